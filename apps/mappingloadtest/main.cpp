@@ -0,0 +1,334 @@
+/**
+ * mappingloadtest: main.cpp
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <boost/chrono.hpp>
+#include <boost/chrono/process_cpu_clocks.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/program_options.hpp>
+#include <boost/thread.hpp>
+
+#include <InputSource/ImageSourceEngine.h>
+using namespace InputSource;
+using namespace ITMLib;
+
+#include <itmx/remotemapping/MappingClient.h>
+#include <itmx/remotemapping/MappingServer.h>
+using namespace itmx;
+
+//#################### NAMESPACE ALIASES ####################
+
+namespace po = boost::program_options;
+
+//#################### TYPEDEFS ####################
+
+typedef boost::chrono::steady_clock Clock;
+
+//#################### TYPES ####################
+
+/**
+ * \brief An instance of this struct holds the statistics gathered for a single simulated client.
+ */
+struct ClientStats
+{
+  //#################### PUBLIC VARIABLES ####################
+
+  /** The number of frames that were dropped on the client side before being sent. */
+  size_t droppedFrames;
+
+  /** The latencies (in milliseconds) of the frames that reached the server, from push on the client to retrieval on the server. */
+  std::vector<double> latencies;
+
+  /** The synchronisation mutex. */
+  boost::mutex mutex;
+
+  /** The times at which the frames were pushed onto the client's queue (indexed by frame number). */
+  std::vector<Clock::time_point> pushTimes;
+
+  //#################### CONSTRUCTORS ####################
+
+  ClientStats()
+  : droppedFrames(0)
+  {}
+};
+
+typedef boost::shared_ptr<ClientStats> ClientStats_Ptr;
+
+//#################### FUNCTIONS ####################
+
+/**
+ * \brief Consumes the frames that a mapping server receives from the specified client, recording the latency of each.
+ *
+ * \param server        The mapping server.
+ * \param clientID      The ID used by the server to refer to the client.
+ * \param clientStats   The statistics for all of the simulated clients.
+ * \param rgbImageSize  The size of the clients' RGB images.
+ * \param depthImageSize  The size of the clients' depth images.
+ */
+void consume_frames(const MappingServer_Ptr& server, int clientID, const std::vector<ClientStats_Ptr>& clientStats,
+                    const Vector2i& rgbImageSize, const Vector2i& depthImageSize)
+{
+  ORUChar4Image_Ptr rgbImage(new ORUChar4Image(rgbImageSize, true, false));
+  ORShortImage_Ptr depthImage(new ORShortImage(depthImageSize, true, false));
+  ORUtils::SE3Pose pose;
+
+  while(server->has_more_images(clientID))
+  {
+    if(!server->has_images_now(clientID))
+    {
+      boost::this_thread::sleep_for(boost::chrono::microseconds(500));
+      continue;
+    }
+
+    server->get_images(clientID, rgbImage.get(), depthImage.get());
+    server->get_pose(clientID, pose);
+    const Clock::time_point receiveTime = Clock::now();
+
+    // The simulated clients encode their own index and the frame number in the translation component of each pose.
+    const Vector3f t = pose.GetT();
+    const size_t clientIndex = static_cast<size_t>(t.x + 0.5f);
+    const size_t frameIndex = static_cast<size_t>(t.y + 0.5f);
+    if(clientIndex >= clientStats.size()) continue;
+
+    ClientStats& stats = *clientStats[clientIndex];
+    boost::lock_guard<boost::mutex> lock(stats.mutex);
+    if(frameIndex < stats.pushTimes.size())
+    {
+      stats.latencies.push_back(boost::chrono::duration<double,boost::milli>(receiveTime - stats.pushTimes[frameIndex]).count());
+    }
+  }
+}
+
+/**
+ * \brief Computes the specified percentile of a set of values.
+ *
+ * \param sortedValues  The values, in ascending order.
+ * \param p             The percentile to compute (in [0,100]).
+ * \return              The specified percentile of the values, or 0 if there are no values.
+ */
+double percentile(const std::vector<double>& sortedValues, double p)
+{
+  if(sortedValues.empty()) return 0.0;
+  const size_t i = static_cast<size_t>(p / 100.0 * (sortedValues.size() - 1) + 0.5);
+  return sortedValues[std::min(i, sortedValues.size() - 1)];
+}
+
+/**
+ * \brief Streams the pre-loaded frames to a mapping server via the specified client.
+ *
+ * \param client          The mapping client.
+ * \param clientIndex     The index of the simulated client.
+ * \param stats           The statistics for the simulated client.
+ * \param rgbImages       The pre-loaded RGB images.
+ * \param depthImages     The pre-loaded depth images.
+ * \param framesPerClient The number of frames to send.
+ * \param fps             The rate at which to send frames (if zero, frames are sent as fast as possible).
+ */
+void stream_frames(MappingClient *client, size_t clientIndex, const ClientStats_Ptr& stats,
+                   const std::vector<ORUChar4Image_Ptr>& rgbImages, const std::vector<ORShortImage_Ptr>& depthImages,
+                   size_t framesPerClient, double fps)
+{
+  const Clock::duration framePeriod = fps > 0.0 ? boost::chrono::duration_cast<Clock::duration>(boost::chrono::duration<double>(1.0 / fps)) : Clock::duration::zero();
+  Clock::time_point nextFrameTime = Clock::now();
+
+  for(size_t i = 0; i < framesPerClient; ++i)
+  {
+    if(framePeriod != Clock::duration::zero())
+    {
+      boost::this_thread::sleep_until(nextFrameTime);
+      nextFrameTime += framePeriod;
+    }
+
+    // Record the push time before pushing, so that it is guaranteed to be available to the consumer.
+    {
+      boost::lock_guard<boost::mutex> lock(stats->mutex);
+      stats->pushTimes[i] = Clock::now();
+    }
+
+    MappingClient::RGBDFrameMessageQueue::PushHandler_Ptr pushHandler = client->begin_push_frame_message();
+    boost::optional<RGBDFrameMessage_Ptr&> elt = pushHandler->get();
+    if(elt)
+    {
+      ORUtils::SE3Pose pose;
+      pose.SetT(Vector3f(static_cast<float>(clientIndex), static_cast<float>(i), 0.0f));
+
+      RGBDFrameMessage& msg = **elt;
+      msg.set_frame_index(static_cast<int>(i));
+      msg.set_pose(pose);
+      msg.set_rgb_image(rgbImages[i % rgbImages.size()]);
+      msg.set_depth_image(depthImages[i % depthImages.size()]);
+    }
+    else
+    {
+      boost::lock_guard<boost::mutex> lock(stats->mutex);
+      ++stats->droppedFrames;
+    }
+  }
+}
+
+int main(int argc, char *argv[])
+try
+{
+  std::string calibrationFilename, depthImageMask, rgbImageMask, transport = "tcp";
+  size_t clientCount = 64, framesPerClient = 300, ioThreadCount = 4, maxFrames = 50;
+  double fps = 30.0;
+  int port = 7852;
+
+  // Parse the command-line arguments.
+  po::options_description options("Mapping Load Test Options");
+  options.add_options()
+    ("help", "produce help message")
+    ("calib,c", po::value<std::string>(&calibrationFilename)->required(), "calibration filename")
+    ("clients", po::value<size_t>(&clientCount)->default_value(clientCount), "number of simulated clients")
+    ("depthMask,d", po::value<std::string>(&depthImageMask)->required(), "depth image mask")
+    ("fps", po::value<double>(&fps)->default_value(fps), "rate at which each client sends frames (0 = as fast as possible)")
+    ("frames", po::value<size_t>(&framesPerClient)->default_value(framesPerClient), "number of frames sent by each client")
+    ("ioThreads", po::value<size_t>(&ioThreadCount)->default_value(ioThreadCount), "number of server I/O threads (0 = one thread per client)")
+    ("maxFrames", po::value<size_t>(&maxFrames)->default_value(maxFrames), "maximum number of frames to load from the sequence")
+    ("port", po::value<int>(&port)->default_value(port), "port on which to run the server")
+    ("rgbMask,r", po::value<std::string>(&rgbImageMask)->required(), "RGB image mask")
+    ("transport", po::value<std::string>(&transport)->default_value(transport), "transport via which the clients send frames (tcp or shm)")
+  ;
+
+  po::variables_map vm;
+  po::store(po::parse_command_line(argc, argv, options), vm);
+  if(vm.count("help"))
+  {
+    std::cout << options << '\n';
+    return EXIT_SUCCESS;
+  }
+  po::notify(vm);
+
+  if(transport != "tcp" && transport != "shm") throw std::runtime_error("Error: Unknown transport '" + transport + "'");
+
+  // Pre-load the frames from the recorded sequence, so that reading them from disk does not affect the measurements.
+  ImageMaskPathGenerator pathGenerator(rgbImageMask.c_str(), depthImageMask.c_str());
+  ImageFileReader<ImageMaskPathGenerator> reader(calibrationFilename.c_str(), pathGenerator);
+  const ITMRGBDCalib calib = reader.getCalib();
+  const Vector2i rgbImageSize = reader.getRGBImageSize(), depthImageSize = reader.getDepthImageSize();
+
+  std::vector<ORUChar4Image_Ptr> rgbImages;
+  std::vector<ORShortImage_Ptr> depthImages;
+  while(rgbImages.size() < maxFrames && reader.hasMoreImages())
+  {
+    ORUChar4Image_Ptr rgbImage(new ORUChar4Image(rgbImageSize, true, false));
+    ORShortImage_Ptr depthImage(new ORShortImage(depthImageSize, true, false));
+    reader.getImages(rgbImage.get(), depthImage.get());
+    rgbImages.push_back(rgbImage);
+    depthImages.push_back(depthImage);
+  }
+
+  if(rgbImages.empty()) throw std::runtime_error("Error: Could not load any frames from the sequence");
+  std::cout << "Loaded " << rgbImages.size() << " frames\n";
+
+  // Start the server.
+  MappingServer_Ptr server(new MappingServer(MappingServer::SM_MULTI_CLIENT, port, ioThreadCount));
+  server->start();
+
+  // Connect the clients and send their calibration messages. Note that MappingClient does not currently support
+  // being shut down cleanly (its message sender thread runs until the process exits), so we deliberately keep
+  // the clients alive until the end of the program.
+  RGBDCalibrationMessage calibMsg;
+  calibMsg.set_calib(calib);
+#ifdef WITH_OPENCV
+  calibMsg.set_depth_compression_type(DEPTH_COMPRESSION_PNG);
+  calibMsg.set_rgb_compression_type(RGB_COMPRESSION_JPG);
+#else
+  calibMsg.set_depth_compression_type(DEPTH_COMPRESSION_NONE);
+  calibMsg.set_rgb_compression_type(RGB_COMPRESSION_NONE);
+#endif
+
+  std::vector<MappingClient*> clients;
+  std::vector<ClientStats_Ptr> clientStats;
+  for(size_t i = 0; i < clientCount; ++i)
+  {
+    // If we're using shared memory, give each client its own segment (frames are then sent uncompressed, bypassing the TCP loopback).
+    const std::string host = transport == "shm" ? "shm://mappingloadtest_" + boost::lexical_cast<std::string>(port) + "_" + boost::lexical_cast<std::string>(i) : "localhost";
+    MappingClient *client = new MappingClient(host, boost::lexical_cast<std::string>(port));
+    client->send_calibration_message(calibMsg);
+    clients.push_back(client);
+
+    ClientStats_Ptr stats(new ClientStats);
+    stats->pushTimes.resize(framesPerClient);
+    clientStats.push_back(stats);
+  }
+
+  // Start a consumer thread for each client on the server side, emulating the per-scene SLAM components.
+  boost::thread_group consumers;
+  for(size_t i = 0; i < clientCount; ++i)
+  {
+    consumers.create_thread(boost::bind(&consume_frames, server, static_cast<int>(i), boost::cref(clientStats), rgbImageSize, depthImageSize));
+  }
+
+  // Stream the frames from all of the clients concurrently. Note that since the clients and the server run in the same process,
+  // the CPU time we measure covers both sides of the transport.
+  const Clock::time_point startTime = Clock::now();
+  const boost::chrono::process_cpu_clock::time_point cpuStartTime = boost::chrono::process_cpu_clock::now();
+
+  boost::thread_group producers;
+  for(size_t i = 0; i < clientCount; ++i)
+  {
+    producers.create_thread(boost::bind(&stream_frames, clients[i], i, clientStats[i], boost::cref(rgbImages), boost::cref(depthImages), framesPerClient, fps));
+  }
+
+  producers.join_all();
+
+  // Give the frames that are still in flight a chance to arrive.
+  const Clock::time_point drainDeadline = Clock::now() + boost::chrono::seconds(10);
+  size_t receivedFrames = 0, droppedFrames = 0;
+  for(;;)
+  {
+    receivedFrames = droppedFrames = 0;
+    for(size_t i = 0; i < clientCount; ++i)
+    {
+      boost::lock_guard<boost::mutex> lock(clientStats[i]->mutex);
+      receivedFrames += clientStats[i]->latencies.size();
+      droppedFrames += clientStats[i]->droppedFrames;
+    }
+
+    if(receivedFrames + droppedFrames >= clientCount * framesPerClient || Clock::now() >= drainDeadline) break;
+    boost::this_thread::sleep_for(boost::chrono::milliseconds(10));
+  }
+
+  const double elapsedSeconds = boost::chrono::duration<double>(Clock::now() - startTime).count();
+  const boost::chrono::process_cpu_clock::times cpuTimes = (boost::chrono::process_cpu_clock::now() - cpuStartTime).count();
+  const double cpuSeconds = (cpuTimes.user + cpuTimes.system) / 1e9;
+
+  // Gather the latencies and report the results.
+  std::vector<double> latencies;
+  for(size_t i = 0; i < clientCount; ++i)
+  {
+    boost::lock_guard<boost::mutex> lock(clientStats[i]->mutex);
+    latencies.insert(latencies.end(), clientStats[i]->latencies.begin(), clientStats[i]->latencies.end());
+  }
+  std::sort(latencies.begin(), latencies.end());
+
+  std::cout << std::fixed << std::setprecision(2)
+            << "Transport: " << transport << ", clients: " << clientCount << ", I/O threads: " << ioThreadCount << ", frames per client: " << framesPerClient << '\n'
+            << "Received frames: " << receivedFrames << ", dropped frames: " << droppedFrames
+            << ", lost frames: " << clientCount * framesPerClient - receivedFrames - droppedFrames << '\n'
+            << "Elapsed time: " << elapsedSeconds << "s, aggregate throughput: " << receivedFrames / elapsedSeconds << " frames/s\n"
+            << "CPU time: " << cpuSeconds << "s (" << 100.0 * cpuSeconds / elapsedSeconds << "% of one core), "
+            << (receivedFrames > 0 ? 1000.0 * cpuSeconds / receivedFrames : 0.0) << " ms per received frame\n"
+            << "Latency (ms): p50 " << percentile(latencies, 50) << ", p95 " << percentile(latencies, 95)
+            << ", p99 " << percentile(latencies, 99) << ", max " << percentile(latencies, 100) << '\n';
+
+  // Stop the server, and wait for the consumer threads to exit (they do so once the server stops reporting their clients as active).
+  server->terminate();
+  consumers.join_all();
+
+  return EXIT_SUCCESS;
+}
+catch(std::exception& e)
+{
+  std::cerr << e.what() << '\n';
+  return EXIT_FAILURE;
+}
@@ -0,0 +1,92 @@
+/**
+ * packsequence: main.cpp
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include <boost/filesystem.hpp>
+#include <boost/format.hpp>
+#include <boost/program_options.hpp>
+
+#include <InputSource/ImageSourceEngine.h>
+using namespace InputSource;
+using namespace ITMLib;
+
+#include <itmx/persistence/PosePersister.h>
+#include <itmx/persistence/RGBDSequenceWriter.h>
+using namespace itmx;
+
+//#################### NAMESPACE ALIASES ####################
+
+namespace bf = boost::filesystem;
+namespace po = boost::program_options;
+
+//#################### FUNCTIONS ####################
+
+int main(int argc, char *argv[])
+try
+{
+  std::string calibrationFilename, depthImageMask, outputFilename, poseFileMask, rgbImageMask;
+  size_t framesPerChunk = 30;
+  int initialFrameNumber = 0;
+
+  // Parse the command-line arguments.
+  po::options_description options("Sequence Packing Options");
+  options.add_options()
+    ("help", "produce help message")
+    ("calib,c", po::value<std::string>(&calibrationFilename)->required(), "calibration filename")
+    ("depthMask,d", po::value<std::string>(&depthImageMask)->required(), "depth image mask")
+    ("framesPerChunk", po::value<size_t>(&framesPerChunk)->default_value(framesPerChunk), "number of frames to store in each chunk")
+    ("initialFrame,n", po::value<int>(&initialFrameNumber)->default_value(initialFrameNumber), "initial frame number")
+    ("output,o", po::value<std::string>(&outputFilename)->required(), "output sequence filename (.rgbds)")
+    ("poseMask,p", po::value<std::string>(&poseFileMask), "pose file mask (optional)")
+    ("rgbMask,r", po::value<std::string>(&rgbImageMask)->required(), "RGB image mask")
+  ;
+
+  po::variables_map vm;
+  po::store(po::parse_command_line(argc, argv, options), vm);
+  if(vm.count("help"))
+  {
+    std::cout << options << '\n';
+    return EXIT_SUCCESS;
+  }
+  po::notify(vm);
+
+  // Set up a reader for the existing sequence.
+  ImageMaskPathGenerator pathGenerator(rgbImageMask.c_str(), depthImageMask.c_str());
+  ImageFileReader<ImageMaskPathGenerator> reader(calibrationFilename.c_str(), pathGenerator, initialFrameNumber);
+  const Vector2i rgbImageSize = reader.getRGBImageSize(), depthImageSize = reader.getDepthImageSize();
+
+  // Copy each frame (and its pose, if available) into the sequence file.
+  RGBDSequenceWriter writer(outputFilename, reader.getCalib(), rgbImageSize, depthImageSize, framesPerChunk);
+  ORUChar4Image_Ptr rgbImage(new ORUChar4Image(rgbImageSize, true, false));
+  ORShortImage_Ptr depthImage(new ORShortImage(depthImageSize, true, false));
+
+  for(int frameNumber = initialFrameNumber; reader.hasMoreImages(); ++frameNumber)
+  {
+    reader.getImages(rgbImage.get(), depthImage.get());
+
+    boost::optional<Matrix4f> pose;
+    if(poseFileMask != "")
+    {
+      const bf::path posePath = (boost::format(poseFileMask) % frameNumber).str();
+      if(bf::exists(posePath)) pose = PosePersister::load_pose(posePath);
+      else std::cerr << "Warning: Missing pose file " << posePath << '\n';
+    }
+
+    writer.write_frame(rgbImage, depthImage, pose);
+  }
+
+  writer.close();
+  std::cout << "Packed " << writer.get_frame_count() << " frames into " << outputFilename << '\n';
+
+  return EXIT_SUCCESS;
+}
+catch(std::exception& e)
+{
+  std::cerr << e.what() << '\n';
+  return EXIT_FAILURE;
+}
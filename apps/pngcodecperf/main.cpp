@@ -0,0 +1,222 @@
+/**
+ * pngcodecperf: main.cpp
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <boost/chrono.hpp>
+#include <boost/program_options.hpp>
+
+#include <lodepng.h>
+
+#include <InputSource/ImageSourceEngine.h>
+using namespace InputSource;
+using namespace ITMLib;
+
+#include <itmx/persistence/ImagePersister.h>
+using namespace itmx;
+
+//#################### NAMESPACE ALIASES ####################
+
+namespace po = boost::program_options;
+
+//#################### TYPEDEFS ####################
+
+typedef boost::chrono::steady_clock Clock;
+
+//#################### FUNCTIONS ####################
+
+/**
+ * \brief Encodes a short image in PNG format in the way ImagePersister originally did (as a baseline).
+ *
+ * \param image   The image to encode.
+ * \param buffer  The buffer into which to write the encoded image.
+ */
+void baseline_encode_png(const ORShortImage_CPtr& image, std::vector<unsigned char>& buffer)
+{
+  const int pixelCount = static_cast<int>(image->dataSize);
+  std::vector<unsigned char> data(pixelCount * 2);
+  const short *src = image->GetData(MEMORYDEVICE_CPU);
+
+  for(int i = 0; i < pixelCount; ++i)
+  {
+    const unsigned char *pixel = reinterpret_cast<const unsigned char*>(&src[i]);
+    data[i * 2] = pixel[1];
+    data[i * 2 + 1] = pixel[0];
+  }
+
+  buffer.clear();
+  lodepng::encode(buffer, &data[0], image->noDims.x, image->noDims.y, LCT_GREY, 16);
+}
+
+/**
+ * \brief Encodes an RGBA image in PNG format in the way ImagePersister originally did (as a baseline).
+ *
+ * \param image   The image to encode.
+ * \param buffer  The buffer into which to write the encoded image.
+ */
+void baseline_encode_png(const ORUChar4Image_CPtr& image, std::vector<unsigned char>& buffer)
+{
+  const int pixelCount = static_cast<int>(image->dataSize);
+  std::vector<unsigned char> data(pixelCount * 4);
+  const Vector4u *src = image->GetData(MEMORYDEVICE_CPU);
+
+  for(int i = 0; i < pixelCount; ++i)
+  {
+    data[i * 4] = src[i].r;
+    data[i * 4 + 1] = src[i].g;
+    data[i * 4 + 2] = src[i].b;
+    data[i * 4 + 3] = src[i].a;
+  }
+
+  buffer.clear();
+  lodepng::encode(buffer, &data[0], image->noDims.x, image->noDims.y);
+}
+
+/**
+ * \brief Gets the number of milliseconds that have elapsed since the specified time point.
+ *
+ * \param start The time point.
+ * \return      The number of milliseconds that have elapsed since the time point.
+ */
+double milliseconds_since(const Clock::time_point& start)
+{
+  return boost::chrono::duration<double,boost::milli>(Clock::now() - start).count();
+}
+
+/**
+ * \brief Prints a row of the results table.
+ *
+ * \param images        The kind of images that were encoded.
+ * \param codec         The codec that was used.
+ * \param encodeMs      The total time (in milliseconds) spent encoding the images.
+ * \param rawBytes      The total size (in bytes) of the raw images.
+ * \param encodedBytes  The total size (in bytes) of the encoded images.
+ * \param frameCount    The number of images.
+ */
+void print_row(const std::string& images, const std::string& codec, double encodeMs, size_t rawBytes, size_t encodedBytes, size_t frameCount)
+{
+  std::cout << std::left << std::setw(8) << images << std::setw(12) << codec << std::right << std::fixed << std::setprecision(2)
+            << std::setw(14) << encodeMs / frameCount
+            << std::setw(14) << (rawBytes / 1048576.0) / (encodeMs / 1000.0)
+            << std::setw(14) << static_cast<double>(rawBytes) / encodedBytes << '\n';
+}
+
+/**
+ * \brief Times the encoding of a set of images using each of the available codecs, and prints the results.
+ *
+ * \param label   A label for the kind of images being encoded.
+ * \param images  The images.
+ */
+template <typename T>
+void time_encoding(const std::string& label, const std::vector<boost::shared_ptr<const ORUtils::Image<T> > >& images)
+{
+  const size_t rawBytes = images.size() * images[0]->dataSize * sizeof(T);
+  std::vector<unsigned char> buffer;
+
+  size_t encodedBytes = 0;
+  Clock::time_point start = Clock::now();
+  for(size_t i = 0, size = images.size(); i < size; ++i)
+  {
+    baseline_encode_png(images[i], buffer);
+    encodedBytes += buffer.size();
+  }
+  print_row(label, "baseline", milliseconds_since(start), rawBytes, encodedBytes, images.size());
+
+  const ImagePersister::PNGCompression modes[] = { ImagePersister::PC_DEFAULT, ImagePersister::PC_FAST };
+  const std::string modeNames[] = { "default", "fast" };
+  for(int m = 0; m < 2; ++m)
+  {
+    encodedBytes = 0;
+    start = Clock::now();
+    for(size_t i = 0, size = images.size(); i < size; ++i)
+    {
+      ImagePersister::encode_png(images[i], buffer, modes[m]);
+      encodedBytes += buffer.size();
+    }
+    print_row(label, modeNames[m], milliseconds_since(start), rawBytes, encodedBytes, images.size());
+  }
+}
+
+int main(int argc, char *argv[])
+try
+{
+  std::string calibrationFilename, depthImageMask, rgbImageMask;
+  size_t maxFrames = 50;
+
+  // Parse the command-line arguments.
+  po::options_description options("PNG Codec Benchmark Options");
+  options.add_options()
+    ("help", "produce help message")
+    ("calib,c", po::value<std::string>(&calibrationFilename)->required(), "calibration filename")
+    ("depthMask,d", po::value<std::string>(&depthImageMask)->required(), "depth image mask")
+    ("maxFrames", po::value<size_t>(&maxFrames)->default_value(maxFrames), "maximum number of frames to load from the sequence")
+    ("rgbMask,r", po::value<std::string>(&rgbImageMask)->required(), "RGB image mask")
+  ;
+
+  po::variables_map vm;
+  po::store(po::parse_command_line(argc, argv, options), vm);
+  if(vm.count("help"))
+  {
+    std::cout << options << '\n';
+    return EXIT_SUCCESS;
+  }
+  po::notify(vm);
+
+  // Pre-load a sample of frames from the sequence, so that reading them from disk does not affect the measurements.
+  ImageMaskPathGenerator pathGenerator(rgbImageMask.c_str(), depthImageMask.c_str());
+  ImageFileReader<ImageMaskPathGenerator> reader(calibrationFilename.c_str(), pathGenerator);
+  const Vector2i rgbImageSize = reader.getRGBImageSize(), depthImageSize = reader.getDepthImageSize();
+
+  std::vector<ORUChar4Image_CPtr> rgbImages;
+  std::vector<ORShortImage_CPtr> depthImages;
+  while(rgbImages.size() < maxFrames && reader.hasMoreImages())
+  {
+    ORUChar4Image_Ptr rgbImage(new ORUChar4Image(rgbImageSize, true, false));
+    ORShortImage_Ptr depthImage(new ORShortImage(depthImageSize, true, false));
+    reader.getImages(rgbImage.get(), depthImage.get());
+    rgbImages.push_back(rgbImage);
+    depthImages.push_back(depthImage);
+  }
+
+  if(rgbImages.empty()) throw std::runtime_error("Error: Could not load any frames from the sequence");
+  std::cout << "Loaded " << rgbImages.size() << " frames\n\n";
+
+  // Time the encoding of the depth and colour images.
+  std::cout << std::left << std::setw(8) << "Images" << std::setw(12) << "Codec" << std::right
+            << std::setw(14) << "ms/frame" << std::setw(14) << "MB/s" << std::setw(14) << "Ratio" << '\n';
+  time_encoding("depth", depthImages);
+  time_encoding("colour", rgbImages);
+
+  // Time the decoding of the colour images, using both lodepng's own decoder and ImagePersister (which uses zlib, if available).
+  std::vector<std::vector<unsigned char> > encodedImages(rgbImages.size());
+  for(size_t i = 0, size = rgbImages.size(); i < size; ++i) ImagePersister::encode_png(rgbImages[i], encodedImages[i]);
+
+  Clock::time_point start = Clock::now();
+  for(size_t i = 0, size = encodedImages.size(); i < size; ++i)
+  {
+    std::vector<unsigned char> data;
+    unsigned int width, height;
+    lodepng::decode(data, width, height, encodedImages[i]);
+  }
+  const double baselineDecodeMs = milliseconds_since(start);
+
+  start = Clock::now();
+  for(size_t i = 0, size = encodedImages.size(); i < size; ++i) ImagePersister::decode_rgba_png(encodedImages[i]);
+  const double decodeMs = milliseconds_since(start);
+
+  std::cout << "\nColour decoding (ms/frame): baseline " << baselineDecodeMs / encodedImages.size()
+            << ", ImagePersister " << decodeMs / encodedImages.size() << '\n';
+
+  return EXIT_SUCCESS;
+}
+catch(std::exception& e)
+{
+  std::cerr << e.what() << '\n';
+  return EXIT_FAILURE;
+}
@@ -0,0 +1,235 @@
+/**
+ * pooledqueueperf: main.cpp
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/chrono.hpp>
+#include <boost/program_options.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+
+#include <tvgutil/containers/PooledQueue.h>
+#include <tvgutil/containers/SPSCPooledQueue.h>
+using namespace tvgutil;
+using namespace tvgutil::pooled_queue;
+
+//#################### NAMESPACE ALIASES ####################
+
+namespace po = boost::program_options;
+
+//#################### TYPEDEFS ####################
+
+typedef boost::chrono::steady_clock Clock;
+
+/** The type of element stored in the queues (the remote mapping queues store shared pointers to frame messages). */
+typedef boost::shared_ptr<size_t> Element;
+
+//#################### TYPES ####################
+
+/**
+ * \brief An instance of this struct holds the results of a single benchmark run.
+ */
+struct RunResult
+{
+  //#################### PUBLIC VARIABLES ####################
+
+  /** The number of elements that were discarded by the producer. */
+  size_t discarded;
+
+  /** The total time taken by the run, in seconds. */
+  double elapsedSeconds;
+
+  /** The number of elements that were received by the consumer. */
+  size_t received;
+
+  //#################### CONSTRUCTORS ####################
+
+  RunResult()
+  : discarded(0), elapsedSeconds(0.0), received(0)
+  {}
+};
+
+//#################### FUNCTIONS ####################
+
+/**
+ * \brief Makes a new queue element.
+ *
+ * \return  The new element.
+ */
+Element make_element()
+{
+  return Element(new size_t(0));
+}
+
+/**
+ * \brief Pops elements from the specified queue until the sentinel value is received.
+ *
+ * \param queue     The queue.
+ * \param sentinel  The value that marks the end of the stream.
+ * \param received  Will be set to the number of (non-sentinel) elements received.
+ */
+template <typename Queue>
+void consume(Queue *queue, size_t sentinel, size_t *received)
+{
+  size_t count = 0;
+  for(;;)
+  {
+    const size_t value = *queue->peek();
+    queue->pop();
+    if(value == sentinel) break;
+    ++count;
+  }
+
+  *received = count;
+}
+
+/**
+ * \brief Pushes the specified number of elements onto the specified queue, followed by a sentinel.
+ *
+ * \param queue     The queue.
+ * \param count     The number of elements to push.
+ * \param sentinel  The value that marks the end of the stream.
+ * \param discarded Will be set to the number of elements that were discarded because the pool was empty.
+ */
+template <typename Queue>
+void produce(Queue *queue, size_t count, size_t sentinel, size_t *discarded)
+{
+  size_t discardCount = 0;
+  for(size_t i = 0; i < count; ++i)
+  {
+    typename Queue::PushHandler_Ptr pushHandler = queue->begin_push();
+    boost::optional<Element&> elt = pushHandler->get();
+    if(elt) **elt = i;
+    else ++discardCount;
+  }
+
+  // Always deliver the sentinel, even if we're discarding elements, so that the consumer knows when to stop.
+  for(;;)
+  {
+    typename Queue::PushHandler_Ptr pushHandler = queue->begin_push();
+    boost::optional<Element&> elt = pushHandler->get();
+    if(elt)
+    {
+      **elt = sentinel;
+      break;
+    }
+    boost::this_thread::yield();
+  }
+
+  *discarded = discardCount;
+}
+
+/**
+ * \brief Runs a single producer/consumer benchmark on a queue of the specified type.
+ *
+ * \param strategy  The pool empty strategy to use.
+ * \param capacity  The capacity of the queue's pool.
+ * \param count     The number of elements to push.
+ * \return          The results of the run.
+ */
+template <typename Queue>
+RunResult run_benchmark(PoolEmptyStrategy strategy, size_t capacity, size_t count)
+{
+  Queue queue(strategy);
+  queue.initialise(capacity, &make_element);
+
+  const size_t sentinel = count;
+  RunResult result;
+
+  const Clock::time_point startTime = Clock::now();
+  boost::thread consumer(boost::bind(&consume<Queue>, &queue, sentinel, &result.received));
+  boost::thread producer(boost::bind(&produce<Queue>, &queue, count, sentinel, &result.discarded));
+  producer.join();
+  consumer.join();
+  result.elapsedSeconds = boost::chrono::duration<double>(Clock::now() - startTime).count();
+
+  return result;
+}
+
+/**
+ * \brief Runs the specified benchmark several times and prints the median results.
+ *
+ * \param name      The name of the queue implementation.
+ * \param strategy  The pool empty strategy to use.
+ * \param capacity  The capacity of the queue's pool.
+ * \param count     The number of elements to push in each run.
+ * \param runs      The number of runs.
+ */
+template <typename Queue>
+void report_benchmark(const std::string& name, PoolEmptyStrategy strategy, size_t capacity, size_t count, size_t runs)
+{
+  std::vector<RunResult> results;
+  for(size_t i = 0; i < runs; ++i)
+  {
+    results.push_back(run_benchmark<Queue>(strategy, capacity, count));
+  }
+
+  std::vector<double> throughputs;
+  size_t received = 0, discarded = 0;
+  for(size_t i = 0; i < runs; ++i)
+  {
+    throughputs.push_back(count / results[i].elapsedSeconds / 1e6);
+    received += results[i].received;
+    discarded += results[i].discarded;
+  }
+
+  std::sort(throughputs.begin(), throughputs.end());
+  std::cout << std::left << std::setw(10) << name << std::setw(16) << strategy << std::right << std::fixed << std::setprecision(2)
+            << std::setw(14) << throughputs[runs / 2] << std::setw(14) << throughputs.front() << std::setw(14) << throughputs.back()
+            << std::setw(14) << received / runs << std::setw(14) << discarded / runs << '\n';
+}
+
+int main(int argc, char *argv[])
+try
+{
+  size_t capacity = 8, count = 1000000, runs = 5;
+
+  // Parse the command-line arguments.
+  po::options_description options("Pooled Queue Benchmark Options");
+  options.add_options()
+    ("help", "produce help message")
+    ("capacity", po::value<size_t>(&capacity)->default_value(capacity), "capacity of each queue's pool")
+    ("count", po::value<size_t>(&count)->default_value(count), "number of elements pushed in each run")
+    ("runs", po::value<size_t>(&runs)->default_value(runs), "number of runs per configuration")
+  ;
+
+  po::variables_map vm;
+  po::store(po::parse_command_line(argc, argv, options), vm);
+  if(vm.count("help"))
+  {
+    std::cout << options << '\n';
+    return EXIT_SUCCESS;
+  }
+  po::notify(vm);
+
+  if(capacity == 0 || runs == 0) throw std::runtime_error("Error: The capacity and number of runs must be non-zero");
+
+  // Compare the mutex-based and lock-free queues under each pool empty strategy. Throughput is measured in
+  // millions of pushes per second (including discarded pushes), and we report the median, minimum and maximum.
+  std::cout << "Capacity: " << capacity << ", elements per run: " << count << ", runs: " << runs << "\n\n"
+            << std::left << std::setw(10) << "Queue" << std::setw(16) << "Strategy" << std::right
+            << std::setw(14) << "Median Mop/s" << std::setw(14) << "Min Mop/s" << std::setw(14) << "Max Mop/s"
+            << std::setw(14) << "Received" << std::setw(14) << "Discarded" << '\n';
+
+  const PoolEmptyStrategy strategies[] = { PES_DISCARD, PES_GROW, PES_REPLACE_RANDOM, PES_WAIT };
+  for(size_t i = 0; i < sizeof(strategies) / sizeof(strategies[0]); ++i)
+  {
+    report_benchmark<PooledQueue<Element> >("mutex", strategies[i], capacity, count, runs);
+    report_benchmark<SPSCPooledQueue<Element> >("spsc", strategies[i], capacity, count, runs);
+  }
+
+  return EXIT_SUCCESS;
+}
+catch(std::exception& e)
+{
+  std::cerr << e.what() << '\n';
+  return EXIT_FAILURE;
+}
@@ -3,11 +3,16 @@
  * Copyright (c) Torr Vision Group, University of Oxford, 2015. All rights reserved.
  */
 
+#include <climits>
+
 #include <boost/assign/list_of.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/thread.hpp>
 using boost::assign::list_of;
 using boost::assign::map_list_of;
 
+#include <evaluation/core/ParallelLearnerEvaluator.h>
 #include <evaluation/core/ParamSetUtil.h>
 #include <evaluation/core/PerformanceTable.h>
 #include <evaluation/splitgenerators/CrossValidationSplitGenerator.h>
@@ -22,6 +27,7 @@ using namespace rafl;
 #include <raflevaluation/RandomForestEvaluator.h>
 using namespace raflevaluation;
 
+#include <tvgutil/misc/ThreadPool.h>
 #include <tvgutil/timing/Timer.h>
 #include <tvgutil/timing/TimeUtil.h>
 using namespace tvgutil;
@@ -33,17 +39,70 @@ typedef boost::shared_ptr<const Example<Label> > Example_CPtr;
 
 //#################### FUNCTIONS ####################
 
-int main(int argc, char *argv[])
+/**
+ * \brief Measures the training throughput of a random forest for increasing numbers of threads.
+ *
+ * The same forest is trained on the same examples on pools of 1, 2, 4, ... threads (up to the number of hardware threads),
+ * and the rates at which examples are added and nodes are split are output for each thread count.
+ *
+ * \param seed The seed to use for the example generator and the forest.
+ */
+void run_throughput_test(unsigned int seed)
 {
-#if WITH_OPENMP
-  omp_set_nested(1);
-#endif
+  const size_t treeCount = 8;
+  std::map<std::string,std::string> settings = map_list_of<std::string,std::string>
+    ("candidateCount", "256")
+    ("decisionFunctionGeneratorParams", "")
+    ("decisionFunctionGeneratorType", "FeatureThresholding")
+    ("gainThreshold", "0")
+    ("maxClassSize", "10000")
+    ("maxTreeHeight", "20")
+    ("randomSeed", boost::lexical_cast<std::string>(seed))
+    ("seenExamplesThreshold", "50")
+    ("splittabilityThreshold", "0.8")
+    ("usePMFReweighting", "1");
+
+  std::set<Label> classLabels = list_of(1)(3)(5)(7);
+  UnitCircleExampleGenerator<Label> uceg(classLabels, seed);
+  std::vector<Example_CPtr> examples = uceg.generate_examples(classLabels, 25000);
+
+  const size_t maxThreadCount = std::max(boost::thread::hardware_concurrency(), 1U);
+  std::cout << "Trees: " << treeCount << ", Examples: " << examples.size() << '\n';
+  std::cout << "Threads\tAddExamples (examples/s)\tTrain (splits/s)\n";
+
+  for(size_t threadCount = 1; threadCount <= maxThreadCount; threadCount *= 2)
+  {
+    ThreadPool threadPool(threadCount);
+    RandomForest<Label> forest(treeCount, DecisionTree<Label>::Settings(settings));
+    forest.set_thread_pool(threadPool);
+
+    boost::chrono::high_resolution_clock::time_point t0 = boost::chrono::high_resolution_clock::now();
+    forest.add_examples(examples);
+    boost::chrono::high_resolution_clock::time_point t1 = boost::chrono::high_resolution_clock::now();
+    size_t nodesSplit = forest.train(INT_MAX);
+    boost::chrono::high_resolution_clock::time_point t2 = boost::chrono::high_resolution_clock::now();
+
+    const double addSeconds = boost::chrono::duration<double>(t1 - t0).count();
+    const double trainSeconds = boost::chrono::duration<double>(t2 - t1).count();
+    std::cout << threadCount << '\t' << examples.size() * treeCount / addSeconds << '\t' << nodesSplit / trainSeconds << '\n';
+  }
+}
 
+int main(int argc, char *argv[])
+{
   const unsigned int seed = 12345;
 
+  if(argc == 2 && std::string(argv[1]) == "--throughput")
+  {
+    DecisionFunctionGeneratorFactory<Label>::instance().register_rafl_makers();
+    run_throughput_test(seed);
+    return 0;
+  }
+
   if(argc != 1 && argc != 4)
   {
     std::cerr << "Usage: raflperf [<training set file> <test set file> <output path>]\n";
+    std::cerr << "       raflperf --throughput\n";
     return EXIT_FAILURE;
   }
 
@@ -147,13 +206,8 @@ int main(int argc, char *argv[])
 
   // Evaluate the random forest on the various different parameter sets.
   PerformanceTable results(list_of("Accuracy"));
-  boost::shared_ptr<RandomForestEvaluator<Label> > evaluator;
-  for(size_t n = 0, size = params.size(); n < size; ++n)
-  {
-    evaluator.reset(new RandomForestEvaluator<Label>(splitGenerator, params[n]));
-    PerformanceResult result = evaluator->evaluate(examples);
-    results.record_performance(params[n], result);
-  }
+  ParallelLearnerEvaluator<Example<Label> > evaluator(boost::bind(&RandomForestEvaluator<Label>::make_evaluator, splitGenerator, _1));
+  evaluator.evaluate(params, examples, results);
 
   timer.stop();
   std::cout << timer << '\n';
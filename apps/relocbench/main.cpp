@@ -0,0 +1,311 @@
+/**
+ * relocbench: main.cpp
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#include <grove/relocalisation/ScoreRelocaliserFactory.h>
+using namespace grove;
+
+#include <itmx/relocalisation/RelocaliserBenchmark.h>
+using namespace itmx;
+
+#include <orx/base/MemoryBlockFactory.h>
+using namespace orx;
+
+#include <tvgutil/filesystem/PathFinder.h>
+#include <tvgutil/misc/SettingsContainer.h>
+using namespace tvgutil;
+
+//#################### NAMESPACE ALIASES ####################
+
+namespace bf = boost::filesystem;
+namespace po = boost::program_options;
+namespace pt = boost::property_tree;
+
+//#################### TYPES ####################
+
+/**
+ * \brief This struct holds user-specifiable arguments.
+ */
+struct CommandLineArguments
+{
+  double accuracyTolerance;
+  std::string baselineFilename;
+  std::string calibrationFilename;
+  bool cpu;
+  std::string csvFilename;
+  std::string forestFilename;
+  size_t frameStep;
+  std::string jsonFilename;
+  size_t maxFrameCount;
+  std::string testFolder;
+  double tolerance;
+  std::string trainFolder;
+};
+
+//#################### FUNCTIONS ####################
+
+/**
+ * \brief Adds all options in a set of parsed options to a settings container object.
+ *
+ * \param parsedOptions The set of parsed options.
+ * \param settings      The settings container object.
+ */
+void add_options_to_settings(const po::parsed_options& parsedOptions, const SettingsContainer_Ptr& settings)
+{
+  for(size_t i = 0, optionCount = parsedOptions.options.size(); i < optionCount; ++i)
+  {
+    const po::basic_option<char>& option = parsedOptions.options[i];
+
+    // Add all the specified values for the option in the correct order.
+    for(size_t j = 0, valueCount = option.value.size(); j < valueCount; ++j)
+    {
+      settings->add_value(option.string_key, option.value[j]);
+    }
+  }
+}
+
+/**
+ * \brief Checks that a "higher is better" metric has not regressed relative to its baseline value.
+ *
+ * \param name            The name of the metric.
+ * \param value           The value of the metric in the current run.
+ * \param baselineValue   The value of the metric in the baseline run.
+ * \param minValue        The smallest value of the metric that does not count as a regression.
+ * \return                true, if the metric has not regressed, or false otherwise.
+ */
+bool check_at_least(const std::string& name, double value, double baselineValue, double minValue)
+{
+  const bool ok = value >= minValue;
+  std::cout << (ok ? "[ OK ] " : "[FAIL] ") << name << ": " << value << " (baseline " << baselineValue << ", minimum " << minValue << ")\n";
+  return ok;
+}
+
+/**
+ * \brief Checks that a "lower is better" metric has not regressed relative to its baseline value.
+ *
+ * \param name            The name of the metric.
+ * \param value           The value of the metric in the current run.
+ * \param baselineValue   The value of the metric in the baseline run.
+ * \param maxValue        The largest value of the metric that does not count as a regression.
+ * \return                true, if the metric has not regressed, or false otherwise.
+ */
+bool check_at_most(const std::string& name, double value, double baselineValue, double maxValue)
+{
+  const bool ok = value <= maxValue;
+  std::cout << (ok ? "[ OK ] " : "[FAIL] ") << name << ": " << value << " (baseline " << baselineValue << ", maximum " << maxValue << ")\n";
+  return ok;
+}
+
+/**
+ * \brief Compares the results of a benchmark run against a baseline previously written by write_json.
+ *
+ * The accuracy may not drop by more than the (absolute) accuracy tolerance, and the throughput, the median and 95th
+ * percentile stage latencies and the peak memory held by memory blocks may not get worse by more than the (relative)
+ * performance tolerance. Stages that do not appear in the baseline are ignored.
+ *
+ * \param results           The results of the benchmark run.
+ * \param baselineFilename  The name of the file containing the baseline results.
+ * \param tolerance         The fraction by which the performance metrics may get worse without counting as a regression.
+ * \param accuracyTolerance The amount by which the accuracy may drop without counting as a regression.
+ * \return                  true, if there were no regressions, or false otherwise.
+ */
+bool compare_with_baseline(const RelocaliserBenchmark::Results& results, const std::string& baselineFilename, double tolerance, double accuracyTolerance)
+{
+  pt::ptree baseline;
+  pt::read_json(baselineFilename, baseline);
+
+  std::cout << "Comparing against baseline: " << baselineFilename << '\n';
+
+  bool ok = true;
+
+  const double baselineAccuracy = baseline.get<double>("accuracy");
+  ok &= check_at_least("accuracy", results.accuracy, baselineAccuracy, baselineAccuracy - accuracyTolerance);
+
+  const double baselineTrainingFps = baseline.get<double>("trainingFramesPerSecond");
+  ok &= check_at_least("trainingFramesPerSecond", results.trainingFramesPerSecond, baselineTrainingFps, baselineTrainingFps * (1.0 - tolerance));
+
+  const double baselineTestingFps = baseline.get<double>("testingFramesPerSecond");
+  ok &= check_at_least("testingFramesPerSecond", results.testingFramesPerSecond, baselineTestingFps, baselineTestingFps * (1.0 - tolerance));
+
+  const double baselineHostBytes = baseline.get<double>("peakHostBlockBytes");
+  ok &= check_at_most("peakHostBlockBytes", static_cast<double>(results.peakHostBlockBytes), baselineHostBytes, baselineHostBytes * (1.0 + tolerance));
+
+  const double baselineDeviceBytes = baseline.get<double>("peakDeviceBlockBytes");
+  ok &= check_at_most("peakDeviceBlockBytes", static_cast<double>(results.peakDeviceBlockBytes), baselineDeviceBytes, baselineDeviceBytes * (1.0 + tolerance));
+
+  for(size_t i = 0, size = results.stages.size(); i < size; ++i)
+  {
+    const RelocaliserBenchmark::StageStatistics& s = results.stages[i];
+
+    // Note: Stage names cannot contain dots, so they can safely be used as property tree paths.
+    boost::optional<const pt::ptree&> baselineStage = baseline.get_child_optional("stages." + s.name);
+    if(!baselineStage) continue;
+
+    const double baselineP50 = baselineStage->get<double>("p50Ms"), baselineP95 = baselineStage->get<double>("p95Ms");
+    ok &= check_at_most(s.name + ".p50Ms", s.p50Ms, baselineP50, baselineP50 * (1.0 + tolerance));
+    ok &= check_at_most(s.name + ".p95Ms", s.p95Ms, baselineP95, baselineP95 * (1.0 + tolerance));
+  }
+
+  return ok;
+}
+
+/**
+ * \brief Parses any command-line arguments passed in by the user and adds them to the application settings.
+ *
+ * \param argc      The command-line argument count.
+ * \param argv      The raw command-line arguments.
+ * \param args      The parsed command-line arguments.
+ * \param settings  The application settings.
+ * \return          true, if the program should continue after parsing the command-line arguments, or false otherwise.
+ */
+bool parse_command_line(int argc, char *argv[], CommandLineArguments& args, const SettingsContainer_Ptr& settings)
+{
+  // Specify the possible options.
+  po::options_description genericOptions("Generic options");
+  genericOptions.add_options()
+    ("help", "produce help message")
+    ("configFile,f", po::value<std::string>(), "additional parameters filename")
+    ("cpu", po::bool_switch(&args.cpu), "run the relocaliser on the CPU")
+    ("forest", po::value<std::string>(&args.forestFilename)->default_value(""), "the forest filename (defaults to the forest in the resources directory)")
+  ;
+
+  po::options_description sequenceOptions("Sequence options");
+  sequenceOptions.add_options()
+    ("calib,c", po::value<std::string>(&args.calibrationFilename)->required(), "calibration filename")
+    ("frameStep", po::value<size_t>(&args.frameStep)->default_value(1), "the step between the frames to use from each sequence")
+    ("maxFrames", po::value<size_t>(&args.maxFrameCount)->default_value(0), "the maximum number of frames to use from each sequence (0 = all)")
+    ("test", po::value<std::string>(&args.testFolder)->required(), "path to the folder containing the testing sequence")
+    ("train", po::value<std::string>(&args.trainFolder)->required(), "path to the folder containing the training sequence")
+  ;
+
+  po::options_description outputOptions("Output options");
+  outputOptions.add_options()
+    ("accuracyTolerance", po::value<double>(&args.accuracyTolerance)->default_value(0.01), "the amount by which the accuracy may drop relative to the baseline")
+    ("baseline", po::value<std::string>(&args.baselineFilename)->default_value(""), "a JSON file containing baseline results against which to compare")
+    ("csvFile", po::value<std::string>(&args.csvFilename)->default_value(""), "a file to which to write the per-frame results in CSV format")
+    ("jsonFile", po::value<std::string>(&args.jsonFilename)->default_value(""), "a file to which to write the summary results in JSON format")
+    ("tolerance", po::value<double>(&args.tolerance)->default_value(0.1), "the fraction by which the performance may get worse relative to the baseline")
+  ;
+
+  po::options_description options;
+  options.add(genericOptions);
+  options.add(sequenceOptions);
+  options.add(outputOptions);
+
+  // Parse the command line.
+  po::parsed_options parsedCommandLineOptions = po::parse_command_line(argc, argv, options);
+
+  // Add all options to the settings.
+  add_options_to_settings(parsedCommandLineOptions, settings);
+
+  // Also store them in the variable map.
+  po::variables_map vm;
+  po::store(parsedCommandLineOptions, vm);
+
+  // If the user specifies the --help flag, print a help message.
+  if(vm.count("help"))
+  {
+    std::cout << options << '\n';
+    return false;
+  }
+
+  // If a configuration file was specified, parse additional options from it (including any relocaliser settings).
+  if(vm.count("configFile"))
+  {
+    po::parsed_options parsedConfigFileOptions = po::parse_config_file<char>(vm["configFile"].as<std::string>().c_str(), options, true);
+    po::store(parsedConfigFileOptions, vm);
+    add_options_to_settings(parsedConfigFileOptions, settings);
+  }
+
+  po::notify(vm);
+
+  return true;
+}
+
+int main(int argc, char *argv[])
+try
+{
+  // Parse the command-line arguments.
+  SettingsContainer_Ptr settings(new SettingsContainer);
+  CommandLineArguments args;
+  if(!parse_command_line(argc, argv, args, settings))
+  {
+    return EXIT_SUCCESS;
+  }
+
+#ifdef WITH_CUDA
+  const DeviceType deviceType = args.cpu ? DEVICE_CPU : DEVICE_CUDA;
+#else
+  const DeviceType deviceType = DEVICE_CPU;
+#endif
+
+  MemoryBlockFactory::instance().set_device_type(deviceType);
+
+  // Load the training and testing sequences into memory, so that disk I/O does not affect the timings.
+  const std::string depthImageMask = settings->get_first_value<std::string>("depthImageMask", "frame-%06d.depth.png");
+  const std::string poseFileMask = settings->get_first_value<std::string>("poseFileMask", "frame-%06d.pose.txt");
+  const std::string rgbImageMask = settings->get_first_value<std::string>("rgbImageMask", "frame-%06d.color.png");
+
+  std::cout << "Loading sequences...\n";
+  const bf::path trainFolder(args.trainFolder), testFolder(args.testFolder);
+  RelocalisationSequence trainingSequence(
+    args.calibrationFilename, (trainFolder / rgbImageMask).string(), (trainFolder / depthImageMask).string(), (trainFolder / poseFileMask).string(),
+    args.frameStep, args.maxFrameCount
+  );
+  RelocalisationSequence testingSequence(
+    args.calibrationFilename, (testFolder / rgbImageMask).string(), (testFolder / depthImageMask).string(), (testFolder / poseFileMask).string(),
+    args.frameStep, args.maxFrameCount
+  );
+  std::cout << "Training frames: " << trainingSequence.get_frame_count() << ", testing frames: " << testingSequence.get_frame_count() << '\n';
+
+  // Construct the relocaliser.
+  const std::string forestFilename = args.forestFilename.empty()
+    ? (find_subdir_from_executable("resources") / "DefaultRelocalisationForest.rf").string()
+    : args.forestFilename;
+  std::cout << "Loading relocalisation forest from: " << forestFilename << '\n';
+  ScoreRelocaliser_Ptr relocaliser = ScoreRelocaliserFactory::make_score_relocaliser(forestFilename, settings, deviceType);
+
+  // Run the benchmark.
+  const RelocaliserBenchmark::Results results = RelocaliserBenchmark::run(relocaliser, trainingSequence, testingSequence, deviceType);
+  relocaliser.reset();
+
+  RelocaliserBenchmark::write_json(std::cout, results);
+
+  if(!args.jsonFilename.empty())
+  {
+    std::ofstream fs(args.jsonFilename.c_str());
+    RelocaliserBenchmark::write_json(fs, results);
+  }
+
+  if(!args.csvFilename.empty())
+  {
+    std::ofstream fs(args.csvFilename.c_str());
+    RelocaliserBenchmark::write_csv(fs, results);
+  }
+
+  // If a baseline was specified, compare the results against it, and fail if anything has regressed.
+  if(!args.baselineFilename.empty() && !compare_with_baseline(results, args.baselineFilename, args.tolerance, args.accuracyTolerance))
+  {
+    std::cerr << "Error: The benchmark results have regressed relative to the baseline\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+catch(std::exception& e)
+{
+  std::cerr << e.what() << '\n';
+  return EXIT_FAILURE;
+}
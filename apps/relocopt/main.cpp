@@ -3,6 +3,7 @@
  * Copyright (c) Torr Vision Group, University of Oxford, 2017. All rights reserved.
  */
 
+#include <cmath>
 #include <fstream>
 #include <iostream>
 #include <limits>
@@ -11,15 +12,28 @@
 #include <boost/assign/list_of.hpp>
 #include <boost/bind.hpp>
 #include <boost/chrono.hpp>
+#include <boost/lexical_cast.hpp>
 #include <boost/program_options.hpp>
+#include <boost/ref.hpp>
 #include <boost/timer/timer.hpp>
 using boost::assign::list_of;
 
 #include <evaluation/util/CoordinateDescentParameterOptimiser.h>
+#include <evaluation/util/ParamSetCostLog.h>
 #include <evaluation/util/RandomParameterOptimiser.h>
 using namespace evaluation;
 
+#include <grove/relocalisation/ScoreRelocaliserFactory.h>
+using namespace grove;
+
+#include <itmx/relocalisation/RelocaliserBenchmark.h>
+using namespace itmx;
+
+#include <orx/base/MemoryBlockFactory.h>
+using namespace orx;
+
 #include <tvgutil/filesystem/PathFinder.h>
+#include <tvgutil/misc/SettingsContainer.h>
 using namespace tvgutil;
 
 //#define COST_IS_TIME
@@ -37,14 +51,22 @@ namespace po = boost::program_options;
 
 struct Arguments
 {
+  bool cpu;
   std::string datasetDir;
   bf::path dir;
+  std::string forestFilename;
+  size_t frameStep;
+  bool inProcess;
   std::string iniSpecifier;
   bf::path logPath;
   std::string logSpecifier;
+  bool noTimeBudget;
   std::string outputSpecifier;
+  bool resume;
   bf::path scriptPath;
   std::string scriptSpecifier;
+  std::vector<std::string> sequences;
+  size_t threadCount;
 
   Arguments()
   : dir(find_subdir_from_executable("resources")),
@@ -53,9 +75,139 @@ struct Arguments
   {}
 };
 
+/**
+ * \brief An instance of this struct holds the data that is shared between all of the in-process evaluations.
+ *
+ * The forest and the sequences are loaded once, up-front, and then reused (concurrently) by every evaluation.
+ */
+struct InProcessData
+{
+  /** The device on which the relocalisers should operate. */
+  DeviceType deviceType;
+
+  /** The pre-trained forest on which the relocalisers should be based. */
+  ScoreRelocaliser::ScoreForest_Ptr forest;
+
+  /** The names of the sequences. */
+  std::vector<std::string> sequenceNames;
+
+  /** The training sequences (one per scene). */
+  std::vector<RelocalisationSequence_CPtr> trainingSequences;
+
+  /** Whether or not to penalise parameter sets whose training or relocalisation times exceed the time budget. */
+  bool useTimeBudget;
+
+  /** The validation sequences (one per scene). */
+  std::vector<RelocalisationSequence_CPtr> validationSequences;
+};
+
+//#################### TYPEDEFS ####################
+
+/** A function that computes the cost of a parameter set, and also returns the values of some additional columns to be written to the log. */
+typedef boost::function<float(const ParamSet&,std::vector<std::string>&)> LoggingCostFunction;
+
 //#################### FUNCTIONS ####################
 
-float grove_cost_fn(const Arguments& args, const ParamSet& params)
+/**
+ * \brief Computes the cost of a parameter set, reusing its cost from the log if it has already been evaluated.
+ *
+ * \param log     The log.
+ * \param costFn  The function to use to compute the cost if it is not in the log.
+ * \param params  The parameter set.
+ * \return        The cost of the parameter set.
+ */
+float cached_cost_fn(ParamSetCostLog& log, const LoggingCostFunction& costFn, const ParamSet& params)
+{
+  boost::optional<float> cachedCost = log.lookup_cost(params);
+  if(cachedCost)
+  {
+    std::cout << "Reusing logged cost " << *cachedCost << " for " << ParamSetUtil::param_set_to_string(params) << '\n';
+    return *cachedCost;
+  }
+
+  std::vector<std::string> extraValues;
+  const float cost = costFn(params, extraValues);
+  log.record_cost(params, cost, extraValues);
+  return cost;
+}
+
+/**
+ * \brief Computes the cost of a parameter set by evaluating it in-process on the validation sequences of each scene.
+ *
+ * \param data        The data shared between all of the in-process evaluations.
+ * \param params      The parameter set.
+ * \param extraValues A place in which to store the values of the additional columns to be written to the log.
+ * \return            The cost of the parameter set.
+ */
+float grove_in_process_cost_fn(const InProcessData& data, const ParamSet& params, std::vector<std::string>& extraValues)
+{
+  typedef boost::chrono::steady_clock Clock;
+  const Clock::time_point start = Clock::now();
+
+  // Make the settings for the relocalisers, starting from the defaults and then overriding them with the parameters being evaluated.
+  SettingsContainer_Ptr settings(new SettingsContainer);
+  settings->add_value("ScoreRelocaliser.maxRelocalisationsToOutput", "1");
+  settings->add_value("ScoreRelocaliser.visualiseForest", "false");
+  for(ParamSet::const_iterator it = params.begin(), iend = params.end(); it != iend; ++it)
+  {
+    settings->add_value(it->first, it->second);
+  }
+
+  // Train and test a fresh relocaliser on each scene (sharing the forest), and accumulate the loss in the same way as relocperf.
+  float relocLoss = 0.0f, trainingMicroseconds = 0.0f, relocalisationMicroseconds = 0.0f;
+  for(size_t i = 0, sequenceCount = data.sequenceNames.size(); i < sequenceCount; ++i)
+  {
+    ScoreRelocaliser_Ptr relocaliser = ScoreRelocaliserFactory::make_score_relocaliser(data.forest, settings, "ScoreRelocaliser.", data.deviceType);
+    const RelocaliserBenchmark::Results results = RelocaliserBenchmark::run(relocaliser, *data.trainingSequences[i], *data.validationSequences[i], data.deviceType);
+
+    relocLoss += static_cast<float>(std::pow(1.0 - results.accuracy, 2));
+
+    for(size_t j = 0, stageCount = results.stages.size(); j < stageCount; ++j)
+    {
+      const RelocaliserBenchmark::StageStatistics& stage = results.stages[j];
+      if(stage.name == "Train") trainingMicroseconds += static_cast<float>(stage.meanMs * 1000.0);
+      else if(stage.name == "Relocalise") relocalisationMicroseconds += static_cast<float>(stage.meanMs * 1000.0);
+    }
+  }
+
+  // Average the timings over the scenes.
+  trainingMicroseconds /= data.sequenceNames.size();
+  relocalisationMicroseconds /= data.sequenceNames.size();
+
+  // If we ran past the computation budget, penalise the cost (see grove_script_cost_fn). Note that this is only done if the parameter
+  // sets are being evaluated one at a time, since otherwise the timings would be inflated by contention with the other evaluations.
+  static const float maxTrainingTime = 10000;        // 10ms
+  static const float maxRelocalisationTime = 150000; // 150ms
+
+  float cost = relocLoss;
+  if(data.useTimeBudget && (trainingMicroseconds > maxTrainingTime || relocalisationMicroseconds > maxRelocalisationTime))
+  {
+    cost += 100.0f;
+  }
+
+  const float elapsedSeconds = boost::chrono::duration<float>(Clock::now() - start).count();
+
+  extraValues.push_back(boost::lexical_cast<std::string>(elapsedSeconds));
+  extraValues.push_back(boost::lexical_cast<std::string>(relocLoss));
+  extraValues.push_back(boost::lexical_cast<std::string>(trainingMicroseconds));
+  extraValues.push_back(boost::lexical_cast<std::string>(relocalisationMicroseconds));
+
+#ifdef COST_IS_TIME
+  return elapsedSeconds;
+#else
+  return cost;
+#endif
+}
+
+/**
+ * \brief Computes the cost of a parameter set by running an external script (which runs spaintgui and relocperf on each scene).
+ *
+ * \param args        The command-line arguments.
+ * \param params      The parameter set.
+ * \param extraValues A place in which to store the values of the additional columns to be written to the log.
+ * \return            The cost of the parameter set.
+ */
+float grove_script_cost_fn(const Arguments& args, const ParamSet& params, std::vector<std::string>& extraValues)
 {
   // Write the parameters to the specified .ini file.
   const bf::path iniPath = args.dir / (args.iniSpecifier + ".ini");
@@ -86,7 +238,8 @@ float grove_cost_fn(const Arguments& args, const ParamSet& params)
 
   // Read the results back in from the output file.
   float cost = std::numeric_limits<float>::max();
-  float relocLoss, icpLoss, trainingMicroseconds, updateMicroseconds, initialRelocalisationMicroseconds, icpRefinementMicroseconds, totalRelocalisationMicroseconds;
+  float relocLoss = 0.0f, icpLoss = 0.0f, trainingMicroseconds = 0.0f, updateMicroseconds = 0.0f;
+  float initialRelocalisationMicroseconds = 0.0f, icpRefinementMicroseconds = 0.0f, totalRelocalisationMicroseconds = 0.0f;
 
   {
     std::ifstream fs(outputPath.string().c_str());
@@ -115,17 +268,15 @@ float grove_cost_fn(const Arguments& args, const ParamSet& params)
     }
   }
 
-  std::ofstream logStream(args.logPath.c_str(), std::ios::app);
-  logStream << cost << ';'
-            << elapsedSeconds << ';'
-            << relocLoss << ';'
-            << icpLoss << ';'
-            << trainingMicroseconds << ';'
-            << updateMicroseconds << ';'
-            << initialRelocalisationMicroseconds << ';'
-            << icpRefinementMicroseconds << ';'
-            << totalRelocalisationMicroseconds << ';'
-            << ParamSetUtil::param_set_to_string(params) << '\n';
+  const float values[] = {
+    elapsedSeconds, relocLoss, icpLoss, trainingMicroseconds, updateMicroseconds,
+    initialRelocalisationMicroseconds, icpRefinementMicroseconds, totalRelocalisationMicroseconds
+  };
+
+  for(size_t i = 0, size = sizeof(values) / sizeof(float); i < size; ++i)
+  {
+    extraValues.push_back(boost::lexical_cast<std::string>(values[i]));
+  }
 
   // Delete the .ini file and the output file again.
   bf::remove(iniPath);
@@ -138,15 +289,71 @@ float grove_cost_fn(const Arguments& args, const ParamSet& params)
 #endif
 }
 
+/**
+ * \brief Loads the data that is shared between all of the in-process evaluations.
+ *
+ * \param args  The command-line arguments.
+ * \return      The data.
+ */
+InProcessData load_in_process_data(const Arguments& args)
+{
+  InProcessData data;
+
+#ifdef WITH_CUDA
+  data.deviceType = args.cpu ? DEVICE_CPU : DEVICE_CUDA;
+#else
+  data.deviceType = DEVICE_CPU;
+#endif
+
+  MemoryBlockFactory::instance().set_device_type(data.deviceType);
+
+  data.useTimeBudget = !args.noTimeBudget;
+
+  std::cout << "Loading relocalisation forest from: " << args.forestFilename << '\n';
+  data.forest = ScoreRelocaliserFactory::load_forest(args.forestFilename, data.deviceType);
+
+  const bf::path datasetDir(args.datasetDir);
+  const std::string calibrationFilename = (datasetDir / "calib.txt").string();
+  for(size_t i = 0, size = args.sequences.size(); i < size; ++i)
+  {
+    const std::string& sequence = args.sequences[i];
+    std::cout << "Loading sequence: " << sequence << '\n';
+
+    const bf::path trainingDir = datasetDir / sequence / "train", validationDir = datasetDir / sequence / "validation";
+    data.sequenceNames.push_back(sequence);
+    data.trainingSequences.push_back(RelocalisationSequence_CPtr(new RelocalisationSequence(
+      calibrationFilename, (trainingDir / "frame-%06d.color.png").string(), (trainingDir / "frame-%06d.depth.png").string(),
+      (trainingDir / "frame-%06d.pose.txt").string(), args.frameStep
+    )));
+    data.validationSequences.push_back(RelocalisationSequence_CPtr(new RelocalisationSequence(
+      calibrationFilename, (validationDir / "frame-%06d.color.png").string(), (validationDir / "frame-%06d.depth.png").string(),
+      (validationDir / "frame-%06d.pose.txt").string(), args.frameStep
+    )));
+  }
+
+  return data;
+}
+
 bool parse_command_line(int argc, char *argv[], Arguments& args)
 {
+  // Note: We skip heads because there aren't enough subsequences to split the training set into train + validation.
+  const std::vector<std::string> defaultSequences = list_of<std::string>("chess")("fire")("office")("pumpkin")("redkitchen")("stairs");
+
   // Specify the possible options.
   po::options_description options;
   options.add_options()
     ("help", "produce help message")
+    ("cpu", po::bool_switch(&args.cpu), "run the in-process evaluations on the CPU")
     ("datasetDir,d", po::value<std::string>(&args.datasetDir)->default_value(""), "the dataset directory")
+    ("forest", po::value<std::string>(&args.forestFilename)->default_value(""), "the forest filename (for in-process evaluation)")
+    ("frameStep", po::value<size_t>(&args.frameStep)->default_value(1), "the step between the frames to use from each sequence (for in-process evaluation)")
+    ("inProcess", po::bool_switch(&args.inProcess), "evaluate the parameter sets in-process rather than by running a script")
     ("logSpecifier,l", po::value<std::string>(&args.logSpecifier)->default_value("relocopt.log"), "the log specifier")
+    ("noTimeBudget", po::bool_switch(&args.noTimeBudget), "don't penalise parameter sets that exceed the time budget, so that they can be evaluated concurrently (for in-process evaluation)")
+    ("resume", po::bool_switch(&args.resume), "reuse the costs of any parameter sets already in the log, rather than starting a fresh log")
     ("scriptSpecifier,s", po::value<std::string>(&args.scriptSpecifier)->default_value(""), "the script specifier")
+    ("sequences", po::value<std::vector<std::string> >(&args.sequences)->multitoken()->default_value(defaultSequences, "chess fire office pumpkin redkitchen stairs"), "the sequences to use (for in-process evaluation)")
+    ("threads", po::value<size_t>(&args.threadCount)->default_value(4), "the maximum number of parameter sets to evaluate concurrently (for in-process evaluation)")
   ;
 
   // Actually parse the command line.
@@ -164,16 +371,42 @@ bool parse_command_line(int argc, char *argv[], Arguments& args)
   // Prepare the log path.
   args.logPath = args.dir / args.logSpecifier;
 
-  // Attempt to find the specified script file.
+  if(args.inProcess)
+  {
+    // Check that the forest exists.
+    if(!bf::exists(bf::path(args.forestFilename)))
+    {
+      throw std::runtime_error("The forest file was not specified or does not exist");
+    }
+
+    // The time budget penalty is based on the training and relocalisation times of each parameter set, which are only meaningful
+    // if they were measured without any other evaluations competing for the device, so in that case only one can be run at once.
+    if(!args.noTimeBudget && args.threadCount > 1)
+    {
+      std::cerr << "Warning: Parameter sets can only be evaluated concurrently when the time budget is disabled (see --noTimeBudget); evaluating them one at a time\n";
+      args.threadCount = 1;
+    }
+  }
+  else
+  {
+    // Attempt to find the specified script file.
 #if _MSC_VER
-  args.scriptPath = args.dir / (args.scriptSpecifier + ".bat");
+    args.scriptPath = args.dir / (args.scriptSpecifier + ".bat");
 #else
-  args.scriptPath = args.dir / (args.scriptSpecifier + ".sh");
+    args.scriptPath = args.dir / (args.scriptSpecifier + ".sh");
 #endif
 
-  if(!bf::exists(args.scriptPath))
-  {
-    throw std::runtime_error("The script file was not specified or does not exist");
+    if(!bf::exists(args.scriptPath))
+    {
+      throw std::runtime_error("The script file was not specified or does not exist");
+    }
+
+    // The script uses fixed filenames for its intermediate files, so only one instance of it can be run at once.
+    if(args.threadCount > 1)
+    {
+      std::cerr << "Warning: Parameter sets can only be evaluated concurrently in-process; evaluating them one at a time\n";
+      args.threadCount = 1;
+    }
   }
 
   // Attempt to find the dataset directory.
@@ -195,35 +428,58 @@ try
     return EXIT_FAILURE;
   }
 
-  // Set up the log file.
+  // Set up the log file. If we're resuming a search, the costs of any parameter sets already in the log will be reused.
+  if(!args.resume) bf::remove(args.logPath);
+
+  std::vector<std::string> extraColumnNames;
+  ParamSet logContext;
+  LoggingCostFunction costFn;
+  InProcessData inProcessData;
+  if(args.inProcess)
+  {
+    // Note: The costs (and timings) of the parameter sets depend on how many of them are evaluated at once and on whether the time budget
+    //       is enforced, so we record these settings in the log to avoid reusing costs that were computed under different settings.
+    extraColumnNames = list_of<std::string>("TotalTime")("RelocAvg")("TrainingTime")("RelocalisationTime");
+    logContext["relocopt.threadCount"] = boost::lexical_cast<std::string>(args.threadCount);
+    logContext["relocopt.timeBudget"] = args.noTimeBudget ? "false" : "true";
+    inProcessData = load_in_process_data(args);
+    costFn = boost::bind(grove_in_process_cost_fn, boost::cref(inProcessData), _1, _2);
+  }
+  else
   {
-    std::ofstream(args.logPath.c_str(), std::ios::trunc);
+    extraColumnNames = list_of<std::string>("TotalTime")("RelocAvg")("ICPAvg")("TrainingTime")("UpdateTime")("InitialRelocalisationTime")("ICPRefinementTime")("TotalRelocalisationTime");
+    costFn = boost::bind(grove_script_cost_fn, boost::cref(args), _1, _2);
   }
 
+  ParamSetCostLog log(args.logPath.string(), extraColumnNames, logContext);
+  if(log.get_entry_count() > 0) std::cout << "Resuming search with " << log.get_entry_count() << " logged parameter sets\n";
+
   // Set up the optimiser.
   const unsigned seed = 12345;
 #ifdef USE_RANDOM
   const size_t epochCount = 100;
-  RandomParameterOptimiser optimiser(boost::bind(grove_cost_fn, args, _1), epochCount, seed);
+  RandomParameterOptimiser optimiser(boost::bind(cached_cost_fn, boost::ref(log), costFn, _1), epochCount, seed);
 #else
   const size_t epochCount = 5;
-  CoordinateDescentParameterOptimiser optimiser(boost::bind(grove_cost_fn, args, _1), epochCount, seed);
+  CoordinateDescentParameterOptimiser optimiser(boost::bind(cached_cost_fn, boost::ref(log), costFn, _1), epochCount, seed);
 #endif
 
+  optimiser.set_evaluation_thread_count(args.threadCount);
+
 //  // Scene parameters.
 //  optimiser.add_param("SceneParams.mu", list_of<float>(2.0f)(4.0f)(6.0f)(8.0f)(10.0f)); // It's a multiplicative coefficient applied to the voxelSize, requires a change in the main spaintgui app at the moment.
 //  optimiser.add_param("SceneParams.voxelSize", list_of<float>(0.005f)(0.010f)(0.015f)(0.020f)(0.025f)(0.030f)(0.040f)(0.050f));
 //  optimiser.add_param("SceneParams.viewFrustum_max", list_of<float>(2.0f)(3.0f)(4.0f)(5.0f)(7.5f)(10.0f)(15.0f));
 
-  // Preemptive Ransac parameters.
-  optimiser.add_param("PreemptiveRansac.maxCandidateGenerationIterations", list_of<int>(50)(250)(500)(1000)(6000));
-  optimiser.add_param("PreemptiveRansac.maxPoseCandidates", list_of<int>(256)(512)(768)(1024)(2048));
-  optimiser.add_param("PreemptiveRansac.maxPoseCandidatesAfterCull", list_of<int>(32)(64)(128)(256));
-  optimiser.add_param("PreemptiveRansac.maxTranslationErrorForCorrectPose", list_of<float>(0.05f)(0.1f)(1000.0f)); // Last value basically disables the check.
-  optimiser.add_param("PreemptiveRansac.minSquaredDistanceBetweenSampledModes", list_of<float>(0.0f)(0.15f * 0.15f)(0.3f * 0.3f)(0.6f * 0.6f)); // First value disables the check.
-  optimiser.add_param("PreemptiveRansac.poseUpdate", list_of<bool>(false)(true));
-  optimiser.add_param("PreemptiveRansac.ransacInliersPerIteration", list_of<int>(256)(512)(1024));
-  optimiser.add_param("PreemptiveRansac.usePredictionCovarianceForPoseOptimization", list_of<bool>(false)(true));
+  // Preemptive Ransac parameters (these are read from the relocaliser's namespace).
+  optimiser.add_param("ScoreRelocaliser.PreemptiveRansac.maxCandidateGenerationIterations", list_of<int>(50)(250)(500)(1000)(6000));
+  optimiser.add_param("ScoreRelocaliser.PreemptiveRansac.maxPoseCandidates", list_of<int>(256)(512)(768)(1024)(2048));
+  optimiser.add_param("ScoreRelocaliser.PreemptiveRansac.maxPoseCandidatesAfterCull", list_of<int>(32)(64)(128)(256));
+  optimiser.add_param("ScoreRelocaliser.PreemptiveRansac.maxTranslationErrorForCorrectPose", list_of<float>(0.05f)(0.1f)(1000.0f)); // Last value basically disables the check.
+  optimiser.add_param("ScoreRelocaliser.PreemptiveRansac.minSquaredDistanceBetweenSampledModes", list_of<float>(0.0f)(0.15f * 0.15f)(0.3f * 0.3f)(0.6f * 0.6f)); // First value disables the check.
+  optimiser.add_param("ScoreRelocaliser.PreemptiveRansac.poseUpdate", list_of<bool>(false)(true));
+  optimiser.add_param("ScoreRelocaliser.PreemptiveRansac.ransacInliersPerIteration", list_of<int>(256)(512)(1024));
+  optimiser.add_param("ScoreRelocaliser.PreemptiveRansac.usePredictionCovarianceForPoseOptimization", list_of<bool>(false)(true));
 
   // Relocaliser parameters.
 //  optimiser.add_param("ScoreRelocaliser.maxRelocalisationsToOutput", list_of<int>(1)(2)(4)(8)(16));
@@ -238,12 +494,6 @@ try
 //  optimiser.add_param("DecisionForest.depthFeatureRatio", list_of<float>(0.0f)(0.2f)(0.4f)(0.5f)(0.6f)(0.8f)(1.1f));
 //  optimiser.add_param("DecisionForest.useFixedThresholds", list_of<bool>(false)(true));
 
-  // Print header in the log file.
-  {
-    std::ofstream logStream(args.logPath.c_str());
-    logStream << "Cost;TotalTime;RelocAvg;ICPAvg;TrainingTime;UpdateTime;InitialRelocalisationTime;ICPRefinementTime;TotalRelocalisationTime;Params\n";
-  }
-
   // Use the optimiser to choose a set of parameters.
   float cost;
   ParamSet params = optimiser.optimise_for_parameters(&cost);
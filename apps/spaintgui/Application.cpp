@@ -20,7 +20,6 @@ using boost::assign::map_list_of;
 using namespace ITMLib;
 
 #include <itmx/persistence/ImagePersister.h>
-#include <itmx/persistence/PosePersister.h>
 #include <itmx/util/CameraPoseConverter.h>
 using namespace itmx;
 
@@ -36,6 +35,7 @@ using namespace spaint;
 #include <tvgutil/commands/NoOpCommand.h>
 #include <tvgutil/filesystem/PathFinder.h>
 #include <tvgutil/timing/TimeUtil.h>
+#include <tvgutil/timing/Tracer.h>
 using namespace tvgutil;
 
 #include "renderers/HeadlessRenderer.h"
@@ -66,6 +66,10 @@ Application::Application(const MultiScenePipeline_Ptr& pipeline, bool renderFidu
   Model_CPtr model = m_pipeline->get_model();
   const Settings_CPtr& settings = model->get_settings();
 
+  // Register any settings that need to be checked every frame.
+  m_renderClientImages = settings->register_setting<bool>("Application.renderClientImages", true);
+  m_saveSequenceAsContainer = settings->register_setting<bool>("Application.saveSequenceAsContainer", false);
+
   if(settings->get_first_value<bool>("headless"))
   {
     m_renderer.reset(new HeadlessRenderer(model));
@@ -83,6 +87,8 @@ bool Application::run()
 {
   for(;;)
   {
+    TRACE_SCOPE("Frame");
+
     // Check to see if the user wants to quit the application, and quit if necessary. Note that if we
     // are running in batch mode, we quit directly, rather than saving a mesh of the scene on exit.
     bool eventQuit = !process_events();
@@ -99,6 +105,8 @@ bool Application::run()
     // If the application is unpaused, process a new frame.
     if(!m_paused)
     {
+      TRACE_SCOPE("Pipeline: Main Section");
+
       // Run the main section of the pipeline.
       const std::set<std::string> scenesProcessed = m_pipeline->run_main_section();
 
@@ -118,17 +126,24 @@ bool Application::run()
     }
 
     // Render the scene.
-    m_renderer->render(m_fracWindowPos, m_renderFiducials);
+    {
+      TRACE_SCOPE("Rendering");
+      m_renderer->render(m_fracWindowPos, m_renderFiducials);
+    }
 
     // If we're running a mapping server and we want to render any scene images requested by remote clients, do so.
     const Model_CPtr model = m_pipeline->get_model();
-    if(model->get_mapping_server() && model->get_settings()->get_first_value<bool>("Application.renderClientImages", true))
+    if(model->get_mapping_server() && m_renderClientImages->get())
     {
       m_renderer->render_client_images();
     }
 
     // If the application is unpaused, run the mode-specific section of the pipeline for the active scene.
-    if(!m_paused) m_pipeline->run_mode_specific_section(get_active_scene_id(), get_monocular_render_state());
+    if(!m_paused)
+    {
+      TRACE_SCOPE("Pipeline: Mode-Specific Section");
+      m_pipeline->run_mode_specific_section(get_active_scene_id(), get_monocular_render_state());
+    }
 
     // If we're currently recording a video, save the next frame of it to disk.
     if(m_videoPathGenerator) save_video_frame();
@@ -298,7 +313,25 @@ void Application::handle_key_down(const SDL_Keysym& keysym)
   // If right shift + / is pressed, toggle video recording.
   if(keysym.sym == SDLK_SLASH)
   {
-    if(m_inputState.key_down(KEYCODE_LSHIFT)) toggle_recording("sequence", m_sequencePathGenerator);
+    if(m_inputState.key_down(KEYCODE_LSHIFT))
+    {
+      toggle_recording("sequence", m_sequencePathGenerator);
+
+      // If we just stopped recording a sequence, wait for any outstanding frames to be saved.
+      if(!m_sequencePathGenerator && m_sequenceRecorder)
+      {
+        m_sequenceRecorder->flush();
+        std::cout << "[spaint] Dropped " << m_sequenceRecorder->get_dropped_frame_count() << " sequence frame(s) whilst recording.\n";
+        m_sequenceRecorder.reset();
+      }
+
+      // Similarly, if we were recording to a chunked sequence file, finish writing it.
+      if(!m_sequencePathGenerator && m_sequenceWriter)
+      {
+        std::cout << "[spaint] Saved " << m_sequenceWriter->get_frame_count() << " sequence frame(s).\n";
+        m_sequenceWriter.reset();
+      }
+    }
     else if(m_inputState.key_down(KEYCODE_RSHIFT)) toggle_recording("video", m_videoPathGenerator);
     else save_screenshot();
   }
@@ -1055,20 +1088,47 @@ void Application::save_sequence_frame()
   const std::string& sceneID = mainSubwindow.get_scene_id();
 
   // If the RGBD calibration hasn't already been saved, save it now.
-  SLAMState_CPtr slamState = m_pipeline->get_model()->get_slam_state(sceneID);
+  const SLAMState_Ptr& slamState = m_pipeline->get_model()->get_slam_state(sceneID);
+
+  // If we're saving the sequence to a single chunked sequence file, write the frame to that (creating the writer if necessary).
+  // The calibration is stored in the file, and the writer compresses the frames on a separate thread.
+  if(m_sequenceWriter || m_saveSequenceAsContainer->get())
+  {
+    ORUChar4Image_CPtr rgbImage = slamState->get_input_rgb_image();
+    ORShortImage_CPtr depthImage = slamState->get_input_raw_depth_image();
+
+    if(!m_sequenceWriter)
+    {
+      const boost::filesystem::path sequenceFile = m_sequencePathGenerator->get_base_dir() / "sequence.rgbds";
+      m_sequenceWriter.reset(new RGBDSequenceWriter(sequenceFile.string(), slamState->get_view()->calib, rgbImage->noDims, depthImage->noDims));
+    }
+
+    // Save the current input images, together with the inverse pose (i.e. the camera -> world transformation).
+    m_sequenceWriter->write_frame(rgbImage, depthImage, slamState->get_pose().GetInvM());
+    m_sequencePathGenerator->increment_index();
+    return;
+  }
+
   boost::filesystem::path calibrationFile = m_sequencePathGenerator->get_base_dir() / "calib.txt";
   if(!boost::filesystem::exists(calibrationFile))
   {
     writeRGBDCalib(calibrationFile.string().c_str(), slamState->get_view()->calib);
   }
 
+  // Get a frame buffer from the sequence recorder (creating the recorder if necessary). If the recorder can't keep up and has
+  // had to drop the frame, early out (without advancing the frame index, so that the saved sequence has no gaps in it).
+  if(!m_sequenceRecorder) m_sequenceRecorder = SequenceRecorder::make_from_settings(m_pipeline->get_model()->get_settings());
+  SequenceRecorder::Frame_Ptr frame = m_sequenceRecorder->begin_frame();
+  if(!frame) return;
+
   // Save the current input images.
-  ImagePersister::save_image_on_thread(slamState->get_input_raw_depth_image_copy(), m_sequencePathGenerator->make_path("frame-%06i.depth.png"));
-  ImagePersister::save_image_on_thread(slamState->get_input_rgb_image_copy(), m_sequencePathGenerator->make_path("frame-%06i.color.png"));
+  frame->add_image(slamState->get_input_raw_depth_image(), m_sequencePathGenerator->make_path("frame-%06i.depth.png"));
+  frame->add_image(slamState->get_input_rgb_image(), m_sequencePathGenerator->make_path("frame-%06i.color.png"));
 
   // Save the inverse pose (i.e. the camera -> world transformation).
-  PosePersister::save_pose_on_thread(slamState->get_pose().GetInvM(), m_sequencePathGenerator->make_path("frame-%06i.pose.txt"));
+  frame->add_pose(slamState->get_pose().GetInvM(), m_sequencePathGenerator->make_path("frame-%06i.pose.txt"));
 
+  m_sequenceRecorder->submit_frame(frame);
   m_sequencePathGenerator->increment_index();
 }
 
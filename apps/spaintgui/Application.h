@@ -16,10 +16,14 @@
 
 #include <ITMLib/Engines/Meshing/Interface/ITMMeshingEngine.h>
 
+#include <itmx/persistence/RGBDSequenceWriter.h>
+#include <itmx/persistence/SequenceRecorder.h>
+
 #include <tvginput/InputState.h>
 
 #include <tvgutil/commands/CommandManager.h>
 #include <tvgutil/filesystem/SequentialPathGenerator.h>
+#include <tvgutil/misc/TypedSetting.h>
 
 #include "core/MultiScenePipeline.h"
 #include "renderers/Renderer.h"
@@ -78,6 +82,9 @@ private:
   /** The multi-scene pipeline that the application should use. */
   MultiScenePipeline_Ptr m_pipeline;
 
+  /** Whether or not to render any scene images requested by remote clients (if we're running a mapping server). */
+  boost::shared_ptr<tvgutil::TypedSetting<bool> > m_renderClientImages;
+
   /** The current renderer. */
   Renderer_Ptr m_renderer;
 
@@ -90,9 +97,18 @@ private:
   /** Whether or not to save models of the scenes on exiting the application. */
   bool m_saveModelsOnExit;
 
+  /** Whether or not to save recorded sequences to a single chunked sequence file (rather than to individual image files). */
+  boost::shared_ptr<tvgutil::TypedSetting<bool> > m_saveSequenceAsContainer;
+
   /** The path generator for the current sequence recording (if any). */
   boost::optional<tvgutil::SequentialPathGenerator> m_sequencePathGenerator;
 
+  /** The recorder used to save the frames of the current sequence recording (if any). */
+  itmx::SequenceRecorder_Ptr m_sequenceRecorder;
+
+  /** The writer used to save the frames of the current sequence recording to a single chunked sequence file (if we're doing so). */
+  itmx::RGBDSequenceWriter_Ptr m_sequenceWriter;
+
   /** A set of sub-window configurations that the user can switch between as desired. */
   mutable std::vector<SubwindowConfiguration_Ptr> m_subwindowConfigurations;
 
@@ -16,7 +16,7 @@ MarkVoxelsCommand::MarkVoxelsCommand(const std::string& sceneID, const boost::sh
 : Command(get_static_description()),
   m_label(label),
   m_model(model),
-  m_oldVoxelLabelsMB(MemoryBlockFactory::instance().make_block<SpaintVoxel::PackedLabel>(voxelLocationsMB->dataSize)),
+  m_oldVoxelLabelsMB(MemoryBlockFactory::instance().make_block<SpaintVoxel::PackedLabel>(voxelLocationsMB->dataSize, "Commands")),
   m_sceneID(sceneID),
   m_voxelLocationsMB(voxelLocationsMB)
 {}
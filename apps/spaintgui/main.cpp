@@ -3,6 +3,7 @@
  * Copyright (c) Torr Vision Group, University of Oxford, 2015. All rights reserved.
  */
 
+#include <algorithm>
 #include <cstdlib>
 #include <iostream>
 #include <string>
@@ -46,6 +47,7 @@
 
 #include <itmx/imagesources/AsyncImageSourceEngine.h>
 #include <itmx/imagesources/RemoteImageSourceEngine.h>
+#include <itmx/imagesources/RGBDSequenceImageSourceEngine.h>
 #ifdef WITH_ZED
 #include <itmx/imagesources/ZedImageSourceEngine.h>
 #endif
@@ -54,6 +56,7 @@
 #include <orx/geometry/GeometryUtil.h>
 
 #include <tvgutil/filesystem/PathFinder.h>
+#include <tvgutil/timing/Tracer.h>
 
 #include "core/CollaborativePipeline.h"
 #include "core/ObjectivePipeline.h"
@@ -101,6 +104,7 @@ struct CommandLineArguments
   std::string port;
   std::vector<std::string> poseFileMasks;
   size_t prefetchBufferCapacity;
+  size_t prefetchThreadCount;
   bool profileMemory;
   std::string relocaliserType;
   bool renderFiducials;
@@ -111,6 +115,8 @@ struct CommandLineArguments
   std::vector<std::string> sequenceSpecifiers;
   std::vector<std::string> sequenceTypes;
   std::string subwindowConfigurationIndex;
+  std::string traceFile;
+  bool traceSyncGPU;
   std::vector<std::string> trackerSpecifiers;
   bool trackObject;
   bool trackSurfels;
@@ -153,6 +159,7 @@ struct CommandLineArguments
       ADD_SETTING(port);
       ADD_SETTINGS(poseFileMasks);
       ADD_SETTING(prefetchBufferCapacity);
+      ADD_SETTING(prefetchThreadCount);
       ADD_SETTING(profileMemory);
       ADD_SETTING(relocaliserType);
       ADD_SETTING(renderFiducials);
@@ -163,6 +170,8 @@ struct CommandLineArguments
       ADD_SETTINGS(sequenceSpecifiers);
       ADD_SETTINGS(sequenceTypes);
       ADD_SETTING(subwindowConfigurationIndex);
+      ADD_SETTING(traceFile);
+      ADD_SETTING(traceSyncGPU);
       ADD_SETTINGS(trackerSpecifiers);
       ADD_SETTING(trackObject);
       ADD_SETTING(trackSurfels);
@@ -348,6 +357,67 @@ ImageSourceEngine *make_camera_subengine(const CommandLineArguments& args)
   return cameraSubengine;
 }
 
+/**
+ * \brief Makes a subengine that reads the images of a disk sequence asynchronously.
+ *
+ * If more than one prefetch thread has been requested, the frames of the sequence are split between several
+ * image file readers (the i'th of n readers reads frames i, i+n, i+2n, ...), so that they can be decoded in parallel.
+ * If the sequence is stored in a single chunked sequence file (in which case the depth image mask is the path to
+ * that file), the file is read directly, and the prefetch threads are used to decode its chunks in parallel.
+ *
+ * \param calibrationFilename The name of the file containing the calibration parameters for the sequence.
+ * \param rgbImageMask        The mask for the RGB images in the sequence.
+ * \param depthImageMask      The mask for the depth images in the sequence.
+ * \param args                The program's command-line arguments.
+ * \return                    The subengine.
+ */
+ImageSourceEngine *make_disk_sequence_subengine(const std::string& calibrationFilename, const std::string& rgbImageMask,
+                                                const std::string& depthImageMask, const CommandLineArguments& args)
+{
+  // If the sequence is stored in a chunked sequence file, read it directly (the engine does its own prefetching, and uses the calibration stored in the file).
+  if(bf::path(depthImageMask).extension() == ".rgbds")
+  {
+    const size_t prefetchChunkCount = 2;
+    RGBDSequenceImageSourceEngine *engine = new RGBDSequenceImageSourceEngine(depthImageMask, prefetchChunkCount, std::max<size_t>(args.prefetchThreadCount, 1));
+    engine->seek(std::min(static_cast<size_t>(args.initialFrameNumber), engine->get_frame_count()));
+    return engine;
+  }
+
+  ImageMaskPathGenerator pathGenerator(rgbImageMask.c_str(), depthImageMask.c_str());
+
+  // If only a single prefetch thread has been requested, read the sequence using a single image file reader.
+  if(args.prefetchThreadCount <= 1)
+  {
+    return new AsyncImageSourceEngine(
+      new ImageFileReader<ImageMaskPathGenerator>(calibrationFilename.c_str(), pathGenerator, args.initialFrameNumber),
+      args.prefetchBufferCapacity
+    );
+  }
+
+  // Otherwise, enumerate the frames of the sequence and deal their paths out to the readers in round-robin order.
+  const size_t initialFrameNumber = static_cast<size_t>(args.initialFrameNumber);
+  const size_t readerCount = args.prefetchThreadCount;
+  std::vector<std::vector<std::string> > rgbImagePaths(readerCount), depthImagePaths(readerCount);
+  for(size_t frameNumber = initialFrameNumber;; ++frameNumber)
+  {
+    const std::string depthImagePath = pathGenerator.getDepthImagePath(frameNumber);
+    if(!bf::exists(depthImagePath)) break;
+
+    const size_t readerIndex = (frameNumber - initialFrameNumber) % readerCount;
+    depthImagePaths[readerIndex].push_back(depthImagePath);
+    rgbImagePaths[readerIndex].push_back(pathGenerator.getRgbImagePath(frameNumber));
+  }
+
+  std::vector<ImageSourceEngine*> readers;
+  for(size_t i = 0; i < readerCount; ++i)
+  {
+    ImageListPathGenerator readerPathGenerator(rgbImagePaths[i], depthImagePaths[i]);
+    readers.push_back(new ImageFileReader<ImageListPathGenerator>(calibrationFilename.c_str(), readerPathGenerator));
+  }
+
+  return new AsyncImageSourceEngine(readers, args.prefetchBufferCapacity);
+}
+
 /**
  * \brief Makes the overall tracker configuration based on any tracker specifiers that were passed in on the command line.
  *
@@ -402,6 +472,12 @@ std::string make_tracker_config(CommandLineArguments& args)
           throw std::runtime_error("Error: Not enough pose file masks have been specified with the -p flag.");
         }
 
+        if(args.poseFileMasks[i].empty())
+        {
+          // If this happens, it's because the sequence is stored in a chunked sequence file, whose poses the file-based tracker can't read.
+          throw std::runtime_error("Error: The Disk tracker cannot be used with a sequence stored in a single .rgbds file.");
+        }
+
         // If we're using global poses for the scenes:
         if(!globalPoses.empty())
         {
@@ -505,11 +581,23 @@ bool postprocess_arguments(CommandLineArguments& args, const po::options_descrip
 
     // Determine the directory containing the sequence and record it for later use.
     const std::string& sequenceSpecifier = args.sequenceSpecifiers[i];
-    const bf::path dir = bf::is_directory(sequenceSpecifier)
+    const bf::path dir = bf::is_directory(sequenceSpecifier) || bf::is_regular_file(sequenceSpecifier)
       ? sequenceSpecifier
       : find_subdir_from_executable(sequenceType + "s") / sequenceSpecifier;
     args.sequenceDirs.push_back(dir);
 
+    // If the sequence is stored in a single chunked sequence file (either specified directly, or in the sequence directory),
+    // use the path to that file as the depth and RGB masks. Such files embed their own calibration and poses, so there is
+    // no pose file mask.
+    const bf::path containerPath = bf::is_regular_file(dir) ? dir : dir / "sequence.rgbds";
+    if(containerPath.extension() == ".rgbds" && bf::is_regular_file(containerPath))
+    {
+      args.depthImageMasks.push_back(containerPath.string());
+      args.poseFileMasks.push_back("");
+      args.rgbImageMasks.push_back(containerPath.string());
+      continue;
+    }
+
     // Try to figure out the format of the sequence stored in the directory (we only check the depth images, since the colour ones might be missing).
     const bool sevenScenesNaming = bf::is_regular_file(dir / "frame-000000.depth.png");
     const bool spaintNaming = bf::is_regular_file(dir / "depthm000000.pgm");
@@ -639,7 +727,7 @@ bool parse_command_line(int argc, char *argv[], CommandLineArguments& args, cons
     ("fiducialDetectorType", po::value<std::string>(&args.fiducialDetectorType)->default_value("aruco"), "fiducial detector type (aruco|vicon)")
     ("globalPosesSpecifier,g", po::value<std::string>(&args.globalPosesSpecifier)->default_value(""), "global poses specifier")
     ("headless", po::bool_switch(&args.headless), "run in headless mode")
-    ("host,h", po::value<std::string>(&args.host)->default_value(""), "remote mapping host")
+    ("host,h", po::value<std::string>(&args.host)->default_value(""), "remote mapping host (use shm://name to send frames via shared memory to a server on the same machine)")
     ("leapFiducialID", po::value<std::string>(&args.leapFiducialID)->default_value(""), "the ID of the fiducial to use for the Leap Motion")
     ("mapSurfels", po::bool_switch(&args.mapSurfels), "enable surfel mapping")
     ("modelSpecifier,m", po::value<std::string>(&args.modelSpecifier)->default_value(""), "model specifier")
@@ -653,6 +741,8 @@ bool parse_command_line(int argc, char *argv[], CommandLineArguments& args, cons
     ("saveMeshOnExit", po::bool_switch(&args.saveMeshOnExit), "save a mesh of the scene on exiting the application")
     ("saveModelsOnExit", po::bool_switch(&args.saveModelsOnExit), "save a model of each voxel scene on exiting the application")
     ("subwindowConfigurationIndex", po::value<std::string>(&args.subwindowConfigurationIndex)->default_value("1"), "subwindow configuration index")
+    ("traceFile", po::value<std::string>(&args.traceFile)->default_value(""), "file to which to write a Chrome trace of the pipeline stages (requires WITH_TRACING)")
+    ("traceSyncGPU", po::bool_switch(&args.traceSyncGPU), "synchronise the GPU at the boundaries of traced scopes (more accurate, but slower)")
     ("trackerSpecifier,t", po::value<std::vector<std::string> >(&args.trackerSpecifiers)->multitoken(), "tracker specifier")
     ("trackSurfels", po::bool_switch(&args.trackSurfels), "enable surfel mapping and tracking")
     ("useVicon", po::bool_switch(&args.useVicon)->default_value(false), "whether or not to use the Vicon system")
@@ -671,6 +761,7 @@ bool parse_command_line(int argc, char *argv[], CommandLineArguments& args, cons
     ("initialFrame,n", po::value<int>(&args.initialFrameNumber)->default_value(0), "initial frame number")
     ("poseMask,p", po::value<std::vector<std::string> >(&args.poseFileMasks)->multitoken(), "pose file mask")
     ("prefetchBufferCapacity,b", po::value<size_t>(&args.prefetchBufferCapacity)->default_value(60), "capacity of the prefetch buffer")
+    ("prefetchThreads", po::value<size_t>(&args.prefetchThreadCount)->default_value(1), "number of threads on which to decode the images of each disk sequence")
     ("rgbMask,r", po::value<std::vector<std::string> >(&args.rgbImageMasks)->multitoken(), "RGB image mask")
     ("sequenceSpecifier,s", po::value<std::vector<std::string> >(&args.sequenceSpecifiers)->multitoken(), "sequence specifier")
     ("sequenceType", po::value<std::vector<std::string> >(&args.sequenceTypes)->multitoken(), "sequence type")
@@ -795,15 +886,22 @@ try
   // Set the failure behaviour of the relocaliser.
   if(args.cameraAfterDisk || !args.noRelocaliser) settings->behaviourOnFailure = ITMLibSettings::FAILUREMODE_RELOCALISE;
 
-  // Pass the device type to the memory block factory.
+  // If requested, warn about settings that are looked up by string often enough to suggest that they are being
+  // looked up every frame (such settings should be registered as typed settings instead).
+  settings->set_lookup_warning_threshold(settings->get_first_value<size_t>("Settings.lookupWarningThreshold", 0));
+
+  // Pass the device type to the memory block factory, and set how much memory it can use to pool released blocks for reuse.
   MemoryBlockFactory::instance().set_device_type(settings->deviceType);
+  MemoryBlockFactory::instance().set_pool_capacity(settings->get_first_value<size_t>("MemoryBlockFactory.poolCapacityMB", 64) * 1024 * 1024);
 
   // Run a remote mapping server if requested.
   MappingServer_Ptr mappingServer;
   if(args.runServer)
   {
     const MappingServer::Mode mode = args.pipelineType == "collaborative" ? MappingServer::SM_MULTI_CLIENT : MappingServer::SM_SINGLE_CLIENT;
-    mappingServer.reset(new MappingServer(mode));
+    const int port = 7851;
+    const size_t ioThreadCount = settings->get_first_value<size_t>("MappingServer.ioThreadCount", 0);
+    mappingServer.reset(new MappingServer(mode, port, ioThreadCount));
     mappingServer->start();
   }
 
@@ -828,11 +926,7 @@ try
       const std::string& rgbImageMask = args.rgbImageMasks[i];
 
       std::cout << "[spaint] Reading images from disk: " << rgbImageMask << ' ' << depthImageMask << '\n';
-      ImageMaskPathGenerator pathGenerator(rgbImageMask.c_str(), depthImageMask.c_str());
-      imageSourceEngine->addSubengine(new AsyncImageSourceEngine(
-        new ImageFileReader<ImageMaskPathGenerator>(args.calibrationFilename.c_str(), pathGenerator, args.initialFrameNumber),
-        args.prefetchBufferCapacity
-      ));
+      imageSourceEngine->addSubengine(make_disk_sequence_subengine(args.calibrationFilename, rgbImageMask, depthImageMask, args));
     }
 
     // If no model and no disk sequences were specified, or we want to switch to the camera once all the disk sequences finish, add a camera subengine.
@@ -917,12 +1011,8 @@ try
       const std::string calibrationFilename = bf::exists(calibrationPath) ? calibrationPath.string() : args.calibrationFilename;
 
       std::cout << "[spaint] Adding local agent for disk sequence: " << rgbImageMask << ' ' << depthImageMask << '\n';
-      ImageMaskPathGenerator pathGenerator(rgbImageMask.c_str(), depthImageMask.c_str());
       CompositeImageSourceEngine_Ptr imageSourceEngine(new CompositeImageSourceEngine);
-      imageSourceEngine->addSubengine(new AsyncImageSourceEngine(
-        new ImageFileReader<ImageMaskPathGenerator>(calibrationFilename.c_str(), pathGenerator, args.initialFrameNumber),
-        args.prefetchBufferCapacity
-      ));
+      imageSourceEngine->addSubengine(make_disk_sequence_subengine(calibrationFilename, rgbImageMask, depthImageMask, args));
 
       imageSourceEngines.push_back(imageSourceEngine);
     }
@@ -933,6 +1023,11 @@ try
     {
       mappingModes.push_back(args.mapSurfels ? SLAMComponent::MAP_BOTH : SLAMComponent::MAP_VOXELS_ONLY);
       trackingModes.push_back(args.trackSurfels ? SLAMComponent::TRACK_SURFELS : SLAMComponent::TRACK_VOXELS);
+      if(args.poseFileMasks[i].empty())
+      {
+        throw std::runtime_error("Error: Sequences stored in .rgbds files cannot currently be used with the collaborative pipeline, since it reads the poses from disk.");
+      }
+
       trackerConfigs.push_back("<tracker type='infinitam'><params>type=file,mask=" + args.poseFileMasks[i] + "</params></tracker>");
     }
 
@@ -956,7 +1051,13 @@ try
   {
     std::cout << "Setting mapping client for host '" << args.host << "' and port '" << args.port << "'\n";
     const pooled_queue::PoolEmptyStrategy poolEmptyStrategy = settings->get_first_value<pooled_queue::PoolEmptyStrategy>("MappingClient.poolEmptyStrategy", pooled_queue::PES_DISCARD);
-    pipeline->set_mapping_client(Model::get_world_scene_id(), MappingClient_Ptr(new MappingClient(args.host, args.port, poolEmptyStrategy)));
+    MappingClient_Ptr mappingClient(new MappingClient(args.host, args.port, poolEmptyStrategy));
+
+    // If a target latency was specified, let the mapping client adapt its compression settings to the state of the link.
+    const double targetLatencyMs = settings->get_first_value<double>("MappingClient.targetLatency", 0.0);
+    if(targetLatencyMs > 0.0) mappingClient->enable_adaptive_compression(targetLatencyMs);
+
+    pipeline->set_mapping_client(Model::get_world_scene_id(), mappingClient);
   }
 
 #ifdef WITH_LEAP
@@ -971,8 +1072,42 @@ try
   app.set_save_memory_usage(args.profileMemory);
   app.set_save_mesh_on_exit(args.saveMeshOnExit);
   app.set_save_models_on_exit(args.saveModelsOnExit);
+
+  // If requested, trace the pipeline stages while the application is running.
+  if(args.traceFile != "")
+  {
+#ifdef WITH_TRACING
+    Tracer::instance().set_gpu_sync(args.traceSyncGPU);
+    Tracer::instance().set_enabled(true);
+#else
+    std::cerr << "Warning: Cannot trace the pipeline stages, since spaintgui was built without WITH_TRACING\n";
+#endif
+  }
+
   bool runSucceeded = app.run();
 
+#ifdef WITH_TRACING
+  // If we were tracing the pipeline stages, write out the trace and print a summary of the timings.
+  if(Tracer::instance().is_enabled())
+  {
+    Tracer::instance().set_enabled(false);
+    Tracer::instance().write_chrome_trace(args.traceFile);
+    std::cout << "Wrote trace to " << args.traceFile << "\n\n";
+    Tracer::instance().write_summary(std::cout);
+  }
+#endif
+
+  // If we were profiling the memory usage, print a report showing how much memory is owned by each subsystem.
+  if(args.profileMemory)
+  {
+    std::cout << "\nMemory block usage:\n";
+    MemoryBlockFactory::instance().write_usage_report(std::cout);
+  }
+
+  // Free any pooled memory blocks, and stop pooling any blocks that are released from now on (the
+  // pool would otherwise only be freed during static destruction, after the CUDA runtime has shut down).
+  MemoryBlockFactory::instance().set_pool_capacity(0);
+
   // Close all open joysticks.
   joysticks.clear();
 
@@ -6,6 +6,8 @@
 #ifndef H_SPAINTGUI_HEADLESSRENDERER
 #define H_SPAINTGUI_HEADLESSRENDERER
 
+#include <tvgutil/misc/TypedSetting.h>
+
 #include "Renderer.h"
 
 /**
@@ -19,6 +21,9 @@ private:
   /** The index of the next frame that will be rendered. */
   mutable uint m_frameIdx;
 
+  /** Whether or not to print the index of each frame as it is processed. */
+  boost::shared_ptr<tvgutil::TypedSetting<bool> > m_verbose;
+
   //#################### CONSTRUCTORS ####################
 public:
   /**
@@ -0,0 +1,206 @@
+/**
+ * threadpoolperf: main.cpp
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <boost/atomic.hpp>
+#include <boost/bind.hpp>
+#include <boost/chrono.hpp>
+#include <boost/program_options.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+
+#include <tvgutil/boost/WrappedAsio.h>
+#include <tvgutil/misc/ThreadPool.h>
+using namespace tvgutil;
+
+//#################### NAMESPACE ALIASES ####################
+
+namespace po = boost::program_options;
+
+//#################### TYPEDEFS ####################
+
+typedef boost::chrono::steady_clock Clock;
+
+//#################### TYPES ####################
+
+/**
+ * \brief An instance of this class represents a thread pool that uses a single io_service queue (as ThreadPool originally did), as a baseline.
+ */
+class AsioThreadPool
+{
+  //#################### PRIVATE MEMBER VARIABLES ####################
+private:
+  /** An I/O service used to schedule work for the threads. */
+  boost::asio::io_service m_scheduler;
+
+  /** The threads in the pool. */
+  boost::thread_group m_threads;
+
+  /** A worker variable used to keep the scheduler running until we want it to stop. */
+  boost::shared_ptr<boost::asio::io_service::work> m_worker;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  explicit AsioThreadPool(size_t numThreads)
+  : m_worker(new boost::asio::io_service::work(m_scheduler))
+  {
+    for(size_t i = 0; i < numThreads; ++i)
+    {
+      m_threads.create_thread(boost::bind(&boost::asio::io_service::run, &m_scheduler));
+    }
+  }
+
+  //#################### DESTRUCTOR ####################
+public:
+  ~AsioThreadPool()
+  {
+    m_worker.reset();
+    m_threads.join_all();
+    m_scheduler.stop();
+  }
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  template <typename Task>
+  void post_task(Task task)
+  {
+    m_scheduler.post(task);
+  }
+};
+
+//#################### FUNCTIONS ####################
+
+/**
+ * \brief Performs a small amount of dummy work, and then marks a task as completed.
+ *
+ * \param workIterations  The number of iterations of dummy work to perform.
+ * \param completed       The number of tasks that have been completed.
+ */
+void run_leaf_task(size_t workIterations, boost::atomic<size_t> *completed)
+{
+  volatile size_t sink = 0;
+  for(size_t i = 0; i < workIterations; ++i) sink += i;
+  ++*completed;
+}
+
+/**
+ * \brief Posts a number of leaf tasks to a pool from within a task (to measure the cost of spawning tasks from the workers).
+ *
+ * \param pool            The pool.
+ * \param fanOut          The number of leaf tasks to post.
+ * \param workIterations  The number of iterations of dummy work to perform in each leaf task.
+ * \param completed       The number of tasks that have been completed.
+ */
+template <typename Pool>
+void run_spawning_task(Pool *pool, size_t fanOut, size_t workIterations, boost::atomic<size_t> *completed)
+{
+  for(size_t i = 0; i < fanOut; ++i) pool->post_task(boost::bind(&run_leaf_task, workIterations, completed));
+}
+
+/**
+ * \brief Times a single run of a benchmark on a pool.
+ *
+ * \param pool            The pool.
+ * \param taskCount       The total number of leaf tasks to run.
+ * \param fanOut          The number of leaf tasks spawned by each task posted from the main thread (1 means post the leaf tasks directly).
+ * \param workIterations  The number of iterations of dummy work to perform in each leaf task.
+ * \return                The throughput (in millions of leaf tasks per second).
+ */
+template <typename Pool>
+double time_run(Pool& pool, size_t taskCount, size_t fanOut, size_t workIterations)
+{
+  boost::atomic<size_t> completed(0);
+  const size_t expected = (taskCount / fanOut) * fanOut;
+
+  const Clock::time_point start = Clock::now();
+  for(size_t i = 0; i < taskCount / fanOut; ++i)
+  {
+    if(fanOut == 1) pool.post_task(boost::bind(&run_leaf_task, workIterations, &completed));
+    else pool.post_task(boost::bind(&run_spawning_task<Pool>, &pool, fanOut, workIterations, &completed));
+  }
+  while(completed < expected) boost::this_thread::yield();
+
+  return expected / boost::chrono::duration<double>(Clock::now() - start).count() / 1e6;
+}
+
+/**
+ * \brief Runs a benchmark several times on a pool and prints the median and range of the throughputs.
+ *
+ * \param name            The name of the pool implementation.
+ * \param pool            The pool.
+ * \param taskCount       The total number of leaf tasks to run.
+ * \param fanOut          The number of leaf tasks spawned by each task posted from the main thread.
+ * \param workIterations  The number of iterations of dummy work to perform in each leaf task.
+ * \param runs            The number of runs.
+ */
+template <typename Pool>
+void report_benchmark(const std::string& name, Pool& pool, size_t taskCount, size_t fanOut, size_t workIterations, size_t runs)
+{
+  std::vector<double> throughputs;
+  for(size_t i = 0; i < runs; ++i) throughputs.push_back(time_run(pool, taskCount, fanOut, workIterations));
+
+  std::sort(throughputs.begin(), throughputs.end());
+  std::cout << std::left << std::setw(14) << name << std::setw(10) << fanOut << std::right << std::fixed << std::setprecision(2)
+            << std::setw(14) << throughputs[runs / 2] << std::setw(14) << throughputs.front() << std::setw(14) << throughputs.back() << '\n';
+}
+
+int main(int argc, char *argv[])
+try
+{
+  size_t runs = 5, taskCount = 200000, threadCount = boost::thread::hardware_concurrency(), workIterations = 100;
+
+  // Parse the command-line arguments.
+  po::options_description options("Thread Pool Benchmark Options");
+  options.add_options()
+    ("help", "produce help message")
+    ("runs", po::value<size_t>(&runs)->default_value(runs), "number of runs of each benchmark")
+    ("tasks", po::value<size_t>(&taskCount)->default_value(taskCount), "number of tasks in each run")
+    ("threads", po::value<size_t>(&threadCount)->default_value(threadCount), "number of threads in each pool")
+    ("work", po::value<size_t>(&workIterations)->default_value(workIterations), "iterations of dummy work per task")
+  ;
+
+  po::variables_map vm;
+  po::store(po::parse_command_line(argc, argv, options), vm);
+  if(vm.count("help"))
+  {
+    std::cout << options << '\n';
+    return EXIT_SUCCESS;
+  }
+  po::notify(vm);
+
+  if(runs == 0 || taskCount == 0 || threadCount == 0) throw std::runtime_error("Error: The numbers of runs, tasks and threads must be non-zero");
+
+  std::cout << "Running " << taskCount << " tasks on " << threadCount << " threads (" << runs << " runs)\n\n";
+  std::cout << std::left << std::setw(14) << "Pool" << std::setw(10) << "Fan-out" << std::right
+            << std::setw(14) << "Median Mt/s" << std::setw(14) << "Min Mt/s" << std::setw(14) << "Max Mt/s" << '\n';
+
+  // Compare the pools both when all of the tasks are posted from the main thread, and when most are spawned by the workers themselves.
+  const size_t fanOuts[] = { 1, 64 };
+  for(int i = 0; i < 2; ++i)
+  {
+    {
+      AsioThreadPool pool(threadCount);
+      report_benchmark("io_service", pool, taskCount, fanOuts[i], workIterations, runs);
+    }
+
+    {
+      ThreadPool pool(threadCount);
+      report_benchmark("work-stealing", pool, taskCount, fanOuts[i], workIterations, runs);
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
+catch(std::exception& e)
+{
+  std::cerr << e.what() << '\n';
+  return EXIT_FAILURE;
+}
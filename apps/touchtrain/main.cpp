@@ -6,12 +6,14 @@
 #include <boost/assign/list_of.hpp>
 using boost::assign::list_of;
 
+#include <evaluation/core/ParallelLearnerEvaluator.h>
 #include <evaluation/core/ParamSetUtil.h>
 #include <evaluation/core/PerformanceTable.h>
 #include <evaluation/splitgenerators/CrossValidationSplitGenerator.h>
 #include <evaluation/util/CartesianProductParameterSetGenerator.h>
 using namespace evaluation;
 
+#include <rafl/core/BinaryForestFile.h>
 #include <rafl/decisionfunctions/DecisionFunctionGeneratorFactory.h>
 using namespace rafl;
 
@@ -70,10 +72,6 @@ int main(int argc, char *argv[])
     return EXIT_FAILURE;
   }
 
-#if WITH_OPENMP
-  omp_set_nested(1);
-#endif
-
   TouchTrainDataset<Label> dataset(argv[1], list_of(2)(3)(4)(5));
   std::cout << "[touchtrain] Training set root: " << dataset.get_root_directory() << '\n';
 
@@ -114,13 +112,8 @@ int main(int argc, char *argv[])
   // Evaluate the random forest on the various different parameter sets.
   std::cout << "[touchtrain] Cross-validating the performance of the forest on various parameter sets...\n";
   PerformanceTable results(list_of("Accuracy"));
-  boost::shared_ptr<RandomForestEvaluator<Label> > evaluator;
-  for(size_t n = 0, size = params.size(); n < size; ++n)
-  {
-    evaluator.reset(new RandomForestEvaluator<Label>(splitGenerator, params[n]));
-    PerformanceResult result = evaluator->evaluate(examples);
-    results.record_performance(params[n], result);
-  }
+  ParallelLearnerEvaluator<Example<Label> > evaluator(boost::bind(&RandomForestEvaluator<Label>::make_evaluator, splitGenerator, _1));
+  evaluator.evaluate(params, examples, results);
 
   // Output the performance table.
   results.output(std::cout);
@@ -154,5 +147,10 @@ int main(int argc, char *argv[])
   std::cout << "[touchtrain] Saving the forest to: " << forestPath << "\n";
   SerializationUtil::save_text(forestPath, *randomForest);
 
+  // Also output it in rafl's binary format, without its reservoirs (these files are much smaller and faster to load, and can be used for touch detection).
+  std::string binaryForestPath = forestPath + "b";
+  std::cout << "[touchtrain] Saving the forest for prediction to: " << binaryForestPath << "\n";
+  BinaryForestFile<Label>::save(*randomForest, binaryForestPath, false);
+
   return 0;
 }
@@ -0,0 +1,7 @@
+##################
+# LinkZLIB.cmake #
+##################
+
+IF(WITH_ZLIB)
+  TARGET_LINK_LIBRARIES(${targetname} ${ZLIB_LIBRARIES})
+ENDIF()
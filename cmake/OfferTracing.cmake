@@ -0,0 +1,9 @@
+######################
+# OfferTracing.cmake #
+######################
+
+OPTION(WITH_TRACING "Enable hierarchical tracing of the pipeline stages?" OFF)
+
+IF(WITH_TRACING)
+  ADD_DEFINITIONS(-DWITH_TRACING)
+ENDIF()
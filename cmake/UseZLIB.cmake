@@ -0,0 +1,11 @@
+#################
+# UseZLIB.cmake #
+#################
+
+OPTION(WITH_ZLIB "Build with zlib support (for faster PNG compression and decompression)?" OFF)
+
+IF(WITH_ZLIB)
+  FIND_PACKAGE(ZLIB REQUIRED)
+  INCLUDE_DIRECTORIES(${ZLIB_INCLUDE_DIRS})
+  ADD_DEFINITIONS(-DWITH_ZLIB)
+ENDIF()
@@ -6,13 +6,25 @@
 #ifndef H_EVALUATION_LEARNEREVALUATOR
 #define H_EVALUATION_LEARNEREVALUATOR
 
+#include <boost/bind.hpp>
+
+#include <tvgutil/misc/TaskGroup.h>
+
 #include "../splitgenerators/SplitGenerator.h"
 
 namespace evaluation {
 
+//#################### FORWARD DECLARATIONS ####################
+
+template <typename Example> class ParallelLearnerEvaluator;
+
 /**
  * \brief An instance of a class deriving from an instantiation of this class template can be used to
  *        evaluate a learner (e.g. a random forest) using approaches based on example set splitting.
+ *
+ * The learner is evaluated on the various splits concurrently, using tasks on the shared thread pool. Derived
+ * classes must therefore ensure that evaluate_on_split can safely be called from several threads at once (e.g.
+ * by constructing a fresh learner, with its own random number generator, for each split).
  */
 template <typename Example, typename Result>
 class LearnerEvaluator
@@ -22,6 +34,10 @@ protected:
   typedef boost::shared_ptr<const Example> Example_CPtr;
   typedef Result ResultType;
 
+  //#################### FRIENDS ####################
+
+  template <typename> friend class ParallelLearnerEvaluator;
+
   //#################### PRIVATE VARIABLES ####################
 private:
   /** The generator to use to split the example set. */
@@ -74,25 +90,48 @@ public:
    */
   Result evaluate(const std::vector<Example_CPtr>& examples) const
   {
-    std::vector<Result> results;
-    std::vector<SplitGenerator::Split> splits = m_splitGenerator->generate_splits(examples.size());
-    int size = static_cast<int>(splits.size());
+    std::vector<SplitGenerator::Split> splits = generate_splits(examples.size());
 
-#ifdef WITH_OPENMP
-    #pragma omp parallel for
-#endif
-    for(int i = 0; i < size; ++i)
+    // Evaluate the learner on each split in a separate task. Each result is stored at the index of its split,
+    // so that the results are averaged in the same order irrespective of the order in which the tasks finish.
+    std::vector<Result> results(splits.size());
+    tvgutil::TaskGroup taskGroup;
+    for(size_t i = 0, size = splits.size(); i < size; ++i)
     {
-      Result evaluationResult = evaluate_on_split(examples, splits[i]);
-
-#ifdef WITH_OPENMP
-      #pragma omp critical
-#endif
-      results.push_back(evaluationResult);
+      taskGroup.run(boost::bind(&LearnerEvaluator::evaluate_on_split_into, this, boost::cref(examples), boost::cref(splits[i]), boost::ref(results[i])));
     }
+    taskGroup.wait();
 
     return average_results(results);
   }
+
+  //#################### PRIVATE MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Evaluates the learner on the specified split of examples, and writes the results into the specified location.
+   *
+   * \param examples  The examples on which to evaluate the learner.
+   * \param split     The way in which the examples should be split into training and validation sets.
+   * \param result    The location into which to write the results of evaluating the learner on the specified split.
+   */
+  void evaluate_on_split_into(const std::vector<Example_CPtr>& examples, const SplitGenerator::Split& split, Result& result) const
+  {
+    result = evaluate_on_split(examples, split);
+  }
+
+  /**
+   * \brief Generates the splits on which to evaluate the learner.
+   *
+   * \note  The split generator is stateful, so this must be called serially (and in a fixed order) if the
+   *        splits are to be reproducible.
+   *
+   * \param exampleCount  The number of examples to split.
+   * \return              The splits.
+   */
+  std::vector<SplitGenerator::Split> generate_splits(size_t exampleCount) const
+  {
+    return m_splitGenerator->generate_splits(exampleCount);
+  }
 };
 
 }
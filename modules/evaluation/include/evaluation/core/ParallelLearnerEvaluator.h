@@ -0,0 +1,241 @@
+/**
+ * evaluation: ParallelLearnerEvaluator.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#ifndef H_EVALUATION_PARALLELLEARNEREVALUATOR
+#define H_EVALUATION_PARALLELLEARNEREVALUATOR
+
+#include <iostream>
+
+#include <boost/bind.hpp>
+#include <boost/chrono/chrono.hpp>
+#include <boost/function.hpp>
+#include <boost/thread/lock_guard.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <tvgutil/misc/TaskGroup.h>
+
+#include "LearnerEvaluator.h"
+#include "PerformanceTable.h"
+
+namespace evaluation {
+
+/**
+ * \brief An instance of an instantiation of this class template can be used to evaluate a learner on several parameter sets at once.
+ *
+ * Every (parameter set, split) pair is evaluated as an independent task on a single thread pool, so that the pool is kept busy
+ * even when there are more threads than splits. The results are deterministic irrespective of the number of threads used:
+ * the splits are generated serially (in parameter set order) before any evaluation starts, each task constructs its own
+ * learner (seeded from its parameter set), and the results for each parameter set are averaged in split order. The averaged
+ * result for each parameter set is recorded in the performance table as soon as it (and every earlier parameter set) has
+ * been evaluated, so the table always contains a prefix of the parameter sets in their original order.
+ */
+template <typename Example>
+class ParallelLearnerEvaluator
+{
+  //#################### TYPEDEFS ####################
+public:
+  typedef boost::shared_ptr<const Example> Example_CPtr;
+  typedef LearnerEvaluator<Example,PerformanceResult> Evaluator;
+  typedef boost::shared_ptr<const Evaluator> Evaluator_CPtr;
+  typedef boost::function<Evaluator_CPtr(const ParamSet&)> EvaluatorMaker;
+
+  //#################### NESTED TYPES ####################
+private:
+  /**
+   * \brief An instance of this struct holds the state shared by the tasks of a single call to evaluate.
+   */
+  struct EvaluationState
+  {
+    /** The evaluators for the various parameter sets. */
+    std::vector<Evaluator_CPtr> evaluators;
+
+    /** The examples on which to evaluate the learner. */
+    const std::vector<Example_CPtr> *examples;
+
+    /** The number of tasks that have finished so far. */
+    size_t finishedTaskCount;
+
+    /** The synchronisation mutex (guards everything below that changes whilst the tasks are running). */
+    boost::mutex mutex;
+
+    /** The index of the next parameter set whose result should be recorded in the performance table. */
+    size_t nextParamSetIndex;
+
+    /** The parameter sets on which to evaluate the learner. */
+    const std::vector<ParamSet> *paramSets;
+
+    /** The number of splits that remain to be evaluated for each parameter set. */
+    std::vector<size_t> remainingSplitCounts;
+
+    /** The results for each split of each parameter set. */
+    std::vector<std::vector<PerformanceResult> > results;
+
+    /** The splits for each parameter set. */
+    std::vector<std::vector<SplitGenerator::Split> > splits;
+
+    /** The time at which the evaluation started. */
+    boost::chrono::steady_clock::time_point startTime;
+
+    /** The performance table into which to record the results. */
+    PerformanceTable *table;
+
+    /** The total number of tasks. */
+    size_t taskCount;
+  };
+
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** The function to use to make an evaluator for each parameter set. */
+  EvaluatorMaker m_makeEvaluator;
+
+  /** The thread pool on which to run the evaluation tasks. */
+  tvgutil::ThreadPool& m_pool;
+
+  /** The stream to which to write progress reports (or NULL, if progress should not be reported). */
+  std::ostream *m_progressStream;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Constructs a parallel learner evaluator.
+   *
+   * \param makeEvaluator The function to use to make an evaluator for each parameter set.
+   * \param pool          The thread pool on which to run the evaluation tasks.
+   */
+  explicit ParallelLearnerEvaluator(const EvaluatorMaker& makeEvaluator, tvgutil::ThreadPool& pool = tvgutil::ThreadPool::instance())
+  : m_makeEvaluator(makeEvaluator), m_pool(pool), m_progressStream(&std::cout)
+  {}
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Evaluates the learner on each of the specified parameter sets, and records the results in a performance table.
+   *
+   * \param paramSets The parameter sets on which to evaluate the learner.
+   * \param examples  The examples on which to evaluate the learner.
+   * \param table     The performance table into which to record the results (in parameter set order).
+   * \throws std::runtime_error If the evaluation of any split fails.
+   */
+  void evaluate(const std::vector<ParamSet>& paramSets, const std::vector<Example_CPtr>& examples, PerformanceTable& table) const
+  {
+    const size_t paramSetCount = paramSets.size();
+
+    EvaluationState state;
+    state.evaluators.resize(paramSetCount);
+    state.examples = &examples;
+    state.finishedTaskCount = 0;
+    state.nextParamSetIndex = 0;
+    state.paramSets = &paramSets;
+    state.remainingSplitCounts.resize(paramSetCount);
+    state.results.resize(paramSetCount);
+    state.splits.resize(paramSetCount);
+    state.table = &table;
+    state.taskCount = 0;
+
+    // Make the evaluators and generate their splits. This is done serially (and in parameter set order),
+    // since evaluators may share a stateful split generator.
+    for(size_t i = 0; i < paramSetCount; ++i)
+    {
+      state.evaluators[i] = m_makeEvaluator(paramSets[i]);
+      state.splits[i] = state.evaluators[i]->generate_splits(examples.size());
+      state.remainingSplitCounts[i] = state.splits[i].size();
+      state.results[i].resize(state.splits[i].size());
+      state.taskCount += state.splits[i].size();
+    }
+
+    // Evaluate every (parameter set, split) pair in a separate task.
+    state.startTime = boost::chrono::steady_clock::now();
+    tvgutil::TaskGroup taskGroup(m_pool);
+    for(size_t i = 0; i < paramSetCount; ++i)
+    {
+      for(size_t j = 0, splitCount = state.splits[i].size(); j < splitCount; ++j)
+      {
+        taskGroup.run(boost::bind(&ParallelLearnerEvaluator::evaluate_split, this, boost::ref(state), i, j));
+      }
+    }
+    taskGroup.wait();
+
+    // Record the results of any parameter sets that had no splits (and so were never recorded by a task).
+    boost::lock_guard<boost::mutex> lock(state.mutex);
+    record_finished_results(state);
+  }
+
+  /**
+   * \brief Sets the stream to which to write progress reports.
+   *
+   * \param progressStream  The stream to which to write progress reports (or NULL, if progress should not be reported).
+   */
+  void set_progress_stream(std::ostream *progressStream)
+  {
+    m_progressStream = progressStream;
+  }
+
+  //#################### PRIVATE MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Evaluates the learner on the specified split of the specified parameter set.
+   *
+   * \param state         The state shared by the tasks of the current evaluation.
+   * \param paramSetIndex The index of the parameter set.
+   * \param splitIndex    The index of the split.
+   */
+  void evaluate_split(EvaluationState& state, size_t paramSetIndex, size_t splitIndex) const
+  {
+    // Note: Each task writes only to its own result slot, so no locking is needed for the evaluation itself.
+    state.results[paramSetIndex][splitIndex] = state.evaluators[paramSetIndex]->evaluate_on_split(*state.examples, state.splits[paramSetIndex][splitIndex]);
+
+    boost::lock_guard<boost::mutex> lock(state.mutex);
+    --state.remainingSplitCounts[paramSetIndex];
+    ++state.finishedTaskCount;
+    record_finished_results(state);
+    report_progress(state);
+  }
+
+  /**
+   * \brief Records in the performance table the results of any parameter sets that have finished
+   *        being evaluated and that are not preceded by a parameter set that is still being evaluated.
+   *
+   * \note  The caller must hold the state's mutex.
+   *
+   * \param state The state shared by the tasks of the current evaluation.
+   */
+  void record_finished_results(EvaluationState& state) const
+  {
+    size_t& i = state.nextParamSetIndex;
+    for(size_t size = state.paramSets->size(); i < size && state.remainingSplitCounts[i] == 0; ++i)
+    {
+      if(!state.results[i].empty())
+      {
+        state.table->record_performance((*state.paramSets)[i], state.evaluators[i]->average_results(state.results[i]));
+      }
+
+      // Free the per-split results, since they are no longer needed.
+      std::vector<PerformanceResult>().swap(state.results[i]);
+    }
+  }
+
+  /**
+   * \brief Writes a progress report (including an estimate of the remaining time) to the progress stream, if any.
+   *
+   * \note  The caller must hold the state's mutex.
+   *
+   * \param state The state shared by the tasks of the current evaluation.
+   */
+  void report_progress(const EvaluationState& state) const
+  {
+    if(!m_progressStream) return;
+
+    const double elapsedSeconds = boost::chrono::duration<double>(boost::chrono::steady_clock::now() - state.startTime).count();
+    const double remainingSeconds = elapsedSeconds * (state.taskCount - state.finishedTaskCount) / state.finishedTaskCount;
+
+    *m_progressStream << "[evaluation] Evaluated " << state.finishedTaskCount << '/' << state.taskCount << " splits ("
+                      << state.nextParamSetIndex << '/' << state.paramSets->size() << " parameter sets); elapsed "
+                      << static_cast<int>(elapsedSeconds) << "s, ETA " << static_cast<int>(remainingSeconds + 0.5) << "s" << std::endl;
+  }
+};
+
+}
+
+#endif
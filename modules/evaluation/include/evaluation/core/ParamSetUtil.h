@@ -20,6 +20,17 @@ struct ParamSetUtil
 {
   //#################### PUBLIC STATIC MEMBER FUNCTIONS ####################
 
+  /**
+   * \brief Computes a hash of a parameter set that can be used to identify it (e.g. in a log file).
+   *
+   * The hash is computed from the string representation of the parameter set using 64-bit FNV-1a, so it is
+   * stable across runs and platforms.
+   *
+   * \param paramSet  The parameter set.
+   * \return          The hash, as a 16-digit hexadecimal string.
+   */
+  static std::string hash_param_set(const ParamSet& paramSet);
+
   /**
    * \brief Makes a string representation of a parameter set.
    *
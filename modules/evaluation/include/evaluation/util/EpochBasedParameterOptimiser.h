@@ -7,8 +7,10 @@
 #define H_EVALUATION_EPOCHBASEDPARAMETEROPTIMISER
 
 #include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
 #include <boost/spirit/home/support/detail/hold_any.hpp>
 
+#include <tvgutil/misc/ThreadPool.h>
 #include <tvgutil/numbers/RandomNumberGenerator.h>
 
 #include "../core/ParamSetUtil.h"
@@ -32,6 +34,9 @@ private:
   /** The number of epochs for which optimisation should be run. */
   size_t m_epochCount;
 
+  /** The thread pool used to evaluate independent parameter sets concurrently (NULL if they should be evaluated one at a time). */
+  boost::shared_ptr<tvgutil::ThreadPool> m_evaluationPool;
+
   //#################### PROTECTED VARIABLES ####################
 protected:
   /** A list of the possible values for each parameter (e.g. [("A", [1,2]), ("B", [3,4])]). */
@@ -94,6 +99,16 @@ public:
    */
   ParamSet optimise_for_parameters(float *bestCost = NULL) const;
 
+  /**
+   * \brief Sets the maximum number of parameter sets that the optimiser may evaluate concurrently.
+   *
+   * By default, parameter sets are evaluated one at a time. If the thread count is greater than one, the
+   * cost function will be called from several threads at once, and so must be thread-safe.
+   *
+   * \param threadCount The maximum number of parameter sets that the optimiser may evaluate concurrently.
+   */
+  void set_evaluation_thread_count(size_t threadCount);
+
   //#################### PROTECTED MEMBER FUNCTIONS ####################
 protected:
   /**
@@ -105,6 +120,16 @@ protected:
    */
   float compute_cost(const std::vector<size_t>& valueIndices) const;
 
+  /**
+   * \brief Computes the costs associated with several independent sets of parameter value indices.
+   *
+   * If an evaluation thread count greater than one has been set, the costs will be computed concurrently.
+   *
+   * \param valueIndicesList  The sets of parameter value indices.
+   * \return                  The costs associated with the sets of parameter value indices (in the same order).
+   */
+  std::vector<float> compute_costs(const std::vector<std::vector<size_t> >& valueIndicesList) const;
+
   //#################### PRIVATE MEMBER FUNCTIONS ####################
 private:
   /**
@@ -0,0 +1,113 @@
+/**
+ * evaluation: ParamSetCostLog.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#ifndef H_EVALUATION_PARAMSETCOSTLOG
+#define H_EVALUATION_PARAMSETCOSTLOG
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/optional.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "../core/ParamSetUtil.h"
+
+namespace evaluation {
+
+/**
+ * \brief An instance of this class represents a log file that records the costs of the parameter sets evaluated during a parameter search.
+ *
+ * Each parameter set is identified in the log by a hash of its string representation. When a log is opened, the costs of any
+ * parameter sets that were already recorded in it are loaded, so that a search that was interrupted can be resumed without
+ * re-evaluating them (provided that the search visits the parameter sets in the same order, e.g. by using the same seed).
+ *
+ * Each entry is appended to the file as soon as it is recorded. Entries can be recorded from several threads at once.
+ *
+ * A log can also be given a context, i.e. a set of settings under which the costs are computed (e.g. the number of evaluation threads),
+ * which is added to every parameter set that is looked up or recorded. This ensures that costs computed under different settings are
+ * never reused for one another when a search is resumed.
+ */
+class ParamSetCostLog
+{
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** The settings under which the costs in the log are computed (these are added to every parameter set that is looked up or recorded). */
+  ParamSet m_context;
+
+  /** The costs of the parameter sets that have been recorded in the log, indexed by their hashes. */
+  std::map<std::string,float> m_costs;
+
+  /** The names of any additional columns (beyond the hash, cost and parameters) in the log. */
+  std::vector<std::string> m_extraColumnNames;
+
+  /** The name of the log file. */
+  std::string m_filename;
+
+  /** The synchronisation mutex. */
+  mutable boost::mutex m_mutex;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Opens a parameter set cost log, creating it if it does not already exist.
+   *
+   * \param filename          The name of the log file.
+   * \param extraColumnNames  The names of any additional columns (beyond the hash, cost and parameters) to include in the log.
+   * \param context           The settings under which the costs in the log are computed (their names must differ from those of the parameters).
+   *
+   * \throws std::runtime_error If the log file cannot be created.
+   */
+  ParamSetCostLog(const std::string& filename, const std::vector<std::string>& extraColumnNames = std::vector<std::string>(), const ParamSet& context = ParamSet());
+
+  //#################### COPY CONSTRUCTOR & ASSIGNMENT OPERATOR ####################
+private:
+  // Deliberately private and unimplemented.
+  ParamSetCostLog(const ParamSetCostLog&);
+  ParamSetCostLog& operator=(const ParamSetCostLog&);
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Gets the number of parameter sets whose costs have been recorded in the log.
+   *
+   * \return  The number of parameter sets whose costs have been recorded in the log.
+   */
+  size_t get_entry_count() const;
+
+  /**
+   * \brief Looks up the cost of a parameter set in the log.
+   *
+   * \param params  The parameter set.
+   * \return        The cost of the parameter set, if it has been recorded in the log, or boost::none otherwise.
+   */
+  boost::optional<float> lookup_cost(const ParamSet& params) const;
+
+  /**
+   * \brief Records the cost of a parameter set in the log.
+   *
+   * \param params      The parameter set.
+   * \param cost        The cost of the parameter set.
+   * \param extraValues The values of any additional columns (there must be one for each of the log's additional columns).
+   *
+   * \throws std::invalid_argument  If the wrong number of additional values is specified.
+   * \throws std::runtime_error     If the entry cannot be written to the log file.
+   */
+  void record_cost(const ParamSet& params, float cost, const std::vector<std::string>& extraValues = std::vector<std::string>());
+
+  //#################### PRIVATE MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Adds the log's context to a parameter set.
+   *
+   * \param params  The parameter set.
+   * \return        The parameter set, together with the log's context.
+   */
+  ParamSet add_context(const ParamSet& params) const;
+};
+
+}
+
+#endif
@@ -5,12 +5,32 @@
 
 #include "core/ParamSetUtil.h"
 
+#include <iomanip>
 #include <iostream>
+#include <sstream>
+
+#include <boost/cstdint.hpp>
 
 namespace evaluation {
 
 //#################### PUBLIC STATIC MEMBER FUNCTIONS ####################
 
+std::string ParamSetUtil::hash_param_set(const ParamSet& paramSet)
+{
+  const std::string paramString = param_set_to_string(paramSet);
+
+  boost::uint64_t hash = 14695981039346656037ULL;
+  for(size_t i = 0, size = paramString.size(); i < size; ++i)
+  {
+    hash ^= static_cast<unsigned char>(paramString[i]);
+    hash *= 1099511628211ULL;
+  }
+
+  std::ostringstream oss;
+  oss << std::hex << std::setw(16) << std::setfill('0') << hash;
+  return oss.str();
+}
+
 std::string ParamSetUtil::param_set_to_string(const ParamSet& params)
 {
   std::string paramString;
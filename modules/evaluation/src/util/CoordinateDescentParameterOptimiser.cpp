@@ -41,20 +41,30 @@ std::pair<std::vector<size_t>,float> CoordinateDescentParameterOptimiser::optimi
     // Record the parameter value for which we already have the corresponding cost so that we can avoid re-evaluating it.
     size_t originalValueIndex = currentValueIndices[paramIndex];
 
-    // For each possible new value that the parameter can take:
-    std::vector<size_t> newValueIndices = currentValueIndices;
+    // Make the sets of parameter value indices obtained by changing the parameter to each of the other values it can take
+    // (we already know the cost for the original value, so there's no need to re-evaluate it). These sets only differ from
+    // the current set in the value of this parameter, so their costs can be computed independently (and concurrently).
+    std::vector<size_t> candidateValueIndices;
+    std::vector<std::vector<size_t> > candidates;
     for(size_t valueIndex = 0; valueIndex < valueCount; ++valueIndex)
     {
-      // If we already know that the cost for the new value is no better than the cost for the current value, skip it.
       if(valueIndex == originalValueIndex) continue;
 
-      // Compute the cost for the new value. If it's better than the cost for the current value, update the current value.
+      std::vector<size_t> newValueIndices = currentValueIndices;
       newValueIndices[paramIndex] = valueIndex;
-      float newCost = compute_cost(newValueIndices);
-      if(newCost < currentCost)
+      candidateValueIndices.push_back(valueIndex);
+      candidates.push_back(newValueIndices);
+    }
+
+    // Compute the costs for the new values. If any of them is better than the cost for the current value, update the current
+    // value to the (first) best one. Note that this makes the same choice as evaluating the new values one at a time would.
+    const std::vector<float> newCosts = compute_costs(candidates);
+    for(size_t i = 0, size = newCosts.size(); i < size; ++i)
+    {
+      if(newCosts[i] < currentCost)
       {
-        currentValueIndices[paramIndex] = valueIndex;
-        currentCost = newCost;
+        currentValueIndices[paramIndex] = candidateValueIndices[i];
+        currentCost = newCosts[i];
       }
     }
 
@@ -10,8 +10,37 @@
 #include <boost/lexical_cast.hpp>
 using boost::spirit::hold_any;
 
+#include <tvgutil/misc/TaskGroup.h>
+using namespace tvgutil;
+
 namespace evaluation {
 
+//#################### HELPER FUNCTIONS ####################
+
+/**
+ * \brief An instance of this struct can be used to compute the cost of one of a list of parameter sets.
+ */
+struct CostComputer
+{
+  /** The cost function. */
+  const boost::function<float(const ParamSet&)>& costFunction;
+
+  /** A place in which to store the costs of the parameter sets. */
+  std::vector<float>& costs;
+
+  /** The parameter sets. */
+  const std::vector<ParamSet>& paramSets;
+
+  CostComputer(const boost::function<float(const ParamSet&)>& costFunction_, const std::vector<ParamSet>& paramSets_, std::vector<float>& costs_)
+  : costFunction(costFunction_), costs(costs_), paramSets(paramSets_)
+  {}
+
+  void operator()(size_t i) const
+  {
+    costs[i] = costFunction(paramSets[i]);
+  }
+};
+
 //#################### CONSTRUCTORS ####################
 
 EpochBasedParameterOptimiser::EpochBasedParameterOptimiser(const CostFunction& costFunction, size_t epochCount, unsigned int seed)
@@ -55,13 +84,40 @@ ParamSet EpochBasedParameterOptimiser::optimise_for_parameters(float *bestCost)
   return make_param_set(bestValueIndicesAllTime);
 }
 
-//#################### PRIVATE MEMBER FUNCTIONS ####################
+void EpochBasedParameterOptimiser::set_evaluation_thread_count(size_t threadCount)
+{
+  // Note: The thread that waits for the evaluations also helps to run them, so the pool needs one fewer thread.
+  m_evaluationPool.reset(threadCount > 1 ? new ThreadPool(threadCount - 1) : NULL);
+}
+
+//#################### PROTECTED MEMBER FUNCTIONS ####################
 
 float EpochBasedParameterOptimiser::compute_cost(const std::vector<size_t>& valueIndices) const
 {
   return m_costFunction(make_param_set(valueIndices));
 }
 
+std::vector<float> EpochBasedParameterOptimiser::compute_costs(const std::vector<std::vector<size_t> >& valueIndicesList) const
+{
+  std::vector<ParamSet> paramSets;
+  paramSets.reserve(valueIndicesList.size());
+  for(size_t i = 0, size = valueIndicesList.size(); i < size; ++i)
+  {
+    paramSets.push_back(make_param_set(valueIndicesList[i]));
+  }
+
+  std::vector<float> costs(paramSets.size());
+  CostComputer costComputer(m_costFunction, paramSets, costs);
+
+  // Note: The parameter sets are evaluated one per task, since each evaluation is typically expensive.
+  if(m_evaluationPool) m_evaluationPool->parallel_for(0, paramSets.size(), costComputer, 1);
+  else for(size_t i = 0, size = paramSets.size(); i < size; ++i) costComputer(i);
+
+  return costs;
+}
+
+//#################### PRIVATE MEMBER FUNCTIONS ####################
+
 std::vector<size_t> EpochBasedParameterOptimiser::generate_random_value_indices() const
 {
   std::vector<size_t> valueIndices;
@@ -0,0 +1,122 @@
+/**
+ * evaluation: ParamSetCostLog.cpp
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#include "util/ParamSetCostLog.h"
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+
+#include <boost/lexical_cast.hpp>
+#include <boost/thread/lock_guard.hpp>
+
+namespace evaluation {
+
+//#################### CONSTRUCTORS ####################
+
+ParamSetCostLog::ParamSetCostLog(const std::string& filename, const std::vector<std::string>& extraColumnNames, const ParamSet& context)
+: m_context(context), m_extraColumnNames(extraColumnNames), m_filename(filename)
+{
+  // If the log file already exists, load the costs of the parameter sets that were recorded in it.
+  std::ifstream is(filename.c_str());
+  if(is)
+  {
+    std::string line;
+    std::getline(is, line); // skip the header
+
+    while(std::getline(is, line))
+    {
+      // Each line has the form "Hash;Cost;<extra values>;Params". If the search was interrupted whilst a line was
+      // being written, the last line may be incomplete, in which case it is skipped.
+      const size_t firstSemicolon = line.find(';');
+      const size_t secondSemicolon = firstSemicolon != std::string::npos ? line.find(';', firstSemicolon + 1) : std::string::npos;
+      if(secondSemicolon == std::string::npos)
+      {
+        if(!line.empty()) std::cerr << "Warning: Skipping malformed entry '" << line << "' in parameter set cost log '" << filename << "'\n";
+        continue;
+      }
+
+      try
+      {
+        m_costs[line.substr(0, firstSemicolon)] = boost::lexical_cast<float>(line.substr(firstSemicolon + 1, secondSemicolon - firstSemicolon - 1));
+      }
+      catch(boost::bad_lexical_cast&)
+      {
+        std::cerr << "Warning: Skipping malformed entry '" << line << "' in parameter set cost log '" << filename << "'\n";
+      }
+    }
+
+    return;
+  }
+
+  // Otherwise, create the log file and write the header.
+  std::ofstream os(filename.c_str());
+  if(!os) throw std::runtime_error("Error: Could not create parameter set cost log '" + filename + "'");
+
+  os << "Hash;Cost;";
+  for(size_t i = 0, size = extraColumnNames.size(); i < size; ++i)
+  {
+    os << extraColumnNames[i] << ';';
+  }
+  os << "Params\n";
+}
+
+//#################### PUBLIC MEMBER FUNCTIONS ####################
+
+size_t ParamSetCostLog::get_entry_count() const
+{
+  boost::lock_guard<boost::mutex> lock(m_mutex);
+  return m_costs.size();
+}
+
+boost::optional<float> ParamSetCostLog::lookup_cost(const ParamSet& params) const
+{
+  const std::string hash = ParamSetUtil::hash_param_set(add_context(params));
+
+  boost::lock_guard<boost::mutex> lock(m_mutex);
+  std::map<std::string,float>::const_iterator it = m_costs.find(hash);
+  return it != m_costs.end() ? boost::optional<float>(it->second) : boost::none;
+}
+
+void ParamSetCostLog::record_cost(const ParamSet& params, float cost, const std::vector<std::string>& extraValues)
+{
+  if(extraValues.size() != m_extraColumnNames.size())
+  {
+    throw std::invalid_argument("Error: The number of extra values must match the number of extra columns in the parameter set cost log");
+  }
+
+  const ParamSet loggedParams = add_context(params);
+  const std::string hash = ParamSetUtil::hash_param_set(loggedParams);
+
+  boost::lock_guard<boost::mutex> lock(m_mutex);
+
+  // Append the entry to the log file. Note that the file is reopened (and thus flushed) for each entry, so that
+  // as few evaluations as possible are lost if the search is interrupted. The cost is written with enough digits
+  // to round-trip exactly, so that a resumed search makes exactly the same decisions as an uninterrupted one.
+  std::ofstream os(m_filename.c_str(), std::ios::app);
+  if(!os) throw std::runtime_error("Error: Could not write to parameter set cost log '" + m_filename + "'");
+
+  os << hash << ';' << std::setprecision(std::numeric_limits<float>::digits10 + 3) << cost << ';';
+  for(size_t i = 0, size = extraValues.size(); i < size; ++i)
+  {
+    os << extraValues[i] << ';';
+  }
+  os << ParamSetUtil::param_set_to_string(loggedParams) << '\n';
+
+  m_costs[hash] = cost;
+}
+
+//#################### PRIVATE MEMBER FUNCTIONS ####################
+
+ParamSet ParamSetCostLog::add_context(const ParamSet& params) const
+{
+  ParamSet result = params;
+  result.insert(m_context.begin(), m_context.end());
+  return result;
+}
+
+}
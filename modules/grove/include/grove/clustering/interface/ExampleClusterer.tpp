@@ -27,13 +27,13 @@ ExampleClusterer<ExampleType, ClusterType, MaxClusters>::ExampleClusterer(float
   // Initially, all are empty. We resize them later, once we know the right sizes.
   orx::MemoryBlockFactory& mbf = orx::MemoryBlockFactory::instance();
 
-  m_clusterIndices = mbf.make_image<int>();
-  m_clusterSizeHistograms = mbf.make_image<int>();
-  m_clusterSizes = mbf.make_image<int>();
-  m_densities = mbf.make_image<float>();
-  m_nbClustersPerExampleSet = mbf.make_block<int>();
-  m_parents = mbf.make_image<int>();
-  m_selectedClusters = mbf.make_image<int>();
+  m_clusterIndices = mbf.make_image<int>(Vector2i(0, 0), "Relocalisation");
+  m_clusterSizeHistograms = mbf.make_image<int>(Vector2i(0, 0), "Relocalisation");
+  m_clusterSizes = mbf.make_image<int>(Vector2i(0, 0), "Relocalisation");
+  m_densities = mbf.make_image<float>(Vector2i(0, 0), "Relocalisation");
+  m_nbClustersPerExampleSet = mbf.make_block<int>(0, "Relocalisation");
+  m_parents = mbf.make_image<int>(Vector2i(0, 0), "Relocalisation");
+  m_selectedClusters = mbf.make_image<int>(Vector2i(0, 0), "Relocalisation");
 }
 
 //#################### DESTRUCTOR ####################
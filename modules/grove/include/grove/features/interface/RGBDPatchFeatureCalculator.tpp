@@ -44,9 +44,9 @@ RGBDPatchFeatureCalculator<KeypointType,DescriptorType>::RGBDPatchFeatureCalcula
 
   // Set up the memory blocks used to specify the features.
   const orx::MemoryBlockFactory& mbf = orx::MemoryBlockFactory::instance();
-  m_depthOffsets = mbf.make_block<Vector4i>(m_depthFeatureCount);
-  m_rgbChannels = mbf.make_block<uchar>(m_rgbFeatureCount);
-  m_rgbOffsets = mbf.make_block<Vector4i>(m_rgbFeatureCount);
+  m_depthOffsets = mbf.make_block<Vector4i>(m_depthFeatureCount, "Relocalisation");
+  m_rgbChannels = mbf.make_block<uchar>(m_rgbFeatureCount, "Relocalisation");
+  m_rgbOffsets = mbf.make_block<Vector4i>(m_rgbFeatureCount, "Relocalisation");
 
   // Set up the features.
   setup_depth_features();
@@ -69,7 +69,7 @@ DecisionForest<DescriptorType,TreeCount>::DecisionForest(const tvgutil::Settings
 
   // Allocate node texture.
   const orx::MemoryBlockFactory& mbf = orx::MemoryBlockFactory::instance();
-  m_nodeImage = mbf.make_image<NodeEntry>(Vector2i(TREE_COUNT, nbNodesPerTree));
+  m_nodeImage = mbf.make_image<NodeEntry>(Vector2i(TREE_COUNT, nbNodesPerTree), "Relocalisation");
   m_nodeImage->Clear();
 
   uint32_t currentLeafIdx = 0;
@@ -143,7 +143,7 @@ DecisionForest<DescriptorType,TreeCount>::DecisionForest(const EnsembleLearner&
 
   // Allocate the texture to store the nodes.
   const orx::MemoryBlockFactory& mbf = orx::MemoryBlockFactory::instance();
-  m_nodeImage = mbf.make_image<NodeEntry>(Vector2i(nbTrees, maxNbNodes));
+  m_nodeImage = mbf.make_image<NodeEntry>(Vector2i(nbTrees, maxNbNodes), "Relocalisation");
   m_nodeImage->Clear();
 
   // Fill the nodes.
@@ -268,7 +268,7 @@ void DecisionForest<DescriptorType,TreeCount>::load_structure_from_file(const st
 
   // Allocate and clear the node image.
   const orx::MemoryBlockFactory& mbf = orx::MemoryBlockFactory::instance();
-  m_nodeImage = mbf.make_image<NodeEntry>(Vector2i(nbTrees, maxNbNodes));
+  m_nodeImage = mbf.make_image<NodeEntry>(Vector2i(nbTrees, maxNbNodes), "Relocalisation");
   m_nodeImage->Clear();
 
 #if RANDOM_FEATURES
@@ -21,6 +21,17 @@ struct ScoreRelocaliserFactory
 {
   //#################### PUBLIC STATIC MEMBER FUNCTIONS ####################
 
+  /**
+   * \brief Loads a pre-trained SCoRe forest from a file, so that it can be shared between several relocalisers.
+   *
+   * \param forestFilename  The name of the file from which to load the pre-trained forest.
+   * \param deviceType      The device on which the relocalisers that will use the forest should operate.
+   * \return                The forest.
+   *
+   * \throws std::runtime_error If the forest cannot be loaded.
+   */
+  static ScoreRelocaliser::ScoreForest_Ptr load_forest(const std::string& forestFilename, DeviceType deviceType);
+
   /**
    * \brief Makes a SCoRe relocaliser by loading a pre-trained forest from a file.
    *
@@ -46,6 +57,20 @@ struct ScoreRelocaliserFactory
    */
   static ScoreRelocaliser_Ptr make_score_relocaliser(const std::string& forestFilename, const tvgutil::SettingsContainer_CPtr& settings,
                                                      const std::string& settingsNamespace, DeviceType deviceType);
+
+  /**
+   * \brief Makes a SCoRe relocaliser that uses an existing pre-trained forest (see load_forest).
+   *
+   * \param forest            The pre-trained forest.
+   * \param settings          The settings used to configure the relocaliser.
+   * \param settingsNamespace The namespace associated with the settings that are specific to the SCoRe relocaliser.
+   * \param deviceType        The device on which the relocaliser should operate.
+   * \return                  The relocaliser.
+   *
+   * \throws std::runtime_error If the relocaliser cannot be created.
+   */
+  static ScoreRelocaliser_Ptr make_score_relocaliser(const ScoreRelocaliser::ScoreForest_Ptr& forest, const tvgutil::SettingsContainer_CPtr& settings,
+                                                     const std::string& settingsNamespace, DeviceType deviceType);
 };
 
 }
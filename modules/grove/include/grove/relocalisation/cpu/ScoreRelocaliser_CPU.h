@@ -29,6 +29,15 @@ public:
    */
   ScoreRelocaliser_CPU(const std::string& forestFilename, const tvgutil::SettingsContainer_CPtr& settings, const std::string& settingsNamespace);
 
+  /**
+   * \brief Constructs a CPU-based SCoRe relocaliser that uses an existing pre-trained forest.
+   *
+   * \param forest            The pre-trained forest (which must have been loaded on the CPU).
+   * \param settings          The settings used to configure the relocaliser.
+   * \param settingsNamespace The namespace associated with the settings that are specific to the SCoRe relocaliser.
+   */
+  ScoreRelocaliser_CPU(const ScoreForest_Ptr& forest, const tvgutil::SettingsContainer_CPtr& settings, const std::string& settingsNamespace);
+
   //#################### PROTECTED MEMBER FUNCTIONS ####################
 protected:
   /** Override */
@@ -154,6 +154,19 @@ protected:
    */
   ScoreRelocaliser(const std::string& forestFilename, const tvgutil::SettingsContainer_CPtr& settings, const std::string& settingsNamespace, DeviceType deviceType);
 
+  /**
+   * \brief Constructs a SCoRe relocaliser that uses an existing pre-trained forest.
+   *
+   * \note  The forest is only read by the relocaliser, so it can safely be shared between several relocalisers
+   *        (e.g. to evaluate different relocaliser parameters without reloading the forest each time).
+   *
+   * \param forest            The pre-trained forest.
+   * \param settings          The settings used to configure the relocaliser.
+   * \param settingsNamespace The namespace associated with the settings that are specific to the SCoRe relocaliser.
+   * \param deviceType        The device on which the relocaliser should operate (must match the device on which the forest was loaded).
+   */
+  ScoreRelocaliser(const ScoreForest_Ptr& forest, const tvgutil::SettingsContainer_CPtr& settings, const std::string& settingsNamespace, DeviceType deviceType);
+
   //#################### DESTRUCTOR ####################
 public:
   /**
@@ -294,6 +307,14 @@ private:
    */
   void ensure_valid_leaf(uint32_t treeIdx, uint32_t leafIdx) const;
 
+  /**
+   * \brief Initialises the relocaliser (this is shared between the constructors).
+   *
+   * \param forest            The pre-trained forest on which the relocaliser is to be based.
+   * \param settingsNamespace The namespace associated with the settings that are specific to the SCoRe relocaliser.
+   */
+  void initialise(const ScoreForest_Ptr& forest, const std::string& settingsNamespace);
+
   /**
    * \brief Updates the pixels to leaves image (for debugging purposes).
    *
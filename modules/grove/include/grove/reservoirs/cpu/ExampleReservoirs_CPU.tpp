@@ -23,7 +23,7 @@ ExampleReservoirs_CPU<ExampleType>::ExampleReservoirs_CPU(uint32_t reservoirCoun
 : ExampleReservoirs<ExampleType>(reservoirCount, reservoirCapacity, rngSeed)
 {
   orx::MemoryBlockFactory& mbf = orx::MemoryBlockFactory::instance();
-  m_rngs = mbf.make_block<CPURNG>();
+  m_rngs = mbf.make_block<CPURNG>(0, "Relocalisation");
 
   reset();
 }
@@ -23,9 +23,9 @@ ExampleReservoirs<ExampleType>::ExampleReservoirs(uint32_t reservoirCount, uint3
   orx::MemoryBlockFactory& mbf = orx::MemoryBlockFactory::instance();
 
   // One row per reservoir, width equal to the capacity.
-  m_reservoirs = mbf.make_image<ExampleType>(Vector2i(reservoirCapacity, reservoirCount));
-  m_reservoirAddCalls = mbf.make_block<int>(reservoirCount);
-  m_reservoirSizes = mbf.make_block<int>(reservoirCount);
+  m_reservoirs = mbf.make_image<ExampleType>(Vector2i(reservoirCapacity, reservoirCount), "Relocalisation");
+  m_reservoirAddCalls = mbf.make_block<int>(reservoirCount, "Relocalisation");
+  m_reservoirSizes = mbf.make_block<int>(reservoirCount, "Relocalisation");
 }
 
 //#################### DESTRUCTOR ####################
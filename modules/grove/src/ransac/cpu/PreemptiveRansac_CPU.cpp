@@ -21,7 +21,7 @@ PreemptiveRansac_CPU::PreemptiveRansac_CPU(const SettingsContainer_CPtr& setting
 : PreemptiveRansac(settings, settingsNamespace)
 {
   MemoryBlockFactory& mbf = MemoryBlockFactory::instance();
-  m_rngs = mbf.make_block<CPURNG>(m_maxPoseCandidates);
+  m_rngs = mbf.make_block<CPURNG>(m_maxPoseCandidates, "Relocalisation");
   m_rngSeed = 42;
 
   init_random();
@@ -151,9 +151,9 @@ PreemptiveRansac_CUDA::PreemptiveRansac_CUDA(const SettingsContainer_CPtr& setti
   MemoryBlockFactory& mbf = MemoryBlockFactory::instance();
 
   // Allocate memory blocks.
-  m_nbInliers_device = mbf.make_block<int>(1);        // Size 1, just to store a value that can be accessed from the GPU.
-  m_nbPoseCandidates_device = mbf.make_block<int>(1); // As above.
-  m_rngs = mbf.make_block<CUDARNG>(m_maxPoseCandidates);
+  m_nbInliers_device = mbf.make_block<int>(1, "Relocalisation");        // Size 1, just to store a value that can be accessed from the GPU.
+  m_nbPoseCandidates_device = mbf.make_block<int>(1, "Relocalisation"); // As above.
+  m_rngs = mbf.make_block<CUDARNG>(m_maxPoseCandidates, "Relocalisation");
 
   // Default random seed.
   m_rngSeed = 42;
@@ -74,13 +74,13 @@ PreemptiveRansac::PreemptiveRansac(const SettingsContainer_CPtr& settings, const
 
   // Allocate memory.
   const MemoryBlockFactory& mbf = MemoryBlockFactory::instance();
-  m_inlierRasterIndicesBlock = mbf.make_block<int>(m_nbMaxInliers);
-  m_inliersMaskImage = mbf.make_image<int>();
-  m_poseCandidates = mbf.make_block<PoseCandidate>(m_maxPoseCandidates);
+  m_inlierRasterIndicesBlock = mbf.make_block<int>(m_nbMaxInliers, "Relocalisation");
+  m_inliersMaskImage = mbf.make_image<int>(Vector2i(0, 0), "Relocalisation");
+  m_poseCandidates = mbf.make_block<PoseCandidate>(m_maxPoseCandidates, "Relocalisation");
 
   const uint32_t poseOptimisationBufferSize = static_cast<uint32_t>(m_nbMaxInliers * m_maxPoseCandidates);
-  m_poseOptimisationCameraPoints = mbf.make_block<Vector4f>(poseOptimisationBufferSize);
-  m_poseOptimisationPredictedModes = mbf.make_block<Keypoint3DColourCluster>(poseOptimisationBufferSize);
+  m_poseOptimisationCameraPoints = mbf.make_block<Vector4f>(poseOptimisationBufferSize, "Relocalisation");
+  m_poseOptimisationPredictedModes = mbf.make_block<Keypoint3DColourCluster>(poseOptimisationBufferSize, "Relocalisation");
 
 #ifdef ENABLE_TIMERS
   // Force the average timers to on as well if we want verbose printing.
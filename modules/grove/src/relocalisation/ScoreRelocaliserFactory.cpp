@@ -6,6 +6,8 @@
 #include "relocalisation/ScoreRelocaliserFactory.h"
 using namespace tvgutil;
 
+#include "forests/DecisionForestFactory.h"
+
 #include "relocalisation/cpu/ScoreRelocaliser_CPU.h"
 #ifdef WITH_CUDA
 #include "relocalisation/cuda/ScoreRelocaliser_CUDA.h"
@@ -15,6 +17,11 @@ namespace grove {
 
 //#################### PUBLIC STATIC MEMBER FUNCTIONS ####################
 
+ScoreRelocaliser::ScoreForest_Ptr ScoreRelocaliserFactory::load_forest(const std::string& forestFilename, DeviceType deviceType)
+{
+  return DecisionForestFactory<ScoreRelocaliser::DescriptorType,ScoreRelocaliser::FOREST_TREE_COUNT>::make_forest(forestFilename, deviceType);
+}
+
 ScoreRelocaliser_Ptr ScoreRelocaliserFactory::make_score_relocaliser(const std::string& forestFilename, const tvgutil::SettingsContainer_CPtr& settings, DeviceType deviceType)
 {
   return make_score_relocaliser(forestFilename, settings, "ScoreRelocaliser.", deviceType);
@@ -41,4 +48,25 @@ ScoreRelocaliser_Ptr ScoreRelocaliserFactory::make_score_relocaliser(const std::
   return relocaliser;
 }
 
+ScoreRelocaliser_Ptr ScoreRelocaliserFactory::make_score_relocaliser(const ScoreRelocaliser::ScoreForest_Ptr& forest, const SettingsContainer_CPtr& settings,
+                                                                     const std::string& settingsNamespace, DeviceType deviceType)
+{
+  ScoreRelocaliser_Ptr relocaliser;
+
+  if(deviceType == DEVICE_CUDA)
+  {
+#ifdef WITH_CUDA
+    relocaliser.reset(new ScoreRelocaliser_CUDA(forest, settings, settingsNamespace));
+#else
+    throw std::runtime_error("Error: CUDA support not currently available. Reconfigure in CMake with the WITH_CUDA option set to on.");
+#endif
+  }
+  else
+  {
+    relocaliser.reset(new ScoreRelocaliser_CPU(forest, settings, settingsNamespace));
+  }
+
+  return relocaliser;
+}
+
 }
@@ -16,6 +16,10 @@ ScoreRelocaliser_CPU::ScoreRelocaliser_CPU(const std::string& forestFilename, co
 : ScoreRelocaliser(forestFilename, settings, settingsNamespace, DEVICE_CPU)
 {}
 
+ScoreRelocaliser_CPU::ScoreRelocaliser_CPU(const ScoreForest_Ptr& forest, const SettingsContainer_CPtr& settings, const std::string& settingsNamespace)
+: ScoreRelocaliser(forest, settings, settingsNamespace, DEVICE_CPU)
+{}
+
 //#################### PROTECTED MEMBER FUNCTIONS ####################
 
 uint32_t ScoreRelocaliser_CPU::count_valid_depths(const ORFloatImage *depthImage) const
@@ -54,6 +54,10 @@ ScoreRelocaliser_CUDA::ScoreRelocaliser_CUDA(const std::string& forestFilename,
 : ScoreRelocaliser(forestFilename, settings, settingsNamespace, DEVICE_CUDA)
 {}
 
+ScoreRelocaliser_CUDA::ScoreRelocaliser_CUDA(const ScoreForest_Ptr& forest, const SettingsContainer_CPtr& settings, const std::string& settingsNamespace)
+: ScoreRelocaliser(forest, settings, settingsNamespace, DEVICE_CUDA)
+{}
+
 //#################### PROTECTED MEMBER FUNCTIONS ####################
 
 uint32_t ScoreRelocaliser_CUDA::count_valid_depths(const ORFloatImage *depthImage) const
@@ -39,47 +39,25 @@ ScoreRelocaliser::ScoreRelocaliser(const std::string& forestFilename, const Sett
   m_minZ(static_cast<float>(INT_MAX)),
   m_settings(settings)
 {
-  // Determine the top-level parameters for the relocaliser.
-  m_maxRelocalisationsToOutput = m_settings->get_first_value<uint32_t>(settingsNamespace + "maxRelocalisationsToOutput", 1);
-  m_visualiseForest = m_settings->get_first_value<bool>(settingsNamespace + "visualiseForest", true);
-
-  // Determine the reservoir-related parameters.
-  m_maxReservoirsToUpdate = m_settings->get_first_value<uint32_t>(settingsNamespace + "maxReservoirsToUpdate", 256);  // Update the modes associated with this number of reservoirs for each train/update call.
-  m_reservoirCapacity = m_settings->get_first_value<uint32_t>(settingsNamespace + "reservoirCapacity", 1024);
-  m_rngSeed = m_settings->get_first_value<uint32_t>(settingsNamespace + "rngSeed", 42);
-
-  // Determine the clustering-related parameters (the defaults are tentative values that seem to work).
-  m_clustererSigma = m_settings->get_first_value<float>(settingsNamespace + "clustererSigma", 0.1f);
-  m_clustererTau = m_settings->get_first_value<float>(settingsNamespace + "clustererTau", 0.05f);
-  m_maxClusterCount = m_settings->get_first_value<uint32_t>(settingsNamespace + "maxClusterCount", ScorePrediction::Capacity);
-  m_minClusterSize = m_settings->get_first_value<uint32_t>(settingsNamespace + "minClusterSize", 20);
-
-  // Check that the maximum number of clusters to store in each leaf is within range.
-  if(m_maxClusterCount > ScorePrediction::Capacity)
-  {
-    throw std::invalid_argument(settingsNamespace + "maxClusterCount > ScorePrediction::Capacity");
-  }
-
-  // Allocate the internal images.
-  MemoryBlockFactory& mbf = MemoryBlockFactory::instance();
-  m_descriptorsImage = mbf.make_image<DescriptorType>();
-  m_keypointsImage = mbf.make_image<ExampleType>();
-  m_leafIndicesImage = mbf.make_image<LeafIndices>();
-  m_predictionsImage = mbf.make_image<ScorePrediction>();
-
-  // Instantiate the sub-components.
-  m_featureCalculator = FeatureCalculatorFactory::make_da_rgbd_patch_feature_calculator(deviceType);
-  m_preemptiveRansac = PreemptiveRansacFactory::make_preemptive_ransac(settings, settingsNamespace + "PreemptiveRansac.", deviceType);
-
-  m_scoreForest = m_settings->get_first_value<bool>(settingsNamespace + "randomlyGenerateForest", false)
-    ? DecisionForestFactory<DescriptorType,FOREST_TREE_COUNT>::make_randomly_generated_forest(m_settings, deviceType)
+  ScoreForest_Ptr forest = settings->get_first_value<bool>(settingsNamespace + "randomlyGenerateForest", false)
+    ? DecisionForestFactory<DescriptorType,FOREST_TREE_COUNT>::make_randomly_generated_forest(settings, deviceType)
     : DecisionForestFactory<DescriptorType,FOREST_TREE_COUNT>::make_forest(forestFilename, deviceType);
 
-  m_reservoirCount = m_scoreForest->get_nb_leaves();
+  initialise(forest, settingsNamespace);
+}
 
-  // Set up the relocaliser's internal state.
-  m_relocaliserState.reset(new ScoreRelocaliserState);
-  reset();
+ScoreRelocaliser::ScoreRelocaliser(const ScoreForest_Ptr& forest, const SettingsContainer_CPtr& settings, const std::string& settingsNamespace, DeviceType deviceType)
+: m_backed(false),
+  m_deviceType(deviceType),
+  m_maxX(static_cast<float>(INT_MIN)),
+  m_maxY(static_cast<float>(INT_MIN)),
+  m_maxZ(static_cast<float>(INT_MIN)),
+  m_minX(static_cast<float>(INT_MAX)),
+  m_minY(static_cast<float>(INT_MAX)),
+  m_minZ(static_cast<float>(INT_MAX)),
+  m_settings(settings)
+{
+  initialise(forest, settingsNamespace);
 }
 
 //#################### DESTRUCTOR ####################
@@ -263,7 +241,7 @@ void ScoreRelocaliser::reset()
   // Set up the predictions block if it hasn't been allocated yet.
   if(!m_relocaliserState->predictionsBlock)
   {
-    m_relocaliserState->predictionsBlock = MemoryBlockFactory::instance().make_block<ScorePrediction>(m_reservoirCount);
+    m_relocaliserState->predictionsBlock = MemoryBlockFactory::instance().make_block<ScorePrediction>(m_reservoirCount, "Relocalisation");
   }
 
   m_relocaliserState->exampleReservoirs->reset();
@@ -396,6 +374,48 @@ void ScoreRelocaliser::ensure_valid_leaf(uint32_t treeIdx, uint32_t leafIdx) con
   }
 }
 
+void ScoreRelocaliser::initialise(const ScoreForest_Ptr& forest, const std::string& settingsNamespace)
+{
+  // Determine the top-level parameters for the relocaliser.
+  m_maxRelocalisationsToOutput = m_settings->get_first_value<uint32_t>(settingsNamespace + "maxRelocalisationsToOutput", 1);
+  m_visualiseForest = m_settings->get_first_value<bool>(settingsNamespace + "visualiseForest", true);
+
+  // Determine the reservoir-related parameters.
+  m_maxReservoirsToUpdate = m_settings->get_first_value<uint32_t>(settingsNamespace + "maxReservoirsToUpdate", 256);  // Update the modes associated with this number of reservoirs for each train/update call.
+  m_reservoirCapacity = m_settings->get_first_value<uint32_t>(settingsNamespace + "reservoirCapacity", 1024);
+  m_rngSeed = m_settings->get_first_value<uint32_t>(settingsNamespace + "rngSeed", 42);
+
+  // Determine the clustering-related parameters (the defaults are tentative values that seem to work).
+  m_clustererSigma = m_settings->get_first_value<float>(settingsNamespace + "clustererSigma", 0.1f);
+  m_clustererTau = m_settings->get_first_value<float>(settingsNamespace + "clustererTau", 0.05f);
+  m_maxClusterCount = m_settings->get_first_value<uint32_t>(settingsNamespace + "maxClusterCount", ScorePrediction::Capacity);
+  m_minClusterSize = m_settings->get_first_value<uint32_t>(settingsNamespace + "minClusterSize", 20);
+
+  // Check that the maximum number of clusters to store in each leaf is within range.
+  if(m_maxClusterCount > ScorePrediction::Capacity)
+  {
+    throw std::invalid_argument(settingsNamespace + "maxClusterCount > ScorePrediction::Capacity");
+  }
+
+  // Allocate the internal images.
+  MemoryBlockFactory& mbf = MemoryBlockFactory::instance();
+  m_descriptorsImage = mbf.make_image<DescriptorType>(Vector2i(0, 0), "Relocalisation");
+  m_keypointsImage = mbf.make_image<ExampleType>(Vector2i(0, 0), "Relocalisation");
+  m_leafIndicesImage = mbf.make_image<LeafIndices>(Vector2i(0, 0), "Relocalisation");
+  m_predictionsImage = mbf.make_image<ScorePrediction>(Vector2i(0, 0), "Relocalisation");
+
+  // Instantiate the sub-components.
+  m_featureCalculator = FeatureCalculatorFactory::make_da_rgbd_patch_feature_calculator(m_deviceType);
+  m_preemptiveRansac = PreemptiveRansacFactory::make_preemptive_ransac(m_settings, settingsNamespace + "PreemptiveRansac.", m_deviceType);
+
+  m_scoreForest = forest;
+  m_reservoirCount = m_scoreForest->get_nb_leaves();
+
+  // Set up the relocaliser's internal state.
+  m_relocaliserState.reset(new ScoreRelocaliserState);
+  reset();
+}
+
 void ScoreRelocaliser::update_pixels_to_leaves_image(const ORFloatImage *depthImage) const
 {
 #ifdef WITH_OPENCV
@@ -6,8 +6,10 @@
 #ifndef H_ITMX_ASYNCIMAGESOURCEENGINE
 #define H_ITMX_ASYNCIMAGESOURCEENGINE
 
-#include <queue>
+#include <map>
+#include <vector>
 
+#include <boost/shared_ptr.hpp>
 #include <boost/thread.hpp>
 
 #include <orx/base/ORImagePtrTypes.h>
@@ -20,11 +22,19 @@ namespace itmx {
  * \brief An instance of this class can be used to read RGB-D images asynchronously from an existing image source.
  *        Images are read from the existing source on a separate thread and stored in an in-memory queue. This
  *        leads to lower latency when processing a disk sequence.
+ *
+ * If reading images from the existing source is expensive (e.g. because they need to be decoded from disk), the
+ * work can be spread over several grabber threads. In that case, each thread needs its own inner source, and the
+ * inner sources must interleave the frames of the sequence (i.e. the i'th of n sources must produce frames i, i+n,
+ * i+2n, ...). The frames are reordered as necessary so that they are always delivered in sequence order.
+ *
+ * Consumers that can work directly with the cached images can borrow them via borrow_images and hand them back
+ * via return_images, thereby avoiding the copy that getImages has to make into the caller's images.
  */
 class AsyncImageSourceEngine : public InputSource::ImageSourceEngine
 {
   //#################### NESTED TYPES ####################
-private:
+public:
   /**
    * \brief An instance of this struct can be used to represent an RGB-D image.
    */
@@ -42,46 +52,73 @@ private:
 
   //#################### PRIVATE VARIABLES ####################
 private:
-  /** The thread on which images are grabbed from the existing image source. */
-  boost::thread m_grabber;
+  /** The calibration to report when there are no images in the queue. */
+  ITMLib::ITMRGBDCalib m_calib;
+
+  /** The size of the depth images to report when there are no images in the queue. */
+  Vector2i m_depthImageSize;
+
+  /** The sequence number of the first frame that the inner sources were unable to produce (if known). */
+  size_t m_endSequenceNumber;
 
-  /** A flag set in the destructor to indicate that the image grabber should terminate. */
+  /** The threads on which images are grabbed from the inner sources (one per inner source). */
+  std::vector<boost::shared_ptr<boost::thread> > m_grabbers;
+
+  /** A flag set in the destructor to indicate that the image grabbers should terminate. */
   bool m_grabberShouldTerminate;
 
-  /** The image source from which to obtain the images to cache. */
-  ImageSourceEngine_Ptr m_innerSource;
+  /** The image sources from which to obtain the images to cache. */
+  std::vector<ImageSourceEngine_Ptr> m_innerSources;
+
+  /** A condition variable used to wait for the next image in the sequence to be added to the queue. */
+  mutable boost::condition_variable m_imageReady;
 
   /** The synchronisation mutex. */
   mutable boost::mutex m_mutex;
 
+  /** The sequence number of the next image to be delivered to the consumer. */
+  size_t m_nextSequenceNumber;
+
   /** A pool of reusable RGB-D images. */
-  std::queue<RGBDImage> m_pool;
+  std::vector<RGBDImage> m_pool;
 
   /** The maximum number of elements that can be stored in the RGB-D image pool. */
   size_t m_poolCapacity;
 
-  /** A queue in which to cache images from the inner source. */
-  std::queue<RGBDImage> m_queue;
+  /** A queue in which to cache images from the inner sources, keyed by sequence number (images may arrive out of order). */
+  std::map<size_t,RGBDImage> m_queue;
 
   /** The maximum number of images to cache. */
   size_t m_queueCapacity;
 
-  /** A condition variable used to wait for elements to be added to the queue. */
-  mutable boost::condition_variable m_queueNotEmpty;
+  /** The size of the RGB images to report when there are no images in the queue. */
+  Vector2i m_rgbImageSize;
 
-  /** A condition variable used to wait for elements to be removed from the queue. */
-  boost::condition_variable m_queueNotFull;
+  /** A condition variable used to wait for images to be removed from the queue. */
+  boost::condition_variable m_spaceAvailable;
 
   //#################### CONSTRUCTORS ####################
 public:
   /**
-   * \brief Constructs an asynchronous image source engine.
+   * \brief Constructs an asynchronous image source engine that grabs images from a single inner source.
    *
    * \param innerSource   The image source from which to obtain the images to cache.
    * \param queueCapacity The maximum number of images to cache (0 means no limit).
+   *
+   * \throws std::runtime_error If innerSource is NULL.
    */
   explicit AsyncImageSourceEngine(ImageSourceEngine *innerSource, size_t queueCapacity = 0);
 
+  /**
+   * \brief Constructs an asynchronous image source engine that grabs images from several interleaved inner sources in parallel.
+   *
+   * \param innerSources  The image sources from which to obtain the images to cache (the i'th of n sources must produce frames i, i+n, i+2n, ...).
+   * \param queueCapacity The maximum number of images to cache (0 means no limit).
+   *
+   * \throws std::runtime_error If innerSources is empty or contains a NULL source.
+   */
+  explicit AsyncImageSourceEngine(const std::vector<ImageSourceEngine*>& innerSources, size_t queueCapacity = 0);
+
   //#################### DESTRUCTOR ####################
 public:
   /**
@@ -89,8 +126,25 @@ public:
    */
   virtual ~AsyncImageSourceEngine();
 
+  //#################### COPY CONSTRUCTOR & ASSIGNMENT OPERATOR ####################
+private:
+  // Deliberately private and unimplemented.
+  AsyncImageSourceEngine(const AsyncImageSourceEngine&);
+  AsyncImageSourceEngine& operator=(const AsyncImageSourceEngine&);
+
   //#################### PUBLIC MEMBER FUNCTIONS ####################
 public:
+  /**
+   * \brief Removes the next RGB-D image from the queue and hands it to the caller without copying it.
+   *
+   * The caller should pass the image back via return_images once it has finished with it, so that its memory can be reused.
+   *
+   * \return  The next RGB-D image.
+   *
+   * \throws std::runtime_error If there are no more images available (make sure to call hasMoreImages first).
+   */
+  RGBDImage borrow_images();
+
   /** Override */
   virtual ITMLib::ITMRGBDCalib getCalib() const;
 
@@ -106,12 +160,26 @@ public:
   /** Override */
   virtual bool hasMoreImages() const;
 
+  /**
+   * \brief Hands an RGB-D image that was obtained from borrow_images back to the engine, so that its memory can be reused.
+   *
+   * \param rgbdImage The RGB-D image.
+   */
+  void return_images(const RGBDImage& rgbdImage);
+
   //#################### PRIVATE MEMBER FUNCTIONS ####################
 private:
   /**
-   * \brief Runs the image grabber.
+   * \brief Fills the RGB-D image pool and starts the image grabbers.
+   */
+  void initialise();
+
+  /**
+   * \brief Runs an image grabber.
+   *
+   * \param grabberIndex  The index of the grabber (and of the inner source from which it grabs images).
    */
-  void run_image_grabber();
+  void run_image_grabber(size_t grabberIndex);
 };
 
 }
@@ -0,0 +1,193 @@
+/**
+ * itmx: RGBDSequenceImageSourceEngine.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#ifndef H_ITMX_RGBDSEQUENCEIMAGESOURCEENGINE
+#define H_ITMX_RGBDSEQUENCEIMAGESOURCEENGINE
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/optional.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+
+#include <InputSource/ImageSourceEngine.h>
+
+#include "../persistence/RGBDSequenceFormat.h"
+
+namespace itmx {
+
+/**
+ * \brief An instance of this class can be used to read RGB-D images from a chunked sequence file (see RGBDSequenceFormat).
+ *
+ * The file is memory-mapped, and the chunks are decompressed ahead of the current frame by a set of decoder threads,
+ * so that several chunks can be decoded in parallel. Since the file contains an index, the engine can seek to any frame.
+ */
+class RGBDSequenceImageSourceEngine : public InputSource::ImageSourceEngine
+{
+  //#################### TYPEDEFS ####################
+private:
+  typedef boost::shared_ptr<const std::vector<unsigned char> > Payload_CPtr;
+
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** The calibration of the camera that captured the sequence. */
+  ITMLib::ITMRGBDCalib m_calib;
+
+  /** A condition variable used to wait for a chunk to be decoded. */
+  boost::condition_variable m_chunkDecoded;
+
+  /** The chunk index. */
+  std::vector<RGBDSequenceFormat::ChunkIndexEntry> m_chunkIndex;
+
+  /** The indices of the chunks that are currently being decoded. */
+  std::set<size_t> m_chunksBeingDecoded;
+
+  /** The index of the next frame to be returned by getImages. */
+  size_t m_currentFrame;
+
+  /** The error (if any) that occurred while decoding a chunk. */
+  std::string m_decodeError;
+
+  /** The decoded chunks that are currently cached, indexed by chunk index. */
+  std::map<size_t,Payload_CPtr> m_decodedChunks;
+
+  /** The threads on which chunks are decoded. */
+  boost::thread_group m_decoders;
+
+  /** The size of the depth images in the sequence. */
+  Vector2i m_depthImageSize;
+
+  /** The memory-mapped file. */
+  boost::interprocess::file_mapping m_file;
+
+  /** The size (in bytes) of a single frame in an uncompressed chunk. */
+  size_t m_frameSize;
+
+  /** The synchronisation mutex. */
+  mutable boost::mutex m_mutex;
+
+  /** The pose records for the frames in the sequence. */
+  std::vector<RGBDSequenceFormat::PoseRecord> m_poses;
+
+  /** The number of chunks beyond the current one that should be decoded ahead of time. */
+  size_t m_prefetchChunkCount;
+
+  /** The mapping of the file into memory. */
+  boost::interprocess::mapped_region m_region;
+
+  /** The size of the RGB images in the sequence. */
+  Vector2i m_rgbImageSize;
+
+  /** A flag set in the destructor to indicate that the decoders should terminate. */
+  bool m_shouldTerminate;
+
+  /** A condition variable used to wake the decoders when there may be more chunks to decode. */
+  boost::condition_variable m_workAvailable;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Constructs an image source engine that reads RGB-D images from a chunked sequence file.
+   *
+   * \param path                The path to the sequence file.
+   * \param prefetchChunkCount  The number of chunks beyond the current one that should be decoded ahead of time.
+   * \param decoderCount        The number of threads on which to decode chunks.
+   *
+   * \throws std::runtime_error If the file cannot be opened or is not a valid sequence file.
+   */
+  explicit RGBDSequenceImageSourceEngine(const std::string& path, size_t prefetchChunkCount = 2, size_t decoderCount = 2);
+
+  //#################### DESTRUCTOR ####################
+public:
+  /**
+   * \brief Destroys the image source engine.
+   */
+  virtual ~RGBDSequenceImageSourceEngine();
+
+  //#################### COPY CONSTRUCTOR & ASSIGNMENT OPERATOR ####################
+private:
+  // Deliberately private and unimplemented.
+  RGBDSequenceImageSourceEngine(const RGBDSequenceImageSourceEngine&);
+  RGBDSequenceImageSourceEngine& operator=(const RGBDSequenceImageSourceEngine&);
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /** Override */
+  virtual ITMLib::ITMRGBDCalib getCalib() const;
+
+  /** Override */
+  virtual Vector2i getDepthImageSize() const;
+
+  /** Override */
+  virtual void getImages(ORUChar4Image *rgb, ORShortImage *rawDepth);
+
+  /** Override */
+  virtual Vector2i getRGBImageSize() const;
+
+  /** Override */
+  virtual bool hasMoreImages() const;
+
+  /**
+   * \brief Gets the index of the next frame that will be returned by getImages.
+   *
+   * \return  The index of the next frame that will be returned by getImages.
+   */
+  size_t get_current_frame() const;
+
+  /**
+   * \brief Gets the number of frames in the sequence.
+   *
+   * \return  The number of frames in the sequence.
+   */
+  size_t get_frame_count() const;
+
+  /**
+   * \brief Gets the camera pose stored for the specified frame (if any).
+   *
+   * \param frameIndex  The index of the frame.
+   * \return            The camera pose stored for the frame, if any, or boost::none otherwise.
+   *
+   * \throws std::out_of_range  If the frame index is out of range.
+   */
+  boost::optional<Matrix4f> get_pose(size_t frameIndex) const;
+
+  /**
+   * \brief Moves to the specified frame, so that it will be the next frame returned by getImages.
+   *
+   * \param frameIndex  The index of the frame (this may be equal to the number of frames, to move to the end of the sequence).
+   *
+   * \throws std::out_of_range  If the frame index is out of range.
+   */
+  void seek(size_t frameIndex);
+
+  //#################### PRIVATE MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Determines the index of the chunk containing the specified frame.
+   *
+   * \param frameIndex  The index of the frame.
+   * \return            The index of the chunk containing the frame.
+   */
+  size_t find_chunk(size_t frameIndex) const;
+
+  /**
+   * \brief Evicts any decoded chunks that are no longer needed and wakes the decoders (the caller must hold the mutex).
+   */
+  void update_prefetch_window();
+
+  /**
+   * \brief Runs a decoder thread.
+   */
+  void run_decoder();
+};
+
+}
+
+#endif
@@ -35,8 +35,50 @@ public:
     IFT_UNKNOWN
   };
 
+  /**
+   * \brief The values of this enumeration represent the supported PNG compression modes.
+   */
+  enum PNGCompression
+  {
+    /** Compress as tightly as lodepng's default settings allow. */
+    PC_DEFAULT,
+
+    /** Compress quickly at the expense of a slightly larger file (e.g. for recording sequences live). */
+    PC_FAST
+  };
+
   //#################### PUBLIC STATIC MEMBER FUNCTIONS ####################
 public:
+  /**
+   * \brief Decodes a buffer in RGBA PNG format into an image.
+   *
+   * \param buffer              The buffer to decode.
+   * \param path                The name of the file from which the buffer was originally loaded (if known).
+   * \return                    The decoded image.
+   * \throws std::runtime_error If the buffer could not be decoded.
+   */
+  static ORUChar4Image_Ptr decode_rgba_png(const std::vector<unsigned char>& buffer, const std::string& path = "");
+
+  /**
+   * \brief Encodes a short image in (16-bit greyscale) PNG format and writes it into a buffer.
+   *
+   * \param image               The image to encode.
+   * \param buffer              The buffer into which to write the encoded image.
+   * \param compression         The PNG compression mode to use.
+   * \throws std::runtime_error If the image could not be encoded.
+   */
+  static void encode_png(const ORShortImage_CPtr& image, std::vector<unsigned char>& buffer, PNGCompression compression = PC_DEFAULT);
+
+  /**
+   * \brief Encodes an RGBA image in PNG format and writes it into a buffer.
+   *
+   * \param image               The image to encode.
+   * \param buffer              The buffer into which to write the encoded image.
+   * \param compression         The PNG compression mode to use.
+   * \throws std::runtime_error If the image could not be encoded.
+   */
+  static void encode_png(const ORUChar4Image_CPtr& image, std::vector<unsigned char>& buffer, PNGCompression compression = PC_DEFAULT);
+
   /**
    * \brief Attempts to load an RGBA image from a file.
    *
@@ -53,9 +95,10 @@ public:
    * \param image               The image to save.
    * \param path                The path to the file to which to save it.
    * \param fileType            The image file type.
+   * \param compression         The PNG compression mode to use (if the image is saved in PNG format).
    * \throws std::runtime_error If the image could not be saved.
    */
-  static void save_image(const ORShortImage_CPtr& image, const std::string& path, ImageFileType fileType = IFT_UNKNOWN);
+  static void save_image(const ORShortImage_CPtr& image, const std::string& path, ImageFileType fileType = IFT_UNKNOWN, PNGCompression compression = PC_DEFAULT);
 
   /**
    * \brief Attempts to save an RGBA image to a file.
@@ -63,9 +106,10 @@ public:
    * \param image               The image to save.
    * \param path                The path to the file to which to save it.
    * \param fileType            The image file type.
+   * \param compression         The PNG compression mode to use (if the image is saved in PNG format).
    * \throws std::runtime_error If the image could not be saved.
    */
-  static void save_image(const ORUChar4Image_CPtr& image, const std::string& path, ImageFileType fileType = IFT_UNKNOWN);
+  static void save_image(const ORUChar4Image_CPtr& image, const std::string& path, ImageFileType fileType = IFT_UNKNOWN, PNGCompression compression = PC_DEFAULT);
 
   /**
    * \brief Attempts to save an image to a file on a separate thread.
@@ -75,12 +119,13 @@ public:
    * \param image               The image to save.
    * \param path                The path to the file to which to save it.
    * \param fileType            The image file type.
+   * \param compression         The PNG compression mode to use (if the image is saved in PNG format).
    * \throws std::runtime_error If the image could not be saved.
    */
   template <typename T>
-  static void save_image_on_thread(const boost::shared_ptr<ORUtils::Image<T> >& image, const std::string& path, ImageFileType fileType = IFT_UNKNOWN)
+  static void save_image_on_thread(const boost::shared_ptr<ORUtils::Image<T> >& image, const std::string& path, ImageFileType fileType = IFT_UNKNOWN, PNGCompression compression = PC_DEFAULT)
   {
-    save_image_on_thread(boost::shared_ptr<const ORUtils::Image<T> >(image), path, fileType);
+    save_image_on_thread(boost::shared_ptr<const ORUtils::Image<T> >(image), path, fileType, compression);
   }
 
   /**
@@ -89,13 +134,14 @@ public:
    * \param image               The image to save.
    * \param path                The path to the file to which to save it.
    * \param fileType            The image file type.
+   * \param compression         The PNG compression mode to use (if the image is saved in PNG format).
    * \throws std::runtime_error If the image could not be saved.
    */
   template <typename T>
-  static void save_image_on_thread(const boost::shared_ptr<const ORUtils::Image<T> >& image, const std::string& path, ImageFileType fileType = IFT_UNKNOWN)
+  static void save_image_on_thread(const boost::shared_ptr<const ORUtils::Image<T> >& image, const std::string& path, ImageFileType fileType = IFT_UNKNOWN, PNGCompression compression = PC_DEFAULT)
   {
-    void (*p)(const boost::shared_ptr<const ORUtils::Image<T> >&, const std::string&, ImageFileType) = &save_image;
-    tvgutil::ThreadPool::instance().post_task(boost::bind(p, image, path, fileType));
+    void (*p)(const boost::shared_ptr<const ORUtils::Image<T> >&, const std::string&, ImageFileType, PNGCompression) = &save_image;
+    tvgutil::ThreadPool::instance().post_task(boost::bind(p, image, path, fileType, compression));
   }
 
   /**
@@ -106,12 +152,13 @@ public:
    * \param image               The image to save.
    * \param path                The path to the file to which to save it.
    * \param fileType            The image file type.
+   * \param compression         The PNG compression mode to use (if the image is saved in PNG format).
    * \throws std::runtime_error If the image could not be saved.
    */
   template <typename T>
-  static void save_image_on_thread(const boost::shared_ptr<ORUtils::Image<T> >& image, const boost::filesystem::path& path, ImageFileType fileType = IFT_UNKNOWN)
+  static void save_image_on_thread(const boost::shared_ptr<ORUtils::Image<T> >& image, const boost::filesystem::path& path, ImageFileType fileType = IFT_UNKNOWN, PNGCompression compression = PC_DEFAULT)
   {
-    save_image_on_thread(image, path.string(), fileType);
+    save_image_on_thread(image, path.string(), fileType, compression);
   }
 
   /**
@@ -120,25 +167,17 @@ public:
    * \param image               The image to save.
    * \param path                The path to the file to which to save it.
    * \param fileType            The image file type.
+   * \param compression         The PNG compression mode to use (if the image is saved in PNG format).
    * \throws std::runtime_error If the image could not be saved.
    */
   template <typename T>
-  static void save_image_on_thread(const boost::shared_ptr<const ORUtils::Image<T> >& image, const boost::filesystem::path& path, ImageFileType fileType = IFT_UNKNOWN)
+  static void save_image_on_thread(const boost::shared_ptr<const ORUtils::Image<T> >& image, const boost::filesystem::path& path, ImageFileType fileType = IFT_UNKNOWN, PNGCompression compression = PC_DEFAULT)
   {
-    save_image_on_thread(image, path.string(), fileType);
+    save_image_on_thread(image, path.string(), fileType, compression);
   }
 
   //#################### PRIVATE STATIC MEMBER FUNCTIONS ####################
 private:
-  /**
-   * \brief Decodes a buffer in RGBA PNG format into an image.
-   *
-   * \param buffer  The buffer to decode.
-   * \param path    The name of the file from which the buffer was originally loaded (if known).
-   * \return        The decoded image.
-   */
-  static ORUChar4Image_Ptr decode_rgba_png(const std::vector<unsigned char>& buffer, const std::string& path);
-
   /**
    * \brief Attempts to deduce an image file's type based on its file extension.
    *
@@ -148,20 +187,18 @@ private:
   static ImageFileType deduce_image_file_type(const std::string& path);
 
   /**
-   * \brief Encodes a short image in PNG format and writes it into a buffer.
-   *
-   * \param image   The image to encode.
-   * \param buffer  The buffer into which to write the encoded image.
-   */
-  static void encode_png(const ORShortImage_CPtr& image, std::vector<unsigned char>& buffer);
-
-  /**
-   * \brief Encodes an RGBA image in PNG format and writes it into a buffer.
+   * \brief Encodes raw pixel data (already in PNG's in-memory layout) in PNG format and writes it into a buffer.
    *
-   * \param image   The image to encode.
-   * \param buffer  The buffer into which to write the encoded image.
+   * \param data                The pixel data.
+   * \param size                The size of the image.
+   * \param channelCount        The number of channels per pixel (1 for greyscale, 4 for RGBA).
+   * \param bitDepth            The number of bits per channel.
+   * \param compression         The PNG compression mode to use.
+   * \param buffer              The buffer into which to write the encoded image.
+   * \throws std::runtime_error If the data could not be encoded.
    */
-  static void encode_png(const ORUChar4Image_CPtr& image, std::vector<unsigned char>& buffer);
+  static void encode_png_data(const unsigned char *data, const Vector2i& size, unsigned int channelCount, unsigned int bitDepth,
+                              PNGCompression compression, std::vector<unsigned char>& buffer);
 };
 
 }
@@ -15,12 +15,30 @@
 namespace itmx {
 
 /**
- * \brief This class contains utility functions for saving camera poses.
+ * \brief This class contains utility functions for saving and loading camera poses.
  */
 class PosePersister
 {
   //#################### PUBLIC STATIC MEMBER FUNCTIONS ####################
 public:
+  /**
+   * \brief Attempts to load a camera pose from a file written by save_pose.
+   *
+   * \param path                The path to the file from which to load it.
+   * \return                    The loaded pose matrix.
+   * \throws std::runtime_error If the pose could not be loaded.
+   */
+  static Matrix4f load_pose(const std::string& path);
+
+  /**
+   * \brief Attempts to load a camera pose from a file written by save_pose.
+   *
+   * \param path                The path to the file from which to load it.
+   * \return                    The loaded pose matrix.
+   * \throws std::runtime_error If the pose could not be loaded.
+   */
+  static Matrix4f load_pose(const boost::filesystem::path& path);
+
   /**
    * \brief Attempts to save a camera pose to a file.
    *
@@ -0,0 +1,160 @@
+/**
+ * itmx: RGBDSequenceFormat.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#ifndef H_ITMX_RGBDSEQUENCEFORMAT
+#define H_ITMX_RGBDSEQUENCEFORMAT
+
+#include <vector>
+
+#include <boost/cstdint.hpp>
+
+#include <ORUtils/Math.h>
+
+namespace itmx {
+
+/**
+ * \brief This class contains the definitions and utility functions that describe the layout of a chunked RGB-D sequence file.
+ *
+ * An RGB-D sequence file (conventionally with the extension .rgbds) stores an entire disk sequence in a single file:
+ *
+ * - A file header, followed by the camera calibration (in the text format used by InfiniTAM's calibration files).
+ * - A sequence of chunks, each of which consists of a chunk header followed by a compressed payload containing the
+ *   depth and RGB images for a run of consecutive frames.
+ * - A footer containing an index entry for each chunk (so that a reader can seek to any frame without scanning the file),
+ *   followed by a pose record for each frame, followed by a fixed-size trailer that locates the footer.
+ *
+ * All of the fields are stored in little-endian byte order. Within an uncompressed chunk payload, each frame is stored as
+ * its depth image (row-major, 16 bits per pixel) followed by its RGBA image (row-major, 32 bits per pixel). Before the
+ * payload is compressed, each row is delta-encoded (per channel) to make it more compressible.
+ */
+class RGBDSequenceFormat
+{
+  //#################### NESTED TYPES ####################
+public:
+  /**
+   * \brief The header at the start of the file (followed immediately by calibSize bytes of calibration text).
+   */
+  struct FileHeader
+  {
+    char magic[8];
+    boost::uint32_t version;
+    boost::int32_t depthWidth;
+    boost::int32_t depthHeight;
+    boost::int32_t rgbWidth;
+    boost::int32_t rgbHeight;
+    boost::uint32_t calibSize;
+  };
+
+  /**
+   * \brief The header at the start of each chunk (followed immediately by compressedSize bytes of compressed payload).
+   */
+  struct ChunkHeader
+  {
+    boost::uint32_t magic;
+    boost::uint32_t firstFrame;
+    boost::uint32_t frameCount;
+    boost::uint32_t reserved;
+    boost::uint64_t compressedSize;
+    boost::uint64_t uncompressedSize;
+  };
+
+  /**
+   * \brief An entry in the chunk index.
+   */
+  struct ChunkIndexEntry
+  {
+    boost::uint64_t offset;
+    boost::uint32_t firstFrame;
+    boost::uint32_t frameCount;
+  };
+
+  /**
+   * \brief The pose record for a frame.
+   */
+  struct PoseRecord
+  {
+    boost::uint32_t hasPose;
+    float m[16];
+  };
+
+  /**
+   * \brief The trailer at the very end of the file.
+   */
+  struct FooterTrailer
+  {
+    boost::uint64_t indexOffset;
+    boost::uint64_t chunkCount;
+    boost::uint64_t frameCount;
+    char magic[8];
+  };
+
+  //#################### CONSTANTS ####################
+public:
+  /** The magic value stored at the start of each chunk header. */
+  static const boost::uint32_t CHUNK_MAGIC = 0x4b4e4843; // "CHNK"
+
+  /** The magic value stored at the start of the file header. */
+  static const char FILE_MAGIC[8];
+
+  /** The magic value stored at the end of the footer trailer. */
+  static const char FOOTER_MAGIC[8];
+
+  /** The current version of the format. */
+  static const boost::uint32_t VERSION = 1;
+
+  //#################### PUBLIC STATIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Compresses the uncompressed payload of a chunk (note that this delta-encodes the payload in place).
+   *
+   * \param payload         The uncompressed payload (which will be delta-encoded in place).
+   * \param depthImageSize  The size of the depth images in the sequence.
+   * \param rgbImageSize    The size of the RGB images in the sequence.
+   * \param compressed      A vector into which to write the compressed payload.
+   *
+   * \throws std::runtime_error If the payload could not be compressed.
+   */
+  static void compress_chunk(std::vector<unsigned char>& payload, const Vector2i& depthImageSize, const Vector2i& rgbImageSize, std::vector<unsigned char>& compressed);
+
+  /**
+   * \brief Decompresses the compressed payload of a chunk.
+   *
+   * \param compressed        A pointer to the compressed payload.
+   * \param compressedSize    The size (in bytes) of the compressed payload.
+   * \param uncompressedSize  The expected size (in bytes) of the uncompressed payload.
+   * \param depthImageSize    The size of the depth images in the sequence.
+   * \param rgbImageSize      The size of the RGB images in the sequence.
+   * \param payload           A vector into which to write the uncompressed payload.
+   *
+   * \throws std::runtime_error If the payload could not be decompressed.
+   */
+  static void decompress_chunk(const unsigned char *compressed, size_t compressedSize, size_t uncompressedSize,
+                               const Vector2i& depthImageSize, const Vector2i& rgbImageSize, std::vector<unsigned char>& payload);
+
+  /**
+   * \brief Gets the size (in bytes) of a single frame in an uncompressed chunk payload.
+   *
+   * \param depthImageSize  The size of the depth images in the sequence.
+   * \param rgbImageSize    The size of the RGB images in the sequence.
+   * \return                The size (in bytes) of a single frame in an uncompressed chunk payload.
+   */
+  static size_t frame_size(const Vector2i& depthImageSize, const Vector2i& rgbImageSize);
+
+  //#################### PRIVATE STATIC MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Delta-encodes or -decodes the rows of every frame in an uncompressed chunk payload, in place.
+   *
+   * \param payload         The payload.
+   * \param depthImageSize  The size of the depth images in the sequence.
+   * \param rgbImageSize    The size of the RGB images in the sequence.
+   * \param encode          Whether to encode (true) or decode (false).
+   */
+  static void delta_code(std::vector<unsigned char>& payload, const Vector2i& depthImageSize, const Vector2i& rgbImageSize, bool encode);
+};
+
+}
+
+#endif
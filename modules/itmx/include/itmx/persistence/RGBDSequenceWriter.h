@@ -0,0 +1,167 @@
+/**
+ * itmx: RGBDSequenceWriter.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#ifndef H_ITMX_RGBDSEQUENCEWRITER
+#define H_ITMX_RGBDSEQUENCEWRITER
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <boost/optional.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+
+#include <ITMLib/Objects/Camera/ITMRGBDCalib.h>
+
+#include <orx/base/ORImagePtrTypes.h>
+
+#include "RGBDSequenceFormat.h"
+
+namespace itmx {
+
+/**
+ * \brief An instance of this class can be used to write an RGB-D sequence to a single chunked sequence file (see RGBDSequenceFormat).
+ *
+ * Frames are accumulated into chunks on the caller's thread. Each full chunk is then compressed and appended to the file on a
+ * separate thread, so that the caller (e.g. a live recording) is only held up if it produces frames faster than they can be
+ * compressed. The footer (containing the chunk index and the poses) is written when the writer is closed.
+ */
+class RGBDSequenceWriter
+{
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** A condition variable used to signal changes to the pending chunk. */
+  boost::condition_variable m_chunkChanged;
+
+  /** The index entries for the chunks that have been written so far. */
+  std::vector<RGBDSequenceFormat::ChunkIndexEntry> m_chunkIndex;
+
+  /** The thread on which full chunks are compressed and written to the file. */
+  boost::thread m_chunkWriter;
+
+  /** Whether or not the writer has been closed. */
+  bool m_closed;
+
+  /** The chunk that is currently being filled by the caller. */
+  std::vector<unsigned char> m_currentChunk;
+
+  /** The number of frames in the chunk that is currently being filled. */
+  size_t m_currentChunkFrameCount;
+
+  /** The size of the depth images in the sequence. */
+  Vector2i m_depthImageSize;
+
+  /** The size (in bytes) of a single frame in an uncompressed chunk. */
+  size_t m_frameSize;
+
+  /** The number of frames in each chunk (except possibly the last). */
+  size_t m_framesPerChunk;
+
+  /** The synchronisation mutex. */
+  boost::mutex m_mutex;
+
+  /** The output stream for the file. */
+  std::ofstream m_os;
+
+  /** A full chunk that is waiting to be compressed and written (if any). */
+  std::vector<unsigned char> m_pendingChunk;
+
+  /** The index of the first frame in the pending chunk. */
+  size_t m_pendingChunkFirstFrame;
+
+  /** The number of frames in the pending chunk (0 if there is no pending chunk). */
+  size_t m_pendingChunkFrameCount;
+
+  /** The pose records for the frames that have been added so far. */
+  std::vector<RGBDSequenceFormat::PoseRecord> m_poses;
+
+  /** The size of the RGB images in the sequence. */
+  Vector2i m_rgbImageSize;
+
+  /** Whether or not the chunk writer should terminate once it has written any pending chunk. */
+  bool m_shouldTerminate;
+
+  /** The error (if any) that occurred on the chunk writer thread. */
+  std::string m_writeError;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Constructs an RGB-D sequence writer.
+   *
+   * \param path            The path of the sequence file to write.
+   * \param calib           The calibration of the camera that captured the sequence.
+   * \param rgbImageSize    The size of the RGB images in the sequence.
+   * \param depthImageSize  The size of the depth images in the sequence.
+   * \param framesPerChunk  The number of frames to store in each chunk.
+   *
+   * \throws std::runtime_error If the file cannot be opened for writing.
+   */
+  RGBDSequenceWriter(const std::string& path, const ITMLib::ITMRGBDCalib& calib, const Vector2i& rgbImageSize,
+                     const Vector2i& depthImageSize, size_t framesPerChunk = 30);
+
+  //#################### DESTRUCTOR ####################
+public:
+  /**
+   * \brief Destroys the writer, closing it first if necessary.
+   */
+  ~RGBDSequenceWriter();
+
+  //#################### COPY CONSTRUCTOR & ASSIGNMENT OPERATOR ####################
+private:
+  // Deliberately private and unimplemented.
+  RGBDSequenceWriter(const RGBDSequenceWriter&);
+  RGBDSequenceWriter& operator=(const RGBDSequenceWriter&);
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Writes any partially-filled chunk and the footer, and closes the file.
+   *
+   * \throws std::runtime_error If any part of the sequence could not be written.
+   */
+  void close();
+
+  /**
+   * \brief Gets the number of frames that have been added to the sequence so far.
+   *
+   * \return  The number of frames that have been added to the sequence so far.
+   */
+  size_t get_frame_count() const;
+
+  /**
+   * \brief Adds a frame to the sequence.
+   *
+   * \param rgb   The RGB image for the frame (its size must match the RGB image size of the sequence).
+   * \param depth The depth image for the frame (its size must match the depth image size of the sequence).
+   * \param pose  The camera pose for the frame (if known).
+   *
+   * \throws std::invalid_argument  If the size of either image does not match the corresponding image size of the sequence.
+   * \throws std::runtime_error     If the writer has been closed, or if an earlier chunk could not be written.
+   */
+  void write_frame(const ORUChar4Image_CPtr& rgb, const ORShortImage_CPtr& depth, const boost::optional<Matrix4f>& pose = boost::none);
+
+  //#################### PRIVATE MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Hands the current chunk over to the chunk writer (waiting for any previous pending chunk to be written first).
+   */
+  void flush_current_chunk();
+
+  /**
+   * \brief Runs the chunk writer.
+   */
+  void run_chunk_writer();
+};
+
+//#################### TYPEDEFS ####################
+
+typedef boost::shared_ptr<RGBDSequenceWriter> RGBDSequenceWriter_Ptr;
+typedef boost::shared_ptr<const RGBDSequenceWriter> RGBDSequenceWriter_CPtr;
+
+}
+
+#endif
@@ -0,0 +1,290 @@
+/**
+ * itmx: SequenceRecorder.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#ifndef H_ITMX_SEQUENCERECORDER
+#define H_ITMX_SEQUENCERECORDER
+
+#include <deque>
+#include <map>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+
+#include <ORUtils/Math.h>
+
+#include <orx/base/ORImagePtrTypes.h>
+
+#include "../base/ITMObjectPtrTypes.h"
+
+namespace itmx {
+
+/**
+ * \brief An instance of this class can be used to save a sequence of frames (sets of images and poses) to disk in the background.
+ *
+ * Frames are copied into a fixed-size pool of frame buffers and then handed to a fixed number of encoder threads, so the memory
+ * used by the recorder is bounded no matter how slowly the frames are encoded. If no buffer is free when a new frame arrives,
+ * the recorder either drops the frame or blocks the caller until a buffer becomes free, depending on its overflow policy.
+ *
+ * Each file is written under a temporary name and only renamed to its final name once all of the frames before it have been
+ * written. Files therefore appear on disk in frame order, and a file with its final name is always complete.
+ */
+class SequenceRecorder
+{
+  //#################### ENUMERATIONS ####################
+public:
+  /**
+   * \brief The values of this enumeration denote the things the recorder can do when a frame arrives and no buffer is free.
+   */
+  enum OverflowPolicy
+  {
+    /** Block the caller until a buffer becomes free. */
+    OP_BLOCK,
+
+    /** Drop the frame. */
+    OP_DROP
+  };
+
+  //#################### NESTED TYPES ####################
+public:
+  /**
+   * \brief An instance of this class represents a buffer into which the contents of a frame can be copied prior to saving.
+   */
+  class Frame
+  {
+    friend class SequenceRecorder;
+
+    //~~~~~~~~~~~~~~~~~~~~ PRIVATE VARIABLES ~~~~~~~~~~~~~~~~~~~~
+  private:
+    /** The number of depth images that have been added to the frame. */
+    size_t m_depthImageCount;
+
+    /** The paths to which to save the depth images. */
+    std::vector<boost::filesystem::path> m_depthImagePaths;
+
+    /** The depth image buffers (the first m_depthImageCount of which are in use). */
+    std::vector<ORShortImage_Ptr> m_depthImages;
+
+    /** The paths to which to save the poses. */
+    std::vector<boost::filesystem::path> m_posePaths;
+
+    /** The poses. */
+    std::vector<Matrix4f> m_poses;
+
+    /** The number of RGB images that have been added to the frame. */
+    size_t m_rgbImageCount;
+
+    /** The paths to which to save the RGB images. */
+    std::vector<boost::filesystem::path> m_rgbImagePaths;
+
+    /** The RGB image buffers (the first m_rgbImageCount of which are in use). */
+    std::vector<ORUChar4Image_Ptr> m_rgbImages;
+
+    /** The position of the frame in the sequence of frames submitted to the recorder. */
+    size_t m_sequenceNumber;
+
+    //~~~~~~~~~~~~~~~~~~~~ CONSTRUCTORS ~~~~~~~~~~~~~~~~~~~~
+  private:
+    /**
+     * \brief Constructs an empty frame buffer.
+     */
+    Frame();
+
+    //~~~~~~~~~~~~~~~~~~~~ PUBLIC MEMBER FUNCTIONS ~~~~~~~~~~~~~~~~~~~~
+  public:
+    /**
+     * \brief Copies a depth image into the frame.
+     *
+     * \param image The depth image.
+     * \param path  The path to which to save the depth image.
+     */
+    void add_image(const ORShortImage_CPtr& image, const boost::filesystem::path& path);
+
+    /**
+     * \brief Copies an RGB image into the frame.
+     *
+     * \param image The RGB image.
+     * \param path  The path to which to save the RGB image.
+     */
+    void add_image(const ORUChar4Image_CPtr& image, const boost::filesystem::path& path);
+
+    /**
+     * \brief Adds a pose to the frame.
+     *
+     * \param pose  The pose.
+     * \param path  The path to which to save the pose.
+     */
+    void add_pose(const Matrix4f& pose, const boost::filesystem::path& path);
+
+    //~~~~~~~~~~~~~~~~~~~~ PRIVATE MEMBER FUNCTIONS ~~~~~~~~~~~~~~~~~~~~
+  private:
+    /**
+     * \brief Gets the paths of all of the files that will be written when the frame is saved.
+     *
+     * \return  The paths of all of the files that will be written when the frame is saved.
+     */
+    std::vector<boost::filesystem::path> get_paths() const;
+
+    /**
+     * \brief Clears the frame so that it can be reused (the image buffers are retained).
+     */
+    void reset();
+
+    /**
+     * \brief Saves the contents of the frame to their temporary paths.
+     */
+    void save() const;
+  };
+
+  typedef boost::shared_ptr<Frame> Frame_Ptr;
+
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** The number of frames that have been dropped because no buffer was free. */
+  size_t m_droppedFrameCount;
+
+  /** The threads on which frames are encoded and saved. */
+  boost::thread_group m_encoders;
+
+  /** The frames that are waiting to be saved, in the order in which they were submitted. */
+  std::deque<Frame_Ptr> m_encodeQueue;
+
+  /** The frames that have been saved but not yet finalised, keyed by sequence number. */
+  std::map<size_t,Frame_Ptr> m_encodedFrames;
+
+  /** A mutex used to ensure that only one thread finalises frames at a time (so that they are finalised in order). */
+  boost::mutex m_finalisationMutex;
+
+  /** The frame buffers that are currently free. */
+  std::vector<Frame_Ptr> m_freeFrames;
+
+  /** A condition variable used to wait for a frame buffer to become free. */
+  boost::condition_variable m_frameFreed;
+
+  /** A condition variable used to wait for a frame to be submitted (or for the recorder to be destroyed). */
+  boost::condition_variable m_frameSubmitted;
+
+  /** The synchronisation mutex. */
+  mutable boost::mutex m_mutex;
+
+  /** The sequence number of the next frame to be finalised. */
+  size_t m_nextFinalisedSequenceNumber;
+
+  /** The sequence number to give to the next frame that is submitted. */
+  size_t m_nextSequenceNumber;
+
+  /** What the recorder should do when a frame arrives and no buffer is free. */
+  OverflowPolicy m_overflowPolicy;
+
+  /** A flag set in the destructor to indicate that the encoders should terminate once they have saved all of the submitted frames. */
+  bool m_shouldTerminate;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Constructs a sequence recorder.
+   *
+   * \param frameBufferCount  The number of frame buffers (this bounds the number of frames that can be waiting to be saved).
+   * \param encoderCount      The number of threads on which to encode and save frames.
+   * \param overflowPolicy    What the recorder should do when a frame arrives and no buffer is free.
+   *
+   * \throws std::invalid_argument  If frameBufferCount or encoderCount is zero.
+   */
+  SequenceRecorder(size_t frameBufferCount = 8, size_t encoderCount = 2, OverflowPolicy overflowPolicy = OP_DROP);
+
+  //#################### DESTRUCTOR ####################
+public:
+  /**
+   * \brief Destroys the sequence recorder.
+   *
+   * \note  This blocks until all of the frames that have been submitted have been saved.
+   */
+  ~SequenceRecorder();
+
+  //#################### COPY CONSTRUCTOR & ASSIGNMENT OPERATOR ####################
+private:
+  // Deliberately private and unimplemented.
+  SequenceRecorder(const SequenceRecorder&);
+  SequenceRecorder& operator=(const SequenceRecorder&);
+
+  //#################### PUBLIC STATIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Makes a sequence recorder that is configured using the "SequenceRecorder.*" settings (if present).
+   *
+   * \param settings  The settings.
+   * \return          The sequence recorder.
+   */
+  static boost::shared_ptr<SequenceRecorder> make_from_settings(const Settings_CPtr& settings);
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Attempts to get a free frame buffer into which the caller can copy the contents of a new frame.
+   *
+   * If this succeeds, the caller must pass the frame to submit_frame once it has filled it.
+   *
+   * \return  The frame buffer, or NULL if no buffer was free and the frame was dropped.
+   */
+  Frame_Ptr begin_frame();
+
+  /**
+   * \brief Blocks until all of the frames that have been submitted so far have been saved and finalised.
+   */
+  void flush();
+
+  /**
+   * \brief Gets the number of frames that have been dropped because no buffer was free.
+   *
+   * \return  The number of frames that have been dropped because no buffer was free.
+   */
+  size_t get_dropped_frame_count() const;
+
+  /**
+   * \brief Gets the number of frames that have been submitted but not yet finalised.
+   *
+   * \return  The number of frames that have been submitted but not yet finalised.
+   */
+  size_t get_queue_depth() const;
+
+  /**
+   * \brief Submits a frame obtained from begin_frame so that it can be saved.
+   *
+   * \param frame The frame.
+   */
+  void submit_frame(const Frame_Ptr& frame);
+
+  //#################### PRIVATE MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Renames the files of any saved frames that are next in sequence to their final paths, and frees their buffers.
+   */
+  void finalise_frames();
+
+  /**
+   * \brief Runs an encoder thread.
+   */
+  void run_encoder();
+
+  //#################### PRIVATE STATIC MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Makes the temporary path to which to write a file before it is finalised.
+   *
+   * \param path  The final path of the file.
+   * \return      The temporary path (a hidden file in the same directory, with the same extension).
+   */
+  static boost::filesystem::path make_temporary_path(const boost::filesystem::path& path);
+};
+
+//#################### TYPEDEFS ####################
+
+typedef boost::shared_ptr<SequenceRecorder> SequenceRecorder_Ptr;
+typedef boost::shared_ptr<const SequenceRecorder> SequenceRecorder_CPtr;
+
+}
+
+#endif
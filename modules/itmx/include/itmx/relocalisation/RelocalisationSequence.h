@@ -0,0 +1,107 @@
+/**
+ * itmx: RelocalisationSequence.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#ifndef H_ITMX_RELOCALISATIONSEQUENCE
+#define H_ITMX_RELOCALISATIONSEQUENCE
+
+#include <string>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+
+#include <ITMLib/Objects/Camera/ITMRGBDCalib.h>
+
+#include <orx/base/ORImagePtrTypes.h>
+
+namespace itmx {
+
+/**
+ * \brief An instance of this class holds an RGB-D sequence with ground truth poses in memory, for use when evaluating relocalisers.
+ *
+ * The sequence is loaded up-front, so that evaluations can be repeated (e.g. for different relocaliser parameters) without
+ * re-reading it from disk, and so that disk I/O does not affect any timings. The images are only held on the CPU.
+ *
+ * The sequence is expected to be in the 7-Scenes format, i.e. each frame has a colour image, a depth image and a text file
+ * containing the 4x4 camera-to-world pose, with the filenames generated from printf-style masks (e.g. frame-%06i.pose.txt).
+ */
+class RelocalisationSequence
+{
+  //#################### NESTED TYPES ####################
+public:
+  /**
+   * \brief An instance of this struct represents a frame in the sequence.
+   */
+  struct Frame
+  {
+    /** The ground truth camera-to-world pose for the frame. */
+    Matrix4f cameraToWorld;
+
+    /** The raw depth image for the frame. */
+    ORShortImage_CPtr depthImage;
+
+    /** The index of the frame in the sequence on disk. */
+    size_t index;
+
+    /** The colour image for the frame. */
+    ORUChar4Image_CPtr rgbImage;
+  };
+
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** The calibration parameters for the camera that captured the sequence. */
+  ITMLib::ITMRGBDCalib m_calib;
+
+  /** The frames in the sequence. */
+  std::vector<Frame> m_frames;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Loads an RGB-D sequence with ground truth poses from disk.
+   *
+   * \param calibrationFilename The name of the file containing the camera calibration parameters.
+   * \param rgbImageMask        The mask used to generate the colour image filenames.
+   * \param depthImageMask      The mask used to generate the depth image filenames.
+   * \param poseFileMask        The mask used to generate the pose filenames.
+   * \param frameStep           The step between the frames to keep (e.g. 10 means keep every tenth frame).
+   * \param maxFrameCount       The maximum number of frames to keep (0 means keep all of them).
+   *
+   * \throws std::runtime_error If the sequence cannot be loaded, or contains no frames.
+   */
+  RelocalisationSequence(const std::string& calibrationFilename, const std::string& rgbImageMask, const std::string& depthImageMask,
+                         const std::string& poseFileMask, size_t frameStep = 1, size_t maxFrameCount = 0);
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Gets the calibration parameters for the camera that captured the sequence.
+   *
+   * \return  The calibration parameters for the camera that captured the sequence.
+   */
+  const ITMLib::ITMRGBDCalib& get_calib() const;
+
+  /**
+   * \brief Gets the specified frame of the sequence.
+   *
+   * \param i The index of the frame (in the loaded sequence, not on disk).
+   * \return  The frame.
+   */
+  const Frame& get_frame(size_t i) const;
+
+  /**
+   * \brief Gets the number of frames in the sequence.
+   *
+   * \return  The number of frames in the sequence.
+   */
+  size_t get_frame_count() const;
+};
+
+//#################### TYPEDEFS ####################
+
+typedef boost::shared_ptr<const RelocalisationSequence> RelocalisationSequence_CPtr;
+
+}
+
+#endif
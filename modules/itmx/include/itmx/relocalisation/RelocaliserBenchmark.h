@@ -0,0 +1,130 @@
+/**
+ * itmx: RelocaliserBenchmark.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#ifndef H_ITMX_RELOCALISERBENCHMARK
+#define H_ITMX_RELOCALISERBENCHMARK
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <ORUtils/DeviceType.h>
+
+#include <orx/relocalisation/Relocaliser.h>
+
+#include <tvgutil/timing/StageStatistics.h>
+
+#include "RelocalisationSequence.h"
+
+namespace itmx {
+
+/**
+ * \brief This class can be used to measure the accuracy and performance of a relocaliser on a pair of in-memory sequences.
+ *
+ * The relocaliser is first trained on each frame of a training sequence, after which it is asked to relocalise each
+ * frame of a testing sequence. A frame counts as successfully relocalised if the pose returned by the relocaliser is
+ * within 5cm and 5 degrees of the ground truth pose (as in Shotton et al.). The time taken by each stage (preparing the
+ * input images, training, finishing training and relocalising) is recorded for every frame, along with the peak memory
+ * used, so that the distributions of the stage latencies (and the throughput) can be reported.
+ */
+class RelocaliserBenchmark
+{
+  //#################### TYPEDEFS ####################
+public:
+  typedef tvgutil::StageStatistics StageStatistics;
+
+  //#################### NESTED TYPES ####################
+public:
+  /**
+   * \brief An instance of this struct records how the relocaliser did on a single frame of the testing sequence.
+   */
+  struct FrameResult
+  {
+    /** The angular error (in degrees) of the relocalised pose (infinite if the relocaliser failed to produce a pose). */
+    float angularErrorDeg;
+
+    /** The index of the frame in the testing sequence on disk. */
+    size_t index;
+
+    /** The time (in milliseconds) taken to prepare the input images for the frame. */
+    double prepareMs;
+
+    /** The time (in milliseconds) taken to relocalise the frame. */
+    double relocaliseMs;
+
+    /** Whether or not the frame was relocalised successfully. */
+    bool success;
+
+    /** The translational error (in metres) of the relocalised pose (infinite if the relocaliser failed to produce a pose). */
+    float translationalError;
+  };
+
+  /**
+   * \brief An instance of this struct holds the results of a benchmark run.
+   */
+  struct Results
+  {
+    /** The fraction of the testing frames that were relocalised successfully. */
+    double accuracy;
+
+    /** The results for each of the testing frames. */
+    std::vector<FrameResult> frameResults;
+
+    /** The peak amount of device memory (in bytes) held by blocks made by the memory block factory. */
+    size_t peakDeviceBlockBytes;
+
+    /** The peak amount of host memory (in bytes) held by blocks made by the memory block factory. */
+    size_t peakHostBlockBytes;
+
+    /** The peak resident set size (in bytes) of the process so far (0 if not available on this platform). */
+    size_t peakResidentBytes;
+
+    /** The latency statistics for each stage. */
+    std::vector<StageStatistics> stages;
+
+    /** The number of testing frames that were relocalised per second (including the time taken to prepare the images). */
+    double testingFramesPerSecond;
+
+    /** The number of training frames that were processed per second (including the time taken to prepare the images). */
+    double trainingFramesPerSecond;
+  };
+
+  //#################### PUBLIC STATIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Trains a relocaliser on one sequence and then measures how well it relocalises the frames of another.
+   *
+   * \note  The relocaliser should be freshly constructed (or reset). Since the benchmark uses its own working images,
+   *        several benchmarks can safely be run concurrently (on different relocalisers) using the same sequences.
+   *
+   * \param relocaliser       The relocaliser.
+   * \param trainingSequence  The sequence on which to train the relocaliser.
+   * \param testingSequence   The sequence whose frames the relocaliser should be asked to relocalise.
+   * \param deviceType        The device on which the relocaliser expects its input images.
+   * \return                  The results of the benchmark.
+   */
+  static Results run(const orx::Relocaliser_Ptr& relocaliser, const RelocalisationSequence& trainingSequence,
+                     const RelocalisationSequence& testingSequence, DeviceType deviceType);
+
+  /**
+   * \brief Writes the per-frame results of a benchmark run to a stream in CSV format.
+   *
+   * \param os      The stream.
+   * \param results The results.
+   */
+  static void write_csv(std::ostream& os, const Results& results);
+
+  /**
+   * \brief Writes the summary results of a benchmark run to a stream in JSON format.
+   *
+   * \param os      The stream.
+   * \param results The results.
+   */
+  static void write_json(std::ostream& os, const Results& results);
+};
+
+}
+
+#endif
@@ -0,0 +1,164 @@
+/**
+ * itmx: AdaptiveCompressionController.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2017. All rights reserved.
+ */
+
+#ifndef H_ITMX_ADAPTIVECOMPRESSIONCONTROLLER
+#define H_ITMX_ADAPTIVECOMPRESSIONCONTROLLER
+
+#include <cstddef>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+
+namespace itmx {
+
+/**
+ * \brief An instance of this class can be used to adapt the compression settings used by a mapping client to the state of its link to the server.
+ *
+ * The controller is fed with the latency of each frame round-trip (the time between starting to send a frame and receiving
+ * the server's acknowledgement) and the number of frames that were discarded from the client's send queue since the last
+ * frame was sent. It maintains an exponentially-weighted moving average of the latency and walks a ladder of increasingly
+ * aggressive RGB compression levels (lower JPG quality, then RGB downscaling) when the link cannot sustain the target latency.
+ * Once the most aggressive level has been reached, it starts to skip frames. When the link recovers, it steps back up the
+ * ladder more cautiously than it stepped down, so as to avoid oscillating between levels.
+ */
+class AdaptiveCompressionController
+{
+  //#################### NESTED TYPES ####################
+public:
+  /**
+   * \brief An instance of this struct represents a single compression level.
+   */
+  struct Level
+  {
+    /** The JPG quality to use for the RGB images. */
+    int rgbJpegQuality;
+
+    /** The factor by which to downscale the RGB images prior to compression. */
+    int rgbDownscaleFactor;
+
+    Level(int rgbJpegQuality_, int rgbDownscaleFactor_)
+    : rgbJpegQuality(rgbJpegQuality_), rgbDownscaleFactor(rgbDownscaleFactor_)
+    {}
+  };
+
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** The minimum number of frames that must be sent after a change of settings before the settings can be degraded further. */
+  size_t m_cooldown;
+
+  /** The number of frames that should be skipped for every frame that is sent. */
+  size_t m_frameSkip;
+
+  /** The number of frames that have been sent since the settings were last changed. */
+  size_t m_framesSinceChange;
+
+  /** The number of frames that remain to be skipped before the next frame is sent. */
+  size_t m_framesToSkip;
+
+  /** Whether or not at least one latency measurement has been recorded. */
+  bool m_hasLatency;
+
+  /** The index of the current compression level. */
+  size_t m_levelIndex;
+
+  /** The compression levels, from least to most aggressive. */
+  std::vector<Level> m_levels;
+
+  /** The maximum number of frames that may be skipped for every frame that is sent. */
+  size_t m_maxFrameSkip;
+
+  /** The smoothed (exponentially-weighted moving average) frame latency, in milliseconds. */
+  double m_smoothedLatencyMs;
+
+  /** The weight given to each new latency measurement when updating the smoothed latency. */
+  double m_smoothingFactor;
+
+  /** The target frame latency, in milliseconds. */
+  double m_targetLatencyMs;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Constructs an adaptive compression controller.
+   *
+   * \param targetLatencyMs The target frame latency, in milliseconds.
+   * \param cooldown        The minimum number of frames that must be sent after a change of settings before the settings can be degraded further.
+   * \param maxFrameSkip    The maximum number of frames that may be skipped for every frame that is sent.
+   *
+   * \throws std::invalid_argument  If targetLatencyMs <= 0.
+   */
+  explicit AdaptiveCompressionController(double targetLatencyMs, size_t cooldown = 5, size_t maxFrameSkip = 3);
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Gets the number of frames that should currently be skipped for every frame that is sent.
+   *
+   * \return  The number of frames that should currently be skipped for every frame that is sent.
+   */
+  size_t get_frame_skip() const;
+
+  /**
+   * \brief Gets the factor by which RGB images should currently be downscaled prior to compression.
+   *
+   * \return  The factor by which RGB images should currently be downscaled prior to compression.
+   */
+  int get_rgb_downscale_factor() const;
+
+  /**
+   * \brief Gets the JPG quality that should currently be used for the RGB images.
+   *
+   * \return  The JPG quality that should currently be used for the RGB images.
+   */
+  int get_rgb_jpeg_quality() const;
+
+  /**
+   * \brief Gets the smoothed frame latency, in milliseconds.
+   *
+   * \return  The smoothed frame latency, in milliseconds.
+   */
+  double get_smoothed_latency() const;
+
+  /**
+   * \brief Records the outcome of sending a frame to the server, and adapts the settings accordingly.
+   *
+   * \param latencyMs       The time (in milliseconds) between starting to send the frame and receiving the server's acknowledgement.
+   * \param discardedFrames The number of frames that were discarded from the client's send queue since the previous frame was sent.
+   * \return                true, if the settings changed as a result of recording the frame, or false otherwise.
+   */
+  bool record_frame(double latencyMs, size_t discardedFrames);
+
+  /**
+   * \brief Determines whether or not the next frame in the client's send queue should be sent (rather than skipped).
+   *
+   * \return  true, if the next frame should be sent, or false if it should be skipped.
+   */
+  bool should_send_frame();
+
+  //#################### PRIVATE MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Attempts to switch to more aggressive settings.
+   *
+   * \return  true, if the settings were changed, or false if they were already as aggressive as possible.
+   */
+  bool degrade();
+
+  /**
+   * \brief Attempts to switch to less aggressive settings.
+   *
+   * \return  true, if the settings were changed, or false if they were already as conservative as possible.
+   */
+  bool improve();
+};
+
+//#################### TYPEDEFS ####################
+
+typedef boost::shared_ptr<AdaptiveCompressionController> AdaptiveCompressionController_Ptr;
+typedef boost::shared_ptr<const AdaptiveCompressionController> AdaptiveCompressionController_CPtr;
+
+}
+
+#endif
@@ -15,7 +15,8 @@
 namespace itmx {
 
 /**
- * \brief An instance of this class represents a message containing the sizes (in bytes) and dimensions of the compressed images for a single RGB-D frame.
+ * \brief An instance of this class represents a message containing the sizes (in bytes) and dimensions of the compressed images for a single RGB-D frame,
+ *        together with the encoding parameters that were used for the RGB image.
  */
 class CompressedRGBDFrameHeaderMessage : public MappingMessage
 {
@@ -33,6 +34,12 @@ private:
   /** The byte segment within the message data that corresponds to the dimensions of the compressed RGB image. */
   Segment m_rgbImageSizeSegment;
 
+  /** The byte segment within the message data that corresponds to the factor by which the RGB image was downscaled prior to compression. */
+  Segment m_rgbDownscaleFactorSegment;
+
+  /** The byte segment within the message data that corresponds to the JPG quality with which the RGB image was compressed. */
+  Segment m_rgbQualitySegment;
+
   //#################### CONSTRUCTORS ####################
 public:
   /**
@@ -56,6 +63,13 @@ public:
    */
   Vector2i extract_depth_image_size() const;
 
+  /**
+   * \brief Extracts the factor by which the RGB image was downscaled prior to compression from the message.
+   *
+   * \return  The factor by which the RGB image was downscaled prior to compression.
+   */
+  int32_t extract_rgb_downscale_factor() const;
+
   /**
    * \brief Extracts the size (in bytes) of the compressed RGB image from the message.
    *
@@ -70,6 +84,13 @@ public:
    */
   Vector2i extract_rgb_image_size() const;
 
+  /**
+   * \brief Extracts the JPG quality with which the RGB image was compressed from the message.
+   *
+   * \return  The JPG quality with which the RGB image was compressed (only meaningful when using JPG compression).
+   */
+  int32_t extract_rgb_quality() const;
+
   /**
    * \brief Sets the size (in bytes) of the compressed depth image.
    *
@@ -84,6 +105,13 @@ public:
    */
   void set_depth_image_size(const Vector2i& depthImageSize);
 
+  /**
+   * \brief Sets the factor by which the RGB image was downscaled prior to compression.
+   *
+   * \param rgbDownscaleFactor  The factor by which the RGB image was downscaled prior to compression.
+   */
+  void set_rgb_downscale_factor(int32_t rgbDownscaleFactor);
+
   /**
    * \brief Sets the size (in bytes) of the compressed RGB image.
    *
@@ -97,6 +125,13 @@ public:
    * \param rgbImageSize  The dimensions of the compressed RGB image.
    */
   void set_rgb_image_size(const Vector2i& rgbImageSize);
+
+  /**
+   * \brief Sets the JPG quality with which the RGB image was compressed.
+   *
+   * \param rgbQuality  The JPG quality with which the RGB image was compressed.
+   */
+  void set_rgb_quality(int32_t rgbQuality);
 };
 
 }
@@ -6,9 +6,13 @@
 #ifndef H_ITMX_MAPPINGCLIENT
 #define H_ITMX_MAPPINGCLIENT
 
+#include <boost/atomic.hpp>
+
 #include <tvgutil/boost/WrappedAsio.h>
 #include <tvgutil/containers/PooledQueue.h>
+#include <tvgutil/net/SharedMemoryMessageRing.h>
 
+#include "AdaptiveCompressionController.h"
 #include "RGBDCalibrationMessage.h"
 #include "RGBDFrameCompressor.h"
 #include "RGBDFrameMessage.h"
@@ -26,18 +30,36 @@ public:
 
   //#################### PRIVATE VARIABLES ####################
 private:
+  /** The controller used to adapt the compression settings to the state of the link to the server (if adaptive compression is enabled). */
+  AdaptiveCompressionController_Ptr m_compressionController;
+
+  /** The number of frame messages that have been discarded (due to the pool being empty) since the last frame message was sent. */
+  boost::atomic<size_t> m_discardedFrameCount;
+
   /** A frame compressor, used to compress frame messages to reduce the network bandwidth they consume. */
   RGBDFrameCompressor_Ptr m_frameCompressor;
 
   /** A queue containing the RGB-D frame messages to be sent to the server. */
   RGBDFrameMessageQueue m_frameMessageQueue;
 
+  /** The shared memory ring via which frames are sent to the server (if the client and server are co-located). */
+  tvgutil::SharedMemoryMessageRing_Ptr m_frameRing;
+
+  /** The thread that sends frames to the server via the shared memory ring (if any). */
+  boost::shared_ptr<boost::thread> m_frameRingWriter;
+
   /** A mutex used to synchronise interactions with the server to avoid overlaps. */
   mutable boost::mutex m_interactionMutex;
 
   /** The image in which remote scene renderings retrieved from the server are stored. */
   mutable ORUChar4Image_Ptr m_remoteImage;
 
+  /** The name of the shared memory segment via which to send frames to the server (empty if frames are to be sent over the network). */
+  std::string m_sharedMemoryName;
+
+  /** A flag used to tell the shared memory ring writer (if any) to stop. */
+  boost::atomic<bool> m_stopFrameRingWriter;
+
   /** The TCP stream used as a wrapper around the connection to the server. */
   mutable boost::asio::ip::tcp::iostream m_stream;
 
@@ -46,12 +68,23 @@ public:
   /**
    * \brief Constructs a mapping client.
    *
-   * \param host              The mapping host to which to connect.
+   * If the host is of the form shm://name, the client is assumed to be running on the same machine as the server. In that case,
+   * it connects to the server via localhost, but sends its frames via a shared memory segment with the specified name, without
+   * compressing them. All other interactions with the server (e.g. rendering requests) still happen over the TCP connection.
+   *
+   * \param host              The mapping host to which to connect (or shm://name, to send frames via shared memory).
    * \param port              The port on the mapping host to which to connect.
    * \param poolEmptyStrategy A strategy specifying what should happen when a push is attempted while the frame message queue's pool is empty.
    */
   explicit MappingClient(const std::string& host = "localhost", const std::string& port = "7851", tvgutil::pooled_queue::PoolEmptyStrategy poolEmptyStrategy = tvgutil::pooled_queue::PES_DISCARD);
 
+  //#################### DESTRUCTOR ####################
+public:
+  /**
+   * \brief Destroys the mapping client, stopping the shared memory ring writer (if any) before the ring is destroyed.
+   */
+  ~MappingClient();
+
   //#################### PUBLIC MEMBER FUNCTIONS ####################
 public:
   /**
@@ -59,6 +92,17 @@ public:
    */
   RGBDFrameMessageQueue::PushHandler_Ptr begin_push_frame_message();
 
+  /**
+   * \brief Enables adaptive compression, whereby the RGB compression settings and the rate at which frames are sent
+   *        are continually adjusted so as to keep the latency of sending each frame close to a target latency.
+   *
+   * \note  This must be called before send_calibration_message. The adapted JPG quality only has an effect when
+   *        using JPG compression for the RGB images; RGB downscaling only has an effect when using any OpenCV codec.
+   *
+   * \param targetLatencyMs The target latency (in milliseconds) for sending a frame and receiving its acknowledgement.
+   */
+  void enable_adaptive_compression(double targetLatencyMs);
+
   /**
    * \brief Gets the image in which remote scene renderings retrieved from the server are stored.
    *
@@ -84,10 +128,26 @@ public:
 
   //#################### PRIVATE MEMBER FUNCTIONS ####################
 private:
+  /**
+   * \brief Checks whether or not the TCP connection to the server is still alive.
+   *
+   * This is done by asking the server whether it has rendered an image for the client, which is harmless, but
+   * requires a full round trip. It is used by the shared memory ring writer, which does not otherwise use the
+   * TCP connection, and so would not otherwise notice that the server has gone away.
+   *
+   * \return  true, if the server responded, or false otherwise.
+   */
+  bool is_connection_ok() const;
+
   /**
    * \brief Sends frame messages from the message queue across to the server.
    */
   void run_message_sender();
+
+  /**
+   * \brief Sends frame messages from the message queue across to the server via the shared memory ring.
+   */
+  void run_shared_memory_message_sender();
 };
 
 //#################### TYPEDEFS ####################
@@ -8,11 +8,15 @@
 
 #include <ITMLib/Objects/Camera/ITMRGBDCalib.h>
 
-#include <tvgutil/containers/PooledQueue.h>
+#include <tvgutil/containers/SPSCPooledQueue.h>
 #include <tvgutil/misc/ExclusiveHandle.h>
+#include <tvgutil/net/AckMessage.h>
 #include <tvgutil/net/ClientHandler.h>
+#include <tvgutil/net/SharedMemoryMessageRing.h>
 
+#include "InteractionTypeMessage.h"
 #include "RenderingRequestMessage.h"
+#include "RGBDCalibrationMessage.h"
 #include "RGBDFrameCompressor.h"
 
 namespace itmx {
@@ -24,14 +28,21 @@ class MappingClientHandler : public tvgutil::ClientHandler
 {
   //#################### TYPEDEFS ####################
 private:
-  typedef tvgutil::PooledQueue<RGBDFrameMessage_Ptr> RGBDFrameMessageQueue;
+  // Note: Frames are only ever pushed by the handler and only ever consumed by the SLAM component for the client's scene, so a lock-free queue suffices.
+  typedef tvgutil::SPSCPooledQueue<RGBDFrameMessage_Ptr> RGBDFrameMessageQueue;
   typedef boost::shared_ptr<RGBDFrameMessageQueue> RGBDFrameMessageQueue_Ptr;
 
   //#################### PRIVATE VARIABLES ####################
 private:
+  /** A place in which to store acknowledgement messages (used when running asynchronously). */
+  tvgutil::AckMessage m_ackMessage;
+
   /** The calibration parameters of the camera associated with the client. */
   ITMLib::ITMRGBDCalib m_calib;
 
+  /** A place in which to store the calibration message received from the client (used when running asynchronously). */
+  RGBDCalibrationMessage m_calibMessage;
+
   /** A dummy frame message to consume messages that cannot be pushed onto the queue. */
   RGBDFrameMessage_Ptr m_dummyFrameMessage;
 
@@ -44,15 +55,30 @@ private:
   /** A queue containing the RGB-D frame messages received from the client. */
   RGBDFrameMessageQueue_Ptr m_frameMessageQueue;
 
+  /** The shared memory ring via which the client sends its frames (if it is co-located with the server). */
+  tvgutil::SharedMemoryMessageRing_Ptr m_frameRing;
+
+  /** The thread that reads frames from the shared memory ring (if any) and pushes them onto the frame message queue. */
+  boost::shared_ptr<boost::thread> m_frameRingReader;
+
+  /** A place in which to store messages indicating whether or not an image has been rendered for the client (used when running asynchronously). */
+  tvgutil::SimpleMessage<bool> m_hasRenderedImageMessage;
+
   /** A place in which to store compressed RGB-D frame header messages. */
   CompressedRGBDFrameHeaderMessage m_headerMessage;
 
   /** A flag indicating whether or not the images associated with the first message in the queue have already been read. */
   bool m_imagesDirty;
 
+  /** A place in which to store interaction type messages (used when running asynchronously). */
+  InteractionTypeMessage m_interactionTypeMessage;
+
   /** A flag indicating whether or not the pose associated with the first message in the queue has already been read. */
   bool m_poseDirty;
 
+  /** A place in which to store rendering request messages received from the client (used when running asynchronously). */
+  RenderingRequestMessage m_receivedRenderingRequestMessage;
+
   /** An optional image into which to render the scene for the client. */
   ORUChar4Image_Ptr m_renderedImage;
 
@@ -71,6 +97,9 @@ private:
   /** The scene ID that is associated with the client. */
   std::string m_sceneID;
 
+  /** A flag used to tell the shared memory ring reader (if any) to stop. */
+  boost::atomic<bool> m_stopFrameRingReader;
+
   //#################### CONSTRUCTORS ####################
 public:
   /**
@@ -150,12 +179,18 @@ public:
   /** Override */
   virtual void run_iter();
 
+  /** Override */
+  virtual void run_iter_async(const Continuation& done);
+
   /** Override */
   virtual void run_post();
 
   /** Override */
   virtual void run_pre();
 
+  /** Override */
+  virtual void run_pre_async(const Continuation& done);
+
   /**
    * \brief Sets whether or not the images associated with the first message in the queue have already been read.
    *
@@ -176,6 +211,81 @@ public:
    * \param sceneID The scene ID that is associated with the client.
    */
   void set_scene_id(const std::string& sceneID);
+
+  /** Override */
+  virtual bool supports_async() const;
+
+  //#################### PRIVATE MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Responds asynchronously to a calibration message that has been received from the client.
+   *
+   * \param done  The continuation to call when the response has been sent.
+   */
+  void handle_calibration_message_async(const Continuation& done);
+
+  /**
+   * \brief Handles asynchronously a frame header message that has been received from the client.
+   *
+   * \param done  The continuation to call when the frame has been received and acknowledged.
+   */
+  void handle_frame_header_async(const Continuation& done);
+
+  /**
+   * \brief Handles asynchronously an interaction type message that has been received from the client.
+   *
+   * This is the entry point of a per-interaction state machine that reads/writes the remaining messages
+   * for the interaction, and then calls the specified continuation once the interaction has finished.
+   *
+   * \param done  The continuation to call when the interaction has finished.
+   */
+  void handle_interaction_type_async(const Continuation& done);
+
+  /**
+   * \brief Handles asynchronously a rendering request message that has been received from the client.
+   *
+   * \param done  The continuation to call when the request has been stored and acknowledged.
+   */
+  void handle_rendering_request_async(const Continuation& done);
+
+  /**
+   * \brief Sets up the handler based on the calibration message received from the client.
+   *
+   * \param calibMsg  The calibration message received from the client.
+   */
+  void initialise(const RGBDCalibrationMessage& calibMsg);
+
+  /**
+   * \brief Compresses the image that the server has rendered for the client into m_headerMessage and m_frameMessage.
+   *
+   * \param renderedImage The image that the server has rendered for the client.
+   */
+  void prepare_rendering_response(const ORUChar4Image_Ptr& renderedImage);
+
+  /**
+   * \brief Uncompresses the frame message that has just been received from the client and pushes it onto the frame message queue.
+   */
+  void push_frame_message();
+
+  /**
+   * \brief Asynchronously pushes the frame message that has just been received from the client onto the frame message queue,
+   *        and then acknowledges it.
+   *
+   * If the queue is full, this defers both the push and the acknowledgement until space becomes available. Since the client
+   * waits for the acknowledgement before sending its next frame, this applies back-pressure to the client, rather than
+   * silently discarding frames on the server.
+   *
+   * \param done  The continuation to call when the frame has been pushed and acknowledged.
+   */
+  void push_frame_message_async(const Continuation& done);
+
+  /**
+   * \brief Reads frames from the shared memory ring and pushes them onto the frame message queue, until told to stop.
+   *
+   * If the queue is full, this leaves the frames in the ring until space becomes available. Since the client waits
+   * for a free slot in the ring before writing its next frame, this applies back-pressure to the client.
+   */
+  void run_frame_ring_reader();
 };
 
 }
@@ -22,10 +22,11 @@ public:
   /**
    * \brief Constructs a mapping server.
    *
-   * \param mode  The mode in which the server should run.
-   * \param port  The port on which the server should listen for connections.
+   * \param mode          The mode in which the server should run.
+   * \param port          The port on which the server should listen for connections.
+   * \param ioThreadCount The number of threads in the I/O thread pool on which to multiplex the clients (if zero, each client gets its own thread instead).
    */
-  explicit MappingServer(Mode mode = SM_MULTI_CLIENT, int port = 7851);
+  explicit MappingServer(Mode mode = SM_MULTI_CLIENT, int port = 7851, size_t ioThreadCount = 0);
 
   //#################### PUBLIC MEMBER FUNCTIONS ####################
 public:
@@ -30,6 +30,9 @@ private:
   /** The type of compression applied to the RGB images. */
   Segment m_rgbCompressionTypeSegment;
 
+  /** The byte segment within the message data that corresponds to the name of the shared memory segment (if any) via which frames will be sent. */
+  Segment m_sharedMemoryNameSegment;
+
   //#################### CONSTRUCTORS ####################
 public:
   /**
@@ -60,6 +63,13 @@ public:
    */
   RGBCompressionType extract_rgb_compression_type() const;
 
+  /**
+   * \brief Extracts the name of the shared memory segment (if any) via which the client will send its frames.
+   *
+   * \return  The name of the shared memory segment via which the client will send its frames, or the empty string if it will send them over the network.
+   */
+  std::string extract_shared_memory_name() const;
+
   /**
    * \brief Copies the camera's calibration parameters into the appropriate byte segment in the message.
    *
@@ -80,6 +90,15 @@ public:
    * \param rgbCompressionType  The type of compression applied to the RGB images.
    */
   void set_rgb_compression_type(RGBCompressionType rgbCompressionType);
+
+  /**
+   * \brief Sets the name of the shared memory segment (if any) via which the client will send its frames.
+   *
+   * \param sharedMemoryName  The name of the shared memory segment (or the empty string to send the frames over the network).
+   *
+   * \throws std::invalid_argument If the name is too long to fit in the message.
+   */
+  void set_shared_memory_name(const std::string& sharedMemoryName);
 };
 
 }
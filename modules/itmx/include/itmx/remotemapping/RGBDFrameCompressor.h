@@ -56,13 +56,39 @@ public:
    */
   void compress_rgbd_frame(const RGBDFrameMessage& uncompressedFrame, CompressedRGBDFrameHeaderMessage& compressedHeader, CompressedRGBDFrameMessage& compressedFrame);
 
+  /**
+   * \brief Sets the factor by which RGB images should be downscaled prior to compression.
+   *
+   * \note  Downscaling is only performed when using a lossy or lossless OpenCV codec (i.e. not with RGB_COMPRESSION_NONE).
+   *        Downscaled images are upsampled back to their original size during uncompression.
+   *
+   * \param rgbDownscaleFactor  The factor by which RGB images should be downscaled prior to compression (1 = no downscaling).
+   *
+   * \throws std::invalid_argument  If rgbDownscaleFactor < 1.
+   */
+  void set_rgb_downscale_factor(int rgbDownscaleFactor);
+
+  /**
+   * \brief Sets the quality with which RGB images should be compressed when using JPG compression.
+   *
+   * \param rgbJpegQuality  The JPG quality to use (in the range [0,100]).
+   *
+   * \throws std::invalid_argument  If rgbJpegQuality is not in the range [0,100].
+   */
+  void set_rgb_jpeg_quality(int rgbJpegQuality);
+
   /**
    * \brief Uncompresses an RGB-D frame message.
    *
+   * The RGB image is decoded and (if necessary) upsampled in accordance with the downscale factor and quality specified in the header.
+   *
+   * \param compressedHeader   The header of the compressed frame message.
    * \param compressedFrame    The compressed frame message.
    * \param uncompressedFrame  Will contain the uncompressed message.
+   *
+   * \throws std::runtime_error  If the RGB parameters in the header are inconsistent with each other or with the size of the uncompressed frame.
    */
-  void uncompress_rgbd_frame(const CompressedRGBDFrameMessage& compressedFrame, RGBDFrameMessage& uncompressedFrame);
+  void uncompress_rgbd_frame(const CompressedRGBDFrameHeaderMessage& compressedHeader, const CompressedRGBDFrameMessage& compressedFrame, RGBDFrameMessage& uncompressedFrame);
 
   //#################### PRIVATE MEMBER FUNCTIONS ####################
 private:
@@ -83,8 +109,12 @@ private:
 
   /**
    * \brief Uncompresses the compressed RGB image on which we are currently working.
+   *
+   * \param rgbDownscaleFactor The factor by which the RGB image was downscaled prior to compression.
+   *
+   * \throws std::runtime_error  If the decoded RGB image does not have the size implied by the downscale factor.
    */
-  void uncompress_rgb_image();
+  void uncompress_rgb_image(int rgbDownscaleFactor);
 };
 
 //#################### TYPEDEFS ####################
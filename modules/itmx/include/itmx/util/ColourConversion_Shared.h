@@ -34,18 +34,16 @@ inline float rgb_to_lab_f(float t)
 }
 
 /**
- * \brief Converts an RGB colour to CIELab.
+ * \brief Converts an RGB colour to CIEXYZ, normalised by the reference white point.
  *
- * \param rgb The RGB colour.
- * \return    The result of converting the colour to CIELab.
+ * This is the (linear) first stage of the RGB to CIELab conversion (see convert_rgb_to_lab).
+ *
+ * \param rgb The RGB colour (with components in the range [0,1]).
+ * \return    The result of converting the colour to normalised CIEXYZ.
  */
 _CPU_AND_GPU_CODE_
-inline Vector3f convert_rgb_to_lab(const Vector3f& rgb)
+inline Vector3f convert_rgb_to_xyz(const Vector3f& rgb)
 {
-  // Equivalent Matlab code can be found at: https://www.eecs.berkeley.edu/Research/Projects/CS/vision/bsds/code/Util/RGB2Lab.m
-  // See also: http://docs.opencv.org/modules/imgproc/doc/miscellaneous_transformations.html
-  const float EPSILON = 0.000001f;
-
   float x = 0.412453f * rgb.r + 0.357580f * rgb.g + 0.180423f * rgb.b;
   float y = 0.212671f * rgb.r + 0.715160f * rgb.g + 0.072169f * rgb.b;
   float z = 0.019334f * rgb.r + 0.119193f * rgb.g + 0.950227f * rgb.b;
@@ -53,11 +51,27 @@ inline Vector3f convert_rgb_to_lab(const Vector3f& rgb)
   x /= 0.950456f;
   z /= 1.088754f;
 
-  float fx = rgb_to_lab_f(x);
-  float fy = rgb_to_lab_f(y);
-  float fz = rgb_to_lab_f(z);
+  return Vector3f(x, y, z);
+}
 
-  float L = y > 0.008856f ? (116.0f * fy - 16.0f) : (903.3f * y);
+/**
+ * \brief Converts a normalised CIEXYZ colour to CIELab.
+ *
+ * This is the (non-linear) second stage of the RGB to CIELab conversion (see convert_rgb_to_lab).
+ *
+ * \param xyz The normalised CIEXYZ colour.
+ * \return    The result of converting the colour to CIELab.
+ */
+_CPU_AND_GPU_CODE_
+inline Vector3f convert_xyz_to_lab(const Vector3f& xyz)
+{
+  const float EPSILON = 0.000001f;
+
+  float fx = rgb_to_lab_f(xyz.x);
+  float fy = rgb_to_lab_f(xyz.y);
+  float fz = rgb_to_lab_f(xyz.z);
+
+  float L = xyz.y > 0.008856f ? (116.0f * fy - 16.0f) : (903.3f * xyz.y);
   float A = 500.0f * (fx - fy);
   float B = 200.0f * (fy - fz);
 
@@ -68,6 +82,20 @@ inline Vector3f convert_rgb_to_lab(const Vector3f& rgb)
   return Vector3f(L, A, B);
 }
 
+/**
+ * \brief Converts an RGB colour to CIELab.
+ *
+ * \param rgb The RGB colour.
+ * \return    The result of converting the colour to CIELab.
+ */
+_CPU_AND_GPU_CODE_
+inline Vector3f convert_rgb_to_lab(const Vector3f& rgb)
+{
+  // Equivalent Matlab code can be found at: https://www.eecs.berkeley.edu/Research/Projects/CS/vision/bsds/code/Util/RGB2Lab.m
+  // See also: http://docs.opencv.org/modules/imgproc/doc/miscellaneous_transformations.html
+  return convert_xyz_to_lab(convert_rgb_to_xyz(rgb));
+}
+
 /**
  * \brief Converts an RGB colour to YCbCr.
  *
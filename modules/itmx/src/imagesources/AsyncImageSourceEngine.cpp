@@ -5,6 +5,7 @@
 
 #include "imagesources/AsyncImageSourceEngine.h"
 
+#include <limits>
 #include <stdexcept>
 
 namespace itmx {
@@ -12,8 +13,9 @@ namespace itmx {
 //#################### CONSTRUCTORS ####################
 
 AsyncImageSourceEngine::AsyncImageSourceEngine(ImageSourceEngine *innerSource, size_t queueCapacity)
-: m_grabberShouldTerminate(false),
-  m_innerSource(innerSource),
+: m_endSequenceNumber(std::numeric_limits<size_t>::max()),
+  m_grabberShouldTerminate(false),
+  m_nextSequenceNumber(0),
   m_queueCapacity(queueCapacity > 0 ? queueCapacity : std::numeric_limits<size_t>::max())
 {
   if(!innerSource)
@@ -21,159 +23,248 @@ AsyncImageSourceEngine::AsyncImageSourceEngine(ImageSourceEngine *innerSource, s
     throw std::runtime_error("Error: Cannot initialise an AsyncImageSourceEngine with a NULL ImageSourceEngine.");
   }
 
-  // Determine the maximum number of RGB-D images to store in the pool.
-  const size_t MAX_POOL_CAPACITY = 60;
-  m_poolCapacity = std::min(m_queueCapacity, MAX_POOL_CAPACITY);
+  m_innerSources.push_back(ImageSourceEngine_Ptr(innerSource));
+  initialise();
+}
+
+AsyncImageSourceEngine::AsyncImageSourceEngine(const std::vector<ImageSourceEngine*>& innerSources, size_t queueCapacity)
+: m_endSequenceNumber(std::numeric_limits<size_t>::max()),
+  m_grabberShouldTerminate(false),
+  m_nextSequenceNumber(0),
+  m_queueCapacity(queueCapacity > 0 ? queueCapacity : std::numeric_limits<size_t>::max())
+{
+  // Take ownership of the inner sources before checking them, so that they get destroyed if we throw.
+  for(size_t i = 0, size = innerSources.size(); i < size; ++i)
+  {
+    m_innerSources.push_back(ImageSourceEngine_Ptr(innerSources[i]));
+  }
 
-  // If the inner source has images available, fill the pool to avoid allocating memory at runtime.
-  // If the inner source doesn't have any images available, there is no need to allocate.
-  if(m_innerSource->hasMoreImages())
+  if(m_innerSources.empty())
   {
-    for(size_t i = 0; i < m_poolCapacity; ++i)
+    throw std::runtime_error("Error: Cannot initialise an AsyncImageSourceEngine without any inner ImageSourceEngines.");
+  }
+
+  for(size_t i = 0, size = m_innerSources.size(); i < size; ++i)
+  {
+    if(!m_innerSources[i])
     {
-      RGBDImage rgbdImage;
-      rgbdImage.rawDepth.reset(new ORShortImage(m_innerSource->getDepthImageSize(), true, false));
-      rgbdImage.rgb.reset(new ORUChar4Image(m_innerSource->getRGBImageSize(), true, false));
-      m_pool.push(rgbdImage);
+      throw std::runtime_error("Error: Cannot initialise an AsyncImageSourceEngine with a NULL ImageSourceEngine.");
     }
   }
 
-  // Start the image grabber.
-  m_grabber = boost::thread(boost::bind(&AsyncImageSourceEngine::run_image_grabber, this));
+  initialise();
 }
 
 //#################### DESTRUCTOR ####################
 
 AsyncImageSourceEngine::~AsyncImageSourceEngine()
 {
-  // Set the flag that informs the image grabber that it should terminate.
-  m_grabberShouldTerminate = true;
+  // Set the flag that informs the image grabbers that they should terminate.
+  {
+    boost::unique_lock<boost::mutex> lock(m_mutex);
+    m_grabberShouldTerminate = true;
+  }
 
-  // Wake the image grabber (it might be waiting on a full queue).
-  m_queueNotFull.notify_one();
+  // Wake the image grabbers (they might be waiting for space in the queue).
+  m_spaceAvailable.notify_all();
 
-  // Wait for the image grabber to terminate gracefully.
-  m_grabber.join();
+  // Wait for the image grabbers to terminate gracefully.
+  for(size_t i = 0, size = m_grabbers.size(); i < size; ++i)
+  {
+    m_grabbers[i]->join();
+  }
 }
 
 //#################### PUBLIC MEMBER FUNCTIONS ####################
 
-ITMLib::ITMRGBDCalib AsyncImageSourceEngine::getCalib() const
+AsyncImageSourceEngine::RGBDImage AsyncImageSourceEngine::borrow_images()
 {
   boost::unique_lock<boost::mutex> lock(m_mutex);
 
-  // If there are images in the queue, return the first image's calibration; if not, defer to the inner source.
-  return !m_queue.empty() ? m_queue.front().calib : m_innerSource->getCalib();
+  // If the next image in the sequence is not available, early out.
+  std::map<size_t,RGBDImage>::iterator it = m_queue.find(m_nextSequenceNumber);
+  if(it == m_queue.end())
+  {
+    throw std::runtime_error("Error: No more images to get. Make sure to call hasMoreImages before calling getImages.");
+  }
+
+  // Otherwise, remove the image from the queue and inform the image grabbers that there is space in the queue.
+  RGBDImage rgbdImage = it->second;
+  m_queue.erase(it);
+  ++m_nextSequenceNumber;
+  m_spaceAvailable.notify_all();
+
+  return rgbdImage;
 }
 
-Vector2i AsyncImageSourceEngine::getDepthImageSize() const
+ITMLib::ITMRGBDCalib AsyncImageSourceEngine::getCalib() const
 {
   boost::unique_lock<boost::mutex> lock(m_mutex);
 
-  // If there are images in the queue, return the first image's depth size; if not, defer to the inner source.
-  return !m_queue.empty() ? m_queue.front().rawDepth->noDims : m_innerSource->getDepthImageSize();
+  // If the next image is in the queue, return its calibration; if not, return the calibration of the inner sources.
+  std::map<size_t,RGBDImage>::const_iterator it = m_queue.find(m_nextSequenceNumber);
+  return it != m_queue.end() ? it->second.calib : m_calib;
 }
 
-void AsyncImageSourceEngine::getImages(ORUChar4Image *rgb, ORShortImage *rawDepth)
+Vector2i AsyncImageSourceEngine::getDepthImageSize() const
 {
   boost::unique_lock<boost::mutex> lock(m_mutex);
 
-  // If there are no more images available, early out.
-  if(m_queue.empty())
-  {
-    throw std::runtime_error("Error: No more images to get. Make sure to call hasMoreImages before calling getImages.");
-  }
+  // If the next image is in the queue, return its depth size; if not, return the depth size of the inner sources.
+  std::map<size_t,RGBDImage>::const_iterator it = m_queue.find(m_nextSequenceNumber);
+  return it != m_queue.end() ? it->second.rawDepth->noDims : m_depthImageSize;
+}
 
-  // Otherwise, get the first RGB-D image from the queue.
-  RGBDImage& rgbdImage = m_queue.front();
+void AsyncImageSourceEngine::getImages(ORUChar4Image *rgb, ORShortImage *rawDepth)
+{
+  // Borrow the next RGB-D image from the queue. Note that we don't hold the mutex while copying it, so the grabbers can carry on.
+  RGBDImage rgbdImage = borrow_images();
 
   // Ensure that the output images have the correct size (this is generally a no-op).
   rawDepth->ChangeDims(rgbdImage.rawDepth->noDims);
   rgb->ChangeDims(rgbdImage.rgb->noDims);
 
-  // Copy the depth and RGB images from the queued image into the output images.
+  // Copy the depth and RGB images from the borrowed image into the output images.
   rawDepth->SetFrom(rgbdImage.rawDepth.get(), ORShortImage::CPU_TO_CPU);
   rgb->SetFrom(rgbdImage.rgb.get(), ORUChar4Image::CPU_TO_CPU);
 
-  // If there is space available in the RGB-D image pool, store the RGB-D image to avoid reallocating memory later.
-  if(m_pool.size() < m_poolCapacity) m_pool.push(rgbdImage);
-
-  // Remove the RGB-D image from the queue and inform the image grabber that the queue is not full.
-  m_queue.pop();
-  m_queueNotFull.notify_one();
+  // Hand the RGB-D image back so that its memory can be reused.
+  return_images(rgbdImage);
 }
 
 Vector2i AsyncImageSourceEngine::getRGBImageSize() const
 {
   boost::unique_lock<boost::mutex> lock(m_mutex);
 
-  // If there are images in the queue, return the first image's RGB size; if not, defer to the inner source.
-  return !m_queue.empty() ? m_queue.front().rgb->noDims : m_innerSource->getRGBImageSize();
+  // If the next image is in the queue, return its RGB size; if not, return the RGB size of the inner sources.
+  std::map<size_t,RGBDImage>::const_iterator it = m_queue.find(m_nextSequenceNumber);
+  return it != m_queue.end() ? it->second.rgb->noDims : m_rgbImageSize;
 }
 
 bool AsyncImageSourceEngine::hasMoreImages() const
 {
-  // We need to grab the mutex in case the queue is empty, in which case we need to wait to see if an image becomes available.
   boost::unique_lock<boost::mutex> lock(m_mutex);
 
-  // If the inner source has more images, wait for one to be added to the queue by the image grabber.
-  while(m_innerSource->hasMoreImages() && m_queue.empty()) m_queueNotEmpty.wait(lock);
+  // Until either the next image in the sequence arrives or we find out that the inner sources can't produce it, wait.
+  while(m_nextSequenceNumber < m_endSequenceNumber && m_queue.find(m_nextSequenceNumber) == m_queue.end())
+  {
+    m_imageReady.wait(lock);
+  }
+
+  return m_queue.find(m_nextSequenceNumber) != m_queue.end();
+}
+
+void AsyncImageSourceEngine::return_images(const RGBDImage& rgbdImage)
+{
+  boost::unique_lock<boost::mutex> lock(m_mutex);
 
-  // At this point, either there is now an image in the queue, in which case we return true,
-  // or the inner source has terminated, in which case we return false.
-  return !m_queue.empty();
+  // If there is space available in the RGB-D image pool, store the RGB-D image to avoid reallocating memory later.
+  if(m_pool.size() < m_poolCapacity) m_pool.push_back(rgbdImage);
 }
 
 //#################### PRIVATE MEMBER FUNCTIONS ####################
 
-void AsyncImageSourceEngine::run_image_grabber()
+void AsyncImageSourceEngine::initialise()
 {
-  while(!m_grabberShouldTerminate)
-  {
-    boost::unique_lock<boost::mutex> lock(m_mutex);
+  // Record the calibration and image sizes of the first inner source, so that they can be reported while the queue is empty
+  // (the inner sources themselves can't be queried once the grabbers are running, since they're not thread-safe).
+  const ImageSourceEngine_Ptr& firstSource = m_innerSources.front();
+  m_calib = firstSource->getCalib();
+  m_depthImageSize = firstSource->getDepthImageSize();
+  m_rgbImageSize = firstSource->getRGBImageSize();
 
-    // If the queue is full, wait until some images have been consumed or termination is requested.
-    while(!m_grabberShouldTerminate && m_queue.size() >= m_queueCapacity) m_queueNotFull.wait(lock);
-
-    // If we were asked to terminate, do so.
-    if(m_grabberShouldTerminate) return;
+  // Determine the maximum number of RGB-D images to store in the pool.
+  const size_t MAX_POOL_CAPACITY = 60;
+  m_poolCapacity = std::min(m_queueCapacity, MAX_POOL_CAPACITY);
 
-    // If there are no more images available from the inner source, notify anyone waiting for an image and terminate.
-    if(!m_innerSource->hasMoreImages())
+  // If the inner sources have images available, fill the pool to avoid allocating memory at runtime.
+  // If they don't have any images available, there is no need to allocate.
+  if(firstSource->hasMoreImages())
+  {
+    m_pool.reserve(m_poolCapacity);
+    for(size_t i = 0; i < m_poolCapacity; ++i)
     {
-      m_queueNotEmpty.notify_one();
-      return;
+      RGBDImage rgbdImage;
+      rgbdImage.rawDepth.reset(new ORShortImage(m_depthImageSize, true, false));
+      rgbdImage.rgb.reset(new ORUChar4Image(m_rgbImageSize, true, false));
+      m_pool.push_back(rgbdImage);
     }
+  }
 
-    // Construct an RGB-D image into which to copy the data from the inner source.
+  // Start the image grabbers.
+  for(size_t i = 0, size = m_innerSources.size(); i < size; ++i)
+  {
+    m_grabbers.push_back(boost::shared_ptr<boost::thread>(new boost::thread(boost::bind(&AsyncImageSourceEngine::run_image_grabber, this, i))));
+  }
+}
+
+void AsyncImageSourceEngine::run_image_grabber(size_t grabberIndex)
+{
+  const ImageSourceEngine_Ptr& innerSource = m_innerSources[grabberIndex];
+  const size_t grabberCount = m_innerSources.size();
+
+  // Grab every grabberCount'th frame of the sequence, starting from the frame with the same index as the grabber.
+  for(size_t sequenceNumber = grabberIndex;; sequenceNumber += grabberCount)
+  {
     RGBDImage rgbdImage;
-    if(!m_pool.empty())
+
     {
+      boost::unique_lock<boost::mutex> lock(m_mutex);
+
+      // Wait until the frame would fit in the queue (this bounds both the number of cached images and the number of images
+      // that can be waiting out of order), or until we're asked to terminate, or until an earlier frame turns out to be the last.
+      while(!m_grabberShouldTerminate && sequenceNumber < m_endSequenceNumber && sequenceNumber - m_nextSequenceNumber >= m_queueCapacity)
+      {
+        m_spaceAvailable.wait(lock);
+      }
+
+      if(m_grabberShouldTerminate || sequenceNumber >= m_endSequenceNumber) return;
+
       // If possible, reuse an existing RGB-D image from the pool rather than allocating new memory.
-      rgbdImage = m_pool.front();
-      m_pool.pop();
+      if(!m_pool.empty())
+      {
+        rgbdImage = m_pool.back();
+        m_pool.pop_back();
+      }
+    }
 
+    // If there are no more images available from the inner source, record where the sequence ends, notify anyone
+    // waiting for an image and terminate. Note that the inner source is only ever accessed by this grabber, so we
+    // don't need to hold the mutex while reading from it.
+    if(!innerSource->hasMoreImages())
+    {
+      boost::unique_lock<boost::mutex> lock(m_mutex);
+      m_endSequenceNumber = std::min(m_endSequenceNumber, sequenceNumber);
+      if(rgbdImage.rgb && m_pool.size() < m_poolCapacity) m_pool.push_back(rgbdImage);
+      m_imageReady.notify_all();
+      m_spaceAvailable.notify_all();
+      return;
+    }
+
+    if(rgbdImage.rgb)
+    {
       // Ensure that the depth and RGB images have the correct size (this is a no-op unless the size of
       // the images produced by the inner source has changed since we put the RGB-D image in the pool).
-      rgbdImage.rawDepth->ChangeDims(m_innerSource->getDepthImageSize());
-      rgbdImage.rgb->ChangeDims(m_innerSource->getRGBImageSize());
+      rgbdImage.rawDepth->ChangeDims(innerSource->getDepthImageSize());
+      rgbdImage.rgb->ChangeDims(innerSource->getRGBImageSize());
     }
     else
     {
       // If there was no existing image available from the pool, allocate new memory for the RGB-D image.
-      rgbdImage.rawDepth.reset(new ORShortImage(m_innerSource->getDepthImageSize(), true, false));
-      rgbdImage.rgb.reset(new ORUChar4Image(m_innerSource->getRGBImageSize(), true, false));
+      rgbdImage.rawDepth.reset(new ORShortImage(innerSource->getDepthImageSize(), true, false));
+      rgbdImage.rgb.reset(new ORUChar4Image(innerSource->getRGBImageSize(), true, false));
     }
 
     // Get the calibration for the RGB-D image from the inner source.
-    rgbdImage.calib = m_innerSource->getCalib();
+    rgbdImage.calib = innerSource->getCalib();
 
-    // Copy the images from the inner source into the RGB-D image.
-    m_innerSource->getImages(rgbdImage.rgb.get(), rgbdImage.rawDepth.get());
+    // Read the images from the inner source into the RGB-D image.
+    innerSource->getImages(rgbdImage.rgb.get(), rgbdImage.rawDepth.get());
 
-    // Add the RGB-D image to the queue and inform the main thread that images are available.
-    m_queue.push(rgbdImage);
-    m_queueNotEmpty.notify_one();
+    // Add the RGB-D image to the queue and, if it's the one the consumer is waiting for, inform the consumer that it's available.
+    boost::unique_lock<boost::mutex> lock(m_mutex);
+    m_queue[sequenceNumber] = rgbdImage;
+    if(sequenceNumber == m_nextSequenceNumber) m_imageReady.notify_all();
   }
 }
 
@@ -0,0 +1,325 @@
+/**
+ * itmx: RGBDSequenceImageSourceEngine.cpp
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#include "imagesources/RGBDSequenceImageSourceEngine.h"
+using namespace ITMLib;
+namespace bip = boost::interprocess;
+
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+#include <boost/bind.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include <ITMLib/Objects/Camera/ITMCalibIO.h>
+
+namespace itmx {
+
+//#################### CONSTRUCTORS ####################
+
+RGBDSequenceImageSourceEngine::RGBDSequenceImageSourceEngine(const std::string& path, size_t prefetchChunkCount, size_t decoderCount)
+: m_currentFrame(0), m_prefetchChunkCount(prefetchChunkCount), m_shouldTerminate(false)
+{
+  // Map the file into memory.
+  try
+  {
+    bip::file_mapping(path.c_str(), bip::read_only).swap(m_file);
+    bip::mapped_region(m_file, bip::read_only).swap(m_region);
+  }
+  catch(bip::interprocess_exception&)
+  {
+    throw std::runtime_error("Error: Could not open RGB-D sequence file '" + path + "'");
+  }
+
+  const unsigned char *data = static_cast<const unsigned char*>(m_region.get_address());
+  const size_t fileSize = m_region.get_size();
+  const std::string invalid = "Error: '" + path + "' is not a valid RGB-D sequence file";
+
+  // Read and check the file header. Note that the fields are copied out of the mapped region rather than accessed in place,
+  // since the file makes no guarantees about their alignment.
+  RGBDSequenceFormat::FileHeader header;
+  if(fileSize < sizeof(header) + sizeof(RGBDSequenceFormat::FooterTrailer)) throw std::runtime_error(invalid);
+  memcpy(&header, data, sizeof(header));
+  if(memcmp(header.magic, RGBDSequenceFormat::FILE_MAGIC, sizeof(header.magic)) != 0) throw std::runtime_error(invalid);
+  if(header.version != RGBDSequenceFormat::VERSION)
+  {
+    throw std::runtime_error("Error: Unsupported RGB-D sequence file version: " + boost::lexical_cast<std::string>(header.version));
+  }
+
+  m_depthImageSize = Vector2i(header.depthWidth, header.depthHeight);
+  m_rgbImageSize = Vector2i(header.rgbWidth, header.rgbHeight);
+  m_frameSize = RGBDSequenceFormat::frame_size(m_depthImageSize, m_rgbImageSize);
+
+  // Read the calibration.
+  if(fileSize < sizeof(header) + header.calibSize) throw std::runtime_error(invalid);
+  std::istringstream calibStream(std::string(reinterpret_cast<const char*>(data + sizeof(header)), header.calibSize));
+  if(!readRGBDCalib(calibStream, m_calib)) throw std::runtime_error("Error: Could not read the calibration in '" + path + "'");
+
+  // Read the footer trailer, and use it to locate and read the chunk index and the pose records.
+  RGBDSequenceFormat::FooterTrailer trailer;
+  memcpy(&trailer, data + fileSize - sizeof(trailer), sizeof(trailer));
+  if(memcmp(trailer.magic, RGBDSequenceFormat::FOOTER_MAGIC, sizeof(trailer.magic)) != 0)
+  {
+    throw std::runtime_error("Error: '" + path + "' has no index (the recording may not have been closed properly)");
+  }
+
+  const size_t indexSize = trailer.chunkCount * sizeof(RGBDSequenceFormat::ChunkIndexEntry);
+  const size_t posesSize = trailer.frameCount * sizeof(RGBDSequenceFormat::PoseRecord);
+  if(trailer.indexOffset + indexSize + posesSize + sizeof(trailer) != fileSize) throw std::runtime_error(invalid);
+
+  m_chunkIndex.resize(trailer.chunkCount);
+  if(indexSize > 0) memcpy(&m_chunkIndex[0], data + trailer.indexOffset, indexSize);
+
+  m_poses.resize(trailer.frameCount);
+  if(posesSize > 0) memcpy(&m_poses[0], data + trailer.indexOffset + indexSize, posesSize);
+
+  // Check that the chunks cover the frames contiguously, so that find_chunk can rely on it.
+  size_t expectedFirstFrame = 0;
+  for(size_t i = 0, size = m_chunkIndex.size(); i < size; ++i)
+  {
+    const RGBDSequenceFormat::ChunkIndexEntry& entry = m_chunkIndex[i];
+    if(entry.firstFrame != expectedFirstFrame || entry.frameCount == 0 || entry.offset + sizeof(RGBDSequenceFormat::ChunkHeader) > trailer.indexOffset)
+    {
+      throw std::runtime_error(invalid);
+    }
+    expectedFirstFrame += entry.frameCount;
+  }
+  if(expectedFirstFrame != m_poses.size()) throw std::runtime_error(invalid);
+
+  // Start the decoders.
+  if(decoderCount == 0) decoderCount = 1;
+  for(size_t i = 0; i < decoderCount; ++i)
+  {
+    m_decoders.create_thread(boost::bind(&RGBDSequenceImageSourceEngine::run_decoder, this));
+  }
+}
+
+//#################### DESTRUCTOR ####################
+
+RGBDSequenceImageSourceEngine::~RGBDSequenceImageSourceEngine()
+{
+  {
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+    m_shouldTerminate = true;
+  }
+
+  m_workAvailable.notify_all();
+  m_decoders.join_all();
+}
+
+//#################### PUBLIC MEMBER FUNCTIONS ####################
+
+ITMRGBDCalib RGBDSequenceImageSourceEngine::getCalib() const
+{
+  return m_calib;
+}
+
+Vector2i RGBDSequenceImageSourceEngine::getDepthImageSize() const
+{
+  return m_depthImageSize;
+}
+
+void RGBDSequenceImageSourceEngine::getImages(ORUChar4Image *rgb, ORShortImage *rawDepth)
+{
+  if(rgb->noDims != m_rgbImageSize || rawDepth->noDims != m_depthImageSize)
+  {
+    throw std::invalid_argument("Error: The output images must have the same sizes as the images in the RGB-D sequence");
+  }
+
+  Payload_CPtr payload;
+  size_t frameOffset;
+
+  {
+    boost::unique_lock<boost::mutex> lock(m_mutex);
+    if(m_currentFrame >= m_poses.size()) throw std::runtime_error("Error: There are no more images in the RGB-D sequence");
+
+    // Wait for the chunk containing the current frame to be decoded.
+    const size_t chunkIndex = find_chunk(m_currentFrame);
+    std::map<size_t,Payload_CPtr>::const_iterator it;
+    while((it = m_decodedChunks.find(chunkIndex)) == m_decodedChunks.end() && m_decodeError.empty())
+    {
+      m_chunkDecoded.wait(lock);
+    }
+
+    if(it == m_decodedChunks.end()) throw std::runtime_error(m_decodeError);
+
+    payload = it->second;
+    frameOffset = (m_currentFrame - m_chunkIndex[chunkIndex].firstFrame) * m_frameSize;
+
+    // Advance to the next frame, and let the decoders move on if we've finished with the current chunk.
+    ++m_currentFrame;
+    update_prefetch_window();
+  }
+
+  // Copy the frame into the output images. The payload is immutable once decoded and we hold a reference to it,
+  // so we can do this without holding the mutex.
+  const size_t depthBytes = m_depthImageSize.x * m_depthImageSize.y * sizeof(short);
+  memcpy(rawDepth->GetData(MEMORYDEVICE_CPU), &(*payload)[frameOffset], depthBytes);
+  memcpy(rgb->GetData(MEMORYDEVICE_CPU), &(*payload)[frameOffset + depthBytes], m_frameSize - depthBytes);
+}
+
+Vector2i RGBDSequenceImageSourceEngine::getRGBImageSize() const
+{
+  return m_rgbImageSize;
+}
+
+bool RGBDSequenceImageSourceEngine::hasMoreImages() const
+{
+  boost::lock_guard<boost::mutex> lock(m_mutex);
+  return m_currentFrame < m_poses.size();
+}
+
+size_t RGBDSequenceImageSourceEngine::get_current_frame() const
+{
+  boost::lock_guard<boost::mutex> lock(m_mutex);
+  return m_currentFrame;
+}
+
+size_t RGBDSequenceImageSourceEngine::get_frame_count() const
+{
+  return m_poses.size();
+}
+
+boost::optional<Matrix4f> RGBDSequenceImageSourceEngine::get_pose(size_t frameIndex) const
+{
+  const RGBDSequenceFormat::PoseRecord& record = m_poses.at(frameIndex);
+  if(!record.hasPose) return boost::none;
+
+  Matrix4f pose;
+  for(int i = 0; i < 16; ++i) pose.m[i] = record.m[i];
+  return pose;
+}
+
+void RGBDSequenceImageSourceEngine::seek(size_t frameIndex)
+{
+  if(frameIndex > m_poses.size()) throw std::out_of_range("Error: Cannot seek beyond the end of the RGB-D sequence");
+
+  boost::lock_guard<boost::mutex> lock(m_mutex);
+  m_currentFrame = frameIndex;
+  update_prefetch_window();
+}
+
+//#################### PRIVATE MEMBER FUNCTIONS ####################
+
+size_t RGBDSequenceImageSourceEngine::find_chunk(size_t frameIndex) const
+{
+  // Binary search for the last chunk whose first frame is <= frameIndex.
+  size_t lo = 0, hi = m_chunkIndex.size();
+  while(hi - lo > 1)
+  {
+    const size_t mid = (lo + hi) / 2;
+    if(m_chunkIndex[mid].firstFrame <= frameIndex) lo = mid;
+    else hi = mid;
+  }
+  return lo;
+}
+
+void RGBDSequenceImageSourceEngine::run_decoder()
+{
+  std::vector<unsigned char> compressed;
+
+  for(;;)
+  {
+    size_t chunkIndex = 0;
+
+    {
+      boost::unique_lock<boost::mutex> lock(m_mutex);
+
+      // Wait until there's a chunk within the prefetch window that is neither decoded nor being decoded.
+      for(;;)
+      {
+        if(m_shouldTerminate) return;
+
+        bool found = false;
+        if(m_currentFrame < m_poses.size() && m_decodeError.empty())
+        {
+          const size_t firstChunk = find_chunk(m_currentFrame);
+          const size_t lastChunk = std::min(firstChunk + m_prefetchChunkCount, m_chunkIndex.size() - 1);
+          for(size_t i = firstChunk; i <= lastChunk && !found; ++i)
+          {
+            if(m_decodedChunks.find(i) == m_decodedChunks.end() && m_chunksBeingDecoded.find(i) == m_chunksBeingDecoded.end())
+            {
+              chunkIndex = i;
+              found = true;
+            }
+          }
+        }
+
+        if(found) break;
+        m_workAvailable.wait(lock);
+      }
+
+      m_chunksBeingDecoded.insert(chunkIndex);
+    }
+
+    // Decode the chunk straight out of the mapped region.
+    boost::shared_ptr<std::vector<unsigned char> > payload(new std::vector<unsigned char>);
+    std::string error;
+    try
+    {
+      const unsigned char *data = static_cast<const unsigned char*>(m_region.get_address());
+      const RGBDSequenceFormat::ChunkIndexEntry& entry = m_chunkIndex[chunkIndex];
+
+      RGBDSequenceFormat::ChunkHeader header;
+      memcpy(&header, data + entry.offset, sizeof(header));
+      if(header.magic != RGBDSequenceFormat::CHUNK_MAGIC || header.firstFrame != entry.firstFrame || header.frameCount != entry.frameCount ||
+         header.uncompressedSize != entry.frameCount * m_frameSize ||
+         entry.offset + sizeof(header) + header.compressedSize > m_region.get_size())
+      {
+        throw std::runtime_error("Error: Chunk " + boost::lexical_cast<std::string>(chunkIndex) + " of the RGB-D sequence is corrupt");
+      }
+
+      RGBDSequenceFormat::decompress_chunk(
+        data + entry.offset + sizeof(header), static_cast<size_t>(header.compressedSize), static_cast<size_t>(header.uncompressedSize),
+        m_depthImageSize, m_rgbImageSize, *payload
+      );
+    }
+    catch(std::exception& e)
+    {
+      error = e.what();
+    }
+
+    {
+      boost::lock_guard<boost::mutex> lock(m_mutex);
+      m_chunksBeingDecoded.erase(chunkIndex);
+
+      if(!error.empty())
+      {
+        m_decodeError = error;
+      }
+      else
+      {
+        // Only keep the chunk if it's still needed (the consumer may have moved on, or sought elsewhere, in the meantime).
+        m_decodedChunks.insert(std::make_pair(chunkIndex, payload));
+        update_prefetch_window();
+      }
+    }
+
+    m_chunkDecoded.notify_all();
+  }
+}
+
+void RGBDSequenceImageSourceEngine::update_prefetch_window()
+{
+  if(m_currentFrame < m_poses.size())
+  {
+    // Evict any decoded chunks that lie outside the prefetch window.
+    const size_t firstChunk = find_chunk(m_currentFrame);
+    const size_t lastChunk = firstChunk + m_prefetchChunkCount;
+
+    std::map<size_t,Payload_CPtr>::iterator it = m_decodedChunks.begin();
+    while(it != m_decodedChunks.end())
+    {
+      if(it->first < firstChunk || it->first > lastChunk) m_decodedChunks.erase(it++);
+      else ++it;
+    }
+  }
+  else m_decodedChunks.clear();
+
+  m_workAvailable.notify_all();
+}
+
+}
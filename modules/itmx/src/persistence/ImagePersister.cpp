@@ -5,18 +5,286 @@
 
 #include "persistence/ImagePersister.h"
 
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
 #include <stdexcept>
 
+#if defined(__AVX2__) || defined(__SSSE3__)
+  #include <immintrin.h>
+#elif defined(__SSE2__)
+  #include <emmintrin.h>
+#endif
+
 #include <boost/algorithm/string.hpp>
+#include <boost/static_assert.hpp>
 
 #include <lodepng.h>
 
+#ifdef WITH_ZLIB
+  #include <zlib.h>
+#endif
+
 #include <ORUtils/FileUtils.h>
 
 namespace itmx {
 
+// PNG stores RGBA pixels as consecutive R, G, B and A bytes, which is exactly how Vector4u is laid out in memory,
+// so RGBA images can be handed to (and taken from) lodepng without being repacked.
+BOOST_STATIC_ASSERT(sizeof(Vector4u) == 4);
+
+//#################### HELPER FUNCTIONS ####################
+
+/**
+ * \brief Swaps the byte order of each of an array of 16-bit values (PNG stores 16-bit samples in big-endian order).
+ *
+ * \param src   The source array.
+ * \param dest  The destination array (which must not overlap the source array).
+ * \param count The number of 16-bit values in the arrays.
+ */
+static void byte_swap_16(const unsigned char *src, unsigned char *dest, int count)
+{
+  int i = 0;
+
+#if defined(__AVX2__)
+  // Note that _mm256_shuffle_epi8 shuffles within each 128-bit lane, so the mask is the same in both lanes.
+  const __m256i mask256 = _mm256_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14, 1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+  for(; i + 16 <= count; i += 16)
+  {
+    const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i * 2));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + i * 2), _mm256_shuffle_epi8(v, mask256));
+  }
+#endif
+
+#if defined(__SSSE3__)
+  const __m128i mask128 = _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+  for(; i + 8 <= count; i += 8)
+  {
+    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 2));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i * 2), _mm_shuffle_epi8(v, mask128));
+  }
+#elif defined(__SSE2__)
+  // Without SSSE3, swap the bytes using a pair of 16-bit shifts (SSE2 is always available on x86-64).
+  for(; i + 8 <= count; i += 8)
+  {
+    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 2));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i * 2), _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8)));
+  }
+#endif
+
+  for(; i < count; ++i)
+  {
+    dest[i * 2] = src[i * 2 + 1];
+    dest[i * 2 + 1] = src[i * 2];
+  }
+}
+
+#ifdef WITH_ZLIB
+/**
+ * \brief Compresses a buffer in zlib format, splitting it into strips that are compressed in parallel.
+ *
+ * Each strip is compressed as a separate raw deflate stream. All but the last strip are terminated with a sync flush
+ * rather than a final block, so that they end on a byte boundary and the concatenation of the strips is itself a valid
+ * deflate stream (as in pigz). The Adler-32 checksums of the strips are then combined to produce the zlib trailer.
+ * The strip boundaries depend only on the size of the input, so the output does not depend on the number of threads.
+ *
+ * This has the signature expected by lodepng for a custom zlib compressor. The compression level is passed in via
+ * the custom context of the compression settings.
+ *
+ * \param out       A location in which to store a pointer to the (malloc'd) compressed buffer.
+ * \param outSize   A location in which to store the size of the compressed buffer.
+ * \param in        The buffer to compress.
+ * \param inSize    The size of the buffer to compress.
+ * \param settings  The compression settings.
+ * \return          0, if the buffer was successfully compressed, or a non-zero error code otherwise.
+ */
+static unsigned zlib_compress_parallel(unsigned char **out, size_t *outSize, const unsigned char *in, size_t inSize, const LodePNGCompressSettings *settings)
+{
+  const size_t minStripSize = 128 * 1024, maxStripCount = 16;
+  const int level = settings->custom_context ? *static_cast<const int*>(settings->custom_context) : Z_DEFAULT_COMPRESSION;
+  const int stripCount = static_cast<int>(std::max<size_t>(1, std::min(maxStripCount, inSize / minStripSize)));
+  const size_t stripSize = (inSize + stripCount - 1) / stripCount;
+
+  std::vector<std::vector<unsigned char> > strips(stripCount);
+  std::vector<uLong> checksums(stripCount);
+  int failureCount = 0;
+
+#ifdef WITH_OPENMP
+  #pragma omp parallel for reduction(+:failureCount)
+#endif
+  for(int i = 0; i < stripCount; ++i)
+  {
+    const size_t begin = std::min(inSize, i * stripSize), end = std::min(inSize, begin + stripSize);
+    const bool last = i == stripCount - 1;
+
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    if(deflateInit2(&stream, level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+    {
+      ++failureCount;
+      continue;
+    }
+
+    // Allocate enough space for the strip to be compressed in a single call (deflateBound does not account for the sync flush marker).
+    std::vector<unsigned char>& strip = strips[i];
+    strip.resize(deflateBound(&stream, static_cast<uLong>(end - begin)) + 16);
+
+    stream.next_in = const_cast<Bytef*>(in + begin);
+    stream.avail_in = static_cast<uInt>(end - begin);
+    stream.next_out = &strip[0];
+    stream.avail_out = static_cast<uInt>(strip.size());
+
+    const int result = deflate(&stream, last ? Z_FINISH : Z_SYNC_FLUSH);
+    if(result != (last ? Z_STREAM_END : Z_OK) || stream.avail_in != 0) ++failureCount;
+    strip.resize(strip.size() - stream.avail_out);
+    deflateEnd(&stream);
+
+    checksums[i] = adler32(adler32(0L, Z_NULL, 0), in + begin, static_cast<uInt>(end - begin));
+  }
+
+  if(failureCount > 0) return 1;
+
+  // Assemble the zlib stream: a header (deflate with a 32K window, no preset dictionary), the strips, and the combined checksum.
+  size_t totalSize = 2 + 4;
+  for(int i = 0; i < stripCount; ++i) totalSize += strips[i].size();
+
+  unsigned char *result = static_cast<unsigned char*>(malloc(totalSize));
+  if(!result) return 83;
+
+  result[0] = 0x78;
+  result[1] = 0x01;
+
+  uLong checksum = checksums[0];
+  size_t offset = 2;
+  for(int i = 0; i < stripCount; ++i)
+  {
+    if(!strips[i].empty()) memcpy(result + offset, &strips[i][0], strips[i].size());
+    offset += strips[i].size();
+
+    if(i > 0)
+    {
+      const size_t begin = std::min(inSize, i * stripSize), end = std::min(inSize, begin + stripSize);
+      checksum = adler32_combine(checksum, checksums[i], static_cast<z_off_t>(end - begin));
+    }
+  }
+
+  result[offset++] = static_cast<unsigned char>((checksum >> 24) & 0xff);
+  result[offset++] = static_cast<unsigned char>((checksum >> 16) & 0xff);
+  result[offset++] = static_cast<unsigned char>((checksum >> 8) & 0xff);
+  result[offset++] = static_cast<unsigned char>(checksum & 0xff);
+
+  *out = result;
+  *outSize = totalSize;
+  return 0;
+}
+
+/**
+ * \brief Decompresses a zlib buffer using zlib (which is considerably faster than lodepng's own inflater).
+ *
+ * This has the signature expected by lodepng for a custom zlib decompressor.
+ *
+ * \param out       A location in which to store a pointer to the (malloc'd) decompressed buffer.
+ * \param outSize   A location in which to store the size of the decompressed buffer.
+ * \param in        The buffer to decompress.
+ * \param inSize    The size of the buffer to decompress.
+ * \return          0, if the buffer was successfully decompressed, or a non-zero error code otherwise.
+ */
+static unsigned zlib_decompress(unsigned char **out, size_t *outSize, const unsigned char *in, size_t inSize, const LodePNGDecompressSettings *)
+{
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  if(inflateInit(&stream) != Z_OK) return 1;
+
+  stream.next_in = const_cast<Bytef*>(in);
+  stream.avail_in = static_cast<uInt>(inSize);
+
+  // Inflate into a buffer that grows geometrically until the whole stream has been decompressed.
+  size_t capacity = std::max<size_t>(inSize * 4, 1024), size = 0;
+  unsigned char *result = static_cast<unsigned char*>(malloc(capacity));
+  int status = Z_OK;
+  while(result && status == Z_OK)
+  {
+    if(size == capacity)
+    {
+      capacity *= 2;
+      unsigned char *grown = static_cast<unsigned char*>(realloc(result, capacity));
+      if(!grown) { free(result); result = NULL; break; }
+      result = grown;
+    }
+
+    stream.next_out = result + size;
+    stream.avail_out = static_cast<uInt>(capacity - size);
+    status = inflate(&stream, Z_NO_FLUSH);
+    size = capacity - stream.avail_out;
+
+    // Z_BUF_ERROR just means that inflate needs more output space, unless the input has run out.
+    if(status == Z_BUF_ERROR && stream.avail_out == 0) status = Z_OK;
+  }
+
+  inflateEnd(&stream);
+
+  if(!result) return 83;
+  if(status != Z_STREAM_END)
+  {
+    free(result);
+    return 1;
+  }
+
+  *out = result;
+  *outSize = size;
+  return 0;
+}
+#endif
+
 //#################### PUBLIC STATIC MEMBER FUNCTIONS ####################
 
+ORUChar4Image_Ptr ImagePersister::decode_rgba_png(const std::vector<unsigned char>& buffer, const std::string& path)
+{
+  lodepng::State state;
+#ifdef WITH_ZLIB
+  state.decoder.zlibsettings.custom_zlib = &zlib_decompress;
+#endif
+
+  // Decode the PNG (by default, lodepng decodes to 8-bit RGBA).
+  std::vector<unsigned char> data;
+  unsigned int width, height;
+  if(buffer.empty() || lodepng::decode(data, width, height, state, &buffer[0], buffer.size()) != 0)
+  {
+    throw std::runtime_error("Failed to decode PNG from '" + path + "'");
+  }
+
+  // Construct the image. Since the decoded pixels are already laid out as Vector4u, they can simply be copied across.
+  ORUChar4Image_Ptr image(new ORUChar4Image(Vector2i(width, height), true, true));
+  memcpy(image->GetData(MEMORYDEVICE_CPU), &data[0], data.size());
+
+  return image;
+}
+
+void ImagePersister::encode_png(const ORShortImage_CPtr& image, std::vector<unsigned char>& buffer, PNGCompression compression)
+{
+  const int width = image->noDims.x, height = image->noDims.y;
+  std::vector<unsigned char> data(image->dataSize * 2);
+  const unsigned char *src = reinterpret_cast<const unsigned char*>(image->GetData(MEMORYDEVICE_CPU));
+  unsigned char *dest = &data[0];
+
+  // Convert the depths to big-endian order, a row at a time.
+#ifdef WITH_OPENMP
+  #pragma omp parallel for
+#endif
+  for(int y = 0; y < height; ++y)
+  {
+    const int offset = y * width * 2;
+    byte_swap_16(src + offset, dest + offset, width);
+  }
+
+  encode_png_data(dest, image->noDims, 1, 16, compression, buffer);
+}
+
+void ImagePersister::encode_png(const ORUChar4Image_CPtr& image, std::vector<unsigned char>& buffer, PNGCompression compression)
+{
+  encode_png_data(reinterpret_cast<const unsigned char*>(image->GetData(MEMORYDEVICE_CPU)), image->noDims, 4, 8, compression, buffer);
+}
+
 ORUChar4Image_Ptr ImagePersister::load_rgba_image(const std::string& path, ImageFileType fileType)
 {
   // If the image file type wasn't specified, try to deduce it.
@@ -39,7 +307,7 @@ ORUChar4Image_Ptr ImagePersister::load_rgba_image(const std::string& path, Image
   }
 }
 
-void ImagePersister::save_image(const ORShortImage_CPtr& image, const std::string& path, ImageFileType fileType)
+void ImagePersister::save_image(const ORShortImage_CPtr& image, const std::string& path, ImageFileType fileType, PNGCompression compression)
 {
   // If the image file type wasn't specified, try to deduce it.
   if(fileType == IFT_UNKNOWN) fileType = deduce_image_file_type(path);
@@ -55,8 +323,8 @@ void ImagePersister::save_image(const ORShortImage_CPtr& image, const std::strin
     case IFT_PNG:
     {
       std::vector<unsigned char> buffer;
-      encode_png(image, buffer);
-      lodepng::save_file(buffer, path);
+      encode_png(image, buffer, compression);
+      if(lodepng::save_file(buffer, path) != 0) throw std::runtime_error("Could not save PNG image to '" + path + "'");
       break;
     }
     default:
@@ -66,7 +334,7 @@ void ImagePersister::save_image(const ORShortImage_CPtr& image, const std::strin
   }
 }
 
-void ImagePersister::save_image(const ORUChar4Image_CPtr& image, const std::string& path, ImageFileType fileType)
+void ImagePersister::save_image(const ORUChar4Image_CPtr& image, const std::string& path, ImageFileType fileType, PNGCompression compression)
 {
   // If the image file type wasn't specified, try to deduce it.
   if(fileType == IFT_UNKNOWN) fileType = deduce_image_file_type(path);
@@ -77,8 +345,8 @@ void ImagePersister::save_image(const ORUChar4Image_CPtr& image, const std::stri
     case IFT_PNG:
     {
       std::vector<unsigned char> buffer;
-      encode_png(image, buffer);
-      lodepng::save_file(buffer, path);
+      encode_png(image, buffer, compression);
+      if(lodepng::save_file(buffer, path) != 0) throw std::runtime_error("Could not save PNG image to '" + path + "'");
       break;
     }
     case IFT_PPM:
@@ -95,38 +363,6 @@ void ImagePersister::save_image(const ORUChar4Image_CPtr& image, const std::stri
 
 //#################### PRIVATE STATIC MEMBER FUNCTIONS ####################
 
-ORUChar4Image_Ptr ImagePersister::decode_rgba_png(const std::vector<unsigned char>& buffer, const std::string& path)
-{
-  // Decode the PNG.
-  std::vector<unsigned char> data;
-  unsigned int width, height;
-  if(lodepng::decode(data, width, height, buffer) != 0)
-  {
-    throw std::runtime_error("Failed to decode PNG from '" + path + "'");
-  }
-
-  // Construct the image.
-  ORUChar4Image_Ptr image(new ORUChar4Image(Vector2i(width, height), true, true));
-  const int pixelCount = width * height;
-  const unsigned char *src = &data[0];
-  Vector4u *dest = image->GetData(MEMORYDEVICE_CPU);
-
-#ifdef WITH_OPENMP
-  #pragma omp parallel for
-#endif
-  for(int i = 0; i < pixelCount; ++i)
-  {
-    Vector4u& pixel = dest[i];
-    int offset = i * 4;
-    pixel.r = src[offset];
-    pixel.g = src[offset + 1];
-    pixel.b = src[offset + 2];
-    pixel.a = src[offset + 3];
-  }
-
-  return image;
-}
-
 ImagePersister::ImageFileType ImagePersister::deduce_image_file_type(const std::string& path)
 {
   boost::filesystem::path bpath(path);
@@ -141,48 +377,38 @@ ImagePersister::ImageFileType ImagePersister::deduce_image_file_type(const std::
   return IFT_UNKNOWN;
 }
 
-void ImagePersister::encode_png(const ORShortImage_CPtr& image, std::vector<unsigned char>& buffer)
+void ImagePersister::encode_png_data(const unsigned char *data, const Vector2i& size, unsigned int channelCount, unsigned int bitDepth,
+                                     PNGCompression compression, std::vector<unsigned char>& buffer)
 {
-  const int pixelCount = static_cast<int>(image->dataSize);
-  std::vector<unsigned char> data(pixelCount * 2);
-  const short *src = image->GetData(MEMORYDEVICE_CPU);
-  unsigned char *dest = &data[0];
+  const LodePNGColorType colourType = channelCount == 1 ? LCT_GREY : LCT_RGBA;
 
-#ifdef WITH_OPENMP
-  #pragma omp parallel for
-#endif
-  for(int i = 0; i < pixelCount; ++i)
+  // Note that this state is set up in the same way as the one lodepng::encode uses internally,
+  // so that with the default compression mode the output is unchanged.
+  lodepng::State state;
+  state.info_raw.colortype = state.info_png.color.colortype = colourType;
+  state.info_raw.bitdepth = state.info_png.color.bitdepth = bitDepth;
+
+  if(compression == PC_FAST)
   {
-    const unsigned char *pixel = reinterpret_cast<const unsigned char*>(&src[i]);
-    int offset = i * 2;
-    dest[offset] = *(pixel + 1);
-    dest[offset + 1] = *pixel;
+#ifdef WITH_ZLIB
+    // Use zlib's fastest compression level, and compress the image in parallel strips.
+    static const int level = 1;
+    state.encoder.zlibsettings.custom_zlib = &zlib_compress_parallel;
+    state.encoder.zlibsettings.custom_context = &level;
+#else
+    // Make lodepng's own compressor trade some compression for speed (disabling lazy matching and halving the window
+    // makes it roughly twice as fast on typical camera images, at the cost of files that are a few percent larger).
+    state.encoder.zlibsettings.lazymatching = 0;
+    state.encoder.zlibsettings.nicematch = 32;
+    state.encoder.zlibsettings.windowsize = 1024;
+#endif
   }
 
-  lodepng::encode(buffer, &data[0], image->noDims.x, image->noDims.y, LCT_GREY, 16);
-}
-
-void ImagePersister::encode_png(const ORUChar4Image_CPtr& image, std::vector<unsigned char>& buffer)
-{
-  const int pixelCount = static_cast<int>(image->dataSize);
-  std::vector<unsigned char> data(pixelCount * 4);
-  const Vector4u *src = image->GetData(MEMORYDEVICE_CPU);
-  unsigned char *dest = &data[0];
-
-#ifdef WITH_OPENMP
-  #pragma omp parallel for
-#endif
-  for(int i = 0; i < pixelCount; ++i)
+  buffer.clear();
+  if(lodepng::encode(buffer, data, size.x, size.y, state) != 0)
   {
-    const Vector4u& pixel = src[i];
-    int offset = i * 4;
-    dest[offset] = pixel.r;
-    dest[offset + 1] = pixel.g;
-    dest[offset + 2] = pixel.b;
-    dest[offset + 3] = pixel.a;
+    throw std::runtime_error("Failed to encode PNG");
   }
-
-  lodepng::encode(buffer, &data[0], image->noDims.x, image->noDims.y);
 }
 
 }
@@ -17,6 +17,28 @@ namespace itmx {
 
 //#################### PUBLIC STATIC MEMBER FUNCTIONS ####################
 
+Matrix4f PosePersister::load_pose(const std::string& path)
+{
+  // Attempt to open the input file.
+  std::ifstream fs(path.c_str());
+  if(!fs) throw std::runtime_error("Could not open input file: " + path);
+
+  // Read the matrix from the file (see save_pose for the layout).
+  Matrix4f pose;
+  for(int y = 0; y < 4; ++y)
+  {
+    fs >> pose(0, y) >> pose(1, y) >> pose(2, y) >> pose(3, y);
+  }
+
+  if(!fs) throw std::runtime_error("Could not read a pose from input file: " + path);
+  return pose;
+}
+
+Matrix4f PosePersister::load_pose(const bf::path& path)
+{
+  return load_pose(path.string());
+}
+
 void PosePersister::save_pose(const Matrix4f& pose, const std::string& path)
 {
   // Attempt to open the output file.
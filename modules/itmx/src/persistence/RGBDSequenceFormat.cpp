@@ -0,0 +1,98 @@
+/**
+ * itmx: RGBDSequenceFormat.cpp
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#include "persistence/RGBDSequenceFormat.h"
+
+#include <stdexcept>
+
+#include <boost/static_assert.hpp>
+
+#include <lodepng.h>
+
+namespace itmx {
+
+//#################### CONSTANTS ####################
+
+const char RGBDSequenceFormat::FILE_MAGIC[8] = { 'R', 'G', 'B', 'D', 'S', 'E', 'Q', '1' };
+const char RGBDSequenceFormat::FOOTER_MAGIC[8] = { 'R', 'G', 'B', 'D', 'I', 'D', 'X', '1' };
+
+// The on-disk structures are read and written directly, so make sure that the compiler hasn't padded them.
+BOOST_STATIC_ASSERT(sizeof(RGBDSequenceFormat::FileHeader) == 32);
+BOOST_STATIC_ASSERT(sizeof(RGBDSequenceFormat::ChunkHeader) == 32);
+BOOST_STATIC_ASSERT(sizeof(RGBDSequenceFormat::ChunkIndexEntry) == 16);
+BOOST_STATIC_ASSERT(sizeof(RGBDSequenceFormat::PoseRecord) == 68);
+BOOST_STATIC_ASSERT(sizeof(RGBDSequenceFormat::FooterTrailer) == 32);
+
+//#################### PUBLIC STATIC MEMBER FUNCTIONS ####################
+
+void RGBDSequenceFormat::compress_chunk(std::vector<unsigned char>& payload, const Vector2i& depthImageSize, const Vector2i& rgbImageSize, std::vector<unsigned char>& compressed)
+{
+  delta_code(payload, depthImageSize, rgbImageSize, true);
+
+  // Compress the delta-coded payload using zlib. Lazy matching is disabled, since it roughly doubles the compression
+  // time for little benefit on delta-coded images (and the writer needs to keep up with a live camera).
+  LodePNGCompressSettings settings = lodepng_default_compress_settings;
+  settings.lazymatching = 0;
+
+  compressed.clear();
+  if(lodepng::compress(compressed, payload.empty() ? NULL : &payload[0], payload.size(), settings) != 0)
+  {
+    throw std::runtime_error("Error: Could not compress RGB-D sequence chunk");
+  }
+}
+
+void RGBDSequenceFormat::decompress_chunk(const unsigned char *compressed, size_t compressedSize, size_t uncompressedSize,
+                                          const Vector2i& depthImageSize, const Vector2i& rgbImageSize, std::vector<unsigned char>& payload)
+{
+  payload.clear();
+  payload.reserve(uncompressedSize);
+  if(lodepng::decompress(payload, compressed, compressedSize) != 0 || payload.size() != uncompressedSize)
+  {
+    throw std::runtime_error("Error: Could not decompress RGB-D sequence chunk");
+  }
+
+  delta_code(payload, depthImageSize, rgbImageSize, false);
+}
+
+size_t RGBDSequenceFormat::frame_size(const Vector2i& depthImageSize, const Vector2i& rgbImageSize)
+{
+  return depthImageSize.x * depthImageSize.y * sizeof(boost::uint16_t) + rgbImageSize.x * rgbImageSize.y * 4;
+}
+
+//#################### PRIVATE STATIC MEMBER FUNCTIONS ####################
+
+void RGBDSequenceFormat::delta_code(std::vector<unsigned char>& payload, const Vector2i& depthImageSize, const Vector2i& rgbImageSize, bool encode)
+{
+  const size_t frameSize = frame_size(depthImageSize, rgbImageSize);
+  const int frameCount = static_cast<int>(payload.size() / frameSize);
+  const int rowCount = depthImageSize.y + rgbImageSize.y;
+
+#ifdef WITH_OPENMP
+  #pragma omp parallel for
+#endif
+  for(int j = 0; j < frameCount * rowCount; ++j)
+  {
+    const int frameIdx = j / rowCount, rowIdx = j % rowCount;
+    unsigned char *frame = &payload[0] + frameIdx * frameSize;
+
+    if(rowIdx < depthImageSize.y)
+    {
+      // Depth rows are coded as differences between consecutive 16-bit pixels (modulo 2^16).
+      boost::uint16_t *row = reinterpret_cast<boost::uint16_t*>(frame) + rowIdx * depthImageSize.x;
+      if(encode) for(int x = depthImageSize.x - 1; x > 0; --x) row[x] = static_cast<boost::uint16_t>(row[x] - row[x-1]);
+      else for(int x = 1; x < depthImageSize.x; ++x) row[x] = static_cast<boost::uint16_t>(row[x] + row[x-1]);
+    }
+    else
+    {
+      // RGB rows are coded as differences between the corresponding channels of consecutive pixels (modulo 2^8).
+      unsigned char *row = frame + depthImageSize.x * depthImageSize.y * sizeof(boost::uint16_t) + (rowIdx - depthImageSize.y) * rgbImageSize.x * 4;
+      const int rowBytes = rgbImageSize.x * 4;
+      if(encode) for(int x = rowBytes - 1; x >= 4; --x) row[x] = static_cast<unsigned char>(row[x] - row[x-4]);
+      else for(int x = 4; x < rowBytes; ++x) row[x] = static_cast<unsigned char>(row[x] + row[x-4]);
+    }
+  }
+}
+
+}
@@ -0,0 +1,236 @@
+/**
+ * itmx: RGBDSequenceWriter.cpp
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#include "persistence/RGBDSequenceWriter.h"
+
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#include <boost/bind.hpp>
+
+#include <ITMLib/Objects/Camera/ITMCalibIO.h>
+
+namespace itmx {
+
+//#################### CONSTRUCTORS ####################
+
+RGBDSequenceWriter::RGBDSequenceWriter(const std::string& path, const ITMLib::ITMRGBDCalib& calib, const Vector2i& rgbImageSize,
+                                       const Vector2i& depthImageSize, size_t framesPerChunk)
+: m_closed(false),
+  m_currentChunkFrameCount(0),
+  m_depthImageSize(depthImageSize),
+  m_frameSize(RGBDSequenceFormat::frame_size(depthImageSize, rgbImageSize)),
+  m_framesPerChunk(framesPerChunk > 0 ? framesPerChunk : 1),
+  m_os(path.c_str(), std::ios::binary),
+  m_pendingChunkFirstFrame(0),
+  m_pendingChunkFrameCount(0),
+  m_rgbImageSize(rgbImageSize),
+  m_shouldTerminate(false)
+{
+  if(!m_os) throw std::runtime_error("Error: Could not open RGB-D sequence file '" + path + "' for writing");
+
+  // Write the file header, followed by the calibration.
+  std::ostringstream calibStream;
+  ITMLib::writeRGBDCalib(calibStream, calib);
+  const std::string calibText = calibStream.str();
+
+  RGBDSequenceFormat::FileHeader header;
+  memcpy(header.magic, RGBDSequenceFormat::FILE_MAGIC, sizeof(header.magic));
+  header.version = RGBDSequenceFormat::VERSION;
+  header.depthWidth = depthImageSize.x;
+  header.depthHeight = depthImageSize.y;
+  header.rgbWidth = rgbImageSize.x;
+  header.rgbHeight = rgbImageSize.y;
+  header.calibSize = static_cast<boost::uint32_t>(calibText.size());
+
+  m_os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  m_os.write(calibText.c_str(), calibText.size());
+
+  m_currentChunk.reserve(m_framesPerChunk * m_frameSize);
+
+  // Start the chunk writer.
+  m_chunkWriter = boost::thread(boost::bind(&RGBDSequenceWriter::run_chunk_writer, this));
+}
+
+//#################### DESTRUCTOR ####################
+
+RGBDSequenceWriter::~RGBDSequenceWriter()
+{
+  try
+  {
+    close();
+  }
+  catch(std::exception& e)
+  {
+    std::cerr << "Warning: Could not finish writing RGB-D sequence: " << e.what() << '\n';
+  }
+}
+
+//#################### PUBLIC MEMBER FUNCTIONS ####################
+
+void RGBDSequenceWriter::close()
+{
+  if(m_closed) return;
+  m_closed = true;
+
+  // Hand any partially-filled chunk over to the chunk writer, and then wait for the chunk writer to finish.
+  // Note that the chunk writer must be stopped even if handing over the chunk fails.
+  std::string error;
+  try
+  {
+    flush_current_chunk();
+  }
+  catch(std::exception& e)
+  {
+    error = e.what();
+  }
+
+  {
+    boost::unique_lock<boost::mutex> lock(m_mutex);
+    m_shouldTerminate = true;
+    m_chunkChanged.notify_all();
+  }
+
+  m_chunkWriter.join();
+
+  if(error.empty()) error = m_writeError;
+  if(!error.empty()) throw std::runtime_error(error);
+
+  // Write the footer: the chunk index, then the pose records, then the trailer.
+  RGBDSequenceFormat::FooterTrailer trailer;
+  trailer.indexOffset = static_cast<boost::uint64_t>(m_os.tellp());
+  trailer.chunkCount = m_chunkIndex.size();
+  trailer.frameCount = m_poses.size();
+  memcpy(trailer.magic, RGBDSequenceFormat::FOOTER_MAGIC, sizeof(trailer.magic));
+
+  if(!m_chunkIndex.empty()) m_os.write(reinterpret_cast<const char*>(&m_chunkIndex[0]), m_chunkIndex.size() * sizeof(RGBDSequenceFormat::ChunkIndexEntry));
+  if(!m_poses.empty()) m_os.write(reinterpret_cast<const char*>(&m_poses[0]), m_poses.size() * sizeof(RGBDSequenceFormat::PoseRecord));
+  m_os.write(reinterpret_cast<const char*>(&trailer), sizeof(trailer));
+
+  m_os.close();
+  if(!m_os) throw std::runtime_error("Error: Could not write the footer of the RGB-D sequence file");
+}
+
+size_t RGBDSequenceWriter::get_frame_count() const
+{
+  return m_poses.size();
+}
+
+void RGBDSequenceWriter::write_frame(const ORUChar4Image_CPtr& rgb, const ORShortImage_CPtr& depth, const boost::optional<Matrix4f>& pose)
+{
+  if(m_closed) throw std::runtime_error("Error: Cannot write a frame to an RGB-D sequence writer that has been closed");
+
+  if(depth->noDims != m_depthImageSize || rgb->noDims != m_rgbImageSize)
+  {
+    throw std::invalid_argument("Error: The images in a frame must have the same sizes as the other images in the RGB-D sequence");
+  }
+
+  // Append the depth and RGB images to the current chunk.
+  const size_t depthBytes = m_depthImageSize.x * m_depthImageSize.y * sizeof(short);
+  const size_t offset = m_currentChunk.size();
+  m_currentChunk.resize(offset + m_frameSize);
+  memcpy(&m_currentChunk[offset], depth->GetData(MEMORYDEVICE_CPU), depthBytes);
+  memcpy(&m_currentChunk[offset + depthBytes], rgb->GetData(MEMORYDEVICE_CPU), m_frameSize - depthBytes);
+
+  // Record the pose (if any).
+  RGBDSequenceFormat::PoseRecord poseRecord;
+  poseRecord.hasPose = pose ? 1 : 0;
+  for(int i = 0; i < 16; ++i) poseRecord.m[i] = pose ? pose->m[i] : 0.0f;
+  m_poses.push_back(poseRecord);
+
+  // If the current chunk is now full, hand it over to the chunk writer.
+  if(++m_currentChunkFrameCount == m_framesPerChunk) flush_current_chunk();
+}
+
+//#################### PRIVATE MEMBER FUNCTIONS ####################
+
+void RGBDSequenceWriter::flush_current_chunk()
+{
+  if(m_currentChunkFrameCount == 0) return;
+
+  {
+    boost::unique_lock<boost::mutex> lock(m_mutex);
+
+    // Wait for the chunk writer to finish writing any previous chunk.
+    while(m_pendingChunkFrameCount > 0 && m_writeError.empty()) m_chunkChanged.wait(lock);
+    if(!m_writeError.empty()) throw std::runtime_error(m_writeError);
+
+    // Swap the current chunk with the (now free) pending chunk buffer, so that neither buffer needs to be reallocated.
+    m_pendingChunk.swap(m_currentChunk);
+    m_pendingChunkFirstFrame = m_poses.size() - m_currentChunkFrameCount;
+    m_pendingChunkFrameCount = m_currentChunkFrameCount;
+    m_chunkChanged.notify_all();
+  }
+
+  m_currentChunk.clear();
+  m_currentChunkFrameCount = 0;
+}
+
+void RGBDSequenceWriter::run_chunk_writer()
+{
+  std::vector<unsigned char> compressed;
+
+  for(;;)
+  {
+    size_t firstFrame, frameCount;
+
+    {
+      boost::unique_lock<boost::mutex> lock(m_mutex);
+      while(m_pendingChunkFrameCount == 0 && !m_shouldTerminate) m_chunkChanged.wait(lock);
+      if(m_pendingChunkFrameCount == 0) return;
+
+      firstFrame = m_pendingChunkFirstFrame;
+      frameCount = m_pendingChunkFrameCount;
+    }
+
+    // Compress the pending chunk and append it to the file. Note that the caller won't touch the pending chunk
+    // until we've finished with it, so we don't need to hold the mutex while doing this.
+    std::string error;
+    try
+    {
+      const size_t uncompressedSize = m_pendingChunk.size();
+      RGBDSequenceFormat::compress_chunk(m_pendingChunk, m_depthImageSize, m_rgbImageSize, compressed);
+
+      RGBDSequenceFormat::ChunkHeader header;
+      header.magic = RGBDSequenceFormat::CHUNK_MAGIC;
+      header.firstFrame = static_cast<boost::uint32_t>(firstFrame);
+      header.frameCount = static_cast<boost::uint32_t>(frameCount);
+      header.reserved = 0;
+      header.compressedSize = compressed.size();
+      header.uncompressedSize = uncompressedSize;
+
+      RGBDSequenceFormat::ChunkIndexEntry entry;
+      entry.offset = static_cast<boost::uint64_t>(m_os.tellp());
+      entry.firstFrame = header.firstFrame;
+      entry.frameCount = header.frameCount;
+
+      m_os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+      m_os.write(reinterpret_cast<const char*>(&compressed[0]), compressed.size());
+      if(!m_os) throw std::runtime_error("Error: Could not write a chunk to the RGB-D sequence file");
+
+      m_chunkIndex.push_back(entry);
+    }
+    catch(std::exception& e)
+    {
+      error = e.what();
+    }
+
+    // Mark the pending chunk buffer as free and wake the caller (if it's waiting for it).
+    boost::unique_lock<boost::mutex> lock(m_mutex);
+    m_pendingChunkFrameCount = 0;
+    if(!error.empty())
+    {
+      m_writeError = error;
+      m_chunkChanged.notify_all();
+      return;
+    }
+
+    m_chunkChanged.notify_all();
+  }
+}
+
+}
@@ -0,0 +1,272 @@
+/**
+ * itmx: SequenceRecorder.cpp
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#include "persistence/SequenceRecorder.h"
+
+#include <iostream>
+#include <stdexcept>
+
+#include <boost/bind.hpp>
+
+#include "persistence/ImagePersister.h"
+#include "persistence/PosePersister.h"
+
+namespace bf = boost::filesystem;
+
+namespace itmx {
+
+//#################### NESTED TYPES ####################
+
+SequenceRecorder::Frame::Frame()
+: m_depthImageCount(0), m_rgbImageCount(0), m_sequenceNumber(0)
+{}
+
+void SequenceRecorder::Frame::add_image(const ORShortImage_CPtr& image, const bf::path& path)
+{
+  // Reuse an existing depth image buffer if possible, or allocate a new one otherwise.
+  if(m_depthImageCount == m_depthImages.size()) m_depthImages.push_back(ORShortImage_Ptr(new ORShortImage(image->noDims, true, false)));
+  const ORShortImage_Ptr& buffer = m_depthImages[m_depthImageCount++];
+
+  buffer->ChangeDims(image->noDims);
+  buffer->SetFrom(image.get(), ORShortImage::CPU_TO_CPU);
+  m_depthImagePaths.push_back(path);
+}
+
+void SequenceRecorder::Frame::add_image(const ORUChar4Image_CPtr& image, const bf::path& path)
+{
+  // Reuse an existing RGB image buffer if possible, or allocate a new one otherwise.
+  if(m_rgbImageCount == m_rgbImages.size()) m_rgbImages.push_back(ORUChar4Image_Ptr(new ORUChar4Image(image->noDims, true, false)));
+  const ORUChar4Image_Ptr& buffer = m_rgbImages[m_rgbImageCount++];
+
+  buffer->ChangeDims(image->noDims);
+  buffer->SetFrom(image.get(), ORUChar4Image::CPU_TO_CPU);
+  m_rgbImagePaths.push_back(path);
+}
+
+void SequenceRecorder::Frame::add_pose(const Matrix4f& pose, const bf::path& path)
+{
+  m_poses.push_back(pose);
+  m_posePaths.push_back(path);
+}
+
+std::vector<bf::path> SequenceRecorder::Frame::get_paths() const
+{
+  std::vector<bf::path> paths(m_depthImagePaths.begin(), m_depthImagePaths.end());
+  paths.insert(paths.end(), m_rgbImagePaths.begin(), m_rgbImagePaths.end());
+  paths.insert(paths.end(), m_posePaths.begin(), m_posePaths.end());
+  return paths;
+}
+
+void SequenceRecorder::Frame::reset()
+{
+  m_depthImageCount = m_rgbImageCount = 0;
+  m_depthImagePaths.clear();
+  m_posePaths.clear();
+  m_poses.clear();
+  m_rgbImagePaths.clear();
+}
+
+void SequenceRecorder::Frame::save() const
+{
+  // Note that we use the fast PNG compression mode, since the encoders need to keep up with a live camera.
+  for(size_t i = 0; i < m_depthImageCount; ++i)
+  {
+    ImagePersister::save_image(ORShortImage_CPtr(m_depthImages[i]), make_temporary_path(m_depthImagePaths[i]).string(), ImagePersister::IFT_UNKNOWN, ImagePersister::PC_FAST);
+  }
+
+  for(size_t i = 0; i < m_rgbImageCount; ++i)
+  {
+    ImagePersister::save_image(ORUChar4Image_CPtr(m_rgbImages[i]), make_temporary_path(m_rgbImagePaths[i]).string(), ImagePersister::IFT_UNKNOWN, ImagePersister::PC_FAST);
+  }
+
+  for(size_t i = 0, size = m_poses.size(); i < size; ++i)
+  {
+    PosePersister::save_pose(m_poses[i], make_temporary_path(m_posePaths[i]));
+  }
+}
+
+//#################### CONSTRUCTORS ####################
+
+SequenceRecorder::SequenceRecorder(size_t frameBufferCount, size_t encoderCount, OverflowPolicy overflowPolicy)
+: m_droppedFrameCount(0),
+  m_nextFinalisedSequenceNumber(0),
+  m_nextSequenceNumber(0),
+  m_overflowPolicy(overflowPolicy),
+  m_shouldTerminate(false)
+{
+  if(frameBufferCount == 0) throw std::invalid_argument("Error: A sequence recorder needs at least one frame buffer");
+  if(encoderCount == 0) throw std::invalid_argument("Error: A sequence recorder needs at least one encoder");
+
+  for(size_t i = 0; i < frameBufferCount; ++i)
+  {
+    m_freeFrames.push_back(Frame_Ptr(new Frame));
+  }
+
+  for(size_t i = 0; i < encoderCount; ++i)
+  {
+    m_encoders.create_thread(boost::bind(&SequenceRecorder::run_encoder, this));
+  }
+}
+
+//#################### DESTRUCTOR ####################
+
+SequenceRecorder::~SequenceRecorder()
+{
+  // Tell the encoders to terminate once they have saved all of the frames that have been submitted.
+  {
+    boost::unique_lock<boost::mutex> lock(m_mutex);
+    m_shouldTerminate = true;
+  }
+
+  m_frameSubmitted.notify_all();
+
+  // Wait for the encoders to terminate.
+  m_encoders.join_all();
+}
+
+//#################### PUBLIC STATIC MEMBER FUNCTIONS ####################
+
+SequenceRecorder_Ptr SequenceRecorder::make_from_settings(const Settings_CPtr& settings)
+{
+  const std::string settingsNamespace = "SequenceRecorder.";
+  const size_t frameBufferCount = settings->get_first_value<size_t>(settingsNamespace + "frameBufferCount", 8);
+  const size_t encoderCount = settings->get_first_value<size_t>(settingsNamespace + "encoderCount", 2);
+  const bool blockWhenFull = settings->get_first_value<bool>(settingsNamespace + "blockWhenFull", false);
+  return SequenceRecorder_Ptr(new SequenceRecorder(frameBufferCount, encoderCount, blockWhenFull ? OP_BLOCK : OP_DROP));
+}
+
+//#################### PUBLIC MEMBER FUNCTIONS ####################
+
+SequenceRecorder::Frame_Ptr SequenceRecorder::begin_frame()
+{
+  boost::unique_lock<boost::mutex> lock(m_mutex);
+
+  if(m_freeFrames.empty())
+  {
+    // If no buffer is free and we're allowed to drop frames, drop this one.
+    if(m_overflowPolicy == OP_DROP)
+    {
+      ++m_droppedFrameCount;
+      return Frame_Ptr();
+    }
+
+    // Otherwise, wait for a buffer to become free.
+    while(m_freeFrames.empty()) m_frameFreed.wait(lock);
+  }
+
+  Frame_Ptr frame = m_freeFrames.back();
+  m_freeFrames.pop_back();
+  return frame;
+}
+
+void SequenceRecorder::flush()
+{
+  boost::unique_lock<boost::mutex> lock(m_mutex);
+  while(m_nextFinalisedSequenceNumber < m_nextSequenceNumber) m_frameFreed.wait(lock);
+}
+
+size_t SequenceRecorder::get_dropped_frame_count() const
+{
+  boost::unique_lock<boost::mutex> lock(m_mutex);
+  return m_droppedFrameCount;
+}
+
+size_t SequenceRecorder::get_queue_depth() const
+{
+  boost::unique_lock<boost::mutex> lock(m_mutex);
+  return m_nextSequenceNumber - m_nextFinalisedSequenceNumber;
+}
+
+void SequenceRecorder::submit_frame(const Frame_Ptr& frame)
+{
+  boost::unique_lock<boost::mutex> lock(m_mutex);
+  frame->m_sequenceNumber = m_nextSequenceNumber++;
+  m_encodeQueue.push_back(frame);
+  m_frameSubmitted.notify_one();
+}
+
+//#################### PRIVATE MEMBER FUNCTIONS ####################
+
+void SequenceRecorder::finalise_frames()
+{
+  // Only one thread may finalise frames at a time, since otherwise two threads could rename the files of consecutive frames concurrently.
+  boost::unique_lock<boost::mutex> finalisationLock(m_finalisationMutex);
+
+  for(;;)
+  {
+    // If the next frame in sequence hasn't been saved yet, stop (the thread that saves it will carry on from here).
+    Frame_Ptr frame;
+    {
+      boost::unique_lock<boost::mutex> lock(m_mutex);
+      std::map<size_t,Frame_Ptr>::iterator it = m_encodedFrames.find(m_nextFinalisedSequenceNumber);
+      if(it == m_encodedFrames.end()) return;
+      frame = it->second;
+      m_encodedFrames.erase(it);
+    }
+
+    // Rename the frame's files to their final paths. If a file is missing, it's because it couldn't be saved,
+    // in which case a warning will already have been printed, so we simply skip it.
+    const std::vector<bf::path> paths = frame->get_paths();
+    for(size_t i = 0, size = paths.size(); i < size; ++i)
+    {
+      boost::system::error_code ec;
+      bf::rename(make_temporary_path(paths[i]), paths[i], ec);
+    }
+
+    // Free the frame's buffer and inform anyone waiting for a buffer (or for a flush) that it's available.
+    {
+      boost::unique_lock<boost::mutex> lock(m_mutex);
+      frame->reset();
+      m_freeFrames.push_back(frame);
+      ++m_nextFinalisedSequenceNumber;
+      m_frameFreed.notify_all();
+    }
+  }
+}
+
+void SequenceRecorder::run_encoder()
+{
+  for(;;)
+  {
+    // Wait for a frame to be submitted. If there are no more frames to save and we've been asked to terminate, do so.
+    Frame_Ptr frame;
+    {
+      boost::unique_lock<boost::mutex> lock(m_mutex);
+      while(m_encodeQueue.empty() && !m_shouldTerminate) m_frameSubmitted.wait(lock);
+      if(m_encodeQueue.empty()) return;
+
+      frame = m_encodeQueue.front();
+      m_encodeQueue.pop_front();
+    }
+
+    // Save the frame to its temporary paths.
+    try
+    {
+      frame->save();
+    }
+    catch(std::exception& e)
+    {
+      std::cerr << "Warning: Could not save frame " << frame->m_sequenceNumber << " of the sequence: " << e.what() << '\n';
+    }
+
+    // Mark the frame as saved, and finalise it (and any subsequent frames that are waiting for it) if possible.
+    {
+      boost::unique_lock<boost::mutex> lock(m_mutex);
+      m_encodedFrames.insert(std::make_pair(frame->m_sequenceNumber, frame));
+    }
+
+    finalise_frames();
+  }
+}
+
+//#################### PRIVATE STATIC MEMBER FUNCTIONS ####################
+
+bf::path SequenceRecorder::make_temporary_path(const bf::path& path)
+{
+  // Note that we keep the file's extension, since it determines the format in which the file will be saved.
+  return path.parent_path() / ("." + path.filename().string());
+}
+
+}
@@ -0,0 +1,67 @@
+/**
+ * itmx: RelocalisationSequence.cpp
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#include "relocalisation/RelocalisationSequence.h"
+
+#include <stdexcept>
+
+#include <boost/format.hpp>
+
+#include <InputSource/ImageSourceEngine.h>
+using namespace InputSource;
+
+#include "persistence/PosePersister.h"
+
+namespace itmx {
+
+//#################### CONSTRUCTORS ####################
+
+RelocalisationSequence::RelocalisationSequence(const std::string& calibrationFilename, const std::string& rgbImageMask, const std::string& depthImageMask,
+                                               const std::string& poseFileMask, size_t frameStep, size_t maxFrameCount)
+{
+  if(frameStep == 0) throw std::runtime_error("Error: The frame step for a relocalisation sequence must be non-zero");
+
+  ImageMaskPathGenerator pathGenerator(rgbImageMask.c_str(), depthImageMask.c_str());
+  ImageFileReader<ImageMaskPathGenerator> reader(calibrationFilename.c_str(), pathGenerator);
+  m_calib = reader.getCalib();
+
+  const Vector2i rgbImageSize = reader.getRGBImageSize(), depthImageSize = reader.getDepthImageSize();
+  for(size_t index = 0; reader.hasMoreImages() && (maxFrameCount == 0 || m_frames.size() < maxFrameCount); ++index)
+  {
+    // Note: The images are read even for frames that are skipped, since the reader can only advance by reading them.
+    ORUChar4Image_Ptr rgbImage(new ORUChar4Image(rgbImageSize, true, false));
+    ORShortImage_Ptr depthImage(new ORShortImage(depthImageSize, true, false));
+    reader.getImages(rgbImage.get(), depthImage.get());
+    if(index % frameStep != 0) continue;
+
+    Frame frame;
+    frame.cameraToWorld = PosePersister::load_pose((boost::format(poseFileMask) % index).str());
+    frame.depthImage = depthImage;
+    frame.index = index;
+    frame.rgbImage = rgbImage;
+    m_frames.push_back(frame);
+  }
+
+  if(m_frames.empty()) throw std::runtime_error("Error: Could not load any frames from the sequence with RGB mask '" + rgbImageMask + "'");
+}
+
+//#################### PUBLIC MEMBER FUNCTIONS ####################
+
+const ITMLib::ITMRGBDCalib& RelocalisationSequence::get_calib() const
+{
+  return m_calib;
+}
+
+const RelocalisationSequence::Frame& RelocalisationSequence::get_frame(size_t i) const
+{
+  return m_frames[i];
+}
+
+size_t RelocalisationSequence::get_frame_count() const
+{
+  return m_frames.size();
+}
+
+}
@@ -0,0 +1,305 @@
+/**
+ * itmx: RelocaliserBenchmark.cpp
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#include "relocalisation/RelocaliserBenchmark.h"
+using namespace ITMLib;
+using namespace orx;
+using namespace tvgutil;
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <limits>
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+#include <boost/chrono.hpp>
+
+#include <ITMLib/Engines/ViewBuilding/ITMViewBuilderFactory.h>
+
+#include <orx/base/MemoryBlockFactory.h>
+
+#include <tvgutil/timing/AverageTimer.h>
+
+#include "base/ITMObjectPtrTypes.h"
+
+namespace itmx {
+
+//#################### TYPEDEFS ####################
+
+typedef AverageTimer<boost::chrono::microseconds> StageTimer;
+
+//#################### HELPER FUNCTIONS ####################
+
+/**
+ * \brief Computes the translational and angular differences between two camera-to-world poses.
+ *
+ * \param gtPose              The ground truth pose.
+ * \param pose                The pose to compare against the ground truth.
+ * \param translationalError  A place in which to store the distance (in metres) between the two camera positions.
+ * \param angularErrorDeg     A place in which to store the angle (in degrees) of the rotation between the two camera orientations.
+ */
+static void compute_pose_errors(const Matrix4f& gtPose, const Matrix4f& pose, float& translationalError, float& angularErrorDeg)
+{
+  const Vector3f dt(gtPose(3,0) - pose(3,0), gtPose(3,1) - pose(3,1), gtPose(3,2) - pose(3,2));
+  translationalError = length(dt);
+
+  // The angle of the relative rotation R_gt^T * R can be recovered from its trace, which is the sum of the dot products of the columns of the two rotations.
+  float trace = 0.0f;
+  for(int c = 0; c < 3; ++c)
+  {
+    for(int r = 0; r < 3; ++r) trace += gtPose(c,r) * pose(c,r);
+  }
+
+  const float cosAngle = std::max(-1.0f, std::min(1.0f, (trace - 1.0f) / 2.0f));
+  angularErrorDeg = static_cast<float>(std::acos(cosAngle) * 180.0 / M_PI);
+}
+
+/**
+ * \brief Gets the peak resident set size of the process so far.
+ *
+ * \return  The peak resident set size (in bytes), or 0 if it is not available on this platform.
+ */
+static size_t get_peak_resident_bytes()
+{
+#if defined(__linux__) || defined(__APPLE__)
+  struct rusage usage;
+  if(getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#if defined(__APPLE__)
+  return static_cast<size_t>(usage.ru_maxrss);
+#else
+  return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+#else
+  return 0;
+#endif
+}
+
+/**
+ * \brief Gets the number of milliseconds taken by the last run of a stage.
+ *
+ * \param timer The timer for the stage.
+ * \return      The number of milliseconds taken by the last run of the stage.
+ */
+static double last_ms(const StageTimer& timer)
+{
+  return timer.last_duration().count() / 1000.0;
+}
+
+/**
+ * \brief Copies the images for a frame into the working images used to train or test the relocaliser.
+ *
+ * \param frame           The frame.
+ * \param calib           The calibration parameters for the camera that captured the frame.
+ * \param viewBuilder     The view builder to use to convert the raw depth image to a float depth image.
+ * \param deviceType      The device on which the relocaliser expects its input images.
+ * \param rgbImage        The working colour image.
+ * \param rawDepthImage   The working raw depth image.
+ * \param depthImage      The working float depth image.
+ */
+static void prepare_images(const RelocalisationSequence::Frame& frame, const ITMRGBDCalib& calib, const ViewBuilder_Ptr& viewBuilder, DeviceType deviceType,
+                           const ORUChar4Image_Ptr& rgbImage, const ORShortImage_Ptr& rawDepthImage, const ORFloatImage_Ptr& depthImage)
+{
+  rgbImage->ChangeDims(frame.rgbImage->noDims);
+  rawDepthImage->ChangeDims(frame.depthImage->noDims);
+  depthImage->ChangeDims(frame.depthImage->noDims);
+
+  rgbImage->SetFrom(frame.rgbImage.get(), ORUtils::MemoryBlock<Vector4u>::CPU_TO_CPU);
+  rawDepthImage->SetFrom(frame.depthImage.get(), ORUtils::MemoryBlock<short>::CPU_TO_CPU);
+
+  if(deviceType == DEVICE_CUDA)
+  {
+    rgbImage->UpdateDeviceFromHost();
+    rawDepthImage->UpdateDeviceFromHost();
+  }
+
+  viewBuilder->ConvertDepthAffineToFloat(depthImage.get(), rawDepthImage.get(), calib.disparityCalib.GetParams());
+}
+
+/**
+ * \brief Updates the peak amounts of memory held by blocks made by the memory block factory.
+ *
+ * \param peakHostBytes   The peak amount of host memory seen so far (updated in place).
+ * \param peakDeviceBytes The peak amount of device memory seen so far (updated in place).
+ */
+static void update_peak_block_bytes(size_t& peakHostBytes, size_t& peakDeviceBytes)
+{
+  const std::vector<MemoryBlockFactory::TagUsage> usage = MemoryBlockFactory::instance().get_usage();
+
+  size_t hostBytes = 0, deviceBytes = 0;
+  for(size_t i = 0, size = usage.size(); i < size; ++i)
+  {
+    hostBytes += usage[i].hostBytes;
+    deviceBytes += usage[i].deviceBytes;
+  }
+
+  peakHostBytes = std::max(peakHostBytes, hostBytes);
+  peakDeviceBytes = std::max(peakDeviceBytes, deviceBytes);
+}
+
+//#################### PUBLIC STATIC MEMBER FUNCTIONS ####################
+
+RelocaliserBenchmark::Results RelocaliserBenchmark::run(const Relocaliser_Ptr& relocaliser, const RelocalisationSequence& trainingSequence,
+                                                        const RelocalisationSequence& testingSequence, DeviceType deviceType)
+{
+  typedef boost::chrono::steady_clock Clock;
+
+  // The maximum errors allowed for a frame to count as having been relocalised successfully (5cm/5deg).
+  const float maxTranslationalError = 0.05f;
+  const float maxAngularErrorDeg = 5.0f;
+
+  Results results;
+  results.peakDeviceBlockBytes = results.peakHostBlockBytes = 0;
+
+  // Make the working images into which the frames will be copied before being passed to the relocaliser.
+  const MemoryBlockFactory& mbf = MemoryBlockFactory::instance();
+  ORUChar4Image_Ptr rgbImage = mbf.make_image<Vector4u>(Vector2i(0, 0), "RelocaliserBenchmark");
+  ORShortImage_Ptr rawDepthImage = mbf.make_image<short>(Vector2i(0, 0), "RelocaliserBenchmark");
+  ORFloatImage_Ptr depthImage = mbf.make_image<float>(Vector2i(0, 0), "RelocaliserBenchmark");
+
+  StageTimer prepareTimer("Prepare"), trainTimer("Train"), finishTrainingTimer("FinishTraining"), relocaliseTimer("Relocalise");
+  std::vector<double> prepareMs, trainMs, relocaliseMs;
+
+  // Train the relocaliser on each frame of the training sequence.
+  {
+    const ITMRGBDCalib& calib = trainingSequence.get_calib();
+    const Vector4f depthIntrinsics = calib.intrinsics_d.projectionParamsSimple.all;
+    ViewBuilder_Ptr viewBuilder(ITMViewBuilderFactory::MakeViewBuilder(calib, deviceType));
+
+    const Clock::time_point start = Clock::now();
+    for(size_t i = 0, frameCount = trainingSequence.get_frame_count(); i < frameCount; ++i)
+    {
+      const RelocalisationSequence::Frame& frame = trainingSequence.get_frame(i);
+
+      prepareTimer.start_sync();
+      prepare_images(frame, calib, viewBuilder, deviceType, rgbImage, rawDepthImage, depthImage);
+      prepareTimer.stop_sync();
+      prepareMs.push_back(last_ms(prepareTimer));
+
+      ORUtils::SE3Pose cameraPose;
+      cameraPose.SetInvM(frame.cameraToWorld);
+
+      trainTimer.start_sync();
+      relocaliser->train(rgbImage.get(), depthImage.get(), depthIntrinsics, cameraPose);
+      trainTimer.stop_sync();
+      trainMs.push_back(last_ms(trainTimer));
+
+      update_peak_block_bytes(results.peakHostBlockBytes, results.peakDeviceBlockBytes);
+    }
+
+    finishTrainingTimer.start_sync();
+    relocaliser->finish_training();
+    finishTrainingTimer.stop_sync();
+
+    const double seconds = boost::chrono::duration<double>(Clock::now() - start).count();
+    results.trainingFramesPerSecond = trainingSequence.get_frame_count() / seconds;
+  }
+
+  // Ask the relocaliser to relocalise each frame of the testing sequence.
+  {
+    const ITMRGBDCalib& calib = testingSequence.get_calib();
+    const Vector4f depthIntrinsics = calib.intrinsics_d.projectionParamsSimple.all;
+    ViewBuilder_Ptr viewBuilder(ITMViewBuilderFactory::MakeViewBuilder(calib, deviceType));
+
+    size_t successCount = 0;
+    const Clock::time_point start = Clock::now();
+    for(size_t i = 0, frameCount = testingSequence.get_frame_count(); i < frameCount; ++i)
+    {
+      const RelocalisationSequence::Frame& frame = testingSequence.get_frame(i);
+      FrameResult frameResult;
+      frameResult.index = frame.index;
+
+      prepareTimer.start_sync();
+      prepare_images(frame, calib, viewBuilder, deviceType, rgbImage, rawDepthImage, depthImage);
+      prepareTimer.stop_sync();
+      frameResult.prepareMs = last_ms(prepareTimer);
+      prepareMs.push_back(frameResult.prepareMs);
+
+      relocaliseTimer.start_sync();
+      std::vector<Relocaliser::Result> relocaliserResults = relocaliser->relocalise(rgbImage.get(), depthImage.get(), depthIntrinsics);
+      relocaliseTimer.stop_sync();
+      frameResult.relocaliseMs = last_ms(relocaliseTimer);
+      relocaliseMs.push_back(frameResult.relocaliseMs);
+
+      if(!relocaliserResults.empty())
+      {
+        compute_pose_errors(frame.cameraToWorld, relocaliserResults[0].pose.GetInvM(), frameResult.translationalError, frameResult.angularErrorDeg);
+      }
+      else
+      {
+        frameResult.translationalError = frameResult.angularErrorDeg = std::numeric_limits<float>::infinity();
+      }
+
+      frameResult.success = frameResult.translationalError <= maxTranslationalError && frameResult.angularErrorDeg <= maxAngularErrorDeg;
+      if(frameResult.success) ++successCount;
+      results.frameResults.push_back(frameResult);
+
+      update_peak_block_bytes(results.peakHostBlockBytes, results.peakDeviceBlockBytes);
+    }
+
+    const double seconds = boost::chrono::duration<double>(Clock::now() - start).count();
+    results.accuracy = static_cast<double>(successCount) / testingSequence.get_frame_count();
+    results.testingFramesPerSecond = testingSequence.get_frame_count() / seconds;
+  }
+
+  // Summarise the latencies of the stages.
+  results.stages.push_back(StageStatistics::compute(prepareTimer.name(), prepareMs));
+  results.stages.push_back(StageStatistics::compute(trainTimer.name(), trainMs));
+  results.stages.push_back(StageStatistics::compute(finishTrainingTimer.name(), std::vector<double>(1, last_ms(finishTrainingTimer))));
+  results.stages.push_back(StageStatistics::compute(relocaliseTimer.name(), relocaliseMs));
+
+  results.peakResidentBytes = get_peak_resident_bytes();
+  return results;
+}
+
+void RelocaliserBenchmark::write_csv(std::ostream& os, const Results& results)
+{
+  os << "index,success,translationalError,angularErrorDeg,prepareMs,relocaliseMs\n";
+  for(size_t i = 0, size = results.frameResults.size(); i < size; ++i)
+  {
+    const FrameResult& r = results.frameResults[i];
+    os << r.index << ',' << r.success << ',' << r.translationalError << ',' << r.angularErrorDeg << ',' << r.prepareMs << ',' << r.relocaliseMs << '\n';
+  }
+}
+
+void RelocaliserBenchmark::write_json(std::ostream& os, const Results& results)
+{
+  size_t successCount = 0;
+  for(size_t i = 0, size = results.frameResults.size(); i < size; ++i)
+  {
+    if(results.frameResults[i].success) ++successCount;
+  }
+
+  const std::ios_base::fmtflags oldFlags = os.flags();
+  const std::streamsize oldPrecision = os.precision();
+
+  os << std::fixed << std::setprecision(6);
+  os << "{\n"
+     << "  \"accuracy\": " << results.accuracy << ",\n"
+     << "  \"successfulFrameCount\": " << successCount << ",\n"
+     << "  \"testingFrameCount\": " << results.frameResults.size() << ",\n"
+     << "  \"trainingFramesPerSecond\": " << results.trainingFramesPerSecond << ",\n"
+     << "  \"testingFramesPerSecond\": " << results.testingFramesPerSecond << ",\n"
+     << "  \"peakHostBlockBytes\": " << results.peakHostBlockBytes << ",\n"
+     << "  \"peakDeviceBlockBytes\": " << results.peakDeviceBlockBytes << ",\n"
+     << "  \"peakResidentBytes\": " << results.peakResidentBytes << ",\n"
+     << "  \"stages\": {\n";
+
+  for(size_t i = 0, size = results.stages.size(); i < size; ++i)
+  {
+    const StageStatistics& s = results.stages[i];
+    os << "    \"" << s.name << "\": { \"count\": " << s.count << ", \"meanMs\": " << s.meanMs << ", \"p50Ms\": " << s.p50Ms
+       << ", \"p95Ms\": " << s.p95Ms << ", \"p99Ms\": " << s.p99Ms << ", \"maxMs\": " << s.maxMs << " }" << (i + 1 != size ? "," : "") << '\n';
+  }
+
+  os << "  }\n}\n";
+
+  os.flags(oldFlags);
+  os.precision(oldPrecision);
+}
+
+}
@@ -0,0 +1,135 @@
+/**
+ * itmx: AdaptiveCompressionController.cpp
+ * Copyright (c) Torr Vision Group, University of Oxford, 2017. All rights reserved.
+ */
+
+#include "remotemapping/AdaptiveCompressionController.h"
+
+#include <stdexcept>
+
+namespace itmx {
+
+//#################### CONSTRUCTORS ####################
+
+AdaptiveCompressionController::AdaptiveCompressionController(double targetLatencyMs, size_t cooldown, size_t maxFrameSkip)
+: m_cooldown(cooldown),
+  m_frameSkip(0),
+  m_framesSinceChange(0),
+  m_framesToSkip(0),
+  m_hasLatency(false),
+  m_levelIndex(0),
+  m_maxFrameSkip(maxFrameSkip),
+  m_smoothedLatencyMs(0.0),
+  m_smoothingFactor(0.2),
+  m_targetLatencyMs(targetLatencyMs)
+{
+  if(targetLatencyMs <= 0.0) throw std::invalid_argument("Error: The target latency must be strictly positive");
+
+  // Quality is reduced first, since it is cheap to do and has the least visible effect. Downscaling the RGB images
+  // is used as a last resort, since it throws away detail that the server cannot recover. Note that the depth images
+  // are always sent at full resolution, since they are fused into the server's model.
+  m_levels.push_back(Level(90, 1));
+  m_levels.push_back(Level(75, 1));
+  m_levels.push_back(Level(60, 1));
+  m_levels.push_back(Level(50, 2));
+  m_levels.push_back(Level(40, 2));
+  m_levels.push_back(Level(30, 4));
+}
+
+//#################### PUBLIC MEMBER FUNCTIONS ####################
+
+size_t AdaptiveCompressionController::get_frame_skip() const
+{
+  return m_frameSkip;
+}
+
+int AdaptiveCompressionController::get_rgb_downscale_factor() const
+{
+  return m_levels[m_levelIndex].rgbDownscaleFactor;
+}
+
+int AdaptiveCompressionController::get_rgb_jpeg_quality() const
+{
+  return m_levels[m_levelIndex].rgbJpegQuality;
+}
+
+double AdaptiveCompressionController::get_smoothed_latency() const
+{
+  return m_smoothedLatencyMs;
+}
+
+bool AdaptiveCompressionController::record_frame(double latencyMs, size_t discardedFrames)
+{
+  // Update the smoothed latency.
+  if(m_hasLatency)
+  {
+    m_smoothedLatencyMs += m_smoothingFactor * (latencyMs - m_smoothedLatencyMs);
+  }
+  else
+  {
+    m_smoothedLatencyMs = latencyMs;
+    m_hasLatency = true;
+  }
+
+  ++m_framesSinceChange;
+
+  // The link is overloaded if the smoothed latency exceeds the target, or if it is close to the target and
+  // frames are being discarded from the send queue (i.e. the client is producing frames faster than it can send them).
+  const bool overloaded = m_smoothedLatencyMs > m_targetLatencyMs || (discardedFrames > 0 && m_smoothedLatencyMs > 0.8 * m_targetLatencyMs);
+
+  // The link is underloaded if the smoothed latency is comfortably below the target and no frames are being discarded.
+  const bool underloaded = m_smoothedLatencyMs < 0.5 * m_targetLatencyMs && discardedFrames == 0;
+
+  bool changed = false;
+  if(overloaded && m_framesSinceChange >= m_cooldown) changed = degrade();
+  else if(underloaded && m_framesSinceChange >= 4 * m_cooldown) changed = improve();
+
+  if(changed) m_framesSinceChange = 0;
+  return changed;
+}
+
+bool AdaptiveCompressionController::should_send_frame()
+{
+  if(m_framesToSkip > 0)
+  {
+    --m_framesToSkip;
+    return false;
+  }
+
+  m_framesToSkip = m_frameSkip;
+  return true;
+}
+
+//#################### PRIVATE MEMBER FUNCTIONS ####################
+
+bool AdaptiveCompressionController::degrade()
+{
+  if(m_levelIndex + 1 < m_levels.size())
+  {
+    ++m_levelIndex;
+    return true;
+  }
+  else if(m_frameSkip < m_maxFrameSkip)
+  {
+    ++m_frameSkip;
+    return true;
+  }
+  else return false;
+}
+
+bool AdaptiveCompressionController::improve()
+{
+  if(m_frameSkip > 0)
+  {
+    --m_frameSkip;
+    return true;
+  }
+  else if(m_levelIndex > 0)
+  {
+    --m_levelIndex;
+    return true;
+  }
+  else return false;
+}
+
+}
@@ -17,7 +17,12 @@ CompressedRGBDFrameHeaderMessage::CompressedRGBDFrameHeaderMessage()
   m_depthImageSizeSegment = std::make_pair(end_of(m_depthImageByteSizeSegment), sizeof(Vector2i));
   m_rgbImageByteSizeSegment = std::make_pair(end_of(m_depthImageSizeSegment), sizeof(uint32_t));
   m_rgbImageSizeSegment = std::make_pair(end_of(m_rgbImageByteSizeSegment), sizeof(Vector2i));
-  m_data.resize(end_of(m_rgbImageSizeSegment));
+  m_rgbDownscaleFactorSegment = std::make_pair(end_of(m_rgbImageSizeSegment), sizeof(int32_t));
+  m_rgbQualitySegment = std::make_pair(end_of(m_rgbDownscaleFactorSegment), sizeof(int32_t));
+  m_data.resize(end_of(m_rgbQualitySegment));
+
+  set_rgb_downscale_factor(1);
+  set_rgb_quality(-1);
 }
 
 //#################### PUBLIC MEMBER FUNCTIONS ####################
@@ -32,6 +37,11 @@ Vector2i CompressedRGBDFrameHeaderMessage::extract_depth_image_size() const
   return read_simple<Vector2i>(m_depthImageSizeSegment);
 }
 
+int32_t CompressedRGBDFrameHeaderMessage::extract_rgb_downscale_factor() const
+{
+  return read_simple<int32_t>(m_rgbDownscaleFactorSegment);
+}
+
 uint32_t CompressedRGBDFrameHeaderMessage::extract_rgb_image_byte_size() const
 {
   return read_simple<uint32_t>(m_rgbImageByteSizeSegment);
@@ -42,6 +52,11 @@ Vector2i CompressedRGBDFrameHeaderMessage::extract_rgb_image_size() const
   return read_simple<Vector2i>(m_rgbImageSizeSegment);
 }
 
+int32_t CompressedRGBDFrameHeaderMessage::extract_rgb_quality() const
+{
+  return read_simple<int32_t>(m_rgbQualitySegment);
+}
+
 void CompressedRGBDFrameHeaderMessage::set_depth_image_byte_size(uint32_t depthImageByteSize)
 {
   write_simple(depthImageByteSize, m_depthImageByteSizeSegment);
@@ -52,6 +67,11 @@ void CompressedRGBDFrameHeaderMessage::set_depth_image_size(const Vector2i& dept
   write_simple(depthImageSize, m_depthImageSizeSegment);
 }
 
+void CompressedRGBDFrameHeaderMessage::set_rgb_downscale_factor(int32_t rgbDownscaleFactor)
+{
+  write_simple(rgbDownscaleFactor, m_rgbDownscaleFactorSegment);
+}
+
 void CompressedRGBDFrameHeaderMessage::set_rgb_image_byte_size(uint32_t rgbImageByteSize)
 {
   write_simple(rgbImageByteSize, m_rgbImageByteSizeSegment);
@@ -62,4 +82,9 @@ void CompressedRGBDFrameHeaderMessage::set_rgb_image_size(const Vector2i& rgbIma
   write_simple(rgbImageSize, m_rgbImageSizeSegment);
 }
 
+void CompressedRGBDFrameHeaderMessage::set_rgb_quality(int32_t rgbQuality)
+{
+  write_simple(rgbQuality, m_rgbQualitySegment);
+}
+
 }
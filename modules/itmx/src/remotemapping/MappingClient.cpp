@@ -7,6 +7,8 @@
 
 #include <stdexcept>
 
+#include <boost/chrono/chrono.hpp>
+
 #include <tvgutil/boost/WrappedAsio.h>
 #include <tvgutil/net/AckMessage.h>
 using boost::asio::ip::tcp;
@@ -20,16 +22,48 @@ namespace itmx {
 //#################### CONSTRUCTORS ####################
 
 MappingClient::MappingClient(const std::string& host, const std::string& port, pooled_queue::PoolEmptyStrategy poolEmptyStrategy)
-: m_frameMessageQueue(poolEmptyStrategy), m_stream(host, port)
+: m_discardedFrameCount(0), m_frameMessageQueue(poolEmptyStrategy), m_stopFrameRingWriter(false)
 {
+  // If the host specifies a shared memory segment, the server must be running locally, so connect to it via localhost.
+  const std::string sharedMemoryPrefix = "shm://";
+  if(host.compare(0, sharedMemoryPrefix.size(), sharedMemoryPrefix) == 0)
+  {
+    m_sharedMemoryName = host.substr(sharedMemoryPrefix.size());
+    if(m_sharedMemoryName.empty()) throw std::invalid_argument("Error: No shared memory segment name specified in host '" + host + "'");
+    m_stream.connect("localhost", port);
+  }
+  else m_stream.connect(host, port);
+
   if(!m_stream) throw std::runtime_error("Error: Could not connect to server");
 }
 
+//#################### DESTRUCTOR ####################
+
+MappingClient::~MappingClient()
+{
+  // If we're sending frames via a shared memory ring, stop doing so before the ring is destroyed.
+  m_stopFrameRingWriter = true;
+  if(m_frameRingWriter) m_frameRingWriter->join();
+  m_frameRing.reset();
+}
+
 //#################### PUBLIC MEMBER FUNCTIONS ####################
 
 MappingClient::RGBDFrameMessageQueue::PushHandler_Ptr MappingClient::begin_push_frame_message()
 {
-  return m_frameMessageQueue.begin_push();
+  RGBDFrameMessageQueue::PushHandler_Ptr pushHandler = m_frameMessageQueue.begin_push();
+
+  // Keep track of any frames that are discarded because the sender cannot keep up, since this is
+  // one of the signals used to adapt the compression settings (if adaptive compression is enabled).
+  if(!pushHandler->get()) ++m_discardedFrameCount;
+
+  return pushHandler;
+}
+
+void MappingClient::enable_adaptive_compression(double targetLatencyMs)
+{
+  if(m_frameCompressor) throw std::runtime_error("Error: Adaptive compression must be enabled before sending the calibration message");
+  m_compressionController.reset(new AdaptiveCompressionController(targetLatencyMs));
 }
 
 ORUChar4Image_CPtr MappingClient::get_remote_image() const
@@ -64,7 +98,7 @@ ORUChar4Image_CPtr MappingClient::get_remote_image() const
             const Vector2i rgbImageSize = headerMsg.extract_rgb_image_size();
             const Vector2i depthImageSize = headerMsg.extract_depth_image_size();
             RGBDFrameMessage uncompressedFrameMsg(rgbImageSize, depthImageSize);
-            m_frameCompressor->uncompress_rgbd_frame(frameMsg, uncompressedFrameMsg);
+            m_frameCompressor->uncompress_rgbd_frame(headerMsg, frameMsg, uncompressedFrameMsg);
 
             // Extract the colour image from the frame and use it to update the remote image for this client.
             if(!m_remoteImage) m_remoteImage.reset(new ORUChar4Image(rgbImageSize, true, false));
@@ -86,8 +120,22 @@ void MappingClient::send_calibration_message(const RGBDCalibrationMessage& msg)
 {
   bool connectionOk = true;
 
+  const ITMLib::ITMRGBDCalib calib = msg.extract_calib();
+  const Vector2i rgbImageSize = calib.intrinsics_rgb.imgSize;
+  const Vector2i depthImageSize = calib.intrinsics_d.imgSize;
+
+  // If we're sending frames via shared memory, create the shared memory ring (with one slot per uncompressed frame message),
+  // and tell the server its name so that it can open it. This must happen before the server receives the calibration message.
+  RGBDCalibrationMessage calibMsg(msg);
+  if(!m_sharedMemoryName.empty())
+  {
+    const size_t slotCount = 4;
+    m_frameRing = SharedMemoryMessageRing::create(m_sharedMemoryName, slotCount, RGBDFrameMessage(rgbImageSize, depthImageSize).get_size());
+    calibMsg.set_shared_memory_name(m_sharedMemoryName);
+  }
+
   // Send the message to the server.
-  connectionOk = connectionOk && m_stream.write(msg.get_data_ptr(), msg.get_size());
+  connectionOk = connectionOk && m_stream.write(calibMsg.get_data_ptr(), calibMsg.get_size());
 
   // Wait for an acknowledgement (note that this is blocking, unless the connection fails).
   AckMessage ackMsg;
@@ -98,16 +146,14 @@ void MappingClient::send_calibration_message(const RGBDCalibrationMessage& msg)
 
   // Initialise the frame message queue.
   const int capacity = 1;
-  const ITMLib::ITMRGBDCalib calib = msg.extract_calib();
-  const Vector2i rgbImageSize = calib.intrinsics_rgb.imgSize;
-  const Vector2i depthImageSize = calib.intrinsics_d.imgSize;
   m_frameMessageQueue.initialise(capacity, boost::bind(&RGBDFrameMessage::make, rgbImageSize, depthImageSize));
 
-  // Set up the RGB-D frame compressor.
+  // Set up the RGB-D frame compressor (when sending frames via shared memory, this is still used to uncompress the images rendered by the server).
   m_frameCompressor.reset(new RGBDFrameCompressor(rgbImageSize, depthImageSize, msg.extract_rgb_compression_type(), msg.extract_depth_compression_type()));
 
-  // Start the message sender thread.
-  boost::thread messageSender(&MappingClient::run_message_sender, this);
+  // Start the message sender thread. If we're sending frames via shared memory, keep hold of the thread so that it can be stopped before the ring is destroyed.
+  if(m_frameRing) m_frameRingWriter.reset(new boost::thread(&MappingClient::run_shared_memory_message_sender, this));
+  else boost::thread messageSender(&MappingClient::run_message_sender, this);
 }
 
 void MappingClient::update_rendering_request(const Vector2i& imgSize, const ORUtils::SE3Pose& pose, int visualisationType)
@@ -132,6 +178,19 @@ void MappingClient::update_rendering_request(const Vector2i& imgSize, const ORUt
 
 //#################### PRIVATE MEMBER FUNCTIONS ####################
 
+bool MappingClient::is_connection_ok() const
+{
+  AckMessage ackMsg;
+  SimpleMessage<bool> flag;
+  InteractionTypeMessage interactionTypeMsg(IT_HASRENDEREDIMAGE);
+
+  boost::lock_guard<boost::mutex> lock(m_interactionMutex);
+
+  return m_stream.write(interactionTypeMsg.get_data_ptr(), interactionTypeMsg.get_size())
+    && m_stream.read(flag.get_data_ptr(), flag.get_size())
+    && m_stream.write(ackMsg.get_data_ptr(), ackMsg.get_size());
+}
+
 void MappingClient::run_message_sender()
 {
   AckMessage ackMsg;
@@ -146,14 +205,33 @@ void MappingClient::run_message_sender()
     // Read the first frame message from the queue (this will block until a message is available).
     RGBDFrameMessage_Ptr msg = m_frameMessageQueue.peek();
 
+    // If we're using adaptive compression, check whether the frame should be skipped, and if not, apply
+    // the current compression settings to the frame compressor.
+    if(m_compressionController)
+    {
+      if(!m_compressionController->should_send_frame())
+      {
+        m_frameMessageQueue.pop();
+        continue;
+      }
+
+      m_frameCompressor->set_rgb_jpeg_quality(m_compressionController->get_rgb_jpeg_quality());
+      m_frameCompressor->set_rgb_downscale_factor(m_compressionController->get_rgb_downscale_factor());
+    }
+
     // Compress the frame. The compressed frame is split into two messages - a header message,
     // which tells the server how large a frame to expect, and a separate message containing
     // the actual frame data.
     m_frameCompressor->compress_rgbd_frame(*msg, headerMsg, frameMsg);
 
+    boost::chrono::steady_clock::time_point sendStart;
+
     {
       boost::lock_guard<boost::mutex> lock(m_interactionMutex);
 
+      // Note that we start timing once we have the lock, so that the latency reflects the state of the link rather than contention with other interactions.
+      sendStart = boost::chrono::steady_clock::now();
+
       // First send the interaction type message, then send the frame header message, then send
       // the frame message itself, then wait for an acknowledgement from the server. We chain
       // all of these with && so as to early out in case of failure.
@@ -164,6 +242,42 @@ void MappingClient::run_message_sender()
         && m_stream.read(ackMsg.get_data_ptr(), ackMsg.get_size());
     }
 
+    // If we're using adaptive compression, update the compression settings based on how long it took to send the frame.
+    if(m_compressionController && connectionOk)
+    {
+      const boost::chrono::duration<double,boost::milli> latency = boost::chrono::steady_clock::now() - sendStart;
+      m_compressionController->record_frame(latency.count(), m_discardedFrameCount.exchange(0));
+    }
+
+    // Remove the frame message that we have just sent from the queue.
+    m_frameMessageQueue.pop();
+  }
+}
+
+void MappingClient::run_shared_memory_message_sender()
+{
+  const boost::posix_time::milliseconds timeout(100);
+
+  while(!m_stopFrameRingWriter)
+  {
+    // If there are no frame messages to send, check again shortly (we avoid blocking on the queue, since we must notice when to stop).
+    if(m_frameMessageQueue.empty())
+    {
+      boost::this_thread::sleep_for(boost::chrono::milliseconds(1));
+      continue;
+    }
+
+    // Copy the first frame message into the next free slot in the shared memory ring, waiting for one to become free if necessary.
+    // Note that the frame is sent uncompressed, since there is no network link to save bandwidth on.
+    RGBDFrameMessage_Ptr msg = m_frameMessageQueue.peek();
+    if(!m_frameRing->write_message(*msg, timeout))
+    {
+      // If no slot became free in time, either the server is not keeping up (in which case we try again, and meanwhile
+      // new frames are handled by the queue's pool empty strategy), or it has gone away (in which case we stop).
+      if(is_connection_ok()) continue;
+      else break;
+    }
+
     // Remove the frame message that we have just sent from the queue.
     m_frameMessageQueue.pop();
   }
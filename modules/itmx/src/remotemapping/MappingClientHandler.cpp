@@ -5,17 +5,12 @@
 
 #include "remotemapping/MappingClientHandler.h"
 
-#include <tvgutil/net/AckMessage.h>
 using namespace tvgutil;
 
 #ifdef WITH_OPENCV
 #include "ocv/OpenCVUtil.h"
 #endif
 
-#include "remotemapping/InteractionTypeMessage.h"
-#include "remotemapping/RenderingRequestMessage.h"
-#include "remotemapping/RGBDCalibrationMessage.h"
-
 //#define DEBUGGING 1
 
 namespace itmx {
@@ -27,7 +22,8 @@ MappingClientHandler::MappingClientHandler(int clientID, const boost::shared_ptr
 : ClientHandler(clientID, sock, shouldTerminate),
   m_frameMessageQueue(new RGBDFrameMessageQueue(tvgutil::pooled_queue::PES_DISCARD)),
   m_imagesDirty(false),
-  m_poseDirty(false)
+  m_poseDirty(false),
+  m_stopFrameRingReader(false)
 {
   m_frameMessage.reset(new CompressedRGBDFrameMessage(m_headerMessage));
 }
@@ -106,18 +102,8 @@ void MappingClientHandler::run_iter()
           break;
         }
 
-        // Prepare the rendering response message (we reuse an uncompressed RGB-D frame for this to avoid creating a new message type).
-        if(!m_renderingResponseMessage || m_renderingResponseMessage->get_rgb_image_size() != imageHandle->get()->noDims)
-        {
-          m_renderingResponseMessage.reset(new RGBDFrameMessage(imageHandle->get()->noDims, Vector2i(1,1)));
-        }
-
-        m_renderingResponseMessage->set_frame_index(-1);
-        m_renderingResponseMessage->set_rgb_image(imageHandle->get());
-
-        // Compress the rendering response message for transmission over the network.
-        // FIXME: Consider using a separate frame compressor for rendering responses (to avoid continually resizing this one's internal images).
-        m_frameCompressor->compress_rgbd_frame(*m_renderingResponseMessage, m_headerMessage, *m_frameMessage);
+        // Prepare the rendering response message and compress it for transmission over the network.
+        prepare_rendering_response(imageHandle->get());
 
         // Send the rendering response to the client, and wait for an acknowledgement before proceeding.
         AckMessage ackMsg;
@@ -152,24 +138,9 @@ void MappingClientHandler::run_iter()
             std::cout << "Message queue size (" << m_clientID << "): " << m_frameMessageQueue->size() << std::endl;
 #endif
 
-            RGBDFrameMessageQueue::PushHandler_Ptr pushHandler = m_frameMessageQueue->begin_push();
-            boost::optional<RGBDFrameMessage_Ptr&> elt = pushHandler->get();
-            RGBDFrameMessage& msg = elt ? **elt : *m_dummyFrameMessage;
-            m_frameCompressor->uncompress_rgbd_frame(*m_frameMessage, msg);
+            push_frame_message();
 
             m_connectionOk = write_message(AckMessage());
-
-#if DEBUGGING
-            std::cout << "Got message: " << msg.extract_frame_index() << std::endl;
-
-          #ifdef WITH_OPENCV
-            static ORUChar4Image_Ptr rgbImage(new ORUChar4Image(get_rgb_image_size(), true, false));
-            msg.extract_rgb_image(rgbImage.get());
-            cv::Mat3b cvRGB = OpenCVUtil::make_rgb_image(rgbImage->GetData(MEMORYDEVICE_CPU), rgbImage->noDims.x, rgbImage->noDims.y);
-            cv::imshow("RGB", cvRGB);
-            cv::waitKey(1);
-          #endif
-#endif
           }
         }
 
@@ -200,8 +171,20 @@ void MappingClientHandler::run_iter()
   }
 }
 
+void MappingClientHandler::run_iter_async(const Continuation& done)
+{
+  // Start reading an interaction type message. Once it arrives, the rest of the interaction will be handled by the
+  // corresponding state machine, which will call the continuation once the interaction has finished.
+  read_message_async(m_interactionTypeMessage, boost::bind(&MappingClientHandler::handle_interaction_type_async, this, done), done);
+}
+
 void MappingClientHandler::run_post()
 {
+  // If we're reading frames from a shared memory ring, stop doing so and close the ring.
+  m_stopFrameRingReader = true;
+  if(m_frameRingReader) m_frameRingReader->join();
+  m_frameRing.reset();
+
   // Destroy the frame compressor prior to stopping the client handler (this cleanly deallocates CUDA memory and avoids a crash on exit).
   m_frameCompressor.reset();
 }
@@ -218,26 +201,20 @@ void MappingClientHandler::run_pre()
   // If the calibration message was successfully read:
   if(m_connectionOk)
   {
-    // Save the calibration parameters.
-    m_calib = calibMsg.extract_calib();
-
-    // Initialise the frame message queue.
-    const size_t capacity = 5;
-    const Vector2i& rgbImageSize = get_rgb_image_size();
-    const Vector2i& depthImageSize = get_depth_image_size();
-    m_frameMessageQueue->initialise(capacity, boost::bind(&RGBDFrameMessage::make, rgbImageSize, depthImageSize));
-
-    // Set up the frame compressor.
-    m_frameCompressor.reset(new RGBDFrameCompressor(rgbImageSize, depthImageSize, calibMsg.extract_rgb_compression_type(), calibMsg.extract_depth_compression_type()));
-
-    // Construct a dummy frame message to consume messages that cannot be pushed onto the queue.
-    m_dummyFrameMessage.reset(new RGBDFrameMessage(rgbImageSize, depthImageSize));
+    // Set up the handler based on the calibration message.
+    initialise(calibMsg);
 
     // Signal to the client that the server is ready.
-    m_connectionOk = write_message(AckMessage());
+    m_connectionOk = m_connectionOk && write_message(AckMessage());
   }
 }
 
+void MappingClientHandler::run_pre_async(const Continuation& done)
+{
+  // Start reading a calibration message from the client to get its camera's image sizes and calibration parameters.
+  read_message_async(m_calibMessage, boost::bind(&MappingClientHandler::handle_calibration_message_async, this, done), done);
+}
+
 void MappingClientHandler::set_images_dirty(bool imagesDirty)
 {
   m_imagesDirty = imagesDirty;
@@ -253,4 +230,230 @@ void MappingClientHandler::set_scene_id(const std::string& sceneID)
   m_sceneID = sceneID;
 }
 
+bool MappingClientHandler::supports_async() const
+{
+  return true;
+}
+
+//#################### PRIVATE MEMBER FUNCTIONS ####################
+
+void MappingClientHandler::handle_calibration_message_async(const Continuation& done)
+{
+#if DEBUGGING
+  std::cout << "Received calibration message from client: " << m_clientID << std::endl;
+#endif
+
+  // Set up the handler based on the calibration message, and then signal to the client that the server is ready.
+  initialise(m_calibMessage);
+  if(m_connectionOk) write_message_async(m_ackMessage, done, done);
+  else done();
+}
+
+void MappingClientHandler::handle_frame_header_async(const Continuation& done)
+{
+  // Set up the frame message based on the header, and then read the frame message itself.
+  m_frameMessage->set_compressed_image_sizes(m_headerMessage);
+  read_message_async(*m_frameMessage, boost::bind(&MappingClientHandler::push_frame_message_async, this, done), done);
+}
+
+void MappingClientHandler::handle_interaction_type_async(const Continuation& done)
+{
+  // Note: Each chain of operations below is set up back to front, i.e. each continuation is constructed before the operation that calls it.
+  switch(m_interactionTypeMessage.extract_value())
+  {
+    case IT_GETRENDEREDIMAGE:
+    {
+      // Try to compress the rendered image to send across to the client, locking the associated mutex only for the duration of
+      // the compression (the mutex must not be held across the asynchronous writes, which may finish on a different thread).
+      // If no image has been rendered for the client, early out.
+      {
+        ExclusiveHandle_Ptr<ORUChar4Image_Ptr>::Type imageHandle = get_rendered_image();
+        if(!imageHandle->get())
+        {
+          std::cerr << "Warning: Client " << m_clientID << " attempted to read a non-existent server-rendered image and is probably deadlocked.\n";
+          m_connectionOk = false;
+          done();
+          return;
+        }
+
+        prepare_rendering_response(imageHandle->get());
+      }
+
+      // Send the rendering response to the client, and wait for an acknowledgement before proceeding.
+      Continuation readAck = boost::bind(&MappingClientHandler::read_message_async<AckMessage>, this, boost::ref(m_ackMessage), done, done);
+      Continuation writeFrame = boost::bind(&MappingClientHandler::write_message_async<CompressedRGBDFrameMessage>, this, boost::cref(*m_frameMessage), readAck, done);
+      write_message_async(m_headerMessage, writeFrame, done);
+      break;
+    }
+    case IT_HASRENDEREDIMAGE:
+    {
+      // Send a message to the client indicating whether or not an image has ever been rendered for it, and wait for an acknowledgement before proceeding.
+      m_hasRenderedImageMessage.set_value(m_renderedImage.get() != NULL);
+      Continuation readAck = boost::bind(&MappingClientHandler::read_message_async<AckMessage>, this, boost::ref(m_ackMessage), done, done);
+      write_message_async(m_hasRenderedImageMessage, readAck, done);
+      break;
+    }
+    case IT_SENDFRAME:
+    {
+      // Read a frame header message, then the frame itself.
+      read_message_async(m_headerMessage, boost::bind(&MappingClientHandler::handle_frame_header_async, this, done), done);
+      break;
+    }
+    case IT_UPDATERENDERINGREQUEST:
+    {
+      // Read a rendering request message.
+      read_message_async(m_receivedRenderingRequestMessage, boost::bind(&MappingClientHandler::handle_rendering_request_async, this, done), done);
+      break;
+    }
+    default:
+    {
+      done();
+      break;
+    }
+  }
+}
+
+void MappingClientHandler::handle_rendering_request_async(const Continuation& done)
+{
+  // Store the request so that it can be picked up by the renderer, and send an acknowledgement to the client.
+  {
+    ExclusiveHandle_Ptr<boost::optional<RenderingRequestMessage> >::Type requestHandle = get_rendering_request();
+    requestHandle->get() = m_receivedRenderingRequestMessage;
+  }
+
+  write_message_async(m_ackMessage, done, done);
+}
+
+void MappingClientHandler::initialise(const RGBDCalibrationMessage& calibMsg)
+{
+  // Save the calibration parameters.
+  m_calib = calibMsg.extract_calib();
+
+  // Initialise the frame message queue.
+  const size_t capacity = 5;
+  const Vector2i& rgbImageSize = get_rgb_image_size();
+  const Vector2i& depthImageSize = get_depth_image_size();
+  m_frameMessageQueue->initialise(capacity, boost::bind(&RGBDFrameMessage::make, rgbImageSize, depthImageSize));
+
+  // Set up the frame compressor.
+  m_frameCompressor.reset(new RGBDFrameCompressor(rgbImageSize, depthImageSize, calibMsg.extract_rgb_compression_type(), calibMsg.extract_depth_compression_type()));
+
+  // Construct a dummy frame message to consume messages that cannot be pushed onto the queue.
+  m_dummyFrameMessage.reset(new RGBDFrameMessage(rgbImageSize, depthImageSize));
+
+  // If the client is running on the same machine as the server and has asked to send its frames via shared memory,
+  // open the shared memory ring and start a thread to read frames from it.
+  const std::string sharedMemoryName = calibMsg.extract_shared_memory_name();
+  if(!sharedMemoryName.empty())
+  {
+    try
+    {
+      m_frameRing = SharedMemoryMessageRing::open(sharedMemoryName);
+    }
+    catch(std::exception& e)
+    {
+      std::cerr << "Warning: Client " << m_clientID << " asked to send frames via shared memory segment '" << sharedMemoryName << "', but it could not be opened: " << e.what() << '\n';
+      m_connectionOk = false;
+      return;
+    }
+
+    if(m_frameRing->get_slot_size() != m_dummyFrameMessage->get_size())
+    {
+      std::cerr << "Warning: The shared memory segment '" << sharedMemoryName << "' for client " << m_clientID << " does not match the client's calibration\n";
+      m_frameRing.reset();
+      m_connectionOk = false;
+      return;
+    }
+
+    m_frameRingReader.reset(new boost::thread(&MappingClientHandler::run_frame_ring_reader, this));
+  }
+}
+
+void MappingClientHandler::prepare_rendering_response(const ORUChar4Image_Ptr& renderedImage)
+{
+  // Prepare the rendering response message (we reuse an uncompressed RGB-D frame for this to avoid creating a new message type).
+  if(!m_renderingResponseMessage || m_renderingResponseMessage->get_rgb_image_size() != renderedImage->noDims)
+  {
+    m_renderingResponseMessage.reset(new RGBDFrameMessage(renderedImage->noDims, Vector2i(1,1)));
+  }
+
+  m_renderingResponseMessage->set_frame_index(-1);
+  m_renderingResponseMessage->set_rgb_image(renderedImage);
+
+  // Compress the rendering response message for transmission over the network.
+  // FIXME: Consider using a separate frame compressor for rendering responses (to avoid continually resizing this one's internal images).
+  m_frameCompressor->compress_rgbd_frame(*m_renderingResponseMessage, m_headerMessage, *m_frameMessage);
+}
+
+void MappingClientHandler::push_frame_message()
+{
+  // Uncompress the images and store them on the frame message queue (or in the dummy message if they cannot be pushed onto the queue).
+  RGBDFrameMessageQueue::PushHandler_Ptr pushHandler = m_frameMessageQueue->begin_push();
+  boost::optional<RGBDFrameMessage_Ptr&> elt = pushHandler->get();
+  RGBDFrameMessage& msg = elt ? **elt : *m_dummyFrameMessage;
+  m_frameCompressor->uncompress_rgbd_frame(m_headerMessage, *m_frameMessage, msg);
+
+#if DEBUGGING
+  std::cout << "Got message: " << msg.extract_frame_index() << std::endl;
+
+#ifdef WITH_OPENCV
+  static ORUChar4Image_Ptr rgbImage(new ORUChar4Image(get_rgb_image_size(), true, false));
+  msg.extract_rgb_image(rgbImage.get());
+  cv::Mat3b cvRGB = OpenCVUtil::make_rgb_image(rgbImage->GetData(MEMORYDEVICE_CPU), rgbImage->noDims.x, rgbImage->noDims.y);
+  cv::imshow("RGB", cvRGB);
+  cv::waitKey(1);
+#endif
+#endif
+}
+
+void MappingClientHandler::push_frame_message_async(const Continuation& done)
+{
+  // If the frame message queue is full, check again shortly. Note that we poll rather than blocking,
+  // since blocking would tie up one of the server's I/O threads and stall the clients sharing it.
+  if(m_frameMessageQueue->pool_empty() && !*m_shouldTerminate)
+  {
+    m_timer->expires_from_now(boost::posix_time::milliseconds(2));
+    m_timer->async_wait(boost::bind(&MappingClientHandler::push_frame_message_async, this, done));
+    return;
+  }
+
+#if DEBUGGING
+  std::cout << "Message queue size (" << m_clientID << "): " << m_frameMessageQueue->size() << std::endl;
+#endif
+
+  // Uncompress the images, store them on the frame message queue and send an acknowledgement to the client.
+  push_frame_message();
+  write_message_async(m_ackMessage, done, done);
+}
+
+void MappingClientHandler::run_frame_ring_reader()
+{
+  const boost::posix_time::milliseconds timeout(100);
+
+  while(!m_stopFrameRingReader && !*m_shouldTerminate)
+  {
+    // If the frame message queue is full, leave the frames in the ring for now and check again shortly.
+    if(m_frameMessageQueue->pool_empty())
+    {
+      boost::this_thread::sleep_for(boost::chrono::milliseconds(1));
+      continue;
+    }
+
+    // Wait for the client to write a frame into the ring.
+    const char *slot = m_frameRing->begin_read(timeout);
+    if(!slot) continue;
+
+    // Copy the frame directly into a message on the frame message queue (the frame is uncompressed, so no decoding is needed),
+    // and then hand the slot back to the client.
+    {
+      RGBDFrameMessageQueue::PushHandler_Ptr pushHandler = m_frameMessageQueue->begin_push();
+      boost::optional<RGBDFrameMessage_Ptr&> elt = pushHandler->get();
+      RGBDFrameMessage& msg = elt ? **elt : *m_dummyFrameMessage;
+      memcpy(msg.get_data_ptr(), slot, msg.get_size());
+    }
+
+    m_frameRing->end_read();
+  }
+}
+
 }
@@ -16,8 +16,8 @@ namespace itmx {
 
 //#################### CONSTRUCTORS ####################
 
-MappingServer::MappingServer(Mode mode, int port)
-: Server(mode, port)
+MappingServer::MappingServer(Mode mode, int port, size_t ioThreadCount)
+: Server(mode, port, ioThreadCount)
 {}
 
 //#################### PUBLIC MEMBER FUNCTIONS ####################
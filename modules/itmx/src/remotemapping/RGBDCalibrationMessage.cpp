@@ -6,6 +6,8 @@
 #include "remotemapping/RGBDCalibrationMessage.h"
 using namespace ITMLib;
 
+#include <stdexcept>
+
 namespace itmx {
 
 //#################### CONSTRUCTORS ####################
@@ -21,7 +23,8 @@ RGBDCalibrationMessage::RGBDCalibrationMessage()
     sizeof(Vector2i) + sizeof(Vector4f) +                     // intrinsics_rgb
     sizeof(Matrix4f)                                          // trafo_rgb_to_depth
   );
-  m_data.resize(end_of(m_calibSegment));
+  m_sharedMemoryNameSegment = std::make_pair(end_of(m_calibSegment), 64);
+  m_data.resize(end_of(m_sharedMemoryNameSegment));
 }
 
 //#################### PUBLIC MEMBER FUNCTIONS ####################
@@ -66,6 +69,12 @@ RGBCompressionType RGBDCalibrationMessage::extract_rgb_compression_type() const
   return read_simple<RGBCompressionType>(m_rgbCompressionTypeSegment);
 }
 
+std::string RGBDCalibrationMessage::extract_shared_memory_name() const
+{
+  const char *p = &m_data[m_sharedMemoryNameSegment.first];
+  return std::string(p, strnlen(p, m_sharedMemoryNameSegment.second));
+}
+
 void RGBDCalibrationMessage::set_calib(const ITMRGBDCalib& calib)
 {
   char *p = &m_data[m_calibSegment.first];
@@ -101,4 +110,14 @@ void RGBDCalibrationMessage::set_rgb_compression_type(RGBCompressionType rgbComp
   write_simple(rgbCompressionType, m_rgbCompressionTypeSegment);
 }
 
+void RGBDCalibrationMessage::set_shared_memory_name(const std::string& sharedMemoryName)
+{
+  // Note: The name is stored null-terminated, so it must be strictly shorter than the segment.
+  if(sharedMemoryName.size() >= m_sharedMemoryNameSegment.second) throw std::invalid_argument("Error: Shared memory name '" + sharedMemoryName + "' is too long");
+
+  char *p = &m_data[m_sharedMemoryNameSegment.first];
+  memset(p, 0, m_sharedMemoryNameSegment.second);
+  memcpy(p, sharedMemoryName.c_str(), sharedMemoryName.size());
+}
+
 }
@@ -5,6 +5,7 @@
 
 #include "remotemapping/RGBDFrameCompressor.h"
 
+#include <algorithm>
 #include <stdexcept>
 
 #ifdef WITH_OPENCV
@@ -34,6 +35,12 @@ struct RGBDFrameCompressor::Impl
   /** The type of compression algorithm to use for the RGB images. */
   RGBCompressionType rgbCompressionType;
 
+  /** The factor by which RGB images are downscaled prior to compression. */
+  int rgbDownscaleFactor;
+
+  /** The quality with which RGB images are compressed when using JPG compression. */
+  int rgbJpegQuality;
+
   /** An image storing the temporary uncompressed depth data. */
   ORShortImage_Ptr uncompressedDepthImage;
 
@@ -48,6 +55,9 @@ struct RGBDFrameCompressor::Impl
 #ifdef WITH_OPENCV
   /** An OpenCV image storing the temporary uncompressed RGB data. */
   cv::Mat uncompressedRgbMat;
+
+  /** An OpenCV image storing a resized version of the temporary uncompressed RGB data (used when the RGB images are downscaled for transmission). */
+  cv::Mat resizedRgbMat;
 #endif
 };
 
@@ -60,8 +70,10 @@ RGBDFrameCompressor::RGBDFrameCompressor(const Vector2i& rgbImageSize, const Vec
 
   m_impl->depthCompressionType = depthCompressionType;
   m_impl->rgbCompressionType = rgbCompressionType;
-  m_impl->uncompressedDepthImage = mbf.make_image<short>(depthImageSize);
-  m_impl->uncompressedRgbImage = mbf.make_image<Vector4u>(rgbImageSize);
+  m_impl->rgbDownscaleFactor = 1;
+  m_impl->rgbJpegQuality = 95;
+  m_impl->uncompressedDepthImage = mbf.make_image<short>(depthImageSize, "RemoteMapping");
+  m_impl->uncompressedRgbImage = mbf.make_image<Vector4u>(rgbImageSize, "RemoteMapping");
 
   // If we're using the PNG compression from OpenCV to compress depth images, allocate a temporary OpenCV image accordingly.
   // The format of this image needs to be CV_16U to properly encode a depth image as PNG. We will use convertTo to fill
@@ -110,6 +122,8 @@ void RGBDFrameCompressor::compress_rgbd_frame(const RGBDFrameMessage& uncompress
   compressedHeader.set_depth_image_size(m_impl->uncompressedDepthImage->noDims);
   compressedHeader.set_rgb_image_byte_size(static_cast<uint32_t>(m_impl->compressedRgbBytes.size()));
   compressedHeader.set_rgb_image_size(m_impl->uncompressedRgbImage->noDims);
+  compressedHeader.set_rgb_downscale_factor(m_impl->rgbCompressionType == RGB_COMPRESSION_NONE ? 1 : m_impl->rgbDownscaleFactor);
+  compressedHeader.set_rgb_quality(m_impl->rgbCompressionType == RGB_COMPRESSION_JPG ? m_impl->rgbJpegQuality : -1);
 
   // Finally, prepare the compressed frame.
   compressedFrame.set_compressed_image_sizes(compressedHeader);
@@ -117,19 +131,58 @@ void RGBDFrameCompressor::compress_rgbd_frame(const RGBDFrameMessage& uncompress
   compressedFrame.set_rgb_image_data(m_impl->compressedRgbBytes);
 }
 
-void RGBDFrameCompressor::uncompress_rgbd_frame(const CompressedRGBDFrameMessage& compressedFrame, RGBDFrameMessage& uncompressedFrame)
+void RGBDFrameCompressor::set_rgb_downscale_factor(int rgbDownscaleFactor)
 {
-  // First, copy the metadata.
+  if(rgbDownscaleFactor < 1) throw std::invalid_argument("Error: The RGB downscale factor must be at least 1");
+  m_impl->rgbDownscaleFactor = rgbDownscaleFactor;
+}
+
+void RGBDFrameCompressor::set_rgb_jpeg_quality(int rgbJpegQuality)
+{
+  if(rgbJpegQuality < 0 || rgbJpegQuality > 100) throw std::invalid_argument("Error: The RGB JPG quality must be in the range [0,100]");
+  m_impl->rgbJpegQuality = rgbJpegQuality;
+}
+
+void RGBDFrameCompressor::uncompress_rgbd_frame(const CompressedRGBDFrameHeaderMessage& compressedHeader, const CompressedRGBDFrameMessage& compressedFrame, RGBDFrameMessage& uncompressedFrame)
+{
+  // First, check that the RGB parameters in the header are consistent with the frame we are uncompressing into.
+  const Vector2i rgbImageSize = compressedHeader.extract_rgb_image_size();
+  const int rgbDownscaleFactor = compressedHeader.extract_rgb_downscale_factor();
+  const int rgbQuality = compressedHeader.extract_rgb_quality();
+
+  if(rgbImageSize != uncompressedFrame.get_rgb_image_size())
+  {
+    throw std::runtime_error("Error: The RGB image size in the frame header does not match that of the uncompressed frame");
+  }
+
+  if(rgbDownscaleFactor < 1 || rgbDownscaleFactor > std::max(rgbImageSize.x, rgbImageSize.y))
+  {
+    throw std::runtime_error("Error: The RGB downscale factor in the frame header is inconsistent with the RGB image size");
+  }
+
+  if(m_impl->rgbCompressionType == RGB_COMPRESSION_NONE && rgbDownscaleFactor != 1)
+  {
+    throw std::runtime_error("Error: The frame header specifies a downscaled RGB image, but the RGB images are not compressed");
+  }
+
+  const bool validQuality = m_impl->rgbCompressionType == RGB_COMPRESSION_JPG ? rgbQuality >= 0 && rgbQuality <= 100 : rgbQuality == -1;
+  if(!validQuality)
+  {
+    throw std::runtime_error("Error: The RGB quality in the frame header is inconsistent with the RGB compression type");
+  }
+
+  // Then, copy the metadata.
   uncompressedFrame.set_frame_index(compressedFrame.extract_frame_index());
   uncompressedFrame.set_pose(compressedFrame.extract_pose());
 
-  // Then, extract the compressed byte vectors.
+  // Next, extract the compressed byte vectors, and set the RGB image to the full size specified in the header.
+  m_impl->uncompressedRgbImage->ChangeDims(rgbImageSize);
   compressedFrame.extract_depth_image_data(m_impl->compressedDepthBytes);
   compressedFrame.extract_rgb_image_data(m_impl->compressedRgbBytes);
 
   // Perform the uncompression.
   uncompress_depth_image();
-  uncompress_rgb_image();
+  uncompress_rgb_image(rgbDownscaleFactor);
 
   // Finally, store the images into the uncompressed message.
   uncompressedFrame.set_depth_image(m_impl->uncompressedDepthImage);
@@ -188,9 +241,26 @@ void RGBDFrameCompressor::compress_rgb_image()
     // Then, make a copy of this image in which we reorder the colours and drop the alpha channel.
     cv::cvtColor(rgbWrapper, m_impl->uncompressedRgbMat, CV_RGBA2BGR);
 
+    // If requested, downscale the image to reduce the number of bytes that need to be transmitted.
+    const cv::Mat *imageToEncode = &m_impl->uncompressedRgbMat;
+    const int factor = m_impl->rgbDownscaleFactor;
+    if(factor > 1)
+    {
+      const cv::Size downscaledSize(std::max(1, m_impl->uncompressedRgbMat.cols / factor), std::max(1, m_impl->uncompressedRgbMat.rows / factor));
+      cv::resize(m_impl->uncompressedRgbMat, m_impl->resizedRgbMat, downscaledSize, 0.0, 0.0, cv::INTER_AREA);
+      imageToEncode = &m_impl->resizedRgbMat;
+    }
+
     // Finally, compress the image using the appropriate format, storing the compressed representation in the internal buffer.
+    std::vector<int> params;
+    if(m_impl->rgbCompressionType == RGB_COMPRESSION_JPG)
+    {
+      params.push_back(cv::IMWRITE_JPEG_QUALITY);
+      params.push_back(m_impl->rgbJpegQuality);
+    }
+
     const std::string outputFormat = m_impl->rgbCompressionType == RGB_COMPRESSION_JPG ? ".jpg" : ".png";
-    cv::imencode(outputFormat, m_impl->uncompressedRgbMat, m_impl->compressedRgbBytes);
+    cv::imencode(outputFormat, *imageToEncode, m_impl->compressedRgbBytes, params);
 #endif
   }
 }
@@ -230,7 +300,7 @@ void RGBDFrameCompressor::uncompress_depth_image()
   }
 }
 
-void RGBDFrameCompressor::uncompress_rgb_image()
+void RGBDFrameCompressor::uncompress_rgb_image(int rgbDownscaleFactor)
 {
   if(m_impl->rgbCompressionType == RGB_COMPRESSION_NONE)
   {
@@ -249,17 +319,31 @@ void RGBDFrameCompressor::uncompress_rgb_image()
     // Otherwise, first decode the image into a preallocated internal buffer.
     m_impl->uncompressedRgbMat = cv::imdecode(m_impl->compressedRgbBytes, cv::IMREAD_COLOR, &m_impl->uncompressedRgbMat);
 
-    // Then, copy the image back into an InfiniTAM image, resizing as necessary. Note that
-    // as part of this process, we reorder the bytes and re-add the alpha channel.
-    m_impl->uncompressedRgbImage->ChangeDims(Vector2i(m_impl->uncompressedRgbMat.cols, m_impl->uncompressedRgbMat.rows));
+    // Then, check that the decoded image has the size that the compressor will have produced for the specified downscale factor.
+    const Vector2i& fullSize = m_impl->uncompressedRgbImage->noDims;
+    const cv::Size encodedSize(std::max(1, fullSize.x / rgbDownscaleFactor), std::max(1, fullSize.y / rgbDownscaleFactor));
+    if(m_impl->uncompressedRgbMat.size() != encodedSize)
+    {
+      throw std::runtime_error("Error: The decoded RGB image size does not match the size implied by the frame header");
+    }
 
+    // If the image was downscaled prior to transmission, upsample it back to its full size.
+    const cv::Mat *decodedImage = &m_impl->uncompressedRgbMat;
+    if(rgbDownscaleFactor > 1)
+    {
+      cv::resize(m_impl->uncompressedRgbMat, m_impl->resizedRgbMat, cv::Size(fullSize.x, fullSize.y), 0.0, 0.0, cv::INTER_LINEAR);
+      decodedImage = &m_impl->resizedRgbMat;
+    }
+
+    // Finally, copy the image back into the InfiniTAM image (which already has the right size). Note that
+    // as part of this process, we reorder the bytes and re-add the alpha channel.
     cv::Mat rgbWrapper(
       m_impl->uncompressedRgbImage->noDims.y,
       m_impl->uncompressedRgbImage->noDims.x, CV_8UC4,
       m_impl->uncompressedRgbImage->GetData(MEMORYDEVICE_CPU)
     );
 
-    cv::cvtColor(m_impl->uncompressedRgbMat, rgbWrapper, CV_BGR2RGBA);
+    cv::cvtColor(*decodedImage, rgbWrapper, CV_BGR2RGBA);
 #endif
   }
 }
@@ -6,6 +6,11 @@
 #ifndef H_ORX_MEMORYBLOCKFACTORY
 #define H_ORX_MEMORYBLOCKFACTORY
 
+#include <ostream>
+#include <string>
+#include <typeinfo>
+#include <vector>
+
 #include <boost/shared_ptr.hpp>
 
 #include <ORUtils/DeviceType.h>
@@ -16,14 +21,101 @@ namespace orx {
 
 /**
  * \brief An instance of this class can be used to make memory blocks.
+ *
+ * Each block made by the factory can be given an allocation tag (e.g. the name of the subsystem that owns it), and the factory
+ * keeps track of the host and device memory used by the live blocks associated with each tag, so that a report can be produced
+ * showing which subsystems own how much memory.
+ *
+ * The factory can also maintain a pool of released blocks (this is disabled by default, and can be enabled by setting a non-zero
+ * pool capacity). When a block made by the factory is released, it is added to the pool (if there is room) rather than being freed,
+ * and a subsequent request for a block of the same type, size and device will then reuse it rather than allocating a new one. This
+ * avoids repeatedly allocating and freeing short-lived temporaries. A reused block is cleared (on both the host and the device) before
+ * it is handed out, so that callers cannot observe the contents left in it by its previous owner.
  */
 class MemoryBlockFactory
 {
+  //#################### NESTED TYPES ####################
+public:
+  /**
+   * \brief An instance of this struct records the memory usage associated with an allocation tag.
+   */
+  struct TagUsage
+  {
+    /** The total number of blocks that have been made with the tag (including any that were reused from the pool). */
+    size_t allocationCount;
+
+    /** The number of bytes of device memory used by the live blocks associated with the tag. */
+    size_t deviceBytes;
+
+    /** The number of bytes of host memory used by the live blocks associated with the tag. */
+    size_t hostBytes;
+
+    /** The number of live blocks associated with the tag. */
+    size_t liveBlockCount;
+
+    /** The number of blocks made with the tag that were reused from the pool rather than allocated. */
+    size_t reuseCount;
+
+    /** The tag. */
+    std::string tag;
+  };
+
+private:
+  /**
+   * \brief An instance of this struct identifies the blocks in the pool that can be reused to satisfy a request.
+   */
+  struct PoolKey
+  {
+    /** The height of the block (1 for a non-image block). */
+    size_t height;
+
+    /** Whether or not the block is allocated on the device. */
+    bool onDevice;
+
+    /** The name of the type of the block. */
+    std::string typeName;
+
+    /** The width of the block (its size, for a non-image block). */
+    size_t width;
+
+    PoolKey(const std::type_info& type, size_t width_, size_t height_, bool onDevice_)
+    : height(height_), onDevice(onDevice_), typeName(type.name()), width(width_)
+    {}
+
+    bool operator<(const PoolKey& rhs) const;
+  };
+
+  struct State;
+  typedef boost::shared_ptr<State> State_Ptr;
+
+  /**
+   * \brief An instance of an instantiation of this struct template can be used to release a block made by the factory.
+   */
+  template <typename Block>
+  struct BlockReleaser
+  {
+    /** Whether or not the block is allocated on the device. */
+    bool onDevice;
+
+    /** The factory's state (this is shared so that blocks that outlive the factory can still be released safely). */
+    State_Ptr state;
+
+    void operator()(Block *block) const
+    {
+      size_t width, height;
+      get_dimensions(*block, width, height);
+      release_block(state, block, PoolKey(typeid(Block), width, height, onDevice), &destroy_block<Block>);
+    }
+  };
+
   //#################### PRIVATE VARIABLES ####################
 private:
   /** The type of device on which the memory blocks will primarily be used. */
   DeviceType m_deviceType;
 
+  /** The factory's state (the memory accounting and the pool). */
+  State_Ptr m_state;
+
   //#################### SINGLETON IMPLEMENTATION ####################
 private:
   /**
@@ -41,30 +133,60 @@ public:
 
   //#################### PUBLIC MEMBER FUNCTIONS ####################
 public:
+  /**
+   * \brief Frees all of the blocks in the pool.
+   *
+   * \note  Before the application exits, pooling should be disabled (see set_pool_capacity), since the pool is otherwise
+   *        only emptied during static destruction, by which point it may no longer be possible to free device memory.
+   */
+  void clear_pool();
+
+  /**
+   * \brief Gets the memory usage associated with each allocation tag that has been used so far.
+   *
+   * \note  The byte counts are computed from the current sizes of the live blocks, so they reflect any resizing that has
+   *        been done since the blocks were made.
+   *
+   * \return  The memory usage associated with each tag, sorted by tag.
+   */
+  std::vector<TagUsage> get_usage() const;
+
   /**
    * \brief Makes a memory block of the specified type and size.
    *
    * \param dataSize  The size of the memory block to make.
+   * \param tag       The allocation tag with which to associate the block.
    * \return          The memory block.
    */
   template <typename T>
-  boost::shared_ptr<ORUtils::MemoryBlock<T> > make_block(size_t dataSize = 0) const
+  boost::shared_ptr<ORUtils::MemoryBlock<T> > make_block(size_t dataSize = 0, const std::string& tag = "") const
   {
+    typedef ORUtils::MemoryBlock<T> Block;
     bool allocateGPU = m_deviceType == DEVICE_CUDA;
-    return boost::shared_ptr<ORUtils::MemoryBlock<T> >(new ORUtils::MemoryBlock<T>(dataSize, true, allocateGPU));
+    Block *block = static_cast<Block*>(take_pooled_block(PoolKey(typeid(Block), dataSize, 1, allocateGPU)));
+    const bool reused = block != NULL;
+    if(reused) block->Clear();
+    else block = new Block(dataSize, true, allocateGPU);
+    return wrap_block<Block,T>(block, tag, allocateGPU, reused);
   }
 
   /**
    * \brief Makes an image of the specified type and size.
    *
    * \param size  The size of the image to make.
+   * \param tag   The allocation tag with which to associate the image.
    * \return      The image.
    */
   template <typename T>
-  boost::shared_ptr<ORUtils::Image<T> > make_image(const ORUtils::Vector2<int> size = ORUtils::Vector2<int>(0, 0)) const
+  boost::shared_ptr<ORUtils::Image<T> > make_image(const ORUtils::Vector2<int> size = ORUtils::Vector2<int>(0, 0), const std::string& tag = "") const
   {
+    typedef ORUtils::Image<T> Block;
     bool allocateGPU = m_deviceType == DEVICE_CUDA;
-    return boost::shared_ptr<ORUtils::Image<T> >(new ORUtils::Image<T>(size, true, allocateGPU));
+    Block *block = static_cast<Block*>(take_pooled_block(PoolKey(typeid(Block), size.x, size.y, allocateGPU)));
+    const bool reused = block != NULL;
+    if(reused) block->Clear();
+    else block = new Block(size, true, allocateGPU);
+    return wrap_block<Block,T>(block, tag, allocateGPU, reused);
   }
 
   /**
@@ -76,6 +198,126 @@ public:
    * \param deviceType  The type of device on which the memory blocks made by the factory will primarily be used.
    */
   void set_device_type(DeviceType deviceType);
+
+  /**
+   * \brief Sets the maximum number of bytes of host memory that may be held by released blocks in the pool.
+   *
+   * If the pool already holds more than this, blocks will be freed until it does not.
+   *
+   * \param poolCapacity  The maximum number of bytes of host memory that may be held by the pool (0 disables pooling).
+   */
+  void set_pool_capacity(size_t poolCapacity);
+
+  /**
+   * \brief Writes a report showing the host and device memory used by the live blocks associated with each allocation tag.
+   *
+   * \param os  The stream to which to write the report.
+   */
+  void write_usage_report(std::ostream& os) const;
+
+  //#################### PRIVATE MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Records a newly-made block in the memory accounting.
+   *
+   * \param block       The block.
+   * \param tag         The allocation tag with which to associate the block.
+   * \param onDevice    Whether or not the block is allocated on the device.
+   * \param reused      Whether or not the block was reused from the pool.
+   * \param countBytes  A function that can be used to compute the number of bytes currently used by the block.
+   */
+  void register_block(const void *block, const std::string& tag, bool onDevice, bool reused, size_t (*countBytes)(const void*)) const;
+
+  /**
+   * \brief Attempts to take a block that matches the specified key from the pool.
+   *
+   * \param key The key.
+   * \return    The block, if a matching one was in the pool, or NULL otherwise.
+   */
+  void *take_pooled_block(const PoolKey& key) const;
+
+  /**
+   * \brief Records a newly-made block in the memory accounting, and wraps it in a shared pointer that will release it to the factory.
+   *
+   * \param block     The block.
+   * \param tag       The allocation tag with which to associate the block.
+   * \param onDevice  Whether or not the block is allocated on the device.
+   * \param reused    Whether or not the block was reused from the pool.
+   * \return          The wrapped block.
+   */
+  template <typename Block, typename T>
+  boost::shared_ptr<Block> wrap_block(Block *block, const std::string& tag, bool onDevice, bool reused) const
+  {
+    register_block(block, tag, onDevice, reused, &count_bytes<Block,T>);
+
+    BlockReleaser<Block> releaser;
+    releaser.onDevice = onDevice;
+    releaser.state = m_state;
+    return boost::shared_ptr<Block>(block, releaser);
+  }
+
+  //#################### PRIVATE STATIC MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Computes the number of bytes of host memory currently used by a block.
+   *
+   * \param block The block.
+   * \return      The number of bytes of host memory currently used by the block.
+   */
+  template <typename Block, typename T>
+  static size_t count_bytes(const void *block)
+  {
+    return static_cast<const Block*>(block)->dataSize * sizeof(T);
+  }
+
+  /**
+   * \brief Frees a block.
+   *
+   * \param block The block.
+   */
+  template <typename Block>
+  static void destroy_block(void *block)
+  {
+    delete static_cast<Block*>(block);
+  }
+
+  /**
+   * \brief Gets the current dimensions of a (non-image) block.
+   *
+   * \param block   The block.
+   * \param width   A place in which to store the width of the block (its size).
+   * \param height  A place in which to store the height of the block (always 1).
+   */
+  template <typename T>
+  static void get_dimensions(const ORUtils::MemoryBlock<T>& block, size_t& width, size_t& height)
+  {
+    width = block.dataSize;
+    height = 1;
+  }
+
+  /**
+   * \brief Gets the current dimensions of an image.
+   *
+   * \param image   The image.
+   * \param width   A place in which to store the width of the image.
+   * \param height  A place in which to store the height of the image.
+   */
+  template <typename T>
+  static void get_dimensions(const ORUtils::Image<T>& image, size_t& width, size_t& height)
+  {
+    width = image.noDims.x;
+    height = image.noDims.y;
+  }
+
+  /**
+   * \brief Releases a block made by the factory, either by adding it to the pool or by freeing it.
+   *
+   * \param state   The factory's state.
+   * \param block   The block.
+   * \param key     The key to use if the block is added to the pool.
+   * \param destroy A function that can be used to free the block.
+   */
+  static void release_block(const State_Ptr& state, void *block, const PoolKey& key, void (*destroy)(void*));
 };
 
 }
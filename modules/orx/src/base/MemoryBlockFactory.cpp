@@ -5,12 +5,143 @@
 
 #include "base/MemoryBlockFactory.h"
 
+#include <algorithm>
+#include <iomanip>
+#include <map>
+
+#include <boost/thread/lock_guard.hpp>
+#include <boost/thread/mutex.hpp>
+
 namespace orx {
 
+//#################### NESTED TYPES ####################
+
+/**
+ * \brief An instance of this struct holds the memory accounting and the pool for a memory block factory.
+ */
+struct MemoryBlockFactory::State
+{
+  //~~~~~~~~~~~~~~~~~~~~ NESTED TYPES ~~~~~~~~~~~~~~~~~~~~
+
+  /** The accounting information for a live block. */
+  struct LiveBlock
+  {
+    size_t (*countBytes)(const void*);
+    bool onDevice;
+    std::string tag;
+  };
+
+  /** A released block in the pool. */
+  struct PooledBlock
+  {
+    void *block;
+    size_t bytes;
+    void (*destroy)(void*);
+  };
+
+  /** The numbers of blocks that have been made (and reused) with a tag. */
+  struct TagCounts
+  {
+    size_t allocationCount;
+    size_t reuseCount;
+
+    TagCounts() : allocationCount(0), reuseCount(0) {}
+  };
+
+  //~~~~~~~~~~~~~~~~~~~~ PUBLIC VARIABLES ~~~~~~~~~~~~~~~~~~~~
+
+  /** The live blocks made by the factory. */
+  std::map<const void*,LiveBlock> liveBlocks;
+
+  /** The mutex used to synchronise access to the state. */
+  mutable boost::mutex mutex;
+
+  /** The released blocks that are available for reuse. */
+  std::multimap<PoolKey,PooledBlock> pool;
+
+  /** The maximum number of bytes of host memory that may be held by the pool. */
+  size_t poolCapacity;
+
+  /** The number of bytes of host memory currently held by the pool. */
+  size_t pooledBytes;
+
+  /** The numbers of blocks that have been made (and reused) with each tag. */
+  std::map<std::string,TagCounts> tagCounts;
+
+  //~~~~~~~~~~~~~~~~~~~~ CONSTRUCTORS ~~~~~~~~~~~~~~~~~~~~
+
+  State()
+  : poolCapacity(0), pooledBytes(0)
+  {}
+
+  //~~~~~~~~~~~~~~~~~~~~ DESTRUCTOR ~~~~~~~~~~~~~~~~~~~~
+
+  ~State()
+  {
+    for(std::multimap<PoolKey,PooledBlock>::iterator it = pool.begin(), iend = pool.end(); it != iend; ++it)
+    {
+      it->second.destroy(it->second.block);
+    }
+  }
+
+  //~~~~~~~~~~~~~~~~~~~~ PUBLIC MEMBER FUNCTIONS ~~~~~~~~~~~~~~~~~~~~
+
+  /**
+   * \brief Removes blocks from the pool until it holds no more than the specified number of bytes.
+   *
+   * \note  The caller must hold the mutex. The removed blocks are returned rather than freed, so that they can be freed after it is released.
+   *
+   * \param maxBytes  The maximum number of bytes that the pool should hold.
+   * \return          The removed blocks.
+   */
+  std::vector<PooledBlock> trim_pool(size_t maxBytes)
+  {
+    std::vector<PooledBlock> removedBlocks;
+    while(pooledBytes > maxBytes)
+    {
+      // Remove the largest blocks first, since these are the ones that hold the most memory.
+      std::multimap<PoolKey,PooledBlock>::iterator largest = pool.begin();
+      for(std::multimap<PoolKey,PooledBlock>::iterator it = pool.begin(), iend = pool.end(); it != iend; ++it)
+      {
+        if(it->second.bytes > largest->second.bytes) largest = it;
+      }
+
+      pooledBytes -= largest->second.bytes;
+      removedBlocks.push_back(largest->second);
+      pool.erase(largest);
+    }
+    return removedBlocks;
+  }
+};
+
+bool MemoryBlockFactory::PoolKey::operator<(const PoolKey& rhs) const
+{
+  if(typeName != rhs.typeName) return typeName < rhs.typeName;
+  if(width != rhs.width) return width < rhs.width;
+  if(height != rhs.height) return height < rhs.height;
+  return onDevice < rhs.onDevice;
+}
+
+//#################### HELPER FUNCTIONS ####################
+
+/**
+ * \brief Frees the specified blocks that have been removed from the pool.
+ *
+ * \param blocks  The blocks to free.
+ */
+template <typename PooledBlock>
+static void destroy_blocks(const std::vector<PooledBlock>& blocks)
+{
+  for(size_t i = 0, size = blocks.size(); i < size; ++i)
+  {
+    blocks[i].destroy(blocks[i].block);
+  }
+}
+
 //#################### SINGLETON IMPLEMENTATION ####################
 
 MemoryBlockFactory::MemoryBlockFactory()
-: m_deviceType(DEVICE_CUDA)
+: m_deviceType(DEVICE_CUDA), m_state(new State)
 {}
 
 MemoryBlockFactory& MemoryBlockFactory::instance()
@@ -21,9 +152,167 @@ MemoryBlockFactory& MemoryBlockFactory::instance()
 
 //#################### PUBLIC MEMBER FUNCTIONS ####################
 
+void MemoryBlockFactory::clear_pool()
+{
+  std::vector<State::PooledBlock> removedBlocks;
+  {
+    boost::lock_guard<boost::mutex> lock(m_state->mutex);
+    removedBlocks = m_state->trim_pool(0);
+  }
+  destroy_blocks(removedBlocks);
+}
+
+std::vector<MemoryBlockFactory::TagUsage> MemoryBlockFactory::get_usage() const
+{
+  std::map<std::string,TagUsage> usageByTag;
+
+  boost::lock_guard<boost::mutex> lock(m_state->mutex);
+
+  for(std::map<std::string,State::TagCounts>::const_iterator it = m_state->tagCounts.begin(), iend = m_state->tagCounts.end(); it != iend; ++it)
+  {
+    TagUsage& usage = usageByTag[it->first];
+    usage.allocationCount = it->second.allocationCount;
+    usage.deviceBytes = usage.hostBytes = usage.liveBlockCount = 0;
+    usage.reuseCount = it->second.reuseCount;
+    usage.tag = it->first;
+  }
+
+  for(std::map<const void*,State::LiveBlock>::const_iterator it = m_state->liveBlocks.begin(), iend = m_state->liveBlocks.end(); it != iend; ++it)
+  {
+    const State::LiveBlock& liveBlock = it->second;
+    TagUsage& usage = usageByTag[liveBlock.tag];
+    const size_t bytes = liveBlock.countBytes(it->first);
+    usage.hostBytes += bytes;
+    if(liveBlock.onDevice) usage.deviceBytes += bytes;
+    ++usage.liveBlockCount;
+  }
+
+  std::vector<TagUsage> result;
+  result.reserve(usageByTag.size());
+  for(std::map<std::string,TagUsage>::const_iterator it = usageByTag.begin(), iend = usageByTag.end(); it != iend; ++it)
+  {
+    result.push_back(it->second);
+  }
+
+  return result;
+}
+
 void MemoryBlockFactory::set_device_type(DeviceType deviceType)
 {
   m_deviceType = deviceType;
 }
 
+void MemoryBlockFactory::set_pool_capacity(size_t poolCapacity)
+{
+  std::vector<State::PooledBlock> removedBlocks;
+  {
+    boost::lock_guard<boost::mutex> lock(m_state->mutex);
+    m_state->poolCapacity = poolCapacity;
+    removedBlocks = m_state->trim_pool(poolCapacity);
+  }
+  destroy_blocks(removedBlocks);
+}
+
+void MemoryBlockFactory::write_usage_report(std::ostream& os) const
+{
+  const std::vector<TagUsage> usage = get_usage();
+
+  size_t pooledBlockCount, pooledBytes;
+  {
+    boost::lock_guard<boost::mutex> lock(m_state->mutex);
+    pooledBlockCount = m_state->pool.size();
+    pooledBytes = m_state->pooledBytes;
+  }
+
+  size_t tagWidth = 10;
+  for(size_t i = 0, size = usage.size(); i < size; ++i) tagWidth = std::max(tagWidth, usage[i].tag.length());
+
+  const std::ios_base::fmtflags oldFlags = os.flags();
+  const std::streamsize oldPrecision = os.precision();
+  const double bytesPerMb = 1024.0 * 1024.0;
+
+  os << std::left << std::setw(static_cast<int>(tagWidth) + 2) << "Tag" << std::right
+     << std::setw(10) << "Live" << std::setw(14) << "Host (MB)" << std::setw(14) << "Device (MB)"
+     << std::setw(14) << "Allocations" << std::setw(10) << "Reused" << '\n';
+
+  os << std::fixed << std::setprecision(2);
+  size_t totalDeviceBytes = 0, totalHostBytes = 0;
+  for(size_t i = 0, size = usage.size(); i < size; ++i)
+  {
+    const TagUsage& u = usage[i];
+    os << std::left << std::setw(static_cast<int>(tagWidth) + 2) << (u.tag.empty() ? "<untagged>" : u.tag) << std::right
+       << std::setw(10) << u.liveBlockCount << std::setw(14) << u.hostBytes / bytesPerMb << std::setw(14) << u.deviceBytes / bytesPerMb
+       << std::setw(14) << u.allocationCount << std::setw(10) << u.reuseCount << '\n';
+    totalDeviceBytes += u.deviceBytes;
+    totalHostBytes += u.hostBytes;
+  }
+
+  os << "Total: " << totalHostBytes / bytesPerMb << " MB host, " << totalDeviceBytes / bytesPerMb << " MB device; "
+     << "pool: " << pooledBlockCount << " blocks, " << pooledBytes / bytesPerMb << " MB host\n";
+
+  os.flags(oldFlags);
+  os.precision(oldPrecision);
+}
+
+//#################### PRIVATE MEMBER FUNCTIONS ####################
+
+void MemoryBlockFactory::register_block(const void *block, const std::string& tag, bool onDevice, bool reused, size_t (*countBytes)(const void*)) const
+{
+  State::LiveBlock liveBlock;
+  liveBlock.countBytes = countBytes;
+  liveBlock.onDevice = onDevice;
+  liveBlock.tag = tag;
+
+  boost::lock_guard<boost::mutex> lock(m_state->mutex);
+  m_state->liveBlocks[block] = liveBlock;
+
+  State::TagCounts& counts = m_state->tagCounts[tag];
+  ++counts.allocationCount;
+  if(reused) ++counts.reuseCount;
+}
+
+void *MemoryBlockFactory::take_pooled_block(const PoolKey& key) const
+{
+  // Empty blocks are never pooled, so there's no point looking for one.
+  if(key.width * key.height == 0) return NULL;
+
+  boost::lock_guard<boost::mutex> lock(m_state->mutex);
+  std::multimap<PoolKey,State::PooledBlock>::iterator it = m_state->pool.find(key);
+  if(it == m_state->pool.end()) return NULL;
+
+  void *block = it->second.block;
+  m_state->pooledBytes -= it->second.bytes;
+  m_state->pool.erase(it);
+  return block;
+}
+
+//#################### PRIVATE STATIC MEMBER FUNCTIONS ####################
+
+void MemoryBlockFactory::release_block(const State_Ptr& state, void *block, const PoolKey& key, void (*destroy)(void*))
+{
+  {
+    boost::lock_guard<boost::mutex> lock(state->mutex);
+
+    // Remove the block from the memory accounting.
+    std::map<const void*,State::LiveBlock>::iterator it = state->liveBlocks.find(block);
+    const size_t bytes = it->second.countBytes(block);
+    state->liveBlocks.erase(it);
+
+    // If the block is non-empty and there's room for it in the pool, add it to the pool rather than freeing it.
+    if(bytes > 0 && state->pooledBytes + bytes <= state->poolCapacity)
+    {
+      State::PooledBlock pooledBlock;
+      pooledBlock.block = block;
+      pooledBlock.bytes = bytes;
+      pooledBlock.destroy = destroy;
+      state->pool.insert(std::make_pair(key, pooledBlock));
+      state->pooledBytes += bytes;
+      return;
+    }
+  }
+
+  // Otherwise, free it (outside the lock, since freeing device memory can be slow).
+  destroy(block);
+}
+
 }
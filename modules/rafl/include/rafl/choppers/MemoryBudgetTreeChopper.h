@@ -0,0 +1,74 @@
+/**
+ * rafl: MemoryBudgetTreeChopper.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#ifndef H_RAFL_MEMORYBUDGETTREECHOPPER
+#define H_RAFL_MEMORYBUDGETTREECHOPPER
+
+#include "TreeChopper.h"
+
+namespace rafl {
+
+/**
+ * \brief An instance of this class represents a tree chopper that chops a tree whenever the memory used by the forest exceeds a specified budget.
+ *
+ * The memory used by the forest is counted with each of the examples in the reservoirs of its trees counted only once, however
+ * many trees share it. The tree chosen is the one with the highest cost, where the cost of a tree is the amount of memory that
+ * would be freed by chopping it (including the examples that are only in its reservoirs), weighted by one plus its average leaf
+ * entropy. This favours chopping trees that are both expensive and of little use (since their leaves do not separate the classes
+ * well). If the forest fits within the budget, the chopper leaves it unchanged.
+ */
+template <typename Label>
+class MemoryBudgetTreeChopper : public TreeChopper<Label>
+{
+  //#################### USINGS #################### 
+private:
+  using typename TreeChopper<Label>::RF_CPtr;
+
+  //#################### PRIVATE VARIABLES #################### 
+private:
+  /** The maximum amount of memory (in bytes) that the forest may use before one of its trees becomes liable to be chopped. */
+  size_t m_memoryBudget;
+
+  //#################### CONSTRUCTORS #################### 
+public:
+  /**
+   * \brief Constructs a memory budget tree chopper.
+   *
+   * \param memoryBudget  The maximum amount of memory (in bytes) that the forest may use before one of its trees becomes liable to be chopped.
+   */
+  explicit MemoryBudgetTreeChopper(size_t memoryBudget)
+  : m_memoryBudget(memoryBudget)
+  {}
+
+  //#################### PUBLIC MEMBER FUNCTIONS #################### 
+public:
+  /** Override */
+  virtual boost::optional<size_t> choose_tree_to_chop(const RF_CPtr& forest) const
+  {
+    // If the forest fits within the budget, leave it unchanged.
+    if(forest->get_memory_usage() <= m_memoryBudget) return boost::none;
+
+    // Otherwise, calculate the amount of memory that would be freed by chopping each tree, and pick the tree with the highest cost for chopping.
+    const size_t treeCount = forest->get_tree_count();
+    std::vector<size_t> memoryUsages = forest->get_tree_memory_usages();
+    boost::optional<size_t> treeToChop;
+    float highestCost = 0.0f;
+    for(size_t i = 0; i < treeCount; ++i)
+    {
+      float cost = memoryUsages[i] * (1.0f + forest->get_tree(i)->calculate_average_leaf_entropy());
+      if(!treeToChop || cost > highestCost)
+      {
+        treeToChop = i;
+        highestCost = cost;
+      }
+    }
+
+    return treeToChop;
+  }
+};
+
+}
+
+#endif
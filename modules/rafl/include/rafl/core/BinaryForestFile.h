@@ -0,0 +1,880 @@
+/**
+ * rafl: BinaryForestFile.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#ifndef H_RAFL_BINARYFORESTFILE
+#define H_RAFL_BINARYFORESTFILE
+
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/crc.hpp>
+#include <boost/cstdint.hpp>
+
+#include "RandomForest.h"
+#include "../decisionfunctions/FeatureThresholdingDecisionFunction.h"
+#include "../decisionfunctions/PairwiseOpAndThresholdDecisionFunction.h"
+
+namespace rafl {
+
+/**
+ * \brief An instance of an instantiation of this class template represents a random forest file in rafl's compact binary format.
+ *
+ * The file consists of a header followed by a number of sections:
+ *
+ * - The header contains a magic string, the format version, a byte-order mark, the size of a label, a table giving the type,
+ *   offset, size and checksum (CRC-32) of each section, and a checksum of the header itself.
+ * - The settings section contains the settings of the forest and the random seed of each tree.
+ * - The trees section contains the structure of each tree (with the decision function of each split node in flat form) and
+ *   the statistics of each leaf (its class histogram), i.e. everything that is needed for prediction.
+ * - The optional reservoirs section contains the examples in the reservoirs of the leaves, which are only needed for further
+ *   training. Each distinct example is stored only once, in a table of labels and features, and is referred to by its index.
+ *
+ * Opening a file reads only its header: each section is read (and its checksum verified) only when it is needed, so a forest
+ * can be loaded for prediction without reading its reservoirs at all. Labels are stored as raw bytes, so the label type must be
+ * trivially copyable, and a file can only be read on a machine with the same byte order as the one that wrote it.
+ *
+ * Unlike the Boost-based serialization of a forest, the format does not record the order in which nodes with equal
+ * splittabilities were queued for splitting, so further training of a loaded forest may break such ties differently.
+ */
+template <typename Label>
+class BinaryForestFile
+{
+  //#################### ENUMERATIONS ####################
+private:
+  /**
+   * \brief The values of this enumeration denote the types of section that a file can contain.
+   */
+  enum SectionType
+  {
+    ST_SETTINGS = 1,
+    ST_TREES = 2,
+    ST_RESERVOIRS = 3
+  };
+
+  /**
+   * \brief The values of this enumeration are constants that are used in the header of a file.
+   */
+  enum
+  {
+    /** A value whose byte pattern identifies the byte order of the machine that wrote the file. */
+    BYTE_ORDER_MARK = 0x01020304,
+
+    /** The latest version of the format (files with later versions cannot be read). */
+    FORMAT_VERSION = 1,
+
+    /** The length of the magic string at the start of the file. */
+    MAGIC_LENGTH = 8
+  };
+
+  //#################### TYPEDEFS ####################
+private:
+  typedef DecisionTree<Label> DT;
+  typedef boost::shared_ptr<DT> DT_Ptr;
+  typedef boost::shared_ptr<RandomForest<Label> > RF_Ptr;
+
+  //#################### NESTED TYPES ####################
+private:
+  /**
+   * \brief An instance of this struct describes a section of a file.
+   */
+  struct Section
+  {
+    /** The CRC-32 checksum of the contents of the section. */
+    boost::uint32_t checksum;
+
+    /** The offset of the section from the start of the file (in bytes). */
+    boost::uint64_t offset;
+
+    /** The size of the section (in bytes). */
+    boost::uint64_t size;
+
+    /** The type of the section. */
+    boost::uint32_t type;
+  };
+
+  /**
+   * \brief An instance of this class can be used to read values in turn from the contents of a section.
+   */
+  class SectionReader
+  {
+  private:
+    /** The contents of the section. */
+    const std::vector<char>& m_buffer;
+
+    /** The offset of the next value to read. */
+    size_t m_pos;
+
+  public:
+    /**
+     * \brief Constructs a reader for the contents of a section.
+     *
+     * \param buffer  The contents of the section.
+     */
+    explicit SectionReader(const std::vector<char>& buffer)
+    : m_buffer(buffer), m_pos(0)
+    {}
+
+  public:
+    /**
+     * \brief Reads a value.
+     *
+     * \param value               A location into which to read the value.
+     * \throws std::runtime_error If there are not enough bytes left in the section.
+     */
+    template <typename T>
+    void read(T& value)
+    {
+      read_bytes(&value, sizeof(T));
+    }
+
+    /**
+     * \brief Reads a number of bytes.
+     *
+     * \param dest                A location into which to read the bytes.
+     * \param size                The number of bytes to read.
+     * \throws std::runtime_error If there are not enough bytes left in the section.
+     */
+    void read_bytes(void *dest, size_t size)
+    {
+      if(size > m_buffer.size() - m_pos) throw std::runtime_error("Error: Unexpected end of section in forest file");
+      if(size > 0) std::memcpy(dest, &m_buffer[m_pos], size);
+      m_pos += size;
+    }
+
+    /**
+     * \brief Reads a string (stored as its length followed by its characters).
+     *
+     * \param s                   A location into which to read the string.
+     * \throws std::runtime_error If there are not enough bytes left in the section.
+     */
+    void read_string(std::string& s)
+    {
+      boost::uint32_t length;
+      read(length);
+      s.resize(length);
+      if(length > 0) read_bytes(&s[0], length);
+    }
+
+    /**
+     * \brief Skips a number of bytes.
+     *
+     * \param size                The number of bytes to skip.
+     * \throws std::runtime_error If there are not enough bytes left in the section.
+     */
+    void skip(size_t size)
+    {
+      if(size > m_buffer.size() - m_pos) throw std::runtime_error("Error: Unexpected end of section in forest file");
+      m_pos += size;
+    }
+  };
+
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** The path to the file. */
+  std::string m_path;
+
+  /** The sections in the file. */
+  std::vector<Section> m_sections;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Opens an existing forest file and reads its header.
+   *
+   * \param path                The path to the file.
+   * \throws std::runtime_error If the file cannot be read, or is not a forest file in a version of the format that can be read.
+   */
+  explicit BinaryForestFile(const std::string& path)
+  : m_path(path)
+  {
+    std::ifstream fs(path.c_str(), std::ios::binary);
+    if(!fs) throw std::runtime_error("Error: Could not open forest file for reading: " + path);
+
+    // Read the fixed part of the header and check that the file is one we can read.
+    std::vector<char> header(MAGIC_LENGTH + 4 * sizeof(boost::uint32_t));
+    if(!fs.read(&header[0], header.size())) throw std::runtime_error("Error: Not a rafl binary forest file: " + path);
+
+    SectionReader fixedReader(header);
+    char magic[MAGIC_LENGTH];
+    boost::uint32_t version, byteOrderMark, labelSize, sectionCount;
+    fixedReader.read_bytes(magic, MAGIC_LENGTH);
+    fixedReader.read(version);
+    fixedReader.read(byteOrderMark);
+    fixedReader.read(labelSize);
+    fixedReader.read(sectionCount);
+
+    if(std::memcmp(magic, get_magic(), MAGIC_LENGTH) != 0) throw std::runtime_error("Error: Not a rafl binary forest file: " + path);
+    if(version > FORMAT_VERSION) throw std::runtime_error("Error: The forest file was written by a later version of rafl: " + path);
+    if(byteOrderMark != BYTE_ORDER_MARK) throw std::runtime_error("Error: The forest file was written on a machine with a different byte order: " + path);
+    if(labelSize != sizeof(Label)) throw std::runtime_error("Error: The forest file was written for a different label type: " + path);
+
+    // Read the section table and the checksum of the header, and verify the checksum.
+    const size_t sectionEntrySize = 2 * sizeof(boost::uint32_t) + 2 * sizeof(boost::uint64_t);
+    const size_t fixedSize = header.size();
+    header.resize(fixedSize + sectionCount * sectionEntrySize + sizeof(boost::uint32_t));
+    if(!fs.read(&header[fixedSize], header.size() - fixedSize)) throw std::runtime_error("Error: Truncated header in forest file: " + path);
+
+    boost::uint32_t headerChecksum;
+    std::memcpy(&headerChecksum, &header[header.size() - sizeof(boost::uint32_t)], sizeof(boost::uint32_t));
+    if(calculate_checksum(&header[0], header.size() - sizeof(boost::uint32_t)) != headerChecksum)
+    {
+      throw std::runtime_error("Error: Checksum mismatch in the header of forest file: " + path);
+    }
+
+    SectionReader tableReader(header);
+    tableReader.skip(fixedSize);
+    m_sections.resize(sectionCount);
+    for(size_t i = 0; i < sectionCount; ++i)
+    {
+      tableReader.read(m_sections[i].type);
+      tableReader.read(m_sections[i].checksum);
+      tableReader.read(m_sections[i].offset);
+      tableReader.read(m_sections[i].size);
+    }
+  }
+
+  //#################### PUBLIC STATIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Saves a random forest to a file.
+   *
+   * \param forest              The forest.
+   * \param path                The path to the file.
+   * \param saveReservoirs      Whether or not to save the examples in the reservoirs of the leaves (which are only needed for further training).
+   * \throws std::runtime_error If the forest contains a decision function that has no flat form, or the file cannot be written.
+   */
+  static void save(const RandomForest<Label>& forest, const std::string& path, bool saveReservoirs = true)
+  {
+    // Make the sections.
+    std::vector<std::pair<SectionType,std::vector<char> > > sections;
+    sections.push_back(std::make_pair(ST_SETTINGS, make_settings_section(forest)));
+    sections.push_back(std::make_pair(ST_TREES, make_trees_section(forest)));
+    if(saveReservoirs) sections.push_back(std::make_pair(ST_RESERVOIRS, make_reservoirs_section(forest)));
+
+    // Make the header, including a table of the sections (which will follow the header in order) and a checksum.
+    std::vector<char> header(get_magic(), get_magic() + MAGIC_LENGTH);
+    write(header, static_cast<boost::uint32_t>(FORMAT_VERSION));
+    write(header, static_cast<boost::uint32_t>(BYTE_ORDER_MARK));
+    write(header, static_cast<boost::uint32_t>(sizeof(Label)));
+    write(header, static_cast<boost::uint32_t>(sections.size()));
+
+    const size_t sectionEntrySize = 2 * sizeof(boost::uint32_t) + 2 * sizeof(boost::uint64_t);
+    boost::uint64_t offset = header.size() + sections.size() * sectionEntrySize + sizeof(boost::uint32_t);
+    for(size_t i = 0, size = sections.size(); i < size; ++i)
+    {
+      const std::vector<char>& contents = sections[i].second;
+      write(header, static_cast<boost::uint32_t>(sections[i].first));
+      write(header, calculate_checksum(contents.empty() ? NULL : &contents[0], contents.size()));
+      write(header, offset);
+      write(header, static_cast<boost::uint64_t>(contents.size()));
+      offset += contents.size();
+    }
+
+    write(header, calculate_checksum(&header[0], header.size()));
+
+    // Write the header and the sections to the file.
+    std::ofstream fs(path.c_str(), std::ios::binary);
+    if(!fs) throw std::runtime_error("Error: Could not open forest file for writing: " + path);
+
+    fs.write(&header[0], header.size());
+    for(size_t i = 0, size = sections.size(); i < size; ++i)
+    {
+      const std::vector<char>& contents = sections[i].second;
+      if(!contents.empty()) fs.write(&contents[0], contents.size());
+    }
+
+    if(!fs) throw std::runtime_error("Error: Could not write forest file: " + path);
+  }
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Gets whether or not the file contains the examples in the reservoirs of the leaves.
+   *
+   * \return  true, if the file contains the examples in the reservoirs of the leaves, or false otherwise.
+   */
+  bool has_reservoirs() const
+  {
+    return find_section(ST_RESERVOIRS) != NULL;
+  }
+
+  /**
+   * \brief Loads the random forest from the file.
+   *
+   * If the reservoirs are not loaded, the forest can be used for prediction straight away, and can still be trained further:
+   * each leaf retains its class histogram, and its reservoir is refilled from the new examples that are added to it.
+   *
+   * \note  The decision function generator specified in the forest's settings must have been registered with the factory.
+   *
+   * \param loadReservoirs      Whether or not to load the examples in the reservoirs of the leaves (if the file contains them).
+   * \return                    The forest.
+   * \throws std::runtime_error If any of the sections that are needed are missing or corrupt.
+   */
+  RF_Ptr load_forest(bool loadReservoirs = true) const
+  {
+    RF_Ptr forest(new RandomForest<Label>);
+
+    std::vector<boost::uint32_t> treeSeeds;
+    {
+      std::vector<char> contents = read_section(ST_SETTINGS);
+      SectionReader reader(contents);
+      load_settings(reader, *forest, treeSeeds);
+    }
+
+    {
+      std::vector<char> contents = read_section(ST_TREES);
+      SectionReader reader(contents);
+      load_trees(reader, treeSeeds, *forest);
+    }
+
+    if(loadReservoirs && has_reservoirs())
+    {
+      std::vector<char> contents = read_section(ST_RESERVOIRS);
+      SectionReader reader(contents);
+      load_reservoirs(reader, *forest);
+    }
+
+    return forest;
+  }
+
+  //#################### PRIVATE MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Finds the section of the specified type in the file (if any).
+   *
+   * \param type  The type of section to find.
+   * \return      A pointer to the section, if the file contains one of the specified type, or NULL otherwise.
+   */
+  const Section *find_section(SectionType type) const
+  {
+    for(size_t i = 0, size = m_sections.size(); i < size; ++i)
+    {
+      if(m_sections[i].type == static_cast<boost::uint32_t>(type)) return &m_sections[i];
+    }
+    return NULL;
+  }
+
+  /**
+   * \brief Reads the contents of the section of the specified type from the file, and verifies its checksum.
+   *
+   * \param type                The type of section to read.
+   * \return                    The contents of the section.
+   * \throws std::runtime_error If the file does not contain a section of the specified type, or the section is corrupt.
+   */
+  std::vector<char> read_section(SectionType type) const
+  {
+    const Section *section = find_section(type);
+    if(!section) throw std::runtime_error("Error: Missing section in forest file: " + m_path);
+
+    std::vector<char> contents(static_cast<size_t>(section->size));
+    std::ifstream fs(m_path.c_str(), std::ios::binary);
+    if(!fs.seekg(static_cast<std::streamoff>(section->offset)) || (!contents.empty() && !fs.read(&contents[0], contents.size())))
+    {
+      throw std::runtime_error("Error: Truncated section in forest file: " + m_path);
+    }
+
+    if(calculate_checksum(contents.empty() ? NULL : &contents[0], contents.size()) != section->checksum)
+    {
+      throw std::runtime_error("Error: Checksum mismatch in a section of forest file: " + m_path);
+    }
+
+    return contents;
+  }
+
+  //#################### PRIVATE STATIC MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Calculates the CRC-32 checksum of a block of bytes.
+   *
+   * \param data  The bytes.
+   * \param size  The number of bytes.
+   * \return      The checksum.
+   */
+  static boost::uint32_t calculate_checksum(const char *data, size_t size)
+  {
+    boost::crc_32_type crc;
+    if(size > 0) crc.process_bytes(data, size);
+    return crc.checksum();
+  }
+
+  /**
+   * \brief Gets the magic string that identifies a forest file.
+   *
+   * \return  The magic string (this is MAGIC_LENGTH characters long, and is not null-terminated within that length).
+   */
+  static const char *get_magic()
+  {
+    return "RAFLFRST";
+  }
+
+  /**
+   * \brief Loads the examples in the reservoirs of the leaves of a forest from the contents of a reservoirs section.
+   *
+   * \param reader  A reader for the contents of the section.
+   * \param forest  The forest (whose trees must already have been loaded).
+   */
+  static void load_reservoirs(SectionReader& reader, RandomForest<Label>& forest)
+  {
+    // Read the table of distinct examples.
+    boost::uint32_t featureCount;
+    boost::uint64_t exampleCount;
+    reader.read(featureCount);
+    reader.read(exampleCount);
+
+    std::vector<Label> labels(static_cast<size_t>(exampleCount));
+    std::vector<float> features(static_cast<size_t>(exampleCount * featureCount));
+    if(!labels.empty()) reader.read_bytes(&labels[0], labels.size() * sizeof(Label));
+    if(!features.empty()) reader.read_bytes(&features[0], features.size() * sizeof(float));
+
+    // Copy the examples into the forest's example store.
+    ExampleStore<Label>& store = *forest.m_exampleStore;
+    store = ExampleStore<Label>(featureCount);
+    std::vector<size_t> exampleIndices(labels.size());
+    for(size_t i = 0, size = exampleIndices.size(); i < size; ++i)
+    {
+      exampleIndices[i] = store.add_example(featureCount > 0 ? &features[i * featureCount] : NULL, labels[i]);
+    }
+
+    // Fill the reservoirs of the leaves.
+    for(size_t t = 0, treeCount = forest.m_trees.size(); t < treeCount; ++t)
+    {
+      DT& tree = *forest.m_trees[t];
+      for(size_t i = 0, nodeCount = tree.m_nodes.size(); i < nodeCount; ++i)
+      {
+        if(!tree.is_leaf(static_cast<int>(i))) continue;
+
+        ExampleReservoir<Label>& reservoir = tree.m_nodes[i]->m_reservoir;
+        boost::uint32_t classCount;
+        reader.read(classCount);
+        for(boost::uint32_t j = 0; j < classCount; ++j)
+        {
+          Label label;
+          boost::uint32_t classSize;
+          reader.read(label);
+          reader.read(classSize);
+
+          // Note: Any examples stored for leaves that are too deep ever to be split (e.g. by older versions of the code) are skipped.
+          std::vector<size_t> *examplesForClass = reservoir.m_maxClassSize > 0 ? &reservoir.m_examples[label] : NULL;
+          for(boost::uint32_t k = 0; k < classSize; ++k)
+          {
+            boost::uint64_t exampleIndex;
+            reader.read(exampleIndex);
+            if(exampleIndex >= exampleIndices.size()) throw std::runtime_error("Error: Bad example index in forest file");
+            if(examplesForClass) examplesForClass->push_back(exampleIndices[static_cast<size_t>(exampleIndex)]);
+          }
+
+          if(examplesForClass) reservoir.m_curSize += classSize;
+        }
+      }
+    }
+
+    // Release any examples that were only in the reservoirs of leaves whose examples were skipped.
+    forest.release_unused_examples();
+  }
+
+  /**
+   * \brief Loads the settings of a forest from the contents of a settings section.
+   *
+   * \param reader    A reader for the contents of the section.
+   * \param forest    The forest.
+   * \param treeSeeds A vector into which to write the random seeds of the trees.
+   */
+  static void load_settings(SectionReader& reader, RandomForest<Label>& forest, std::vector<boost::uint32_t>& treeSeeds)
+  {
+    typename DT::Settings& settings = forest.m_settings;
+
+    boost::int32_t candidateCount;
+    boost::uint64_t maxClassSize, maxTreeHeight, seenExamplesThreshold;
+    boost::uint32_t randomSeed;
+    unsigned char usePMFReweighting;
+    std::string decisionFunctionGeneratorParams, decisionFunctionGeneratorType;
+
+    reader.read(candidateCount);
+    reader.read(settings.gainThreshold);
+    reader.read(maxClassSize);
+    reader.read(maxTreeHeight);
+    reader.read(randomSeed);
+    reader.read(seenExamplesThreshold);
+    reader.read(settings.splittabilityThreshold);
+    reader.read(usePMFReweighting);
+    reader.read_string(decisionFunctionGeneratorParams);
+    reader.read_string(decisionFunctionGeneratorType);
+
+    settings.candidateCount = candidateCount;
+    settings.decisionFunctionGenerator = DecisionFunctionGeneratorFactory<Label>::instance().make(decisionFunctionGeneratorType, decisionFunctionGeneratorParams);
+    settings.maxClassSize = static_cast<size_t>(maxClassSize);
+    settings.maxTreeHeight = static_cast<size_t>(maxTreeHeight);
+    settings.randomNumberGenerator.reset(new tvgutil::RandomNumberGenerator(randomSeed));
+    settings.seenExamplesThreshold = static_cast<size_t>(seenExamplesThreshold);
+    settings.usePMFReweighting = usePMFReweighting != 0;
+
+    boost::uint32_t treeCount;
+    reader.read(treeCount);
+    treeSeeds.resize(treeCount);
+    for(size_t i = 0; i < treeCount; ++i) reader.read(treeSeeds[i]);
+  }
+
+  /**
+   * \brief Loads the trees of a forest (without the examples in the reservoirs of their leaves) from the contents of a trees section.
+   *
+   * \param reader              A reader for the contents of the section.
+   * \param treeSeeds           The random seeds of the trees.
+   * \param forest              The forest (whose settings must already have been loaded).
+   * \throws std::runtime_error If the structure of a tree is invalid.
+   */
+  static void load_trees(SectionReader& reader, const std::vector<boost::uint32_t>& treeSeeds, RandomForest<Label>& forest)
+  {
+    for(size_t t = 0, treeCount = treeSeeds.size(); t < treeCount; ++t)
+    {
+      DT_Ptr tree(new DT);
+      tree->m_exampleStore = forest.m_exampleStore;
+      tree->m_settings = forest.m_settings;
+      tree->m_settings.randomNumberGenerator.reset(new tvgutil::RandomNumberGenerator(treeSeeds[t]));
+
+      unsigned char isValid;
+      boost::int32_t rootIndex;
+      boost::uint32_t nodeCount;
+      reader.read(isValid);
+      reader.read(rootIndex);
+      reader.read(nodeCount);
+      if(rootIndex < 0 || static_cast<boost::uint32_t>(rootIndex) >= nodeCount) throw std::runtime_error("Error: Bad root index in forest file");
+
+      tree->m_isValid = isValid != 0;
+      tree->m_rootIndex = rootIndex;
+      read_histogram(reader, tree->m_classFrequencies);
+
+      unsigned char hasInverseClassWeights;
+      reader.read(hasInverseClassWeights);
+      if(hasInverseClassWeights)
+      {
+        boost::uint32_t weightCount;
+        reader.read(weightCount);
+        std::map<Label,float> inverseClassWeights;
+        for(boost::uint32_t i = 0; i < weightCount; ++i)
+        {
+          Label label;
+          float weight;
+          reader.read(label);
+          reader.read(weight);
+          inverseClassWeights.insert(inverseClassWeights.end(), std::make_pair(label, weight));
+        }
+        tree->m_inverseClassWeights = inverseClassWeights;
+      }
+
+      // Read the nodes.
+      tree->m_nodes.reserve(nodeCount);
+      tree->m_treeDepth = 0;
+      for(boost::uint32_t i = 0; i < nodeCount; ++i)
+      {
+        boost::uint32_t depth;
+        boost::int32_t leftChildIndex, rightChildIndex;
+        reader.read(depth);
+        reader.read(leftChildIndex);
+        reader.read(rightChildIndex);
+
+        typename DT::Node_Ptr node(new typename DT::Node(depth, tree->get_max_class_size(depth), tree->m_settings.randomNumberGenerator));
+        node->m_leftChildIndex = leftChildIndex;
+        node->m_rightChildIndex = rightChildIndex;
+
+        if(leftChildIndex != -1)
+        {
+          if(leftChildIndex < 0 || rightChildIndex < 0 || static_cast<boost::uint32_t>(leftChildIndex) >= nodeCount || static_cast<boost::uint32_t>(rightChildIndex) >= nodeCount)
+          {
+            throw std::runtime_error("Error: Bad child index in forest file");
+          }
+
+          unsigned char op;
+          boost::uint32_t firstFeatureIndex, secondFeatureIndex;
+          DecisionFunction::FlatForm flatForm;
+          reader.read(op);
+          reader.read(firstFeatureIndex);
+          reader.read(secondFeatureIndex);
+          reader.read(flatForm.threshold);
+
+          flatForm.firstFeatureIndex = firstFeatureIndex;
+          flatForm.op = static_cast<DecisionFunction::FlatForm::Op>(op);
+          flatForm.secondFeatureIndex = secondFeatureIndex;
+          node->m_splitter = make_decision_function(flatForm);
+
+          // The reservoirs of split nodes are cleared (as they are when the nodes are split during training).
+          node->m_reservoir.clear();
+        }
+        else
+        {
+          boost::uint64_t seenExamples;
+          read_histogram(reader, *node->m_reservoir.m_histogram);
+          reader.read(seenExamples);
+          node->m_reservoir.m_seenExamples = static_cast<size_t>(seenExamples);
+        }
+
+        if(depth > tree->m_treeDepth) tree->m_treeDepth = depth;
+        tree->m_nodes.push_back(node);
+      }
+
+      // Queue the leaves for splitting, based on their histograms.
+      const signed char nullData = -1;
+      for(int i = 0; i < static_cast<int>(nodeCount); ++i)
+      {
+        if(!tree->is_leaf(i)) continue;
+        tree->m_splittabilityQueue.insert(i, 0.0f, nullData);
+        tree->update_splittability(i);
+      }
+
+      forest.m_trees.push_back(tree);
+    }
+  }
+
+  /**
+   * \brief Makes a decision function from its flat form.
+   *
+   * \param flatForm            The flat form of the decision function.
+   * \return                    The decision function.
+   * \throws std::runtime_error If the flat form has an unknown operation.
+   */
+  static DecisionFunction_Ptr make_decision_function(const DecisionFunction::FlatForm& flatForm)
+  {
+    switch(flatForm.op)
+    {
+      case DecisionFunction::FlatForm::FO_FIRST:
+        return DecisionFunction_Ptr(new FeatureThresholdingDecisionFunction(flatForm.firstFeatureIndex, flatForm.threshold));
+      case DecisionFunction::FlatForm::FO_ADD:
+        return DecisionFunction_Ptr(new PairwiseOpAndThresholdDecisionFunction(flatForm.firstFeatureIndex, flatForm.secondFeatureIndex, PairwiseOpAndThresholdDecisionFunction::PO_ADD, flatForm.threshold));
+      case DecisionFunction::FlatForm::FO_SUBTRACT:
+        return DecisionFunction_Ptr(new PairwiseOpAndThresholdDecisionFunction(flatForm.firstFeatureIndex, flatForm.secondFeatureIndex, PairwiseOpAndThresholdDecisionFunction::PO_SUBTRACT, flatForm.threshold));
+      default:
+        throw std::runtime_error("Error: Unknown decision function operation in forest file");
+    }
+  }
+
+  /**
+   * \brief Makes the contents of a reservoirs section for a forest.
+   *
+   * \param forest  The forest.
+   * \return        The contents of the section.
+   */
+  static std::vector<char> make_reservoirs_section(const RandomForest<Label>& forest)
+  {
+    // Assign a file index to each distinct example in the reservoirs of the leaves (the same example is generally in several trees),
+    // and record the file indices of the examples in each leaf's reservoir.
+    const ExampleStore<Label>& store = *forest.m_exampleStore;
+    const size_t featureCount = store.get_feature_count();
+    std::map<size_t,boost::uint64_t> exampleIndices;
+    std::vector<Label> labels;
+    std::vector<float> features;
+    std::vector<char> leaves;
+
+    for(size_t t = 0, treeCount = forest.m_trees.size(); t < treeCount; ++t)
+    {
+      const DT& tree = *forest.m_trees[t];
+      for(size_t i = 0, nodeCount = tree.m_nodes.size(); i < nodeCount; ++i)
+      {
+        if(!tree.is_leaf(static_cast<int>(i))) continue;
+
+        const std::map<Label,std::vector<size_t> >& examplesByClass = tree.m_nodes[i]->m_reservoir.m_examples;
+        write(leaves, static_cast<boost::uint32_t>(examplesByClass.size()));
+        for(typename std::map<Label,std::vector<size_t> >::const_iterator it = examplesByClass.begin(), iend = examplesByClass.end(); it != iend; ++it)
+        {
+          write(leaves, it->first);
+          write(leaves, static_cast<boost::uint32_t>(it->second.size()));
+          for(std::vector<size_t>::const_iterator jt = it->second.begin(), jend = it->second.end(); jt != jend; ++jt)
+          {
+            std::pair<std::map<size_t,boost::uint64_t>::iterator,bool> result = exampleIndices.insert(std::make_pair(*jt, labels.size()));
+            if(result.second)
+            {
+              const float *featuresForExample = store.get_features(*jt);
+              labels.push_back(store.get_label(*jt));
+              features.insert(features.end(), featuresForExample, featuresForExample + featureCount);
+            }
+
+            write(leaves, result.first->second);
+          }
+        }
+      }
+    }
+
+    std::vector<char> contents;
+    write(contents, static_cast<boost::uint32_t>(featureCount));
+    write(contents, static_cast<boost::uint64_t>(labels.size()));
+    if(!labels.empty()) write_bytes(contents, &labels[0], labels.size() * sizeof(Label));
+    if(!features.empty()) write_bytes(contents, &features[0], features.size() * sizeof(float));
+    contents.insert(contents.end(), leaves.begin(), leaves.end());
+    return contents;
+  }
+
+  /**
+   * \brief Makes the contents of a settings section for a forest.
+   *
+   * \param forest  The forest.
+   * \return        The contents of the section.
+   */
+  static std::vector<char> make_settings_section(const RandomForest<Label>& forest)
+  {
+    const typename DT::Settings& settings = forest.m_settings;
+
+    std::vector<char> contents;
+    write(contents, static_cast<boost::int32_t>(settings.candidateCount));
+    write(contents, settings.gainThreshold);
+    write(contents, static_cast<boost::uint64_t>(settings.maxClassSize));
+    write(contents, static_cast<boost::uint64_t>(settings.maxTreeHeight));
+    write(contents, static_cast<boost::uint32_t>(settings.randomNumberGenerator->get_seed()));
+    write(contents, static_cast<boost::uint64_t>(settings.seenExamplesThreshold));
+    write(contents, settings.splittabilityThreshold);
+    write(contents, static_cast<unsigned char>(settings.usePMFReweighting ? 1 : 0));
+    write_string(contents, settings.decisionFunctionGenerator->get_params());
+    write_string(contents, settings.decisionFunctionGenerator->get_type());
+
+    write(contents, static_cast<boost::uint32_t>(forest.m_trees.size()));
+    for(size_t t = 0, treeCount = forest.m_trees.size(); t < treeCount; ++t)
+    {
+      write(contents, static_cast<boost::uint32_t>(forest.m_trees[t]->m_settings.randomNumberGenerator->get_seed()));
+    }
+
+    return contents;
+  }
+
+  /**
+   * \brief Makes the contents of a trees section for a forest.
+   *
+   * \param forest              The forest.
+   * \return                    The contents of the section.
+   * \throws std::runtime_error If the forest contains a decision function that has no flat form.
+   */
+  static std::vector<char> make_trees_section(const RandomForest<Label>& forest)
+  {
+    std::vector<char> contents;
+    for(size_t t = 0, treeCount = forest.m_trees.size(); t < treeCount; ++t)
+    {
+      const DT& tree = *forest.m_trees[t];
+      write(contents, static_cast<unsigned char>(tree.m_isValid ? 1 : 0));
+      write(contents, static_cast<boost::int32_t>(tree.m_rootIndex));
+      write(contents, static_cast<boost::uint32_t>(tree.m_nodes.size()));
+      write_histogram(contents, tree.m_classFrequencies);
+
+      write(contents, static_cast<unsigned char>(tree.m_inverseClassWeights ? 1 : 0));
+      if(tree.m_inverseClassWeights)
+      {
+        const std::map<Label,float>& inverseClassWeights = *tree.m_inverseClassWeights;
+        write(contents, static_cast<boost::uint32_t>(inverseClassWeights.size()));
+        for(typename std::map<Label,float>::const_iterator it = inverseClassWeights.begin(), iend = inverseClassWeights.end(); it != iend; ++it)
+        {
+          write(contents, it->first);
+          write(contents, it->second);
+        }
+      }
+
+      for(size_t i = 0, nodeCount = tree.m_nodes.size(); i < nodeCount; ++i)
+      {
+        const typename DT::Node& node = *tree.m_nodes[i];
+        write(contents, static_cast<boost::uint32_t>(node.m_depth));
+        write(contents, static_cast<boost::int32_t>(node.m_leftChildIndex));
+        write(contents, static_cast<boost::int32_t>(node.m_rightChildIndex));
+
+        if(node.m_leftChildIndex != -1)
+        {
+          DecisionFunction::FlatForm flatForm;
+          if(!node.m_splitter->to_flat_form(flatForm))
+          {
+            throw std::runtime_error("Error: Cannot save a forest containing a decision function that has no flat form in binary format");
+          }
+
+          write(contents, static_cast<unsigned char>(flatForm.op));
+          write(contents, static_cast<boost::uint32_t>(flatForm.firstFeatureIndex));
+          write(contents, static_cast<boost::uint32_t>(flatForm.op == DecisionFunction::FlatForm::FO_FIRST ? 0 : flatForm.secondFeatureIndex));
+          write(contents, flatForm.threshold);
+        }
+        else
+        {
+          write_histogram(contents, *node.m_reservoir.get_histogram());
+          write(contents, static_cast<boost::uint64_t>(node.m_reservoir.seen_examples()));
+        }
+      }
+    }
+
+    return contents;
+  }
+
+  /**
+   * \brief Reads a histogram (stored as its number of bins, followed by the label and size of each bin) and adds its contents to another histogram.
+   *
+   * \param reader    A reader for the contents of a section.
+   * \param histogram The histogram to which to add the contents of the stored histogram.
+   */
+  static void read_histogram(SectionReader& reader, tvgutil::Histogram<Label>& histogram)
+  {
+    boost::uint32_t binCount;
+    reader.read(binCount);
+    for(boost::uint32_t i = 0; i < binCount; ++i)
+    {
+      Label label;
+      boost::uint64_t binSize;
+      reader.read(label);
+      reader.read(binSize);
+      histogram.add(label, static_cast<size_t>(binSize));
+    }
+  }
+
+  /**
+   * \brief Appends a value to a buffer.
+   *
+   * \param buffer  The buffer.
+   * \param value   The value.
+   */
+  template <typename T>
+  static void write(std::vector<char>& buffer, const T& value)
+  {
+    write_bytes(buffer, &value, sizeof(T));
+  }
+
+  /**
+   * \brief Appends a number of bytes to a buffer.
+   *
+   * \param buffer  The buffer.
+   * \param data    The bytes.
+   * \param size    The number of bytes.
+   */
+  static void write_bytes(std::vector<char>& buffer, const void *data, size_t size)
+  {
+    const char *bytes = static_cast<const char*>(data);
+    buffer.insert(buffer.end(), bytes, bytes + size);
+  }
+
+  /**
+   * \brief Appends a histogram to a buffer (as its number of bins, followed by the label and size of each bin).
+   *
+   * \param buffer    The buffer.
+   * \param histogram The histogram.
+   */
+  static void write_histogram(std::vector<char>& buffer, const tvgutil::Histogram<Label>& histogram)
+  {
+    const std::vector<Label>& labels = histogram.get_labels();
+    const std::vector<size_t>& binSizes = histogram.get_bin_sizes();
+    write(buffer, static_cast<boost::uint32_t>(labels.size()));
+    for(size_t i = 0, size = labels.size(); i < size; ++i)
+    {
+      write(buffer, labels[i]);
+      write(buffer, static_cast<boost::uint64_t>(binSizes[i]));
+    }
+  }
+
+  /**
+   * \brief Appends a string to a buffer (as its length followed by its characters).
+   *
+   * \param buffer  The buffer.
+   * \param s       The string.
+   */
+  static void write_string(std::vector<char>& buffer, const std::string& s)
+  {
+    write(buffer, static_cast<boost::uint32_t>(s.size()));
+    write_bytes(buffer, s.data(), s.size());
+  }
+};
+
+}
+
+#endif
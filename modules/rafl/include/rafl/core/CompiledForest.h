@@ -0,0 +1,453 @@
+/**
+ * rafl: CompiledForest.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#ifndef H_RAFL_COMPILEDFOREST
+#define H_RAFL_COMPILEDFOREST
+
+#include <algorithm>
+#include <set>
+#include <stdexcept>
+#include <vector>
+
+#include "RandomForest.h"
+
+namespace rafl {
+
+/**
+ * \brief An instance of an instantiation of this class template represents a snapshot of a random forest in a flat form that is optimised for prediction.
+ *
+ * Each tree is stored as a set of parallel arrays (a struct of arrays) indexed by node: an op code, two feature indices, a threshold and
+ * either the index of the node's left child (for a split node, whose right child always immediately follows its left child) or the index
+ * of the node's leaf slot (for a leaf). The PMF of each leaf is stored as a dense array of masses (one per label known to the forest),
+ * so that a prediction involves no virtual calls, no pointer chasing and no maps. Prediction is performed in blocks of descriptors,
+ * with every descriptor in a block being advanced by one level of each tree at a time, so that the inner loops are branch-light and
+ * amenable to vectorisation.
+ *
+ * The snapshot can be refreshed cheaply after the forest has been trained further: trees that have not changed since the last refresh
+ * are skipped, and in the trees that have changed, only the nodes that have been added or split since the last refresh are re-encoded.
+ *
+ * The compiled forest also records the version in which each node last changed, so that a caller that remembers which leaves a descriptor
+ * reached can later check whether its prediction would still be the same without having to push it through the trees again.
+ *
+ * Note that unlike RandomForest::predict, prediction does not throw if a leaf is empty; such leaves simply do not contribute to the result.
+ */
+template <typename Label>
+class CompiledForest
+{
+  //#################### ENUMERATIONS ####################
+private:
+  /**
+   * \brief The op codes used for the nodes (the op codes for split nodes are the values of DecisionFunction::FlatForm::Op).
+   */
+  enum
+  {
+    /** The op code used for leaves. */
+    OP_LEAF = 255
+  };
+
+  //#################### CONSTANTS ####################
+private:
+  /** The number of descriptors that are pushed through the trees together. */
+  static const size_t BLOCK_SIZE = 64;
+
+  //#################### TYPEDEFS ####################
+private:
+  typedef DecisionTree<Label> DT;
+  typedef boost::shared_ptr<const DT> DT_CPtr;
+
+  //#################### NESTED TYPES ####################
+private:
+  /**
+   * \brief An instance of this struct represents the compiled form of a single tree.
+   */
+  struct CompiledTree
+  {
+    /** For each node, the index of its left child (for a split node) or its leaf slot (for a leaf). */
+    std::vector<int> childOrLeafIndices;
+
+    /** For each node, the index of the first feature to which its decision function refers (0 for a leaf). */
+    std::vector<int> firstFeatureIndices;
+
+    /** The dense masses for each leaf slot (stored contiguously, one per label known to the forest). */
+    std::vector<float> leafMasses;
+
+    /** For each node, the version of the compiled forest in which the node (i.e. its decision function or, for a leaf, its masses) last changed. */
+    std::vector<size_t> nodeVersions;
+
+    /** For each node, its op code. */
+    std::vector<unsigned char> ops;
+
+    /** The revision of the source tree at the point at which it was compiled. */
+    size_t revision;
+
+    /** The index of the root node. */
+    int rootIndex;
+
+    /** For each node, the index of the second feature to which its decision function refers (0 for a leaf). */
+    std::vector<int> secondFeatureIndices;
+
+    /** The source tree (this is kept alive so that a tree that has been reset can be reliably detected). */
+    DT_CPtr source;
+
+    /** For each node, the threshold used by its decision function (0 for a leaf). */
+    std::vector<float> thresholds;
+  };
+
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** The number of features in each descriptor. */
+  size_t m_featureCount;
+
+  /** The labels known to the forest, in ascending order (the masses for each leaf are stored in this order). */
+  std::vector<Label> m_labels;
+
+  /** The compiled trees. */
+  std::vector<CompiledTree> m_trees;
+
+  /** A counter that is incremented whenever a refresh changes any of the compiled trees. */
+  size_t m_version;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Constructs an empty compiled forest (call refresh to compile a forest into it).
+   *
+   * \param featureCount  The number of features in each descriptor.
+   */
+  explicit CompiledForest(size_t featureCount)
+  : m_featureCount(featureCount), m_version(0)
+  {}
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Gets the number of trees in the compiled forest.
+   *
+   * \return The number of trees in the compiled forest.
+   */
+  size_t get_tree_count() const
+  {
+    return m_trees.size();
+  }
+
+  /**
+   * \brief Gets the version of the compiled forest, which is incremented whenever a refresh changes any of its trees.
+   *
+   * This happens when a tree is replaced, the set of known labels changes, a node is split, or the masses in any leaf change
+   * (e.g. because examples have been added to it). Labels predicted by the compiled forest at a given version can thus be
+   * reused for as long as its version stays the same (or, more finely, for as long as leaves_unchanged_since says that the
+   * leaves used to predict them have not changed).
+   *
+   * \return The version of the compiled forest.
+   */
+  size_t get_version() const
+  {
+    return m_version;
+  }
+
+  /**
+   * \brief Checks whether any of the specified leaves (one per tree, as output by predict_batch) have changed since the specified version.
+   *
+   * If they have not, a prediction that was made using those leaves in that version would still be the same now.
+   *
+   * \param leafIndices The indices of the leaves (one per tree, as output by predict_batch for a single descriptor).
+   * \param leafCount   The number of leaf indices (this must match the current number of trees for the leaves to be considered unchanged).
+   * \param version     The version of the compiled forest in which the leaves were reached.
+   * \return            true, if none of the leaves have changed since the specified version, or false otherwise.
+   */
+  bool leaves_unchanged_since(const int *leafIndices, size_t leafCount, size_t version) const
+  {
+    if(leafCount != m_trees.size()) return false;
+
+    for(size_t t = 0; t < leafCount; ++t)
+    {
+      const std::vector<size_t>& nodeVersions = m_trees[t].nodeVersions;
+      const int nodeIndex = leafIndices[t];
+      if(nodeIndex < 0 || static_cast<size_t>(nodeIndex) >= nodeVersions.size() || nodeVersions[nodeIndex] > version) return false;
+    }
+
+    return true;
+  }
+
+  /**
+   * \brief Predicts labels for a batch of descriptors.
+   *
+   * This is safe to call from several threads at once (e.g. on different parts of a batch), provided that each thread uses its own scratch buffer.
+   *
+   * \param features            The features of the descriptors, stored contiguously (i.e. descriptor i starts at features[i * featureCount]).
+   * \param count               The number of descriptors.
+   * \param out                 An array into which to write the predicted labels (must have space for count labels).
+   * \param scratch             A buffer in which to accumulate the masses of the labels (this is grown as necessary, so reusing
+   *                            the same buffer across calls avoids reallocating it).
+   * \param leafIndices         An optional array into which to write the indices of the leaves reached by each descriptor (if non-NULL,
+   *                            it must have space for count * get_tree_count() indices, and the index of the leaf in tree t that is
+   *                            reached by descriptor i will be written to leafIndices[i * get_tree_count() + t]).
+   * \throws std::runtime_error If the compiled forest does not yet know about any labels.
+   */
+  void predict_batch(const float *features, size_t count, Label *out, std::vector<float>& scratch, int *leafIndices = NULL) const
+  {
+    const size_t labelCount = m_labels.size();
+    if(labelCount == 0) throw std::runtime_error("Error: Cannot predict labels using a compiled forest that has no labels");
+
+    if(scratch.size() < BLOCK_SIZE * labelCount) scratch.resize(BLOCK_SIZE * labelCount);
+    float *masses = &scratch[0];
+    int nodeIndices[BLOCK_SIZE];
+
+    for(size_t blockBegin = 0; blockBegin < count; blockBegin += BLOCK_SIZE)
+    {
+      const size_t blockSize = count - blockBegin < BLOCK_SIZE ? count - blockBegin : BLOCK_SIZE;
+      const float *blockFeatures = features + blockBegin * m_featureCount;
+      std::fill(masses, masses + blockSize * labelCount, 0.0f);
+
+      // Sum the leaf masses for the descriptors in the block across all of the trees.
+      const size_t treeCount = m_trees.size();
+      for(size_t t = 0; t < treeCount; ++t)
+      {
+        const CompiledTree& tree = m_trees[t];
+        find_leaves(tree, blockFeatures, blockSize, nodeIndices);
+
+        if(leafIndices)
+        {
+          for(size_t i = 0; i < blockSize; ++i) leafIndices[(blockBegin + i) * treeCount + t] = nodeIndices[i];
+        }
+
+        for(size_t i = 0; i < blockSize; ++i)
+        {
+          const float *leafMasses = &tree.leafMasses[tree.childOrLeafIndices[nodeIndices[i]] * labelCount];
+          float *descriptorMasses = &masses[i * labelCount];
+          for(size_t k = 0; k < labelCount; ++k)
+          {
+            descriptorMasses[k] += leafMasses[k];
+          }
+        }
+      }
+
+      // Pick the label with the largest summed mass for each descriptor (breaking ties in favour of the smallest label, as RandomForest::predict does).
+      for(size_t i = 0; i < blockSize; ++i)
+      {
+        const float *descriptorMasses = &masses[i * labelCount];
+        size_t bestIndex = 0;
+        for(size_t k = 1; k < labelCount; ++k)
+        {
+          if(descriptorMasses[k] > descriptorMasses[bestIndex]) bestIndex = k;
+        }
+        out[blockBegin + i] = m_labels[bestIndex];
+      }
+    }
+  }
+
+  /**
+   * \brief Brings the compiled forest up to date with the specified random forest.
+   *
+   * Only the trees that have changed since the last refresh are recompiled.
+   *
+   * \param forest              The random forest.
+   * \throws std::runtime_error If the forest contains a decision function that cannot be described in flat form,
+   *                            or that refers to a feature outside the descriptors.
+   */
+  void refresh(const RandomForest<Label>& forest)
+  {
+    const size_t treeCount = forest.get_tree_count();
+
+    // Determine the labels that are known to the forest. If they have changed, the leaf masses of every tree must be recalculated.
+    std::set<Label> labelSet;
+    for(size_t t = 0; t < treeCount; ++t)
+    {
+      const std::vector<Label>& treeLabels = forest.get_tree(t)->get_class_frequencies().get_labels();
+      labelSet.insert(treeLabels.begin(), treeLabels.end());
+    }
+
+    std::vector<Label> labels(labelSet.begin(), labelSet.end());
+    const bool labelsChanged = labels != m_labels;
+    m_labels.swap(labels);
+
+    // Recompile any trees that have changed, marking any nodes that change as having done so in the next version.
+    const size_t nextVersion = m_version + 1;
+    bool changed = labelsChanged || m_trees.size() != treeCount;
+    m_trees.resize(treeCount);
+    for(size_t t = 0; t < treeCount; ++t)
+    {
+      DT_CPtr tree = forest.get_tree(t);
+      CompiledTree& compiledTree = m_trees[t];
+
+      if(compiledTree.source != tree)
+      {
+        // The tree has been replaced (or not yet compiled), so compile it from scratch.
+        compiledTree = CompiledTree();
+        compiledTree.source = tree;
+        changed = true;
+      }
+      else if(compiledTree.revision == tree->get_revision() && !labelsChanged)
+      {
+        // The tree has not changed, so there is nothing to do.
+        continue;
+      }
+
+      if(compile_tree(*tree, labelsChanged, nextVersion, compiledTree)) changed = true;
+    }
+
+    if(changed) m_version = nextVersion;
+  }
+
+  //#################### PRIVATE MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Brings the compiled form of a tree up to date.
+   *
+   * Since the nodes of a tree are never removed, and a split node never changes, only the nodes that have been added
+   * (or that were previously leaves) need to be re-encoded. The leaf masses are always recalculated, since both the
+   * contents of the leaves and the class weights used to calculate their PMFs may have changed. Any nodes that have
+   * been added or split, and any leaves whose masses have changed, are marked as having changed in the specified version.
+   *
+   * \param tree          The tree.
+   * \param labelsChanged Whether or not the labels known to the forest have changed since the tree was last compiled.
+   * \param version       The version in which any changes to the tree are being made.
+   * \param compiledTree  The compiled form of the tree.
+   * \return              true, if any nodes were added or split or the masses of any leaf changed, or false otherwise.
+   */
+  bool compile_tree(const DT& tree, bool labelsChanged, size_t version, CompiledTree& compiledTree) const
+  {
+    const size_t oldNodeCount = compiledTree.ops.size();
+    const size_t nodeCount = tree.m_nodes.size();
+    bool changed = nodeCount != oldNodeCount;
+
+    // Keep the old leaf slots and masses, so that we can tell which leaves have changed.
+    const std::vector<int> oldChildOrLeafIndices = compiledTree.childOrLeafIndices;
+    std::vector<float> oldLeafMasses;
+    oldLeafMasses.swap(compiledTree.leafMasses);
+
+    compiledTree.childOrLeafIndices.resize(nodeCount);
+    compiledTree.firstFeatureIndices.resize(nodeCount);
+    compiledTree.nodeVersions.resize(nodeCount, version);
+    compiledTree.ops.resize(nodeCount);
+    compiledTree.rootIndex = tree.m_rootIndex;
+    compiledTree.secondFeatureIndices.resize(nodeCount);
+    compiledTree.thresholds.resize(nodeCount);
+
+    // Encode the new nodes and any nodes that were previously leaves.
+    for(size_t i = 0; i < nodeCount; ++i)
+    {
+      if(i < oldNodeCount && compiledTree.ops[i] != OP_LEAF) continue;
+
+      const typename DT::Node& node = *tree.m_nodes[i];
+      if(node.m_leftChildIndex == -1)
+      {
+        compiledTree.firstFeatureIndices[i] = compiledTree.secondFeatureIndices[i] = 0;
+        compiledTree.ops[i] = OP_LEAF;
+        compiledTree.thresholds[i] = 0.0f;
+        continue;
+      }
+
+      DecisionFunction::FlatForm flatForm;
+      if(!node.m_splitter->to_flat_form(flatForm))
+      {
+        throw std::runtime_error("Error: Cannot compile a decision tree containing a decision function that has no flat form");
+      }
+
+      if(flatForm.firstFeatureIndex >= m_featureCount || flatForm.secondFeatureIndex >= m_featureCount)
+      {
+        throw std::runtime_error("Error: Cannot compile a decision tree containing a decision function that refers to a non-existent feature");
+      }
+
+      if(node.m_rightChildIndex != node.m_leftChildIndex + 1)
+      {
+        throw std::runtime_error("Error: Cannot compile a decision tree whose right children do not immediately follow their left children");
+      }
+
+      compiledTree.childOrLeafIndices[i] = node.m_leftChildIndex;
+      compiledTree.firstFeatureIndices[i] = static_cast<int>(flatForm.firstFeatureIndex);
+      compiledTree.nodeVersions[i] = version;
+      compiledTree.ops[i] = static_cast<unsigned char>(flatForm.op);
+      compiledTree.secondFeatureIndices[i] = static_cast<int>(flatForm.secondFeatureIndex);
+      compiledTree.thresholds[i] = flatForm.threshold;
+    }
+
+    // Assign each leaf a slot and calculate its dense masses.
+    const size_t labelCount = m_labels.size();
+    size_t leafCount = 0;
+    for(size_t i = 0; i < nodeCount; ++i)
+    {
+      if(compiledTree.ops[i] == OP_LEAF) ++leafCount;
+    }
+
+    compiledTree.leafMasses.assign(leafCount * labelCount, 0.0f);
+
+    int leafSlot = 0;
+    for(size_t i = 0; i < nodeCount; ++i)
+    {
+      if(compiledTree.ops[i] != OP_LEAF) continue;
+
+      compiledTree.childOrLeafIndices[i] = leafSlot;
+      const std::vector<float>::iterator leafMasses = compiledTree.leafMasses.begin() + leafSlot * labelCount;
+
+      if(tree.m_nodes[i]->m_reservoir.get_histogram()->get_count() > 0)
+      {
+        const tvgutil::ProbabilityMassFunction<Label> pmf = tree.make_pmf(static_cast<int>(i));
+        const std::vector<Label>& pmfLabels = pmf.get_labels();
+        const std::vector<float>& pmfMasses = pmf.get_mass_values();
+        for(size_t j = 0, size = pmfLabels.size(); j < size; ++j)
+        {
+          typename std::vector<Label>::const_iterator jt = std::lower_bound(m_labels.begin(), m_labels.end(), pmfLabels[j]);
+          if(jt != m_labels.end() && *jt == pmfLabels[j]) leafMasses[jt - m_labels.begin()] = pmfMasses[j];
+        }
+      }
+
+      // If the leaf is an existing one (a node that is a leaf now was already a leaf if it existed before) and its masses have changed,
+      // mark it as having changed. If the labels have changed, the old masses cannot be compared like-for-like, so we assume that it has.
+      if(i < oldNodeCount)
+      {
+        if(labelsChanged || !std::equal(leafMasses, leafMasses + labelCount, oldLeafMasses.begin() + oldChildOrLeafIndices[i] * labelCount))
+        {
+          compiledTree.nodeVersions[i] = version;
+          changed = true;
+        }
+      }
+
+      ++leafSlot;
+    }
+
+    compiledTree.revision = tree.get_revision();
+    return changed;
+  }
+
+  /**
+   * \brief Finds the leaves in a compiled tree that are reached by a block of descriptors.
+   *
+   * \param tree        The compiled tree.
+   * \param features    The features of the descriptors in the block, stored contiguously.
+   * \param blockSize   The number of descriptors in the block.
+   * \param nodeIndices An array into which to write the indices of the leaves reached by the descriptors.
+   */
+  void find_leaves(const CompiledTree& tree, const float *features, size_t blockSize, int *nodeIndices) const
+  {
+    for(size_t i = 0; i < blockSize; ++i) nodeIndices[i] = tree.rootIndex;
+
+    // Advance every descriptor in the block by one level at a time until they have all reached leaves.
+    bool active = true;
+    while(active)
+    {
+      active = false;
+      for(size_t i = 0; i < blockSize; ++i)
+      {
+        const int nodeIndex = nodeIndices[i];
+        const unsigned char op = tree.ops[nodeIndex];
+        if(op == OP_LEAF) continue;
+
+        const float *descriptor = features + i * m_featureCount;
+        const float a = descriptor[tree.firstFeatureIndices[nodeIndex]];
+        const float b = descriptor[tree.secondFeatureIndices[nodeIndex]];
+        const float value = op == DecisionFunction::FlatForm::FO_ADD ? a + b : op == DecisionFunction::FlatForm::FO_SUBTRACT ? a - b : a;
+
+        // Note: The right child immediately follows the left child. The comparison is written so as to send NaNs right, as the decision functions do.
+        nodeIndices[i] = tree.childOrLeafIndices[nodeIndex] + (value < tree.thresholds[nodeIndex] ? 0 : 1);
+        active = true;
+      }
+    }
+  }
+};
+
+}
+
+#endif
@@ -10,14 +10,24 @@
 #include <stdexcept>
 
 #include <tvgutil/containers/PriorityQueue.h>
+#include <tvgutil/misc/ThreadPool.h>
 #include <tvgutil/persistence/PropertyUtil.h>
 
 #include "../decisionfunctions/DecisionFunctionGeneratorFactory.h"
 
 namespace rafl {
 
+//#################### FORWARD DECLARATIONS ####################
+
+template <typename Label> class BinaryForestFile;
+template <typename Label> class CompiledForest;
+template <typename Label> class RandomForest;
+
 /**
  * \brief An instance of an instantiation of this class template represents a tree suitable for use within a random forest.
+ *
+ * The examples in the reservoirs of the tree's nodes are kept in an example store that is shared by all of the trees in the forest,
+ * and which is managed by the forest (the tree only ever reads from it).
  */
 template <typename Label>
 class DecisionTree
@@ -260,10 +270,16 @@ public:
 
   //#################### PRIVATE TYPEDEFS ####################
 private:
-  typedef boost::shared_ptr<const Example<Label> > Example_CPtr;
+  typedef boost::shared_ptr<const ExampleStore<Label> > ExampleStore_CPtr;
   typedef boost::shared_ptr<Node> Node_Ptr;
   typedef tvgutil::PriorityQueue<int,float,signed char,std::greater<float> > SplittabilityQueue;
 
+  //#################### FRIENDS ####################
+
+  friend class BinaryForestFile<Label>;
+  friend class CompiledForest<Label>;
+  friend class RandomForest<Label>;
+
   //#################### PRIVATE VARIABLES ####################
 private:
   /** The histogram holding the class frequencies observed in the training data. */
@@ -272,6 +288,9 @@ private:
   /** The indices of nodes to which examples have been added during the current call to add_examples() and whose splittability may need recalculating. */
   std::set<int> m_dirtyNodes;
 
+  /** The example store containing the examples in the reservoirs of the tree's nodes (this is not serialized). */
+  ExampleStore_CPtr m_exampleStore;
+
   /** The inverses of the L1-normalised class frequencies observed in the training data. */
   boost::optional<std::map<Label,float> > m_inverseClassWeights;
 
@@ -281,6 +300,9 @@ private:
   /** The nodes in the tree. */
   std::vector<Node_Ptr> m_nodes;
 
+  /** A counter that is incremented whenever the tree's structure or leaf contents change (this is not serialized). */
+  size_t m_revision;
+
   /** The root node's index in the node array. */
   int m_rootIndex;
 
@@ -298,10 +320,11 @@ public:
   /**
    * \brief Constructs an empty decision tree.
    *
-   * \param settings  The settings needed to configure the decision tree.
+   * \param settings      The settings needed to configure the decision tree.
+   * \param exampleStore  The example store containing the examples that will be added to the tree.
    */
-  explicit DecisionTree(const Settings& settings)
-  : m_isValid(false), m_settings(settings), m_treeDepth(0)
+  DecisionTree(const Settings& settings, const ExampleStore_CPtr& exampleStore)
+  : m_exampleStore(exampleStore), m_isValid(false), m_revision(0), m_settings(settings), m_treeDepth(0)
   {
     m_rootIndex = add_node(0);
 
@@ -315,42 +338,33 @@ private:
    *
    * Note: This constructor is needed for serialization and should not be used otherwise.
    */
-  DecisionTree() {}
+  DecisionTree()
+  : m_revision(0)
+  {}
 
   //#################### PUBLIC MEMBER FUNCTIONS ####################
 public:
   /**
    * \brief Adds new training examples to the decision tree.
    *
-   * \param examples  The examples to be added.
-   */
-  void add_examples(const std::vector<Example_CPtr>& examples)
-  {
-    // Create a vector of indices indicating that all the examples should be added to the tree.
-    size_t size = examples.size();
-    std::vector<size_t> indices(size);
-    for(size_t i = 0; i < size; ++i) indices[i] = i;
-
-    add_examples(examples, indices);
-  }
-
-  /**
-   * \brief Adds new training examples to the decision tree.
-   *
-   * \param examples                      A pool of examples that could potentially be added.
-   * \param indices                       The indices of the examples in the pool that should be added to the decision tree.
-   * \throws std::out_of_range_exception  If any of the indices are invalid.
+   * \param exampleIndices  The indices (in the example store) of the examples to be added.
+   * \param added           A vector into which to write a flag for each example, indicating whether or not it was stored in the reservoir of a node.
    */
-  void add_examples(const std::vector<Example_CPtr>& examples, const std::vector<size_t>& indices)
+  void add_examples(const std::vector<size_t>& exampleIndices, std::vector<unsigned char>& added)
   {
-    // Add each example indicated in the indices list to the tree.
-    for(size_t i = 0, size = indices.size(); i < size; ++i)
+    // Add each example to the tree.
+    added.resize(exampleIndices.size());
+    for(size_t i = 0, size = exampleIndices.size(); i < size; ++i)
     {
-      add_example(examples.at(indices[i]));
+      added[i] = add_example(exampleIndices[i]);
     }
 
-    // Provided we added at least one example, the tree is now valid if it wasn't already.
-    if(!examples.empty()) m_isValid = true;
+    // Provided we added at least one example, the tree is now valid if it wasn't already, and the contents of its leaves have changed.
+    if(!exampleIndices.empty())
+    {
+      m_isValid = true;
+      ++m_revision;
+    }
 
     // Update the inverse class weights (note that this must be done before updating the dirty nodes,
     // since the splittability calculations for the dirty nodes depend on the new weights).
@@ -363,7 +377,9 @@ public:
   /**
    * \brief Calculates the average leaf entropy in the tree.
    *
-   * \return  The average leaf entropy in the tree.
+   * \note  Leaves to which no examples have yet been added are ignored.
+   *
+   * \return  The average leaf entropy in the tree (0, if no examples have yet been added to any of its leaves).
    */
   float calculate_average_leaf_entropy() const
   {
@@ -371,13 +387,13 @@ public:
     size_t leafCount = 0;
     for(int nodeIndex = 0, nodeCount = static_cast<int>(m_nodes.size()); nodeIndex < nodeCount; ++nodeIndex)
     {
-      if(is_leaf(nodeIndex))
+      if(is_leaf(nodeIndex) && m_nodes[nodeIndex]->m_reservoir.get_histogram()->get_count() > 0)
       {
         totalLeafEntropy += make_pmf(nodeIndex).calculate_entropy();
         ++leafCount;
       }
     }
-    return totalLeafEntropy / leafCount;
+    return leafCount > 0 ? totalLeafEntropy / leafCount : 0.0f;
   }
 
   /**
@@ -390,6 +406,24 @@ public:
     return m_classFrequencies;
   }
 
+  /**
+   * \brief Gets an estimate of the amount of memory (in bytes) used by the tree.
+   *
+   * \note  This does not include the examples in the reservoirs of the tree's nodes, which are kept in the forest's example store
+   *        (and are often shared with other trees). See RandomForest::get_memory_usage and RandomForest::get_tree_memory_usages.
+   *
+   * \return  An estimate of the amount of memory (in bytes) used by the tree.
+   */
+  size_t get_memory_usage() const
+  {
+    size_t result = sizeof(DecisionTree) + m_nodes.capacity() * sizeof(Node_Ptr);
+    for(typename std::vector<Node_Ptr>::const_iterator it = m_nodes.begin(), iend = m_nodes.end(); it != iend; ++it)
+    {
+      result += sizeof(Node) + (*it)->m_reservoir.get_memory_usage();
+    }
+    return result;
+  }
+
   /**
    * \brief Gets the number of nodes in the tree.
    *
@@ -400,6 +434,26 @@ public:
     return m_nodes.size();
   }
 
+  /**
+   * \brief Gets the tree's revision counter, which is incremented whenever the tree's structure or leaf contents change.
+   *
+   * \return  The tree's revision counter.
+   */
+  size_t get_revision() const
+  {
+    return m_revision;
+  }
+
+  /**
+   * \brief Gets the settings used to configure the decision tree.
+   *
+   * \return  The settings used to configure the decision tree.
+   */
+  const Settings& get_settings() const
+  {
+    return m_settings;
+  }
+
   /**
    * \brief Gets the depth of the tree.
    *
@@ -455,15 +509,30 @@ public:
     return lookup_pmf(descriptor).calculate_best_label();
   }
 
+  /**
+   * \brief Sets the random number generator used by the tree (and by the example reservoirs of its nodes).
+   *
+   * \param randomNumberGenerator The random number generator.
+   */
+  void set_random_number_generator(const tvgutil::RandomNumberGenerator_Ptr& randomNumberGenerator)
+  {
+    m_settings.randomNumberGenerator = randomNumberGenerator;
+    for(size_t i = 0, size = m_nodes.size(); i < size; ++i)
+    {
+      m_nodes[i]->m_reservoir.set_random_number_generator(randomNumberGenerator);
+    }
+  }
+
   /**
    * \brief Trains the tree by splitting a number of suitable nodes.
    *
    * The number of nodes that are split in each training step is limited to ensure that a step is not overly costly.
    *
    * \param splitBudget The maximum number of nodes that may be split in this training step.
+   * \param threadPool  The thread pool on which to evaluate the split candidates for each node.
    * \return            The number of nodes that have been split.
    */
-  size_t train(size_t splitBudget)
+  size_t train(size_t splitBudget, tvgutil::ThreadPool& threadPool = tvgutil::ThreadPool::instance())
   {
     size_t nodesSplit = 0;
 
@@ -478,7 +547,7 @@ public:
       if(e.key() >= m_settings.splittabilityThreshold)
       {
         m_splittabilityQueue.pop();
-        if(split_node(e.id())) ++nodesSplit;
+        if(split_node(e.id(), threadPool)) ++nodesSplit;
         else elementsToReAdd.push_back(e);
       }
       else break;
@@ -490,6 +559,9 @@ public:
       m_splittabilityQueue.insert(it->id(), it->key(), it->data());
     }
 
+    // Record the fact that the structure of the tree has changed.
+    if(nodesSplit > 0) ++m_revision;
+
     return nodesSplit;
   }
 
@@ -498,21 +570,26 @@ private:
   /**
    * \brief Adds a new training example to the decision tree.
    *
-   * \param example The example to be added.
+   * \param exampleIndex  The index (in the example store) of the example to be added.
+   * \return              true, if the example was stored in the reservoir of the leaf to which it was added, or false otherwise.
    */
-  void add_example(const Example_CPtr& example)
+  bool add_example(size_t exampleIndex)
   {
+    const Label& label = m_exampleStore->get_label(exampleIndex);
+
     // Find the leaf to which to add the new example.
-    int leafIndex = find_leaf(*example->get_descriptor());
+    int leafIndex = find_leaf(m_exampleStore->get_features(exampleIndex));
 
     // Add the example to the leaf's reservoir.
-    m_nodes[leafIndex]->m_reservoir.add_example(example);
+    bool added = m_nodes[leafIndex]->m_reservoir.add_example(exampleIndex, label);
 
     // Mark the leaf as dirty to ensure that its splittability is properly recalculated once all of the examples have been added.
     m_dirtyNodes.insert(leafIndex);
 
     // Update the class frequency histogram.
-    m_classFrequencies.add(example->get_label());
+    m_classFrequencies.add(label);
+
+    return added;
   }
 
   /**
@@ -524,7 +601,7 @@ private:
    */
   int add_node(size_t depth)
   {
-    m_nodes.push_back(Node_Ptr(new Node(depth, m_settings.maxClassSize, m_settings.randomNumberGenerator)));
+    m_nodes.push_back(Node_Ptr(new Node(depth, get_max_class_size(depth), m_settings.randomNumberGenerator)));
     if(depth > m_treeDepth) m_treeDepth = depth;
 
     int id = static_cast<int>(m_nodes.size()) - 1;
@@ -537,21 +614,21 @@ private:
   /**
    * \brief Fills the specified reservoir with examples sampled from an input set of examples.
    *
-   * \param inputExamples The set of examples from which to sample.
+   * \param inputExamples The indices (in the example store) of the set of examples from which to sample.
    * \param multipliers   The per-class ratios between the total number of examples seen for a class and the number of examples currently in the source reservoir.
    * \param reservoir     The reservoir to fill.
    */
-  void fill_reservoir(const std::vector<Example_CPtr>& inputExamples, const std::map<Label,float>& multipliers, ExampleReservoir<Label>& reservoir)
+  void fill_reservoir(const std::vector<size_t>& inputExamples, const std::map<Label,float>& multipliers, ExampleReservoir<Label>& reservoir)
   {
     // Group the input examples by label.
-    std::map<Label,std::vector<Example_CPtr> > inputExamplesByLabel;
-    for(typename std::vector<Example_CPtr>::const_iterator it = inputExamples.begin(), iend = inputExamples.end(); it != iend; ++it)
+    std::map<Label,std::vector<size_t> > inputExamplesByLabel;
+    for(std::vector<size_t>::const_iterator it = inputExamples.begin(), iend = inputExamples.end(); it != iend; ++it)
     {
-      inputExamplesByLabel[(*it)->get_label()].push_back(*it);
+      inputExamplesByLabel[m_exampleStore->get_label(*it)].push_back(*it);
     }
 
     // For each group:
-    for(typename std::map<Label,std::vector<Example_CPtr> >::const_iterator it = inputExamplesByLabel.begin(), iend = inputExamplesByLabel.end(); it != iend; ++it)
+    for(typename std::map<Label,std::vector<size_t> >::const_iterator it = inputExamplesByLabel.begin(), iend = inputExamplesByLabel.end(); it != iend; ++it)
     {
 #if 1
       // Sample the appropriate number of examples (based on the multiplier for the group) and add them to the target reservoir.
@@ -560,16 +637,16 @@ private:
 
       float multiplier = jt->second;
       size_t sampleCount = static_cast<size_t>(it->second.size() * multiplier + 0.5f);
-      std::vector<Example_CPtr> sampledExamples = sample_examples(it->second, sampleCount);
+      std::vector<size_t> sampledExamples = sample_examples(it->second, sampleCount);
       for(size_t j = 0; j < sampleCount; ++j)
       {
-        reservoir.add_example(sampledExamples[j]);
+        reservoir.add_example(sampledExamples[j], it->first);
       }
 #else
       // Simply add all of the examples for the group to the target reservoir (useful for debugging purposes).
       for(size_t j = 0, size = it->second.size(); j < size; ++j)
       {
-        reservoir.add_example(it->second[j]);
+        reservoir.add_example(it->second[j], it->first);
       }
 #endif
     }
@@ -582,15 +659,55 @@ private:
    * \return            The index of the leaf to which an example with the descriptor would currently be added.
    */
   int find_leaf(const Descriptor& descriptor) const
+  {
+    // Note: Taking the address of the first element of an empty descriptor would be undefined behaviour.
+    return find_leaf(descriptor.empty() ? NULL : &descriptor[0]);
+  }
+
+  /**
+   * \brief Finds the index of the leaf to which an example with the specified features would currently be added.
+   *
+   * \param features  The (contiguous) features of the example.
+   * \return          The index of the leaf to which an example with the features would currently be added.
+   */
+  int find_leaf(const float *features) const
   {
     int curIndex = m_rootIndex;
     while(!is_leaf(curIndex))
     {
-      curIndex = m_nodes[curIndex]->m_splitter->classify_descriptor(descriptor) == DecisionFunction::DC_LEFT ? m_nodes[curIndex]->m_leftChildIndex : m_nodes[curIndex]->m_rightChildIndex;
+      curIndex = m_nodes[curIndex]->m_splitter->classify_features(features) == DecisionFunction::DC_LEFT ? m_nodes[curIndex]->m_leftChildIndex : m_nodes[curIndex]->m_rightChildIndex;
     }
     return curIndex;
   }
 
+  /**
+   * \brief Gets the maximum number of examples of each class to store in the reservoir of a node at the specified depth.
+   *
+   * The examples in a node's reservoir are only needed to split the node, so the reservoirs of nodes that are too deep ever
+   * to be split store no examples (only their histograms are needed, to make the PMFs for the leaves).
+   *
+   * \param depth The depth of the node.
+   * \return      The maximum number of examples of each class to store in the node's reservoir.
+   */
+  size_t get_max_class_size(size_t depth) const
+  {
+    return depth + 1 < m_settings.maxTreeHeight ? m_settings.maxClassSize : 0;
+  }
+
+  /**
+   * \brief Moves any examples loaded from an archive saved before reservoirs referred to an example store into the specified store.
+   *
+   * \param store           The example store.
+   * \param exampleIndices  A map from examples that have already been moved into the store to their indices in it.
+   */
+  void import_legacy_examples(ExampleStore<Label>& store, std::map<const Example<Label>*,size_t>& exampleIndices)
+  {
+    for(size_t i = 0, size = m_nodes.size(); i < size; ++i)
+    {
+      m_nodes[i]->m_reservoir.import_legacy_examples(store, exampleIndices);
+    }
+  }
+
   /**
    * \brief Returns whether or not the specified node is a leaf.
    *
@@ -613,6 +730,19 @@ private:
     return tvgutil::ProbabilityMassFunction<Label>(*m_nodes[leafIndex]->m_reservoir.get_histogram(), m_inverseClassWeights);
   }
 
+  /**
+   * \brief Marks the examples in the reservoirs of the tree's nodes as being in use.
+   *
+   * \param used  Flags indicating which of the rows in the example store contain examples that are in use (the flags for the tree's examples will be set).
+   */
+  void mark_used_examples(std::vector<unsigned char>& used) const
+  {
+    for(size_t i = 0, size = m_nodes.size(); i < size; ++i)
+    {
+      m_nodes[i]->m_reservoir.mark_used_examples(used);
+    }
+  }
+
   /**
    * \brief Outputs a subtree of the decision tree to a stream.
    *
@@ -640,13 +770,13 @@ private:
   /**
    * \brief Randomly samples sampleCount examples (with replacement) from the specified set of input examples.
    *
-   * \param inputExamples The set of examples from which to sample.
+   * \param inputExamples The indices (in the example store) of the set of examples from which to sample.
    * \param sampleCount   The number of samples to choose.
-   * \return              The chosen set of examples.
+   * \return              The indices of the chosen set of examples.
    */
-  std::vector<Example_CPtr> sample_examples(const std::vector<Example_CPtr>& inputExamples, size_t sampleCount)
+  std::vector<size_t> sample_examples(const std::vector<size_t>& inputExamples, size_t sampleCount)
   {
-    std::vector<Example_CPtr> outputExamples;
+    std::vector<size_t> outputExamples;
     for(size_t i = 0; i < sampleCount; ++i)
     {
       int exampleIndex = m_settings.randomNumberGenerator->generate_int_from_uniform(0, static_cast<int>(inputExamples.size()) - 1);
@@ -658,18 +788,21 @@ private:
   /**
    * \brief Attempts to split the node with the specified index.
    *
-   * \param nodeIndex The index of the node to try and split.
-   * \return          true, if the node was successfully split, or false otherwise.
+   * \param nodeIndex   The index of the node to try and split.
+   * \param threadPool  The thread pool on which to evaluate the split candidates.
+   * \return            true, if the node was successfully split, or false otherwise.
    */
-  bool split_node(int nodeIndex)
+  bool split_node(int nodeIndex, tvgutil::ThreadPool& threadPool)
   {
     Node& n = *m_nodes[nodeIndex];
     typename DecisionFunctionGenerator<Label>::Split_CPtr split = m_settings.decisionFunctionGenerator->split_examples(
       n.m_reservoir,
+      *m_exampleStore,
       m_settings.candidateCount,
       m_settings.gainThreshold,
       m_inverseClassWeights,
-      m_settings.randomNumberGenerator
+      m_settings.randomNumberGenerator,
+      threadPool
     );
     if(!split) return false;
 
@@ -740,10 +873,11 @@ private:
 
     float count = static_cast<float>(m_classFrequencies.get_count());
 
-    const std::map<Label,size_t>& bins = m_classFrequencies.get_bins();
-    for(typename std::map<Label,size_t>::const_iterator it = bins.begin(), iend = bins.end(); it != iend; ++it)
+    const std::vector<Label>& labels = m_classFrequencies.get_labels();
+    const std::vector<size_t>& binSizes = m_classFrequencies.get_bin_sizes();
+    for(size_t i = 0, size = labels.size(); i < size; ++i)
     {
-      (*m_inverseClassWeights)[it->first] = count / it->second;
+      (*m_inverseClassWeights)[labels[i]] = count / binSizes[i];
     }
   }
 
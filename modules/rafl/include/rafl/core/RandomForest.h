@@ -6,12 +6,33 @@
 #ifndef H_RAFL_RANDOMFOREST
 #define H_RAFL_RANDOMFOREST
 
+#include <climits>
+#include <numeric>
+
+#include <boost/bind.hpp>
+#include <boost/mpl/int.hpp>
+#include <boost/serialization/version.hpp>
+
+#include <tvgutil/misc/TaskGroup.h>
+
 #include "DecisionTree.h"
 
 namespace rafl {
 
+//#################### FORWARD DECLARATIONS ####################
+
+template <typename Label> class BinaryForestFile;
+
 /**
  * \brief An instance of an instantiation of this class template represents a random forest.
+ *
+ * The trees in the forest are independent of each other: each has its own stream of random numbers (seeded from the
+ * forest's random number generator when the tree is made), so examples can be added to them and they can be trained
+ * in parallel on a thread pool, with results that do not depend on the number of threads used.
+ *
+ * The examples in the reservoirs of the trees' nodes are kept in a single example store that is owned by the forest,
+ * so that an example that is in the reservoirs of several trees is only stored once. Examples that are no longer in
+ * any reservoir are released from the store from time to time, so that their rows can be reused for new examples.
  */
 template <typename Label>
 class RandomForest
@@ -19,15 +40,32 @@ class RandomForest
   //#################### TYPEDEFS ####################
 private:
   typedef boost::shared_ptr<const Example<Label> > Example_CPtr;
+  typedef boost::shared_ptr<ExampleStore<Label> > ExampleStore_Ptr;
   typedef DecisionTree<Label> DT;
   typedef boost::shared_ptr<DT> DT_Ptr;
   typedef boost::shared_ptr<const DT> DT_CPtr;
 
+  //#################### FRIENDS ####################
+
+  friend class BinaryForestFile<Label>;
+
   //#################### PRIVATE VARIABLES ####################
 private:
-  /** The settings needed to configure the decision trees. */
+  /** The number of examples in the store above which any examples that are no longer in use will next be released (this is not serialized). */
+  size_t m_collectionThreshold;
+
+  /** The example store containing the examples in the reservoirs of the trees' nodes. */
+  ExampleStore_Ptr m_exampleStore;
+
+  /** The position in the tree order from which to start when sharing out a split budget between the trees (this is not serialized). */
+  size_t m_roundRobinOffset;
+
+  /** The settings needed to configure the decision trees (the random number generator is used to seed those of the trees). */
   typename DT::Settings m_settings;
 
+  /** The thread pool on which to add examples to and train the trees (this is not serialized). */
+  tvgutil::ThreadPool *m_threadPool;
+
   /** The decision trees that collectively make up the random forest. */
   std::vector<DT_Ptr> m_trees;
 
@@ -40,11 +78,11 @@ public:
    * \param settings  The settings needed to configure the decision trees.
    */
   RandomForest(size_t treeCount, const typename DT::Settings& settings)
-  : m_settings(settings)
+  : m_collectionThreshold(0), m_exampleStore(new ExampleStore<Label>), m_roundRobinOffset(0), m_settings(settings), m_threadPool(&tvgutil::ThreadPool::instance())
   {
     for(size_t i = 0; i < treeCount; ++i)
     {
-      m_trees.push_back(DT_Ptr(new DT(settings)));
+      m_trees.push_back(make_tree());
     }
   }
 
@@ -54,7 +92,9 @@ private:
    *
    * Note: This constructor is needed for serialization and should not be used otherwise.
    */
-  RandomForest() {}
+  RandomForest()
+  : m_collectionThreshold(0), m_exampleStore(new ExampleStore<Label>), m_roundRobinOffset(0), m_threadPool(&tvgutil::ThreadPool::instance())
+  {}
 
   //#################### PUBLIC MEMBER FUNCTIONS ####################
 public:
@@ -65,11 +105,12 @@ public:
    */
   void add_examples(const std::vector<Example_CPtr>& examples)
   {
-    // Add the new examples to the different trees.
-    for(typename std::vector<DT_Ptr>::const_iterator it = m_trees.begin(), iend = m_trees.end(); it != iend; ++it)
-    {
-      (*it)->add_examples(examples);
-    }
+    // Create a vector of indices indicating that all the examples should be added to the trees.
+    size_t size = examples.size();
+    std::vector<size_t> indices(size);
+    for(size_t i = 0; i < size; ++i) indices[i] = i;
+
+    add_examples(examples, indices);
   }
 
   /**
@@ -78,14 +119,36 @@ public:
    * \param examples                      A pool of examples that could potentially be added.
    * \param indices                       The indices of the examples in the pool that should be added to the forest.
    * \throws std::out_of_range_exception  If any of the indices are invalid.
+   * \throws std::runtime_error           If the examples do not all have the same number of features as those already in the forest.
    */
   void add_examples(const std::vector<Example_CPtr>& examples, const std::vector<size_t>& indices)
   {
-    // Add the new examples to the different trees.
-    for(typename std::vector<DT_Ptr>::const_iterator it = m_trees.begin(), iend = m_trees.end(); it != iend; ++it)
+    // Check the indices up-front, so that an invalid index cannot leave the trees in inconsistent states.
+    for(size_t i = 0, size = indices.size(); i < size; ++i)
     {
-      (*it)->add_examples(examples, indices);
+      if(indices[i] >= examples.size()) throw std::out_of_range("Bad example index whilst trying to add examples to a forest");
     }
+
+    // Copy the new examples into the example store.
+    std::vector<size_t> exampleIndices = m_exampleStore->add_examples(examples, indices);
+
+    // Add the new examples to the different trees in parallel.
+    std::vector<std::vector<unsigned char> > added(m_trees.size());
+    m_threadPool->parallel_for(0, m_trees.size(), boost::bind(&RandomForest::add_examples_to_tree, this, _1, boost::cref(exampleIndices), boost::ref(added)), 1);
+
+    // Release any new examples that did not end up in the reservoirs of any of the trees straight away.
+    for(size_t i = 0, size = exampleIndices.size(); i < size; ++i)
+    {
+      bool used = false;
+      for(size_t j = 0, treeCount = added.size(); j < treeCount && !used; ++j)
+      {
+        used = added[j][i] != 0;
+      }
+
+      if(!used) m_exampleStore->release_example(exampleIndices[i]);
+    }
+
+    release_unused_examples_if_necessary();
   }
 
   /**
@@ -103,10 +166,11 @@ public:
     for(typename std::vector<DT_Ptr>::const_iterator it = m_trees.begin(), iend = m_trees.end(); it != iend; ++it)
     {
       tvgutil::ProbabilityMassFunction<Label> individualPMF = (*it)->lookup_pmf(descriptor);
-      const std::map<Label,float>& individualMasses = individualPMF.get_masses();
-      for(typename std::map<Label,float>::const_iterator jt = individualMasses.begin(), jend = individualMasses.end(); jt != jend; ++jt)
+      const std::vector<Label>& individualLabels = individualPMF.get_labels();
+      const std::vector<float>& individualMasses = individualPMF.get_mass_values();
+      for(size_t i = 0, size = individualLabels.size(); i < size; ++i)
       {
-        masses[jt->first] += jt->second;
+        masses[individualLabels[i]] += individualMasses[i];
       }
     }
 
@@ -114,6 +178,23 @@ public:
     return tvgutil::ProbabilityMassFunction<Label>(masses);
   }
 
+  /**
+   * \brief Gets an estimate of the amount of memory (in bytes) used by the forest, including the examples in the reservoirs of its trees.
+   *
+   * \note  Each example is counted only once, however many reservoirs contain it.
+   *
+   * \return  An estimate of the amount of memory (in bytes) used by the forest.
+   */
+  size_t get_memory_usage() const
+  {
+    size_t result = sizeof(ExampleStore<Label>) + m_exampleStore->get_memory_usage();
+    for(typename std::vector<DT_Ptr>::const_iterator it = m_trees.begin(), iend = m_trees.end(); it != iend; ++it)
+    {
+      result += (*it)->get_memory_usage();
+    }
+    return result;
+  }
+
   /**
    * \brief Gets the specified tree in the forest.
    *
@@ -126,6 +207,49 @@ public:
     else throw std::runtime_error("Bad tree index");
   }
 
+  /**
+   * \brief Gets estimates of the amounts of memory (in bytes) that would be freed by resetting each of the trees in the forest.
+   *
+   * The estimate for a tree includes the memory used by the tree itself, and by any examples that are only in the reservoirs of
+   * that tree. Examples that are also in the reservoirs of other trees would not be freed, so they are not attributed to any tree
+   * (which means that the estimates for the trees may sum to less than the amount of memory used by the forest).
+   *
+   * \return  Estimates of the amounts of memory (in bytes) that would be freed by resetting each of the trees in the forest.
+   */
+  std::vector<size_t> get_tree_memory_usages() const
+  {
+    const size_t treeCount = m_trees.size();
+    const size_t rowCount = m_exampleStore->get_row_count();
+
+    // Find the only tree whose reservoirs contain the example in each row of the store (-1 if no tree does, or -2 if several trees do).
+    std::vector<int> owners(rowCount, -1);
+    std::vector<unsigned char> used;
+    for(size_t i = 0; i < treeCount; ++i)
+    {
+      used.assign(rowCount, 0);
+      m_trees[i]->mark_used_examples(used);
+      for(size_t j = 0; j < rowCount; ++j)
+      {
+        if(used[j]) owners[j] = owners[j] == -1 ? static_cast<int>(i) : -2;
+      }
+    }
+
+    // Add the memory used by the examples that are only in the reservoirs of each tree to the memory used by the tree itself.
+    std::vector<size_t> result(treeCount);
+    for(size_t i = 0; i < treeCount; ++i)
+    {
+      result[i] = m_trees[i]->get_memory_usage();
+    }
+
+    const size_t exampleMemoryUsage = m_exampleStore->get_example_memory_usage();
+    for(size_t j = 0; j < rowCount; ++j)
+    {
+      if(owners[j] >= 0) result[owners[j]] += exampleMemoryUsage;
+    }
+
+    return result;
+  }
+
   /**
    * \brief Gets the number of trees in the forest.
    *
@@ -206,28 +330,184 @@ public:
    */
   void reset_tree(size_t treeIndex)
   {
-    if(treeIndex < m_trees.size()) m_trees[treeIndex].reset(new DT(m_settings));
+    if(treeIndex < m_trees.size()) m_trees[treeIndex] = make_tree();
     else throw std::runtime_error("Bad tree index whilst trying to reset tree");
+
+    // Release the examples that were only in the reservoirs of the old tree, so that the memory they use can be reclaimed straight away.
+    release_unused_examples();
+  }
+
+  /**
+   * \brief Sets the thread pool on which to add examples to and train the trees.
+   *
+   * \param threadPool  The thread pool (this must outlive the forest, or until another pool is set).
+   */
+  void set_thread_pool(tvgutil::ThreadPool& threadPool)
+  {
+    m_threadPool = &threadPool;
   }
 
   /**
    * \brief Trains the forest by splitting a number of suitable nodes in each tree.
    *
    * The number of nodes that are split in each training step is limited to ensure that a step is not overly costly.
+   * The trees are trained in parallel.
    *
    * \param splitBudget The maximum number of nodes per tree that may be split in this training step.
    * \return            The total number of nodes that have been split across all the trees.
    */
   size_t train(size_t splitBudget)
   {
+    std::vector<size_t> treeIndices(m_trees.size());
+    for(size_t i = 0, size = treeIndices.size(); i < size; ++i) treeIndices[i] = i;
+
+    std::vector<size_t> nodesSplit;
+    train_trees(treeIndices, splitBudget, nodesSplit);
+    release_unused_examples_if_necessary();
+    return std::accumulate(nodesSplit.begin(), nodesSplit.end(), static_cast<size_t>(0));
+  }
+
+  /**
+   * \brief Trains the forest by splitting a number of suitable nodes, subject to an overall budget that is shared between the trees.
+   *
+   * The budget is shared out in rounds. In each round, the remaining budget is divided evenly between the trees that still
+   * have nodes worth splitting, and those trees are trained in parallel. Any tree that uses less than its share drops out,
+   * and what it did not use is shared between the others in the next round. If there is less budget left than there are
+   * trees, the trees that get a split are chosen in round-robin order across calls, so that no tree is starved. This bounds
+   * the cost of a training step (e.g. per frame) whilst still letting the trees that can most use the splits have them.
+   *
+   * \param splitBudget The maximum number of nodes that may be split in this training step (across all the trees).
+   * \return            The total number of nodes that have been split across all the trees.
+   */
+  size_t train_within_budget(size_t splitBudget)
+  {
+    const size_t treeCount = m_trees.size();
+    if(treeCount == 0) return 0;
+
+    std::vector<size_t> activeTrees(treeCount);
+    for(size_t i = 0; i < treeCount; ++i) activeTrees[i] = (m_roundRobinOffset + i) % treeCount;
+    m_roundRobinOffset = (m_roundRobinOffset + 1) % treeCount;
+
     size_t nodesSplit = 0;
-    for(typename std::vector<DT_Ptr>::const_iterator it = m_trees.begin(), iend = m_trees.end(); it != iend; ++it)
+    while(nodesSplit < splitBudget && !activeTrees.empty())
     {
-      nodesSplit += (*it)->train(splitBudget);
+      // Share the remaining budget between the active trees (if there is not enough for all of them, the ones at the front get one split each).
+      const size_t remainingBudget = splitBudget - nodesSplit;
+      const size_t roundTreeCount = std::min(activeTrees.size(), remainingBudget);
+      const size_t share = remainingBudget / roundTreeCount;
+
+      std::vector<size_t> roundTrees(activeTrees.begin(), activeTrees.begin() + roundTreeCount);
+      std::vector<size_t> roundNodesSplit;
+      train_trees(roundTrees, share, roundNodesSplit);
+
+      // The trees that did not take part in this round stay active (and move to the front). Of the trees that did take part,
+      // only those that used their whole share stay active; the others have no more nodes that are worth splitting for now.
+      std::vector<size_t> stillActiveTrees(activeTrees.begin() + roundTreeCount, activeTrees.end());
+      for(size_t i = 0; i < roundTreeCount; ++i)
+      {
+        nodesSplit += roundNodesSplit[i];
+        if(roundNodesSplit[i] == share) stillActiveTrees.push_back(roundTrees[i]);
+      }
+
+      activeTrees.swap(stillActiveTrees);
     }
+
+    release_unused_examples_if_necessary();
     return nodesSplit;
   }
 
+  //#################### PRIVATE MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Adds new training examples to the specified tree.
+   *
+   * \param treeIndex       The index of the tree.
+   * \param exampleIndices  The indices (in the example store) of the examples to be added.
+   * \param added           The flags indicating which of the examples each tree stored in the reservoir of a node (the flags for the tree will be set).
+   */
+  void add_examples_to_tree(size_t treeIndex, const std::vector<size_t>& exampleIndices, std::vector<std::vector<unsigned char> >& added)
+  {
+    m_trees[treeIndex]->add_examples(exampleIndices, added[treeIndex]);
+  }
+
+  /**
+   * \brief Makes a new decision tree with its own stream of random numbers.
+   *
+   * \return  The decision tree.
+   */
+  DT_Ptr make_tree()
+  {
+    typename DT::Settings treeSettings = m_settings;
+    treeSettings.randomNumberGenerator = make_tree_random_number_generator();
+    return DT_Ptr(new DT(treeSettings, m_exampleStore));
+  }
+
+  /**
+   * \brief Makes a random number generator for a tree, seeded from the forest's random number generator.
+   *
+   * \return  The random number generator.
+   */
+  tvgutil::RandomNumberGenerator_Ptr make_tree_random_number_generator()
+  {
+    unsigned int seed = static_cast<unsigned int>(m_settings.randomNumberGenerator->generate_int_from_uniform(0, INT_MAX));
+    return tvgutil::RandomNumberGenerator_Ptr(new tvgutil::RandomNumberGenerator(seed));
+  }
+
+  /**
+   * \brief Releases all of the examples in the store that are no longer in the reservoirs of any of the trees.
+   *
+   * Examples stop being in use when they are replaced in a reservoir, or when the node whose reservoir they are in is split,
+   * or when the tree whose reservoirs they are in is reset. Rather than tracking this as it happens, the forest marks the
+   * examples that are still in use and releases the others.
+   */
+  void release_unused_examples()
+  {
+    std::vector<unsigned char> used(m_exampleStore->get_row_count(), 0);
+    for(typename std::vector<DT_Ptr>::const_iterator it = m_trees.begin(), iend = m_trees.end(); it != iend; ++it)
+    {
+      (*it)->mark_used_examples(used);
+    }
+
+    m_exampleStore->release_unused_examples(used);
+
+    // Wait until the store has at least doubled in size before doing this again, so that the cost is amortised over the examples added.
+    m_collectionThreshold = 2 * m_exampleStore->get_example_count();
+  }
+
+  /**
+   * \brief Releases all of the examples in the store that are no longer in use, if the store has grown enough since this was last done.
+   */
+  void release_unused_examples_if_necessary()
+  {
+    if(m_exampleStore->get_example_count() > m_collectionThreshold) release_unused_examples();
+  }
+
+  /**
+   * \brief Trains one of a set of trees by splitting a number of suitable nodes.
+   *
+   * \param treeIndices The indices of the trees in the set.
+   * \param splitBudget The maximum number of nodes that may be split in the tree.
+   * \param nodesSplit  The numbers of nodes that have been split in the trees in the set (the element for the tree will be set).
+   * \param i           The index of the tree within the set.
+   */
+  void train_tree(const std::vector<size_t>& treeIndices, size_t splitBudget, std::vector<size_t>& nodesSplit, size_t i)
+  {
+    nodesSplit[i] = m_trees[treeIndices[i]]->train(splitBudget, *m_threadPool);
+  }
+
+  /**
+   * \brief Trains a set of trees in parallel by splitting a number of suitable nodes in each of them.
+   *
+   * \param treeIndices The indices of the trees to train.
+   * \param splitBudget The maximum number of nodes per tree that may be split.
+   * \param nodesSplit  A vector into which to write the number of nodes that were split in each tree (in the same order as the indices).
+   */
+  void train_trees(const std::vector<size_t>& treeIndices, size_t splitBudget, std::vector<size_t>& nodesSplit)
+  {
+    nodesSplit.assign(treeIndices.size(), 0);
+    m_threadPool->parallel_for(0, treeIndices.size(), boost::bind(&RandomForest::train_tree, this, boost::cref(treeIndices), splitBudget, boost::ref(nodesSplit), _1), 1);
+  }
+
   //#################### SERIALIZATION ####################
 private:
   /**
@@ -240,7 +520,32 @@ private:
   void serialize(Archive& ar, const unsigned int version)
   {
     ar & m_settings;
+
+    // Forests saved by earlier versions of rafl did not have an example store (the reservoirs stored the examples themselves).
+    if(version > 0) ar & m_exampleStore;
+
     ar & m_trees;
+
+    if(Archive::is_loading::value)
+    {
+      std::map<const Example<Label>*,size_t> exampleIndices;
+      for(size_t i = 0, size = m_trees.size(); i < size; ++i)
+      {
+        // Give the tree access to the example store. The reservoirs of forests saved by earlier versions of rafl stored
+        // the examples themselves, so move the examples in the reservoirs of such a forest into the store.
+        m_trees[i]->m_exampleStore = m_exampleStore;
+        if(version == 0) m_trees[i]->import_legacy_examples(*m_exampleStore, exampleIndices);
+
+        // Forests saved by earlier versions of rafl used a single random number generator for the forest and all of its trees.
+        // Since the trees are now trained in parallel, give each tree of such a forest a stream of random numbers of its own.
+        if(m_trees[i]->get_settings().randomNumberGenerator == m_settings.randomNumberGenerator)
+        {
+          m_trees[i]->set_random_number_generator(make_tree_random_number_generator());
+        }
+      }
+
+      m_collectionThreshold = 2 * m_exampleStore->get_example_count();
+    }
   }
 
   friend class boost::serialization::access;
@@ -248,4 +553,24 @@ private:
 
 }
 
+//#################### SERIALIZATION VERSION ####################
+
+namespace boost { namespace serialization {
+
+/**
+ * \brief Specifies the current version of the archive format for random forests.
+ *
+ * Version 0: The forest has no example store (the reservoirs of its trees store the examples themselves).
+ * Version 1: The forest has an example store, which contains the examples in the reservoirs of its trees.
+ */
+template <typename Label>
+struct version<rafl::RandomForest<Label> >
+{
+  typedef mpl::int_<1> type;
+  typedef mpl::integral_c_tag tag;
+  BOOST_STATIC_CONSTANT(int, value = version::type::value);
+};
+
+}}
+
 #endif
@@ -21,10 +21,6 @@ class CompositeDecisionFunctionGenerator : public DecisionFunctionGenerator<Labe
 protected:
   typedef boost::shared_ptr<const DecisionFunctionGenerator<Label> > DecisionFunctionGenerator_CPtr;
 
-  //#################### USINGS ####################
-protected:
-  using typename DecisionFunctionGenerator<Label>::Example_CPtr;
-
   //#################### PRIVATE VARIABLES ####################
 private:
   /** An array of subsidiary generators that can be used to generate candidate decision functions. */
@@ -33,11 +29,11 @@ private:
   //#################### PUBLIC MEMBER FUNCTIONS ####################
 public:
   /** Override */
-  virtual DecisionFunction_Ptr generate_candidate_decision_function(const std::vector<Example_CPtr>& examples, const tvgutil::RandomNumberGenerator_Ptr& randomNumberGenerator) const
+  virtual DecisionFunction_Ptr generate_candidate_decision_function(const ExampleStore<Label>& store, const std::vector<size_t>& exampleIndices, const tvgutil::RandomNumberGenerator_Ptr& randomNumberGenerator) const
   {
     // Pick a random subsidiary generator and use it to generate a candidate decision function.
     int generatorIndex = randomNumberGenerator->generate_int_from_uniform(0, static_cast<int>(m_generators.size()) - 1);
-    return m_generators[generatorIndex]->generate_candidate_decision_function(examples, randomNumberGenerator);
+    return m_generators[generatorIndex]->generate_candidate_decision_function(store, exampleIndices, randomNumberGenerator);
   }
 
   //#################### PROTECTED MEMBER FUNCTIONS ####################
@@ -42,6 +42,42 @@ public:
     DC_RIGHT
   };
 
+  //#################### NESTED TYPES ####################
+public:
+  /**
+   * \brief An instance of this struct describes a decision function of the form "op(descriptor[firstFeatureIndex], descriptor[secondFeatureIndex]) < threshold"
+   *        in a flat form that can be evaluated without a virtual function call (as is done by compiled forests).
+   */
+  struct FlatForm
+  {
+    /**
+     * \brief The operations that can be applied to the features.
+     */
+    enum Op
+    {
+      /** The first feature should be used on its own. */
+      FO_FIRST,
+
+      /** The two features should be added together. */
+      FO_ADD,
+
+      /** The second feature should be subtracted from the first feature. */
+      FO_SUBTRACT
+    };
+
+    /** The index of the first feature in a feature descriptor. */
+    size_t firstFeatureIndex;
+
+    /** The operation to apply to the features. */
+    Op op;
+
+    /** The index of the second feature in a feature descriptor (ignored if op is FO_FIRST). */
+    size_t secondFeatureIndex;
+
+    /** The threshold against which to compare the result of the operation. */
+    float threshold;
+  };
+
   //#################### DESTRUCTOR ####################
 public:
   /**
@@ -52,12 +88,12 @@ public:
   //#################### PUBLIC ABSTRACT MEMBER FUNCTIONS ####################
 public:
   /**
-   * \brief Classifies the specified descriptor using the decision function.
+   * \brief Classifies a descriptor, specified as a contiguous array of features, using the decision function.
    *
-   * \param descriptor  The descriptor to classify.
-   * \return            DC_LEFT, if the descriptor should be sent down the left subtree of the node, or DC_RIGHT otherwise.
+   * \param features  The features of the descriptor to classify.
+   * \return          DC_LEFT, if the descriptor should be sent down the left subtree of the node, or DC_RIGHT otherwise.
    */
-  virtual DescriptorClassification classify_descriptor(const Descriptor& descriptor) const = 0;
+  virtual DescriptorClassification classify_features(const float *features) const = 0;
 
   /**
    * \brief Outputs the decision function to the specified stream.
@@ -66,6 +102,31 @@ public:
    */
   virtual void output(std::ostream& os) const = 0;
 
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Classifies the specified descriptor using the decision function.
+   *
+   * \param descriptor  The descriptor to classify.
+   * \return            DC_LEFT, if the descriptor should be sent down the left subtree of the node, or DC_RIGHT otherwise.
+   */
+  DescriptorClassification classify_descriptor(const Descriptor& descriptor) const
+  {
+    // Note: Taking the address of the first element of an empty descriptor would be undefined behaviour.
+    return classify_features(descriptor.empty() ? NULL : &descriptor[0]);
+  }
+
+  /**
+   * \brief Attempts to describe the decision function in flat form.
+   *
+   * \param flatForm  A location into which to write the flat form of the decision function.
+   * \return          true, if the decision function can be described in flat form, or false otherwise.
+   */
+  virtual bool to_flat_form(FlatForm&) const
+  {
+    return false;
+  }
+
   //#################### SERIALIZATION #################### 
 private:
   /**
@@ -6,13 +6,17 @@
 #ifndef H_RAFL_DECISIONFUNCTIONGENERATOR
 #define H_RAFL_DECISIONFUNCTIONGENERATOR
 
+#include <algorithm>
+#include <cmath>
 #include <utility>
 
-#ifdef WITH_OPENMP
-#include <omp.h>
-#endif
+#include <boost/bind.hpp>
+#include <boost/thread/tss.hpp>
+
+#include <tvgutil/misc/TaskGroup.h>
 
 #include "../examples/ExampleReservoir.h"
+#include "../examples/ExampleStore.h"
 #include "../examples/ExampleUtil.h"
 #include "DecisionFunction.h"
 
@@ -25,11 +29,86 @@ namespace rafl {
 template <typename Label>
 class DecisionFunctionGenerator
 {
-  //#################### PROTECTED TYPEDEFS ####################
-protected:
-  typedef boost::shared_ptr<const Example<Label> > Example_CPtr;
-
   //#################### NESTED TYPES ####################
+private:
+  /**
+   * \brief An instance of this struct holds the scratch arrays used by a thread when evaluating split candidates.
+   *
+   * Each thread that evaluates candidates has its own instance, which is reused (and only grown when necessary) across all
+   * of the candidates that the thread evaluates, so that evaluating a candidate does not need to allocate any memory.
+   */
+  struct CandidateScratch
+  {
+    /** The number of examples with each (dense) label that are sent left by the candidate. */
+    std::vector<size_t> m_leftCounts;
+
+    /** The masses of the PMFs whose entropies are calculated when evaluating the candidate. */
+    std::vector<float> m_masses;
+
+    /** A mask indicating which examples are sent left by the candidate. */
+    std::vector<unsigned char> m_mask;
+  };
+
+  /**
+   * \brief An instance of this struct represents a run of consecutive examples in the set being split that share the same label.
+   */
+  struct LabelRun
+  {
+    /** The position in the set of the first example in the run. */
+    size_t m_begin;
+
+    /** The position in the set one past the last example in the run. */
+    size_t m_end;
+
+    /** The dense index of the label shared by the examples in the run. */
+    size_t m_labelIndex;
+  };
+
+  /**
+   * \brief An instance of this struct holds the state shared by the evaluations of the split candidates for a single call to split_examples.
+   */
+  struct SplitEvaluationState
+  {
+    /** The split candidates. */
+    std::vector<DecisionFunction_Ptr> m_candidates;
+
+    /** A map from feature indices to the indices of the corresponding feature columns (-1 for features without a column). */
+    std::vector<int> m_columnIndices;
+
+    /** The indices (in the example store) of the examples to split. */
+    std::vector<size_t> m_exampleIndices;
+
+    /** The feature columns used by the flat forms of the split candidates (each of which contains one feature for every example). */
+    std::vector<float> m_columns;
+
+    /** Flags indicating which of the split candidates have flat forms. */
+    std::vector<char> m_flat;
+
+    /** The flat forms of the split candidates (where available). */
+    std::vector<DecisionFunction::FlatForm> m_flatForms;
+
+    /** The information gains we would obtain from the split candidates. */
+    std::vector<float> m_gains;
+
+    /** The entropy of the examples before the split. */
+    float m_initialEntropy;
+
+    /** The per-class ratios with which to scale the probabilities for the different (dense) labels. */
+    std::vector<float> m_labelMultipliers;
+
+    /** The runs of consecutive examples in the set being split that share the same label. */
+    std::vector<LabelRun> m_labelRuns;
+
+    /** The example store containing the examples to split. */
+    const ExampleStore<Label> *m_store;
+
+    /** The number of examples with each (dense) label. */
+    std::vector<size_t> m_totalCounts;
+
+    /** Flags indicating which of the split candidates would send at least one example each way. */
+    std::vector<char> m_usable;
+  };
+
 public:
   /**
    * \brief An instance of this struct represents a split of a set of examples into two subsets,
@@ -40,11 +119,11 @@ public:
     /** The decision function that induced the split. */
     DecisionFunction_Ptr m_decisionFunction;
 
-    /** The examples that were sent left by the decision function. */
-    std::vector<Example_CPtr> m_leftExamples;
+    /** The indices (in the example store) of the examples that were sent left by the decision function. */
+    std::vector<size_t> m_leftExamples;
 
-    /** The examples that were sent right by the decision function. */
-    std::vector<Example_CPtr> m_rightExamples;
+    /** The indices (in the example store) of the examples that were sent right by the decision function. */
+    std::vector<size_t> m_rightExamples;
   };
 
   //#################### PUBLIC TYPEDEFS ####################
@@ -52,11 +131,6 @@ public:
   typedef boost::shared_ptr<Split> Split_Ptr;
   typedef boost::shared_ptr<const Split> Split_CPtr;
 
-  //#################### PRIVATE VARIABLES ####################
-private:
-  /* The split candidates. */
-  mutable std::vector<Split> m_splitCandidates;
-
   //#################### DESTRUCTOR ####################
 public:
   /**
@@ -69,11 +143,13 @@ public:
   /**
    * \brief Generates a candidate decision function to split the specified set of examples.
    *
-   * \param examples              The examples to split.
+   * \param store                 The example store containing the examples.
+   * \param exampleIndices        The indices (in the store) of the examples to split.
    * \param randomNumberGenerator A random number generator.
    * \return                      The candidate decision function.
    */
-  virtual DecisionFunction_Ptr generate_candidate_decision_function(const std::vector<Example_CPtr>& examples, const tvgutil::RandomNumberGenerator_Ptr& randomNumberGenerator) const = 0;
+  virtual DecisionFunction_Ptr generate_candidate_decision_function(const ExampleStore<Label>& store, const std::vector<size_t>& exampleIndices,
+                                                                    const tvgutil::RandomNumberGenerator_Ptr& randomNumberGenerator) const = 0;
 
   /**
    * \brief Gets the parameters of the decision function generator as a string.
@@ -95,114 +171,209 @@ public:
    * \brief Tries to pick an appropriate way in which to split the specified reservoir of examples.
    *
    * \param reservoir             The reservoir of examples to split.
+   * \param store                 The example store containing the examples in the reservoir.
    * \param candidateCount        The number of candidates to evaluate.
    * \param gainThreshold         The minimum information gain that must be obtained from a split to make it worthwhile.
    * \param inverseClassWeights   The (optional) inverses of the L1-normalised class frequencies observed in the training data.
    * \param randomNumberGenerator A random number generator.
+   * \param threadPool            The thread pool on which to evaluate the candidates.
    * \return                      The chosen split, if one was suitable, or NULL otherwise.
    */
-  Split_CPtr split_examples(const ExampleReservoir<Label>& reservoir, int candidateCount, float gainThreshold, const boost::optional<std::map<Label,float> >& inverseClassWeights,
-                            const tvgutil::RandomNumberGenerator_Ptr& randomNumberGenerator) const
+  Split_CPtr split_examples(const ExampleReservoir<Label>& reservoir, const ExampleStore<Label>& store, int candidateCount, float gainThreshold,
+                            const boost::optional<std::map<Label,float> >& inverseClassWeights, const tvgutil::RandomNumberGenerator_Ptr& randomNumberGenerator,
+                            tvgutil::ThreadPool& threadPool = tvgutil::ThreadPool::instance()) const
   {
-    std::vector<Example_CPtr> examples = reservoir.get_examples();
-    float initialEntropy = ExampleUtil::calculate_entropy(*reservoir.get_histogram(), inverseClassWeights);
+    SplitEvaluationState state;
+    state.m_initialEntropy = ExampleUtil::calculate_entropy(*reservoir.get_histogram(), inverseClassWeights);
+    state.m_store = &store;
 
 #if 0
-    std::cout << "\nP: " << *reservoir.get_histogram() << ' ' << initialEntropy << '\n';
+    std::cout << "\nP: " << *reservoir.get_histogram() << ' ' << state.m_initialEntropy << '\n';
 #endif
 
+    // Look up the indices of the examples in the store (their features are read from the store directly, without being copied).
+    state.m_exampleIndices = reservoir.get_examples();
+    const std::vector<size_t>& examples = state.m_exampleIndices;
+    const size_t exampleCount = examples.size();
+
     // Generate the split candidates.
-    if(static_cast<int>(m_splitCandidates.size()) != candidateCount) m_splitCandidates.resize(candidateCount);
+    std::vector<DecisionFunction_Ptr>& candidates = state.m_candidates;
+    candidates.resize(candidateCount);
     for(int i = 0; i < candidateCount; ++i)
     {
-      m_splitCandidates[i].m_decisionFunction = generate_candidate_decision_function(examples, randomNumberGenerator);
+      candidates[i] = generate_candidate_decision_function(store, examples, randomNumberGenerator);
     }
 
-    // Pick the best split candidate and return it.
-    float bestGain = static_cast<float>(INT_MIN);
-    int bestIndex = -1;
+    // Calculate the multipliers with which to scale the class probabilities (these are the same for every candidate).
+    std::map<Label,float> multipliers = reservoir.get_class_multipliers();
+    if(inverseClassWeights) multipliers = combine_multipliers(multipliers, *inverseClassWeights);
 
-#ifdef WITH_OPENMP
-    #pragma omp parallel for
-#endif
-    for(int i = 0; i < candidateCount; ++i)
+    // Assign each label that appears in the examples a dense index (in label order), and divide the examples
+    // into runs with the same label, so that label histograms can be accumulated into arrays.
+    std::map<Label,size_t> labelIndices;
+    for(size_t i = 0; i < exampleCount; ++i) labelIndices.insert(std::make_pair(store.get_label(examples[i]), 0));
+
+    const size_t labelCount = labelIndices.size();
+    state.m_labelMultipliers.resize(labelCount, 1.0f);
+    size_t labelIndex = 0;
+    for(typename std::map<Label,size_t>::iterator it = labelIndices.begin(), iend = labelIndices.end(); it != iend; ++it, ++labelIndex)
     {
-#if 0 && WITH_OPENMP
-      int threadID = omp_get_thread_num();
-      int threadCount = omp_get_num_threads();
-      std::cout << "threadID=" << threadID << " threadCount=" << threadCount << '\n';
-#endif
+      it->second = labelIndex;
+      typename std::map<Label,float>::const_iterator jt = multipliers.find(it->first);
+      if(jt != multipliers.end()) state.m_labelMultipliers[labelIndex] = jt->second;
+    }
 
-#if 0
-      std::cout << *splitCandidate->m_decisionFunction << '\n';
-#endif
+    std::vector<LabelRun>& labelRuns = state.m_labelRuns;
+    state.m_totalCounts.resize(labelCount, 0);
+    for(size_t i = 0; i < exampleCount; ++i)
+    {
+      size_t exampleLabelIndex = labelIndices[store.get_label(examples[i])];
+      if(labelRuns.empty() || labelRuns.back().m_labelIndex != exampleLabelIndex)
+      {
+        LabelRun run = { i, i, exampleLabelIndex };
+        labelRuns.push_back(run);
+      }
+      ++labelRuns.back().m_end;
+      ++state.m_totalCounts[exampleLabelIndex];
+    }
+
+    // Convert as many of the candidates as possible to flat form, and gather the features they use into contiguous columns.
+    state.m_flatForms.resize(candidateCount);
+    state.m_flat.resize(candidateCount);
+    state.m_columnIndices.resize(store.get_feature_count(), -1);
+    std::vector<size_t> columnFeatureIndices;
+    for(int i = 0; i < candidateCount; ++i)
+    {
+      const DecisionFunction::FlatForm& flatForm = state.m_flatForms[i];
+      state.m_flat[i] = candidates[i]->to_flat_form(state.m_flatForms[i]);
+      if(!state.m_flat[i]) continue;
 
-      // Partition the examples using the split candidate's decision function.
-      m_splitCandidates[i].m_leftExamples.clear();
-      m_splitCandidates[i].m_rightExamples.clear();
-      for(size_t j = 0, size = examples.size(); j < size; ++j)
+      size_t featureIndices[] = { flatForm.firstFeatureIndex, flatForm.secondFeatureIndex };
+      for(int j = 0, count = flatForm.op == DecisionFunction::FlatForm::FO_FIRST ? 1 : 2; j < count; ++j)
       {
-        if(m_splitCandidates[i].m_decisionFunction->classify_descriptor(*examples[j]->get_descriptor()) == DecisionFunction::DC_LEFT)
+        if(state.m_columnIndices[featureIndices[j]] == -1)
         {
-          m_splitCandidates[i].m_leftExamples.push_back(examples[j]);
-        }
-        else
-        {
-          m_splitCandidates[i].m_rightExamples.push_back(examples[j]);
+          state.m_columnIndices[featureIndices[j]] = static_cast<int>(columnFeatureIndices.size());
+          columnFeatureIndices.push_back(featureIndices[j]);
         }
       }
+    }
 
-      // Calculate the information gain we would obtain from this split.
-      float gain = calculate_information_gain(reservoir, initialEntropy, m_splitCandidates[i].m_leftExamples, m_splitCandidates[i].m_rightExamples, inverseClassWeights);
+    state.m_columns.resize(columnFeatureIndices.size() * exampleCount);
+    for(size_t i = 0, size = columnFeatureIndices.size(); i < size; ++i)
+    {
+      store.gather_feature(columnFeatureIndices[i], examples, &state.m_columns[i * exampleCount]);
+    }
 
-#ifdef WITH_OPENMP
-      #pragma omp critical
-#endif
+    // Calculate the information gain we would obtain from each split candidate, distributing the candidates across
+    // the thread pool (if this is called from within one of the pool's tasks, e.g. when training several trees at
+    // once, the current thread helps to evaluate the candidates rather than blocking).
+    state.m_gains.resize(candidateCount);
+    state.m_usable.resize(candidateCount);
+    if(exampleCount > 0)
+    {
+      threadPool.parallel_for(0, candidateCount, boost::bind(&DecisionFunctionGenerator::evaluate_candidate, boost::ref(state), _1));
+    }
+
+    // Pick a split candidate that has maximum gain (if there are several, the first of them is chosen, so that the choice is deterministic).
+    float bestGain = gainThreshold;
+    int bestIndex = -1;
+    for(int i = 0; i < candidateCount; ++i)
+    {
+      if(state.m_usable[i] && state.m_gains[i] > bestGain)
       {
-        if(gain > bestGain)
-        {
-          if(gain > gainThreshold && !m_splitCandidates[i].m_leftExamples.empty() && !m_splitCandidates[i].m_rightExamples.empty())
-          {
-            bestGain = gain;
-            bestIndex = i;
-          }
-        }
+        bestGain = state.m_gains[i];
+        bestIndex = i;
       }
     }
 
-    Split_Ptr bestSplitCandidate;
-    if(bestIndex != -1) bestSplitCandidate.reset(new Split(m_splitCandidates[bestIndex]));
+    // If no split candidate had a high enough gain, early out.
+    if(bestIndex == -1) return Split_CPtr();
+
+    // Otherwise, partition the examples using the chosen candidate and return the resulting split.
+    Split_Ptr bestSplit(new Split);
+    bestSplit->m_decisionFunction = candidates[bestIndex];
+
+    std::vector<unsigned char> mask(exampleCount);
+    classify_examples(state, bestIndex, &mask[0]);
+    for(size_t i = 0; i < exampleCount; ++i)
+    {
+      if(mask[i]) bestSplit->m_leftExamples.push_back(examples[i]);
+      else bestSplit->m_rightExamples.push_back(examples[i]);
+    }
 
-    // Return a split candidate that had maximum gain (note that this may be NULL if no split had a high enough gain).
-    return bestSplitCandidate;
+    return bestSplit;
   }
 
   //#################### PRIVATE STATIC MEMBER FUNCTIONS ####################
 private:
   /**
-   * \brief Calculates the information gain that results from splitting an example reservoir in a particular way.
+   * \brief Calculates the entropy of a label histogram that is stored as a dense array of counts.
    *
-   * \param reservoir           The reservoir.
-   * \param initialEntropy      The entropy of the example set before the split.
-   * \param leftExamples        The examples that end up in the left half of the split.
-   * \param rightExamples       The examples that end up in the right half of the split.
-   * \param inverseClassWeights The (optional) inverses of the L1-normalised class frequencies observed in the training data.
-   * \return                    The information gain resulting from the split.
+   * This mirrors ExampleUtil::calculate_entropy (for a histogram with multipliers) operation for operation,
+   * so that the results are identical to those that would be obtained via the map-based histogram and PMF.
+   *
+   * \param counts      The number of examples with each (dense) label.
+   * \param count       The total number of examples.
+   * \param multipliers The per-class ratios with which to scale the probabilities for the different (dense) labels.
+   * \param masses      A scratch array (of the same size as counts) in which to store the masses of the PMF.
+   * \return            The entropy of the histogram.
    */
-  static float calculate_information_gain(const ExampleReservoir<Label>& reservoir, float initialEntropy, const std::vector<Example_CPtr>& leftExamples, const std::vector<Example_CPtr>& rightExamples, const boost::optional<std::map<Label,float> >& inverseClassWeights)
+  static float calculate_entropy(const std::vector<size_t>& counts, size_t count, const std::vector<float>& multipliers, std::vector<float>& masses)
   {
-    float exampleCount = static_cast<float>(reservoir.current_size());
-    std::map<Label,float> multipliers = reservoir.get_class_multipliers();
-    if(inverseClassWeights) multipliers = combine_multipliers(multipliers, *inverseClassWeights);
+    if(count == 0) return 0.0f;
+
+    const size_t labelCount = counts.size();
+    float sum = 0.0f;
+    for(size_t i = 0; i < labelCount; ++i)
+    {
+      if(counts[i] == 0) continue;
+      masses[i] = static_cast<float>(counts[i]) / count * multipliers[i];
+      sum += masses[i];
+    }
+
+    float entropy = 0.0f;
+    for(size_t i = 0; i < labelCount; ++i)
+    {
+      if(counts[i] == 0) continue;
+      float mass = masses[i] / sum;
+      if(mass > 0) entropy += mass * log2(mass);
+    }
+
+    return -entropy;
+  }
+
+  /**
+   * \brief Calculates the information gain that results from splitting a set of examples in a particular way.
+   *
+   * \param initialEntropy  The entropy of the example set before the split.
+   * \param leftCounts      The number of examples with each (dense) label that end up in the left half of the split.
+   * \param totalCounts     The number of examples with each (dense) label in the example set.
+   * \param leftCount       The total number of examples that end up in the left half of the split.
+   * \param exampleCount    The total number of examples in the example set.
+   * \param multipliers     The per-class ratios with which to scale the probabilities for the different (dense) labels.
+   * \param masses          A scratch array (with one element per label) for use when calculating entropies.
+   * \return                The information gain resulting from the split.
+   */
+  static float calculate_information_gain(float initialEntropy, std::vector<size_t>& leftCounts, const std::vector<size_t>& totalCounts, size_t leftCount, size_t exampleCount,
+                                          const std::vector<float>& multipliers, std::vector<float>& masses)
+  {
+    const size_t rightCount = exampleCount - leftCount;
+    float leftEntropy = calculate_entropy(leftCounts, leftCount, multipliers, masses);
+
+    // Turn the left counts into right counts in place, to avoid the need for a second array.
+    for(size_t i = 0, size = leftCounts.size(); i < size; ++i)
+    {
+      leftCounts[i] = totalCounts[i] - leftCounts[i];
+    }
+    float rightEntropy = calculate_entropy(leftCounts, rightCount, multipliers, masses);
 
-    float leftEntropy = ExampleUtil::calculate_entropy(leftExamples, multipliers);
-    float rightEntropy = ExampleUtil::calculate_entropy(rightExamples, multipliers);
-    float leftWeight = leftExamples.size() / exampleCount;
-    float rightWeight = rightExamples.size() / exampleCount;
+    float leftWeight = leftCount / static_cast<float>(exampleCount);
+    float rightWeight = rightCount / static_cast<float>(exampleCount);
 
 #if 0
-    std::cout << "L: " << ExampleUtil::make_histogram(leftExamples) << ' ' << leftEntropy << '\n';
-    std::cout << "R: " << ExampleUtil::make_histogram(rightExamples) << ' ' << rightEntropy << '\n';
+    std::cout << "L: " << leftCount << ' ' << leftEntropy << '\n';
+    std::cout << "R: " << rightCount << ' ' << rightEntropy << '\n';
 #endif
 
     float gain = initialEntropy - (leftWeight * leftEntropy + rightWeight * rightEntropy);
@@ -214,6 +385,121 @@ private:
     return gain;
   }
 
+  /**
+   * \brief Classifies the examples being split against the specified split candidate.
+   *
+   * \param state           The state shared by the evaluations of the split candidates.
+   * \param candidateIndex  The index of the split candidate.
+   * \param mask            An array into which to write 1 for each example that is sent left, and 0 for each example that is sent right.
+   */
+  static void classify_examples(const SplitEvaluationState& state, size_t candidateIndex, unsigned char *mask)
+  {
+    if(state.m_flat[candidateIndex]) classify_examples(state.m_flatForms[candidateIndex], state.m_columns, state.m_columnIndices, state.m_exampleIndices.size(), mask);
+    else classify_examples(*state.m_candidates[candidateIndex], *state.m_store, state.m_exampleIndices, mask);
+  }
+
+  /**
+   * \brief Classifies a set of examples in a store against a decision function that has no flat form.
+   *
+   * \param decisionFunction  The decision function.
+   * \param store             The store containing the examples.
+   * \param exampleIndices    The indices (in the store) of the examples.
+   * \param mask              An array into which to write 1 for each example that is sent left, and 0 for each example that is sent right.
+   */
+  static void classify_examples(const DecisionFunction& decisionFunction, const ExampleStore<Label>& store, const std::vector<size_t>& exampleIndices, unsigned char *mask)
+  {
+    for(size_t i = 0, size = exampleIndices.size(); i < size; ++i)
+    {
+      mask[i] = decisionFunction.classify_features(store.get_features(exampleIndices[i])) == DecisionFunction::DC_LEFT;
+    }
+  }
+
+  /**
+   * \brief Classifies a set of examples against a decision function in flat form, using contiguous columns of their features.
+   *
+   * The loops are written so that the compiler can vectorise them (each is a straight-line compare over contiguous floats).
+   *
+   * \param flatForm      The flat form of the decision function.
+   * \param columns       The feature columns (each of which contains one feature for every example).
+   * \param columnIndices A map from feature indices to the indices of the corresponding columns (-1 for features without a column).
+   * \param exampleCount  The number of examples.
+   * \param mask          An array into which to write 1 for each example that is sent left, and 0 for each example that is sent right.
+   */
+  static void classify_examples(const DecisionFunction::FlatForm& flatForm, const std::vector<float>& columns, const std::vector<int>& columnIndices, size_t exampleCount, unsigned char *mask)
+  {
+    const float *first = &columns[columnIndices[flatForm.firstFeatureIndex] * exampleCount];
+    const float threshold = flatForm.threshold;
+
+    switch(flatForm.op)
+    {
+      case DecisionFunction::FlatForm::FO_FIRST:
+      {
+        for(size_t i = 0; i < exampleCount; ++i) mask[i] = first[i] < threshold;
+        break;
+      }
+      case DecisionFunction::FlatForm::FO_ADD:
+      {
+        const float *second = &columns[columnIndices[flatForm.secondFeatureIndex] * exampleCount];
+        for(size_t i = 0; i < exampleCount; ++i) mask[i] = first[i] + second[i] < threshold;
+        break;
+      }
+      case DecisionFunction::FlatForm::FO_SUBTRACT:
+      {
+        const float *second = &columns[columnIndices[flatForm.secondFeatureIndex] * exampleCount];
+        for(size_t i = 0; i < exampleCount; ++i) mask[i] = first[i] - second[i] < threshold;
+        break;
+      }
+    }
+  }
+
+  /**
+   * \brief Calculates the information gain we would obtain from the specified split candidate.
+   *
+   * The results are written into the candidate's elements of the gains and usability arrays in the shared state,
+   * so it is safe to evaluate different candidates concurrently.
+   *
+   * \param state           The state shared by the evaluations of the split candidates.
+   * \param candidateIndex  The index of the split candidate.
+   */
+  static void evaluate_candidate(SplitEvaluationState& state, size_t candidateIndex)
+  {
+#if 0
+    std::cout << *state.m_candidates[candidateIndex] << '\n';
+#endif
+
+    const size_t exampleCount = state.m_exampleIndices.size();
+    const size_t labelCount = state.m_totalCounts.size();
+
+    // Reset the current thread's scratch arrays for this candidate (this only allocates if they need to grow).
+    CandidateScratch& scratch = get_candidate_scratch();
+    std::vector<size_t>& leftCounts = scratch.m_leftCounts;
+    std::vector<float>& masses = scratch.m_masses;
+    std::vector<unsigned char>& mask = scratch.m_mask;
+    leftCounts.assign(labelCount, 0);
+    masses.resize(labelCount);
+    mask.resize(exampleCount);
+
+    // Classify the examples against the candidate.
+    classify_examples(state, candidateIndex, &mask[0]);
+
+    // Count the examples with each label that are sent left.
+    size_t leftCount = 0;
+    for(size_t i = 0, size = state.m_labelRuns.size(); i < size; ++i)
+    {
+      const LabelRun& run = state.m_labelRuns[i];
+      size_t runLeftCount = 0;
+      for(size_t j = run.m_begin; j < run.m_end; ++j)
+      {
+        runLeftCount += mask[j];
+      }
+      leftCounts[run.m_labelIndex] += runLeftCount;
+      leftCount += runLeftCount;
+    }
+
+    state.m_usable[candidateIndex] = leftCount != 0 && leftCount != exampleCount;
+    state.m_gains[candidateIndex] = calculate_information_gain(state.m_initialEntropy, leftCounts, state.m_totalCounts, leftCount, exampleCount, state.m_labelMultipliers, masses);
+  }
+
   /**
    * \brief Multiplies together two sets of multipliers that share some labels in common.
    *
@@ -242,6 +528,18 @@ private:
 
     return result;
   }
+
+  /**
+   * \brief Gets the current thread's scratch arrays for use when evaluating split candidates.
+   *
+   * \return  The current thread's scratch arrays.
+   */
+  static CandidateScratch& get_candidate_scratch()
+  {
+    static boost::thread_specific_ptr<CandidateScratch> s_scratch;
+    if(!s_scratch.get()) s_scratch.reset(new CandidateScratch);
+    return *s_scratch;
+  }
 };
 
 }
@@ -22,10 +22,9 @@ namespace rafl {
 template <typename Label>
 class FeatureThresholdingDecisionFunctionGenerator : public FeatureBasedDecisionFunctionGenerator<Label>
 {
-  //#################### TYPEDEFS AND USINGS ####################
+  //#################### TYPEDEFS ####################
 protected:
   typedef boost::shared_ptr<DecisionFunctionGenerator<Label> > DecisionFunctionGenerator_Ptr;
-  using typename DecisionFunctionGenerator<Label>::Example_CPtr;
 
   //#################### CONSTRUCTORS ####################
 public:
@@ -65,11 +64,11 @@ public:
   //#################### PUBLIC MEMBER FUNCTIONS ####################
 public:
   /** Override */
-  virtual DecisionFunction_Ptr generate_candidate_decision_function(const std::vector<Example_CPtr>& examples, const tvgutil::RandomNumberGenerator_Ptr& randomNumberGenerator) const
+  virtual DecisionFunction_Ptr generate_candidate_decision_function(const ExampleStore<Label>& store, const std::vector<size_t>& exampleIndices, const tvgutil::RandomNumberGenerator_Ptr& randomNumberGenerator) const
   {
-    assert(!examples.empty());
+    assert(!exampleIndices.empty());
 
-    int descriptorSize = static_cast<int>(examples[0]->get_descriptor()->size());
+    int descriptorSize = static_cast<int>(store.get_feature_count());
 
     // Pick a random feature in the descriptor to threshold.
     std::pair<int,int> featureIndexRange = this->get_feature_index_range(descriptorSize);
@@ -77,8 +76,8 @@ public:
 
     // Select an appropriate threshold by picking a random example and using
     // the value of the chosen feature from that example as the threshold.
-    int exampleIndex = randomNumberGenerator->generate_int_from_uniform(0, static_cast<int>(examples.size()) - 1);
-    float threshold = (*examples[exampleIndex]->get_descriptor())[featureIndex];
+    int exampleIndex = randomNumberGenerator->generate_int_from_uniform(0, static_cast<int>(exampleIndices.size()) - 1);
+    float threshold = store.get_features(exampleIndices[exampleIndex])[featureIndex];
 
     return DecisionFunction_Ptr(new FeatureThresholdingDecisionFunction(featureIndex, threshold));
   }
@@ -13,15 +13,28 @@
 #include <map>
 #include <vector>
 
+#include <boost/mpl/int.hpp>
+#include <boost/serialization/map.hpp>
+#include <boost/serialization/shared_ptr.hpp>
+#include <boost/serialization/vector.hpp>
+#include <boost/serialization/version.hpp>
+
 #include <tvgutil/numbers/RandomNumberGenerator.h>
 #include <tvgutil/statistics/Histogram.h>
 
-#include "Example.h"
+#include "ExampleStore.h"
 
 namespace rafl {
 
+//#################### FORWARD DECLARATIONS ####################
+
+template <typename Label> class BinaryForestFile;
+
 /**
  * \brief An instance of an instantiation of this class template represents a reservoir to store the examples for a node.
+ *
+ * The examples themselves are kept in an example store that is shared by all of the reservoirs in a forest:
+ * the reservoir just records the indices of its examples in the store.
  */
 template <typename Label>
 class ExampleReservoir
@@ -32,17 +45,24 @@ private:
   typedef boost::shared_ptr<tvgutil::Histogram<Label> > Histogram_Ptr;
   typedef boost::shared_ptr<const tvgutil::Histogram<Label> > Histogram_CPtr;
 
+  //#################### FRIENDS ####################
+
+  friend class BinaryForestFile<Label>;
+
   //#################### PRIVATE VARIABLES ####################
 private:
   /** The total number of examples currently in the reservoir. */
   size_t m_curSize;
 
-  /** The examples in the reservoir. */
-  std::map<Label,std::vector<Example_CPtr> > m_examples;
+  /** The indices (in the example store) of the examples in the reservoir, grouped by label. */
+  std::map<Label,std::vector<size_t> > m_examples;
 
   /** The histogram of the label distribution of all of the examples that have ever been added to the reservoir. */
   Histogram_Ptr m_histogram;
 
+  /** The examples in the reservoir, if it was loaded from an archive saved before reservoirs referred to an example store (this is not serialized). */
+  std::map<Label,std::vector<Example_CPtr> > m_legacyExamples;
+
   /** The maximum number of examples of each class allowed in the reservoir at any one time. */
   size_t m_maxClassSize;
 
@@ -60,7 +80,8 @@ public:
    * Adding more than the specified number of examples of a particular class to the reservoir may result
    * in some of the older examples for that class being (randomly) discarded.
    *
-   * \param maxClassSize          The maximum number of examples of each class allowed in the reservoir at any one time.
+   * \param maxClassSize          The maximum number of examples of each class allowed in the reservoir at any one time
+   *                              (if this is zero, the reservoir just records the label distribution of the examples added to it).
    * \param randomNumberGenerator A random number generator.
    */
   ExampleReservoir(size_t maxClassSize, const tvgutil::RandomNumberGenerator_Ptr& randomNumberGenerator)
@@ -83,34 +104,39 @@ public:
    * an older example of that class may be (randomly) discarded to make space for the new one. If not, the new example itself
    * is discarded.
    *
-   * \param example The example to be added.
-   * \return        true, if the example was actually added to the reservoir, or false otherwise.
+   * \param exampleIndex  The index of the example in the example store.
+   * \param label         The label of the example.
+   * \return              true, if the example was actually added to the reservoir, or false otherwise.
    */
-  bool add_example(const Example_CPtr& example)
+  bool add_example(size_t exampleIndex, const Label& label)
   {
     bool changed = false;
 
-    std::vector<Example_CPtr>& examplesForClass = m_examples[example->get_label()];
-    if(examplesForClass.size() < m_maxClassSize)
-    {
-      // If we haven't yet reached the maximum number of examples for this class, simply add the new one.
-      examplesForClass.push_back(example);
-      ++m_curSize;
-      changed = true;
-    }
-    else
+    // Note: A reservoir with a maximum class size of zero stores no examples, and just records the label distribution of the examples added to it.
+    if(m_maxClassSize > 0)
     {
-      // Otherwise, randomly decide whether or not to replace one of the existing examples for this class with the new one.
-      size_t binSize = m_histogram->get_bins().find(example->get_label())->second;
-      size_t k = m_randomNumberGenerator->generate_int_from_uniform(0, static_cast<int>(binSize) - 1);
-      if(k < examplesForClass.size())
+      std::vector<size_t>& examplesForClass = m_examples[label];
+      if(examplesForClass.size() < m_maxClassSize)
       {
-        examplesForClass[k] = example;
+        // If we haven't yet reached the maximum number of examples for this class, simply add the new one.
+        examplesForClass.push_back(exampleIndex);
+        ++m_curSize;
         changed = true;
       }
+      else
+      {
+        // Otherwise, randomly decide whether or not to replace one of the existing examples for this class with the new one.
+        size_t binSize = m_histogram->get_bin_size(label);
+        size_t k = m_randomNumberGenerator->generate_int_from_uniform(0, static_cast<int>(binSize) - 1);
+        if(k < examplesForClass.size())
+        {
+          examplesForClass[k] = exampleIndex;
+          changed = true;
+        }
+      }
     }
 
-    m_histogram->add(example->get_label());
+    m_histogram->add(label);
     ++m_seenExamples;
     return changed;
   }
@@ -120,6 +146,7 @@ public:
    */
   void clear()
   {
+    m_curSize = 0;
     m_examples.clear();
     m_histogram.reset();
     m_randomNumberGenerator.reset();
@@ -138,34 +165,39 @@ public:
   /**
    * \brief Gets the per-class ratios between the total number of examples seen for a class and the number of examples currently in the reservoir.
    *
+   * \note  Classes that have been seen but of which there are no examples currently in the reservoir (as happens when a forest
+   *        is loaded without its reservoirs) have no multiplier.
+   *
    * \return  The per-class ratios between the total number of examples seen for a class and the number of examples currently in the reservoir.
    */
   std::map<Label,float> get_class_multipliers() const
   {
     std::map<Label,float> result;
 
-    const std::map<Label,size_t>& bins = m_histogram->get_bins();
-    typename std::map<Label,std::vector<Example_CPtr> >::const_iterator it = m_examples.begin(), iend = m_examples.end();
-    typename std::map<Label,size_t>::const_iterator jt = bins.begin();
-    for(; it != iend; ++it, ++jt)
+    // Note: The examples and the histogram bins are both in ascending label order, and every class in the reservoir has a bin.
+    const std::vector<Label>& labels = m_histogram->get_labels();
+    const std::vector<size_t>& binSizes = m_histogram->get_bin_sizes();
+    typename std::map<Label,std::vector<size_t> >::const_iterator it = m_examples.begin(), iend = m_examples.end();
+    for(size_t j = 0; it != iend; ++it)
     {
-      assert(it->first == jt->first);
-      result.insert(std::make_pair(it->first, static_cast<float>(jt->second) / it->second.size()));
+      while(labels[j] < it->first) ++j;
+      assert(it->first == labels[j]);
+      if(!it->second.empty()) result.insert(result.end(), std::make_pair(it->first, static_cast<float>(binSizes[j]) / it->second.size()));
     }
 
     return result;
   }
 
   /**
-   * \brief Gets the examples currently in the reservoir.
+   * \brief Gets the indices (in the example store) of the examples currently in the reservoir.
    *
-   * \return  The examples currently in the reservoir.
+   * \return  The indices of the examples currently in the reservoir, grouped by label (in ascending label order).
    */
-  std::vector<Example_CPtr> get_examples() const
+  std::vector<size_t> get_examples() const
   {
-    std::vector<Example_CPtr> examples;
+    std::vector<size_t> examples;
     examples.reserve(m_curSize);
-    for(typename std::map<Label,std::vector<Example_CPtr> >::const_iterator it = m_examples.begin(), iend = m_examples.end(); it != iend; ++it)
+    for(typename std::map<Label,std::vector<size_t> >::const_iterator it = m_examples.begin(), iend = m_examples.end(); it != iend; ++it)
     {
       std::copy(it->second.begin(), it->second.end(), std::back_inserter(examples));
     }
@@ -182,6 +214,71 @@ public:
     return m_histogram;
   }
 
+  /**
+   * \brief Gets an estimate of the amount of heap memory (in bytes) used by the reservoir.
+   *
+   * \note  This does not include the examples themselves, which are kept in the example store (and are often shared between reservoirs).
+   *
+   * \return  An estimate of the amount of heap memory (in bytes) used by the reservoir.
+   */
+  size_t get_memory_usage() const
+  {
+    size_t result = 0;
+
+    if(m_histogram)
+    {
+      result += sizeof(tvgutil::Histogram<Label>) + m_histogram->get_memory_usage();
+    }
+
+    for(typename std::map<Label,std::vector<size_t> >::const_iterator it = m_examples.begin(), iend = m_examples.end(); it != iend; ++it)
+    {
+      result += sizeof(std::pair<const Label,std::vector<size_t> >) + it->second.capacity() * sizeof(size_t);
+    }
+
+    return result;
+  }
+
+  /**
+   * \brief Moves any examples loaded from an archive saved before reservoirs referred to an example store into the specified store.
+   *
+   * \param store               The example store.
+   * \param exampleIndices      A map from examples that have already been moved into the store to their indices in it
+   *                            (this is used to make sure that examples shared between reservoirs are only stored once).
+   * \throws std::runtime_error If the examples do not all have the same number of features.
+   */
+  void import_legacy_examples(ExampleStore<Label>& store, std::map<const Example<Label>*,size_t>& exampleIndices)
+  {
+    for(typename std::map<Label,std::vector<Example_CPtr> >::const_iterator it = m_legacyExamples.begin(), iend = m_legacyExamples.end(); it != iend; ++it)
+    {
+      std::vector<size_t>& examplesForClass = m_examples[it->first];
+      for(typename std::vector<Example_CPtr>::const_iterator jt = it->second.begin(), jend = it->second.end(); jt != jend; ++jt)
+      {
+        typename std::map<const Example<Label>*,size_t>::const_iterator kt = exampleIndices.find(jt->get());
+        if(kt == exampleIndices.end()) kt = exampleIndices.insert(std::make_pair(jt->get(), store.add_example(**jt))).first;
+
+        examplesForClass.push_back(kt->second);
+      }
+    }
+
+    m_legacyExamples.clear();
+  }
+
+  /**
+   * \brief Marks the examples in the reservoir as being in use.
+   *
+   * \param used  Flags indicating which of the rows in the example store contain examples that are in use (the flags for the examples in the reservoir will be set).
+   */
+  void mark_used_examples(std::vector<unsigned char>& used) const
+  {
+    for(typename std::map<Label,std::vector<size_t> >::const_iterator it = m_examples.begin(), iend = m_examples.end(); it != iend; ++it)
+    {
+      for(typename std::vector<size_t>::const_iterator jt = it->second.begin(), jend = it->second.end(); jt != jend; ++jt)
+      {
+        used[*jt] = 1;
+      }
+    }
+  }
+
   /**
    * \brief Gets the total number of examples that have been added to the reservoir over time.
    *
@@ -192,6 +289,18 @@ public:
     return m_seenExamples;
   }
 
+  /**
+   * \brief Sets the random number generator used to decide which examples to keep once the reservoir is full.
+   *
+   * \note  This has no effect on a reservoir that has been cleared (since it no longer needs a random number generator).
+   *
+   * \param randomNumberGenerator The random number generator.
+   */
+  void set_random_number_generator(const tvgutil::RandomNumberGenerator_Ptr& randomNumberGenerator)
+  {
+    if(m_randomNumberGenerator) m_randomNumberGenerator = randomNumberGenerator;
+  }
+
   //#################### STREAM OPERATORS ####################
 
   /**
@@ -203,9 +312,12 @@ public:
    */
   friend std::ostream& operator<<(std::ostream& os, const ExampleReservoir& rhs)
   {
-    for(typename std::vector<Example_CPtr>::const_iterator it = rhs.m_examples.begin(), iend = rhs.m_examples.end(); it != iend; ++it)
+    for(typename std::map<Label,std::vector<size_t> >::const_iterator it = rhs.m_examples.begin(), iend = rhs.m_examples.end(); it != iend; ++it)
     {
-      os << (*it)->get_label() << ' ';
+      for(size_t i = 0, size = it->second.size(); i < size; ++i)
+      {
+        os << it->first << ' ';
+      }
     }
 
     return os;
@@ -223,7 +335,12 @@ private:
   void serialize(Archive& ar, const unsigned int version)
   {
     ar & m_curSize;
-    ar & m_examples;
+
+    // Reservoirs saved by earlier versions of rafl stored the examples themselves, rather than their indices in an example store.
+    // The examples in such reservoirs are moved into the forest's example store once the whole forest has been loaded.
+    if(version == 0) ar & m_legacyExamples;
+    else ar & m_examples;
+
     ar & m_histogram;
     ar & m_maxClassSize;
     ar & m_randomNumberGenerator;
@@ -235,4 +352,24 @@ private:
 
 }
 
+//#################### SERIALIZATION VERSION ####################
+
+namespace boost { namespace serialization {
+
+/**
+ * \brief Specifies the current version of the archive format for example reservoirs.
+ *
+ * Version 0: The reservoir stores the examples themselves.
+ * Version 1: The reservoir stores the indices of its examples in the forest's example store.
+ */
+template <typename Label>
+struct version<rafl::ExampleReservoir<Label> >
+{
+  typedef mpl::int_<1> type;
+  typedef mpl::integral_c_tag tag;
+  BOOST_STATIC_CONSTANT(int, value = version::type::value);
+};
+
+}}
+
 #endif
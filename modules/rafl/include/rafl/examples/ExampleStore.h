@@ -0,0 +1,308 @@
+/**
+ * rafl: ExampleStore.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#ifndef H_RAFL_EXAMPLESTORE
+#define H_RAFL_EXAMPLESTORE
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+#include <boost/serialization/vector.hpp>
+
+#include "Example.h"
+
+namespace rafl {
+
+/**
+ * \brief An instance of an instantiation of this class template represents a contiguous store of examples.
+ *
+ * A random forest keeps a single store for all of its trees, and the reservoirs of the trees' nodes refer to the examples in it
+ * by their indices, so that each example is stored exactly once however many reservoirs contain it. The features of the examples
+ * are stored as the rows of a single row-major matrix, and their labels in a parallel array, so that splitting a node can read the
+ * features of its examples straight from the store. Examples that are no longer in any reservoir are released by the forest, and
+ * their rows are reused for new examples.
+ */
+template <typename Label>
+class ExampleStore
+{
+  //#################### TYPEDEFS ####################
+private:
+  typedef boost::shared_ptr<const Example<Label> > Example_CPtr;
+
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** The number of examples currently in the store. */
+  size_t m_exampleCount;
+
+  /** The number of features in each example. */
+  size_t m_featureCount;
+
+  /** The features of the examples (the example in row i occupies elements [i * m_featureCount, (i+1) * m_featureCount)). */
+  std::vector<float> m_features;
+
+  /** The indices of the rows that have been released and can be reused for new examples. */
+  std::vector<size_t> m_freeRows;
+
+  /** The labels of the examples. */
+  std::vector<Label> m_labels;
+
+  /** Flags indicating which of the rows currently contain examples. */
+  std::vector<unsigned char> m_occupied;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Constructs an empty example store.
+   *
+   * \param featureCount  The number of features in each example (if this is 0, it will be set when the first examples are added).
+   */
+  explicit ExampleStore(size_t featureCount = 0)
+  : m_exampleCount(0), m_featureCount(featureCount)
+  {}
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Adds an example to the store.
+   *
+   * \param features  The features of the example (there must be get_feature_count() of them).
+   * \param label     The label of the example.
+   * \return          The index of the example in the store.
+   */
+  size_t add_example(const float *features, const Label& label)
+  {
+    size_t i;
+    if(!m_freeRows.empty())
+    {
+      i = m_freeRows.back();
+      m_freeRows.pop_back();
+      std::copy(features, features + m_featureCount, m_features.begin() + i * m_featureCount);
+      m_labels[i] = label;
+      m_occupied[i] = 1;
+    }
+    else
+    {
+      i = m_labels.size();
+      m_features.insert(m_features.end(), features, features + m_featureCount);
+      m_labels.push_back(label);
+      m_occupied.push_back(1);
+    }
+
+    ++m_exampleCount;
+    return i;
+  }
+
+  /**
+   * \brief Copies an example into the store.
+   *
+   * \param example             The example.
+   * \return                    The index of the example in the store.
+   * \throws std::runtime_error If the example's descriptor does not have the same number of features as the store.
+   */
+  size_t add_example(const Example<Label>& example)
+  {
+    const Descriptor& descriptor = *example.get_descriptor();
+    check_descriptor(descriptor);
+    return add_example(descriptor.empty() ? NULL : &descriptor[0], example.get_label());
+  }
+
+  /**
+   * \brief Copies some of the examples in a pool into the store.
+   *
+   * \param examples            A pool of examples.
+   * \param indices             The indices of the examples in the pool that should be copied into the store.
+   * \return                    The indices in the store of the copied examples (in the same order as the indices in the pool).
+   * \throws std::runtime_error If the examples' descriptors do not all have the same number of features as the store
+   *                            (in which case none of the examples are copied).
+   */
+  std::vector<size_t> add_examples(const std::vector<Example_CPtr>& examples, const std::vector<size_t>& indices)
+  {
+    // Check all of the examples before copying any of them, so that the store is left unchanged if any of them are unsuitable.
+    for(size_t i = 0, size = indices.size(); i < size; ++i)
+    {
+      check_descriptor(*examples[indices[i]]->get_descriptor());
+    }
+
+    std::vector<size_t> result(indices.size());
+    for(size_t i = 0, size = indices.size(); i < size; ++i)
+    {
+      result[i] = add_example(*examples[indices[i]]);
+    }
+
+    return result;
+  }
+
+  /**
+   * \brief Removes all of the examples from the store (without releasing its memory).
+   */
+  void clear()
+  {
+    m_exampleCount = 0;
+    m_features.clear();
+    m_freeRows.clear();
+    m_labels.clear();
+    m_occupied.clear();
+  }
+
+  /**
+   * \brief Copies the specified feature of each of a set of examples in the store into a contiguous column.
+   *
+   * \param featureIndex  The index of the feature.
+   * \param indices       The indices of the examples in the store.
+   * \param column        An array (with one element per example in the set) into which to copy the feature.
+   */
+  void gather_feature(size_t featureIndex, const std::vector<size_t>& indices, float *column) const
+  {
+    for(size_t i = 0, size = indices.size(); i < size; ++i)
+    {
+      column[i] = m_features[indices[i] * m_featureCount + featureIndex];
+    }
+  }
+
+  /**
+   * \brief Gets the number of examples currently in the store.
+   *
+   * \return  The number of examples currently in the store.
+   */
+  size_t get_example_count() const
+  {
+    return m_exampleCount;
+  }
+
+  /**
+   * \brief Gets the number of features in each example.
+   *
+   * \return  The number of features in each example.
+   */
+  size_t get_feature_count() const
+  {
+    return m_featureCount;
+  }
+
+  /**
+   * \brief Gets the features of the specified example.
+   *
+   * \param i The index of the example.
+   * \return  A pointer to the (contiguous) features of the example.
+   */
+  const float *get_features(size_t i) const
+  {
+    // Note: Taking the address of the first element of an empty vector would be undefined behaviour.
+    return m_features.empty() ? NULL : &m_features[i * m_featureCount];
+  }
+
+  /**
+   * \brief Gets the label of the specified example.
+   *
+   * \param i The index of the example.
+   * \return  The label of the example.
+   */
+  const Label& get_label(size_t i) const
+  {
+    return m_labels[i];
+  }
+
+  /**
+   * \brief Gets the amount of memory (in bytes) used by each example in the store.
+   *
+   * \return  The amount of memory (in bytes) used by each example in the store.
+   */
+  size_t get_example_memory_usage() const
+  {
+    return m_featureCount * sizeof(float) + sizeof(Label) + sizeof(unsigned char);
+  }
+
+  /**
+   * \brief Gets an estimate of the amount of memory (in bytes) used by the examples currently in the store.
+   *
+   * \note  Rows that have been released are kept for reuse by new examples, and are not counted.
+   *
+   * \return  An estimate of the amount of memory (in bytes) used by the examples currently in the store.
+   */
+  size_t get_memory_usage() const
+  {
+    return m_exampleCount * get_example_memory_usage();
+  }
+
+  /**
+   * \brief Gets the number of rows in the store (including any that have been released).
+   *
+   * The indices of the examples in the store are all less than this.
+   *
+   * \return  The number of rows in the store.
+   */
+  size_t get_row_count() const
+  {
+    return m_labels.size();
+  }
+
+  /**
+   * \brief Releases the specified example, so that its row can be reused for a new example.
+   *
+   * \param i The index of the example.
+   */
+  void release_example(size_t i)
+  {
+    if(!m_occupied[i]) return;
+    m_occupied[i] = 0;
+    m_freeRows.push_back(i);
+    --m_exampleCount;
+  }
+
+  /**
+   * \brief Releases all of the examples in the store that are not in use.
+   *
+   * \param used  Flags indicating which of the rows in the store contain examples that are still in use (there must be get_row_count() of them).
+   */
+  void release_unused_examples(const std::vector<unsigned char>& used)
+  {
+    for(size_t i = 0, size = m_labels.size(); i < size; ++i)
+    {
+      if(!used[i]) release_example(i);
+    }
+  }
+
+  //#################### PRIVATE MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Checks that a descriptor has the same number of features as the store.
+   *
+   * If the store has never held any examples and its number of features has not yet been set, it is set from the descriptor.
+   *
+   * \param descriptor          The descriptor.
+   * \throws std::runtime_error If the descriptor does not have the same number of features as the store.
+   */
+  void check_descriptor(const Descriptor& descriptor)
+  {
+    if(m_labels.empty() && m_featureCount == 0) m_featureCount = descriptor.size();
+    if(descriptor.size() != m_featureCount) throw std::runtime_error("Error: Cannot add an example with the wrong number of features to an example store");
+  }
+
+  //#################### SERIALIZATION ####################
+private:
+  /**
+   * \brief Serializes the example store to/from an archive.
+   *
+   * \param ar      The archive.
+   * \param version The file format version number.
+   */
+  template <typename Archive>
+  void serialize(Archive& ar, const unsigned int version)
+  {
+    ar & m_exampleCount;
+    ar & m_featureCount;
+    ar & m_features;
+    ar & m_freeRows;
+    ar & m_labels;
+    ar & m_occupied;
+  }
+
+  friend class boost::serialization::access;
+};
+
+}
+
+#endif
@@ -17,9 +17,9 @@ FeatureThresholdingDecisionFunction::FeatureThresholdingDecisionFunction(size_t
 
 //#################### PUBLIC MEMBER FUNCTIONS ####################
 
-DecisionFunction::DescriptorClassification FeatureThresholdingDecisionFunction::classify_descriptor(const Descriptor& descriptor) const
+DecisionFunction::DescriptorClassification FeatureThresholdingDecisionFunction::classify_features(const float *features) const
 {
-  return descriptor[m_featureIndex] < m_threshold ? DC_LEFT : DC_RIGHT;
+  return features[m_featureIndex] < m_threshold ? DC_LEFT : DC_RIGHT;
 }
 
 void FeatureThresholdingDecisionFunction::output(std::ostream& os) const
@@ -27,6 +27,15 @@ void FeatureThresholdingDecisionFunction::output(std::ostream& os) const
   os << "Feature " << m_featureIndex << " < " << m_threshold;
 }
 
+bool FeatureThresholdingDecisionFunction::to_flat_form(FlatForm& flatForm) const
+{
+  flatForm.firstFeatureIndex = m_featureIndex;
+  flatForm.op = FlatForm::FO_FIRST;
+  flatForm.secondFeatureIndex = m_featureIndex;
+  flatForm.threshold = m_threshold;
+  return true;
+}
+
 }
 
 BOOST_CLASS_EXPORT(rafl::FeatureThresholdingDecisionFunction)
@@ -23,9 +23,9 @@ PairwiseOpAndThresholdDecisionFunction::PairwiseOpAndThresholdDecisionFunction()
 
 //#################### PUBLIC MEMBER FUNCTIONS ####################
 
-DecisionFunction::DescriptorClassification PairwiseOpAndThresholdDecisionFunction::classify_descriptor(const Descriptor& descriptor) const
+DecisionFunction::DescriptorClassification PairwiseOpAndThresholdDecisionFunction::classify_features(const float *features) const
 {
-  float result = apply_op(m_op, descriptor[m_firstFeatureIndex], descriptor[m_secondFeatureIndex]);
+  float result = apply_op(m_op, features[m_firstFeatureIndex], features[m_secondFeatureIndex]);
   return result < m_threshold ? DC_LEFT : DC_RIGHT;
 }
 
@@ -37,6 +37,26 @@ void PairwiseOpAndThresholdDecisionFunction::output(std::ostream& os) const
      << " < " << m_threshold;
 }
 
+bool PairwiseOpAndThresholdDecisionFunction::to_flat_form(FlatForm& flatForm) const
+{
+  switch(m_op)
+  {
+    case PO_ADD:
+      flatForm.op = FlatForm::FO_ADD;
+      break;
+    case PO_SUBTRACT:
+      flatForm.op = FlatForm::FO_SUBTRACT;
+      break;
+    default:
+      return false;
+  }
+
+  flatForm.firstFeatureIndex = m_firstFeatureIndex;
+  flatForm.secondFeatureIndex = m_secondFeatureIndex;
+  flatForm.threshold = m_threshold;
+  return true;
+}
+
 //#################### PUBLIC STATIC MEMBER FUNCTIONS ####################
 
 float PairwiseOpAndThresholdDecisionFunction::apply_op(Op op, float a, float b)
@@ -62,6 +62,20 @@ public:
     #undef GET_SETTING
   }
 
+  //#################### PUBLIC STATIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Makes a random forest evaluator (this is intended for use as the evaluator maker of a parallel learner evaluator).
+   *
+   * \param splitGenerator  The generator to use to split the example set.
+   * \param settings        The settings to use for the random forest.
+   * \return                The random forest evaluator.
+   */
+  static boost::shared_ptr<const Base> make_evaluator(const evaluation::SplitGenerator_Ptr& splitGenerator, const std::map<std::string,std::string>& settings)
+  {
+    return boost::shared_ptr<const Base>(new RandomForestEvaluator(splitGenerator, settings));
+  }
+
   //#################### PROTECTED MEMBER FUNCTIONS ####################
 protected:
   /** Override */
@@ -96,22 +110,16 @@ private:
    */
   static ResultType do_evaluation(const RandomForest_Ptr& randomForest, const std::vector<Example_CPtr>& examples, const std::vector<size_t>& indices)
   {
+    // Note: This deliberately runs serially, since it is called from within evaluation tasks that are already running in parallel.
     std::set<Label> classLabels;
-    int indicesSize = static_cast<int>(indices.size());
+    const size_t indicesSize = indices.size();
     std::vector<Label> expectedLabels(indicesSize), predictedLabels(indicesSize);
 
-#ifdef WITH_OPENMP
-    #pragma omp parallel for
-#endif
-    for(int i = 0; i < indicesSize; ++i)
+    for(size_t i = 0; i < indicesSize; ++i)
     {
       const Example_CPtr& example = examples[indices[i]];
       predictedLabels[i] = randomForest->predict(example->get_descriptor());
       expectedLabels[i] = example->get_label();
-
-#ifdef WITH_OPENMP
-      #pragma omp critical
-#endif
       classLabels.insert(expectedLabels[i]);
     }
 
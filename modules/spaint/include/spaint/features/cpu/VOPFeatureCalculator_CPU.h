@@ -11,6 +11,9 @@
 namespace spaint {
 /**
  * \brief An instance of a class deriving from this one can be used to calculate VOP feature descriptors for voxels sampled from a scene using the CPU.
+ *
+ * Unlike the CUDA implementation, which uses a thread per pixel, the CPU implementation processes the patches in blocks, with each
+ * thread handling a whole block at a time using its own scratch buffers (so that e.g. histograms can be accumulated without atomics).
  */
 class VOPFeatureCalculator_CPU : public VOPFeatureCalculator
 {
@@ -7,6 +7,7 @@
 #define H_SPAINT_OBJECTSEGMENTATIONCOMPONENT
 
 #include <itmx/imagesources/SingleRGBDImagePipe.h>
+#include <itmx/persistence/SequenceRecorder.h>
 
 #include "ObjectSegmentationContext.h"
 
@@ -31,6 +32,9 @@ private:
   /** The ID of the scene on which the component should operate. */
   std::string m_sceneID;
 
+  /** The recorder used to save the frames of the current segmentation video (if any). */
+  itmx::SequenceRecorder_Ptr m_segmentationRecorder;
+
   //#################### CONSTRUCTORS ####################
 public:
   /**
@@ -9,9 +9,12 @@
 #include <ITMLib/Core/ITMDenseMapper.h>
 #include <ITMLib/Core/ITMDenseSurfelMapper.h>
 
+#include <itmx/imagesources/AsyncImageSourceEngine.h>
 #include <itmx/remotemapping/MappingClient.h>
 #include <itmx/trackers/FallibleTracker.h>
 
+#include <tvgutil/misc/TypedSetting.h>
+
 #include "SLAMContext.h"
 
 namespace spaint {
@@ -79,6 +82,9 @@ private:
   /** Whether or not the user wants fusion to be run. */
   bool m_fusionEnabled;
 
+  /** The global poses specifier (if any), which is checked every frame. */
+  boost::shared_ptr<tvgutil::TypedSetting<std::string> > m_globalPosesSpecifier;
+
   /** The engine used to provide input images to the fusion process. */
   ImageSourceEngine_Ptr m_imageSourceEngine;
 
@@ -237,6 +243,15 @@ public:
 
   //#################### PRIVATE MEMBER FUNCTIONS ####################
 private:
+  /**
+   * \brief Gets the asynchronous image source engine (if any) that is currently supplying the input images.
+   *
+   * This is either the image source engine itself or, if that is a composite, its current sub-engine.
+   *
+   * \return The asynchronous image source engine that is currently supplying the input images, or NULL if there isn't one.
+   */
+  itmx::AsyncImageSourceEngine *get_async_image_source_engine() const;
+
   /**
    * \brief Render from the live camera position to prepare for tracking.
    *
@@ -6,10 +6,14 @@
 #ifndef H_SPAINT_SEMANTICSEGMENTATIONCOMPONENT
 #define H_SPAINT_SEMANTICSEGMENTATIONCOMPONENT
 
-#include <rafl/core/RandomForest.h>
+#include <rafl/core/CompiledForest.h>
+
+#include <tvgutil/timing/AverageTimer.h>
 
 #include "SemanticSegmentationContext.h"
 #include "../features/interface/FeatureCalculator.h"
+#include "../randomforest/TrainingScheduler.h"
+#include "../randomforest/VoxelPredictionCache.h"
 #include "../sampling/interface/PerLabelVoxelSampler.h"
 #include "../sampling/interface/UniformVoxelSampler.h"
 
@@ -22,40 +26,65 @@ class SemanticSegmentationComponent
 {
   //#################### TYPEDEFS ####################
 private:
+  typedef boost::shared_ptr<rafl::CompiledForest<SpaintVoxel::Label> > CompiledForest_Ptr;
   typedef boost::shared_ptr<rafl::RandomForest<SpaintVoxel::Label> > RandomForest_Ptr;
 
   //#################### PRIVATE VARIABLES ####################
 private:
+  /** A compiled snapshot of the random forest that is used for prediction (this is refreshed before each prediction). */
+  CompiledForest_Ptr m_compiledForest;
+
   /** The shared context needed for semantic segmentation. */
   SemanticSegmentationContext_Ptr m_context;
 
   /** The feature calculator. */
   FeatureCalculator_CPtr m_featureCalculator;
 
+  /** A timer used to measure how long it takes to sample voxels, calculate their features and add them to the forest during training. */
+  tvgutil::AverageTimer<boost::chrono::microseconds> m_featureTimer;
+
   /** The random forest. */
   RandomForest_Ptr m_forest;
 
   /** The maximum number of voxels for which to predict labels each frame. */
   size_t m_maxPredictionVoxelCount;
 
-  /** The maximum number of voxels per label from which to train each frame. */
+  /** The maximum number of voxels per label from which to train each frame (the number actually used is chosen by the training scheduler). */
   size_t m_maxTrainingVoxelsPerLabel;
 
   /** The side length of a VOP patch (must be odd). */
   size_t m_patchSize;
 
+  /** A record of the voxels whose labels have been predicted recently, which is used to avoid predicting labels for them again. */
+  VoxelPredictionCache_Ptr m_predictionCache;
+
+  /** A memory block in which to store the locations of the candidate voxels from which the voxels to use for prediction are chosen. */
+  boost::shared_ptr<ORUtils::MemoryBlock<Vector3s> > m_predictionCandidateLocationsMB;
+
   /** A memory block in which to store the feature vectors computed for the various voxels during prediction. */
   boost::shared_ptr<ORUtils::MemoryBlock<float> > m_predictionFeaturesMB;
 
   /** A memory block in which to store the labels predicted for the various voxels. */
   boost::shared_ptr<ORUtils::MemoryBlock<SpaintVoxel::PackedLabel> > m_predictionLabelsMB;
 
+  /** The leaves (one per tree) reached by the feature descriptors of the voxels for which labels were most recently predicted. */
+  std::vector<int> m_predictionLeafIndices;
+
+  /** The scratch buffers used by the compiled forest when predicting labels (one per prediction thread, reused across frames). */
+  std::vector<std::vector<float> > m_predictionScratch;
+
   /** The voxel sampler used in prediction mode. */
   UniformVoxelSampler_CPtr m_predictionSampler;
 
+  /** A timer used to measure how long prediction takes (so that the rest of the frame's time can be used for deferred training). */
+  tvgutil::AverageTimer<boost::chrono::microseconds> m_predictionTimer;
+
   /** A memory block in which to store the locations of the voxels sampled for prediction purposes. */
   Selector::Selection_Ptr m_predictionVoxelLocationsMB;
 
+  /** The size of the raycast result (in pixels) with which the voxel samplers currently work. */
+  int m_raycastResultSize;
+
   /** The ID of the scene on which the component should operate. */
   std::string m_sceneID;
 
@@ -71,12 +100,21 @@ private:
   /** The voxel sampler used in training mode. */
   PerLabelVoxelSampler_CPtr m_trainingSampler;
 
+  /** The scheduler that decides how much training work to do on each frame in order to stay within the target frame time. */
+  TrainingScheduler_Ptr m_trainingScheduler;
+
+  /** A timer used to measure how long it takes to split nodes in the forest. */
+  tvgutil::AverageTimer<boost::chrono::microseconds> m_trainingTimer;
+
   /** A memory block in which to store the number of voxels sampled for each label for training purposes. */
   boost::shared_ptr<ORUtils::MemoryBlock<unsigned int> > m_trainingVoxelCountsMB;
 
   /** A memory block in which to store the locations of the voxels sampled for training purposes. */
   Selector::Selection_Ptr m_trainingVoxelLocationsMB;
 
+  /** The number of voxels per label that the training sampler currently samples each frame. */
+  size_t m_trainingVoxelsPerLabel;
+
   //#################### CONSTRUCTORS ####################
 public:
   /**
@@ -112,6 +150,8 @@ public:
   /**
    * \brief Runs the prediction section of the component.
    *
+   * Any time left over within the target frame time after prediction is used to do training work deferred from earlier frames.
+   *
    * \param renderState The render state associated with the camera position from which to sample voxels.
    */
   void run_prediction(const VoxelRenderState_CPtr& renderState);
@@ -119,9 +159,40 @@ public:
   /**
    * \brief Runs the training section of the component.
    *
+   * The numbers of voxels sampled and nodes split are adapted from frame to frame so as to stay within the target frame time.
+   *
    * \param renderState The render state associated with the camera position from which to sample voxels.
    */
   void run_training(const VoxelRenderState_CPtr& renderState);
+
+  //#################### PRIVATE MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Chooses the voxels for which to predict labels on the current frame.
+   *
+   * More candidate voxels are sampled than labels can be predicted for, and the voxels are chosen from among the candidates,
+   * preferring those that have no fresh label in the prediction cache. If there are not enough of these, the rest of the voxels
+   * are chosen from the other candidates (thereby refreshing their labels).
+   *
+   * \param raycastResult The current raycast result.
+   * \return              true, if any of the chosen voxels has no fresh label, or false otherwise (in which case there is no need to predict labels).
+   */
+  bool choose_prediction_voxels(const ORFloat4Image *raycastResult);
+
+  /**
+   * \brief Resets the training sampler (and the memory block into which it writes) to sample the specified number of voxels per label.
+   *
+   * \param voxelsPerLabel  The number of voxels per label to sample.
+   */
+  void reset_training_sampler(size_t voxelsPerLabel);
+
+  /**
+   * \brief Trains the forest for a frame, and records how long this took with the training scheduler.
+   *
+   * \param splitBudget The maximum number of nodes to split (across all the trees).
+   * \param idle        Whether or not the training is being done on an idle frame (i.e. using the deferred budget).
+   */
+  void train_forest(size_t splitBudget, bool idle);
 };
 
 //#################### TYPEDEFS ####################
@@ -6,6 +6,8 @@
 #ifndef H_SPAINT_FORESTUTIL
 #define H_SPAINT_FORESTUTIL
 
+#include <boost/make_shared.hpp>
+
 #include <ORUtils/MemoryBlock.h>
 
 #include <rafl/examples/Example.h>
@@ -69,12 +71,12 @@ struct ForestUtil
     {
       for(size_t i = 0; i < descriptorCounts[label]; ++i)
       {
-        // Copy the features for the example into a descriptor.
+        // Copy the features for the example into a descriptor (make_shared is used to allocate each object and its reference count together).
         const float *featuresForExample = features + (label * maxDescriptorsPerLabel + i) * featureCount;
-        rafl::Descriptor_Ptr descriptor(new rafl::Descriptor(featuresForExample, featuresForExample + featureCount));
+        rafl::Descriptor_CPtr descriptor = boost::make_shared<rafl::Descriptor>(featuresForExample, featuresForExample + featureCount);
 
         // Make the example and add it.
-        examples[exampleIndex++] = Example_CPtr(new rafl::Example<Label>(descriptor, label));
+        examples[exampleIndex++] = boost::make_shared<const rafl::Example<Label> >(descriptor, label);
       }
     }
 
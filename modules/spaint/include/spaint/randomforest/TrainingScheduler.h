@@ -0,0 +1,148 @@
+/**
+ * spaint: TrainingScheduler.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#ifndef H_SPAINT_TRAININGSCHEDULER
+#define H_SPAINT_TRAININGSCHEDULER
+
+#include <cstddef>
+
+#include <boost/shared_ptr.hpp>
+
+namespace spaint {
+
+/**
+ * \brief An instance of this class decides how much online training work to do each frame in order to stay within a target time.
+ *
+ * Training a forest online involves sampling voxels, calculating features for them and then splitting nodes in the forest.
+ * The scheduler keeps running estimates of how long each of these takes (per sampled voxel and per split, respectively),
+ * and uses them to choose the number of voxels to sample per label and the number of nodes to split on each frame.
+ * Any splits that are cut from a training frame's nominal budget due to lack of time are deferred (up to a limit of a few
+ * frames' worth), and can be done on later frames that have time to spare (e.g. frames on which only prediction is done).
+ */
+class TrainingScheduler
+{
+  //#################### CONSTANTS ####################
+private:
+  /** The maximum number of training frames' worth of nominal split budget that can be deferred at any one time. */
+  static const size_t MAX_DEFERRED_FRAMES = 4;
+
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** The number of splits that have been deferred from earlier training frames. */
+  size_t m_deferredSplitCount;
+
+  /** The estimated time (in ms) taken to sample and calculate the features for one voxel per label (< 0 if not yet known). */
+  double m_featureCostPerVoxel;
+
+  /** The fraction of the target time that can be used for sampling voxels and calculating their features. */
+  double m_featureTimeFraction;
+
+  /** The maximum number of voxels to sample per label on each frame. */
+  size_t m_maxVoxelsPerLabel;
+
+  /** The minimum number of nodes to split on each training frame, even if there is no time left. */
+  size_t m_minSplitBudget;
+
+  /** The minimum number of voxels to sample per label on each frame. */
+  size_t m_minVoxelsPerLabel;
+
+  /** The number of nodes to split on each training frame if there is time. */
+  size_t m_nominalSplitBudget;
+
+  /** The estimated time (in ms) taken to split a node (< 0 if not yet known). */
+  double m_splitCost;
+
+  /** The target time (in ms) for the training work done on each frame. */
+  double m_targetTime;
+
+  /** The number of voxels to sample per label on the next training frame. */
+  size_t m_voxelsPerLabel;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Constructs a training scheduler.
+   *
+   * \param targetTime          The target time (in ms) for the training work done on each frame.
+   * \param minVoxelsPerLabel   The minimum number of voxels to sample per label on each frame.
+   * \param maxVoxelsPerLabel   The maximum number of voxels to sample per label on each frame.
+   * \param nominalSplitBudget  The number of nodes to split on each training frame if there is time.
+   * \param featureTimeFraction The fraction of the target time that can be used for sampling voxels and calculating their features.
+   * \param minSplitBudget      The minimum number of nodes to split on each training frame, even if there is no time left (this ensures
+   *                            that the forest keeps growing on machines that are too slow to fit any splits into the target time).
+   */
+  TrainingScheduler(double targetTime, size_t minVoxelsPerLabel, size_t maxVoxelsPerLabel, size_t nominalSplitBudget, double featureTimeFraction = 0.5, size_t minSplitBudget = 1);
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Gets the number of splits that have been deferred from earlier training frames.
+   *
+   * \return  The number of splits that have been deferred from earlier training frames.
+   */
+  size_t get_deferred_split_count() const;
+
+  /**
+   * \brief Gets the number of deferred splits that can be done on an idle frame (one on which no new examples are being added).
+   *
+   * \param elapsedTime The time (in ms) that has already been spent on the frame.
+   * \return            The number of deferred splits that can be done in the time remaining.
+   */
+  size_t get_idle_split_budget(double elapsedTime) const;
+
+  /**
+   * \brief Gets the number of nodes that can be split on a training frame.
+   *
+   * \param elapsedTime The time (in ms) that has already been spent on the frame (e.g. sampling voxels and calculating features).
+   * \return            The number of nodes that can be split in the time remaining (but at least the minimum split budget).
+   */
+  size_t get_split_budget(double elapsedTime) const;
+
+  /**
+   * \brief Gets the number of voxels to sample per label on the next training frame.
+   *
+   * \return  The number of voxels to sample per label on the next training frame (a power of two between the minimum and maximum).
+   */
+  size_t get_voxels_per_label() const;
+
+  /**
+   * \brief Records how long it took to sample voxels and calculate their features on a training frame.
+   *
+   * The estimated cost per voxel is updated, and the number of voxels to sample per label on the next frame is chosen accordingly.
+   *
+   * \param voxelsPerLabel  The number of voxels per label that were sampled.
+   * \param time            The time (in ms) taken.
+   */
+  void record_feature_time(size_t voxelsPerLabel, double time);
+
+  /**
+   * \brief Records how long it took to split nodes in the forest.
+   *
+   * \param splitBudget The number of nodes that were allowed to be split.
+   * \param nodesSplit  The number of nodes that were actually split.
+   * \param time        The time (in ms) taken.
+   * \param idle        Whether or not the splits were done on an idle frame (i.e. using the deferred budget).
+   */
+  void record_training_time(size_t splitBudget, size_t nodesSplit, double time, bool idle);
+
+  //#################### PRIVATE STATIC MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Blends a new measurement into a running estimate.
+   *
+   * \param estimate    The running estimate (< 0 if there is no estimate yet).
+   * \param measurement The new measurement.
+   * \return            The updated estimate.
+   */
+  static double update_estimate(double estimate, double measurement);
+};
+
+//#################### TYPEDEFS ####################
+
+typedef boost::shared_ptr<TrainingScheduler> TrainingScheduler_Ptr;
+
+}
+
+#endif
@@ -0,0 +1,180 @@
+/**
+ * spaint: VoxelPredictionCache.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#ifndef H_SPAINT_VOXELPREDICTIONCACHE
+#define H_SPAINT_VOXELPREDICTIONCACHE
+
+#include <map>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <ORUtils/Math.h>
+
+namespace spaint {
+
+/**
+ * \brief An instance of this class records when labels were last predicted for the voxels in a scene, so that prediction can focus on voxels with no fresh label.
+ *
+ * The label predicted for a voxel is considered to be fresh if it was predicted no more than a specified number of frames ago
+ * (after which the voxel's neighbourhood may have changed enough for its features to be different), and if the forest would
+ * still predict the same label for it. The latter is the case if the label was predicted using the current version of the
+ * forest or, if the leaves reached by the voxel's descriptor were recorded, if none of those leaves have changed since (as
+ * determined by a leaf checker supplied by the caller). The records are kept per block of voxels, and a block's records are
+ * discarded as soon as none of them can still be fresh, so the memory used by the cache is bounded by the part of the scene
+ * that has been predicted recently.
+ */
+class VoxelPredictionCache
+{
+  //#################### CONSTANTS ####################
+private:
+  /** The side length of a block of voxels (this is the same as the side length of a voxel block in the scene). */
+  static const int BLOCK_SIZE = 8;
+
+  //#################### TYPEDEFS ####################
+public:
+  /**
+   * A function that checks whether any of the specified leaves (one per tree) have changed since the specified version of the forest
+   * (see rafl::CompiledForest::leaves_unchanged_since). Its arguments are the leaf indices, the number of leaves and the version.
+   */
+  typedef boost::function<bool(const int*,size_t,size_t)> LeafChecker;
+
+  //#################### NESTED TYPES ####################
+private:
+  /**
+   * \brief An instance of this struct records when labels were last predicted for the voxels in a block.
+   */
+  struct BlockRecord
+  {
+    /** The most recent frame in which a label was predicted for any voxel in the block. */
+    size_t lastPredictionFrame;
+
+    /** The number of leaves recorded for each voxel in the block (one per tree). */
+    size_t leafCount;
+
+    /** The leaves reached by the descriptors of the voxels in the block (leafCount per voxel, or -1 if not known). */
+    std::vector<int> leafIndices;
+
+    /** The frames in which labels were last predicted for the individual voxels in the block (0 if a voxel has no recorded label). */
+    std::vector<unsigned int> predictionFrames;
+
+    /** The versions of the forest that were used to predict the labels recorded for the individual voxels in the block. */
+    std::vector<size_t> predictionVersions;
+
+    BlockRecord()
+    : lastPredictionFrame(0), leafCount(0)
+    {}
+  };
+
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** The records for the blocks containing voxels whose labels may still be fresh. */
+  std::map<boost::uint64_t,BlockRecord> m_blocks;
+
+  /** The current version of the forest. */
+  size_t m_forestVersion;
+
+  /** The current frame (frames are numbered from 1). */
+  size_t m_frameIndex;
+
+  /** The function used to check whether the leaves used to predict a label have changed since it was predicted (may be empty). */
+  LeafChecker m_leafChecker;
+
+  /** The maximum age (in frames) of a label that is considered to be fresh. */
+  size_t m_maxPredictionAge;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Constructs a voxel prediction cache.
+   *
+   * \param maxPredictionAge    The maximum age (in frames) of a label that is considered to be fresh.
+   * \throws std::runtime_error If maxPredictionAge is zero.
+   */
+  explicit VoxelPredictionCache(size_t maxPredictionAge);
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Starts a new frame.
+   *
+   * \param forestVersion The version of the forest that will be used to predict labels in the frame.
+   * \param leafChecker   An optional function that can be used to check whether the leaves used to predict a label with an earlier
+   *                      version of the forest have changed since (if it is empty, only labels predicted with the current version are fresh).
+   */
+  void begin_frame(size_t forestVersion, const LeafChecker& leafChecker = LeafChecker());
+
+  /**
+   * \brief Clears the cache (e.g. because the forest has been reset).
+   */
+  void clear();
+
+  /**
+   * \brief Gets the number of blocks for which the cache currently holds records.
+   *
+   * \return  The number of blocks for which the cache currently holds records.
+   */
+  size_t get_block_count() const;
+
+  /**
+   * \brief Gets whether or not the label predicted for the specified voxel is fresh.
+   *
+   * \param voxelLocation The location of the voxel.
+   * \return              true, if a label was predicted for the voxel in one of the last maxPredictionAge frames (including the current one),
+   *                      using either the current version of the forest or an earlier version whose relevant leaves have not changed since,
+   *                      or false otherwise.
+   */
+  bool is_fresh(const Vector3s& voxelLocation) const;
+
+  /**
+   * \brief Records the leaves (one per tree) reached by the descriptor of a voxel for which a label is being predicted in the current frame.
+   *
+   * If no prediction has been recorded for the voxel in the current frame, this is a no-op.
+   *
+   * \param voxelLocation The location of the voxel.
+   * \param leafIndices   The indices of the leaves (one per tree).
+   * \param leafCount     The number of leaves.
+   */
+  void record_leaves(const Vector3s& voxelLocation, const int *leafIndices, size_t leafCount);
+
+  /**
+   * \brief Records that a label is being predicted for the specified voxel in the current frame.
+   *
+   * Any leaves previously recorded for the voxel are forgotten (see record_leaves).
+   *
+   * \param voxelLocation The location of the voxel.
+   */
+  void record_prediction(const Vector3s& voxelLocation);
+
+  //#################### PRIVATE STATIC MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Finds the key of the block containing the specified voxel, and the index of the voxel within the block.
+   *
+   * \param voxelLocation The location of the voxel.
+   * \param voxelIndex    A location into which to write the index of the voxel within its block.
+   * \return              The key of the block.
+   */
+  static boost::uint64_t find_block(const Vector3s& voxelLocation, int& voxelIndex);
+
+  /**
+   * \brief Splits a voxel coordinate into the coordinate of the block that contains it and its offset within that block.
+   *
+   * \param coord   The voxel coordinate.
+   * \param offset  A location into which to write the offset of the voxel within its block.
+   * \return        The coordinate of the block that contains the voxel.
+   */
+  static int split_coordinate(int coord, int& offset);
+};
+
+//#################### TYPEDEFS ####################
+
+typedef boost::shared_ptr<VoxelPredictionCache> VoxelPredictionCache_Ptr;
+
+}
+
+#endif
@@ -74,6 +74,7 @@ public:
    * \brief Loads a random forest from the file specified by the forest path.
    *
    * The loading is done in TouchSettings rather than TouchDetector to work around a weird compiler bug.
+   * Forests whose files have a .rfb extension are loaded from rafl's binary format (without their reservoirs).
    *
    * \return  The random forest that has been loaded.
    */
@@ -5,12 +5,25 @@
 
 #include "features/cpu/VOPFeatureCalculator_CPU.h"
 
+#include <algorithm>
 #include <vector>
 
 #include <ITMLib/Objects/Scene/ITMRepresentationAccess.h>
 
 #include "features/shared/VOPFeatureCalculator_Shared.h"
 
+namespace {
+
+//#################### LOCAL CONSTANTS ####################
+
+/**
+ * The number of voxel patches that are processed together by a thread when converting patches to CIELab or calculating
+ * their dominant orientations (the working set for a block fits comfortably within a core's cache).
+ */
+const int PATCH_BLOCK_SIZE = 16;
+
+}
+
 namespace spaint {
 
 //#################### CONSTRUCTORS ####################
@@ -44,13 +57,51 @@ void VOPFeatureCalculator_CPU::convert_patches_to_lab(int voxelLocationCount, OR
 {
   const size_t featureCount = get_feature_count();
   float *features = featuresMB.GetData(MEMORYDEVICE_CPU);
+  const int patchArea = static_cast<int>(m_patchSize * m_patchSize);
+  const int blockCount = (voxelLocationCount + PATCH_BLOCK_SIZE - 1) / PATCH_BLOCK_SIZE;
 
 #ifdef WITH_OPENMP
-  #pragma omp parallel for
+  #pragma omp parallel
 #endif
-  for(int voxelLocationIndex = 0; voxelLocationIndex < voxelLocationCount; ++voxelLocationIndex)
   {
-    convert_patch_to_lab(voxelLocationIndex, featureCount, features);
+    // The colours of the patches in a block are converted to CIEXYZ in a first pass, which is linear and can be vectorised,
+    // and are stored in separate X, Y and Z arrays for the thread. They are then converted to CIELab in a second pass.
+    std::vector<float> xs(PATCH_BLOCK_SIZE * patchArea), ys(PATCH_BLOCK_SIZE * patchArea), zs(PATCH_BLOCK_SIZE * patchArea);
+
+#ifdef WITH_OPENMP
+    #pragma omp for
+#endif
+    for(int blockIndex = 0; blockIndex < blockCount; ++blockIndex)
+    {
+      const int firstVoxelLocationIndex = blockIndex * PATCH_BLOCK_SIZE;
+      const int blockSize = std::min(PATCH_BLOCK_SIZE, voxelLocationCount - firstVoxelLocationIndex);
+
+      for(int i = 0; i < blockSize; ++i)
+      {
+        const float *rgbPatch = features + (firstVoxelLocationIndex + i) * featureCount;
+        float *x = &xs[i * patchArea], *y = &ys[i * patchArea], *z = &zs[i * patchArea];
+        for(int j = 0; j < patchArea; ++j)
+        {
+          Vector3f xyz = itmx::convert_rgb_to_xyz(Vector3f(rgbPatch[j * 3] / 255.0f, rgbPatch[j * 3 + 1] / 255.0f, rgbPatch[j * 3 + 2] / 255.0f));
+          x[j] = xyz.x;
+          y[j] = xyz.y;
+          z[j] = xyz.z;
+        }
+      }
+
+      for(int i = 0; i < blockSize; ++i)
+      {
+        float *labPatch = features + (firstVoxelLocationIndex + i) * featureCount;
+        const float *x = &xs[i * patchArea], *y = &ys[i * patchArea], *z = &zs[i * patchArea];
+        for(int j = 0; j < patchArea; ++j)
+        {
+          Vector3f lab = itmx::convert_xyz_to_lab(Vector3f(x[j], y[j], z[j]));
+          labPatch[j * 3] = lab.x;
+          labPatch[j * 3 + 1] = lab.y;
+          labPatch[j * 3 + 2] = lab.z;
+        }
+      }
+    }
   }
 }
 
@@ -107,46 +158,73 @@ void VOPFeatureCalculator_CPU::generate_rgb_patches(const ORUtils::MemoryBlock<V
 
 void VOPFeatureCalculator_CPU::update_coordinate_systems(int voxelLocationCount, const ORUtils::MemoryBlock<float>& featuresMB) const
 {
-  const int featureCount = static_cast<int>(get_feature_count());
+  const size_t featureCount = get_feature_count();
   const float *features = featuresMB.GetData(MEMORYDEVICE_CPU);
   const int patchSize = static_cast<int>(m_patchSize);
   const int patchArea = patchSize * patchSize;
+  const int blockCount = (voxelLocationCount + PATCH_BLOCK_SIZE - 1) / PATCH_BLOCK_SIZE;
   Vector3f *xAxes = m_xAxesMB->GetData(MEMORYDEVICE_CPU);
   Vector3f *yAxes = m_yAxesMB->GetData(MEMORYDEVICE_CPU);
 
-  std::vector<std::vector<float> > histograms(voxelLocationCount, std::vector<float>(m_binCount));
-  std::vector<std::vector<float> > intensities(voxelLocationCount, std::vector<float>(patchArea));
-
-  int threadCount = voxelLocationCount * patchArea;
-
-  // Convert each voxel's RGB patch to an intensity patch.
-#ifdef WITH_OPENMP
-  #pragma omp parallel for
-#endif
-  for(int tid = 0; tid < threadCount; ++tid)
-  {
-    int voxelLocationIndex = tid / patchArea;
-    compute_intensities_for_patch(tid, features, featureCount, patchSize, &intensities[voxelLocationIndex][0]);
-  }
-
-  // Compute a histogram of oriented gradients from the intensity patch for each voxel.
 #ifdef WITH_OPENMP
-  #pragma omp parallel for
+  #pragma omp parallel
 #endif
-  for(int tid = 0; tid < threadCount; ++tid)
   {
-    int voxelLocationIndex = tid / patchArea;
-    compute_histogram_for_patch(tid, m_patchSize, &intensities[voxelLocationIndex][0], m_binCount, &histograms[voxelLocationIndex][0]);
-  }
+    // Each thread accumulates the histograms for its own block of patches, so no atomic updates are needed.
+    std::vector<float> histograms(PATCH_BLOCK_SIZE * m_binCount);
+    std::vector<float> intensities(PATCH_BLOCK_SIZE * patchArea);
+    std::vector<float> magnitudes(patchSize), xDerivs(patchSize), yDerivs(patchSize);
 
-  // Calculate the dominant orientation for each voxel and rotate its coordinate system to align with that as necessary.
 #ifdef WITH_OPENMP
-  #pragma omp parallel for
+    #pragma omp for
 #endif
-  for(int tid = 0; tid < threadCount; ++tid)
-  {
-    int voxelLocationIndex = tid / patchArea;
-    update_coordinate_system(tid, patchArea, &histograms[voxelLocationIndex][0], m_binCount, &xAxes[voxelLocationIndex], &yAxes[voxelLocationIndex]);
+    for(int blockIndex = 0; blockIndex < blockCount; ++blockIndex)
+    {
+      const int firstVoxelLocationIndex = blockIndex * PATCH_BLOCK_SIZE;
+      const int blockSize = std::min(PATCH_BLOCK_SIZE, voxelLocationCount - firstVoxelLocationIndex);
+
+      // Convert the RGB patches in the block to intensity patches.
+      for(int i = 0; i < blockSize; ++i)
+      {
+        const float *rgbPatch = features + (firstVoxelLocationIndex + i) * featureCount;
+        float *intensityPatch = &intensities[i * patchArea];
+        for(int j = 0; j < patchArea; ++j)
+        {
+          intensityPatch[j] = itmx::convert_rgb_to_grey(rgbPatch[j * 3], rgbPatch[j * 3 + 1], rgbPatch[j * 3 + 2]);
+        }
+      }
+
+      // Compute a histogram of oriented gradients from each intensity patch. The derivatives and magnitudes are computed
+      // a row at a time (which can be vectorised), after which the orientations are quantized and added to the histogram.
+      std::fill(histograms.begin(), histograms.end(), 0.0f);
+      for(int i = 0; i < blockSize; ++i)
+      {
+        const float *intensityPatch = &intensities[i * patchArea];
+        float *histogram = &histograms[i * m_binCount];
+        for(int y = 1; y < patchSize - 1; ++y)
+        {
+          const float *row = intensityPatch + y * patchSize;
+          for(int x = 1; x < patchSize - 1; ++x)
+          {
+            xDerivs[x] = row[x + 1] - row[x - 1];
+            yDerivs[x] = row[x + patchSize] - row[x - patchSize];
+            magnitudes[x] = static_cast<float>(sqrt(xDerivs[x] * xDerivs[x] + yDerivs[x] * yDerivs[x]));
+          }
+
+          for(int x = 1; x < patchSize - 1; ++x)
+          {
+            histogram[quantize_gradient_orientation(xDerivs[x], yDerivs[x], m_binCount)] += magnitudes[x];
+          }
+        }
+      }
+
+      // Calculate the dominant orientation for each voxel and rotate its coordinate system to align with that as necessary.
+      for(int i = 0; i < blockSize; ++i)
+      {
+        const int voxelLocationIndex = firstVoxelLocationIndex + i;
+        update_coordinate_system(0, patchArea, &histograms[i * m_binCount], m_binCount, &xAxes[voxelLocationIndex], &yAxes[voxelLocationIndex]);
+      }
+    }
   }
 }
 
@@ -29,9 +29,9 @@ VOPFeatureCalculator::VOPFeatureCalculator(size_t maxVoxelLocationCount, size_t
   m_binCount(binCount),
   m_patchSize(patchSize),
   m_patchSpacing(patchSpacing),
-  m_surfaceNormalsMB(MemoryBlockFactory::instance().make_block<Vector3f>(maxVoxelLocationCount)),
-  m_xAxesMB(MemoryBlockFactory::instance().make_block<Vector3f>(maxVoxelLocationCount)),
-  m_yAxesMB(MemoryBlockFactory::instance().make_block<Vector3f>(maxVoxelLocationCount))
+  m_surfaceNormalsMB(MemoryBlockFactory::instance().make_block<Vector3f>(maxVoxelLocationCount, "Features")),
+  m_xAxesMB(MemoryBlockFactory::instance().make_block<Vector3f>(maxVoxelLocationCount, "Features")),
+  m_yAxesMB(MemoryBlockFactory::instance().make_block<Vector3f>(maxVoxelLocationCount, "Features"))
 {}
 
 //#################### PUBLIC MEMBER FUNCTIONS ####################
@@ -221,7 +221,7 @@ boost::optional<Vector3f> ArUcoFiducialDetector::pick_corner_from_raycast(const
 
   if(!m_picker) m_picker = PickerFactory::make_picker(m_settings->deviceType);
 
-  static boost::shared_ptr<ORUtils::MemoryBlock<Vector3f> > pickPointFloatMB = MemoryBlockFactory::instance().make_block<Vector3f>(1);
+  static boost::shared_ptr<ORUtils::MemoryBlock<Vector3f> > pickPointFloatMB = MemoryBlockFactory::instance().make_block<Vector3f>(1, "Fiducials");
   bool pickPointFound = m_picker->pick(p.x, p.y, m_renderState.get(), *pickPointFloatMB);
   if(!pickPointFound) return boost::none;
 
@@ -10,7 +10,7 @@ using namespace tvgutil;
 #include <boost/serialization/singleton.hpp>
 #include <boost/serialization/shared_ptr.hpp>
 
-#include <itmx/persistence/ImagePersister.h>
+#include <itmx/persistence/SequenceRecorder.h>
 using namespace itmx;
 
 #include "segmentation/SegmentationUtil.h"
@@ -75,13 +75,25 @@ void ObjectSegmentationComponent::run_segmentation(const VoxelRenderState_CPtr&
   boost::optional<SequentialPathGenerator>& segmentationPathGenerator = m_context->get_segmentation_path_generator();
   if(segmentationPathGenerator)
   {
-    segmentationPathGenerator->increment_index();
-    ImagePersister::save_image_on_thread(colouredDepthInput, segmentationPathGenerator->make_path("cdepth%06i.png"));
-    ImagePersister::save_image_on_thread(colouredDepthMasked, segmentationPathGenerator->make_path("cdepthm%06i.png"));
-    ImagePersister::save_image_on_thread(depthInput, segmentationPathGenerator->make_path("depth%06i.pgm"));
-    ImagePersister::save_image_on_thread(depthMasked, segmentationPathGenerator->make_path("depthm%06i.pgm"));
-    ImagePersister::save_image_on_thread(rgbInput, segmentationPathGenerator->make_path("rgb%06i.ppm"));
-    ImagePersister::save_image_on_thread(rgbMasked, segmentationPathGenerator->make_path("rgbm%06i.ppm"));
+    // If the recorder can't keep up and has had to drop the frame, skip it (without advancing the frame index).
+    if(!m_segmentationRecorder) m_segmentationRecorder = SequenceRecorder::make_from_settings(m_context->get_settings());
+    SequenceRecorder::Frame_Ptr frame = m_segmentationRecorder->begin_frame();
+    if(frame)
+    {
+      segmentationPathGenerator->increment_index();
+      frame->add_image(colouredDepthInput, segmentationPathGenerator->make_path("cdepth%06i.png"));
+      frame->add_image(colouredDepthMasked, segmentationPathGenerator->make_path("cdepthm%06i.png"));
+      frame->add_image(depthInput, segmentationPathGenerator->make_path("depth%06i.pgm"));
+      frame->add_image(depthMasked, segmentationPathGenerator->make_path("depthm%06i.pgm"));
+      frame->add_image(rgbInput, segmentationPathGenerator->make_path("rgb%06i.ppm"));
+      frame->add_image(rgbMasked, segmentationPathGenerator->make_path("rgbm%06i.ppm"));
+      m_segmentationRecorder->submit_frame(frame);
+    }
+  }
+  else if(m_segmentationRecorder)
+  {
+    // If the segmentation video has just been stopped, wait for any outstanding frames to be saved and destroy the recorder.
+    m_segmentationRecorder.reset();
   }
 
   // Set the masked colour image as the segmentation overlay image so that it will be rendered.
@@ -5,6 +5,8 @@
 
 #include "pipelinecomponents/PropagationComponent.h"
 
+#include <tvgutil/timing/Tracer.h>
+
 #include "propagation/LabelPropagatorFactory.h"
 
 namespace spaint {
@@ -28,6 +30,7 @@ void PropagationComponent::reset_label_propagator(int raycastResultSize)
 
 void PropagationComponent::run(const VoxelRenderState_CPtr& renderState)
 {
+  TRACE_SCOPE("Propagation");
   m_labelPropagator->propagate_label(m_context->get_semantic_label(), renderState->raycastResult, m_context->get_slam_state(m_sceneID)->get_voxel_scene().get());
 }
 
@@ -25,6 +25,7 @@ using namespace grove;
 #endif
 
 #ifdef WITH_OPENCV
+#include <itmx/imagesources/AsyncImageSourceEngine.h>
 #include <itmx/ocv/OpenCVUtil.h>
 #endif
 #include <itmx/relocalisation/CascadeRelocaliser.h>
@@ -39,6 +40,7 @@ using namespace itmx;
 using namespace orx;
 
 #include <tvgutil/misc/SettingsContainer.h>
+#include <tvgutil/timing/Tracer.h>
 using namespace tvgutil;
 
 #ifdef WITH_OPENCV
@@ -82,6 +84,9 @@ SLAMComponent::SLAMComponent(const SLAMContext_Ptr& context, const std::string&
   const Settings_CPtr& settings = context->get_settings();
   m_lowLevelEngine.reset(ITMLowLevelEngineFactory::MakeLowLevelEngine(settings->deviceType));
 
+  // Register any settings that need to be checked every frame.
+  m_globalPosesSpecifier = settings->register_setting<std::string>("globalPosesSpecifier", "");
+
   // Set up the view builder.
   m_viewBuilder.reset(ITMViewBuilderFactory::MakeViewBuilder(m_imageSourceEngine->getCalib(), settings->deviceType));
 
@@ -203,6 +208,8 @@ bool SLAMComponent::process_frame()
     return false;
   }
 
+  TRACE_SCOPE("SLAM: Frame");
+
   const ORShortImage_Ptr& inputRawDepthImage = slamState->get_input_raw_depth_image();
   const ORUChar4Image_Ptr& inputRGBImage = slamState->get_input_rgb_image();
   const SurfelRenderState_Ptr& liveSurfelRenderState = slamState->get_live_surfel_render_state();
@@ -213,11 +220,32 @@ bool SLAMComponent::process_frame()
   const SpaintVoxelScene_Ptr& voxelScene = slamState->get_voxel_scene();
 
   // Get the next frame.
-  ITMView *newView = view.get();
-  m_imageSourceEngine->getImages(inputRGBImage.get(), inputRawDepthImage.get());
-  const bool useBilateralFilter = m_trackingMode == TRACK_SURFELS;
-  m_viewBuilder->UpdateView(&newView, inputRGBImage.get(), inputRawDepthImage.get(), useBilateralFilter);
-  slamState->set_view(newView);
+  {
+    TRACE_SCOPE("SLAM: Input");
+    ITMView *newView = view.get();
+
+    AsyncImageSourceEngine *asyncImageSourceEngine = get_async_image_source_engine();
+    if(asyncImageSourceEngine)
+    {
+      // If the images are being supplied by an asynchronous image source engine, borrow its cached images and use them as the
+      // input images directly, rather than copying them. The previous input images are handed back to the engine so that their
+      // memory can be reused, unless something else is still holding on to them.
+      AsyncImageSourceEngine::RGBDImage previousImages;
+      previousImages.rawDepth = inputRawDepthImage;
+      previousImages.rgb = inputRGBImage;
+
+      AsyncImageSourceEngine::RGBDImage borrowedImages = asyncImageSourceEngine->borrow_images();
+      slamState->set_input_raw_depth_image(borrowedImages.rawDepth);
+      slamState->set_input_rgb_image(borrowedImages.rgb);
+
+      if(previousImages.rawDepth.unique() && previousImages.rgb.unique()) asyncImageSourceEngine->return_images(previousImages);
+    }
+    else m_imageSourceEngine->getImages(inputRGBImage.get(), inputRawDepthImage.get());
+
+    const bool useBilateralFilter = m_trackingMode == TRACK_SURFELS;
+    m_viewBuilder->UpdateView(&newView, inputRGBImage.get(), inputRawDepthImage.get(), useBilateralFilter);
+    slamState->set_view(newView);
+  }
 
   // If there's an active input mask of the right size, apply it to the depth image.
   ORFloatImage_Ptr maskedDepthImage;
@@ -244,6 +272,7 @@ bool SLAMComponent::process_frame()
   {
     // Note: When using a normal tracker, it's safe to call this even before we've started fusion (it will be a no-op).
     //       When using a file-based tracker, we *must* call it in order to correctly set the pose for the first frame.
+    TRACE_SCOPE("SLAM: Tracking");
     m_trackingController->Track(trackingState.get(), view.get());
   }
 
@@ -293,6 +322,8 @@ bool SLAMComponent::process_frame()
 
   if(runFusion)
   {
+    TRACE_SCOPE("SLAM: Fusion");
+
     // Run the fusion process.
     m_denseVoxelMapper->ProcessFrame(view.get(), trackingState.get(), voxelScene.get(), liveVoxelRenderState.get(), resetVisibleList);
     if(m_mappingMode != MAP_VOXELS_ONLY)
@@ -341,7 +372,7 @@ bool SLAMComponent::process_frame()
 
   // If we're using a composite image source engine, the current sub-engine has run out of images and we're not using global poses, disable fusion.
   CompositeImageSourceEngine_CPtr compositeImageSourceEngine = boost::dynamic_pointer_cast<const CompositeImageSourceEngine>(m_imageSourceEngine);
-  const bool usingGlobalPoses = m_context->get_settings()->get_first_value<std::string>("globalPosesSpecifier", "") != "";
+  const bool usingGlobalPoses = m_globalPosesSpecifier->get() != "";
   if(compositeImageSourceEngine && !compositeImageSourceEngine->getCurrentSubengine()->hasMoreImages() && !usingGlobalPoses) m_fusionEnabled = false;
 
   // If we're using a fiducial detector and the user wants to detect fiducials and the tracking is good, try to detect fiducial markers
@@ -468,8 +499,19 @@ void SLAMComponent::set_mapping_client(const MappingClient_Ptr& mappingClient)
 
 //#################### PRIVATE MEMBER FUNCTIONS ####################
 
+AsyncImageSourceEngine *SLAMComponent::get_async_image_source_engine() const
+{
+  // Note: The composite image source engine only provides const access to its current sub-engine, but it owns that sub-engine
+  //       non-const, so it is safe to cast the constness away here.
+  CompositeImageSourceEngine_CPtr compositeImageSourceEngine = boost::dynamic_pointer_cast<const CompositeImageSourceEngine>(m_imageSourceEngine);
+  const ImageSourceEngine *imageSourceEngine = compositeImageSourceEngine ? compositeImageSourceEngine->getCurrentSubengine() : m_imageSourceEngine.get();
+  return const_cast<AsyncImageSourceEngine*>(dynamic_cast<const AsyncImageSourceEngine*>(imageSourceEngine));
+}
+
 void SLAMComponent::prepare_for_tracking(TrackingMode trackingMode)
 {
+  TRACE_SCOPE("SLAM: Raycasting");
+
   const SLAMState_Ptr& slamState = m_context->get_slam_state(m_sceneID);
   const TrackingState_Ptr& trackingState = slamState->get_tracking_state();
   const View_Ptr& view = slamState->get_view();
@@ -496,6 +538,8 @@ void SLAMComponent::prepare_for_tracking(TrackingMode trackingMode)
 
 void SLAMComponent::process_relocalisation()
 {
+  TRACE_SCOPE("SLAM: Relocalisation");
+
   const Relocaliser_Ptr& relocaliser = m_context->get_relocaliser(m_sceneID);
   const SLAMState_Ptr& slamState = m_context->get_slam_state(m_sceneID);
   const TrackingState_Ptr& trackingState = slamState->get_tracking_state();
@@ -519,6 +563,7 @@ void SLAMComponent::process_relocalisation()
   // Note that we prevent training and bookkeeping from both running in the same frame for performance reasons.
   if(!performTraining)
   {
+    TRACE_SCOPE("SLAM: Relocalisation: Update");
     relocaliser->update();
   }
 
@@ -526,6 +571,7 @@ void SLAMComponent::process_relocalisation()
   const bool performRelocalisation = m_relocaliseEveryFrame || trackingState->trackerResult == ITMTrackingState::TRACKING_FAILED;
   if(performRelocalisation)
   {
+    TRACE_SCOPE("SLAM: Relocalisation: Relocalise");
     std::vector<Relocaliser::Result> relocalisationResults = relocaliser->relocalise(view->rgb, view->depth, depthIntrinsics);
 
     if(!relocalisationResults.empty())
@@ -539,6 +585,7 @@ void SLAMComponent::process_relocalisation()
   // Train the relocaliser if necessary.
   if(performTraining)
   {
+    TRACE_SCOPE("SLAM: Relocalisation: Train");
     relocaliser->train(view->rgb, view->depth, depthIntrinsics, oldPose);
   }
 
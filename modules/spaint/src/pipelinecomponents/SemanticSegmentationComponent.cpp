@@ -5,6 +5,12 @@
 
 #include "pipelinecomponents/SemanticSegmentationComponent.h"
 
+#ifdef WITH_OPENMP
+#include <omp.h>
+#endif
+
+#include <boost/bind.hpp>
+
 #ifdef WITH_OPENCV
 #include <itmx/ocv/OpenCVUtil.h>
 #endif
@@ -16,6 +22,8 @@ using namespace orx;
 #include <rafl/examples/Example.h>
 using namespace rafl;
 
+#include <tvgutil/timing/Tracer.h>
+
 #include "features/FeatureCalculatorFactory.h"
 #include "randomforest/ForestUtil.h"
 #include "randomforest/SpaintDecisionFunctionGenerator.h"
@@ -23,12 +31,26 @@ using namespace rafl;
 
 #define DEBUGGING 1
 
+namespace {
+
+//#################### LOCAL CONSTANTS ####################
+
+/** The number of candidate voxels to sample for each voxel for which a label can be predicted on a frame. */
+const size_t PREDICTION_CANDIDATES_PER_VOXEL = 4;
+
+}
+
 namespace spaint {
 
 //#################### CONSTRUCTORS ####################
 
 SemanticSegmentationComponent::SemanticSegmentationComponent(const SemanticSegmentationContext_Ptr& context, const std::string& sceneID, unsigned int seed)
-: m_context(context), m_sceneID(sceneID), m_seed(seed)
+: m_context(context),
+  m_featureTimer("Segmentation: Features"),
+  m_predictionTimer("Segmentation: Prediction"),
+  m_sceneID(sceneID),
+  m_seed(seed),
+  m_trainingTimer("Segmentation: Training")
 {
   // Set the maximum numbers of voxels to use for training and prediction.
   // FIXME: These values shouldn't be hard-coded here ultimately.
@@ -41,14 +63,26 @@ SemanticSegmentationComponent::SemanticSegmentationComponent(const SemanticSegme
   const size_t maxLabelCount = context->get_label_manager()->get_max_label_count();
   const size_t maxTrainingVoxelCount = maxLabelCount * m_maxTrainingVoxelsPerLabel;
 
+  // Set up the training scheduler. The nominal split budget matches what was previously split on every training
+  // frame (20 nodes in each of the 5 trees), but it is now cut (and the rest deferred) if the frame has no time for it.
+  const Settings_CPtr& settings = context->get_settings();
+  const double targetFrameTime = settings->get_first_value<double>("SemanticSegmentationComponent.targetFrameTimeMs", 20.0);
+  const size_t minTrainingVoxelsPerLabel = 16;
+  const size_t nominalSplitBudget = 100;
+  m_trainingScheduler.reset(new TrainingScheduler(targetFrameTime, minTrainingVoxelsPerLabel, m_maxTrainingVoxelsPerLabel, nominalSplitBudget));
+  m_trainingVoxelsPerLabel = m_trainingScheduler->get_voxels_per_label();
+
+  // Set up the prediction cache. Labels predicted for voxels are reused until the forest changes or they get too old
+  // (at which point the voxels' neighbourhoods, and hence their features, may have changed).
+  const size_t maxPredictionAge = settings->get_first_value<size_t>("SemanticSegmentationComponent.maxPredictionAgeFrames", 30);
+  m_predictionCache.reset(new VoxelPredictionCache(maxPredictionAge));
+
   // Set up the voxel samplers.
   const Vector2i& depthImageSize = context->get_slam_state(sceneID)->get_depth_image_size();
   const int raycastResultSize = depthImageSize.width * depthImageSize.height;
   reset_voxel_samplers(raycastResultSize);
 
   // Set up the feature calculator.
-  const Settings_CPtr& settings = context->get_settings();
-
   // FIXME: These values shouldn't be hard-coded here ultimately.
   m_patchSize = 13;
   const float patchSpacing = 0.01f / settings->sceneParams.voxelSize; // 10mm = 0.01m (dividing by the voxel size, which is in m, expresses the spacing in voxels)
@@ -62,13 +96,12 @@ SemanticSegmentationComponent::SemanticSegmentationComponent(const SemanticSegme
   // Set up the memory blocks needed for prediction and training.
   MemoryBlockFactory& mbf = MemoryBlockFactory::instance();
   const size_t featureCount = m_featureCalculator->get_feature_count();
-  m_predictionFeaturesMB = mbf.make_block<float>(m_maxPredictionVoxelCount * featureCount);
-  m_predictionLabelsMB = mbf.make_block<SpaintVoxel::PackedLabel>(m_maxPredictionVoxelCount);
-  m_predictionVoxelLocationsMB = mbf.make_block<Vector3s>(m_maxPredictionVoxelCount);
-  m_trainingFeaturesMB = mbf.make_block<float>(maxTrainingVoxelCount * featureCount);
-  m_trainingLabelMaskMB = mbf.make_block<bool>(maxLabelCount);
-  m_trainingVoxelCountsMB = mbf.make_block<unsigned int>(maxLabelCount);
-  m_trainingVoxelLocationsMB = mbf.make_block<Vector3s>(maxTrainingVoxelCount);
+  m_predictionFeaturesMB = mbf.make_block<float>(m_maxPredictionVoxelCount * featureCount, "SemanticSegmentation");
+  m_predictionLabelsMB = mbf.make_block<SpaintVoxel::PackedLabel>(m_maxPredictionVoxelCount, "SemanticSegmentation");
+  m_predictionVoxelLocationsMB = mbf.make_block<Vector3s>(m_maxPredictionVoxelCount, "SemanticSegmentation");
+  m_trainingFeaturesMB = mbf.make_block<float>(maxTrainingVoxelCount * featureCount, "SemanticSegmentation");
+  m_trainingLabelMaskMB = mbf.make_block<bool>(maxLabelCount, "SemanticSegmentation");
+  m_trainingVoxelCountsMB = mbf.make_block<unsigned int>(maxLabelCount, "SemanticSegmentation");
 
   // Register the relevant decision function generators with the factory.
   DecisionFunctionGeneratorFactory<SpaintVoxel::Label>::instance().register_maker(
@@ -87,14 +120,19 @@ void SemanticSegmentationComponent::reset_forest()
   const size_t treeCount = 5;
   DecisionTree<SpaintVoxel::Label>::Settings dtSettings(m_context->get_resources_dir() + "/RaflSettings.xml");
   m_forest.reset(new RandomForest<SpaintVoxel::Label>(treeCount, dtSettings));
+  m_compiledForest.reset(new CompiledForest<SpaintVoxel::Label>(m_featureCalculator->get_feature_count()));
+  m_predictionCache->clear();
 }
 
 void SemanticSegmentationComponent::reset_voxel_samplers(int raycastResultSize)
 {
-  const size_t maxLabelCount = m_context->get_label_manager()->get_max_label_count();
-  const Settings_CPtr& settings = m_context->get_settings();
-  m_predictionSampler = VoxelSamplerFactory::make_uniform_sampler(raycastResultSize, m_seed, settings->deviceType);
-  m_trainingSampler = VoxelSamplerFactory::make_per_label_sampler(maxLabelCount, m_maxTrainingVoxelsPerLabel, raycastResultSize, m_seed, settings->deviceType);
+  m_raycastResultSize = raycastResultSize;
+  m_predictionSampler = VoxelSamplerFactory::make_uniform_sampler(raycastResultSize, m_seed, m_context->get_settings()->deviceType);
+
+  // Note: The prediction sampler cannot sample more voxels than there are pixels in the raycast result.
+  const size_t predictionCandidateCount = std::min<size_t>(raycastResultSize, PREDICTION_CANDIDATES_PER_VOXEL * m_maxPredictionVoxelCount);
+  m_predictionCandidateLocationsMB = MemoryBlockFactory::instance().make_block<Vector3s>(predictionCandidateCount, "SemanticSegmentation");
+  reset_training_sampler(m_trainingVoxelsPerLabel);
 }
 
 void SemanticSegmentationComponent::run_feature_inspection(const VoxelRenderState_CPtr& renderState)
@@ -106,7 +144,7 @@ void SemanticSegmentationComponent::run_feature_inspection(const VoxelRenderStat
   if(!selection || selection->dataSize != 1) return;
 
   // Calculate the feature descriptor for the selected voxel.
-  boost::shared_ptr<ORUtils::MemoryBlock<float> > featuresMB = MemoryBlockFactory::instance().make_block<float>(m_featureCalculator->get_feature_count());
+  boost::shared_ptr<ORUtils::MemoryBlock<float> > featuresMB = MemoryBlockFactory::instance().make_block<float>(m_featureCalculator->get_feature_count(), "SemanticSegmentation");
   m_featureCalculator->calculate_features(*selection, m_context->get_slam_state(m_sceneID)->get_voxel_scene().get(), *featuresMB);
 
 #ifdef WITH_OPENCV
@@ -127,41 +165,101 @@ void SemanticSegmentationComponent::run_feature_inspection(const VoxelRenderStat
 
 void SemanticSegmentationComponent::run_prediction(const VoxelRenderState_CPtr& renderState)
 {
+  TRACE_SCOPE("Segmentation: Prediction");
+
   // If we haven't been provided with a camera position from which to sample, early out.
   if(!renderState) return;
 
   // If the random forest is not yet valid, early out.
   if(!m_forest->is_valid()) return;
 
-  // Sample some voxels for which to predict labels.
-  m_predictionSampler->sample_voxels(renderState->raycastResult, m_maxPredictionVoxelCount, *m_predictionVoxelLocationsMB);
+  m_predictionTimer.start_sync();
+
+  // Bring the compiled form of the forest up to date with any training that has happened since the last prediction.
+  // Labels predicted using earlier versions of the forest stay fresh if none of the leaves used to predict them have changed since.
+  m_compiledForest->refresh(*m_forest);
+  m_predictionCache->begin_frame(
+    m_compiledForest->get_version(),
+    boost::bind(&CompiledForest<SpaintVoxel::Label>::leaves_unchanged_since, m_compiledForest.get(), _1, _2, _3)
+  );
+
+  // Choose some voxels for which to predict labels. If they all have fresh labels already, there is no need to predict anything.
+  if(choose_prediction_voxels(renderState->raycastResult))
+  {
+    // Calculate feature descriptors for the chosen voxels, and make sure that they are available on the CPU.
+    m_featureCalculator->calculate_features(*m_predictionVoxelLocationsMB, m_context->get_slam_state(m_sceneID)->get_voxel_scene().get(), *m_predictionFeaturesMB);
+    m_predictionFeaturesMB->UpdateHostFromDevice();
 
-  // Calculate feature descriptors for the sampled voxels.
-  m_featureCalculator->calculate_features(*m_predictionVoxelLocationsMB, m_context->get_slam_state(m_sceneID)->get_voxel_scene().get(), *m_predictionFeaturesMB);
-  std::vector<Descriptor_CPtr> descriptors = ForestUtil::make_descriptors(*m_predictionFeaturesMB, m_maxPredictionVoxelCount, m_featureCalculator->get_feature_count());
+    // Predict labels for the voxels based on the feature descriptors. The voxels are divided into chunks that are predicted in parallel.
+    const size_t featureCount = m_featureCalculator->get_feature_count();
+    const float *features = m_predictionFeaturesMB->GetData(MEMORYDEVICE_CPU);
+    std::vector<SpaintVoxel::Label> predictedLabels(m_maxPredictionVoxelCount);
+    const size_t treeCount = m_compiledForest->get_tree_count();
+    m_predictionLeafIndices.resize(m_maxPredictionVoxelCount * treeCount);
 
-  // Predict labels for the voxels based on the feature descriptors.
-  SpaintVoxel::PackedLabel *labels = m_predictionLabelsMB->GetData(MEMORYDEVICE_CPU);
+    const int chunkSize = 256;
+    const int chunkCount = static_cast<int>((m_maxPredictionVoxelCount + chunkSize - 1) / chunkSize);
 
 #ifdef WITH_OPENMP
-  #pragma omp parallel for
+    m_predictionScratch.resize(omp_get_max_threads());
+    #pragma omp parallel for
+#else
+    m_predictionScratch.resize(1);
 #endif
-  for(int i = 0; i < static_cast<int>(m_maxPredictionVoxelCount); ++i)
-  {
-    labels[i] = SpaintVoxel::PackedLabel(m_forest->predict(descriptors[i]), SpaintVoxel::LG_FOREST);
-  }
+    for(int i = 0; i < chunkCount; ++i)
+    {
+#ifdef WITH_OPENMP
+      std::vector<float>& scratch = m_predictionScratch[omp_get_thread_num()];
+#else
+      std::vector<float>& scratch = m_predictionScratch[0];
+#endif
+
+      const size_t chunkBegin = i * chunkSize;
+      const size_t chunkVoxelCount = std::min<size_t>(chunkSize, m_maxPredictionVoxelCount - chunkBegin);
+      m_compiledForest->predict_batch(features + chunkBegin * featureCount, chunkVoxelCount, &predictedLabels[chunkBegin], scratch, &m_predictionLeafIndices[chunkBegin * treeCount]);
+    }
+
+    // Record the leaves that were used to predict the labels, so that the labels can stay fresh until one of those leaves changes.
+    const Vector3s *voxelLocations = m_predictionVoxelLocationsMB->GetData(MEMORYDEVICE_CPU);
+    for(size_t i = 0; i < m_maxPredictionVoxelCount; ++i)
+    {
+      m_predictionCache->record_leaves(voxelLocations[i], &m_predictionLeafIndices[i * treeCount], treeCount);
+    }
+
+    SpaintVoxel::PackedLabel *labels = m_predictionLabelsMB->GetData(MEMORYDEVICE_CPU);
+    for(size_t i = 0; i < m_maxPredictionVoxelCount; ++i)
+    {
+      labels[i] = SpaintVoxel::PackedLabel(predictedLabels[i], SpaintVoxel::LG_FOREST);
+    }
 
-  m_predictionLabelsMB->UpdateDeviceFromHost();
+    m_predictionLabelsMB->UpdateDeviceFromHost();
 
-  // Mark the voxels with their predicted labels.
-  m_context->mark_voxels(m_sceneID, m_predictionVoxelLocationsMB, m_predictionLabelsMB, NORMAL_MARKING);
+    // Mark the voxels with their predicted labels.
+    m_context->mark_voxels(m_sceneID, m_predictionVoxelLocationsMB, m_predictionLabelsMB, NORMAL_MARKING);
+  }
+
+  // Use any time that is left within the target frame time to do training work that had to be deferred from earlier frames.
+  m_predictionTimer.stop_sync();
+  const double predictionTime = m_predictionTimer.last_duration().count() / 1000.0;
+  const size_t idleSplitBudget = m_trainingScheduler->get_idle_split_budget(predictionTime);
+  if(idleSplitBudget > 0) train_forest(idleSplitBudget, true);
 }
 
 void SemanticSegmentationComponent::run_training(const VoxelRenderState_CPtr& renderState)
 {
+  TRACE_SCOPE("Segmentation: Training");
+
   // If we haven't been provided with a camera position from which to sample, early out.
   if(!renderState) return;
 
+  m_featureTimer.start_sync();
+
+  // If the training scheduler has changed the number of voxels to sample per label (to fit the target frame time), remake the training sampler.
+  if(m_trainingScheduler->get_voxels_per_label() != m_trainingVoxelsPerLabel)
+  {
+    reset_training_sampler(m_trainingScheduler->get_voxels_per_label());
+  }
+
   // Calculate a mask indicating the labels that are currently in use and from which we want to train.
   // Note that we deliberately avoid training from the background label (0), since the entire scene is
   // initially labelled as background and so training from the background would cause us to learn
@@ -201,14 +299,86 @@ void SemanticSegmentationComponent::run_training(const VoxelRenderState_CPtr& re
     *m_trainingFeaturesMB,
     *m_trainingVoxelCountsMB,
     m_featureCalculator->get_feature_count(),
-    m_maxTrainingVoxelsPerLabel,
+    m_trainingVoxelsPerLabel,
     maxLabelCount
   );
 
-  // Train the forest.
-  const size_t splitBudget = 20;
+  // Add the examples to the forest, and record how long it took to get to this point.
   m_forest->add_examples(examples);
-  m_forest->train(splitBudget);
+  m_featureTimer.stop_sync();
+  const double featureTime = m_featureTimer.last_duration().count() / 1000.0;
+  m_trainingScheduler->record_feature_time(m_trainingVoxelsPerLabel, featureTime);
+
+  // Train the forest for as much of the rest of the frame as the target frame time allows.
+  train_forest(m_trainingScheduler->get_split_budget(featureTime), false);
+}
+
+//#################### PRIVATE MEMBER FUNCTIONS ####################
+
+bool SemanticSegmentationComponent::choose_prediction_voxels(const ORFloat4Image *raycastResult)
+{
+  // Sample the candidate voxels, and make sure that they are available on the CPU.
+  const size_t candidateCount = m_predictionCandidateLocationsMB->dataSize;
+  m_predictionSampler->sample_voxels(raycastResult, candidateCount, *m_predictionCandidateLocationsMB);
+  m_predictionCandidateLocationsMB->UpdateHostFromDevice();
+
+  // Choose the candidates that have no fresh label, up to the maximum number of voxels for which labels can be predicted.
+  // Each chosen voxel is recorded in the cache straight away, so that any duplicates among the candidates count as fresh.
+  const Vector3s *candidateLocations = m_predictionCandidateLocationsMB->GetData(MEMORYDEVICE_CPU);
+  Vector3s *voxelLocations = m_predictionVoxelLocationsMB->GetData(MEMORYDEVICE_CPU);
+  std::vector<size_t> freshCandidateIndices;
+  size_t voxelCount = 0;
+
+  for(size_t i = 0; i < candidateCount && voxelCount < m_maxPredictionVoxelCount; ++i)
+  {
+    const Vector3s& candidateLocation = candidateLocations[i];
+    if(m_predictionCache->is_fresh(candidateLocation))
+    {
+      freshCandidateIndices.push_back(i);
+    }
+    else
+    {
+      voxelLocations[voxelCount++] = candidateLocation;
+      m_predictionCache->record_prediction(candidateLocation);
+    }
+  }
+
+  if(voxelCount == 0) return false;
+
+  // Fill up any remaining space with candidates whose labels are fresh (the features are calculated for every location in the
+  // memory block, so we may as well use them to refresh some labels). If we run out of candidates, repeat the last voxel.
+  for(size_t i = 0, size = freshCandidateIndices.size(); i < size && voxelCount < m_maxPredictionVoxelCount; ++i)
+  {
+    voxelLocations[voxelCount++] = candidateLocations[freshCandidateIndices[i]];
+    m_predictionCache->record_prediction(voxelLocations[voxelCount - 1]);
+  }
+
+  for(; voxelCount < m_maxPredictionVoxelCount; ++voxelCount)
+  {
+    voxelLocations[voxelCount] = voxelLocations[voxelCount - 1];
+  }
+
+  m_predictionVoxelLocationsMB->UpdateDeviceFromHost();
+  return true;
+}
+
+void SemanticSegmentationComponent::reset_training_sampler(size_t voxelsPerLabel)
+{
+  const size_t maxLabelCount = m_context->get_label_manager()->get_max_label_count();
+  m_trainingVoxelsPerLabel = voxelsPerLabel;
+  m_trainingSampler = VoxelSamplerFactory::make_per_label_sampler(maxLabelCount, voxelsPerLabel, m_raycastResultSize, m_seed, m_context->get_settings()->deviceType);
+
+  // The features are calculated for every location in the block, so its size must match the number of voxels that can be sampled.
+  m_trainingVoxelLocationsMB = MemoryBlockFactory::instance().make_block<Vector3s>(maxLabelCount * voxelsPerLabel, "SemanticSegmentation");
+}
+
+void SemanticSegmentationComponent::train_forest(size_t splitBudget, bool idle)
+{
+  m_trainingTimer.start_nosync();
+  const size_t nodesSplit = m_forest->train_within_budget(splitBudget);
+  m_trainingTimer.stop_nosync();
+
+  m_trainingScheduler->record_training_time(splitBudget, nodesSplit, m_trainingTimer.last_duration().count() / 1000.0, idle);
 }
 
 }
@@ -16,7 +16,7 @@ LabelPropagator::LabelPropagator(size_t raycastResultSize, float maxAngleBetween
 : m_maxAngleBetweenNormals(maxAngleBetweenNormals),
   m_maxSquaredDistanceBetweenColours(maxSquaredDistanceBetweenColours),
   m_maxSquaredDistanceBetweenVoxels(maxSquaredDistanceBetweenVoxels),
-  m_surfaceNormalsMB(MemoryBlockFactory::instance().make_block<Vector3f>(raycastResultSize))
+  m_surfaceNormalsMB(MemoryBlockFactory::instance().make_block<Vector3f>(raycastResultSize, "Propagation"))
 {}
 
 //#################### DESTRUCTOR ####################
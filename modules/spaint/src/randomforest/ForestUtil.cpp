@@ -25,7 +25,7 @@ std::vector<rafl::Descriptor_CPtr> ForestUtil::make_descriptors(const ORUtils::M
   {
     // Copy the relevant features into a descriptor and add it.
     const float *featuresForDescriptor = features + i * featureCount;
-    descriptors[i].reset(new rafl::Descriptor(featuresForDescriptor, featuresForDescriptor + featureCount));
+    descriptors[i] = boost::make_shared<rafl::Descriptor>(featuresForDescriptor, featuresForDescriptor + featureCount);
   }
 
   return descriptors;
@@ -0,0 +1,112 @@
+/**
+ * spaint: TrainingScheduler.cpp
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#include "randomforest/TrainingScheduler.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace spaint {
+
+//#################### CONSTRUCTORS ####################
+
+TrainingScheduler::TrainingScheduler(double targetTime, size_t minVoxelsPerLabel, size_t maxVoxelsPerLabel, size_t nominalSplitBudget, double featureTimeFraction, size_t minSplitBudget)
+: m_deferredSplitCount(0),
+  m_featureCostPerVoxel(-1.0),
+  m_featureTimeFraction(featureTimeFraction),
+  m_maxVoxelsPerLabel(maxVoxelsPerLabel),
+  m_minSplitBudget(minSplitBudget),
+  m_minVoxelsPerLabel(minVoxelsPerLabel),
+  m_nominalSplitBudget(nominalSplitBudget),
+  m_splitCost(-1.0),
+  m_targetTime(targetTime),
+  m_voxelsPerLabel(maxVoxelsPerLabel)
+{
+  if(minVoxelsPerLabel == 0 || minVoxelsPerLabel > maxVoxelsPerLabel)
+  {
+    throw std::runtime_error("Error: The minimum number of voxels per label must be positive and no greater than the maximum");
+  }
+}
+
+//#################### PUBLIC MEMBER FUNCTIONS ####################
+
+size_t TrainingScheduler::get_deferred_split_count() const
+{
+  return m_deferredSplitCount;
+}
+
+size_t TrainingScheduler::get_idle_split_budget(double elapsedTime) const
+{
+  // If we don't know how long a split takes yet, we can't tell how many will fit, so wait for a training frame to find out.
+  if(m_splitCost < 0.0 || elapsedTime >= m_targetTime) return 0;
+  const size_t affordableSplits = static_cast<size_t>((m_targetTime - elapsedTime) / m_splitCost);
+  return std::min(m_deferredSplitCount, affordableSplits);
+}
+
+size_t TrainingScheduler::get_split_budget(double elapsedTime) const
+{
+  const size_t wantedSplits = m_nominalSplitBudget + m_deferredSplitCount;
+
+  // If we don't know how long a split takes yet, use the nominal budget so that we can find out.
+  if(m_splitCost < 0.0) return m_nominalSplitBudget;
+
+  // Always allow the minimum number of splits, so that the forest keeps growing (and the split cost keeps being re-estimated)
+  // even if sampling voxels and calculating their features has already used up the target time.
+  const size_t affordableSplits = elapsedTime < m_targetTime ? static_cast<size_t>((m_targetTime - elapsedTime) / m_splitCost) : 0;
+  return std::min(wantedSplits, std::max(m_minSplitBudget, affordableSplits));
+}
+
+size_t TrainingScheduler::get_voxels_per_label() const
+{
+  return m_voxelsPerLabel;
+}
+
+void TrainingScheduler::record_feature_time(size_t voxelsPerLabel, double time)
+{
+  if(voxelsPerLabel == 0) return;
+  m_featureCostPerVoxel = update_estimate(m_featureCostPerVoxel, time / voxelsPerLabel);
+
+  // Choose the largest power-of-two number of voxels per label (between the minimum and the maximum)
+  // whose sampling and feature calculation are expected to fit into their share of the target time.
+  const double featureTime = m_featureTimeFraction * m_targetTime;
+  m_voxelsPerLabel = m_minVoxelsPerLabel;
+  while(m_voxelsPerLabel * 2 <= m_maxVoxelsPerLabel && m_voxelsPerLabel * 2 * m_featureCostPerVoxel <= featureTime)
+  {
+    m_voxelsPerLabel *= 2;
+  }
+}
+
+void TrainingScheduler::record_training_time(size_t splitBudget, size_t nodesSplit, double time, bool idle)
+{
+  if(nodesSplit > 0) m_splitCost = update_estimate(m_splitCost, time / nodesSplit);
+
+  if(nodesSplit < splitBudget)
+  {
+    // The forest ran out of nodes worth splitting before the budget was used up, so there is no outstanding work.
+    m_deferredSplitCount = 0;
+  }
+  else if(idle)
+  {
+    m_deferredSplitCount -= std::min(m_deferredSplitCount, nodesSplit);
+  }
+  else
+  {
+    // Defer any part of the frame's nominal budget (and of the previously deferred splits) that had to be cut to fit into the target time.
+    // The number of deferred splits is capped, so that it cannot grow without limit when every frame is over budget.
+    const size_t wantedSplits = m_nominalSplitBudget + m_deferredSplitCount;
+    m_deferredSplitCount = std::min(wantedSplits - std::min(wantedSplits, nodesSplit), MAX_DEFERRED_FRAMES * m_nominalSplitBudget);
+  }
+}
+
+//#################### PRIVATE STATIC MEMBER FUNCTIONS ####################
+
+double TrainingScheduler::update_estimate(double estimate, double measurement)
+{
+  // Use an exponential moving average, so that the estimate tracks gradual changes in cost (e.g. as the trees grow) without being thrown by a single slow frame.
+  const double alpha = 0.2;
+  return estimate < 0.0 ? measurement : (1.0 - alpha) * estimate + alpha * measurement;
+}
+
+}
@@ -0,0 +1,134 @@
+/**
+ * spaint: VoxelPredictionCache.cpp
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#include "randomforest/VoxelPredictionCache.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace spaint {
+
+//#################### CONSTRUCTORS ####################
+
+VoxelPredictionCache::VoxelPredictionCache(size_t maxPredictionAge)
+: m_forestVersion(0), m_frameIndex(0), m_maxPredictionAge(maxPredictionAge)
+{
+  if(maxPredictionAge == 0) throw std::runtime_error("Error: The maximum age of a fresh prediction must be positive");
+}
+
+//#################### PUBLIC MEMBER FUNCTIONS ####################
+
+void VoxelPredictionCache::begin_frame(size_t forestVersion, const LeafChecker& leafChecker)
+{
+  ++m_frameIndex;
+  m_forestVersion = forestVersion;
+  m_leafChecker = leafChecker;
+
+  // Every so often, discard the records for any blocks that no longer contain voxels with fresh labels.
+  if(m_frameIndex % m_maxPredictionAge == 0)
+  {
+    for(std::map<boost::uint64_t,BlockRecord>::iterator it = m_blocks.begin(), iend = m_blocks.end(); it != iend;)
+    {
+      const BlockRecord& block = it->second;
+      if(m_frameIndex - block.lastPredictionFrame >= m_maxPredictionAge) m_blocks.erase(it++);
+      else ++it;
+    }
+  }
+}
+
+void VoxelPredictionCache::clear()
+{
+  m_blocks.clear();
+}
+
+size_t VoxelPredictionCache::get_block_count() const
+{
+  return m_blocks.size();
+}
+
+bool VoxelPredictionCache::is_fresh(const Vector3s& voxelLocation) const
+{
+  int voxelIndex;
+  std::map<boost::uint64_t,BlockRecord>::const_iterator it = m_blocks.find(find_block(voxelLocation, voxelIndex));
+  if(it == m_blocks.end()) return false;
+
+  // If no label has been predicted for the voxel recently enough, it can't be fresh.
+  const BlockRecord& block = it->second;
+  const unsigned int predictionFrame = block.predictionFrames[voxelIndex];
+  if(predictionFrame == 0 || m_frameIndex - predictionFrame >= m_maxPredictionAge) return false;
+
+  // Otherwise, the label is fresh if it was predicted using the current version of the forest, or if the leaves
+  // used to predict it are known and have not changed since the version of the forest that was used.
+  const size_t predictionVersion = block.predictionVersions[voxelIndex];
+  if(predictionVersion == m_forestVersion) return true;
+  if(!m_leafChecker || block.leafCount == 0) return false;
+
+  const int *leafIndices = &block.leafIndices[voxelIndex * block.leafCount];
+  return leafIndices[0] != -1 && m_leafChecker(leafIndices, block.leafCount, predictionVersion);
+}
+
+void VoxelPredictionCache::record_leaves(const Vector3s& voxelLocation, const int *leafIndices, size_t leafCount)
+{
+  int voxelIndex;
+  std::map<boost::uint64_t,BlockRecord>::iterator it = m_blocks.find(find_block(voxelLocation, voxelIndex));
+  if(it == m_blocks.end() || it->second.predictionFrames[voxelIndex] != m_frameIndex || leafCount == 0) return;
+
+  // If the number of leaves per voxel has changed (i.e. the number of trees in the forest has changed), forget the leaves recorded for the block so far.
+  BlockRecord& block = it->second;
+  if(block.leafCount != leafCount)
+  {
+    block.leafCount = leafCount;
+    block.leafIndices.assign(BLOCK_SIZE * BLOCK_SIZE * BLOCK_SIZE * leafCount, -1);
+  }
+
+  std::copy(leafIndices, leafIndices + leafCount, block.leafIndices.begin() + voxelIndex * leafCount);
+}
+
+void VoxelPredictionCache::record_prediction(const Vector3s& voxelLocation)
+{
+  int voxelIndex;
+  BlockRecord& block = m_blocks[find_block(voxelLocation, voxelIndex)];
+
+  // If the block's records are empty, initialise them.
+  const size_t voxelCount = BLOCK_SIZE * BLOCK_SIZE * BLOCK_SIZE;
+  if(block.predictionFrames.empty())
+  {
+    block.predictionFrames.assign(voxelCount, 0);
+    block.predictionVersions.assign(voxelCount, 0);
+  }
+
+  block.lastPredictionFrame = m_frameIndex;
+  block.predictionFrames[voxelIndex] = static_cast<unsigned int>(m_frameIndex);
+  block.predictionVersions[voxelIndex] = m_forestVersion;
+
+  // Forget any leaves recorded for an earlier prediction (the leaves for this prediction will be recorded once it has been made).
+  if(block.leafCount > 0) block.leafIndices[voxelIndex * block.leafCount] = -1;
+}
+
+//#################### PRIVATE STATIC MEMBER FUNCTIONS ####################
+
+boost::uint64_t VoxelPredictionCache::find_block(const Vector3s& voxelLocation, int& voxelIndex)
+{
+  int offsetX, offsetY, offsetZ;
+  const int blockX = split_coordinate(voxelLocation.x, offsetX);
+  const int blockY = split_coordinate(voxelLocation.y, offsetY);
+  const int blockZ = split_coordinate(voxelLocation.z, offsetZ);
+
+  voxelIndex = (offsetZ * BLOCK_SIZE + offsetY) * BLOCK_SIZE + offsetX;
+
+  // Since voxel coordinates are shorts, each block coordinate fits into 16 bits once offset to be non-negative.
+  const boost::uint64_t bias = 1 << 15;
+  return ((blockX + bias) << 32) | ((blockY + bias) << 16) | (blockZ + bias);
+}
+
+int VoxelPredictionCache::split_coordinate(int coord, int& offset)
+{
+  // Note: The block coordinate must be rounded down (rather than towards zero) for negative voxel coordinates.
+  const int blockCoord = coord >= 0 ? coord / BLOCK_SIZE : (coord - BLOCK_SIZE + 1) / BLOCK_SIZE;
+  offset = coord - blockCoord * BLOCK_SIZE;
+  return blockCoord;
+}
+
+}
@@ -15,14 +15,14 @@ namespace spaint {
 //#################### CONSTRUCTORS ####################
 
 PerLabelVoxelSampler::PerLabelVoxelSampler(size_t maxLabelCount, size_t maxVoxelsPerLabel, int raycastResultSize, unsigned int seed)
-: m_candidateVoxelIndicesMB(MemoryBlockFactory::instance().make_block<int>(maxLabelCount * maxVoxelsPerLabel)),
-  m_candidateVoxelLocationsMB(MemoryBlockFactory::instance().make_block<Vector3s>(maxLabelCount * raycastResultSize)),
+: m_candidateVoxelIndicesMB(MemoryBlockFactory::instance().make_block<int>(maxLabelCount * maxVoxelsPerLabel, "Sampling")),
+  m_candidateVoxelLocationsMB(MemoryBlockFactory::instance().make_block<Vector3s>(maxLabelCount * raycastResultSize, "Sampling")),
   m_maxLabelCount(maxLabelCount),
   m_maxVoxelsPerLabel(maxVoxelsPerLabel),
   m_raycastResultSize(raycastResultSize),
   m_rng(new tvgutil::RandomNumberGenerator(seed)),
-  m_voxelMaskPrefixSumsMB(MemoryBlockFactory::instance().make_block<unsigned int>(maxLabelCount * (raycastResultSize + 1))),
-  m_voxelMasksMB(MemoryBlockFactory::instance().make_block<unsigned char>(maxLabelCount * (raycastResultSize + 1)))
+  m_voxelMaskPrefixSumsMB(MemoryBlockFactory::instance().make_block<unsigned int>(maxLabelCount * (raycastResultSize + 1), "Sampling")),
+  m_voxelMasksMB(MemoryBlockFactory::instance().make_block<unsigned char>(maxLabelCount * (raycastResultSize + 1), "Sampling"))
 {
   // Make sure that the dummy elements at the end of the voxel masks for the various labels are properly initialised.
   unsigned char *voxelMasks = m_voxelMasksMB->GetData(MEMORYDEVICE_CPU);
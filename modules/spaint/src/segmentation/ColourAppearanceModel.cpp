@@ -38,8 +38,8 @@ float ColourAppearanceModel::compute_posterior_probability(const Vector3u& rgbCo
                        P(colour | object) + P(colour | !object)
   */
   int bin = compute_bin(rgbColour);
-  float colourGivenObject = MapUtil::lookup(m_pmfColourGivenObject->get_masses(), bin, 0.0f);
-  float colourGivenNotObject = MapUtil::lookup(m_pmfColourGivenNotObject->get_masses(), bin, 0.0f);
+  float colourGivenObject = m_pmfColourGivenObject->get_mass(bin);
+  float colourGivenNotObject = m_pmfColourGivenNotObject->get_mass(bin);
   float denom = colourGivenObject + colourGivenNotObject;
   return denom > 0.0f ? colourGivenObject / denom : 0.5f;
 }
@@ -34,8 +34,8 @@ LeapSelector::LeapSelector(const Settings_CPtr& settings, const VoxelVisualisati
   m_fiducialID(fiducialID),
   m_mode(mode),
   m_picker(PickerFactory::make_picker(settings->deviceType)),
-  m_pickPointFloatMB(MemoryBlockFactory::instance().make_block<Vector3f>(1)),
-  m_pickPointShortMB(MemoryBlockFactory::instance().make_block<Vector3s>(1)),
+  m_pickPointFloatMB(MemoryBlockFactory::instance().make_block<Vector3f>(1, "Selectors")),
+  m_pickPointShortMB(MemoryBlockFactory::instance().make_block<Vector3s>(1, "Selectors")),
   m_visualisationEngine(visualisationEngine)
 {}
 
@@ -19,8 +19,8 @@ namespace spaint {
 PickingSelector::PickingSelector(const Settings_CPtr& settings)
 : Selector(settings),
   m_picker(PickerFactory::make_picker(settings->deviceType)),
-  m_pickPointFloatMB(MemoryBlockFactory::instance().make_block<Vector3f>(1)),
-  m_pickPointShortMB(MemoryBlockFactory::instance().make_block<Vector3s>(1)),
+  m_pickPointFloatMB(MemoryBlockFactory::instance().make_block<Vector3f>(1, "Selectors")),
+  m_pickPointShortMB(MemoryBlockFactory::instance().make_block<Vector3s>(1, "Selectors")),
   m_pickPointValid(false)
 {}
 
@@ -384,7 +384,7 @@ int TouchDetector::pick_best_candidate_component_based_on_forest(const af::array
   {
     candidateDiff = (m_connectedComponentImage == candidateIDs[i]) * diffRawRaycastInMm;
     Descriptor_CPtr descriptor = TouchDescriptorCalculator::calculate_histogram_descriptor(candidateDiff);
-    touchProb[i] = MapUtil::lookup(m_forest->calculate_pmf(descriptor).get_masses(), isTouchLabel);
+    touchProb[i] = m_forest->calculate_pmf(descriptor).get_mass(isTouchLabel);
 
 #if defined(DEBUG_TOUCH_OUTPUT_PMF)
     std::cout << "The PMF is: " << m_forest->calculate_pmf(descriptor) << '\n';
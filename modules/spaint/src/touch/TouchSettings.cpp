@@ -4,6 +4,8 @@
 
 #include "touch/TouchSettings.h"
 
+#include <rafl/core/BinaryForestFile.h>
+
 #include <tvgutil/containers/MapUtil.h>
 #include <tvgutil/filesystem/FilesystemUtil.h>
 #include <tvgutil/persistence/PropertyUtil.h>
@@ -68,8 +70,10 @@ TouchSettings::RF_Ptr TouchSettings::load_forest() const
   // Register the relevant decision function generators with the factory.
   rafl::DecisionFunctionGeneratorFactory<Label>::instance().register_rafl_makers();
 
-  // Load the forest.
-  RF_Ptr forest = SerializationUtil::load_text(fullForestPath.string(), forest);
+  // Load the forest. Forests in rafl's binary format are loaded without their reservoirs, since touch detection only uses the forest for prediction.
+  RF_Ptr forest;
+  if(fullForestPath.extension() == ".rfb") forest = rafl::BinaryForestFile<Label>(fullForestPath.string()).load_forest(false);
+  else forest = SerializationUtil::load_text(fullForestPath.string(), forest);
 
   return forest;
 }
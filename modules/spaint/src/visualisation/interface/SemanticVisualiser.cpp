@@ -13,7 +13,7 @@ namespace spaint {
 //#################### CONSTRUCTORS ####################
 
 SemanticVisualiser::SemanticVisualiser(size_t maxLabelCount)
-: m_labelColoursMB(MemoryBlockFactory::instance().make_block<Vector3u>(maxLabelCount))
+: m_labelColoursMB(MemoryBlockFactory::instance().make_block<Vector3u>(maxLabelCount, "Visualisation"))
 {}
 
 //#################### DESTRUCTOR ####################
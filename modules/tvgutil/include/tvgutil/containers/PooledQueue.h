@@ -304,6 +304,20 @@ public:
     return m_queue.front();
   }
 
+  /**
+   * \brief Gets whether or not the pool backing the queue is currently empty.
+   *
+   * If the pool is empty, the next push will have to resort to the pool empty strategy. Callers that want to
+   * apply back-pressure to their producers, rather than relying on that strategy, can check this before pushing.
+   *
+   * \return  true, if the pool backing the queue is currently empty, or false otherwise.
+   */
+  bool pool_empty() const
+  {
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+    return m_pool.empty();
+  }
+
   /**
    * \brief Pops the first element from the queue and returns it to the pool.
    *
@@ -0,0 +1,532 @@
+/**
+ * tvgutil: SPSCPooledQueue.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2017. All rights reserved.
+ */
+
+#ifndef H_TVGUTIL_SPSCPOOLEDQUEUE
+#define H_TVGUTIL_SPSCPOOLEDQUEUE
+
+#include <algorithm>
+#include <vector>
+
+#include <boost/atomic.hpp>
+#include <boost/cstdint.hpp>
+
+#include "PooledQueue.h"
+
+namespace tvgutil {
+
+/**
+ * \brief An instance of an instantiation of this class template represents a lock-free, bounded, single-producer/single-consumer
+ *        queue that is backed by a pool of reusable elements.
+ *
+ * The interface mirrors that of PooledQueue, and can be used as a drop-in replacement for it whenever there is exactly one thread
+ * pushing onto the queue (calling begin_push and pool_empty) and exactly one thread consuming from it (calling peek and pop) at
+ * any one time. The queue and the pool are each stored in a fixed-size ring buffer, so pushing and popping neither take a lock
+ * nor allocate. The pool empty strategies behave as they do for PooledQueue, with two caveats:
+ *
+ * - PES_GROW can only grow the pool up to the size of the ring buffers (see the constructor). Beyond that, it waits.
+ * - PES_REPLACE_RANDOM cannot safely remove an arbitrary element from the middle of the queue without a lock, so instead
+ *   it replaces the most recently pushed element that the consumer is not currently using. If the only element on the
+ *   queue is one that the consumer has already peeked at, it waits.
+ *
+ * Threads that need to wait (the consumer for the queue to become non-empty, or the producer for the pool to become
+ * non-empty) spin briefly before parking on a condition variable.
+ */
+template <typename T>
+class SPSCPooledQueue
+{
+  //#################### NESTED TYPES ####################
+public:
+  /**
+   * \brief An instance of this class can be used to handle the process of pushing an element onto the queue.
+   */
+  class PushHandler
+  {
+    //~~~~~~~~~~~~~~~~~~~~ PRIVATE VARIABLES ~~~~~~~~~~~~~~~~~~~~
+  private:
+    /** A pointer to the pooled queue on which push was called. */
+    SPSCPooledQueue<T> *m_base;
+
+    /** The element that is to be pushed onto the queue (if any). */
+    boost::optional<T> m_elt;
+
+    //~~~~~~~~~~~~~~~~~~~~ CONSTRUCTORS ~~~~~~~~~~~~~~~~~~~~
+  public:
+    /**
+     * \brief Constructs a push handler.
+     *
+     * \param base  A pointer to the pooled queue on which push was called.
+     * \param elt   The element that is to be pushed onto the queue (if any).
+     */
+    PushHandler(SPSCPooledQueue<T> *base, const boost::optional<T>& elt)
+    : m_base(base), m_elt(elt)
+    {}
+
+    //~~~~~~~~~~~~~~~~~~~~ DESTRUCTOR ~~~~~~~~~~~~~~~~~~~~
+  public:
+    /**
+     * \brief Completes the push by pushing the element (if any) onto the queue.
+     */
+    ~PushHandler()
+    {
+      if(m_elt) m_base->end_push(*m_elt);
+    }
+
+    //~~~~~~~~~~~~~~~~~~~~ COPY CONSTRUCTOR & ASSIGNMENT OPERATOR ~~~~~~~~~~~~~~~~~~~~
+  private:
+    // Deliberately private and unimplemented.
+    PushHandler(const PushHandler&);
+    PushHandler& operator=(const PushHandler&);
+
+    //~~~~~~~~~~~~~~~~~~~~ PUBLIC MEMBER FUNCTIONS ~~~~~~~~~~~~~~~~~~~~
+  public:
+    /**
+     * \brief Gets a reference to the element that is to be pushed onto the queue (if any).
+     *
+     * \return  A reference to the element that is to be pushed onto the queue (if any).
+     */
+    boost::optional<T&> get()
+    {
+      return m_elt ? boost::optional<T&>(*m_elt) : boost::none;
+    }
+  };
+
+private:
+  /**
+   * \brief An instance of this struct holds an atomic index that occupies its own cache line, to avoid false sharing between the producer and the consumer.
+   */
+  struct PaddedIndex
+  {
+    boost::atomic<size_t> value;
+    char padding[64 - sizeof(boost::atomic<size_t>)];
+
+    PaddedIndex()
+    : value(0)
+    {}
+  };
+
+  //#################### TYPEDEFS ####################
+public:
+  typedef boost::shared_ptr<PushHandler> PushHandler_Ptr;
+
+  //#################### CONSTANTS ####################
+private:
+  /**
+   * The state of the queue ring is packed into a single 64-bit word so that the producer and consumer can update it atomically:
+   * bits 0-30 store the head (the index of the first element), bit 31 stores whether or not the consumer has claimed the first
+   * element (by peeking at it), and bits 32-62 store the tail (the index one past the last element). Indices wrap modulo 2^31.
+   */
+  static const boost::uint64_t CLAIM_BIT = 1ULL << 31;
+  static const boost::uint64_t INDEX_MASK = (1ULL << 31) - 1;
+
+  /** The number of times a waiting thread polls before parking. */
+  static const int SPIN_COUNT = 1024;
+
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** Whether or not the consumer is parked waiting for the queue to become non-empty. */
+  mutable boost::atomic<bool> m_consumerParked;
+
+  /** The number of elements that have been created so far (only accessed by the producer). */
+  size_t m_eltCount;
+
+  /** A function that can be used to construct new elements (by default, the default constructor for the element type). */
+  boost::function<T()> m_maker;
+
+  /** The maximum number of elements that the queue can hold (the ring buffers will be sized to the next power of two above this). */
+  size_t m_maxCapacity;
+
+  /** The mutex on which threads park when they need to wait. */
+  mutable boost::mutex m_parkMutex;
+
+  /** The ring buffer holding the pool of reusable elements. */
+  std::vector<T> m_pool;
+
+  /** The index of the first element in the pool ring (only written by the producer). */
+  PaddedIndex m_poolHead;
+
+  /** A strategy specifying what should happen when a push is attempted while the pool is empty. */
+  pooled_queue::PoolEmptyStrategy m_poolEmptyStrategy;
+
+  /** A condition variable used to wait for the pool to become non-empty. */
+  boost::condition_variable m_poolNonEmpty;
+
+  /** The index one past the last element in the pool ring (only written by the consumer). */
+  PaddedIndex m_poolTail;
+
+  /** Whether or not the producer is parked waiting for the pool to become non-empty. */
+  boost::atomic<bool> m_producerParked;
+
+  /** The ring buffer holding the queue itself. */
+  std::vector<T> m_queue;
+
+  /** A condition variable used to wait for the queue to become non-empty. */
+  mutable boost::condition_variable m_queueNonEmpty;
+
+  /** The packed state of the queue ring (see CLAIM_BIT). */
+  mutable boost::atomic<boost::uint64_t> m_queueState;
+
+  /** A mask used to map indices to positions in the ring buffers (the ring buffers have a power-of-two size). */
+  size_t m_ringMask;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Constructs a lock-free single-producer/single-consumer pooled queue.
+   *
+   * \param poolEmptyStrategy A strategy specifying what should happen when a push is attempted while the pool is empty.
+   * \param maxCapacity       The maximum number of elements the queue can ever hold (only relevant when using the 'grow' strategy;
+   *                          if this is smaller than the capacity passed to initialise, the latter will be used instead).
+   */
+  explicit SPSCPooledQueue(pooled_queue::PoolEmptyStrategy poolEmptyStrategy = pooled_queue::PES_GROW, size_t maxCapacity = 64)
+  : m_consumerParked(false),
+    m_eltCount(0),
+    m_maxCapacity(maxCapacity),
+    m_poolEmptyStrategy(poolEmptyStrategy),
+    m_producerParked(false),
+    m_queueState(0),
+    m_ringMask(0)
+  {}
+
+  //#################### COPY CONSTRUCTOR & ASSIGNMENT OPERATOR ####################
+private:
+  // Deliberately private and unimplemented.
+  SPSCPooledQueue(const SPSCPooledQueue&);
+  SPSCPooledQueue& operator=(const SPSCPooledQueue&);
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Starts a push operation (see PooledQueue::begin_push for details).
+   *
+   * Note: This must only be called from the producer thread.
+   *
+   * \return  A push handler that will handle the process of pushing an element onto the queue.
+   */
+  PushHandler_Ptr begin_push()
+  {
+    using namespace pooled_queue;
+
+    for(;;)
+    {
+      // If the pool is non-empty, take its first element and return it to the caller for writing.
+      boost::optional<T> elt = try_take_from_pool();
+      if(elt) return PushHandler_Ptr(new PushHandler(this, elt));
+
+      // Otherwise, apply the pool empty strategy.
+      switch(m_poolEmptyStrategy)
+      {
+        case PES_DISCARD:
+        {
+          return PushHandler_Ptr(new PushHandler(this, boost::none));
+        }
+        case PES_GROW:
+        {
+          if(m_eltCount <= m_ringMask)
+          {
+            ++m_eltCount;
+            return PushHandler_Ptr(new PushHandler(this, m_maker()));
+          }
+
+          // If the ring buffers are full, fall back to waiting.
+          wait_for_pool();
+          break;
+        }
+        case PES_REPLACE_RANDOM:
+        {
+          elt = try_take_from_queue();
+          if(elt) return PushHandler_Ptr(new PushHandler(this, elt));
+
+          // If the only element on the queue is in use by the consumer, fall back to waiting.
+          wait_for_pool();
+          break;
+        }
+        case PES_WAIT:
+        {
+          wait_for_pool();
+          break;
+        }
+      }
+    }
+  }
+
+  /**
+   * \brief Gets whether or not the queue is empty.
+   *
+   * \return  true, if the queue is empty, or false otherwise.
+   */
+  bool empty() const
+  {
+    return size() == 0;
+  }
+
+  /**
+   * \brief Initialises the pool backing the queue.
+   *
+   * Note: This must be called before the producer or consumer start to use the queue.
+   *
+   * \param capacity  The initial capacity of the pool (if we're using the 'grow' strategy, this may later change).
+   * \param maker     A function that can be used to construct new elements (by default, the default constructor for the element type).
+   */
+  void initialise(size_t capacity, const boost::function<T()>& maker = boost::value_factory<T>())
+  {
+    size_t ringSize = 1;
+    const size_t requiredSize = std::max(capacity, m_poolEmptyStrategy == pooled_queue::PES_GROW ? m_maxCapacity : capacity);
+    while(ringSize < requiredSize) ringSize <<= 1;
+    if(ringSize > (INDEX_MASK + 1) / 2) throw std::invalid_argument("Error: SPSCPooledQueue capacity is too large");
+
+    m_maker = maker;
+    m_ringMask = ringSize - 1;
+    m_pool.assign(ringSize, T());
+    m_queue.assign(ringSize, T());
+
+    for(size_t i = 0; i < capacity; ++i)
+    {
+      m_pool[i] = maker();
+    }
+
+    m_eltCount = capacity;
+    m_poolHead.value.store(0);
+    m_poolTail.value.store(capacity);
+    m_queueState.store(0);
+  }
+
+  /**
+   * \brief Gets a reference to the first element in the queue.
+   *
+   * Note: This will block until the queue is non-empty. It must only be called from the consumer thread.
+   *
+   * \return  A reference to the first element in the queue.
+   */
+  T& peek()
+  {
+    return m_queue[claim_first() & m_ringMask];
+  }
+
+  /**
+   * \brief Gets a reference to the first element in the queue.
+   *
+   * Note: This will block until the queue is non-empty. It must only be called from the consumer thread.
+   *
+   * \return  A reference to the first element in the queue.
+   */
+  const T& peek() const
+  {
+    return m_queue[claim_first() & m_ringMask];
+  }
+
+  /**
+   * \brief Gets whether or not the pool backing the queue is currently empty.
+   *
+   * Note: This must only be called from the producer thread.
+   *
+   * \return  true, if the pool backing the queue is currently empty, or false otherwise.
+   */
+  bool pool_empty() const
+  {
+    return m_poolHead.value.load(boost::memory_order_relaxed) == m_poolTail.value.load();
+  }
+
+  /**
+   * \brief Pops the first element from the queue and returns it to the pool.
+   *
+   * Note: This will block until the queue is non-empty. It must only be called from the consumer thread.
+   */
+  void pop()
+  {
+    // Claim the first element, so that the producer cannot take it back while we are moving it to the pool.
+    const size_t head = claim_first();
+    const T elt = m_queue[head & m_ringMask];
+
+    // Advance the head and release the claim. The producer may concurrently move the tail, so we need a CAS loop.
+    boost::uint64_t state = m_queueState.load();
+    while(!m_queueState.compare_exchange_weak(state, make_state(head + 1, tail_of(state), false)))
+    {
+      // Retry with the updated state.
+    }
+
+    // Return the element to the pool, and wake the producer if it's waiting for it.
+    const size_t poolTail = m_poolTail.value.load(boost::memory_order_relaxed);
+    m_pool[poolTail & m_ringMask] = elt;
+    m_poolTail.value.store(poolTail + 1);
+    if(m_producerParked.load()) notify(m_poolNonEmpty);
+  }
+
+  /**
+   * \brief Gets the size of the queue.
+   *
+   * \return  The size of the queue.
+   */
+  size_t size() const
+  {
+    const boost::uint64_t state = m_queueState.load();
+    return (tail_of(state) - head_of(state)) & INDEX_MASK;
+  }
+
+  //#################### PRIVATE MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Waits for the queue to be non-empty, and then claims the first element in it on behalf of the consumer.
+   *
+   * \return  The index of the first element in the queue.
+   */
+  size_t claim_first() const
+  {
+    for(;;)
+    {
+      boost::uint64_t state = m_queueState.load();
+      const size_t head = head_of(state), tail = tail_of(state);
+
+      if(head == tail)
+      {
+        wait_for_queue();
+      }
+      else if((state & CLAIM_BIT) || m_queueState.compare_exchange_weak(state, state | CLAIM_BIT))
+      {
+        return head;
+      }
+    }
+  }
+
+  /**
+   * \brief Completes a push operation by pushing the specified element onto the queue.
+   *
+   * \param elt The element to be pushed onto the queue.
+   */
+  void end_push(const T& elt)
+  {
+    // Only the producer ever moves the tail, so we can write the element into the slot just past it before publishing it.
+    boost::uint64_t state = m_queueState.load();
+    const size_t tail = tail_of(state);
+    m_queue[tail & m_ringMask] = elt;
+
+    // Publish the element by advancing the tail. The consumer may concurrently move the head or claim the first element.
+    while(!m_queueState.compare_exchange_weak(state, make_state(head_of(state), tail + 1, (state & CLAIM_BIT) != 0)))
+    {
+      // Retry with the updated state.
+    }
+
+    if(m_consumerParked.load()) notify(m_queueNonEmpty);
+  }
+
+  /**
+   * \brief Notifies any thread parked on the specified condition variable.
+   *
+   * \param cv  The condition variable.
+   */
+  void notify(boost::condition_variable& cv) const
+  {
+    boost::lock_guard<boost::mutex> lock(m_parkMutex);
+    cv.notify_one();
+  }
+
+  /**
+   * \brief Attempts to take the first element from the pool.
+   *
+   * \return  The first element from the pool, if it was non-empty, or boost::none otherwise.
+   */
+  boost::optional<T> try_take_from_pool()
+  {
+    const size_t poolHead = m_poolHead.value.load(boost::memory_order_relaxed);
+    if(poolHead == m_poolTail.value.load()) return boost::none;
+
+    const T elt = m_pool[poolHead & m_ringMask];
+    m_poolHead.value.store(poolHead + 1, boost::memory_order_release);
+    return elt;
+  }
+
+  /**
+   * \brief Attempts to take back the most recently pushed element on the queue that the consumer is not currently using.
+   *
+   * \return  The element, if there was one that could be taken, or boost::none otherwise.
+   */
+  boost::optional<T> try_take_from_queue()
+  {
+    boost::uint64_t state = m_queueState.load();
+    for(;;)
+    {
+      const size_t head = head_of(state), tail = tail_of(state);
+      const size_t size = (tail - head) & INDEX_MASK;
+      const bool claimed = (state & CLAIM_BIT) != 0;
+
+      // If the queue is empty, or its only element has been claimed by the consumer, there is nothing we can take.
+      if(size == 0 || (size == 1 && claimed)) return boost::none;
+
+      // Otherwise, copy the last element (which only the producer ever writes, so this is safe even if we then fail to take it),
+      // and try to retract the tail to remove it from the queue.
+      const T elt = m_queue[(tail - 1) & m_ringMask];
+      if(m_queueState.compare_exchange_weak(state, make_state(head, tail - 1, claimed))) return elt;
+    }
+  }
+
+  /**
+   * \brief Waits (by spinning and then parking) until the pool is non-empty.
+   */
+  void wait_for_pool()
+  {
+    for(int i = 0; i < SPIN_COUNT; ++i)
+    {
+      if(!pool_empty()) return;
+      if(i >= SPIN_COUNT / 2) boost::this_thread::yield();
+    }
+
+    boost::unique_lock<boost::mutex> lock(m_parkMutex);
+    m_producerParked.store(true);
+    while(pool_empty()) m_poolNonEmpty.wait(lock);
+    m_producerParked.store(false);
+  }
+
+  /**
+   * \brief Waits (by spinning and then parking) until the queue is non-empty.
+   */
+  void wait_for_queue() const
+  {
+    for(int i = 0; i < SPIN_COUNT; ++i)
+    {
+      if(!empty()) return;
+      if(i >= SPIN_COUNT / 2) boost::this_thread::yield();
+    }
+
+    boost::unique_lock<boost::mutex> lock(m_parkMutex);
+    m_consumerParked.store(true);
+    while(empty()) m_queueNonEmpty.wait(lock);
+    m_consumerParked.store(false);
+  }
+
+  //#################### PRIVATE STATIC MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Extracts the head index from a packed queue state.
+   */
+  static size_t head_of(boost::uint64_t state)
+  {
+    return static_cast<size_t>(state & INDEX_MASK);
+  }
+
+  /**
+   * \brief Packs a head index, a tail index and a claim flag into a queue state.
+   */
+  static boost::uint64_t make_state(size_t head, size_t tail, bool claimed)
+  {
+    return (static_cast<boost::uint64_t>(tail & INDEX_MASK) << 32) | (claimed ? CLAIM_BIT : 0) | (head & INDEX_MASK);
+  }
+
+  /**
+   * \brief Extracts the tail index from a packed queue state.
+   */
+  static size_t tail_of(boost::uint64_t state)
+  {
+    return static_cast<size_t>((state >> 32) & INDEX_MASK);
+  }
+};
+
+//#################### STATIC CONSTANT DEFINITIONS ####################
+
+template <typename T> const boost::uint64_t SPSCPooledQueue<T>::CLAIM_BIT;
+template <typename T> const boost::uint64_t SPSCPooledQueue<T>::INDEX_MASK;
+template <typename T> const int SPSCPooledQueue<T>::SPIN_COUNT;
+
+}
+
+#endif
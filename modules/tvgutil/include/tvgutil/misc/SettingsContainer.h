@@ -10,9 +10,13 @@
 #include <vector>
 
 #include <boost/shared_ptr.hpp>
+#include <boost/thread/lock_guard.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/weak_ptr.hpp>
 
 #include "../containers/MapUtil.h"
 #include "ConversionUtil.h"
+#include "TypedSetting.h"
 
 namespace tvgutil {
 
@@ -20,6 +24,10 @@ namespace tvgutil {
  * \brief An instance of this class can be used to store named settings for an application.
  *
  * The settings are represented as a key -> [value] map, i.e. there can be multiple values for the same setting.
+ *
+ * Looking up a setting by name involves a map lookup and a string conversion, so code that needs the value of
+ * a setting every frame should instead register a typed setting once (see register_setting) and read that.
+ * To help find per-frame lookups, the container can warn about settings that are repeatedly looked up by name.
  */
 class SettingsContainer
 {
@@ -30,9 +38,28 @@ public:
 
   //#################### PRIVATE VARIABLES ####################
 private:
+  /** The number of times each setting has been looked up by name (only maintained if lookup checking is enabled). */
+  mutable std::map<std::string,size_t> m_lookupCounts;
+
+  /** The number of lookups of a setting by name after which to warn that it should be registered as a typed setting (0 disables the check). */
+  size_t m_lookupWarningThreshold;
+
+  /** The mutex used to synchronise access to the lookup counts and the typed settings (shared between copies of the container). */
+  boost::shared_ptr<boost::mutex> m_mutex;
+
   /** The key -> [value] map storing the values for the settings. */
   std::map<std::string,std::vector<std::string> > m_settings;
 
+  /** The typed settings that have been registered, indexed by the names of their settings. */
+  mutable std::map<std::string,std::vector<boost::weak_ptr<TypedSettingBase> > > m_typedSettings;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Constructs an empty settings container.
+   */
+  SettingsContainer();
+
   //#################### DESTRUCTOR ####################
 public:
   /**
@@ -62,6 +89,7 @@ public:
   template <typename T>
   T get_first_value(const std::string& key) const
   {
+    if(m_lookupWarningThreshold > 0) note_lookup(key);
     const std::vector<std::string>& values = MapUtil::lookup(m_settings, key);
     if(values.empty() || values[0] == NOT_SET) throw std::runtime_error("Value for " + key + " not found in the container");
     return from_string<T>(values[0]);
@@ -80,6 +108,7 @@ public:
   template <typename T>
   T get_first_value(const std::string& key, typename boost::mpl::identity<const T>::type& defaultValue) const
   {
+    if(m_lookupWarningThreshold > 0) note_lookup(key);
     static std::vector<std::string> defaultEmptyVector;
     const std::vector<std::string>& values = MapUtil::lookup(m_settings, key, defaultEmptyVector);
     return values.empty() || values[0] == NOT_SET ? defaultValue : from_string<T>(values[0]);
@@ -96,6 +125,7 @@ public:
   template <typename T>
   std::vector<T> get_values(const std::string& key) const
   {
+    if(m_lookupWarningThreshold > 0) note_lookup(key);
     static std::vector<std::string> defaultEmptyVector;
     const std::vector<std::string>& values = MapUtil::lookup(m_settings, key, defaultEmptyVector);
     if(values.empty() || values[0] == NOT_SET) return std::vector<T>();
@@ -116,6 +146,67 @@ public:
    */
   bool has_values(const std::string& key) const;
 
+  /**
+   * \brief Registers a typed setting whose value will be kept in sync with the first value of the specified setting.
+   *
+   * The value is parsed immediately, and again whenever the setting is changed via add_value or set_value.
+   *
+   * \param key           The name of the setting.
+   * \param defaultValue  The value to use if the setting is not set.
+   * \return              The typed setting.
+   *
+   * \throws boost::bad_lexical_cast  If the setting exists but its first value cannot be converted to the specified type.
+   */
+  template <typename T>
+  boost::shared_ptr<TypedSetting<T> > register_setting(const std::string& key, typename boost::mpl::identity<const T>::type& defaultValue) const
+  {
+    boost::shared_ptr<TypedSetting<T> > setting(new TypedSetting<T>(defaultValue));
+    setting->update(get_first_raw_value(key));
+
+    boost::lock_guard<boost::mutex> lock(*m_mutex);
+    m_typedSettings[key].push_back(setting);
+    return setting;
+  }
+
+  /**
+   * \brief Sets the number of times a setting can be looked up by name before a warning is printed suggesting that it be registered as a typed setting.
+   *
+   * \param lookupWarningThreshold  The threshold (0 disables the check).
+   */
+  void set_lookup_warning_threshold(size_t lookupWarningThreshold);
+
+  /**
+   * \brief Replaces any existing values for the specified setting with a single value, and updates any typed settings registered for it.
+   *
+   * \param key   The name of the setting.
+   * \param value The new value for the setting.
+   */
+  void set_value(const std::string& key, const std::string& value);
+
+  //#################### PRIVATE MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Gets the first (string) value associated with the specified setting, if any.
+   *
+   * \param key The name of the setting.
+   * \return    A pointer to the first value associated with the setting, or NULL if the setting is not set.
+   */
+  const std::string *get_first_raw_value(const std::string& key) const;
+
+  /**
+   * \brief Records that the specified setting has been looked up by name, and warns if it has been looked up too many times.
+   *
+   * \param key The name of the setting.
+   */
+  void note_lookup(const std::string& key) const;
+
+  /**
+   * \brief Updates any typed settings that have been registered for the specified setting.
+   *
+   * \param key The name of the setting.
+   */
+  void update_typed_settings(const std::string& key);
+
   //#################### STREAM OPERATORS ####################
 public:
   /**
@@ -0,0 +1,198 @@
+/**
+ * tvgutil: TaskGroup.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#ifndef H_TVGUTIL_TASKGROUP
+#define H_TVGUTIL_TASKGROUP
+
+#include <algorithm>
+#include <deque>
+#include <string>
+
+#include <boost/bind.hpp>
+#include <boost/ref.hpp>
+#include <boost/thread.hpp>
+
+#include "ThreadPool.h"
+
+namespace tvgutil {
+
+/**
+ * \brief An instance of this class can be used to run a group of tasks on a thread pool and wait for them all to finish.
+ */
+class TaskGroup
+{
+  //#################### NESTED TYPES ####################
+private:
+  /**
+   * \brief An instance of this struct holds the tasks in a group that have not yet been started.
+   *
+   * Each task added to the group is posted to the pool as a "ticket" that runs the next task from the queue (if any).
+   * The queue is shared with the tickets, since a ticket can still be in the pool after the group has been destroyed
+   * (if a thread that waited for the group ran the ticket's task itself).
+   */
+  struct TaskQueue
+  {
+    /** The synchronisation mutex. */
+    boost::mutex mutex;
+
+    /** The tasks that have not yet been started. */
+    std::deque<ThreadPool::Task> tasks;
+  };
+
+  typedef boost::shared_ptr<TaskQueue> TaskQueue_Ptr;
+
+  //#################### PRIVATE MEMBER VARIABLES ####################
+private:
+  /** The error message from the first task in the group that threw (if any). */
+  std::string m_error;
+
+  /** The synchronisation mutex. */
+  boost::mutex m_mutex;
+
+  /** The number of tasks in the group that have not yet finished. */
+  size_t m_pendingTaskCount;
+
+  /** The thread pool on which to run the tasks. */
+  ThreadPool& m_pool;
+
+  /** The tasks in the group that have not yet been started. */
+  TaskQueue_Ptr m_queuedTasks;
+
+  /** A condition variable used to wait for the tasks in the group to finish (it is also notified whenever a task is added to the group). */
+  boost::condition_variable m_tasksFinished;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Constructs a task group.
+   *
+   * \param pool  The thread pool on which to run the tasks.
+   */
+  explicit TaskGroup(ThreadPool& pool = ThreadPool::instance());
+
+  //#################### DESTRUCTOR ####################
+public:
+  /**
+   * \brief Destroys the task group, waiting for any of its tasks that have not yet finished.
+   */
+  ~TaskGroup();
+
+  //#################### COPY CONSTRUCTOR & ASSIGNMENT OPERATOR ####################
+private:
+  // Deliberately private and unimplemented.
+  TaskGroup(const TaskGroup&);
+  TaskGroup& operator=(const TaskGroup&);
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Runs a task as part of the group.
+   *
+   * \param task  The task to run.
+   */
+  template <typename F>
+  void run(F task)
+  {
+    {
+      boost::lock_guard<boost::mutex> lock(m_mutex);
+      ++m_pendingTaskCount;
+
+      boost::lock_guard<boost::mutex> queueLock(m_queuedTasks->mutex);
+      m_queuedTasks->tasks.push_back(boost::bind(&TaskGroup::run_task, this, ThreadPool::Task(task)));
+    }
+
+    // Wake any thread that is waiting for the group, so that it can help to run the new task.
+    m_tasksFinished.notify_all();
+
+    m_pool.enqueue_task(boost::bind(&TaskGroup::run_queued_task, m_queuedTasks));
+  }
+
+  /**
+   * \brief Waits for all of the tasks in the group to finish, helping to run the group's own tasks in the meantime.
+   *
+   * \note  Only tasks belonging to the group are run by the waiting thread, so that it cannot be stalled by an unrelated
+   *        (and potentially long-running) task that happens to be pending in the pool.
+   *
+   * \throws std::runtime_error If any of the tasks in the group threw.
+   */
+  void wait();
+
+  //#################### PRIVATE STATIC MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Runs the next task from a group's queue of tasks that have not yet been started (if any).
+   *
+   * \param queue The queue.
+   * \return      true, if a task was run, or false otherwise.
+   */
+  static bool run_queued_task(const TaskQueue_Ptr& queue);
+
+  //#################### PRIVATE MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Gets whether or not the group has any tasks that have not yet been started.
+   *
+   * \return  true, if the group has any tasks that have not yet been started, or false otherwise.
+   */
+  bool has_queued_tasks() const;
+
+  /**
+   * \brief Runs one of the group's tasks, recording any error and notifying any waiters if it is the last to finish.
+   *
+   * \param task  The task.
+   */
+  void run_task(const ThreadPool::Task& task);
+
+  /**
+   * \brief Waits for all of the tasks in the group to finish, without throwing if any of them threw.
+   */
+  void wait_for_tasks();
+};
+
+//#################### HELPER FUNCTIONS ####################
+
+/**
+ * \brief Calls a function for each index in a subrange.
+ *
+ * \param body  The function.
+ * \param begin The start of the subrange.
+ * \param end   The end of the subrange (exclusive).
+ */
+template <typename Body>
+void run_parallel_for_chunk(const Body& body, size_t begin, size_t end)
+{
+  for(size_t i = begin; i < end; ++i) body(i);
+}
+
+//#################### TEMPLATED MEMBER FUNCTIONS ####################
+
+template <typename Body>
+void ThreadPool::parallel_for(size_t begin, size_t end, const Body& body, size_t grainSize)
+{
+  if(begin >= end) return;
+
+  // If no grain size was specified, aim for a few chunks per thread, so that stealing can even out any imbalance.
+  const size_t count = end - begin;
+  if(grainSize == 0) grainSize = std::max<size_t>(1, count / (4 * get_thread_count()));
+
+  // If the range fits into a single chunk, just run it on the current thread.
+  if(count <= grainSize)
+  {
+    run_parallel_for_chunk(body, begin, end);
+    return;
+  }
+
+  TaskGroup group(*this);
+  for(size_t chunkBegin = begin; chunkBegin < end; chunkBegin += grainSize)
+  {
+    const size_t chunkEnd = std::min(chunkBegin + grainSize, end);
+    group.run(boost::bind(&run_parallel_for_chunk<Body>, boost::cref(body), chunkBegin, chunkEnd));
+  }
+  group.wait();
+}
+
+}
+
+#endif
@@ -6,46 +6,98 @@
 #ifndef H_TVGUTIL_THREADPOOL
 #define H_TVGUTIL_THREADPOOL
 
-#include <string>
+#include <deque>
+#include <vector>
 
+#include <boost/atomic.hpp>
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
 #include <boost/shared_ptr.hpp>
 #include <boost/thread.hpp>
-
-#include "../boost/WrappedAsio.h"
+#include <boost/thread/future.hpp>
+#include <boost/thread/tss.hpp>
+#include <boost/utility/result_of.hpp>
 
 namespace tvgutil {
 
 /**
  * \brief An instance of this class represents a pool of threads that can be used to asynchronously execute arbitrary tasks.
+ *
+ * Each worker thread has its own deque of tasks. Tasks posted from a worker go onto the back of that worker's deque
+ * and are taken from the back again (so that recently-spawned, cache-warm tasks run first), whilst tasks posted from
+ * other threads are distributed round-robin across the workers. A worker whose deque is empty steals from the front
+ * of the other workers' deques, so load is balanced without all of the threads contending for a single queue.
  */
 class ThreadPool
 {
+  //#################### FRIENDS ####################
+
+  friend class TaskGroup;
+
+  //#################### TYPEDEFS ####################
+public:
+  typedef boost::function<void()> Task;
+
+  //#################### NESTED TYPES ####################
+private:
+  /**
+   * \brief An instance of this struct holds the tasks that have been queued for a worker thread.
+   */
+  struct Worker
+  {
+    /** The synchronisation mutex. */
+    boost::mutex mutex;
+
+    /** The tasks that have been queued for the worker. */
+    std::deque<Task> tasks;
+  };
+
+  typedef boost::shared_ptr<Worker> Worker_Ptr;
+
   //#################### PRIVATE MEMBER VARIABLES ####################
 private:
-  /** An I/O service used to schedule work for the threads. */
-  boost::asio::io_service m_scheduler;
+  /** The index of the worker to which the next task posted from outside the pool should be given. */
+  boost::atomic<size_t> m_nextWorker;
+
+  /** The number of tasks that have been posted but not yet started. */
+  boost::atomic<size_t> m_pendingTaskCount;
+
+  /** A flag set in the destructor to indicate that the worker threads should terminate once all of the pending tasks have been run. */
+  bool m_shouldTerminate;
+
+  /** The number of worker threads that are currently waiting for tasks. */
+  boost::atomic<size_t> m_sleepingWorkerCount;
+
+  /** A condition variable used to wake the worker threads when tasks are posted. */
+  boost::condition_variable m_taskAvailable;
 
   /** The threads in the pool. */
   boost::thread_group m_threads;
 
-  /** A worker variable used to keep the scheduler running until we want it to stop. */
-  boost::shared_ptr<boost::asio::io_service::work> m_worker;
+  /** The mutex used when worker threads go to sleep or are woken. */
+  boost::mutex m_wakeMutex;
+
+  /** The index of the worker associated with the current thread (if the current thread is one of the pool's worker threads). */
+  boost::thread_specific_ptr<size_t> m_workerIndex;
+
+  /** The workers. */
+  std::vector<Worker_Ptr> m_workers;
 
   //#################### CONSTRUCTORS ####################
 public:
   /**
    * \brief Constructs a thread pool.
    *
-   * \param numThreads  The number of threads that should be in the pool.
+   * \param numThreads  The number of threads that should be in the pool (0 means one per hardware thread).
    */
-  explicit ThreadPool(size_t numThreads = 20);
+  explicit ThreadPool(size_t numThreads = 0);
 
   //#################### DESTRUCTOR ####################
 public:
   /**
    * \brief Destroys the thread pool.
    *
-   * \note  Since all threads in the pool are joined, this can block.
+   * \note  Any tasks that have already been posted will be run first. Since all threads in the pool are joined, this can block.
    */
   ~ThreadPool();
 
@@ -68,18 +120,106 @@ public:
 
   //#################### PUBLIC MEMBER FUNCTIONS ####################
 public:
+  /**
+   * \brief Gets the number of threads in the pool.
+   *
+   * \return  The number of threads in the pool.
+   */
+  size_t get_thread_count() const;
+
+  /**
+   * \brief Calls a function for each index in a range, distributing the work across the pool.
+   *
+   * The range is split into chunks, each of which is run as a task. The calling thread helps to run
+   * tasks until all of the chunks have finished, so it is safe to call this from within a task.
+   *
+   * \param begin       The start of the range.
+   * \param end         The end of the range (exclusive).
+   * \param body        The function to call for each index (it must be safe to call concurrently).
+   * \param grainSize   The number of indices in each chunk (0 means choose automatically).
+   *
+   * \throws std::runtime_error If the function throws for any index.
+   */
+  template <typename Body>
+  void parallel_for(size_t begin, size_t end, const Body& body, size_t grainSize = 0);
+
   /**
    * \brief Posts a task to be executed by the thread pool.
    *
+   * \note  If the task throws, a warning is printed and the exception is otherwise ignored.
+   *
    * \param task  The task to execute.
    */
-  template <typename Task>
-  void post_task(Task task)
+  template <typename F>
+  void post_task(F task)
+  {
+    enqueue_task(Task(task));
+  }
+
+  /**
+   * \brief Submits a task to be executed by the thread pool, and returns a future that will hold its result.
+   *
+   * \param f The task to execute (this must be callable with no arguments).
+   * \return  A future that will hold the result of the task (or any exception that it throws).
+   */
+  template <typename F>
+  boost::shared_future<typename boost::result_of<F()>::type> submit(F f)
+  {
+    typedef typename boost::result_of<F()>::type R;
+    boost::shared_ptr<boost::packaged_task<R> > task(new boost::packaged_task<R>(f));
+    boost::shared_future<R> future(task->get_future());
+    enqueue_task(boost::bind(&ThreadPool::run_packaged_task<R>, task));
+    return future;
+  }
+
+  //#################### PRIVATE MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Adds a task to the deque of one of the workers, and wakes a sleeping worker if necessary.
+   *
+   * \param task  The task.
+   */
+  void enqueue_task(const Task& task);
+
+  /**
+   * \brief Runs a worker thread.
+   *
+   * \param workerIndex The index of the worker.
+   */
+  void run_worker(size_t workerIndex);
+
+  /**
+   * \brief Attempts to take a pending task from the pool, preferring the current thread's own deque (if it is a worker thread).
+   *
+   * \param task  A place in which to store the task (if one was found).
+   * \return      true, if a task was found, or false otherwise.
+   */
+  bool try_take_task(Task& task);
+
+  //#################### PRIVATE STATIC MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Runs a task, printing a warning if it throws.
+   *
+   * \param task  The task.
+   */
+  static void run_task(const Task& task);
+
+  /**
+   * \brief Runs a packaged task (this is needed since packaged_task::operator() cannot portably be bound directly).
+   *
+   * \param task  The packaged task.
+   */
+  template <typename R>
+  static void run_packaged_task(const boost::shared_ptr<boost::packaged_task<R> >& task)
   {
-    m_scheduler.post(task);
+    (*task)();
   }
 };
 
 }
 
+// Note: TaskGroup.h contains the definition of ThreadPool::parallel_for, which needs TaskGroup to be complete.
+#include "TaskGroup.h"
+
 #endif
@@ -0,0 +1,127 @@
+/**
+ * tvgutil: TypedSetting.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#ifndef H_TVGUTIL_TYPEDSETTING
+#define H_TVGUTIL_TYPEDSETTING
+
+#include <string>
+#include <vector>
+
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include "ConversionUtil.h"
+
+namespace tvgutil {
+
+/**
+ * \brief An instance of a class deriving from this one holds the parsed value of a setting in a settings container.
+ */
+class TypedSettingBase
+{
+  //#################### DESTRUCTOR ####################
+public:
+  /**
+   * \brief Destroys the typed setting.
+   */
+  virtual ~TypedSettingBase() {}
+
+  //#################### PUBLIC ABSTRACT MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Updates the typed setting when the value of the underlying setting changes.
+   *
+   * \param value The new (string) value of the setting, or NULL if the setting is no longer set.
+   *
+   * \throws boost::bad_lexical_cast  If the value cannot be converted to the type of the setting.
+   */
+  virtual void update(const std::string *value) = 0;
+};
+
+/**
+ * \brief An instance of an instantiation of this class template holds the parsed value of a setting in a settings container.
+ *
+ * Typed settings are obtained via SettingsContainer::register_setting. The value is parsed once on registration (and again
+ * whenever the setting is changed via the container), so reading it is just a member access, which makes typed settings
+ * suitable for use in code that runs every frame. Listeners can be added to respond to changes (e.g. for live tuning).
+ */
+template <typename T>
+class TypedSetting : public TypedSettingBase
+{
+  //#################### TYPEDEFS ####################
+public:
+  typedef boost::function<void(const T&)> Listener;
+
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** The value to use if the setting is not set. */
+  T m_defaultValue;
+
+  /** The functions to call whenever the value of the setting changes. */
+  std::vector<Listener> m_listeners;
+
+  /** The current value of the setting. */
+  T m_value;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Constructs a typed setting.
+   *
+   * \param defaultValue  The value to use if the setting is not set.
+   */
+  explicit TypedSetting(const T& defaultValue)
+  : m_defaultValue(defaultValue), m_value(defaultValue)
+  {}
+
+  //#################### PUBLIC OPERATORS ####################
+public:
+  /**
+   * \brief Gets the current value of the setting.
+   *
+   * \return  The current value of the setting.
+   */
+  const T& operator*() const
+  {
+    return m_value;
+  }
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Adds a function to call whenever the value of the setting changes.
+   *
+   * \param listener  The function to call.
+   */
+  void add_listener(const Listener& listener)
+  {
+    m_listeners.push_back(listener);
+  }
+
+  /**
+   * \brief Gets the current value of the setting.
+   *
+   * \return  The current value of the setting.
+   */
+  const T& get() const
+  {
+    return m_value;
+  }
+
+  /** Override */
+  virtual void update(const std::string *value)
+  {
+    m_value = value ? from_string<T>(*value) : m_defaultValue;
+
+    for(size_t i = 0, size = m_listeners.size(); i < size; ++i)
+    {
+      m_listeners[i](m_value);
+    }
+  }
+};
+
+}
+
+#endif
@@ -7,6 +7,7 @@
 #define H_TVGUTIL_CLIENTHANDLER
 
 #include <boost/atomic.hpp>
+#include <boost/function.hpp>
 #include <boost/optional.hpp>
 #include <boost/thread.hpp>
 
@@ -19,6 +20,11 @@ namespace tvgutil {
  */
 class ClientHandler
 {
+  //#################### TYPEDEFS ####################
+public:
+  /** A function that should be called when an asynchronous operation finishes. */
+  typedef boost::function<void()> Continuation;
+
   //#################### PUBLIC VARIABLES ####################
 public:
   /** The ID used by the server to refer to the client. */
@@ -33,9 +39,12 @@ public:
   /** The socket used to communicate with the client. */
   boost::shared_ptr<boost::asio::ip::tcp::socket> m_sock;
 
-  /** The thread that manages communication with the client. */
+  /** The thread that manages communication with the client (if the client is not being multiplexed on the server's I/O thread pool). */
   boost::shared_ptr<boost::thread> m_thread;
 
+  /** A timer that can be used to defer asynchronous work (only set if the client is being multiplexed on the server's I/O thread pool). */
+  boost::shared_ptr<boost::asio::deadline_timer> m_timer;
+
   //#################### CONSTRUCTORS ####################
 public:
   /**
@@ -68,6 +77,17 @@ public:
    */
   virtual void run_iter();
 
+  /**
+   * \brief Asynchronously runs an iteration of the main loop for the client.
+   *
+   * This will only be called if supports_async returns true. It must not block: instead, it should start a chain
+   * of asynchronous operations that calls the specified continuation exactly once when the iteration finishes,
+   * successfully or otherwise (on failure, m_connectionOk should be set to false beforehand).
+   *
+   * \param done  The continuation to call when the iteration finishes.
+   */
+  virtual void run_iter_async(const Continuation& done);
+
   /**
    * \brief Runs any code that should happen after the main loop for the client.
    */
@@ -78,6 +98,25 @@ public:
    */
   virtual void run_pre();
 
+  /**
+   * \brief Asynchronously runs any code that should happen before the main loop for the client.
+   *
+   * This will only be called if supports_async returns true. The same rules apply as for run_iter_async.
+   *
+   * \param done  The continuation to call when the pre-loop code finishes.
+   */
+  virtual void run_pre_async(const Continuation& done);
+
+  /**
+   * \brief Gets whether or not the handler supports asynchronous operation.
+   *
+   * Handlers that support asynchronous operation can be multiplexed with other clients on a server's I/O thread pool,
+   * rather than needing a dedicated thread of their own.
+   *
+   * \return  true, if the handler supports asynchronous operation, or false otherwise.
+   */
+  virtual bool supports_async() const;
+
   //#################### PROTECTED MEMBER FUNCTIONS ####################
 protected:
   /**
@@ -97,6 +136,22 @@ protected:
     return *m_shouldTerminate ? false : !*err;
   }
 
+  /**
+   * \brief Starts an asynchronous read of a message of type T from the socket used to communicate with the client.
+   *
+   * This returns immediately. If the read later succeeds, next will be called; if not, m_connectionOk will be set
+   * to false and done will be called instead. The message must remain alive until the read has finished.
+   *
+   * \param msg   The T into which to write the message.
+   * \param next  The continuation to call if the read succeeds.
+   * \param done  The continuation to call if the read fails.
+   */
+  template <typename T>
+  void read_message_async(T& msg, const Continuation& next, const Continuation& done)
+  {
+    boost::asio::async_read(*m_sock, boost::asio::buffer(msg.get_data_ptr(), msg.get_size()), boost::bind(&ClientHandler::async_message_handler, this, _1, next, done));
+  }
+
   /**
    * \brief Attempts to write a message of type T on the socket used to communicate with the client.
    *
@@ -114,8 +169,33 @@ protected:
     return *m_shouldTerminate ? false : !*err;
   }
 
+  /**
+   * \brief Starts an asynchronous write of a message of type T on the socket used to communicate with the client.
+   *
+   * This returns immediately. If the write later succeeds, next will be called; if not, m_connectionOk will be set
+   * to false and done will be called instead. The message must remain alive until the write has finished.
+   *
+   * \param msg   The T to write.
+   * \param next  The continuation to call if the write succeeds.
+   * \param done  The continuation to call if the write fails.
+   */
+  template <typename T>
+  void write_message_async(const T& msg, const Continuation& next, const Continuation& done)
+  {
+    boost::asio::async_write(*m_sock, boost::asio::buffer(msg.get_data_ptr(), msg.get_size()), boost::bind(&ClientHandler::async_message_handler, this, _1, next, done));
+  }
+
   //#################### PRIVATE MEMBER FUNCTIONS ####################
 private:
+  /**
+   * \brief The handler called when an asynchronous read or write started by read_message_async or write_message_async finishes.
+   *
+   * \param err   The error code associated with the read or write.
+   * \param next  The continuation to call if the read or write succeeded.
+   * \param done  The continuation to call if the read or write failed (or if the server is terminating).
+   */
+  void async_message_handler(const boost::system::error_code& err, const Continuation& next, const Continuation& done);
+
   /**
    * \brief The handler called when an asynchronous read of a message finishes.
    *
@@ -68,6 +68,12 @@ private:
   /** The server's I/O service. */
   boost::asio::io_service m_ioService;
 
+  /** The number of threads in the I/O thread pool (if zero, each client gets its own thread instead). */
+  size_t m_ioThreadCount;
+
+  /** The I/O thread pool on which the clients are multiplexed (if the server is running in pooled mode). */
+  boost::thread_group m_ioThreads;
+
   /** The mode in which the server should run. */
   Mode m_mode;
 
@@ -86,6 +92,9 @@ private:
   /** Whether or not the server should terminate. */
   boost::shared_ptr<boost::atomic<bool> > m_shouldTerminate;
 
+  /** The handlers for the asynchronous clients that have been accepted, but whose pre-loop code has not yet finished. */
+  std::map<int, ClientHandler_Ptr> m_startingClientHandlers;
+
   /** The set of clients that have finished but whose handlers have not yet been removed from the client handlers map. */
   std::set<int> m_uncleanClients;
 
@@ -97,11 +106,18 @@ public:
   /**
    * \brief Constructs a server.
    *
-   * \param mode  The mode in which the server should run.
-   * \param port  The port on which the server should listen for connections.
+   * If ioThreadCount is zero, the server will spawn a dedicated thread for each client that connects. Otherwise,
+   * it will run in pooled mode, in which all clients whose handlers support asynchronous operation are multiplexed
+   * on a fixed-size pool of I/O threads. (Clients whose handlers do not support asynchronous operation will still
+   * get a dedicated thread in pooled mode.)
+   *
+   * \param mode          The mode in which the server should run.
+   * \param port          The port on which the server should listen for connections.
+   * \param ioThreadCount The number of threads in the I/O thread pool (if zero, each client gets its own thread instead).
    */
-  explicit Server(Mode mode = SM_MULTI_CLIENT, int port = 7851)
-  : m_mode(mode),
+  explicit Server(Mode mode = SM_MULTI_CLIENT, int port = 7851, size_t ioThreadCount = 0)
+  : m_ioThreadCount(ioThreadCount),
+    m_mode(mode),
     m_nextClientID(0),
     m_port(port),
     m_shouldTerminate(new boost::atomic<bool>(false)),
@@ -162,7 +178,8 @@ public:
    */
   void start()
   {
-    m_serverThread.reset(new boost::thread(boost::bind(&Server::run_server, this)));
+    if(m_ioThreadCount > 0) start_pooled();
+    else m_serverThread.reset(new boost::thread(boost::bind(&Server::run_server, this)));
   }
 
   /**
@@ -174,6 +191,40 @@ public:
 
     if(m_serverThread) m_serverThread->join();
 
+    if(m_ioThreadCount > 0)
+    {
+      // Stop the I/O service and wait for the I/O threads to finish. Any asynchronous operations
+      // that are still pending at this point will simply be abandoned.
+      m_ioService.stop();
+      m_ioThreads.join_all();
+
+      // Finish any asynchronous clients that had not yet finished (whether they were still running their pre-loop
+      // code or had reached their main loop), so that their resources are released and the cleaner thread can remove them.
+      std::vector<ClientHandler_Ptr> unfinishedClientHandlers;
+      {
+        boost::lock_guard<boost::mutex> lock(m_mutex);
+        for(typename std::map<int, ClientHandler_Ptr>::const_iterator it = m_clientHandlers.begin(), iend = m_clientHandlers.end(); it != iend; ++it)
+        {
+          if(!it->second->m_thread && m_finishedClients.find(it->first) == m_finishedClients.end())
+          {
+            unfinishedClientHandlers.push_back(it->second);
+          }
+        }
+
+        for(typename std::map<int, ClientHandler_Ptr>::const_iterator it = m_startingClientHandlers.begin(), iend = m_startingClientHandlers.end(); it != iend; ++it)
+        {
+          unfinishedClientHandlers.push_back(it->second);
+        }
+
+        m_startingClientHandlers.clear();
+      }
+
+      for(size_t i = 0, size = unfinishedClientHandlers.size(); i < size; ++i)
+      {
+        finish_client(unfinishedClientHandlers[i]);
+      }
+    }
+
     if(m_cleanerThread)
     {
       // Make sure that the cleaner thread can terminate when there are no clients remaining to wake it up.
@@ -221,9 +272,8 @@ private:
   void accept_client()
   {
     // FIXME: It would be better to have accept_client_handler call accept_client after accepting a connection.
-    //        This would allow us to get rid of the sleep loop.
-    boost::shared_ptr<tcp::socket> sock(new tcp::socket(m_ioService));
-    m_acceptor->async_accept(*sock, boost::bind(&Server::accept_client_handler, this, sock, _1));
+    //        This would allow us to get rid of the sleep loop. (Pooled mode already works this way.)
+    begin_accept_client();
     while(!*m_shouldTerminate && m_ioService.poll() == 0)
     {
       boost::this_thread::sleep_for(boost::chrono::milliseconds(5));
@@ -238,6 +288,12 @@ private:
    */
   void accept_client_handler(const boost::shared_ptr<boost::asio::ip::tcp::socket>& sock, const boost::system::error_code& err)
   {
+    // If we're running in pooled mode, start listening for the next client straight away (unless the server is terminating).
+    if(m_ioThreadCount > 0 && !*m_shouldTerminate && err != boost::asio::error::operation_aborted)
+    {
+      begin_accept_client();
+    }
+
     // If an error occurred, early out.
     if(err) return;
 
@@ -249,15 +305,53 @@ private:
       return;
     }
 
-    // If a client successfully connects, start a thread for it.
+    // If a client successfully connects, either start it on the I/O thread pool (if we're running in pooled mode and
+    // the client's handler supports asynchronous operation), or start a dedicated thread for it.
     std::cout << "Accepted client connection" << std::endl;
     boost::lock_guard<boost::mutex> lock(m_mutex);
     ClientHandler_Ptr clientHandler(new ClientHandlerType(m_nextClientID, sock, m_shouldTerminate));
-    boost::shared_ptr<boost::thread> clientThread(new boost::thread(boost::bind(&Server::handle_client, this, clientHandler)));
-    clientHandler->m_thread = clientThread;
+    if(m_ioThreadCount > 0 && clientHandler->supports_async())
+    {
+      clientHandler->m_timer.reset(new boost::asio::deadline_timer(m_ioService));
+      m_startingClientHandlers.insert(std::make_pair(m_nextClientID, clientHandler));
+      m_ioService.post(boost::bind(&Server::handle_client_async, this, clientHandler));
+    }
+    else
+    {
+      boost::shared_ptr<boost::thread> clientThread(new boost::thread(boost::bind(&Server::handle_client, this, clientHandler)));
+      clientHandler->m_thread = clientThread;
+    }
     ++m_nextClientID;
   }
 
+  /**
+   * \brief Starts an asynchronous accept that will call accept_client_handler when a client connects.
+   */
+  void begin_accept_client()
+  {
+    boost::shared_ptr<tcp::socket> sock(new tcp::socket(m_ioService));
+    m_acceptor->async_accept(*sock, boost::bind(&Server::accept_client_handler, this, sock, _1));
+  }
+
+  /**
+   * \brief Runs any code that should happen after the main loop for a client, and marks the client as finished.
+   *
+   * \param clientHandler The handler for the client.
+   */
+  void finish_client(const ClientHandler_Ptr& clientHandler)
+  {
+    // Run the post-loop code for the client.
+    clientHandler->run_post();
+
+    // Once the client's finished, add it to the finished clients set so that it can be cleaned up.
+    const int clientID = clientHandler->get_client_id();
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+    std::cout << "Stopping client: " << clientID << '\n';
+    m_finishedClients.insert(clientID);
+    m_uncleanClients.insert(clientID);
+    m_clientsHaveFinished.notify_one();
+  }
+
   /**
    * \brief Handles messages from a client.
    *
@@ -289,17 +383,21 @@ private:
       clientHandler->run_iter();
     }
 
-    // Run the post-loop code for the client.
-    clientHandler->run_post();
+    // Run the post-loop code for the client and mark it as finished.
+    finish_client(clientHandler);
+  }
 
-    // Once the client's finished, add it to the finished clients set so that it can be cleaned up.
-    {
-      boost::lock_guard<boost::mutex> lock(m_mutex);
-      std::cout << "Stopping client: " << clientID << '\n';
-      m_finishedClients.insert(clientID);
-      m_uncleanClients.insert(clientID);
-      m_clientsHaveFinished.notify_one();
-    }
+  /**
+   * \brief Starts handling messages from a client asynchronously on the I/O thread pool.
+   *
+   * \param clientHandler   The handler for the client.
+   */
+  void handle_client_async(const ClientHandler_Ptr& clientHandler)
+  {
+    std::cout << "Starting client: " << clientHandler->get_client_id() << '\n';
+
+    // Asynchronously run the pre-loop code for the client. When it finishes, start the client's main loop.
+    clientHandler->run_pre_async(boost::bind(&Server::start_client_loop_async, this, clientHandler));
   }
 
   /**
@@ -336,6 +434,31 @@ private:
 #endif
   }
 
+  /**
+   * \brief Asynchronously runs the next iteration of the main loop for a client.
+   *
+   * The iteration's continuation calls this function again, so in effect this asynchronously loops until either
+   * (a) the connection drops, or (b) the server itself is terminating, at which point the client is finished.
+   *
+   * \param clientHandler   The handler for the client.
+   */
+  void run_client_iter_async(const ClientHandler_Ptr& clientHandler)
+  {
+    if(clientHandler->m_connectionOk && !*m_shouldTerminate)
+    {
+      clientHandler->run_iter_async(boost::bind(&Server::run_client_iter_async, this, clientHandler));
+    }
+    else finish_client(clientHandler);
+  }
+
+  /**
+   * \brief Runs the I/O service on one of the threads in the I/O thread pool.
+   */
+  void run_io_thread()
+  {
+    m_ioService.run();
+  }
+
   /**
    * \brief Runs the server.
    */
@@ -359,6 +482,52 @@ private:
     std::cout << "Server thread terminating" << std::endl;
 #endif
   }
+
+  /**
+   * \brief Makes an asynchronous client active once its pre-loop code has finished, and then starts its main loop.
+   *
+   * \param clientHandler   The handler for the client.
+   */
+  void start_client_loop_async(const ClientHandler_Ptr& clientHandler)
+  {
+    // Move the client handler to the map of handlers for active clients.
+    {
+      boost::lock_guard<boost::mutex> lock(m_mutex);
+      m_startingClientHandlers.erase(clientHandler->get_client_id());
+      m_clientHandlers.insert(std::make_pair(clientHandler->get_client_id(), clientHandler));
+    }
+
+    // Signal to other threads that the client is ready.
+    m_clientReady.notify_one();
+
+    // Start the main loop for the client.
+    run_client_iter_async(clientHandler);
+  }
+
+  /**
+   * \brief Starts the server in pooled mode.
+   *
+   * In pooled mode, there is no dedicated server thread: the accepting of clients and all asynchronous client
+   * interactions are driven by the threads in the I/O thread pool.
+   */
+  void start_pooled()
+  {
+    // Spawn a thread to keep the map of clients clean by removing any clients that have terminated.
+    m_cleanerThread.reset(new boost::thread(&Server::run_cleaner, this));
+
+    // Set up the TCP acceptor and start listening for connections.
+    tcp::endpoint endpoint(tcp::v4(), m_port);
+    m_acceptor.reset(new tcp::acceptor(m_ioService, endpoint));
+    begin_accept_client();
+
+    std::cout << "Listening for connections (using " << m_ioThreadCount << " I/O threads)...\n";
+
+    // Start the I/O thread pool.
+    for(size_t i = 0; i < m_ioThreadCount; ++i)
+    {
+      m_ioThreads.create_thread(boost::bind(&Server::run_io_thread, this));
+    }
+  }
 };
 
 }
@@ -0,0 +1,192 @@
+/**
+ * tvgutil: SharedMemoryMessageRing.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#ifndef H_TVGUTIL_SHAREDMEMORYMESSAGERING
+#define H_TVGUTIL_SHAREDMEMORYMESSAGERING
+
+#include <string>
+
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/interprocess/shared_memory_object.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include "Message.h"
+
+namespace tvgutil {
+
+/**
+ * \brief An instance of this class represents a ring of fixed-size message slots in a named shared memory segment,
+ *        which can be used to pass messages from a single writer process to a single reader process on the same machine.
+ *
+ * The ring is created by the writer and opened by the reader. The two processes signal each other via a pair of process-shared
+ * semaphores stored in the segment (on Linux, these are futex-based, so a process that waits for a slot sleeps in the kernel
+ * rather than spinning). Messages are copied into and out of the slots without any further encoding.
+ */
+class SharedMemoryMessageRing
+{
+  //#################### NESTED TYPES ####################
+private:
+  /** Forward declare the structure stored at the start of the shared memory segment. */
+  struct Header;
+
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** A pointer to the header stored at the start of the shared memory segment. */
+  Header *m_header;
+
+  /** The name of the shared memory segment. */
+  std::string m_name;
+
+  /** Whether or not this object created the shared memory segment (and is therefore responsible for removing it). */
+  bool m_owner;
+
+  /** The index of the next slot to read (used by the reader). */
+  size_t m_readIndex;
+
+  /** The mapping of the shared memory segment into this process's address space. */
+  boost::interprocess::mapped_region m_region;
+
+  /** The shared memory segment. */
+  boost::interprocess::shared_memory_object m_sharedMemory;
+
+  /** A pointer to the first slot in the ring. */
+  char *m_slots;
+
+  /** The index of the next slot to write (used by the writer). */
+  size_t m_writeIndex;
+
+  //#################### CONSTRUCTORS ####################
+private:
+  /**
+   * \brief Constructs a shared memory message ring (see create and open).
+   */
+  SharedMemoryMessageRing(const std::string& name, bool owner, size_t slotCount, size_t slotSize);
+
+  //#################### DESTRUCTOR ####################
+public:
+  /**
+   * \brief Destroys the shared memory message ring, removing the shared memory segment if this object created it.
+   */
+  ~SharedMemoryMessageRing();
+
+  //#################### COPY CONSTRUCTOR & ASSIGNMENT OPERATOR ####################
+private:
+  // Deliberately private and unimplemented.
+  SharedMemoryMessageRing(const SharedMemoryMessageRing&);
+  SharedMemoryMessageRing& operator=(const SharedMemoryMessageRing&);
+
+  //#################### PUBLIC STATIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Creates a new shared memory message ring (replacing any existing segment with the same name).
+   *
+   * \param name      The name of the shared memory segment.
+   * \param slotCount The number of slots in the ring.
+   * \param slotSize  The size (in bytes) of each slot.
+   * \return          The ring.
+   *
+   * \throws boost::interprocess::interprocess_exception If the shared memory segment cannot be created.
+   */
+  static boost::shared_ptr<SharedMemoryMessageRing> create(const std::string& name, size_t slotCount, size_t slotSize);
+
+  /**
+   * \brief Opens an existing shared memory message ring.
+   *
+   * \param name  The name of the shared memory segment.
+   * \return      The ring.
+   *
+   * \throws boost::interprocess::interprocess_exception If the shared memory segment cannot be opened.
+   * \throws std::runtime_error                           If the shared memory segment does not contain a valid ring.
+   */
+  static boost::shared_ptr<SharedMemoryMessageRing> open(const std::string& name);
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Waits for the next slot to be filled by the writer, and then returns a pointer to its contents.
+   *
+   * If this succeeds, the reader must call end_read once it has finished with the slot.
+   *
+   * \param timeout The maximum amount of time for which to wait.
+   * \return        A pointer to the contents of the slot, or NULL if the timeout expired.
+   */
+  const char *begin_read(const boost::posix_time::time_duration& timeout);
+
+  /**
+   * \brief Waits for the next slot to become free, and then returns a pointer to it so that the writer can fill it.
+   *
+   * If this succeeds, the writer must call end_write once it has filled the slot.
+   *
+   * \param timeout The maximum amount of time for which to wait.
+   * \return        A pointer to the slot, or NULL if the timeout expired.
+   */
+  char *begin_write(const boost::posix_time::time_duration& timeout);
+
+  /**
+   * \brief Releases the slot obtained by the last successful call to begin_read, so that the writer can reuse it.
+   */
+  void end_read();
+
+  /**
+   * \brief Hands the slot obtained by the last successful call to begin_write to the reader.
+   */
+  void end_write();
+
+  /**
+   * \brief Gets the name of the shared memory segment.
+   *
+   * \return  The name of the shared memory segment.
+   */
+  const std::string& get_name() const;
+
+  /**
+   * \brief Gets the size (in bytes) of each slot in the ring.
+   *
+   * \return  The size (in bytes) of each slot in the ring.
+   */
+  size_t get_slot_size() const;
+
+  /**
+   * \brief Attempts to read a message from the ring.
+   *
+   * \param msg     The message into which to read (its size must match the slot size).
+   * \param timeout The maximum amount of time for which to wait for a message.
+   * \return        true, if a message was read, or false if the timeout expired.
+   *
+   * \throws std::invalid_argument  If the size of the message does not match the slot size.
+   */
+  bool read_message(Message& msg, const boost::posix_time::time_duration& timeout);
+
+  /**
+   * \brief Attempts to write a message to the ring.
+   *
+   * \param msg     The message to write (its size must match the slot size).
+   * \param timeout The maximum amount of time for which to wait for a free slot.
+   * \return        true, if the message was written, or false if the timeout expired.
+   *
+   * \throws std::invalid_argument  If the size of the message does not match the slot size.
+   */
+  bool write_message(const Message& msg, const boost::posix_time::time_duration& timeout);
+
+  //#################### PRIVATE MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Gets a pointer to the specified slot.
+   *
+   * \param index The index of the slot.
+   * \return      A pointer to the slot.
+   */
+  char *get_slot(size_t index) const;
+};
+
+//#################### TYPEDEFS ####################
+
+typedef boost::shared_ptr<SharedMemoryMessageRing> SharedMemoryMessageRing_Ptr;
+typedef boost::shared_ptr<const SharedMemoryMessageRing> SharedMemoryMessageRing_CPtr;
+
+}
+
+#endif
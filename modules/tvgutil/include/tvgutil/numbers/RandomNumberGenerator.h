@@ -90,6 +90,13 @@ public:
     return dist(*m_gen);
   }
 
+  /**
+   * \brief Gets the seed with which the generation engine was initialised.
+   *
+   * \return  The seed with which the generation engine was initialised.
+   */
+  unsigned int get_seed() const;
+
   //#################### SERIALIZATION #################### 
 public:
   /**
@@ -8,27 +8,43 @@
 
 #include <map>
 #include <stdexcept>
+#include <vector>
 
+#include <boost/serialization/map.hpp>
 #include <boost/serialization/serialization.hpp>
+#include <boost/serialization/split_member.hpp>
 
+#include "LabelledValuesView.h"
 #include "../containers/LimitedContainer.h"
 
 namespace tvgutil {
 
 /**
  * \brief An instance of an instantiation of this class template represents a histogram over the specified label type.
+ *
+ * The bins are stored as two contiguous arrays (the labels that have been seen, in ascending order, and the corresponding bin sizes),
+ * so that the histogram can be iterated without pointer chasing, and adding an instance of a label that has been seen before does not
+ * allocate. For the small integer label spaces used in practice, the bin for a label is found via a dense array indexed by the label
+ * (see LabelIndex), so neither adding an instance nor looking up a bin size needs a search.
  */
 template <typename Label>
 class Histogram
 {
+  //#################### TYPEDEFS ####################
+public:
+  typedef LabelledValuesView<Label,size_t> BinView;
+
   //#################### PRIVATE VARIABLES ####################
 private:
-  /** The bins that record the number of instances of each label that have been seen. */
-  std::map<Label,size_t> m_bins;
+  /** The bin sizes, i.e. the numbers of instances of the corresponding labels that have been seen. */
+  std::vector<size_t> m_binSizes;
 
   /** The total number of instances that are in the histogram. */
   size_t m_count;
 
+  /** An index containing the labels that have been seen, in ascending order. */
+  LabelIndex<Label> m_labelIndex;
+
   //#################### CONSTRUCTORS ####################
 public:
   /**
@@ -47,8 +63,22 @@ public:
    */
   void add(const Label& label)
   {
-    ++m_bins[label];
-    ++m_count;
+    add(label, 1);
+  }
+
+  /**
+   * \brief Adds the specified number of instances of a label to the histogram.
+   *
+   * \param label The label for which to add instances.
+   * \param count The number of instances to add.
+   */
+  void add(const Label& label, size_t count)
+  {
+    std::pair<size_t,bool> result = m_labelIndex.insert(label);
+    if(result.second) m_binSizes.insert(m_binSizes.begin() + result.first, 0);
+
+    m_binSizes[result.first] += count;
+    m_count += count;
   }
 
   /**
@@ -62,13 +92,37 @@ public:
   }
 
   /**
-   * \brief Gets the bins that record the number of instances of each label that have been seen.
+   * \brief Gets the size of the bin for the specified label.
    *
-   * \return The bins that record the number of instances of each label that have been seen.
+   * \param label The label.
+   * \return      The number of instances of the label that have been seen.
    */
-  const std::map<Label,size_t>& get_bins() const
+  size_t get_bin_size(const Label& label) const
   {
-    return m_bins;
+    const int i = m_labelIndex.find(label);
+    return i >= 0 ? m_binSizes[i] : 0;
+  }
+
+  /**
+   * \brief Gets the sizes of the bins, in the same order as the labels returned by get_labels.
+   *
+   * \return  The sizes of the bins.
+   */
+  const std::vector<size_t>& get_bin_sizes() const
+  {
+    return m_binSizes;
+  }
+
+  /**
+   * \brief Gets a view of the bins that record the number of instances of each label that have been seen.
+   *
+   * \note  The view refers to the histogram's own arrays, so it must not be used once further instances have been added.
+   *
+   * \return A view of the bins, which can be used like a map from labels to bin sizes.
+   */
+  BinView get_bins() const
+  {
+    return BinView(m_labelIndex, m_binSizes);
   }
 
   /**
@@ -81,21 +135,71 @@ public:
     return m_count;
   }
 
-  //#################### SERIALIZATION #################### 
+  /**
+   * \brief Gets the labels that have been seen, in ascending order.
+   *
+   * \return  The labels that have been seen.
+   */
+  const std::vector<Label>& get_labels() const
+  {
+    return m_labelIndex.get_labels();
+  }
+
+  /**
+   * \brief Gets an estimate of the amount of heap memory (in bytes) used by the histogram.
+   *
+   * \return  An estimate of the amount of heap memory (in bytes) used by the histogram.
+   */
+  size_t get_memory_usage() const
+  {
+    return m_binSizes.capacity() * sizeof(size_t) + m_labelIndex.get_memory_usage();
+  }
+
+  //#################### SERIALIZATION ####################
 private:
   /**
-   * \brief Serializes the histogram to/from an archive.
+   * \brief Loads the histogram from an archive.
    *
    * \param ar      The archive.
    * \param version The file format version number.
    */
   template<typename Archive>
-  void serialize(Archive& ar, const unsigned int version)
+  void load(Archive& ar, const unsigned int version)
   {
-    ar & m_bins;
+    std::map<Label,size_t> bins;
+    ar & bins;
     ar & m_count;
+
+    std::vector<Label> labels;
+    m_binSizes.clear();
+    for(typename std::map<Label,size_t>::const_iterator it = bins.begin(), iend = bins.end(); it != iend; ++it)
+    {
+      labels.push_back(it->first);
+      m_binSizes.push_back(it->second);
+    }
+
+    m_labelIndex = LabelIndex<Label>(labels);
   }
 
+  /**
+   * \brief Saves the histogram to an archive.
+   *
+   * \note  The bins are saved as a map, so that the format is the same as that used by earlier, map-based versions of the histogram.
+   *
+   * \param ar      The archive.
+   * \param version The file format version number.
+   */
+  template<typename Archive>
+  void save(Archive& ar, const unsigned int version) const
+  {
+    const BinView binView = get_bins();
+    std::map<Label,size_t> bins(binView.begin(), binView.end());
+    ar & bins;
+    ar & m_count;
+  }
+
+  BOOST_SERIALIZATION_SPLIT_MEMBER()
+
   friend class boost::serialization::access;
 };
 
@@ -0,0 +1,192 @@
+/**
+ * tvgutil: LabelIndex.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2015. All rights reserved.
+ */
+
+#ifndef H_TVGUTIL_LABELINDEX
+#define H_TVGUTIL_LABELINDEX
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include <boost/type_traits/integral_constant.hpp>
+#include <boost/type_traits/is_integral.hpp>
+
+namespace tvgutil {
+
+/**
+ * \brief An instance of an instantiation of this class template maps a sorted set of labels to their positions in the set.
+ *
+ * It is used by statistical containers (e.g. histograms and PMFs) that store their values in a contiguous array, in ascending label order.
+ * For integral labels in [0,MAX_DENSE_LABEL), the position of a label is looked up in a dense array indexed by the label itself, which
+ * avoids a binary search in the common case of a small integer label space (other labels fall back to a binary search of the labels).
+ */
+template <typename Label>
+class LabelIndex
+{
+  //#################### CONSTANTS ####################
+public:
+  /** An upper bound on the labels whose positions are looked up in the dense array (larger labels use a binary search). */
+  static const int MAX_DENSE_LABEL = 256;
+
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** The positions of the labels in [0,MAX_DENSE_LABEL), indexed by label (-1 for labels that are not in the set). */
+  std::vector<int> m_densePositions;
+
+  /** The labels in the set, in ascending order. */
+  std::vector<Label> m_labels;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Constructs an empty label index.
+   */
+  LabelIndex() {}
+
+  /**
+   * \brief Constructs a label index for the specified labels.
+   *
+   * \pre   The labels are distinct and in ascending order.
+   *
+   * \param labels  The labels.
+   */
+  explicit LabelIndex(const std::vector<Label>& labels)
+  : m_labels(labels)
+  {
+    for(size_t i = 0, size = m_labels.size(); i < size; ++i)
+    {
+      set_dense_position(m_labels[i], static_cast<int>(i));
+    }
+  }
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Clears the index.
+   */
+  void clear()
+  {
+    m_densePositions.clear();
+    m_labels.clear();
+  }
+
+  /**
+   * \brief Finds the position of the specified label in the set.
+   *
+   * \param label The label.
+   * \return      The position of the label in the set, or -1 if the label is not in the set.
+   */
+  int find(const Label& label) const
+  {
+    const int denseLabel = to_dense_label(label);
+    if(denseLabel >= 0) return denseLabel < static_cast<int>(m_densePositions.size()) ? m_densePositions[denseLabel] : -1;
+
+    typename std::vector<Label>::const_iterator it = std::lower_bound(m_labels.begin(), m_labels.end(), label);
+    return it != m_labels.end() && !(label < *it) ? static_cast<int>(it - m_labels.begin()) : -1;
+  }
+
+  /**
+   * \brief Gets the labels in the set, in ascending order.
+   *
+   * \return  The labels in the set.
+   */
+  const std::vector<Label>& get_labels() const
+  {
+    return m_labels;
+  }
+
+  /**
+   * \brief Gets an estimate of the amount of heap memory (in bytes) used by the index.
+   *
+   * \return  An estimate of the amount of heap memory (in bytes) used by the index.
+   */
+  size_t get_memory_usage() const
+  {
+    return m_densePositions.capacity() * sizeof(int) + m_labels.capacity() * sizeof(Label);
+  }
+
+  /**
+   * \brief Adds the specified label to the set (if it is not already in it).
+   *
+   * \param label The label.
+   * \return      A pair containing the position of the label in the set, and a flag indicating whether or not the label was added
+   *              (if it was, any values stored for the labels at or after this position need to be shifted along by one).
+   */
+  std::pair<size_t,bool> insert(const Label& label)
+  {
+    const int position = find(label);
+    if(position >= 0) return std::make_pair(static_cast<size_t>(position), false);
+
+    typename std::vector<Label>::iterator it = std::lower_bound(m_labels.begin(), m_labels.end(), label);
+    const int newPosition = static_cast<int>(it - m_labels.begin());
+    m_labels.insert(it, label);
+
+    // Shift the positions of any labels after the new one along by one.
+    for(size_t i = 0, size = m_densePositions.size(); i < size; ++i)
+    {
+      if(m_densePositions[i] >= newPosition) ++m_densePositions[i];
+    }
+
+    set_dense_position(label, newPosition);
+    return std::make_pair(static_cast<size_t>(newPosition), true);
+  }
+
+  //#################### PRIVATE MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Records the position of the specified label in the dense array (if it is small enough to be looked up there).
+   *
+   * \param label     The label.
+   * \param position  Its position in the set.
+   */
+  void set_dense_position(const Label& label, int position)
+  {
+    const int denseLabel = to_dense_label(label);
+    if(denseLabel < 0) return;
+
+    if(denseLabel >= static_cast<int>(m_densePositions.size())) m_densePositions.resize(denseLabel + 1, -1);
+    m_densePositions[denseLabel] = position;
+  }
+
+  //#################### PRIVATE STATIC MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Converts a label to an index into the dense array.
+   *
+   * \param label The label.
+   * \return      The index, or -1 if the label cannot be looked up in the dense array.
+   */
+  static int to_dense_label(const Label& label)
+  {
+    return to_dense_label(label, typename boost::is_integral<Label>::type());
+  }
+
+  /**
+   * \brief Converts an integral label to an index into the dense array.
+   *
+   * \param label The label.
+   * \return      The index, or -1 if the label is outside [0,MAX_DENSE_LABEL).
+   */
+  static int to_dense_label(const Label& label, boost::true_type)
+  {
+    const long long l = static_cast<long long>(label);
+    return l >= 0 && l < MAX_DENSE_LABEL ? static_cast<int>(l) : -1;
+  }
+
+  /**
+   * \brief Converts a non-integral label to an index into the dense array (such labels are never looked up there).
+   *
+   * \param label The label.
+   * \return      -1.
+   */
+  static int to_dense_label(const Label& label, boost::false_type)
+  {
+    return -1;
+  }
+};
+
+}
+
+#endif
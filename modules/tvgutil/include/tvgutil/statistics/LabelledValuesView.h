@@ -0,0 +1,142 @@
+/**
+ * tvgutil: LabelledValuesView.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2015. All rights reserved.
+ */
+
+#ifndef H_TVGUTIL_LABELLEDVALUESVIEW
+#define H_TVGUTIL_LABELLEDVALUESVIEW
+
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include <boost/iterator/iterator_facade.hpp>
+
+#include "LabelIndex.h"
+
+namespace tvgutil {
+
+/**
+ * \brief An instance of an instantiation of this class template provides a read-only, map-like view of a set of labels and
+ *        the values associated with them (e.g. the bins of a histogram, or the masses of a PMF).
+ *
+ * The view refers to the contiguous arrays in which the labels and values are actually stored, so it is cheap to construct and
+ * does not allocate. Iterating over it yields (label,value) pairs in ascending label order. The view (and any iterators obtained
+ * from it) are only valid for as long as the arrays to which it refers are neither destroyed nor changed.
+ */
+template <typename Label, typename Value>
+class LabelledValuesView
+{
+  //#################### NESTED TYPES ####################
+public:
+  /**
+   * \brief An instance of this class can be used to iterate over the (label,value) pairs in the view.
+   */
+  class const_iterator : public boost::iterator_facade<const_iterator, const std::pair<Label,Value>, boost::random_access_traversal_tag, std::pair<Label,Value> >
+  {
+    //~~~~~~~~~~~~~~~~~~~~ PRIVATE VARIABLES ~~~~~~~~~~~~~~~~~~~~
+  private:
+    /** A pointer to the label of the current pair. */
+    const Label *m_label;
+
+    /** A pointer to the value of the current pair. */
+    const Value *m_value;
+
+    //~~~~~~~~~~~~~~~~~~~~ CONSTRUCTORS ~~~~~~~~~~~~~~~~~~~~
+  public:
+    const_iterator()
+    : m_label(NULL), m_value(NULL)
+    {}
+
+    const_iterator(const Label *label, const Value *value)
+    : m_label(label), m_value(value)
+    {}
+
+    //~~~~~~~~~~~~~~~~~~~~ PRIVATE MEMBER FUNCTIONS ~~~~~~~~~~~~~~~~~~~~
+  private:
+    void advance(std::ptrdiff_t n)                                { m_label += n; m_value += n; }
+    void decrement()                                              { --m_label; --m_value; }
+    std::pair<Label,Value> dereference() const                    { return std::make_pair(*m_label, *m_value); }
+    std::ptrdiff_t distance_to(const const_iterator& rhs) const   { return rhs.m_label - m_label; }
+    bool equal(const const_iterator& rhs) const                   { return m_label == rhs.m_label; }
+    void increment()                                              { ++m_label; ++m_value; }
+
+    friend class boost::iterator_core_access;
+  };
+
+  typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+  typedef std::pair<Label,Value> value_type;
+
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** An index that can be used to find the positions of the labels. */
+  const LabelIndex<Label> *m_labelIndex;
+
+  /** The labels, in ascending order. */
+  const std::vector<Label> *m_labels;
+
+  /** The values associated with the labels (in the same order as the labels). */
+  const std::vector<Value> *m_values;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Constructs a view of a set of labels and the values associated with them.
+   *
+   * \param labelIndex  An index containing the labels, in ascending order.
+   * \param values      The values associated with the labels (in the same order as the labels).
+   */
+  LabelledValuesView(const LabelIndex<Label>& labelIndex, const std::vector<Value>& values)
+  : m_labelIndex(&labelIndex), m_labels(&labelIndex.get_labels()), m_values(&values)
+  {}
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /** Gets an iterator pointing to the first (label,value) pair in the view. */
+  const_iterator begin() const                { return make_iterator(0); }
+
+  /** Gets whether or not the view is empty. */
+  bool empty() const                          { return m_labels->empty(); }
+
+  /** Gets an iterator pointing one past the last (label,value) pair in the view. */
+  const_iterator end() const                  { return make_iterator(m_labels->size()); }
+
+  /**
+   * \brief Finds the (label,value) pair for the specified label.
+   *
+   * \param label The label.
+   * \return      An iterator pointing to the (label,value) pair, or end() if the label is not in the view.
+   */
+  const_iterator find(const Label& label) const
+  {
+    const int i = m_labelIndex->find(label);
+    return i >= 0 ? make_iterator(static_cast<size_t>(i)) : end();
+  }
+
+  /** Gets a reverse iterator pointing to the last (label,value) pair in the view. */
+  const_reverse_iterator rbegin() const       { return const_reverse_iterator(end()); }
+
+  /** Gets a reverse iterator pointing one before the first (label,value) pair in the view. */
+  const_reverse_iterator rend() const         { return const_reverse_iterator(begin()); }
+
+  /** Gets the number of (label,value) pairs in the view. */
+  size_t size() const                         { return m_labels->size(); }
+
+  //#################### PRIVATE MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Makes an iterator pointing to the (label,value) pair at the specified position in the view.
+   *
+   * \param i  The position (which may be one past the end of the view).
+   * \return   The iterator.
+   */
+  const_iterator make_iterator(size_t i) const
+  {
+    if(m_labels->empty()) return const_iterator();
+    return const_iterator(&(*m_labels)[0] + i, &(*m_values)[0] + i);
+  }
+};
+
+}
+
+#endif
@@ -6,8 +6,10 @@
 #ifndef H_TVGUTIL_PROBABILITYMASSFUNCTION
 #define H_TVGUTIL_PROBABILITYMASSFUNCTION
 
+#include <algorithm>
 #include <cassert>
 #include <cmath>
+#include <vector>
 
 #include <boost/lexical_cast.hpp>
 #include <boost/optional.hpp>
@@ -24,15 +26,27 @@ const float SMALL_EPSILON = 1e-9f;
 /**
  * \brief An instance of an instantiation of this class template represents a probability mass function (PMF).
  *
+ * The masses are stored as two contiguous arrays (the labels, in ascending order, and the corresponding masses), so that
+ * the sum, normalisation, entropy and argmax calculations are simple loops over an array of floats, and constructing a PMF
+ * needs no per-label allocations. For the small integer label spaces used in practice, the mass for a label is found via a dense
+ * array indexed by the label (see LabelIndex), so looking up a mass needs no search.
+ *
  * Datatype Invariant: The masses in the PMF must sum to 1.
  */
 template <typename Label>
 class ProbabilityMassFunction
 {
+  //#################### TYPEDEFS ####################
+public:
+  typedef LabelledValuesView<Label,float> MassView;
+
   //#################### PRIVATE VARIABLES ####################
 private:
-  /** The masses for the various labels. */
-  std::map<Label,float> m_masses;
+  /** An index containing the labels, in ascending order. */
+  LabelIndex<Label> m_labelIndex;
+
+  /** The masses for the various labels (in the same order as the labels). */
+  std::vector<float> m_masses;
 
   //#################### CONSTRUCTORS ####################
 public:
@@ -47,9 +61,20 @@ public:
    * \param masses  The label -> masses map to normalise.
    */
   explicit ProbabilityMassFunction(const std::map<Label,float>& masses)
-  : m_masses(masses)
   {
     assert(!masses.empty());
+
+    std::vector<Label> labels;
+    labels.reserve(masses.size());
+    m_masses.reserve(masses.size());
+    for(typename std::map<Label,float>::const_iterator it = masses.begin(), iend = masses.end(); it != iend; ++it)
+    {
+      labels.push_back(it->first);
+      m_masses.push_back(it->second);
+    }
+
+    m_labelIndex = LabelIndex<Label>(labels);
+
     normalise();
     ensure_invariant();
   }
@@ -61,29 +86,39 @@ public:
    * \param multipliers Optional per-class ratios that can be used to scale the probabilities for the different labels.
    */
   explicit ProbabilityMassFunction(const Histogram<Label>& histogram, const boost::optional<std::map<Label,float> >& multipliers = boost::none)
+  : m_labelIndex(histogram.get_labels())
   {
     // Determine the masses for the labels in the histogram by dividing the number of instances in each bin by the histogram count.
-    const std::map<Label,size_t>& bins = histogram.get_bins();
+    const std::vector<size_t>& binSizes = histogram.get_bin_sizes();
     size_t count = histogram.get_count();
     if(count == 0) throw std::runtime_error("Cannot make a probability mass function from an empty histogram");
-    for(typename std::map<Label,size_t>::const_iterator it = bins.begin(), iend = bins.end(); it != iend; ++it)
+
+    const std::vector<Label>& labels = m_labelIndex.get_labels();
+    const size_t labelCount = labels.size();
+    m_masses.resize(labelCount);
+    for(size_t i = 0; i < labelCount; ++i)
     {
-      float mass = static_cast<float>(it->second) / count;
+      m_masses[i] = static_cast<float>(binSizes[i]) / count;
+    }
 
-      // Scale the mass by the relevant multiplier for the corresponding class (if supplied).
-      if(multipliers)
+    // Scale the masses by the relevant multipliers for the corresponding classes (if supplied).
+    if(multipliers)
+    {
+      typename std::map<Label,float>::const_iterator jt = multipliers->begin(), jend = multipliers->end();
+      for(size_t i = 0; i < labelCount; ++i)
       {
-        typename std::map<Label,float>::const_iterator jt = multipliers->find(it->first);
-        if(jt != multipliers->end()) mass *= jt->second;
+        // Note: Both the labels and the multipliers are in ascending label order, so we can merge rather than search.
+        while(jt != jend && jt->first < labels[i]) ++jt;
+        if(jt != jend && !(labels[i] < jt->first)) m_masses[i] *= jt->second;
       }
-
-      // Our implementation is dependent on the masses never becoming too small. If this assumption turns out not to be ok,
-      // we may need to change the implementation.
-      assert(mass >= SMALL_EPSILON);
-
-      m_masses.insert(std::make_pair(it->first, mass));
     }
 
+    // Our implementation is dependent on the masses never becoming too small. If this assumption turns out not to be ok,
+    // we may need to change the implementation.
+#ifndef NDEBUG
+    for(size_t i = 0; i < labelCount; ++i) assert(m_masses[i] >= SMALL_EPSILON);
+#endif
+
     if(multipliers) normalise();
 
     ensure_invariant();
@@ -101,7 +136,7 @@ public:
    */
   Label calculate_best_label() const
   {
-    return ArgUtil::argmax(m_masses);
+    return m_labelIndex.get_labels()[ArgUtil::argmax(m_masses)];
   }
 
   /**
@@ -112,9 +147,9 @@ public:
   float calculate_entropy() const
   {
     float entropy = 0.0f;
-    for(typename std::map<Label,float>::const_iterator it = m_masses.begin(), iend = m_masses.end(); it != iend; ++it)
+    for(size_t i = 0, size = m_masses.size(); i < size; ++i)
     {
-      float mass = it->second;
+      float mass = m_masses[i];
       if(mass > 0)
       {
         // Note: If P(x_i) = 0, the value of the corresponding sum 0*log2(0) is taken to be 0, since lim{p->0+} p*log2(p) = 0 (see Wikipedia!).
@@ -125,15 +160,49 @@ public:
   }
 
   /**
-   * \brief Gets the masses for the various labels.
+   * \brief Gets the labels in the PMF, in ascending order.
    *
-   * \return The masses for the various labels.
+   * \return  The labels in the PMF.
    */
-  const std::map<Label,float>& get_masses() const
+  const std::vector<Label>& get_labels() const
+  {
+    return m_labelIndex.get_labels();
+  }
+
+  /**
+   * \brief Gets the mass for the specified label.
+   *
+   * \param label The label.
+   * \return      The mass for the label (or 0, if the label is not in the PMF).
+   */
+  float get_mass(const Label& label) const
+  {
+    const int i = m_labelIndex.find(label);
+    return i >= 0 ? m_masses[i] : 0.0f;
+  }
+
+  /**
+   * \brief Gets the masses for the various labels, in the same order as the labels returned by get_labels.
+   *
+   * \return  The masses for the various labels.
+   */
+  const std::vector<float>& get_mass_values() const
   {
     return m_masses;
   }
 
+  /**
+   * \brief Gets a view of the masses for the various labels.
+   *
+   * \note  The view refers to the PMF's own arrays, so it must not outlive the PMF.
+   *
+   * \return A view of the masses, which can be used like a map from labels to masses.
+   */
+  MassView get_masses() const
+  {
+    return MassView(m_labelIndex, m_masses);
+  }
+
   //#################### PRIVATE MEMBER FUNCTIONS ####################
 private:
   /**
@@ -141,13 +210,13 @@ private:
    *
    * \return  The sum of the masses in the PMF.
    */
-  float calculate_sum()
+  float calculate_sum() const
   {
     float sum = 0.0f;
-    for(typename std::map<Label,float>::const_iterator it = m_masses.begin(), iend = m_masses.end(); it != iend; ++it)
+    for(size_t i = 0, size = m_masses.size(); i < size; ++i)
     {
-      assert(it->second >= 0.0f);
-      sum += it->second;
+      assert(m_masses[i] >= 0.0f);
+      sum += m_masses[i];
     }
     return sum;
   }
@@ -175,9 +244,9 @@ private:
     if(fabs(sum) < SMALL_EPSILON) throw std::runtime_error("Cannot normalise the probability mass function: denominator too small");
 
     // Normalise the PMF by dividing each mass by the sum.
-    for(typename std::map<Label,float>::iterator it = m_masses.begin(), iend = m_masses.end(); it != iend; ++it)
+    for(size_t i = 0, size = m_masses.size(); i < size; ++i)
     {
-      it->second /= sum;
+      m_masses[i] /= sum;
     }
   }
 };
@@ -0,0 +1,68 @@
+/**
+ * tvgutil: StageStatistics.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#ifndef H_TVGUTIL_STAGESTATISTICS
+#define H_TVGUTIL_STAGESTATISTICS
+
+#include <string>
+#include <vector>
+
+namespace tvgutil {
+
+/**
+ * \brief An instance of this struct summarises the distribution of the durations of a stage of processing (e.g. a traced scope).
+ */
+struct StageStatistics
+{
+  //#################### PUBLIC VARIABLES ####################
+
+  /** The number of times the stage was run. */
+  size_t count;
+
+  /** The longest duration of the stage (in milliseconds). */
+  double maxMs;
+
+  /** The mean duration of the stage (in milliseconds). */
+  double meanMs;
+
+  /** The name of the stage. */
+  std::string name;
+
+  /** The 50th percentile of the durations of the stage (in milliseconds). */
+  double p50Ms;
+
+  /** The 95th percentile of the durations of the stage (in milliseconds). */
+  double p95Ms;
+
+  /** The 99th percentile of the durations of the stage (in milliseconds). */
+  double p99Ms;
+
+  //#################### PUBLIC STATIC MEMBER FUNCTIONS ####################
+
+  /**
+   * \brief Computes the statistics for the durations of a stage.
+   *
+   * \note  The percentiles are computed using the nearest-rank method.
+   *
+   * \param name                The name of the stage.
+   * \param durationsMs         The durations (in milliseconds) recorded for the stage (must be non-empty).
+   * \return                    The statistics.
+   * \throws std::runtime_error If no durations were recorded for the stage.
+   */
+  static StageStatistics compute(const std::string& name, std::vector<double> durationsMs);
+
+  /**
+   * \brief Computes the specified percentile of a sorted set of values, using the nearest-rank method.
+   *
+   * \param sortedValues  The values, sorted in ascending order (must be non-empty).
+   * \param percentile    The percentile to compute (in the range [0,100]).
+   * \return              The percentile.
+   */
+  static double nearest_rank_percentile(const std::vector<double>& sortedValues, double percentile);
+};
+
+}
+
+#endif
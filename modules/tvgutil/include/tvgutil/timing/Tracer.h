@@ -0,0 +1,322 @@
+/**
+ * tvgutil: Tracer.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#ifndef H_TVGUTIL_TRACER
+#define H_TVGUTIL_TRACER
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <boost/atomic.hpp>
+#include <boost/chrono.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/scoped_array.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/tss.hpp>
+
+#include "StageStatistics.h"
+
+namespace tvgutil {
+
+/**
+ * \brief An instance of this class records the timings of (possibly nested) scopes on any number of threads,
+ *        so that they can be exported as a Chrome trace (for chrome://tracing) or summarised as percentiles.
+ *
+ * Each thread records into its own fixed-size ring buffer, so recording an event involves no locking (once
+ * the thread's buffer has been created). When a buffer is full, the oldest events in it are overwritten.
+ *
+ * Tracing is disabled by default, and can be enabled at runtime. Scopes are normally traced via the TRACE_SCOPE
+ * macro, which compiles to nothing unless the code is built with WITH_TRACING defined.
+ */
+class Tracer
+{
+  //#################### NESTED TYPES ####################
+public:
+  /**
+   * \brief An instance of this struct represents a single completed scope.
+   */
+  struct Event
+  {
+    /** The nesting depth of the scope on its thread (0 for an outermost scope). */
+    boost::uint32_t depth;
+
+    /** The duration of the scope (in nanoseconds). */
+    boost::uint64_t durationNs;
+
+    /** The name of the scope (this must point to a string with static storage duration, e.g. a literal). */
+    const char *name;
+
+    /** The time at which the scope started (in nanoseconds since the tracer was created). */
+    boost::uint64_t startNs;
+  };
+
+private:
+  /**
+   * \brief An instance of this struct holds an event in a thread's ring buffer.
+   *
+   * The fields are atomic (but only ever accessed with relaxed ordering) because an exporter may read
+   * a slot while its owning thread is overwriting it; any such torn reads are detected and discarded.
+   */
+  struct Slot
+  {
+    boost::atomic<boost::uint32_t> depth;
+    boost::atomic<boost::uint64_t> durationNs;
+    boost::atomic<const char*> name;
+    boost::atomic<boost::uint64_t> startNs;
+  };
+
+  /**
+   * \brief An instance of this struct holds the events recorded on a single thread.
+   */
+  struct ThreadBuffer
+  {
+    /** The capacity of the ring buffer. */
+    size_t capacity;
+
+    /**
+     * The number of events whose writing had started when the buffer was last cleared (exporters ignore these events).
+     * This is only accessed whilst holding the tracer's mutex, and never by the owning thread, so that clearing the
+     * buffer does not race with the owning thread's updates to the event counts.
+     */
+    size_t clearedCount;
+
+    /** The current nesting depth of the traced scopes on the thread (only accessed by the thread itself). */
+    boost::uint32_t depth;
+
+    /** The total number of events that have ever been written to the buffer (the write position is this modulo the capacity). */
+    boost::atomic<size_t> eventCount;
+
+    /** The ring buffer of events. */
+    boost::scoped_array<Slot> slots;
+
+    /** The total number of events whose writing has started (this runs ahead of eventCount while a slot is being written). */
+    boost::atomic<size_t> startedCount;
+
+    /** The index of the thread (used as its thread ID in the trace). */
+    size_t threadIndex;
+
+    ThreadBuffer(size_t capacity_, size_t threadIndex_)
+    : capacity(capacity_), clearedCount(0), depth(0), eventCount(0), slots(new Slot[capacity_]), startedCount(0), threadIndex(threadIndex_)
+    {}
+  };
+
+  typedef boost::shared_ptr<ThreadBuffer> ThreadBuffer_Ptr;
+
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** The capacity of the ring buffer that will be created for each new thread. */
+  size_t m_bufferCapacity;
+
+  /** The buffers of all the threads that have recorded events (these outlive the threads themselves). */
+  std::vector<ThreadBuffer_Ptr> m_buffers;
+
+  /** Whether or not tracing is currently enabled. */
+  boost::atomic<bool> m_enabled;
+
+  /** Whether or not to synchronise the GPU at the start and end of each scope (so that asynchronous kernels are attributed correctly). */
+  boost::atomic<bool> m_gpuSync;
+
+  /** The synchronisation mutex (used when creating buffers and exporting events). */
+  mutable boost::mutex m_mutex;
+
+  /** The time at which the tracer was created (event times are measured relative to this). */
+  boost::chrono::steady_clock::time_point m_origin;
+
+  /** The buffer for the current thread (not owned: the buffers are owned by m_buffers). */
+  boost::thread_specific_ptr<ThreadBuffer> m_threadBuffer;
+
+  //#################### SINGLETON IMPLEMENTATION ####################
+private:
+  /**
+   * \brief Constructs the tracer.
+   */
+  Tracer();
+
+public:
+  /**
+   * \brief Gets the singleton instance.
+   *
+   * \return  The singleton instance.
+   */
+  static Tracer& instance();
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Marks the start of a traced scope on the current thread.
+   *
+   * \return  The start time of the scope (in nanoseconds since the tracer was created).
+   */
+  boost::uint64_t begin_scope();
+
+  /**
+   * \brief Discards all of the events that have been recorded so far.
+   *
+   * \note  This may be called whilst other threads are recording events, since it does not modify their ring buffers
+   *        (it just marks the events currently in them as discarded). An event that is being recorded at the time
+   *        of the call may or may not be discarded.
+   */
+  void clear();
+
+  /**
+   * \brief Computes summary statistics for each distinct scope name that has been recorded.
+   *
+   * \return  The summary statistics, sorted by scope name.
+   */
+  std::vector<StageStatistics> compute_statistics() const;
+
+  /**
+   * \brief Marks the end of a traced scope on the current thread, and records it.
+   *
+   * \param name    The name of the scope (this must point to a string with static storage duration).
+   * \param startNs The start time of the scope, as returned by begin_scope.
+   */
+  void end_scope(const char *name, boost::uint64_t startNs);
+
+  /**
+   * \brief Gets whether or not tracing is currently enabled.
+   *
+   * \return  true, if tracing is currently enabled, or false otherwise.
+   */
+  bool is_enabled() const
+  {
+    return m_enabled.load(boost::memory_order_relaxed);
+  }
+
+  /**
+   * \brief Sets the capacity of the ring buffer that will be created for each new thread that records events.
+   *
+   * \param bufferCapacity  The capacity (in events) of the ring buffer for each new thread.
+   */
+  void set_buffer_capacity(size_t bufferCapacity);
+
+  /**
+   * \brief Sets whether or not tracing is enabled.
+   *
+   * \param enabled Whether or not tracing should be enabled.
+   */
+  void set_enabled(bool enabled);
+
+  /**
+   * \brief Sets whether or not to synchronise the GPU at the start and end of each traced scope.
+   *
+   * \param gpuSync Whether or not to synchronise the GPU at the start and end of each traced scope.
+   */
+  void set_gpu_sync(bool gpuSync);
+
+  /**
+   * \brief Writes all of the recorded events to a file in Chrome's trace event format (for chrome://tracing).
+   *
+   * \param path                The path to the file.
+   * \throws std::runtime_error If the file could not be written.
+   */
+  void write_chrome_trace(const std::string& path) const;
+
+  /**
+   * \brief Writes a table of summary statistics for the recorded scopes to a stream.
+   *
+   * \param os  The stream.
+   */
+  void write_summary(std::ostream& os) const;
+
+  //#################### PRIVATE MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Gets a consistent snapshot of all of the events that are currently in the threads' ring buffers.
+   *
+   * \param threadIndices A vector into which to write the thread index of each event.
+   * \return              The events.
+   */
+  std::vector<Event> collect_events(std::vector<size_t>& threadIndices) const;
+
+  /**
+   * \brief Gets the buffer for the current thread, creating it if necessary.
+   *
+   * \return  The buffer for the current thread.
+   */
+  ThreadBuffer& get_thread_buffer();
+
+  /**
+   * \brief Gets the current time (in nanoseconds since the tracer was created).
+   *
+   * \return  The current time (in nanoseconds since the tracer was created).
+   */
+  boost::uint64_t now_ns() const;
+
+  /**
+   * \brief Synchronises the GPU, if GPU synchronisation is enabled.
+   */
+  void sync_gpu_if_needed() const;
+
+  //#################### PRIVATE STATIC MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief A no-op cleanup function for the thread-specific buffer pointers (the buffers must outlive their threads).
+   */
+  static void release_thread_buffer(ThreadBuffer *);
+};
+
+/**
+ * \brief An instance of this class traces the scope in which it is declared (if tracing is enabled when it is constructed).
+ */
+class TraceScope
+{
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** Whether or not the scope is being traced. */
+  bool m_active;
+
+  /** The name of the scope. */
+  const char *m_name;
+
+  /** The start time of the scope (in nanoseconds since the tracer was created). */
+  boost::uint64_t m_startNs;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Constructs a trace scope.
+   *
+   * \param name  The name of the scope (this must point to a string with static storage duration, e.g. a literal).
+   */
+  explicit TraceScope(const char *name)
+  : m_active(Tracer::instance().is_enabled()), m_name(name), m_startNs(0)
+  {
+    if(m_active) m_startNs = Tracer::instance().begin_scope();
+  }
+
+  //#################### DESTRUCTOR ####################
+public:
+  /**
+   * \brief Destroys the trace scope, recording it if it is being traced.
+   */
+  ~TraceScope()
+  {
+    if(m_active) Tracer::instance().end_scope(m_name, m_startNs);
+  }
+
+  //#################### COPY CONSTRUCTOR & ASSIGNMENT OPERATOR ####################
+private:
+  // Deliberately private and unimplemented.
+  TraceScope(const TraceScope&);
+  TraceScope& operator=(const TraceScope&);
+};
+
+//#################### MACROS ####################
+
+#define TVGUTIL_TRACE_CONCAT_IMPL(a, b) a##b
+#define TVGUTIL_TRACE_CONCAT(a, b) TVGUTIL_TRACE_CONCAT_IMPL(a, b)
+
+#ifdef WITH_TRACING
+  #define TRACE_SCOPE(name) tvgutil::TraceScope TVGUTIL_TRACE_CONCAT(traceScope, __LINE__)(name)
+#else
+  #define TRACE_SCOPE(name)
+#endif
+
+}
+
+#endif
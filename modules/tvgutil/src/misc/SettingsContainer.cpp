@@ -5,12 +5,20 @@
 
 #include "misc/SettingsContainer.h"
 
+#include <iostream>
+
 namespace tvgutil {
 
 //#################### CONSTANTS ####################
 
 const std::string SettingsContainer::NOT_SET = "<Not Set>";
 
+//#################### CONSTRUCTORS ####################
+
+SettingsContainer::SettingsContainer()
+: m_lookupWarningThreshold(0), m_mutex(new boost::mutex)
+{}
+
 //#################### DESTRUCTOR ####################
 
 SettingsContainer::~SettingsContainer() {}
@@ -19,7 +27,11 @@ SettingsContainer::~SettingsContainer() {}
 
 void SettingsContainer::add_value(const std::string& key, const std::string& value)
 {
-  m_settings[key].push_back(value);
+  std::vector<std::string>& values = m_settings[key];
+  values.push_back(value);
+
+  // If this is the first value for the setting, it is now the value of any typed settings registered for it.
+  if(values.size() == 1) update_typed_settings(key);
 }
 
 bool SettingsContainer::has_values(const std::string& key) const
@@ -27,6 +39,66 @@ bool SettingsContainer::has_values(const std::string& key) const
   return MapUtil::contains(m_settings, key);
 }
 
+void SettingsContainer::set_lookup_warning_threshold(size_t lookupWarningThreshold)
+{
+  m_lookupWarningThreshold = lookupWarningThreshold;
+}
+
+void SettingsContainer::set_value(const std::string& key, const std::string& value)
+{
+  m_settings[key] = std::vector<std::string>(1, value);
+  update_typed_settings(key);
+}
+
+//#################### PRIVATE MEMBER FUNCTIONS ####################
+
+const std::string *SettingsContainer::get_first_raw_value(const std::string& key) const
+{
+  std::map<std::string,std::vector<std::string> >::const_iterator it = m_settings.find(key);
+  return it != m_settings.end() && !it->second.empty() && it->second[0] != NOT_SET ? &it->second[0] : NULL;
+}
+
+void SettingsContainer::note_lookup(const std::string& key) const
+{
+  boost::lock_guard<boost::mutex> lock(*m_mutex);
+  if(++m_lookupCounts[key] == m_lookupWarningThreshold)
+  {
+    std::cerr << "Warning: The setting '" << key << "' has been looked up by name " << m_lookupWarningThreshold
+              << " times - if it is needed every frame, consider using register_setting instead\n";
+  }
+}
+
+void SettingsContainer::update_typed_settings(const std::string& key)
+{
+  std::vector<boost::shared_ptr<TypedSettingBase> > settings;
+
+  // Find the typed settings that are still in use, discarding any that are not.
+  {
+    boost::lock_guard<boost::mutex> lock(*m_mutex);
+    std::map<std::string,std::vector<boost::weak_ptr<TypedSettingBase> > >::iterator it = m_typedSettings.find(key);
+    if(it == m_typedSettings.end()) return;
+
+    std::vector<boost::weak_ptr<TypedSettingBase> > live;
+    for(size_t i = 0, size = it->second.size(); i < size; ++i)
+    {
+      boost::shared_ptr<TypedSettingBase> setting = it->second[i].lock();
+      if(setting)
+      {
+        settings.push_back(setting);
+        live.push_back(setting);
+      }
+    }
+    it->second.swap(live);
+  }
+
+  // Update them outside the lock, since their listeners may use the container.
+  const std::string *value = get_first_raw_value(key);
+  for(size_t i = 0, size = settings.size(); i < size; ++i)
+  {
+    settings[i]->update(value);
+  }
+}
+
 //#################### STREAM OPERATORS ####################
 
 std::ostream& operator<<(std::ostream& os, const SettingsContainer& rhs)
@@ -0,0 +1,102 @@
+/**
+ * tvgutil: TaskGroup.cpp
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#include "misc/TaskGroup.h"
+
+#include <stdexcept>
+
+namespace tvgutil {
+
+//#################### CONSTRUCTORS ####################
+
+TaskGroup::TaskGroup(ThreadPool& pool)
+: m_pendingTaskCount(0), m_pool(pool), m_queuedTasks(new TaskQueue)
+{}
+
+//#################### DESTRUCTOR ####################
+
+TaskGroup::~TaskGroup()
+{
+  wait_for_tasks();
+}
+
+//#################### PUBLIC MEMBER FUNCTIONS ####################
+
+void TaskGroup::wait()
+{
+  wait_for_tasks();
+
+  boost::lock_guard<boost::mutex> lock(m_mutex);
+  if(m_error != "")
+  {
+    const std::string error = m_error;
+    m_error = "";
+    throw std::runtime_error(error);
+  }
+}
+
+//#################### PRIVATE STATIC MEMBER FUNCTIONS ####################
+
+bool TaskGroup::run_queued_task(const TaskQueue_Ptr& queue)
+{
+  ThreadPool::Task task;
+  {
+    boost::lock_guard<boost::mutex> lock(queue->mutex);
+    if(queue->tasks.empty()) return false;
+    task.swap(queue->tasks.front());
+    queue->tasks.pop_front();
+  }
+
+  // Note: The task is a call to run_task, which catches any exceptions.
+  task();
+  return true;
+}
+
+//#################### PRIVATE MEMBER FUNCTIONS ####################
+
+bool TaskGroup::has_queued_tasks() const
+{
+  boost::lock_guard<boost::mutex> lock(m_queuedTasks->mutex);
+  return !m_queuedTasks->tasks.empty();
+}
+
+void TaskGroup::run_task(const ThreadPool::Task& task)
+{
+  std::string error;
+  try
+  {
+    task();
+  }
+  catch(std::exception& e)
+  {
+    error = e.what();
+  }
+  catch(...)
+  {
+    error = "Error: A task group task threw an unknown exception";
+  }
+
+  boost::lock_guard<boost::mutex> lock(m_mutex);
+  if(error != "" && m_error == "") m_error = error;
+  if(--m_pendingTaskCount == 0) m_tasksFinished.notify_all();
+}
+
+void TaskGroup::wait_for_tasks()
+{
+  for(;;)
+  {
+    // Help to run any of the group's own tasks that have not yet been started, so that waiting from within a task
+    // cannot deadlock the pool (each task is eventually run by whichever thread gets to it first).
+    while(run_queued_task(m_queuedTasks)) {}
+
+    // The group's remaining tasks (if any) must be running on other threads, so wait until they have finished,
+    // or until a new task is added to the group (e.g. by one of the running tasks) that we can help to run.
+    boost::unique_lock<boost::mutex> lock(m_mutex);
+    while(m_pendingTaskCount != 0 && !has_queued_tasks()) m_tasksFinished.wait(lock);
+    if(m_pendingTaskCount == 0) return;
+  }
+}
+
+}
@@ -5,18 +5,26 @@
 
 #include "misc/ThreadPool.h"
 
-#include <boost/bind.hpp>
+#include <algorithm>
+#include <iostream>
 
 namespace tvgutil {
 
 //#################### CONSTRUCTORS ####################
 
 ThreadPool::ThreadPool(size_t numThreads)
-: m_worker(new boost::asio::io_service::work(m_scheduler))
+: m_nextWorker(0), m_pendingTaskCount(0), m_shouldTerminate(false), m_sleepingWorkerCount(0)
 {
+  if(numThreads == 0) numThreads = std::max(1u, boost::thread::hardware_concurrency());
+
   for(size_t i = 0; i < numThreads; ++i)
   {
-    m_threads.create_thread(boost::bind(&boost::asio::io_service::run, &m_scheduler));
+    m_workers.push_back(Worker_Ptr(new Worker));
+  }
+
+  for(size_t i = 0; i < numThreads; ++i)
+  {
+    m_threads.create_thread(boost::bind(&ThreadPool::run_worker, this, i));
   }
 }
 
@@ -24,14 +32,15 @@ ThreadPool::ThreadPool(size_t numThreads)
 
 ThreadPool::~ThreadPool()
 {
-  // Stop executing the scheduler's run function, but allow running and queued tasks to finish cleanly.
-  m_worker.reset();
+  // Tell the workers to terminate once they have run all of the pending tasks.
+  {
+    boost::lock_guard<boost::mutex> lock(m_wakeMutex);
+    m_shouldTerminate = true;
+  }
+  m_taskAvailable.notify_all();
 
   // Wait for all threads to terminate.
   m_threads.join_all();
-
-  // Cleanly stop the scheduler.
-  m_scheduler.stop();
 }
 
 //#################### PUBLIC STATIC MEMBER FUNCTIONS ####################
@@ -42,4 +51,117 @@ ThreadPool& ThreadPool::instance()
   return s_instance;
 }
 
+//#################### PUBLIC MEMBER FUNCTIONS ####################
+
+size_t ThreadPool::get_thread_count() const
+{
+  return m_workers.size();
+}
+
+//#################### PRIVATE MEMBER FUNCTIONS ####################
+
+void ThreadPool::enqueue_task(const Task& task)
+{
+  // Note: The pending task count is incremented before the task is added to a deque, so that it can never underflow
+  //       (a worker that sees the count before the task arrives will briefly spin until it can take the task).
+  ++m_pendingTaskCount;
+
+  // If we're on one of the worker threads, add the task to the back of its own deque; if not, pick a worker in turn.
+  const size_t *workerIndex = m_workerIndex.get();
+  Worker& worker = *m_workers[workerIndex ? *workerIndex : m_nextWorker++ % m_workers.size()];
+  {
+    boost::lock_guard<boost::mutex> lock(worker.mutex);
+    worker.tasks.push_back(task);
+  }
+
+  // If any workers are sleeping, wake one of them. The wake mutex is briefly acquired to ensure that a worker that
+  // has just checked the pending task count (and found it to be zero) is actually waiting before we notify it.
+  if(m_sleepingWorkerCount > 0)
+  {
+    { boost::lock_guard<boost::mutex> lock(m_wakeMutex); }
+    m_taskAvailable.notify_one();
+  }
+}
+
+void ThreadPool::run_worker(size_t workerIndex)
+{
+  m_workerIndex.reset(new size_t(workerIndex));
+
+  Task task;
+  for(;;)
+  {
+    if(try_take_task(task))
+    {
+      run_task(task);
+      task.clear();
+      continue;
+    }
+
+    // If there are no tasks available, sleep until either a task is posted or the pool is being destroyed.
+    boost::unique_lock<boost::mutex> lock(m_wakeMutex);
+    ++m_sleepingWorkerCount;
+    while(m_pendingTaskCount == 0 && !m_shouldTerminate) m_taskAvailable.wait(lock);
+    --m_sleepingWorkerCount;
+
+    if(m_pendingTaskCount == 0 && m_shouldTerminate) return;
+  }
+}
+
+bool ThreadPool::try_take_task(Task& task)
+{
+  if(m_pendingTaskCount == 0) return false;
+
+  const size_t workerCount = m_workers.size();
+  const size_t *workerIndex = m_workerIndex.get();
+
+  // If we're on one of the worker threads, first try to take the most recently added task from its own deque.
+  if(workerIndex)
+  {
+    Worker& worker = *m_workers[*workerIndex];
+    boost::lock_guard<boost::mutex> lock(worker.mutex);
+    if(!worker.tasks.empty())
+    {
+      task.swap(worker.tasks.back());
+      worker.tasks.pop_back();
+      --m_pendingTaskCount;
+      return true;
+    }
+  }
+
+  // Otherwise, try to steal the oldest task from one of the other workers' deques.
+  const size_t start = workerIndex ? *workerIndex + 1 : 0;
+  for(size_t i = 0; i < workerCount; ++i)
+  {
+    Worker& victim = *m_workers[(start + i) % workerCount];
+    boost::lock_guard<boost::mutex> lock(victim.mutex);
+    if(!victim.tasks.empty())
+    {
+      task.swap(victim.tasks.front());
+      victim.tasks.pop_front();
+      --m_pendingTaskCount;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+//#################### PRIVATE STATIC MEMBER FUNCTIONS ####################
+
+void ThreadPool::run_task(const Task& task)
+{
+  try
+  {
+    task();
+  }
+  catch(std::exception& e)
+  {
+    std::cerr << "Warning: A thread pool task threw an exception: " << e.what() << '\n';
+  }
+  catch(...)
+  {
+    std::cerr << "Warning: A thread pool task threw an unknown exception\n";
+  }
+}
+
 }
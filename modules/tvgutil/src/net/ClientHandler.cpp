@@ -5,6 +5,8 @@
 
 #include "net/ClientHandler.h"
 
+#include <stdexcept>
+
 namespace tvgutil {
 
 //#################### CONSTRUCTORS ####################
@@ -33,6 +35,12 @@ void ClientHandler::run_iter()
   // No-op by default
 }
 
+void ClientHandler::run_iter_async(const Continuation&)
+{
+  // Handlers that support asynchronous operation must override this.
+  throw std::runtime_error("Error: This client handler does not support asynchronous operation");
+}
+
 void ClientHandler::run_post()
 {
   // No-op by default
@@ -43,8 +51,29 @@ void ClientHandler::run_pre()
   // No-op by default
 }
 
+void ClientHandler::run_pre_async(const Continuation& done)
+{
+  // No-op by default
+  done();
+}
+
+bool ClientHandler::supports_async() const
+{
+  return false;
+}
+
 //#################### PRIVATE MEMBER FUNCTIONS ####################
 
+void ClientHandler::async_message_handler(const boost::system::error_code& err, const Continuation& next, const Continuation& done)
+{
+  if(err || *m_shouldTerminate)
+  {
+    m_connectionOk = false;
+    done();
+  }
+  else next();
+}
+
 void ClientHandler::read_message_handler(const boost::system::error_code& err, boost::optional<boost::system::error_code>& ret)
 {
   // Store any error message so that it can be examined by read_message.
@@ -0,0 +1,189 @@
+/**
+ * tvgutil: SharedMemoryMessageRing.cpp
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#include "net/SharedMemoryMessageRing.h"
+using namespace boost::interprocess;
+
+#include <cstring>
+#include <limits>
+#include <new>
+#include <stdexcept>
+
+#include <boost/cstdint.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/interprocess/sync/interprocess_semaphore.hpp>
+
+namespace tvgutil {
+
+//#################### NESTED TYPES ####################
+
+struct SharedMemoryMessageRing::Header
+{
+  /** A value used to check that an opened segment actually contains a ring. */
+  boost::uint32_t magic;
+
+  /** The number of slots in the ring. */
+  boost::uint32_t slotCount;
+
+  /** The size (in bytes) of each slot in the ring. */
+  boost::uint64_t slotSize;
+
+  /** A semaphore counting the number of slots that are free for the writer to fill. */
+  interprocess_semaphore freeSlots;
+
+  /** A semaphore counting the number of slots that have been filled and are waiting for the reader. */
+  interprocess_semaphore fullSlots;
+
+  Header(size_t slotCount_, size_t slotSize_)
+  : magic(MAGIC), slotCount(static_cast<boost::uint32_t>(slotCount_)), slotSize(slotSize_),
+    freeSlots(static_cast<unsigned int>(slotCount_)), fullSlots(0)
+  {}
+
+  /** The value stored in the magic field of a valid ring. */
+  static const boost::uint32_t MAGIC = 0x52474244;
+
+  /** The offset of the first slot from the start of the segment (the slots are aligned to cache lines). */
+  static size_t slots_offset()
+  {
+    return (sizeof(Header) + 63) & ~static_cast<size_t>(63);
+  }
+};
+
+//#################### CONSTRUCTORS ####################
+
+SharedMemoryMessageRing::SharedMemoryMessageRing(const std::string& name, bool owner, size_t slotCount, size_t slotSize)
+: m_header(NULL), m_name(name), m_owner(owner), m_readIndex(0), m_slots(NULL), m_writeIndex(0)
+{
+  if(owner)
+  {
+    // Create the segment, size it to hold the header and the slots, and construct the header in place.
+    shared_memory_object(create_only, name.c_str(), read_write).swap(m_sharedMemory);
+    m_sharedMemory.truncate(static_cast<offset_t>(Header::slots_offset() + slotCount * slotSize));
+    mapped_region(m_sharedMemory, read_write).swap(m_region);
+    m_header = new (m_region.get_address()) Header(slotCount, slotSize);
+  }
+  else
+  {
+    // Open the existing segment and check that it contains a valid ring.
+    shared_memory_object(open_only, name.c_str(), read_write).swap(m_sharedMemory);
+    mapped_region(m_sharedMemory, read_write).swap(m_region);
+    m_header = static_cast<Header*>(m_region.get_address());
+
+    // Note that the slot layout is checked against the size of the mapped region without forming the product of
+    // the slot count and slot size, since a corrupt header could otherwise cause that product to overflow.
+    const size_t regionSize = m_region.get_size();
+    bool valid = regionSize >= Header::slots_offset() && m_header->magic == Header::MAGIC;
+    if(valid)
+    {
+      const boost::uint64_t slotsSize = regionSize - Header::slots_offset();
+      const boost::uint64_t slotCount = m_header->slotCount, slotSize = m_header->slotSize;
+      valid = slotCount > 0 && slotSize > 0 && slotsSize % slotCount == 0 && slotsSize / slotCount == slotSize;
+    }
+
+    if(!valid)
+    {
+      throw std::runtime_error("Error: Shared memory segment '" + name + "' does not contain a valid message ring");
+    }
+  }
+
+  m_slots = static_cast<char*>(m_region.get_address()) + Header::slots_offset();
+}
+
+//#################### DESTRUCTOR ####################
+
+SharedMemoryMessageRing::~SharedMemoryMessageRing()
+{
+  if(m_owner)
+  {
+    m_header->~Header();
+    shared_memory_object::remove(m_name.c_str());
+  }
+}
+
+//#################### PUBLIC STATIC MEMBER FUNCTIONS ####################
+
+SharedMemoryMessageRing_Ptr SharedMemoryMessageRing::create(const std::string& name, size_t slotCount, size_t slotSize)
+{
+  if(slotCount == 0 || slotSize == 0) throw std::invalid_argument("Error: A shared memory message ring must have a non-zero number of non-empty slots");
+  if(slotCount > std::numeric_limits<boost::uint32_t>::max()) throw std::invalid_argument("Error: Too many slots for a shared memory message ring");
+
+  // Remove any stale segment with the same name (e.g. one left behind by a process that crashed).
+  shared_memory_object::remove(name.c_str());
+  return SharedMemoryMessageRing_Ptr(new SharedMemoryMessageRing(name, true, slotCount, slotSize));
+}
+
+SharedMemoryMessageRing_Ptr SharedMemoryMessageRing::open(const std::string& name)
+{
+  return SharedMemoryMessageRing_Ptr(new SharedMemoryMessageRing(name, false, 0, 0));
+}
+
+//#################### PUBLIC MEMBER FUNCTIONS ####################
+
+const char *SharedMemoryMessageRing::begin_read(const boost::posix_time::time_duration& timeout)
+{
+  const boost::posix_time::ptime deadline = boost::posix_time::microsec_clock::universal_time() + timeout;
+  return m_header->fullSlots.timed_wait(deadline) ? get_slot(m_readIndex) : NULL;
+}
+
+char *SharedMemoryMessageRing::begin_write(const boost::posix_time::time_duration& timeout)
+{
+  const boost::posix_time::ptime deadline = boost::posix_time::microsec_clock::universal_time() + timeout;
+  return m_header->freeSlots.timed_wait(deadline) ? get_slot(m_writeIndex) : NULL;
+}
+
+void SharedMemoryMessageRing::end_read()
+{
+  m_readIndex = (m_readIndex + 1) % m_header->slotCount;
+  m_header->freeSlots.post();
+}
+
+void SharedMemoryMessageRing::end_write()
+{
+  m_writeIndex = (m_writeIndex + 1) % m_header->slotCount;
+  m_header->fullSlots.post();
+}
+
+const std::string& SharedMemoryMessageRing::get_name() const
+{
+  return m_name;
+}
+
+size_t SharedMemoryMessageRing::get_slot_size() const
+{
+  return static_cast<size_t>(m_header->slotSize);
+}
+
+bool SharedMemoryMessageRing::read_message(Message& msg, const boost::posix_time::time_duration& timeout)
+{
+  if(msg.get_size() != get_slot_size()) throw std::invalid_argument("Error: The message size does not match the slot size of the shared memory message ring");
+
+  const char *slot = begin_read(timeout);
+  if(!slot) return false;
+
+  memcpy(msg.get_data_ptr(), slot, msg.get_size());
+  end_read();
+  return true;
+}
+
+bool SharedMemoryMessageRing::write_message(const Message& msg, const boost::posix_time::time_duration& timeout)
+{
+  if(msg.get_size() != get_slot_size()) throw std::invalid_argument("Error: The message size does not match the slot size of the shared memory message ring");
+
+  char *slot = begin_write(timeout);
+  if(!slot) return false;
+
+  memcpy(slot, msg.get_data_ptr(), msg.get_size());
+  end_write();
+  return true;
+}
+
+//#################### PRIVATE MEMBER FUNCTIONS ####################
+
+char *SharedMemoryMessageRing::get_slot(size_t index) const
+{
+  return m_slots + index * m_header->slotSize;
+}
+
+}
@@ -27,4 +27,9 @@ int RandomNumberGenerator::generate_int_from_uniform(int lower, int upper)
   return dist(*m_gen) + lower;
 }
 
+unsigned int RandomNumberGenerator::get_seed() const
+{
+  return m_seed;
+}
+
 }
@@ -0,0 +1,43 @@
+/**
+ * tvgutil: StageStatistics.cpp
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#include "timing/StageStatistics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace tvgutil {
+
+//#################### PUBLIC STATIC MEMBER FUNCTIONS ####################
+
+StageStatistics StageStatistics::compute(const std::string& name, std::vector<double> durationsMs)
+{
+  if(durationsMs.empty()) throw std::runtime_error("Error: Cannot compute the statistics for stage '" + name + "', since it has no recorded durations");
+
+  std::sort(durationsMs.begin(), durationsMs.end());
+
+  double totalMs = 0.0;
+  for(size_t i = 0, size = durationsMs.size(); i < size; ++i) totalMs += durationsMs[i];
+
+  StageStatistics stats;
+  stats.count = durationsMs.size();
+  stats.maxMs = durationsMs.back();
+  stats.meanMs = totalMs / durationsMs.size();
+  stats.name = name;
+  stats.p50Ms = nearest_rank_percentile(durationsMs, 50.0);
+  stats.p95Ms = nearest_rank_percentile(durationsMs, 95.0);
+  stats.p99Ms = nearest_rank_percentile(durationsMs, 99.0);
+  return stats;
+}
+
+double StageStatistics::nearest_rank_percentile(const std::vector<double>& sortedValues, double percentile)
+{
+  size_t rank = static_cast<size_t>(std::ceil(percentile / 100.0 * sortedValues.size()));
+  if(rank < 1) rank = 1;
+  return sortedValues[rank - 1];
+}
+
+}
@@ -0,0 +1,265 @@
+/**
+ * tvgutil: Tracer.cpp
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#include "timing/Tracer.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <stdexcept>
+
+#include <boost/thread/lock_guard.hpp>
+
+#ifdef WITH_CUDA
+#include <cuda_runtime.h>
+#endif
+
+namespace tvgutil {
+
+//#################### HELPER FUNCTIONS ####################
+
+/**
+ * \brief Writes a string to a stream as a JSON string literal.
+ *
+ * \param os  The stream.
+ * \param s   The string.
+ */
+static void write_json_string(std::ostream& os, const char *s)
+{
+  os << '"';
+  for(; *s; ++s)
+  {
+    if(*s == '"' || *s == '\\') os << '\\' << *s;
+    else if(static_cast<unsigned char>(*s) < 0x20) os << ' ';
+    else os << *s;
+  }
+  os << '"';
+}
+
+//#################### SINGLETON IMPLEMENTATION ####################
+
+Tracer::Tracer()
+: m_bufferCapacity(65536), m_enabled(false), m_gpuSync(false), m_origin(boost::chrono::steady_clock::now()), m_threadBuffer(&Tracer::release_thread_buffer)
+{}
+
+Tracer& Tracer::instance()
+{
+  static Tracer s_instance;
+  return s_instance;
+}
+
+//#################### PUBLIC MEMBER FUNCTIONS ####################
+
+boost::uint64_t Tracer::begin_scope()
+{
+  sync_gpu_if_needed();
+  ++get_thread_buffer().depth;
+  return now_ns();
+}
+
+void Tracer::clear()
+{
+  boost::lock_guard<boost::mutex> lock(m_mutex);
+  for(size_t i = 0, size = m_buffers.size(); i < size; ++i)
+  {
+    // Note: The counts are only ever written by the owning thread, so rather than resetting them, we record how far
+    //       the thread has got and have the exporters ignore any events before that point.
+    m_buffers[i]->clearedCount = m_buffers[i]->startedCount.load(boost::memory_order_relaxed);
+  }
+}
+
+std::vector<StageStatistics> Tracer::compute_statistics() const
+{
+  std::vector<size_t> threadIndices;
+  std::vector<Event> events = collect_events(threadIndices);
+
+  // Group the durations of the events by name (the names are compared as strings, since the same literal may have different addresses in different modules).
+  std::map<std::string,std::vector<double> > durationsMsByName;
+  for(size_t i = 0, size = events.size(); i < size; ++i)
+  {
+    durationsMsByName[events[i].name].push_back(events[i].durationNs / 1000000.0);
+  }
+
+  std::vector<StageStatistics> result;
+  result.reserve(durationsMsByName.size());
+  for(std::map<std::string,std::vector<double> >::const_iterator it = durationsMsByName.begin(), iend = durationsMsByName.end(); it != iend; ++it)
+  {
+    result.push_back(StageStatistics::compute(it->first, it->second));
+  }
+
+  return result;
+}
+
+void Tracer::end_scope(const char *name, boost::uint64_t startNs)
+{
+  sync_gpu_if_needed();
+  const boost::uint64_t endNs = now_ns();
+
+  ThreadBuffer& buffer = get_thread_buffer();
+  --buffer.depth;
+
+  // Only this thread ever writes to the buffer, so the count can be read relaxed. The write is announced
+  // (via startedCount) before the slot is touched, and published (via eventCount) after it is complete,
+  // so that a concurrent exporter can detect and discard any slots that were overwritten while it was
+  // copying them (in the manner of a seqlock).
+  const size_t count = buffer.eventCount.load(boost::memory_order_relaxed);
+  buffer.startedCount.store(count + 1, boost::memory_order_relaxed);
+  boost::atomic_thread_fence(boost::memory_order_release);
+
+  Slot& slot = buffer.slots[count % buffer.capacity];
+  slot.depth.store(buffer.depth, boost::memory_order_relaxed);
+  slot.durationNs.store(endNs - startNs, boost::memory_order_relaxed);
+  slot.name.store(name, boost::memory_order_relaxed);
+  slot.startNs.store(startNs, boost::memory_order_relaxed);
+  buffer.eventCount.store(count + 1, boost::memory_order_release);
+}
+
+void Tracer::set_buffer_capacity(size_t bufferCapacity)
+{
+  if(bufferCapacity == 0) throw std::runtime_error("Error: The tracer's buffer capacity must be non-zero");
+  boost::lock_guard<boost::mutex> lock(m_mutex);
+  m_bufferCapacity = bufferCapacity;
+}
+
+void Tracer::set_enabled(bool enabled)
+{
+  m_enabled.store(enabled, boost::memory_order_relaxed);
+}
+
+void Tracer::set_gpu_sync(bool gpuSync)
+{
+  m_gpuSync.store(gpuSync, boost::memory_order_relaxed);
+}
+
+void Tracer::write_chrome_trace(const std::string& path) const
+{
+  std::vector<size_t> threadIndices;
+  std::vector<Event> events = collect_events(threadIndices);
+
+  std::ofstream fs(path.c_str());
+  if(!fs) throw std::runtime_error("Error: Could not open trace file '" + path + "' for writing");
+
+  // Note: Chrome expects the timestamps and durations of complete ("X") events to be in microseconds.
+  fs << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+  fs << std::fixed << std::setprecision(3);
+  for(size_t i = 0, size = events.size(); i < size; ++i)
+  {
+    const Event& e = events[i];
+    fs << "{\"name\":";
+    write_json_string(fs, e.name);
+    fs << ",\"ph\":\"X\",\"ts\":" << e.startNs / 1000.0 << ",\"dur\":" << e.durationNs / 1000.0
+       << ",\"pid\":1,\"tid\":" << threadIndices[i] << ",\"args\":{\"depth\":" << e.depth << "}}";
+    if(i + 1 != size) fs << ',';
+    fs << '\n';
+  }
+  fs << "]}\n";
+
+  if(!fs) throw std::runtime_error("Error: Could not write trace file '" + path + "'");
+}
+
+void Tracer::write_summary(std::ostream& os) const
+{
+  const std::vector<StageStatistics> stats = compute_statistics();
+
+  size_t nameWidth = 5;
+  for(size_t i = 0, size = stats.size(); i < size; ++i) nameWidth = std::max(nameWidth, stats[i].name.length());
+
+  const std::ios_base::fmtflags oldFlags = os.flags();
+  const std::streamsize oldPrecision = os.precision();
+
+  os << std::left << std::setw(static_cast<int>(nameWidth) + 2) << "Stage" << std::right
+     << std::setw(10) << "Count" << std::setw(12) << "Mean (ms)" << std::setw(12) << "p50 (ms)"
+     << std::setw(12) << "p95 (ms)" << std::setw(12) << "p99 (ms)" << std::setw(12) << "Max (ms)" << '\n';
+
+  os << std::fixed << std::setprecision(3);
+  for(size_t i = 0, size = stats.size(); i < size; ++i)
+  {
+    const StageStatistics& s = stats[i];
+    os << std::left << std::setw(static_cast<int>(nameWidth) + 2) << s.name << std::right
+       << std::setw(10) << s.count << std::setw(12) << s.meanMs << std::setw(12) << s.p50Ms
+       << std::setw(12) << s.p95Ms << std::setw(12) << s.p99Ms << std::setw(12) << s.maxMs << '\n';
+  }
+
+  os.flags(oldFlags);
+  os.precision(oldPrecision);
+}
+
+//#################### PRIVATE MEMBER FUNCTIONS ####################
+
+std::vector<Tracer::Event> Tracer::collect_events(std::vector<size_t>& threadIndices) const
+{
+  std::vector<Event> result;
+  threadIndices.clear();
+
+  boost::lock_guard<boost::mutex> lock(m_mutex);
+  for(size_t i = 0, size = m_buffers.size(); i < size; ++i)
+  {
+    const ThreadBuffer& buffer = *m_buffers[i];
+    const size_t capacity = buffer.capacity;
+
+    // Copy the events that are currently in the ring buffer (ignoring any that have been cleared). Since the owning thread may
+    // still be recording, check how far it has got afterwards and discard any slots that may have been overwritten.
+    const size_t countBefore = buffer.eventCount.load(boost::memory_order_acquire);
+    const size_t first = std::min(std::max(countBefore > capacity ? countBefore - capacity : 0, buffer.clearedCount), countBefore);
+    std::vector<Event> events;
+    events.reserve(countBefore - first);
+    for(size_t j = first; j < countBefore; ++j)
+    {
+      const Slot& slot = buffer.slots[j % capacity];
+      Event e;
+      e.depth = slot.depth.load(boost::memory_order_relaxed);
+      e.durationNs = slot.durationNs.load(boost::memory_order_relaxed);
+      e.name = slot.name.load(boost::memory_order_relaxed);
+      e.startNs = slot.startNs.load(boost::memory_order_relaxed);
+      events.push_back(e);
+    }
+
+    boost::atomic_thread_fence(boost::memory_order_acquire);
+    const size_t startedAfter = buffer.startedCount.load(boost::memory_order_relaxed);
+    const size_t firstValid = startedAfter > capacity ? startedAfter - capacity : 0;
+    const size_t skip = std::min(firstValid > first ? firstValid - first : 0, events.size());
+
+    result.insert(result.end(), events.begin() + skip, events.end());
+    threadIndices.insert(threadIndices.end(), events.size() - skip, buffer.threadIndex);
+  }
+
+  return result;
+}
+
+Tracer::ThreadBuffer& Tracer::get_thread_buffer()
+{
+  ThreadBuffer *buffer = m_threadBuffer.get();
+  if(!buffer)
+  {
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+    ThreadBuffer_Ptr newBuffer(new ThreadBuffer(m_bufferCapacity, m_buffers.size()));
+    m_buffers.push_back(newBuffer);
+    buffer = newBuffer.get();
+    m_threadBuffer.reset(buffer);
+  }
+  return *buffer;
+}
+
+boost::uint64_t Tracer::now_ns() const
+{
+  return boost::chrono::duration_cast<boost::chrono::nanoseconds>(boost::chrono::steady_clock::now() - m_origin).count();
+}
+
+void Tracer::sync_gpu_if_needed() const
+{
+#ifdef WITH_CUDA
+  if(m_gpuSync.load(boost::memory_order_relaxed)) cudaDeviceSynchronize();
+#endif
+}
+
+//#################### PRIVATE STATIC MEMBER FUNCTIONS ####################
+
+void Tracer::release_thread_buffer(ThreadBuffer *)
+{
+  // No-op: the buffers are owned by the tracer, so that their events survive the threads that recorded them.
+}
+
+}
@@ -58,4 +58,29 @@ BOOST_AUTO_TEST_CASE(optimise_for_parameters_test)
   BOOST_CHECK_CLOSE(cost, expectedCost, TOL);
 }
 
+BOOST_AUTO_TEST_CASE(parallel_optimise_for_parameters_test)
+{
+  // Check that evaluating parameter sets concurrently makes exactly the same choices as evaluating them one at a time.
+  const unsigned int seed = 12345;
+  const size_t epochCount = 10;
+  CoordinateDescentParameterOptimiser serialOptimiser(sum_squares_cost_fn, epochCount, seed);
+  CoordinateDescentParameterOptimiser parallelOptimiser(sum_squares_cost_fn, epochCount, seed);
+  parallelOptimiser.set_evaluation_thread_count(4);
+
+  CoordinateDescentParameterOptimiser *optimisers[] = { &serialOptimiser, &parallelOptimiser };
+  for(int i = 0; i < 2; ++i)
+  {
+    optimisers[i]->add_param("Foo", NumberSequenceGenerator::generate_stepped<float>(-5.5f, 1.5f, 5.0f))
+                  .add_param("Bar", NumberSequenceGenerator::generate_stepped<float>(-1000.0f, 1.0f, 5.0f))
+                  .add_param("Boo", list_of<float>(-10.0f)(-5.0f)(-2.0f)(0.0f)(5.0f)(15.0f));
+  }
+
+  float serialCost, parallelCost;
+  ParamSet serialParams = serialOptimiser.optimise_for_parameters(&serialCost);
+  ParamSet parallelParams = parallelOptimiser.optimise_for_parameters(&parallelCost);
+
+  BOOST_CHECK_EQUAL(ParamSetUtil::param_set_to_string(parallelParams), ParamSetUtil::param_set_to_string(serialParams));
+  BOOST_CHECK_EQUAL(parallelCost, serialCost);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
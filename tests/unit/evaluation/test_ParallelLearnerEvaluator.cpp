@@ -0,0 +1,104 @@
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+
+#include <sstream>
+
+#include <boost/assign/list_of.hpp>
+using boost::assign::list_of;
+
+#include <evaluation/core/ParallelLearnerEvaluator.h>
+#include <evaluation/core/PerformanceMeasureUtil.h>
+#include <evaluation/splitgenerators/RandomPermutationAndDivisionSplitGenerator.h>
+#include <evaluation/util/CartesianProductParameterSetGenerator.h>
+using namespace evaluation;
+
+#include <tvgutil/containers/MapUtil.h>
+#include <tvgutil/numbers/RandomNumberGenerator.h>
+using namespace tvgutil;
+
+//#################### HELPER TYPES ####################
+
+/**
+ * \brief An instance of this class "evaluates" a dummy learner whose results depend on its seed and the examples in each split.
+ */
+class DummyEvaluator : public LearnerEvaluator<int,PerformanceResult>
+{
+private:
+  unsigned int m_seed;
+
+public:
+  DummyEvaluator(const SplitGenerator_Ptr& splitGenerator, const ParamSet& params)
+  : LearnerEvaluator<int,PerformanceResult>(splitGenerator)
+  {
+    MapUtil::typed_lookup(params, "seed", m_seed);
+  }
+
+  static boost::shared_ptr<const LearnerEvaluator<int,PerformanceResult> > make(const SplitGenerator_Ptr& splitGenerator, const ParamSet& params)
+  {
+    return boost::shared_ptr<const LearnerEvaluator<int,PerformanceResult> >(new DummyEvaluator(splitGenerator, params));
+  }
+
+protected:
+  virtual PerformanceResult average_results(const std::vector<PerformanceResult>& results) const
+  {
+    return PerformanceMeasureUtil::average_results(results);
+  }
+
+  virtual PerformanceResult evaluate_on_split(const std::vector<Example_CPtr>& examples, const SplitGenerator::Split& split) const
+  {
+    // Each "learner" uses its own random number generator, so the result is independent of which thread runs it.
+    RandomNumberGenerator rng(m_seed);
+    float value = 0.0f;
+    for(size_t i = 0, size = split.second.size(); i < size; ++i)
+    {
+      value += *examples[split.second[i]] * rng.generate_real_from_uniform(0.0f, 1.0f);
+    }
+
+    PerformanceResult result;
+    result.insert(std::make_pair("Score", PerformanceMeasure(value)));
+    return result;
+  }
+};
+
+BOOST_AUTO_TEST_SUITE(test_ParallelLearnerEvaluator)
+
+BOOST_AUTO_TEST_CASE(evaluate_test)
+{
+  std::vector<boost::shared_ptr<const int> > examples;
+  for(int i = 0; i < 100; ++i) examples.push_back(boost::shared_ptr<const int>(new int(i)));
+
+  std::vector<ParamSet> paramSets = CartesianProductParameterSetGenerator()
+    .add_param("seed", list_of<unsigned int>(1)(2)(3)(4)(5)(6)(7))
+    .generate_param_sets();
+
+  const unsigned int splitSeed = 12345;
+  const size_t splitCount = 5;
+  const float ratio = 0.5f;
+
+  // Evaluate the parameter sets one at a time.
+  PerformanceTable serialTable(list_of("Score"));
+  {
+    SplitGenerator_Ptr splitGenerator(new RandomPermutationAndDivisionSplitGenerator(splitSeed, splitCount, ratio));
+    for(size_t i = 0, size = paramSets.size(); i < size; ++i)
+    {
+      serialTable.record_performance(paramSets[i], DummyEvaluator(splitGenerator, paramSets[i]).evaluate(examples));
+    }
+  }
+
+  // Evaluate the parameter sets all at once on a separate pool, and check that the results (and their order) are identical.
+  PerformanceTable parallelTable(list_of("Score"));
+  {
+    SplitGenerator_Ptr splitGenerator(new RandomPermutationAndDivisionSplitGenerator(splitSeed, splitCount, ratio));
+    ThreadPool pool(4);
+    ParallelLearnerEvaluator<int> evaluator(boost::bind(&DummyEvaluator::make, splitGenerator, _1), pool);
+    evaluator.set_progress_stream(NULL);
+    evaluator.evaluate(paramSets, examples, parallelTable);
+  }
+
+  std::ostringstream serialOutput, parallelOutput;
+  serialTable.output(serialOutput);
+  parallelTable.output(parallelOutput);
+  BOOST_CHECK_EQUAL(serialOutput.str(), parallelOutput.str());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
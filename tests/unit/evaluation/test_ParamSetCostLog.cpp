@@ -0,0 +1,75 @@
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+
+#include <boost/assign/list_of.hpp>
+#include <boost/filesystem.hpp>
+using boost::assign::list_of;
+using boost::assign::map_list_of;
+
+#include <evaluation/util/ParamSetCostLog.h>
+using namespace evaluation;
+
+namespace bf = boost::filesystem;
+
+BOOST_AUTO_TEST_SUITE(test_ParamSetCostLog)
+
+BOOST_AUTO_TEST_CASE(context_test)
+{
+  const bf::path logPath = bf::temp_directory_path() / bf::unique_path("test_ParamSetCostLog-%%%%-%%%%.log");
+
+  ParamSet params = map_list_of("Foo","1")("Bar","2");
+  ParamSet context1 = map_list_of("Threads","1");
+  ParamSet context4 = map_list_of("Threads","4");
+
+  // Record the cost of a parameter set in a log with one context.
+  {
+    ParamSetCostLog log(logPath.string(), std::vector<std::string>(), context1);
+    log.record_cost(params, 0.1f);
+    BOOST_CHECK_EQUAL(*log.lookup_cost(params), 0.1f);
+  }
+
+  // Reopen the log with a different context, and check that the cost is not reused.
+  {
+    ParamSetCostLog log(logPath.string(), std::vector<std::string>(), context4);
+    BOOST_CHECK_EQUAL(log.get_entry_count(), 1);
+    BOOST_CHECK(!log.lookup_cost(params));
+  }
+
+  // Reopen the log with the original context, and check that the cost is reused.
+  {
+    ParamSetCostLog log(logPath.string(), std::vector<std::string>(), context1);
+    BOOST_CHECK_EQUAL(*log.lookup_cost(params), 0.1f);
+  }
+
+  bf::remove(logPath);
+}
+
+BOOST_AUTO_TEST_CASE(resume_test)
+{
+  const bf::path logPath = bf::temp_directory_path() / bf::unique_path("test_ParamSetCostLog-%%%%-%%%%.log");
+
+  ParamSet params1 = map_list_of("Foo","1")("Bar","2");
+  ParamSet params2 = map_list_of("Foo","1")("Bar","3");
+
+  // Record the cost of a parameter set in a new log.
+  {
+    ParamSetCostLog log(logPath.string(), list_of<std::string>("Time"));
+    BOOST_CHECK(!log.lookup_cost(params1));
+    log.record_cost(params1, 0.1f, list_of<std::string>("23"));
+    BOOST_CHECK_EQUAL(*log.lookup_cost(params1), 0.1f);
+    BOOST_CHECK(!log.lookup_cost(params2));
+    BOOST_CHECK_THROW(log.record_cost(params2, 0.2f), std::invalid_argument);
+  }
+
+  // Reopen the log, and check that the cost was loaded exactly.
+  {
+    ParamSetCostLog log(logPath.string(), list_of<std::string>("Time"));
+    BOOST_CHECK_EQUAL(log.get_entry_count(), 1);
+    BOOST_CHECK_EQUAL(*log.lookup_cost(params1), 0.1f);
+    BOOST_CHECK(!log.lookup_cost(params2));
+  }
+
+  bf::remove(logPath);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,54 @@
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+
+#include <itmx/remotemapping/AdaptiveCompressionController.h>
+using namespace itmx;
+
+BOOST_AUTO_TEST_SUITE(test_AdaptiveCompressionController)
+
+BOOST_AUTO_TEST_CASE(degrade_test)
+{
+  AdaptiveCompressionController controller(50.0, 1, 2);
+  const int initialQuality = controller.get_rgb_jpeg_quality();
+  BOOST_CHECK_EQUAL(controller.get_rgb_downscale_factor(), 1);
+  BOOST_CHECK_EQUAL(controller.get_frame_skip(), 0);
+
+  // A single slow frame should cause the quality to be reduced.
+  BOOST_CHECK(controller.record_frame(200.0, 0));
+  BOOST_CHECK_LT(controller.get_rgb_jpeg_quality(), initialQuality);
+
+  // A persistently overloaded link should eventually cause the controller to downscale the RGB images and then skip frames.
+  for(int i = 0; i < 100; ++i) controller.record_frame(200.0, 1);
+  BOOST_CHECK_GT(controller.get_rgb_downscale_factor(), 1);
+  BOOST_CHECK_EQUAL(controller.get_frame_skip(), 2);
+
+  // Check that frames are skipped at the expected rate.
+  BOOST_CHECK(controller.should_send_frame());
+  BOOST_CHECK(!controller.should_send_frame());
+  BOOST_CHECK(!controller.should_send_frame());
+  BOOST_CHECK(controller.should_send_frame());
+}
+
+BOOST_AUTO_TEST_CASE(recover_test)
+{
+  AdaptiveCompressionController controller(50.0, 1, 2);
+  const int initialQuality = controller.get_rgb_jpeg_quality();
+  for(int i = 0; i < 100; ++i) controller.record_frame(200.0, 1);
+
+  // Once the link recovers, the controller should eventually return to its initial settings.
+  for(int i = 0; i < 1000; ++i) controller.record_frame(1.0, 0);
+  BOOST_CHECK_EQUAL(controller.get_frame_skip(), 0);
+  BOOST_CHECK_EQUAL(controller.get_rgb_downscale_factor(), 1);
+  BOOST_CHECK_EQUAL(controller.get_rgb_jpeg_quality(), initialQuality);
+}
+
+BOOST_AUTO_TEST_CASE(stable_test)
+{
+  // A link that is comfortably within the target latency should not cause the settings to change.
+  AdaptiveCompressionController controller(50.0, 1, 2);
+  const int initialQuality = controller.get_rgb_jpeg_quality();
+  for(int i = 0; i < 100; ++i) BOOST_CHECK(!controller.record_frame(35.0, 0));
+  BOOST_CHECK_EQUAL(controller.get_rgb_jpeg_quality(), initialQuality);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
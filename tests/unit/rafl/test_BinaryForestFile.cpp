@@ -0,0 +1,173 @@
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#include <boost/assign/list_of.hpp>
+using boost::assign::list_of;
+using boost::assign::map_list_of;
+
+#include <rafl/core/BinaryForestFile.h>
+#include <rafl/examples/UnitCircleExampleGenerator.h>
+using namespace rafl;
+
+typedef int Label;
+typedef boost::shared_ptr<const Example<Label> > Example_CPtr;
+typedef boost::shared_ptr<RandomForest<Label> > RF_Ptr;
+
+/**
+ * \brief Checks that two forests predict the same labels for a grid of descriptors.
+ *
+ * \param lhs The first forest.
+ * \param rhs The second forest.
+ */
+void check_predictions(const RandomForest<Label>& lhs, const RandomForest<Label>& rhs)
+{
+  for(float y = -1.5f; y <= 1.5f; y += 0.05f)
+  {
+    for(float x = -1.5f; x <= 1.5f; x += 0.05f)
+    {
+      Descriptor_CPtr descriptor(new Descriptor(list_of(x)(y)));
+      BOOST_REQUIRE_EQUAL(lhs.predict(descriptor), rhs.predict(descriptor));
+    }
+  }
+}
+
+/**
+ * \brief Makes a small forest that has been trained on examples around the unit circle.
+ *
+ * \param generator The generator to use to make the examples.
+ * \return          The forest.
+ */
+RF_Ptr make_forest(UnitCircleExampleGenerator<Label>& generator)
+{
+  DecisionFunctionGeneratorFactory<Label>::instance().register_rafl_makers();
+
+  std::map<std::string,std::string> settings = map_list_of<std::string,std::string>
+    ("candidateCount", "64")
+    ("decisionFunctionGeneratorParams", "")
+    ("decisionFunctionGeneratorType", "PairwiseOpAndThreshold")
+    ("gainThreshold", "0")
+    ("maxClassSize", "1000")
+    ("maxTreeHeight", "20")
+    ("randomSeed", "1234")
+    ("seenExamplesThreshold", "20")
+    ("splittabilityThreshold", "0.5")
+    ("usePMFReweighting", "1");
+
+  RF_Ptr forest(new RandomForest<Label>(4, DecisionTree<Label>::Settings(settings)));
+  for(int step = 0; step < 5; ++step)
+  {
+    forest->add_examples(generator.generate_examples(list_of(1)(2)(3)(4), 50));
+    forest->train(step + 1);
+  }
+
+  return forest;
+}
+
+/**
+ * \brief Gets the textual representation of a forest.
+ *
+ * \param forest  The forest.
+ * \return        The textual representation of the forest.
+ */
+std::string to_string(const RandomForest<Label>& forest)
+{
+  std::ostringstream oss;
+  forest.output(oss);
+  forest.output_statistics(oss);
+  return oss.str();
+}
+
+BOOST_AUTO_TEST_SUITE(test_BinaryForestFile)
+
+BOOST_AUTO_TEST_CASE(corruption_test)
+{
+  const std::string path = "test_BinaryForestFile_corruption.bin";
+  UnitCircleExampleGenerator<Label> generator(list_of(1)(2)(3)(4), 1234);
+  RF_Ptr forest = make_forest(generator);
+  BinaryForestFile<Label>::save(*forest, path);
+
+  std::vector<char> bytes;
+  {
+    std::ifstream fs(path.c_str(), std::ios::binary);
+    bytes.assign(std::istreambuf_iterator<char>(fs), std::istreambuf_iterator<char>());
+  }
+
+  // Corrupting the header should be detected when the file is opened.
+  bytes[30] ^= 1;
+  {
+    std::ofstream fs(path.c_str(), std::ios::binary);
+    fs.write(&bytes[0], bytes.size());
+  }
+  BOOST_CHECK_THROW(BinaryForestFile<Label> file(path), std::runtime_error);
+  bytes[30] ^= 1;
+
+  // Corrupting the reservoirs (at the end of the file) should only be detected when they are loaded.
+  bytes.back() ^= 1;
+  {
+    std::ofstream fs(path.c_str(), std::ios::binary);
+    fs.write(&bytes[0], bytes.size());
+  }
+  BinaryForestFile<Label> file(path);
+  BOOST_CHECK_THROW(file.load_forest(), std::runtime_error);
+  BOOST_CHECK_NO_THROW(file.load_forest(false));
+
+  // A file that is not a forest file should be rejected.
+  {
+    std::ofstream fs(path.c_str(), std::ios::binary);
+    fs << "Not a forest file";
+  }
+  BOOST_CHECK_THROW(BinaryForestFile<Label> file(path), std::runtime_error);
+
+  std::remove(path.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(inference_only_test)
+{
+  const std::string path = "test_BinaryForestFile_inference_only.bin";
+  UnitCircleExampleGenerator<Label> generator(list_of(1)(2)(3)(4), 1234);
+  RF_Ptr forest = make_forest(generator);
+  BinaryForestFile<Label>::save(*forest, path, false);
+
+  BinaryForestFile<Label> file(path);
+  BOOST_CHECK(!file.has_reservoirs());
+  RF_Ptr loadedForest = file.load_forest();
+  check_predictions(*forest, *loadedForest);
+
+  // Check that the loaded forest can still be trained.
+  loadedForest->add_examples(generator.generate_examples(list_of(1)(2)(3)(4), 50));
+  loadedForest->train(4);
+  BOOST_CHECK(loadedForest->is_valid());
+
+  std::remove(path.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(round_trip_test)
+{
+  const std::string path = "test_BinaryForestFile_round_trip.bin";
+  UnitCircleExampleGenerator<Label> generator(list_of(1)(2)(3)(4), 1234);
+  RF_Ptr forest = make_forest(generator);
+  BinaryForestFile<Label>::save(*forest, path);
+
+  BinaryForestFile<Label> file(path);
+  BOOST_CHECK(file.has_reservoirs());
+  RF_Ptr loadedForest = file.load_forest();
+  BOOST_CHECK_EQUAL(to_string(*forest), to_string(*loadedForest));
+  check_predictions(*forest, *loadedForest);
+
+  // Check that saving the loaded forest produces an identical file.
+  const std::string secondPath = "test_BinaryForestFile_round_trip2.bin";
+  BinaryForestFile<Label>::save(*loadedForest, secondPath);
+  std::ifstream fs1(path.c_str(), std::ios::binary), fs2(secondPath.c_str(), std::ios::binary);
+  std::string bytes1((std::istreambuf_iterator<char>(fs1)), std::istreambuf_iterator<char>());
+  std::string bytes2((std::istreambuf_iterator<char>(fs2)), std::istreambuf_iterator<char>());
+  BOOST_CHECK(bytes1 == bytes2);
+
+  std::remove(path.c_str());
+  std::remove(secondPath.c_str());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,159 @@
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+
+#include <boost/assign/list_of.hpp>
+using boost::assign::list_of;
+using boost::assign::map_list_of;
+
+#include <rafl/core/CompiledForest.h>
+#include <rafl/examples/UnitCircleExampleGenerator.h>
+using namespace rafl;
+
+typedef int Label;
+typedef boost::shared_ptr<const Example<Label> > Example_CPtr;
+
+/**
+ * \brief Checks that a compiled forest predicts the same labels as its source forest for a grid of descriptors.
+ *
+ * \param forest          The source forest.
+ * \param compiledForest  The compiled forest.
+ */
+void check_predictions(const RandomForest<Label>& forest, const CompiledForest<Label>& compiledForest)
+{
+  std::vector<float> features;
+  for(float y = -1.5f; y <= 1.5f; y += 0.05f)
+  {
+    for(float x = -1.5f; x <= 1.5f; x += 0.05f)
+    {
+      features.push_back(x);
+      features.push_back(y);
+    }
+  }
+
+  // Note: The scratch buffer is deliberately oversized and full of junk, to check that the compiled forest resets the parts of it that it uses.
+  const size_t count = features.size() / 2;
+  std::vector<Label> labels(count);
+  std::vector<float> scratch(10000, 1000.0f);
+  compiledForest.predict_batch(&features[0], count, &labels[0], scratch);
+
+  for(size_t i = 0; i < count; ++i)
+  {
+    Descriptor_CPtr descriptor(new Descriptor(&features[i * 2], &features[i * 2] + 2));
+    BOOST_REQUIRE_EQUAL(labels[i], forest.predict(descriptor));
+  }
+}
+
+/**
+ * \brief Makes the specified number of examples with the specified label.
+ *
+ * \param label The label.
+ * \param count The number of examples to make.
+ * \return      The examples.
+ */
+std::vector<Example_CPtr> make_examples(Label label, size_t count)
+{
+  Descriptor_CPtr descriptor(new Descriptor(list_of(0.0f)(0.0f)));
+  return std::vector<Example_CPtr>(count, Example_CPtr(new Example<Label>(descriptor, label)));
+}
+
+BOOST_AUTO_TEST_SUITE(test_CompiledForest)
+
+BOOST_AUTO_TEST_CASE(predict_batch_test)
+{
+  DecisionFunctionGeneratorFactory<Label>::instance().register_rafl_makers();
+
+  const std::vector<std::string> generatorTypes = list_of<std::string>("FeatureThresholding")("PairwiseOpAndThreshold");
+  for(size_t i = 0, size = generatorTypes.size(); i < size; ++i)
+  {
+    std::map<std::string,std::string> settings = map_list_of<std::string,std::string>
+      ("candidateCount", "64")
+      ("decisionFunctionGeneratorParams", "")
+      ("decisionFunctionGeneratorType", generatorTypes[i])
+      ("gainThreshold", "0")
+      ("maxClassSize", "1000")
+      ("maxTreeHeight", "20")
+      ("randomSeed", "1234")
+      ("seenExamplesThreshold", "20")
+      ("splittabilityThreshold", "0.5")
+      ("usePMFReweighting", "1");
+
+    RandomForest<Label> forest(4, DecisionTree<Label>::Settings(settings));
+    CompiledForest<Label> compiledForest(2);
+    UnitCircleExampleGenerator<Label> generator(list_of(1)(2)(3)(4), 1234);
+
+    // Train the forest incrementally, refreshing the compiled forest after each step, and check that the predictions match at each stage.
+    for(int step = 0; step < 5; ++step)
+    {
+      std::vector<Example_CPtr> examples = generator.generate_examples(list_of(1)(2)(3)(4), 50);
+      forest.add_examples(examples);
+      forest.train(step + 1);
+      compiledForest.refresh(forest);
+      check_predictions(forest, compiledForest);
+    }
+
+    // Check that the version of the compiled forest only changes when the forest does.
+    const size_t version = compiledForest.get_version();
+    compiledForest.refresh(forest);
+    BOOST_CHECK_EQUAL(compiledForest.get_version(), version);
+
+    // Check that resetting a tree is handled correctly.
+    forest.reset_tree(0);
+    forest.add_examples(generator.generate_examples(list_of(1)(2)(3)(4), 50));
+    forest.train(4);
+    compiledForest.refresh(forest);
+    BOOST_CHECK(compiledForest.get_version() != version);
+    check_predictions(forest, compiledForest);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(version_test)
+{
+  DecisionFunctionGeneratorFactory<Label>::instance().register_rafl_makers();
+
+  // Note: The trees in this forest consist of a single leaf that can never be split.
+  std::map<std::string,std::string> settings = map_list_of<std::string,std::string>
+    ("candidateCount", "64")
+    ("decisionFunctionGeneratorParams", "")
+    ("decisionFunctionGeneratorType", "FeatureThresholding")
+    ("gainThreshold", "0")
+    ("maxClassSize", "1000")
+    ("maxTreeHeight", "1")
+    ("randomSeed", "1234")
+    ("seenExamplesThreshold", "20")
+    ("splittabilityThreshold", "0.5")
+    ("usePMFReweighting", "0");
+
+  RandomForest<Label> forest(2, DecisionTree<Label>::Settings(settings));
+  CompiledForest<Label> compiledForest(2);
+  forest.add_examples(make_examples(1, 10));
+  forest.add_examples(make_examples(2, 5));
+  compiledForest.refresh(forest);
+  const size_t version = compiledForest.get_version();
+
+  // Find the leaves that are reached by the examples' descriptor.
+  const std::vector<float> features = list_of(0.0f)(0.0f);
+  std::vector<Label> labels(1);
+  std::vector<float> scratch;
+  std::vector<int> leafIndices(compiledForest.get_tree_count());
+  compiledForest.predict_batch(&features[0], 1, &labels[0], scratch, &leafIndices[0]);
+  BOOST_CHECK(compiledForest.leaves_unchanged_since(&leafIndices[0], leafIndices.size(), version));
+
+  // Refreshing the compiled forest when the forest has not changed should leave the version unchanged.
+  compiledForest.refresh(forest);
+  BOOST_CHECK_EQUAL(compiledForest.get_version(), version);
+
+  // Adding examples that change the masses of the leaves should change the version, even if the most likely label of each leaf stays the same.
+  forest.add_examples(make_examples(2, 4));
+  compiledForest.refresh(forest);
+  BOOST_CHECK(compiledForest.get_version() != version);
+  BOOST_CHECK(!compiledForest.leaves_unchanged_since(&leafIndices[0], leafIndices.size(), version));
+  BOOST_CHECK(compiledForest.leaves_unchanged_since(&leafIndices[0], leafIndices.size(), compiledForest.get_version()));
+  check_predictions(forest, compiledForest);
+
+  // Leaf indices that do not match the compiled forest should never be considered unchanged.
+  BOOST_CHECK(!compiledForest.leaves_unchanged_since(&leafIndices[0], leafIndices.size() - 1, compiledForest.get_version()));
+  leafIndices[0] = -1;
+  BOOST_CHECK(!compiledForest.leaves_unchanged_since(&leafIndices[0], leafIndices.size(), compiledForest.get_version()));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
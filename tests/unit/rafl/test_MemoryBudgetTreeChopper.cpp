@@ -0,0 +1,118 @@
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+
+#include <boost/assign/list_of.hpp>
+using boost::assign::list_of;
+using boost::assign::map_list_of;
+
+#include <boost/lexical_cast.hpp>
+
+#include <rafl/choppers/MemoryBudgetTreeChopper.h>
+#include <rafl/examples/UnitCircleExampleGenerator.h>
+using namespace rafl;
+
+typedef int Label;
+typedef boost::shared_ptr<RandomForest<Label> > RF_Ptr;
+
+/**
+ * \brief Makes an untrained forest.
+ *
+ * \param maxTreeHeight The maximum height allowed for the trees in the forest.
+ * \return              The forest.
+ */
+RF_Ptr make_forest(size_t maxTreeHeight)
+{
+  DecisionFunctionGeneratorFactory<Label>::instance().register_rafl_makers();
+
+  std::map<std::string,std::string> settings = map_list_of<std::string,std::string>
+    ("candidateCount", "64")
+    ("decisionFunctionGeneratorParams", "")
+    ("decisionFunctionGeneratorType", "PairwiseOpAndThreshold")
+    ("gainThreshold", "0")
+    ("maxClassSize", "1000")
+    ("maxTreeHeight", boost::lexical_cast<std::string>(maxTreeHeight))
+    ("randomSeed", "1234")
+    ("seenExamplesThreshold", "20")
+    ("splittabilityThreshold", "0.5")
+    ("usePMFReweighting", "1");
+
+  return RF_Ptr(new RandomForest<Label>(4, DecisionTree<Label>::Settings(settings)));
+}
+
+BOOST_AUTO_TEST_SUITE(test_MemoryBudgetTreeChopper)
+
+BOOST_AUTO_TEST_CASE(chop_test)
+{
+  UnitCircleExampleGenerator<Label> generator(list_of(1)(2)(3)(4), 1234);
+  RF_Ptr forest = make_forest(20);
+  for(int step = 0; step < 5; ++step)
+  {
+    forest->add_examples(generator.generate_examples(list_of(1)(2)(3)(4), 50));
+    forest->train(step + 1);
+  }
+
+  // A forest that fits within the budget should be left unchanged.
+  const size_t memoryUsage = forest->get_memory_usage();
+  MemoryBudgetTreeChopper<Label> generousChopper(memoryUsage);
+  BOOST_CHECK(!generousChopper.choose_tree_to_chop(forest));
+
+  // A forest that exceeds the budget should have its most costly tree chopped.
+  MemoryBudgetTreeChopper<Label> strictChopper(memoryUsage - 1);
+  boost::optional<size_t> treeToChop = strictChopper.choose_tree_to_chop(forest);
+  BOOST_REQUIRE(treeToChop);
+
+  const size_t treeMemoryUsage = forest->get_tree(*treeToChop)->get_memory_usage();
+  strictChopper.chop_tree_if_necessary(forest);
+  BOOST_CHECK(forest->get_memory_usage() < memoryUsage);
+  BOOST_CHECK(forest->get_tree(*treeToChop)->get_memory_usage() < treeMemoryUsage);
+  BOOST_CHECK(!strictChopper.choose_tree_to_chop(forest));
+}
+
+BOOST_AUTO_TEST_CASE(shared_examples_test)
+{
+  // Make some examples with large descriptors, so that the memory they use dominates that used by the trees themselves.
+  const size_t exampleCount = 50, featureCount = 256;
+  std::vector<boost::shared_ptr<const Example<Label> > > examples;
+  for(size_t i = 0; i < exampleCount; ++i)
+  {
+    Descriptor_CPtr descriptor(new Descriptor(featureCount, static_cast<float>(i)));
+    examples.push_back(boost::shared_ptr<const Example<Label> >(new Example<Label>(descriptor, static_cast<Label>(i % 4))));
+  }
+
+  // Every tree stores every example, but the forest should only count each example once.
+  RF_Ptr forest = make_forest(20);
+  forest->add_examples(examples);
+  const size_t examplesMemoryUsage = exampleCount * featureCount * sizeof(float);
+  BOOST_CHECK(forest->get_memory_usage() > examplesMemoryUsage);
+  BOOST_CHECK(forest->get_memory_usage() < 2 * examplesMemoryUsage);
+
+  // Since the examples are shared between the trees, chopping any one tree would not free them.
+  std::vector<size_t> treeMemoryUsages = forest->get_tree_memory_usages();
+  BOOST_REQUIRE_EQUAL(treeMemoryUsages.size(), forest->get_tree_count());
+  for(size_t i = 0, size = treeMemoryUsages.size(); i < size; ++i)
+  {
+    BOOST_CHECK_EQUAL(treeMemoryUsages[i], forest->get_tree(i)->get_memory_usage());
+    BOOST_CHECK(treeMemoryUsages[i] < examplesMemoryUsage);
+  }
+
+  // A budget that would be exceeded if the shared examples were counted once per tree should not cause a tree to be chopped.
+  MemoryBudgetTreeChopper<Label> chopper(2 * examplesMemoryUsage);
+  BOOST_CHECK(!chopper.choose_tree_to_chop(forest));
+}
+
+BOOST_AUTO_TEST_CASE(unsplittable_leaf_test)
+{
+  // The roots of trees with a maximum height of 1 can never be split, so they should not store any examples.
+  UnitCircleExampleGenerator<Label> generator(list_of(1)(2)(3)(4), 1234);
+  RF_Ptr forest = make_forest(1);
+  forest->add_examples(generator.generate_examples(list_of(1)(2)(3)(4), 10));
+  const size_t memoryUsage = forest->get_memory_usage();
+  forest->add_examples(generator.generate_examples(list_of(1)(2)(3)(4), 100));
+  BOOST_CHECK_EQUAL(forest->get_memory_usage(), memoryUsage);
+
+  // Their leaves should nevertheless still be able to make predictions.
+  Descriptor_CPtr descriptor(new Descriptor(list_of(1.0f)(0.0f)));
+  BOOST_CHECK_NO_THROW(forest->predict(descriptor));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
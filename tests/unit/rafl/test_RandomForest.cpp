@@ -0,0 +1,126 @@
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+
+#include <boost/assign/list_of.hpp>
+using boost::assign::list_of;
+using boost::assign::map_list_of;
+
+#include <rafl/core/RandomForest.h>
+#include <rafl/examples/UnitCircleExampleGenerator.h>
+using namespace rafl;
+
+#include <tvgutil/misc/ThreadPool.h>
+using namespace tvgutil;
+
+typedef int Label;
+typedef boost::shared_ptr<const Example<Label> > Example_CPtr;
+
+/**
+ * \brief Makes the settings for a small forest trained on examples around the unit circle.
+ *
+ * \return  The settings.
+ */
+DecisionTree<Label>::Settings make_settings()
+{
+  DecisionFunctionGeneratorFactory<Label>::instance().register_rafl_makers();
+
+  std::map<std::string,std::string> settings = map_list_of<std::string,std::string>
+    ("candidateCount", "64")
+    ("decisionFunctionGeneratorParams", "")
+    ("decisionFunctionGeneratorType", "FeatureThresholding")
+    ("gainThreshold", "0")
+    ("maxClassSize", "1000")
+    ("maxTreeHeight", "20")
+    ("randomSeed", "1234")
+    ("seenExamplesThreshold", "20")
+    ("splittabilityThreshold", "0.5")
+    ("usePMFReweighting", "1");
+
+  return DecisionTree<Label>::Settings(settings);
+}
+
+/**
+ * \brief Gets the labels predicted by a forest for a grid of descriptors.
+ *
+ * \param forest  The forest.
+ * \return        The predicted labels.
+ */
+std::vector<Label> predict_grid(const RandomForest<Label>& forest)
+{
+  std::vector<Label> labels;
+  for(float y = -1.5f; y <= 1.5f; y += 0.05f)
+  {
+    for(float x = -1.5f; x <= 1.5f; x += 0.05f)
+    {
+      Descriptor_CPtr descriptor(new Descriptor(list_of(x)(y)));
+      labels.push_back(forest.predict(descriptor));
+    }
+  }
+  return labels;
+}
+
+/**
+ * \brief Trains a forest incrementally on a fixed sequence of examples, using the specified thread pool.
+ *
+ * \param threadPool  The thread pool.
+ * \return            The labels predicted by the trained forest for a grid of descriptors.
+ */
+std::vector<Label> train_forest(ThreadPool& threadPool)
+{
+  RandomForest<Label> forest(6, make_settings());
+  forest.set_thread_pool(threadPool);
+
+  UnitCircleExampleGenerator<Label> generator(list_of(1)(2)(3)(4), 1234);
+  for(int step = 0; step < 5; ++step)
+  {
+    forest.add_examples(generator.generate_examples(list_of(1)(2)(3)(4), 50));
+    forest.train(step + 1);
+  }
+
+  return predict_grid(forest);
+}
+
+BOOST_AUTO_TEST_SUITE(test_RandomForest)
+
+BOOST_AUTO_TEST_CASE(add_examples_test)
+{
+  RandomForest<Label> forest(2, make_settings());
+  UnitCircleExampleGenerator<Label> generator(list_of(1)(2), 1234);
+  std::vector<Example_CPtr> examples = generator.generate_examples(list_of(1)(2), 10);
+
+  // Check that an invalid index is rejected before any of the examples are added.
+  BOOST_CHECK_THROW(forest.add_examples(examples, list_of<size_t>(0)(1)(examples.size())), std::out_of_range);
+  BOOST_CHECK_EQUAL(forest.get_tree(0)->get_class_frequencies().get_count(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(thread_count_test)
+{
+  // Check that the trained forest does not depend on the number of threads used to train it.
+  ThreadPool serialPool(1), parallelPool(4);
+  std::vector<Label> serialLabels = train_forest(serialPool);
+  std::vector<Label> parallelLabels = train_forest(parallelPool);
+  BOOST_CHECK(serialLabels == parallelLabels);
+}
+
+BOOST_AUTO_TEST_CASE(train_within_budget_test)
+{
+  RandomForest<Label> forest(4, make_settings());
+  UnitCircleExampleGenerator<Label> generator(list_of(1)(2)(3)(4), 1234);
+  forest.add_examples(generator.generate_examples(list_of(1)(2)(3)(4), 200));
+
+  // Check that the overall budget is respected, however it has to be shared out between the trees.
+  size_t totalNodesSplit = 0;
+  for(size_t splitBudget = 1; splitBudget <= 7; ++splitBudget)
+  {
+    size_t nodesSplit = forest.train_within_budget(splitBudget);
+    BOOST_CHECK_LE(nodesSplit, splitBudget);
+    totalNodesSplit += nodesSplit;
+  }
+  BOOST_CHECK_GT(totalNodesSplit, 0);
+
+  // Check that once the trees have nothing left worth splitting, a large budget is not used up.
+  while(forest.train_within_budget(1000) > 0);
+  BOOST_CHECK_EQUAL(forest.train_within_budget(1000), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
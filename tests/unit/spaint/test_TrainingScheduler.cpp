@@ -0,0 +1,76 @@
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+
+#include <spaint/randomforest/TrainingScheduler.h>
+using namespace spaint;
+
+BOOST_AUTO_TEST_SUITE(test_TrainingScheduler)
+
+BOOST_AUTO_TEST_CASE(split_budget_test)
+{
+  TrainingScheduler scheduler(20.0, 16, 128, 100);
+
+  // Until the cost of a split is known, the nominal budget should be used on training frames, and nothing should be done on idle frames.
+  BOOST_CHECK_EQUAL(scheduler.get_split_budget(5.0), 100);
+  BOOST_CHECK_EQUAL(scheduler.get_idle_split_budget(5.0), 0);
+
+  // If 100 splits take 50ms, only 30 should fit into the 15ms left after 5ms of feature calculation, and the other 70 should be deferred.
+  scheduler.record_training_time(100, 100, 50.0, false);
+  BOOST_CHECK_EQUAL(scheduler.get_split_budget(5.0), 30);
+  scheduler.record_training_time(30, 30, 15.0, false);
+  BOOST_CHECK_EQUAL(scheduler.get_deferred_split_count(), 70);
+
+  // An idle frame with 10ms left should be able to do 20 of the deferred splits.
+  BOOST_CHECK_EQUAL(scheduler.get_idle_split_budget(10.0), 20);
+  scheduler.record_training_time(20, 20, 10.0, true);
+  BOOST_CHECK_EQUAL(scheduler.get_deferred_split_count(), 50);
+
+  // A frame with no time left should only do the minimum number of splits, and should defer the rest of its nominal budget.
+  BOOST_CHECK_EQUAL(scheduler.get_split_budget(25.0), 1);
+  scheduler.record_training_time(1, 1, 0.5, false);
+  BOOST_CHECK_EQUAL(scheduler.get_deferred_split_count(), 149);
+
+  // If the forest runs out of nodes worth splitting before the budget is used up, there should be no outstanding work.
+  scheduler.record_training_time(30, 10, 5.0, false);
+  BOOST_CHECK_EQUAL(scheduler.get_deferred_split_count(), 0);
+  BOOST_CHECK_EQUAL(scheduler.get_idle_split_budget(0.0), 0);
+}
+
+BOOST_AUTO_TEST_CASE(over_budget_test)
+{
+  TrainingScheduler scheduler(20.0, 16, 128, 100, 0.5, 2);
+  scheduler.record_training_time(100, 100, 50.0, false);
+
+  // If every frame is over budget, the minimum number of splits should still be done, and the deferred splits should be capped at a few frames' worth.
+  for(int i = 0; i < 20; ++i)
+  {
+    BOOST_CHECK_EQUAL(scheduler.get_split_budget(25.0), 2);
+    BOOST_CHECK_EQUAL(scheduler.get_idle_split_budget(25.0), 0);
+    scheduler.record_training_time(2, 2, 0.2, false);
+    BOOST_CHECK(scheduler.get_deferred_split_count() <= 400);
+  }
+  BOOST_CHECK_EQUAL(scheduler.get_deferred_split_count(), 400);
+
+  // The splits done should keep the split cost up to date, so that more splits are allowed once there is time for them again.
+  BOOST_CHECK(scheduler.get_split_budget(5.0) > 100);
+}
+
+BOOST_AUTO_TEST_CASE(voxels_per_label_test)
+{
+  TrainingScheduler scheduler(20.0, 16, 128, 100);
+  BOOST_CHECK_EQUAL(scheduler.get_voxels_per_label(), 128);
+
+  // If sampling 128 voxels per label takes 40ms, at most 10ms (half the target) worth of voxels (32 per label) should be sampled next time.
+  scheduler.record_feature_time(128, 40.0);
+  BOOST_CHECK_EQUAL(scheduler.get_voxels_per_label(), 32);
+
+  // The number of voxels should never drop below the minimum, however slow sampling is.
+  scheduler.record_feature_time(32, 1000.0);
+  BOOST_CHECK_EQUAL(scheduler.get_voxels_per_label(), 16);
+
+  // If sampling becomes cheap, the number of voxels should rise again (but not above the maximum).
+  for(int i = 0; i < 50; ++i) scheduler.record_feature_time(16, 0.1);
+  BOOST_CHECK_EQUAL(scheduler.get_voxels_per_label(), 128);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
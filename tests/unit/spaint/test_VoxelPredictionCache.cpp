@@ -0,0 +1,153 @@
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+
+#include <boost/assign/list_of.hpp>
+#include <boost/bind.hpp>
+using boost::assign::list_of;
+using boost::assign::map_list_of;
+
+#include <rafl/core/CompiledForest.h>
+using namespace rafl;
+
+#include <spaint/randomforest/VoxelPredictionCache.h>
+using namespace spaint;
+
+typedef int Label;
+typedef boost::shared_ptr<const Example<Label> > Example_CPtr;
+
+/**
+ * \brief Makes the specified number of examples with the specified label and a descriptor of the form (x,0).
+ *
+ * \param label The label.
+ * \param count The number of examples to make.
+ * \param x     The first feature of the examples' descriptor.
+ * \return      The examples.
+ */
+std::vector<Example_CPtr> make_examples(Label label, size_t count, float x)
+{
+  Descriptor_CPtr descriptor(new Descriptor(list_of(x)(0.0f)));
+  return std::vector<Example_CPtr>(count, Example_CPtr(new Example<Label>(descriptor, label)));
+}
+
+BOOST_AUTO_TEST_SUITE(test_VoxelPredictionCache)
+
+BOOST_AUTO_TEST_CASE(eviction_test)
+{
+  VoxelPredictionCache cache(3);
+
+  // Predictions in two different blocks (including one with negative coordinates) should give rise to two block records.
+  cache.begin_frame(0);
+  cache.record_prediction(Vector3s(1, 2, 3));
+  cache.record_prediction(Vector3s(2, 2, 3));
+  cache.record_prediction(Vector3s(-1, -1, -1));
+  BOOST_CHECK_EQUAL(cache.get_block_count(), 2);
+
+  // Once none of a block's predictions can be fresh any more, its record should be discarded (the cache checks for such blocks every 3 frames).
+  cache.begin_frame(0);
+  cache.begin_frame(0);
+  BOOST_CHECK_EQUAL(cache.get_block_count(), 2);
+  cache.begin_frame(0);
+  cache.record_prediction(Vector3s(-1, -1, -1));
+  cache.begin_frame(0);
+  cache.begin_frame(0);
+  BOOST_CHECK_EQUAL(cache.get_block_count(), 1);
+  BOOST_CHECK(cache.is_fresh(Vector3s(-1, -1, -1)));
+
+  // Clearing the cache should discard all of the records.
+  cache.clear();
+  BOOST_CHECK_EQUAL(cache.get_block_count(), 0);
+  BOOST_CHECK(!cache.is_fresh(Vector3s(-1, -1, -1)));
+}
+
+BOOST_AUTO_TEST_CASE(forest_training_test)
+{
+  DecisionFunctionGeneratorFactory<Label>::instance().register_rafl_makers();
+
+  std::map<std::string,std::string> settings = map_list_of<std::string,std::string>
+    ("candidateCount", "64")
+    ("decisionFunctionGeneratorParams", "")
+    ("decisionFunctionGeneratorType", "FeatureThresholding")
+    ("gainThreshold", "0")
+    ("maxClassSize", "1000")
+    ("maxTreeHeight", "2")
+    ("randomSeed", "1234")
+    ("seenExamplesThreshold", "20")
+    ("splittabilityThreshold", "0.5")
+    ("usePMFReweighting", "0");
+
+  // Train a forest whose trees separate examples at (-1,0) from examples at (1,0).
+  RandomForest<Label> forest(2, DecisionTree<Label>::Settings(settings));
+  CompiledForest<Label> compiledForest(2);
+  forest.add_examples(make_examples(1, 30, -1.0f));
+  forest.add_examples(make_examples(2, 30, 1.0f));
+  forest.train(2);
+  compiledForest.refresh(forest);
+
+  // Predict labels for a voxel with each descriptor, and record the leaves that were used.
+  const Vector3s leftVoxel(1, 2, 3), rightVoxel(20, 2, 3);
+  const std::vector<float> features = list_of(-1.0f)(0.0f)(1.0f)(0.0f);
+  const size_t treeCount = compiledForest.get_tree_count();
+  std::vector<Label> labels(2);
+  std::vector<float> scratch;
+  std::vector<int> leafIndices(2 * treeCount);
+  compiledForest.predict_batch(&features[0], 2, &labels[0], scratch, &leafIndices[0]);
+  BOOST_REQUIRE(leafIndices[0] != leafIndices[treeCount]);
+
+  VoxelPredictionCache cache(30);
+  VoxelPredictionCache::LeafChecker leafChecker = boost::bind(&CompiledForest<Label>::leaves_unchanged_since, &compiledForest, _1, _2, _3);
+  cache.begin_frame(compiledForest.get_version(), leafChecker);
+  cache.record_prediction(leftVoxel);
+  cache.record_leaves(leftVoxel, &leafIndices[0], treeCount);
+  cache.record_prediction(rightVoxel);
+  cache.record_leaves(rightVoxel, &leafIndices[treeCount], treeCount);
+
+  // Refreshing the compiled forest when the forest has not changed should not stop the voxels' labels from being fresh.
+  compiledForest.refresh(forest);
+  cache.begin_frame(compiledForest.get_version(), leafChecker);
+  BOOST_CHECK(cache.is_fresh(leftVoxel));
+  BOOST_CHECK(cache.is_fresh(rightVoxel));
+
+  // Adding examples that change the masses of only the right-hand leaves should only stop the right-hand voxel's label from being fresh.
+  forest.add_examples(make_examples(1, 5, 1.0f));
+  compiledForest.refresh(forest);
+  cache.begin_frame(compiledForest.get_version(), leafChecker);
+  BOOST_CHECK(cache.is_fresh(leftVoxel));
+  BOOST_CHECK(!cache.is_fresh(rightVoxel));
+
+  // Without a leaf checker, only labels predicted using the current version of the forest should be fresh.
+  cache.begin_frame(compiledForest.get_version());
+  BOOST_CHECK(!cache.is_fresh(leftVoxel));
+}
+
+BOOST_AUTO_TEST_CASE(freshness_test)
+{
+  VoxelPredictionCache cache(2);
+  cache.begin_frame(0);
+
+  // A voxel should only be fresh once a prediction has been recorded for it, and this should not affect its neighbours.
+  BOOST_CHECK(!cache.is_fresh(Vector3s(7, 0, 0)));
+  cache.record_prediction(Vector3s(7, 0, 0));
+  BOOST_CHECK(cache.is_fresh(Vector3s(7, 0, 0)));
+  BOOST_CHECK(!cache.is_fresh(Vector3s(8, 0, 0)));
+  BOOST_CHECK(!cache.is_fresh(Vector3s(6, 0, 0)));
+  BOOST_CHECK(!cache.is_fresh(Vector3s(-7, 0, 0)));
+
+  // A prediction should stay fresh for the specified number of frames.
+  cache.begin_frame(0);
+  BOOST_CHECK(cache.is_fresh(Vector3s(7, 0, 0)));
+  cache.begin_frame(0);
+  BOOST_CHECK(!cache.is_fresh(Vector3s(7, 0, 0)));
+
+  // A prediction should no longer be fresh once the version of the forest changes.
+  cache.record_prediction(Vector3s(7, 0, 0));
+  cache.record_prediction(Vector3s(0, 0, 0));
+  cache.begin_frame(1);
+  BOOST_CHECK(!cache.is_fresh(Vector3s(7, 0, 0)));
+
+  // Recording a new prediction in the block should not make the other predictions in it fresh again.
+  cache.record_prediction(Vector3s(7, 0, 0));
+  BOOST_CHECK(cache.is_fresh(Vector3s(7, 0, 0)));
+  BOOST_CHECK(!cache.is_fresh(Vector3s(0, 0, 0)));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,112 @@
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+
+#include <sstream>
+
+#include <boost/archive/text_iarchive.hpp>
+#include <boost/archive/text_oarchive.hpp>
+#include <boost/assign/list_of.hpp>
+using boost::assign::map_list_of;
+
+#include <tvgutil/statistics/Histogram.h>
+using namespace tvgutil;
+
+//#################### HELPER TYPES ####################
+
+/**
+ * \brief An instance of this struct serializes itself in the same way as the original map-based histogram did.
+ */
+struct LegacyHistogram
+{
+  std::map<int,size_t> m_bins;
+  size_t m_count;
+
+  template<typename Archive>
+  void serialize(Archive& ar, const unsigned int version)
+  {
+    ar & m_bins;
+    ar & m_count;
+  }
+};
+
+//#################### TESTS ####################
+
+BOOST_AUTO_TEST_SUITE(test_Histogram)
+
+BOOST_AUTO_TEST_CASE(add_test)
+{
+  Histogram<int> histogram;
+  histogram.add(7);
+  histogram.add(2);
+
+  histogram.add(7);
+  histogram.add(5);
+  histogram.add(300);
+  histogram.add(-1);
+
+  // Check that the view of the bins contains the expected bins, including those for labels that cannot be looked up in the dense array.
+  const Histogram<int>::BinView bins = histogram.get_bins();
+  std::map<int,size_t> expectedBins = map_list_of(-1,1)(2,1)(5,1)(7,2)(300,1);
+  BOOST_CHECK((std::map<int,size_t>(bins.begin(), bins.end()) == expectedBins));
+  BOOST_CHECK_EQUAL(bins.size(), expectedBins.size());
+  BOOST_CHECK_EQUAL(bins.find(300)->second, 1);
+  BOOST_CHECK(bins.find(3) == bins.end());
+  BOOST_CHECK_EQUAL(histogram.get_count(), 6);
+
+  // Check that the contiguous form of the bins is sorted by label.
+  BOOST_CHECK_EQUAL(histogram.get_labels().size(), 5);
+  BOOST_CHECK_EQUAL(histogram.get_labels()[0], -1);
+  BOOST_CHECK_EQUAL(histogram.get_labels()[3], 7);
+  BOOST_CHECK_EQUAL(histogram.get_bin_sizes()[3], 2);
+  BOOST_CHECK_EQUAL(histogram.get_bin_size(-1), 1);
+  BOOST_CHECK_EQUAL(histogram.get_bin_size(5), 1);
+  BOOST_CHECK_EQUAL(histogram.get_bin_size(6), 0);
+  BOOST_CHECK_EQUAL(histogram.get_bin_size(7), 2);
+  BOOST_CHECK_EQUAL(histogram.get_bin_size(300), 1);
+  BOOST_CHECK_EQUAL(histogram.get_bin_size(1000), 0);
+
+  // Check that a copy of the histogram is independent of the original.
+  Histogram<int> copy(histogram);
+  copy.add(2);
+  BOOST_CHECK_EQUAL(copy.get_bin_size(2), 2);
+  BOOST_CHECK_EQUAL(histogram.get_bin_size(2), 1);
+  BOOST_CHECK_EQUAL(histogram.get_bins().find(2)->second, 1);
+}
+
+BOOST_AUTO_TEST_CASE(serialization_test)
+{
+  // Write a histogram in the format used by the original map-based implementation.
+  LegacyHistogram legacyHistogram;
+  legacyHistogram.m_bins = map_list_of(1,3)(4,2);
+  legacyHistogram.m_count = 5;
+  std::ostringstream oss;
+  {
+    boost::archive::text_oarchive archive(oss);
+    const LegacyHistogram& constLegacyHistogram = legacyHistogram;
+    archive << constLegacyHistogram;
+  }
+
+  // Check that it can be read back in as a histogram.
+  Histogram<int> histogram;
+  {
+    std::istringstream iss(oss.str());
+    boost::archive::text_iarchive archive(iss);
+    archive >> histogram;
+  }
+
+  const Histogram<int>::BinView bins = histogram.get_bins();
+  BOOST_CHECK((std::map<int,size_t>(bins.begin(), bins.end()) == legacyHistogram.m_bins));
+  BOOST_CHECK_EQUAL(histogram.get_count(), legacyHistogram.m_count);
+
+  // Check that writing the histogram out again produces the same output as before.
+  std::ostringstream oss2;
+  {
+    boost::archive::text_oarchive archive(oss2);
+    const Histogram<int>& constHistogram = histogram;
+    archive << constHistogram;
+  }
+
+  BOOST_CHECK_EQUAL(oss.str(), oss2.str());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,65 @@
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+
+#include <boost/assign/list_of.hpp>
+using boost::assign::map_list_of;
+
+#include <tvgutil/statistics/ProbabilityMassFunction.h>
+using namespace tvgutil;
+
+BOOST_AUTO_TEST_SUITE(test_ProbabilityMassFunction)
+
+BOOST_AUTO_TEST_CASE(histogram_test)
+{
+  Histogram<int> histogram;
+  for(int i = 0; i < 6; ++i) histogram.add(3);
+  for(int i = 0; i < 2; ++i) histogram.add(1);
+  for(int i = 0; i < 2; ++i) histogram.add(8);
+
+  // Without multipliers, the masses are simply the normalised bin sizes.
+  ProbabilityMassFunction<int> pmf(histogram);
+  const ProbabilityMassFunction<int>::MassView masses = pmf.get_masses();
+  BOOST_CHECK_EQUAL(masses.size(), 3);
+  BOOST_CHECK_CLOSE(masses.find(1)->second, 0.2f, 1e-4f);
+  BOOST_CHECK_CLOSE(masses.find(3)->second, 0.6f, 1e-4f);
+  BOOST_CHECK_CLOSE(pmf.get_mass(8), 0.2f, 1e-4f);
+  BOOST_CHECK_EQUAL(pmf.get_mass(2), 0.0f);
+  BOOST_CHECK_EQUAL(pmf.calculate_best_label(), 3);
+
+  // With multipliers, the masses are scaled and renormalised (labels without a multiplier are left unscaled).
+  std::map<int,float> multipliers = map_list_of(1,6.0f)(5,2.0f);
+  ProbabilityMassFunction<int> weightedPMF(histogram, multipliers);
+  BOOST_CHECK_CLOSE(weightedPMF.get_mass(1), 0.6f, 1e-4f);
+  BOOST_CHECK_CLOSE(weightedPMF.get_mass(3), 0.3f, 1e-4f);
+  BOOST_CHECK_CLOSE(weightedPMF.get_mass(8), 0.1f, 1e-4f);
+  BOOST_CHECK_EQUAL(weightedPMF.calculate_best_label(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(masses_test)
+{
+  std::map<int,float> masses = map_list_of(0,1.0f)(2,1.0f)(5,2.0f)(9,0.0f);
+  ProbabilityMassFunction<int> pmf(masses);
+
+  // Check that the contiguous form and the view agree.
+  BOOST_CHECK_EQUAL(pmf.get_labels().size(), 4);
+  BOOST_CHECK_EQUAL(pmf.get_mass_values().size(), 4);
+  for(size_t i = 0; i < 4; ++i)
+  {
+    BOOST_CHECK_EQUAL(pmf.get_masses().find(pmf.get_labels()[i])->second, pmf.get_mass_values()[i]);
+  }
+
+  BOOST_CHECK_CLOSE(pmf.calculate_entropy(), 1.5f, 1e-4f);
+  BOOST_CHECK_EQUAL(pmf.calculate_best_label(), 5);
+
+  // Check that ties are broken in favour of the smallest label, as with the original map-based implementation.
+  ProbabilityMassFunction<int> tiedPMF(map_list_of(4,1.0f)(2,1.0f)(7,0.5f));
+  BOOST_CHECK_EQUAL(tiedPMF.calculate_best_label(), 2);
+
+  // Check that copies have the same masses.
+  ProbabilityMassFunction<int> copy(pmf);
+  BOOST_CHECK(copy.get_labels() == pmf.get_labels());
+  BOOST_CHECK(copy.get_mass_values() == pmf.get_mass_values());
+  BOOST_CHECK_EQUAL(copy.get_mass(5), pmf.get_mass(5));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
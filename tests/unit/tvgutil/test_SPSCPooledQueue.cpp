@@ -0,0 +1,113 @@
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+
+#include <tvgutil/containers/SPSCPooledQueue.h>
+using namespace tvgutil;
+using namespace tvgutil::pooled_queue;
+
+typedef boost::shared_ptr<int> IntPtr;
+typedef SPSCPooledQueue<IntPtr> Queue;
+
+//#################### HELPER FUNCTIONS ####################
+
+IntPtr make_int()
+{
+  return IntPtr(new int(0));
+}
+
+void push(Queue& queue, int value)
+{
+  Queue::PushHandler_Ptr pushHandler = queue.begin_push();
+  boost::optional<IntPtr&> elt = pushHandler->get();
+  if(elt) **elt = value;
+}
+
+void run_producer(Queue *queue, int count)
+{
+  for(int i = 0; i < count; ++i) push(*queue, i);
+}
+
+//#################### TESTS ####################
+
+BOOST_AUTO_TEST_SUITE(test_SPSCPooledQueue)
+
+BOOST_AUTO_TEST_CASE(discard_test)
+{
+  Queue queue(PES_DISCARD);
+  queue.initialise(2, &make_int);
+
+  push(queue, 1);
+  push(queue, 2);
+  BOOST_CHECK(queue.pool_empty());
+  push(queue, 3);
+  BOOST_CHECK_EQUAL(queue.size(), 2);
+
+  BOOST_CHECK_EQUAL(*queue.peek(), 1);
+  queue.pop();
+  BOOST_CHECK_EQUAL(*queue.peek(), 2);
+  queue.pop();
+  BOOST_CHECK(queue.empty());
+}
+
+BOOST_AUTO_TEST_CASE(grow_test)
+{
+  Queue queue(PES_GROW, 8);
+  queue.initialise(1, &make_int);
+
+  for(int i = 0; i < 8; ++i) push(queue, i);
+  BOOST_CHECK_EQUAL(queue.size(), 8);
+
+  for(int i = 0; i < 8; ++i)
+  {
+    BOOST_CHECK_EQUAL(*queue.peek(), i);
+    queue.pop();
+  }
+}
+
+BOOST_AUTO_TEST_CASE(replace_test)
+{
+  Queue queue(PES_REPLACE_RANDOM);
+  queue.initialise(3, &make_int);
+
+  push(queue, 1);
+  push(queue, 2);
+  push(queue, 3);
+
+  // The consumer is not using any of the elements, so the most recently pushed one should be replaced.
+  push(queue, 4);
+  BOOST_CHECK_EQUAL(queue.size(), 3);
+
+  BOOST_CHECK_EQUAL(*queue.peek(), 1);
+  queue.pop();
+  BOOST_CHECK_EQUAL(*queue.peek(), 2);
+  queue.pop();
+  BOOST_CHECK_EQUAL(*queue.peek(), 4);
+  queue.pop();
+  BOOST_CHECK(queue.empty());
+}
+
+BOOST_AUTO_TEST_CASE(wait_test)
+{
+  const int count = 100000;
+  Queue queue(PES_WAIT);
+  queue.initialise(4, &make_int);
+
+  // Check that all of the elements arrive, in order, when the producer runs on a different thread to the consumer.
+  boost::thread producer(&run_producer, &queue, count);
+
+  bool ok = true;
+  for(int i = 0; i < count; ++i)
+  {
+    if(*queue.peek() != i) ok = false;
+    queue.pop();
+  }
+
+  producer.join();
+  BOOST_CHECK(ok);
+  BOOST_CHECK(queue.empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,74 @@
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+
+#include <boost/bind.hpp>
+
+#include <tvgutil/misc/SettingsContainer.h>
+using namespace tvgutil;
+
+//#################### HELPER FUNCTIONS ####################
+
+void record_value(std::vector<int>& values, int value)
+{
+  values.push_back(value);
+}
+
+//#################### TESTS ####################
+
+BOOST_AUTO_TEST_SUITE(test_SettingsContainer)
+
+BOOST_AUTO_TEST_CASE(register_setting_test)
+{
+  SettingsContainer settings;
+  settings.add_value("Foo", "23");
+  settings.add_value("Foo", "9");
+  settings.add_value("Bar", SettingsContainer::NOT_SET);
+
+  boost::shared_ptr<TypedSetting<int> > foo = settings.register_setting<int>("Foo", 7);
+  boost::shared_ptr<TypedSetting<int> > bar = settings.register_setting<int>("Bar", 8);
+  boost::shared_ptr<TypedSetting<int> > baz = settings.register_setting<int>("Baz", 84);
+
+  BOOST_CHECK_EQUAL(foo->get(), 23);
+  BOOST_CHECK_EQUAL(**bar, 8);
+  BOOST_CHECK_EQUAL(baz->get(), 84);
+
+  // Adding the first value for a setting should update its typed settings, but adding a later value should not.
+  settings.add_value("Baz", "17");
+  BOOST_CHECK_EQUAL(baz->get(), 17);
+  settings.add_value("Baz", "18");
+  BOOST_CHECK_EQUAL(baz->get(), 17);
+
+  settings.set_value("Wibble", "Wobble");
+  BOOST_CHECK_THROW(settings.register_setting<int>("Wibble", 0), boost::bad_lexical_cast);
+}
+
+BOOST_AUTO_TEST_CASE(set_value_test)
+{
+  SettingsContainer settings;
+  settings.add_value("Foo", "23");
+  settings.add_value("Foo", "9");
+
+  boost::shared_ptr<TypedSetting<int> > foo = settings.register_setting<int>("Foo", 7);
+
+  std::vector<int> values;
+  foo->add_listener(boost::bind(&record_value, boost::ref(values), _1));
+
+  settings.set_value("Foo", "24");
+  BOOST_CHECK_EQUAL(foo->get(), 24);
+  BOOST_CHECK_EQUAL(settings.get_values<int>("Foo").size(), 1);
+
+  settings.set_value("Foo", SettingsContainer::NOT_SET);
+  BOOST_CHECK_EQUAL(foo->get(), 7);
+  BOOST_CHECK_THROW(settings.get_first_value<int>("Foo"), std::runtime_error);
+
+  BOOST_REQUIRE_EQUAL(values.size(), 2);
+  BOOST_CHECK_EQUAL(values[0], 24);
+  BOOST_CHECK_EQUAL(values[1], 7);
+
+  // Typed settings that are no longer in use should be silently discarded.
+  foo.reset();
+  settings.set_value("Foo", "25");
+  BOOST_CHECK_EQUAL(settings.get_first_value<int>("Foo"), 25);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
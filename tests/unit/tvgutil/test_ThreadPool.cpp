@@ -0,0 +1,134 @@
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+
+#include <stdexcept>
+#include <vector>
+
+#include <boost/atomic.hpp>
+#include <boost/bind.hpp>
+
+#include <tvgutil/misc/TaskGroup.h>
+using namespace tvgutil;
+
+//#################### TYPES ####################
+
+struct Doubler
+{
+  std::vector<size_t> *values;
+
+  void operator()(size_t i) const
+  {
+    (*values)[i] = i * 2;
+  }
+};
+
+//#################### HELPER FUNCTIONS ####################
+
+void increment(boost::atomic<int> *counter)
+{
+  ++*counter;
+}
+
+void run_until_released(boost::atomic<bool> *started, const boost::atomic<bool> *released)
+{
+  *started = true;
+  while(!*released) boost::this_thread::sleep_for(boost::chrono::milliseconds(1));
+}
+
+void run_nested_parallel_for(ThreadPool *pool, boost::atomic<int> *counter)
+{
+  std::vector<size_t> values(100);
+  Doubler doubler = { &values };
+  pool->parallel_for(0, values.size(), doubler, 7);
+  for(size_t i = 0; i < values.size(); ++i)
+  {
+    if(values[i] != i * 2) return;
+  }
+  ++*counter;
+}
+
+int square(int x)
+{
+  return x * x;
+}
+
+void throw_error()
+{
+  throw std::runtime_error("Error");
+}
+
+//#################### TESTS ####################
+
+BOOST_AUTO_TEST_SUITE(test_ThreadPool)
+
+BOOST_AUTO_TEST_CASE(parallel_for_test)
+{
+  ThreadPool pool(4);
+  std::vector<size_t> values(1000);
+  Doubler doubler = { &values };
+  pool.parallel_for(0, values.size(), doubler);
+
+  for(size_t i = 0; i < values.size(); ++i)
+  {
+    BOOST_CHECK_EQUAL(values[i], i * 2);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(post_task_test)
+{
+  boost::atomic<int> counter(0);
+  {
+    ThreadPool pool(4);
+    for(int i = 0; i < 1000; ++i) pool.post_task(boost::bind(&increment, &counter));
+
+    // The destructor should run all of the pending tasks before the pool is destroyed.
+  }
+  BOOST_CHECK_EQUAL(counter, 1000);
+}
+
+BOOST_AUTO_TEST_CASE(submit_test)
+{
+  ThreadPool pool(2);
+  boost::shared_future<int> result = pool.submit(boost::bind(&square, 7));
+  BOOST_CHECK_EQUAL(result.get(), 49);
+
+  boost::shared_future<void> error = pool.submit(&throw_error);
+  BOOST_CHECK_THROW(error.get(), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(task_group_isolation_test)
+{
+  ThreadPool pool(1);
+  boost::atomic<bool> firstStarted(false), secondStarted(false), released(false);
+
+  // Keep the pool's only worker busy with a long external task, and post another long external task behind it.
+  pool.post_task(boost::bind(&run_until_released, &firstStarted, &released));
+  while(!firstStarted) boost::this_thread::sleep_for(boost::chrono::milliseconds(1));
+  pool.post_task(boost::bind(&run_until_released, &secondStarted, &released));
+
+  // Waiting for a group should run the group's own tasks on the waiting thread, without picking up the pending external task.
+  boost::atomic<int> counter(0);
+  TaskGroup group(pool);
+  for(int i = 0; i < 10; ++i) group.run(boost::bind(&increment, &counter));
+  group.wait();
+  BOOST_CHECK_EQUAL(counter, 10);
+  BOOST_CHECK(!secondStarted);
+
+  released = true;
+}
+
+BOOST_AUTO_TEST_CASE(task_group_test)
+{
+  // Note: Nesting parallel_for within the tasks checks that waiting from within a task cannot deadlock the pool.
+  ThreadPool pool(2);
+  boost::atomic<int> counter(0);
+  TaskGroup group(pool);
+  for(int i = 0; i < 20; ++i) group.run(boost::bind(&run_nested_parallel_for, &pool, &counter));
+  group.wait();
+  BOOST_CHECK_EQUAL(counter, 20);
+
+  group.run(&throw_error);
+  BOOST_CHECK_THROW(group.wait(), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,133 @@
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#include <boost/thread.hpp>
+
+#include <tvgutil/timing/Tracer.h>
+using namespace tvgutil;
+
+//#################### HELPER FUNCTIONS ####################
+
+void trace_nested_scopes(int count)
+{
+  for(int i = 0; i < count; ++i)
+  {
+    TraceScope outer("outer");
+    TraceScope inner("inner");
+  }
+}
+
+//#################### TESTS ####################
+
+BOOST_AUTO_TEST_SUITE(test_Tracer)
+
+BOOST_AUTO_TEST_CASE(chrome_trace_test)
+{
+  Tracer& tracer = Tracer::instance();
+  tracer.clear();
+  tracer.set_enabled(true);
+  trace_nested_scopes(3);
+  tracer.set_enabled(false);
+
+  const std::string path = "test_Tracer.json";
+  tracer.write_chrome_trace(path);
+
+  std::ifstream fs(path.c_str());
+  std::stringstream ss;
+  ss << fs.rdbuf();
+  fs.close();
+  std::remove(path.c_str());
+
+  const std::string json = ss.str();
+  BOOST_CHECK(json.find("\"traceEvents\"") != std::string::npos);
+  BOOST_CHECK(json.find("\"name\":\"outer\",\"ph\":\"X\"") != std::string::npos);
+  BOOST_CHECK(json.find("\"depth\":1") != std::string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(clear_test)
+{
+  Tracer& tracer = Tracer::instance();
+  tracer.clear();
+  tracer.set_enabled(true);
+
+  boost::thread_group threads;
+  for(int i = 0; i < 4; ++i) threads.create_thread(boost::bind(&trace_nested_scopes, 1000));
+
+  // Clear the tracer while the threads are still recording, to check that this is safe.
+  for(int i = 0; i < 10; ++i) tracer.clear();
+
+  threads.join_all();
+
+  // Once the threads have finished, clearing the tracer should discard all of their events.
+  tracer.clear();
+  BOOST_CHECK(tracer.compute_statistics().empty());
+
+  // Events recorded after the tracer has been cleared should be kept.
+  trace_nested_scopes(3);
+  tracer.set_enabled(false);
+
+  std::vector<StageStatistics> stats = tracer.compute_statistics();
+  BOOST_REQUIRE_EQUAL(stats.size(), 2);
+  BOOST_CHECK_EQUAL(stats[0].count, 3);
+  BOOST_CHECK_EQUAL(stats[1].count, 3);
+}
+
+BOOST_AUTO_TEST_CASE(disabled_test)
+{
+  Tracer& tracer = Tracer::instance();
+  tracer.clear();
+  tracer.set_enabled(false);
+  trace_nested_scopes(10);
+  BOOST_CHECK(tracer.compute_statistics().empty());
+}
+
+BOOST_AUTO_TEST_CASE(statistics_test)
+{
+  Tracer& tracer = Tracer::instance();
+  tracer.clear();
+  tracer.set_enabled(true);
+  trace_nested_scopes(100);
+  tracer.set_enabled(false);
+
+  std::vector<StageStatistics> stats = tracer.compute_statistics();
+  BOOST_REQUIRE_EQUAL(stats.size(), 2);
+  BOOST_CHECK_EQUAL(stats[0].name, "inner");
+  BOOST_CHECK_EQUAL(stats[1].name, "outer");
+
+  for(size_t i = 0; i < 2; ++i)
+  {
+    BOOST_CHECK_EQUAL(stats[i].count, 100);
+    BOOST_CHECK(stats[i].p50Ms <= stats[i].p95Ms);
+    BOOST_CHECK(stats[i].p95Ms <= stats[i].p99Ms);
+    BOOST_CHECK(stats[i].p99Ms <= stats[i].maxMs);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(threads_test)
+{
+  Tracer& tracer = Tracer::instance();
+  tracer.clear();
+  tracer.set_enabled(true);
+
+  // Note: The buffer capacity only applies to threads that have not yet recorded any events.
+  tracer.set_buffer_capacity(64);
+  boost::thread_group threads;
+  for(int i = 0; i < 4; ++i) threads.create_thread(boost::bind(&trace_nested_scopes, 1000));
+
+  // Compute statistics while the threads are still recording, to check that this is safe.
+  for(int i = 0; i < 10; ++i) tracer.compute_statistics();
+
+  threads.join_all();
+  tracer.set_enabled(false);
+
+  // Each thread's ring buffer should have kept only its most recent events.
+  std::vector<StageStatistics> stats = tracer.compute_statistics();
+  BOOST_REQUIRE_EQUAL(stats.size(), 2);
+  BOOST_CHECK_EQUAL(stats[0].count + stats[1].count, 4 * 64);
+}
+
+BOOST_AUTO_TEST_SUITE_END()